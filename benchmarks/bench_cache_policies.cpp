@@ -0,0 +1,132 @@
+#include "../include/lru_cache.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <random> // For the synthetic trace
+#include <algorithm> // For std::lower_bound
+#include <cmath> // For std::pow
+#include <chrono> // For timing
+
+namespace {
+    // Keys in the synthetic hot working set.
+    constexpr size_t WORKING_SET_KEYS = 100000;
+    // Requests in the synthetic trace before and after the sweep (each).
+    constexpr size_t PHASE_REQUESTS = 1000000;
+    // Distinct keys touched once by the nightly sweep.
+    constexpr size_t SWEEP_KEYS = 500000;
+    // Requests after the sweep over which the recovery hit ratio is measured.
+    constexpr size_t RECOVERY_REQUESTS = 200000;
+    // Cache capacity used for every policy.
+    constexpr size_t CACHE_CAPACITY = 10000;
+    // Zipf exponent of the working set.
+    constexpr double ZIPF_EXPONENT = 0.99;
+
+    // Builds a trace: zipfian reads over the working set, one sweep over fresh keys, then zipfian reads again.
+    // Returns the index of the first request after the sweep through sweepEnd.
+    std::vector<std::string> syntheticTrace(size_t& sweepEnd) {
+        // Cumulative zipf weights of the working set keys.
+        std::vector<double> cdf(WORKING_SET_KEYS);
+        // Running total.
+        double total = 0;
+        // Weight of rank i is 1 / (i + 1)^s.
+        for (size_t i = 0; i < WORKING_SET_KEYS; ++i) cdf[i] = total += 1.0 / std::pow(static_cast<double>(i + 1), ZIPF_EXPONENT);
+        // Fixed seed so every run sees the same trace.
+        std::mt19937_64 rng(7);
+        // Uniform draw over the total weight.
+        std::uniform_real_distribution<double> draw(0, total);
+        // The trace.
+        std::vector<std::string> trace;
+        // Room for every request.
+        trace.reserve(2 * PHASE_REQUESTS + SWEEP_KEYS);
+        // Appends one zipfian request.
+        auto zipfRequest = [&]() {
+            // Rank of the drawn key.
+            size_t rank = static_cast<size_t>(std::lower_bound(cdf.begin(), cdf.end(), draw(rng)) - cdf.begin());
+            // Its key.
+            trace.push_back("user:" + std::to_string(rank));
+        };
+        // Steady state before the sweep.
+        for (size_t i = 0; i < PHASE_REQUESTS; ++i) zipfRequest();
+        // The batch job touches every key of another keyspace once.
+        for (size_t i = 0; i < SWEEP_KEYS; ++i) trace.push_back("batch:" + std::to_string(i));
+        // Start of the recovery phase.
+        sweepEnd = trace.size();
+        // Steady state after the sweep.
+        for (size_t i = 0; i < PHASE_REQUESTS; ++i) zipfRequest();
+        // Return the trace.
+        return trace;
+    }
+
+    // Replays a trace through a cache (read, and insert on a miss) and reports hit ratios and speed.
+    void replay(const char* name, CachePolicy policy, const std::vector<std::string>& trace, size_t sweepEnd) {
+        // Cache under test.
+        LRUCache cache(CACHE_CAPACITY, policy);
+        // Hits overall.
+        size_t hits = 0;
+        // Hits in the recovery window right after the sweep.
+        size_t recoveryHits = 0;
+        // Start of the replay.
+        auto start = std::chrono::steady_clock::now();
+        // Replay every request.
+        for (size_t i = 0; i < trace.size(); ++i) {
+            // Hash once, as KVStore does.
+            uint64_t hashCode = Utils::hash64(trace[i]);
+            // Read the key.
+            bool hit = cache.find(trace[i], hashCode).has_value();
+            // Insert it on a miss, as KVStore::get does.
+            if (!hit) cache.put(trace[i], "value", hashCode);
+            // Count the hit.
+            hits += hit;
+            // Count it for the recovery window too.
+            if (hit && i >= sweepEnd && i < sweepEnd + RECOVERY_REQUESTS) recoveryHits++;
+        }
+        // Nanoseconds per request.
+        double nsPerRequest = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()) / trace.size();
+        // Report the figures.
+        std::cout << name << ": hit ratio " << 100.0 * hits / trace.size() << "%";
+        // Recovery figure, if the trace has a sweep.
+        if (sweepEnd < trace.size()) {
+            // Hits in the window after the sweep.
+            std::cout << ", first " << RECOVERY_REQUESTS << " requests after the sweep "
+                      << 100.0 * recoveryHits / std::min(RECOVERY_REQUESTS, trace.size() - sweepEnd) << "%";
+        }
+        // Speed.
+        std::cout << ", " << nsPerRequest << " ns/request" << std::endl;
+    }
+}
+
+// Main function for the cache policy benchmark. Usage: bench_cache_policies [traceFile]
+// (one key per line; without a file a synthetic zipfian trace with a one-off keyspace sweep is used).
+int main(int argc, char** argv) {
+    // The trace.
+    std::vector<std::string> trace;
+    // Start of the recovery window (past the end when the trace has no known sweep).
+    size_t sweepEnd = 0;
+    // Load a recorded trace if one was given.
+    if (argc > 1) {
+        // Trace file.
+        std::ifstream file(argv[1]);
+        // One key per line.
+        std::string key;
+        // Read every key.
+        while (std::getline(file, key)) trace.push_back(key);
+        // No sweep position is known.
+        sweepEnd = trace.size();
+    } else {
+        // Build the synthetic trace.
+        trace = syntheticTrace(sweepEnd);
+    }
+    // Describe the run.
+    std::cout << "requests: " << trace.size() << ", cache capacity: " << CACHE_CAPACITY << std::endl;
+    // Replay through each policy.
+    replay("LRU", CachePolicy::LRU, trace, sweepEnd);
+    // W-TinyLFU.
+    replay("W-TinyLFU", CachePolicy::WTinyLFU, trace, sweepEnd);
+    // S3-FIFO.
+    replay("S3-FIFO", CachePolicy::S3FIFO, trace, sweepEnd);
+    // Return 0 indicating successful execution.
+    return 0;
+}
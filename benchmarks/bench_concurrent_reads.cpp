@@ -0,0 +1,188 @@
+#include "../include/concurrent_hash_map.hpp"
+#include "../include/hash_map.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread> // For the readers and the writer
+#include <atomic> // For the stop flag and counters
+#include <shared_mutex> // For the locked baseline
+#include <mutex> // For std::unique_lock
+#include <chrono> // For timing
+#include <cstdlib> // For std::strtoull
+#include <algorithm> // For std::max
+
+namespace {
+    // Keys stored.
+    constexpr size_t KEYS = 100000;
+    // Value size in bytes.
+    constexpr size_t VALUE_SIZE = 32;
+    // Reads between two writes of the writer (about 95% reads with one reader).
+    constexpr size_t READS_PER_WRITE = 19;
+
+    // Reads and writes done in one run.
+    struct RunResult {
+        // GETs by all readers.
+        uint64_t reads = 0;
+        // SETs by the writer.
+        uint64_t writes = 0;
+        // Elapsed seconds.
+        double seconds = 0.0;
+    };
+
+    // Runs readers reader threads issuing GETs through read, alongside one writer issuing SETs through write
+    // paced to one per READS_PER_WRITE reads of the first reader, for the given number of milliseconds.
+    template <typename Read, typename Write>
+    RunResult run(const std::vector<std::string>& keys, size_t readers, size_t millis, Read read, Write write) {
+        // Tells everyone to stop.
+        std::atomic<bool> stop{false};
+        // Reads of the first reader, which pace the writer.
+        std::atomic<uint64_t> pacing{0};
+        // Total reads.
+        std::atomic<uint64_t> reads{0};
+        // Total writes.
+        uint64_t writes = 0;
+        // The threads.
+        std::vector<std::thread> threads;
+        // Start the readers.
+        for (size_t r = 0; r < readers; ++r) {
+            // Each walks the keys with its own stride.
+            threads.emplace_back([&keys, &stop, &pacing, &reads, &read, r]() {
+                // Reused value buffer.
+                std::string value;
+                // Local count.
+                uint64_t count = 0;
+                // Position in the keys.
+                size_t index = r * 7919;
+                // Until told to stop.
+                while (!stop.load(std::memory_order_relaxed)) {
+                    // A batch between looks at the flag.
+                    for (size_t i = 0; i < 64; ++i) {
+                        // Next key.
+                        index = (index + 104729) % keys.size();
+                        // Read it.
+                        read(keys[index], value);
+                    }
+                    // Count the batch.
+                    count += 64;
+                    // The first reader paces the writer (its own cache line is the only one it writes to).
+                    if (r == 0) pacing.store(count, std::memory_order_relaxed);
+                }
+                // Publish.
+                reads.fetch_add(count);
+            });
+        }
+        // The writer.
+        threads.emplace_back([&keys, &stop, &pacing, &writes, &write, readers]() {
+            // The value written.
+            std::string value(VALUE_SIZE, 'w');
+            // Position in the keys.
+            size_t index = 0;
+            // Until told to stop.
+            while (!stop.load(std::memory_order_relaxed)) {
+                // Stay at one write per READS_PER_WRITE reads of the first reader (or run free without readers).
+                if (readers > 0 && writes * READS_PER_WRITE >= pacing.load(std::memory_order_relaxed)) {
+                    // Let the readers run.
+                    std::this_thread::yield();
+                    // Look again.
+                    continue;
+                }
+                // Next key.
+                index = (index + 7919) % keys.size();
+                // Overwrite it.
+                write(keys[index], value);
+                // Count it.
+                ++writes;
+            }
+        });
+        // Start of the run.
+        auto start = std::chrono::steady_clock::now();
+        // Let it run.
+        std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+        // Stop everyone.
+        stop.store(true);
+        // Wait for them.
+        for (std::thread& thread : threads) thread.join();
+        // Report.
+        return RunResult{reads.load(), writes, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+    }
+
+    // Prints one run.
+    void report(const char* label, size_t readers, const RunResult& result) {
+        // Reads per second by all readers, and the writer's rate.
+        std::cout << "  " << label << ", " << readers << " reader(s): "
+                  << static_cast<uint64_t>(static_cast<double>(result.reads) / result.seconds) << " reads/s, "
+                  << static_cast<uint64_t>(static_cast<double>(result.writes) / result.seconds) << " writes/s" << std::endl;
+    }
+}
+
+// Main function for the lock-free read benchmark. Usage: bench_concurrent_reads [max readers] [milliseconds per run]
+// Runs 1, 2, 4, ... reader threads doing GETs against one writer doing SETs (about 5% of the traffic) and compares
+// a HashMap behind a std::shared_mutex (every GET takes the lock, so its counter's cache line bounces between the
+// readers' cores) with ConcurrentHashMap (GETs write nothing shared). Scaling needs a hardware thread per reader
+// plus one for the writer.
+int main(int argc, char** argv) {
+    // Largest reader count (one per hardware thread by default).
+    size_t maxReaders = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::max<size_t>(1, std::thread::hardware_concurrency());
+    // Length of each run.
+    size_t millis = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 500;
+    // The keys.
+    std::vector<std::string> keys;
+    // Room for them.
+    keys.reserve(KEYS);
+    // Build them.
+    for (size_t i = 0; i < KEYS; ++i) keys.push_back("key:" + std::to_string(i));
+    // Locked baseline.
+    HashMap locked(KEYS * 2);
+    // Its lock.
+    std::shared_mutex lock;
+    // Lock-free variant.
+    ConcurrentHashMap lockFree(KEYS * 2);
+    // Fill both.
+    for (const std::string& key : keys) {
+        // Same value in each.
+        locked.set(key, std::string(VALUE_SIZE, 'v'));
+        // Same value in each.
+        lockFree.set(key, std::string(VALUE_SIZE, 'v'));
+    }
+    // Describe the run.
+    std::cout << KEYS << " keys, " << VALUE_SIZE << "-byte values, one writer at one SET per " << READS_PER_WRITE
+              << " GETs of a reader, " << millis << " ms per run" << std::endl;
+    // Double the readers each round.
+    for (size_t readers = 1; readers <= maxReaders; readers *= 2) {
+        // Shared lock per GET, exclusive lock per SET.
+        RunResult baseline = run(keys, readers, millis,
+            [&locked, &lock](const std::string& key, std::string& value) {
+                // Readers share the lock (and its counter).
+                std::shared_lock<std::shared_mutex> guard(lock);
+                // Const lookup, safe under a shared lock.
+                std::optional<std::string_view> found = locked.peek(key);
+                // Copy it out while locked.
+                if (found) value.assign(found->data(), found->size());
+            },
+            [&locked, &lock](const std::string& key, const std::string& value) {
+                // Writers exclude everyone.
+                std::unique_lock<std::shared_mutex> guard(lock);
+                // Overwrite.
+                locked.set(key, value);
+            });
+        // Report it.
+        report("shared_mutex HashMap", readers, baseline);
+        // No locks on the read path.
+        RunResult epochs = run(keys, readers, millis,
+            [&lockFree](const std::string& key, std::string& value) {
+                // Lock-free lookup.
+                lockFree.get(key, value);
+            },
+            [&lockFree](const std::string& key, const std::string& value) {
+                // Publishes a new record.
+                lockFree.set(key, value);
+            });
+        // Report it.
+        report("ConcurrentHashMap   ", readers, epochs);
+    }
+    // Retired records freed along the way.
+    std::cout << "ConcurrentHashMap reclaimed " << lockFree.reclaimedCount() << " retired records, "
+              << lockFree.pendingReclamation() << " pending" << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "../include/core_server.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread> // For the server and the clients
+#include <chrono> // For timing
+#include <cstdlib> // For std::strtoull
+#include <algorithm> // For std::max
+#include <unistd.h> // For read, write, close
+#include <sys/socket.h> // For the client sockets
+#include <netinet/in.h> // For sockaddr_in
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <arpa/inet.h> // For inet_pton
+
+namespace {
+    // Commands each client issues by default.
+    constexpr size_t DEFAULT_COMMANDS = 100000;
+    // Keys the commands spread over.
+    constexpr size_t KEYS = 100000;
+    // Commands per pipeline.
+    constexpr size_t DEPTH = 16;
+    // Client connections per core.
+    constexpr size_t CLIENTS_PER_CORE = 2;
+
+    // Opens a client connection to the server on localhost.
+    int connectTo(uint16_t port) {
+        // TCP socket.
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        // Server address.
+        sockaddr_in address{};
+        // IPv4.
+        address.sin_family = AF_INET;
+        // Port in network order.
+        address.sin_port = htons(port);
+        // Loopback.
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        // Connect.
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return -1;
+        // Small requests go out at once.
+        int enable = 1;
+        // Set it.
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        // Hand it back.
+        return fd;
+    }
+
+    // Issues commands as pipelines of DEPTH GET/SET on its own keys; returns false if the connection failed.
+    bool runClient(uint16_t port, size_t client, size_t commands) {
+        // Its connection.
+        int fd = connectTo(port);
+        // Refused.
+        if (fd < 0) return false;
+        // Read buffer.
+        std::vector<char> buffer(64 * 1024);
+        // One pipeline.
+        std::string pipeline;
+        // Bytes of its replies.
+        size_t replyBytes = 0;
+        // Build it: alternating GET and SET on keys spread over every core.
+        for (size_t i = 0; i < DEPTH; ++i) {
+            // Key for this command.
+            std::string key = "key:" + std::to_string((client * 7919 + i * 104729) % KEYS);
+            // Command and reply.
+            if (i % 2 == 0) {
+                // Read it.
+                pipeline += "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+                // "$32\r\n" + value + "\r\n".
+                replyBytes += 5 + 32 + 2;
+            } else {
+                // Overwrite it.
+                pipeline += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$32\r\n" + std::string(32, 'w') + "\r\n";
+                // "+OK\r\n".
+                replyBytes += 5;
+            }
+        }
+        // Issue them.
+        for (size_t done = 0; done < commands; done += DEPTH) {
+            // Send the pipeline.
+            for (size_t sent = 0; sent < pipeline.size();) {
+                // Send the rest.
+                ssize_t n = ::write(fd, pipeline.data() + sent, pipeline.size() - sent);
+                // Broken connection.
+                if (n <= 0) return false;
+                // Past it.
+                sent += static_cast<size_t>(n);
+            }
+            // Read every reply.
+            for (size_t received = 0; received < replyBytes;) {
+                // Read what is there.
+                ssize_t n = ::read(fd, buffer.data(), buffer.size());
+                // Broken connection.
+                if (n <= 0) return false;
+                // Count it.
+                received += static_cast<size_t>(n);
+            }
+        }
+        // Done with it.
+        ::close(fd);
+        // Served.
+        return true;
+    }
+}
+
+// Main function for the thread-per-core scaling benchmark. Usage: bench_core_scaling [max cores] [commands per client]
+// Runs a CoreServer with 1, 2, 4, ... cores, each driven by CLIENTS_PER_CORE pipelining clients over loopback, and
+// reports the aggregate throughput and how much of it was forwarded between cores. Client threads share the machine
+// with the cores, so near-linear scaling needs at least twice as many hardware threads as cores.
+int main(int argc, char** argv) {
+    // Largest group (one per hardware thread by default).
+    size_t maxCores = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : std::max<size_t>(1, std::thread::hardware_concurrency());
+    // Commands per client.
+    size_t commands = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : DEFAULT_COMMANDS;
+    // Describe the run.
+    std::cout << "pipeline depth " << DEPTH << ", " << CLIENTS_PER_CORE << " clients per core, " << commands
+              << " commands per client (half GET, half SET of 32-byte values)" << std::endl;
+    // Double the cores each round.
+    for (size_t cores = 1; cores <= maxCores; cores *= 2) {
+        // Settings.
+        ServerConfig config;
+        // Any free port.
+        config.port = 0;
+        // The group.
+        CoreServer server(cores, KVStoreConfig(), config);
+        // Fill each partition with the keys it owns.
+        for (size_t i = 0; i < KEYS; ++i) {
+            // The key.
+            std::string key = "key:" + std::to_string(i);
+            // Into its owner's partition.
+            server.partition(server.ownerOf(Utils::hash64(key))).set(key, std::string(32, 'v'));
+        }
+        // Listen.
+        if (!server.start()) {
+            // Report it.
+            std::cerr << "Could not listen on loopback." << std::endl;
+            // Fail.
+            return 1;
+        }
+        // Serve in the background.
+        std::thread loop([&server]() { server.run(); });
+        // Clients of this round.
+        size_t clients = cores * CLIENTS_PER_CORE;
+        // Whether each client finished.
+        std::vector<char> succeeded(clients, 0);
+        // Their threads.
+        std::vector<std::thread> threads;
+        // Start of the run.
+        auto start = std::chrono::steady_clock::now();
+        // Start them.
+        for (size_t c = 0; c < clients; ++c) threads.emplace_back([&server, &succeeded, c, commands]() { succeeded[c] = runClient(server.port(), c, commands); });
+        // Wait for them.
+        for (std::thread& thread : threads) thread.join();
+        // Elapsed seconds.
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // Stop the cores.
+        server.stop();
+        // Wait for them.
+        loop.join();
+        // A client failed.
+        for (char ok : succeeded) {
+            // Report it.
+            if (!ok) {
+                // Say so.
+                std::cerr << "Connection failed." << std::endl;
+                // Fail.
+                return 1;
+            }
+        }
+        // The cores' counters.
+        ServerStats stats = server.stats();
+        // Report the round.
+        std::cout << cores << " cores: " << static_cast<size_t>(static_cast<double>(stats.commandsProcessed) / seconds) << " commands/s, "
+                  << (stats.commandsProcessed == 0 ? 0 : stats.forwardedCommands * 100 / stats.commandsProcessed) << "% forwarded, "
+                  << stats.peerWakeups << " peer wake-ups" << std::endl;
+    }
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,137 @@
+#include "../include/kv_store.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib> // For std::malloc/std::free
+#include <new> // For replacing global operator new
+
+// Number of heap allocations made by the whole process so far.
+static size_t allocationCount = 0;
+
+// Counting replacement for the global allocation function.
+void* operator new(size_t size) {
+    // Count the allocation.
+    allocationCount++;
+    // Forward to malloc.
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        // Return the allocated block.
+        return ptr;
+    }
+    // Report allocation failure the standard way.
+    throw std::bad_alloc();
+}
+
+// Matching replacement for the global deallocation function.
+void operator delete(void* ptr) noexcept {
+    // Forward to free.
+    std::free(ptr);
+}
+
+// Sized deallocation forwards to the unsized version.
+void operator delete(void* ptr, size_t) noexcept {
+    // Forward to free.
+    std::free(ptr);
+}
+
+// Runs GETs for keys held in plain char buffers and returns the average allocations per GET.
+template <typename GetFn>
+double allocationsPerGet(const std::vector<std::vector<char>>& keyBuffers, size_t rounds, GetFn getFn) {
+    // Allocation count before the timed loop.
+    size_t before = allocationCount;
+    // Number of GETs performed.
+    size_t gets = 0;
+    // Repeat over the key set.
+    for (size_t round = 0; round < rounds; ++round) {
+        // Look up each key from its C buffer.
+        for (const auto& buffer : keyBuffers) {
+            // Perform the GET.
+            getFn(buffer.data());
+            // Count it.
+            gets++;
+        }
+    }
+    // Average allocations per GET.
+    return static_cast<double>(allocationCount - before) / static_cast<double>(gets);
+}
+
+// Main function for the GET allocation microbenchmark.
+int main() {
+    // Number of keys loaded into the store.
+    const size_t numKeys = 10000;
+    // Cache capacity; the hot set below fits, the full key set does not.
+    const size_t cacheCapacity = 100;
+    // Store sized so the Bloom filter is not saturated.
+    KVStore store(numKeys * 2, cacheCapacity, numKeys * 10, 3);
+    // Keys as NUL-terminated C buffers, the way network callers hold them.
+    std::vector<std::vector<char>> keyBuffers;
+    // Values longer than the small-string buffer so every copy allocates.
+    std::string valuePadding(64, 'v');
+    // Load the store.
+    for (size_t i = 0; i < numKeys; ++i) {
+        // Keys longer than the small-string buffer as well.
+        std::string key = "benchmark:user:session:" + std::to_string(i);
+        // Insert the pair.
+        store.set(key, valuePadding + std::to_string(i));
+        // Keep a C copy of the key.
+        keyBuffers.emplace_back(key.c_str(), key.c_str() + key.size() + 1);
+    }
+    // Hot keys that stay in the cache.
+    std::vector<std::vector<char>> hotKeys(keyBuffers.end() - cacheCapacity / 2, keyBuffers.end());
+    // Sink that keeps the compiler from discarding results.
+    size_t checksum = 0;
+
+    // Cache hits through the copying API (the key must become a std::string first).
+    double legacyHit = allocationsPerGet(hotKeys, 100, [&](const char* key) {
+        // Build a temporary key and receive a copied value.
+        checksum += store.get(std::string(key)).size();
+    });
+    // Cache hits through the borrowed-view API.
+    double viewHit = allocationsPerGet(hotKeys, 100, [&](const char* key) {
+        // Borrow the value directly.
+        checksum += store.getView(key)->size();
+    });
+    // Cache misses (cycling the whole key set evicts everything) through the copying API.
+    double legacyMiss = allocationsPerGet(keyBuffers, 3, [&](const char* key) {
+        // Build a temporary key and receive a copied value.
+        checksum += store.get(std::string(key)).size();
+    });
+    // Cache misses through the borrowed-view API.
+    double viewMiss = allocationsPerGet(keyBuffers, 3, [&](const char* key) {
+        // Borrow the value directly.
+        checksum += store.getView(key)->size();
+    });
+    // Absent keys (rejected by the Bloom filter or the table) through both APIs.
+    std::vector<std::vector<char>> absentKeys;
+    // Build absent keys of the same shape.
+    for (size_t i = 0; i < 1000; ++i) {
+        // Key that was never inserted.
+        std::string key = "benchmark:user:missing:" + std::to_string(i);
+        // Keep a C copy of the key.
+        absentKeys.emplace_back(key.c_str(), key.c_str() + key.size() + 1);
+    }
+    // Misses through the copying API.
+    double legacyAbsent = allocationsPerGet(absentKeys, 10, [&](const char* key) {
+        // Build a temporary key and receive an empty string.
+        checksum += store.get(std::string(key)).size();
+    });
+    // Misses through the borrowed-view API.
+    double viewAbsent = allocationsPerGet(absentKeys, 10, [&](const char* key) {
+        // Borrow (nothing).
+        checksum += store.getView(key).has_value();
+    });
+
+    // Print the results table.
+    std::cout << "Allocations per GET (keys/values longer than SSO, cache capacity " << cacheCapacity << ")" << std::endl;
+    // Header row.
+    std::cout << "case          get(std::string)  getView(string_view)" << std::endl;
+    // Cache hits.
+    std::cout << "cache hit     " << legacyHit << "                 " << viewHit << std::endl;
+    // Cache misses.
+    std::cout << "cache miss    " << legacyMiss << "                 " << viewMiss << std::endl;
+    // Absent keys.
+    std::cout << "absent key    " << legacyAbsent << "                 " << viewAbsent << std::endl;
+    // Print the checksum so the work is observable.
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
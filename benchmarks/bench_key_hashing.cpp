@@ -0,0 +1,128 @@
+#include "../include/kv_store.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono> // For timing
+#include <functional> // For std::hash
+
+namespace {
+    // Per-character modulo hash the HashMap used before hash64 (one division per byte).
+    size_t legacyMapHash(const std::string& key, size_t tableCapacity) {
+        // Running hash.
+        size_t hashCode = 0;
+        // Fold in each character.
+        for (char c : key) {
+            // Multiply-add, reduced every step.
+            hashCode = (hashCode * 31 + c) % tableCapacity;
+        }
+        // Return the slot index.
+        return hashCode;
+    }
+
+    // DJB2, the first legacy Bloom hash.
+    unsigned int legacyBloomHash1(const std::string& key) {
+        // Seed.
+        unsigned int hash = 5381;
+        // hash * 33 + c per character.
+        for (char c : key) hash = ((hash << 5) + hash) + c;
+        // Return the hash.
+        return hash;
+    }
+
+    // SDBM, the second legacy Bloom hash.
+    unsigned int legacyBloomHash2(const std::string& key) {
+        // Seed.
+        unsigned int hash = 0;
+        // SDBM step per character.
+        for (char c : key) hash = c + (hash << 6) + (hash << 16) - hash;
+        // Return the hash.
+        return hash;
+    }
+
+    // Multiply-by-31, the third legacy Bloom hash.
+    unsigned int legacyBloomHash3(const std::string& key) {
+        // Seed.
+        unsigned int hash = 0;
+        // hash * 31 + c per character.
+        for (char c : key) hash = (hash * 31) + c;
+        // Return the hash.
+        return hash;
+    }
+
+    // Returns nanoseconds per call of fn over every key, repeated rounds times.
+    template <typename Fn>
+    double nsPerKey(const std::vector<std::string>& keys, size_t rounds, Fn fn) {
+        // Start time.
+        auto start = std::chrono::steady_clock::now();
+        // Repeat over the key set.
+        for (size_t round = 0; round < rounds; ++round) {
+            // Call fn for each key.
+            for (const std::string& key : keys) fn(key);
+        }
+        // Elapsed nanoseconds.
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        // Average per key.
+        return elapsed / static_cast<double>(keys.size() * rounds);
+    }
+}
+
+// Main function for the key hashing microbenchmark.
+int main() {
+    // Number of distinct keys.
+    const size_t numKeys = 200000;
+    // Passes over the key set for the pure hashing loops.
+    const size_t rounds = 20;
+    // Keys of a typical shape.
+    std::vector<std::string> keys;
+    // Build the key set.
+    for (size_t i = 0; i < numKeys; ++i) {
+        // One key.
+        keys.push_back("benchmark:user:session:" + std::to_string(i));
+    }
+    // Sink that keeps the compiler from discarding results.
+    uint64_t checksum = 0;
+
+    // Old per-request hashing: map hash + std::hash for the cache + three Bloom hashes.
+    double legacy = nsPerKey(keys, rounds, [&](const std::string& key) {
+        // Slot hash of the old HashMap.
+        checksum += legacyMapHash(key, 1000003);
+        // std::unordered_map hash of the old LRU cache.
+        checksum += std::hash<std::string>{}(key);
+        // Three Bloom hashes.
+        checksum += legacyBloomHash1(key) + legacyBloomHash2(key) + legacyBloomHash3(key);
+    });
+    // New per-request hashing: one hash64 shared by every structure.
+    double shared = nsPerKey(keys, rounds, [&](const std::string& key) {
+        // The single hash.
+        checksum += Utils::hash64(key);
+    });
+
+    // End-to-end SET/GET through the store, which now hashes once per request.
+    KVStore store(numKeys * 2, 1000, numKeys * 10, 3);
+    // Time the inserts.
+    double setNs = nsPerKey(keys, 1, [&](const std::string& key) {
+        // Insert the key as its own value.
+        store.set(key, key);
+    });
+    // Time the lookups (mostly cache misses).
+    double getNs = nsPerKey(keys, 5, [&](const std::string& key) {
+        // Borrow the value.
+        checksum += store.getView(key)->size();
+    });
+
+    // Print the results.
+    std::cout << "Hashing cost per request (" << numKeys << " keys of ~28 bytes)" << std::endl;
+    // Legacy row.
+    std::cout << "legacy (5 hashes)   " << legacy << " ns" << std::endl;
+    // New row.
+    std::cout << "shared hash64       " << shared << " ns" << std::endl;
+    // Store rows.
+    std::cout << "KVStore set         " << setNs << " ns/op" << std::endl;
+    // Store rows.
+    std::cout << "KVStore getView     " << getNs << " ns/op" << std::endl;
+    // Print the checksum so the work is observable.
+    std::cout << "(checksum " << checksum << ")" << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
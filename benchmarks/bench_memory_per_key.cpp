@@ -0,0 +1,105 @@
+#include "../include/hash_map.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib> // For std::strtoull
+#include <unordered_map> // Node-based layout used for comparison
+#include <unistd.h> // For sysconf and fork
+#include <sys/wait.h> // For waitpid
+
+// Returns the resident set size of this process in bytes.
+size_t residentBytes() {
+    // /proc/self/statm reports sizes in pages: total, then resident.
+    std::ifstream statm("/proc/self/statm");
+    // Total program size (unused).
+    size_t totalPages = 0;
+    // Resident pages.
+    size_t residentPages = 0;
+    // Read both fields.
+    statm >> totalPages >> residentPages;
+    // Convert pages to bytes.
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+// Builds the key for index i (13 bytes, typical short key).
+std::string makeKey(size_t i) {
+    // Fixed-width numeric suffix.
+    std::string digits = std::to_string(i);
+    // Zero-pad to 8 digits.
+    return "user:" + std::string(digits.size() < 8 ? 8 - digits.size() : 0, '0') + digits;
+}
+
+// Builds the value for index i (40 bytes, longer than the small-string buffer).
+std::string makeValue(size_t i) {
+    // Fixed payload plus the index.
+    std::string value = "session-token-" + std::to_string(i);
+    // Pad to 40 bytes.
+    value.resize(40, '.');
+    // Return the value.
+    return value;
+}
+
+// Loads numKeys pairs into a node-based map and reports bytes per key.
+void measureNodeBased(size_t numKeys) {
+    // Resident bytes before the load.
+    size_t baseline = residentBytes();
+    // One heap node plus two std::strings per entry, like the old chained HashMap.
+    std::unordered_map<std::string, std::string> nodeMap;
+    // Load every key.
+    for (size_t i = 0; i < numKeys; ++i) {
+        // Insert the pair.
+        nodeMap.emplace(makeKey(i), makeValue(i));
+    }
+    // Bytes added by the load.
+    size_t used = residentBytes() - baseline;
+    // Report bytes per key.
+    std::cout << "node-based (std::unordered_map<string,string>): "
+              << static_cast<double>(used) / numKeys << " bytes/key" << std::endl;
+}
+
+// Loads numKeys pairs into an arena-backed HashMap and reports bytes per key and arena figures.
+void measureArena(size_t numKeys) {
+    // Resident bytes before the load.
+    size_t baseline = residentBytes();
+    // Arena shared with the map, as KVStore does.
+    SlabArena arena;
+    // Open-addressing map whose slots point into the arena.
+    HashMap map(101, HashMap::DEFAULT_MAX_LOAD_FACTOR, HashMap::DEFAULT_MIN_LOAD_FACTOR, &arena);
+    // Load every key.
+    for (size_t i = 0; i < numKeys; ++i) {
+        // Insert the pair.
+        map.set(makeKey(i), makeValue(i));
+    }
+    // Bytes added by the load.
+    size_t used = residentBytes() - baseline;
+    // Arena figures.
+    ArenaStats stats = arena.stats();
+    // Report bytes per key.
+    std::cout << "HashMap + SlabArena: " << static_cast<double>(used) / numKeys << " bytes/key"
+              << " (table slots " << map.capacity() << ")" << std::endl;
+    // Report the arena's own accounting.
+    std::cout << "arena: payload " << stats.payloadBytes << " B, slots " << stats.slotBytes
+              << " B, reserved " << stats.reservedBytes << " B, fragmentation " << stats.fragmentation << std::endl;
+}
+
+// Main function for the bytes-per-key benchmark. Usage: bench_memory_per_key [numKeys] (default 1000000).
+int main(int argc, char** argv) {
+    // Number of keys to load (pass 10000000 for the 10M-key figure).
+    size_t numKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    // Each layout is measured in its own child process so freed memory from one cannot hide the other's growth.
+    for (auto measure : {measureNodeBased, measureArena}) {
+        // Fork the measuring process.
+        pid_t child = fork();
+        // In the child, measure and exit.
+        if (child == 0) {
+            // Run one measurement.
+            measure(numKeys);
+            // Leave without running the parent's remaining loop.
+            std::exit(0);
+        }
+        // Wait for the child before starting the next one.
+        waitpid(child, nullptr, 0);
+    }
+    // Return 0 indicating successful execution.
+    return 0;
+}
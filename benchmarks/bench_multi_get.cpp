@@ -0,0 +1,95 @@
+#include "../include/kv_store.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random> // For the key order
+#include <chrono> // For timing
+#include <algorithm> // For std::min
+#include <cstdlib> // For std::strtoull
+
+namespace {
+    // Keys stored by default; enough that the table, records and filter are far larger than the CPU caches.
+    constexpr size_t DEFAULT_KEYS = 2000000;
+    // Keys looked up per measurement.
+    constexpr size_t LOOKUPS = 2000000;
+    // One lookup in this many asks for a key that was never stored.
+    constexpr size_t MISS_EVERY = 10;
+
+    // Returns the nanoseconds per key of reading every key through lookup, which takes one request's keys.
+    template <typename Lookup>
+    double nsPerKey(const std::vector<std::string>& keys, size_t keysPerRequest, Lookup lookup) {
+        // One request's keys.
+        std::vector<std::string> request;
+        // Values seen, so the lookups cannot be optimized away.
+        size_t found = 0;
+        // Start of the run.
+        auto start = std::chrono::steady_clock::now();
+        // Issue the keys a request at a time.
+        for (size_t begin = 0; begin < keys.size(); begin += keysPerRequest) {
+            // This request's keys.
+            request.assign(keys.begin() + begin, keys.begin() + std::min(keys.size(), begin + keysPerRequest));
+            // Resolve them.
+            found += lookup(request);
+        }
+        // Elapsed nanoseconds.
+        double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+        // Keep the count observable.
+        if (found == 0) std::cout << "(no hits)" << std::endl;
+        // Per key.
+        return ns / static_cast<double>(keys.size());
+    }
+}
+
+// Main function for the batched lookup benchmark. Usage: bench_multi_get [keys]
+// Compares one getView per key with multiGet requests of growing size over a store larger than the CPU caches.
+int main(int argc, char** argv) {
+    // Number of stored keys.
+    size_t numKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_KEYS;
+    // Store sized for the keys, so the filter stays accurate.
+    KVStoreConfig config;
+    // Expected keys for the filter.
+    config.bloomExpectedKeys = numKeys;
+    // Build the store.
+    KVStore store(config);
+    // Fill it.
+    for (size_t i = 0; i < numKeys; ++i) store.set("user:" + std::to_string(i), "profile-" + std::to_string(i));
+    // Random lookup order with a share of missing keys.
+    std::mt19937_64 rng(5);
+    // The keys to read.
+    std::vector<std::string> keys;
+    // Room for them.
+    keys.reserve(LOOKUPS);
+    // Draw them.
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+        // Mostly stored keys, sometimes one that never was.
+        keys.push_back((i % MISS_EVERY == 0 ? "absent:" : "user:") + std::to_string(rng() % numKeys));
+    }
+    // Describe the run.
+    std::cout << "keys: " << numKeys << ", lookups: " << LOOKUPS << ", prefetch batch: " << config.multiKeyBatch << std::endl;
+    // Warm-up pass, so the first measurement does not also pay for page faults and frequency ramp-up.
+    for (const std::string& key : keys) store.getView(key);
+    // Baseline: one getView per key, each paying its cache misses in turn.
+    double single = nsPerKey(keys, 1, [&](const std::vector<std::string>& request) {
+        // The only key.
+        return store.getView(request[0]).has_value() ? size_t{1} : size_t{0};
+    });
+    // Report it.
+    std::cout << "getView per key: " << single << " ns/key" << std::endl;
+    // Requests of growing size.
+    for (size_t keysPerRequest : {1, 4, 16, 64, 256, 1024}) {
+        // Same keys through multiGet.
+        double batched = nsPerKey(keys, keysPerRequest, [&](const std::vector<std::string>& request) {
+            // Hits in this request.
+            size_t hits = 0;
+            // Count them.
+            for (const std::optional<std::string_view>& value : store.multiGet(request)) hits += value.has_value();
+            // Return the count.
+            return hits;
+        });
+        // Report it against the baseline.
+        std::cout << "MGET of " << keysPerRequest << " keys: " << batched << " ns/key (" << single / batched << "x)" << std::endl;
+    }
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include "../include/kv_store.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono> // For timing
+#include <cstdlib> // For std::strtoull
+#include <cstdint> // For SIZE_MAX
+
+namespace {
+    // Builds the date part of a key for a day of October 2026.
+    std::string dayKey(int day) {
+        // Zero-padded day of month.
+        return "order:2026-10-" + std::string(day < 10 ? "0" : "") + std::to_string(day);
+    }
+
+    // Returns microseconds per query for queries runs that took the given time.
+    double usPerQuery(std::chrono::steady_clock::time_point start, size_t queries) {
+        // Elapsed nanoseconds.
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        // Average per query, in microseconds.
+        return static_cast<double>(elapsed.count()) / queries / 1000.0;
+    }
+}
+
+// Main function for the range scan benchmark. Usage: bench_range_scan [ordersPerDay] (default 5000).
+int main(int argc, char** argv) {
+    // Orders stored for each day of the month.
+    size_t ordersPerDay = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5000;
+    // Store holding a month of orders.
+    KVStore store;
+    // Load every day.
+    for (int day = 1; day <= 31; ++day) {
+        // Load the day's orders.
+        for (size_t n = 0; n < ordersPerDay; ++n) store.set(dayKey(day) + ":" + std::to_string(n), "amount=" + std::to_string(n));
+    }
+    // Queries per measurement.
+    const size_t queries = 20;
+    // Pairs returned (kept so the loops are not optimized away).
+    size_t returned = 0;
+
+    // Workaround: one PREFIX per day in the week, filtered client-side, then a GET per key.
+    auto start = std::chrono::steady_clock::now();
+    // Repeat the query.
+    for (size_t q = 0; q < queries; ++q) {
+        // Pairs for this query.
+        std::vector<std::pair<std::string, std::string>> pairs;
+        // One prefix search per day in [01, 08).
+        for (int day = 1; day < 8; ++day) {
+            // Every key of the day.
+            for (const std::string& key : store.prefixSearch(dayKey(day))) {
+                // Client-side range filter (a day prefix can also match longer dates).
+                if (key < dayKey(1) || key >= dayKey(8)) continue;
+                // Follow-up GET for the value.
+                std::optional<std::string_view> value = store.peek(key);
+                // Keep the pair.
+                if (value) pairs.emplace_back(key, std::string(*value));
+            }
+        }
+        // Count the pairs.
+        returned += pairs.size();
+    }
+    // Workaround latency.
+    double prefixUs = usPerQuery(start, queries);
+
+    // Range scan: one ordered walk returning keys and values.
+    start = std::chrono::steady_clock::now();
+    // Repeat the query.
+    for (size_t q = 0; q < queries; ++q) {
+        // Count the pairs.
+        returned += store.scanRange(dayKey(1), dayKey(8), SIZE_MAX).size();
+    }
+    // Range scan latency.
+    double rangeUs = usPerQuery(start, queries);
+
+    // First page of 100 from the range (a typical paged client).
+    start = std::chrono::steady_clock::now();
+    // Repeat the query.
+    for (size_t q = 0; q < queries; ++q) {
+        // Count the pairs.
+        returned += store.scanRange(dayKey(1), dayKey(8), 100).size();
+    }
+    // Limited scan latency.
+    double pageUs = usPerQuery(start, queries);
+
+    // Report the figures.
+    std::cout << "keys: " << 31 * ordersPerDay << ", range [" << dayKey(1) << ", " << dayKey(8) << ") holds "
+              << 7 * ordersPerDay << " pairs" << std::endl;
+    // Workaround.
+    std::cout << "7x PREFIX + client filter + GET per key: " << prefixUs << " us/query" << std::endl;
+    // Range scan.
+    std::cout << "scanRange (keys + values): " << rangeUs << " us/query" << std::endl;
+    // Limited range scan.
+    std::cout << "scanRange LIMIT 100: " << pageUs << " us/query" << std::endl;
+    // Checksum.
+    std::cout << "(pairs returned: " << returned << ")" << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,179 @@
+#include "../include/kv_store.hpp"
+#include "../include/resp.hpp"
+#include "../include/resp_server.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread> // For the server's event loop
+#include <chrono> // For timing
+#include <cstdlib> // For std::strtoull
+#include <unistd.h> // For read, write, close
+#include <sys/socket.h> // For the client socket
+#include <netinet/in.h> // For sockaddr_in
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <arpa/inet.h> // For inet_pton
+
+namespace {
+    // Commands issued per pipeline depth by default.
+    constexpr size_t DEFAULT_COMMANDS = 200000;
+    // Keys the commands spread over.
+    constexpr size_t KEYS = 10000;
+
+    // Opens a client connection to the server on localhost.
+    int connectTo(uint16_t port) {
+        // TCP socket.
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        // Server address.
+        sockaddr_in address{};
+        // IPv4.
+        address.sin_family = AF_INET;
+        // Port in network order.
+        address.sin_port = htons(port);
+        // Loopback.
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        // Connect.
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) return -1;
+        // Small requests go out at once.
+        int enable = 1;
+        // Set it.
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        // Hand it back.
+        return fd;
+    }
+
+    // Sends data and reads exactly replyBytes back; returns false if the connection failed.
+    bool exchange(int fd, const std::string& data, size_t replyBytes, std::vector<char>& buffer) {
+        // Send the pipeline.
+        for (size_t sent = 0; sent < data.size();) {
+            // Send the rest.
+            ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+            // Broken connection.
+            if (n <= 0) return false;
+            // Past it.
+            sent += static_cast<size_t>(n);
+        }
+        // Read every reply.
+        for (size_t received = 0; received < replyBytes;) {
+            // Read what is there.
+            ssize_t n = ::read(fd, buffer.data(), buffer.size());
+            // Broken connection.
+            if (n <= 0) return false;
+            // Count it.
+            received += static_cast<size_t>(n);
+        }
+        // Round trip done.
+        return true;
+    }
+
+    // Runs every pipeline depth against a server using backend; returns false if it could not be served.
+    bool runBackend(KVStore& store, ServerBackend backend, const char* label, size_t commands) {
+        // Settings.
+        ServerConfig config;
+        // Any free port.
+        config.port = 0;
+        // Event loop to measure.
+        config.backend = backend;
+        // The server.
+        RespServer server(store, config);
+        // Listen.
+        if (!server.start()) {
+            // Report it.
+            std::cerr << "Could not listen on loopback." << std::endl;
+            // Fail.
+            return false;
+        }
+        // io_uring was requested but the kernel or build lacks it.
+        if (server.stats().backend != backend) {
+            // Say so instead of measuring epoll twice.
+            std::cout << label << ": not available (epoll fallback), skipped" << std::endl;
+            // Not a failure.
+            return true;
+        }
+        // Serve in the background.
+        std::thread loop([&server]() { server.run(); });
+        // One client.
+        int fd = connectTo(server.port());
+        // Read buffer.
+        std::vector<char> buffer(256 * 1024);
+        // Pipeline depths to compare.
+        for (size_t depth : {1, 16, 128}) {
+            // One pipeline: alternating GET and SET.
+            std::string pipeline;
+            // Bytes of its replies.
+            size_t replyBytes = 0;
+            // Build it.
+            for (size_t i = 0; i < depth; ++i) {
+                // Key for this command.
+                std::string key = "key:" + std::to_string((i * 7919) % KEYS);
+                // Command and reply.
+                if (i % 2 == 0) {
+                    // Read it.
+                    pipeline += "*2\r\n$3\r\nGET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n";
+                    // "$32\r\n" + value + "\r\n".
+                    replyBytes += 5 + 32 + 2;
+                } else {
+                    // Overwrite it.
+                    pipeline += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" + key + "\r\n$32\r\n" + std::string(32, 'w') + "\r\n";
+                    // "+OK\r\n".
+                    replyBytes += 5;
+                }
+            }
+            // Round trips needed.
+            size_t rounds = (commands + depth - 1) / depth;
+            // Start of the run.
+            auto start = std::chrono::steady_clock::now();
+            // Issue them.
+            for (size_t r = 0; r < rounds; ++r) {
+                // One pipeline.
+                if (!exchange(fd, pipeline, replyBytes, buffer)) {
+                    // Report it.
+                    std::cerr << "Connection failed." << std::endl;
+                    // Stop the loop before failing.
+                    server.stop();
+                    // Wait for it.
+                    loop.join();
+                    // Fail.
+                    return false;
+                }
+            }
+            // Elapsed seconds.
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            // Report it.
+            std::cout << label << " pipeline depth " << depth << ": "
+                      << static_cast<size_t>(static_cast<double>(rounds * depth) / seconds) << " commands/s" << std::endl;
+        }
+        // Done with the client.
+        ::close(fd);
+        // Stop the loop.
+        server.stop();
+        // Wait for it.
+        loop.join();
+        // How the replies went out.
+        ServerStats stats = server.stats();
+        // Report it.
+        std::cout << label << " server: " << stats.commandsProcessed << " commands, " << stats.reads << " reads, "
+                  << stats.writevCalls << " gather writes, " << stats.ringSubmits << " io_uring_enter calls" << std::endl;
+        // Measured.
+        return true;
+    }
+}
+
+// Main function for the pipelining benchmark. Usage: bench_resp_pipeline [commands]
+// Drives an in-process RespServer over loopback with GET/SET pipelines of growing depth, as redis-benchmark -P does,
+// once per event-loop backend (io_uring only when built with -DKV_STORE_IO_URING=ON).
+int main(int argc, char** argv) {
+    // Commands per depth.
+    size_t commands = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_COMMANDS;
+    // The store.
+    KVStore store;
+    // Fill it.
+    for (size_t i = 0; i < KEYS; ++i) store.set("key:" + std::to_string(i), std::string(32, 'v'));
+    // Describe the run.
+    std::cout << "commands per depth: " << commands << " (half GET, half SET of 32-byte values)" << std::endl;
+    // Readiness-based loop.
+    if (!runBackend(store, ServerBackend::Epoll, "epoll", commands)) return 1;
+    // Completion-based loop.
+    if (!runBackend(store, ServerBackend::IoUring, "io_uring", commands)) return 1;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "../include/kv_store.hpp"
+#include <iostream>
+#include <string>
+#include <chrono> // For timing
+#include <cstdlib> // For std::strtoull
+#include <cstdio> // For std::remove
+#include <sys/stat.h> // For the snapshot size
+
+namespace {
+    // Keys stored by default.
+    constexpr size_t DEFAULT_KEYS = 10000000;
+
+    // Returns the seconds elapsed since start.
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        // Elapsed time as a fraction of a second.
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+// Main function for the restart benchmark. Usage: bench_snapshot_restart [keys] [snapshotPath]
+// Times repopulating a store through set() against saving it and loading the snapshot into a fresh store.
+int main(int argc, char** argv) {
+    // Number of keys.
+    size_t numKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : DEFAULT_KEYS;
+    // Snapshot file.
+    std::string path = argc > 2 ? argv[2] : "/tmp/bench_snapshot_restart.kvs";
+    // Both stores are sized for the keys, as a production store would be.
+    KVStoreConfig config;
+    // Filter sized for every key.
+    config.bloomExpectedKeys = numKeys;
+    // Describe the run.
+    std::cout << "keys: " << numKeys << std::endl;
+    // Scope the source store, so only one store is resident at a time.
+    {
+        // Store filled through the normal write path.
+        KVStore source(config);
+        // Start of the replay.
+        auto start = std::chrono::steady_clock::now();
+        // One set per key: HashMap, Trie, cache and filter each do their work.
+        for (size_t i = 0; i < numKeys; ++i) source.set("user:" + std::to_string(i), "profile-" + std::to_string(i));
+        // Report it.
+        std::cout << "repopulate via set(): " << secondsSince(start) << " s" << std::endl;
+        // Start of the save.
+        start = std::chrono::steady_clock::now();
+        // Write the snapshot.
+        if (!source.save(path)) {
+            // Nothing to load.
+            std::cerr << "save to " << path << " failed" << std::endl;
+            // Give up.
+            return 1;
+        }
+        // Size of the file.
+        struct stat info;
+        // Look it up.
+        ::stat(path.c_str(), &info);
+        // Report it.
+        std::cout << "SAVE: " << secondsSince(start) << " s, " << info.st_size / (1024.0 * 1024.0) << " MiB" << std::endl;
+    }
+    // Fresh store, as after a restart.
+    KVStore restored(config);
+    // Start of the load.
+    auto start = std::chrono::steady_clock::now();
+    // Map the file and bulk-build the store.
+    if (!restored.load(path)) {
+        // Report the failure.
+        std::cerr << "load of " << path << " failed" << std::endl;
+        // Give up.
+        return 1;
+    }
+    // Report it.
+    std::cout << "load from snapshot: " << secondsSince(start) << " s (" << restored.size() << " keys)" << std::endl;
+    // Remove the file.
+    std::remove(path.c_str());
+    // Return 0 indicating successful execution.
+    return 0;
+}
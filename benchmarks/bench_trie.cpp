@@ -0,0 +1,214 @@
+#include "../include/trie.hpp"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map> // Child map of the legacy trie
+#include <chrono> // For timing
+#include <cstdlib> // For std::strtoull
+#include <unistd.h> // For sysconf and fork
+#include <sys/wait.h> // For waitpid
+
+namespace {
+    // Node of the Trie this repo used before the adaptive radix tree: one std::map per character.
+    struct LegacyTrieNode {
+        // Children keyed by character.
+        std::map<char, LegacyTrieNode*> children;
+        // True if a key ends at this node.
+        bool isEndOfKey = false;
+        // Frees the children.
+        ~LegacyTrieNode() {
+            // Delete each child.
+            for (auto& pair : children) delete pair.second;
+        }
+    };
+
+    // The legacy Trie, reduced to the operations measured here.
+    class LegacyTrie {
+    private:
+        // Root node.
+        LegacyTrieNode root;
+
+        // Appends every key below node (prefix is the path to it).
+        void collect(const LegacyTrieNode* node, std::string& prefix, std::vector<std::string>& result) const {
+            // A key ends here.
+            if (node->isEndOfKey) result.push_back(prefix);
+            // Visit each child.
+            for (const auto& pair : node->children) {
+                // Extend the path.
+                prefix.push_back(pair.first);
+                // Recurse.
+                collect(pair.second, prefix, result);
+                // Restore the path.
+                prefix.pop_back();
+            }
+        }
+
+    public:
+        // Inserts a key, one node per character.
+        void insert(const std::string& key) {
+            // Start at the root.
+            LegacyTrieNode* current = &root;
+            // Walk or create each character's node.
+            for (char ch : key) {
+                // Child slot for the character.
+                LegacyTrieNode*& child = current->children[ch];
+                // Create it if missing.
+                if (child == nullptr) child = new LegacyTrieNode();
+                // Descend.
+                current = child;
+            }
+            // Mark the end of the key.
+            current->isEndOfKey = true;
+        }
+
+        // Checks if a key exists.
+        bool contains(const std::string& key) const {
+            // Start at the root.
+            const LegacyTrieNode* current = &root;
+            // Follow each character.
+            for (char ch : key) {
+                // Child for the character.
+                auto it = current->children.find(ch);
+                // Missing: not present.
+                if (it == current->children.end()) return false;
+                // Descend.
+                current = it->second;
+            }
+            // Present only if a key ends here.
+            return current->isEndOfKey;
+        }
+
+        // Returns every key starting with prefix.
+        std::vector<std::string> searchPrefix(const std::string& prefix) const {
+            // Keys found.
+            std::vector<std::string> result;
+            // Start at the root.
+            const LegacyTrieNode* current = &root;
+            // Follow the prefix.
+            for (char ch : prefix) {
+                // Child for the character.
+                auto it = current->children.find(ch);
+                // Missing: no keys.
+                if (it == current->children.end()) return result;
+                // Descend.
+                current = it->second;
+            }
+            // Working copy of the path.
+            std::string path = prefix;
+            // Collect the subtree.
+            collect(current, path, result);
+            // Return the keys.
+            return result;
+        }
+    };
+
+    // Returns the resident set size of this process in bytes.
+    size_t residentBytes() {
+        // /proc/self/statm reports sizes in pages: total, then resident.
+        std::ifstream statm("/proc/self/statm");
+        // Total program size (unused).
+        size_t totalPages = 0;
+        // Resident pages.
+        size_t residentPages = 0;
+        // Read both fields.
+        statm >> totalPages >> residentPages;
+        // Convert pages to bytes.
+        return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    // Builds the key for index i (namespaced like typical cache keys: "user:<id>:profile").
+    std::string makeKey(size_t i) {
+        // Fixed-width numeric id.
+        std::string digits = std::to_string(i);
+        // Zero-pad to 8 digits.
+        return "user:" + std::string(digits.size() < 8 ? 8 - digits.size() : 0, '0') + digits + ":profile";
+    }
+
+    // Returns nanoseconds per operation for ops operations that took the given time.
+    double nsPerOp(std::chrono::steady_clock::time_point start, size_t ops) {
+        // Elapsed nanoseconds.
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        // Average per operation.
+        return static_cast<double>(elapsed.count()) / ops;
+    }
+
+    // Loads numKeys keys into a trie type and reports bytes per key and per-operation latencies.
+    template <typename TrieType>
+    void measure(const char* name, size_t numKeys) {
+        // Keys built up front so their memory is not attributed to the trie.
+        std::vector<std::string> keys;
+        // Reserve space for them.
+        keys.reserve(numKeys);
+        // Build every key.
+        for (size_t i = 0; i < numKeys; ++i) keys.push_back(makeKey(i));
+        // Resident bytes before the load.
+        size_t baseline = residentBytes();
+        // Heap-allocated so the structure lives until the process exits.
+        TrieType* trie = new TrieType();
+        // Start of the insert phase.
+        auto start = std::chrono::steady_clock::now();
+        // Insert every key.
+        for (const std::string& key : keys) trie->insert(key);
+        // Insert latency.
+        double insertNs = nsPerOp(start, numKeys);
+        // Bytes added by the load.
+        size_t used = residentBytes() - baseline;
+        // Start of the lookup phase.
+        start = std::chrono::steady_clock::now();
+        // Keys found (kept so the loop is not optimized away).
+        size_t found = 0;
+        // Look up every key.
+        for (const std::string& key : keys) found += trie->contains(key);
+        // Lookup latency.
+        double containsNs = nsPerOp(start, numKeys);
+        // Number of prefix searches (each returns the 10 keys sharing "user:<7 digits>").
+        size_t searches = numKeys / 10;
+        // Keys returned (kept so the loop is not optimized away).
+        size_t returned = 0;
+        // Start of the prefix-search phase.
+        start = std::chrono::steady_clock::now();
+        // Search every group of ten ids.
+        for (size_t i = 0; i < searches; ++i) returned += trie->searchPrefix(keys[i * 10].substr(0, 12)).size();
+        // Prefix-search latency.
+        double searchNs = nsPerOp(start, searches);
+        // Report the figures.
+        std::cout << name << ": " << static_cast<double>(used) / numKeys << " bytes/key, insert "
+                  << insertNs << " ns, contains " << containsNs << " ns, searchPrefix(10 results) "
+                  << searchNs << " ns (found " << found << ", returned " << returned << ")" << std::endl;
+    }
+
+    // Measures the legacy std::map trie.
+    void measureLegacy(size_t numKeys) {
+        // One node per character.
+        measure<LegacyTrie>("legacy trie (std::map per node)", numKeys);
+    }
+
+    // Measures the adaptive radix tree.
+    void measureArt(size_t numKeys) {
+        // Adaptive nodes, path compression, lazy expansion.
+        measure<Trie>("adaptive radix tree", numKeys);
+    }
+}
+
+// Main function for the Trie benchmark. Usage: bench_trie [numKeys] (default 1000000).
+int main(int argc, char** argv) {
+    // Number of keys to load.
+    size_t numKeys = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    // Each structure is measured in its own child process so freed memory from one cannot hide the other's growth.
+    for (auto run : {measureLegacy, measureArt}) {
+        // Fork the measuring process.
+        pid_t child = fork();
+        // In the child, measure and exit.
+        if (child == 0) {
+            // Run one measurement.
+            run(numKeys);
+            // Leave without running the parent's remaining loop.
+            std::exit(0);
+        }
+        // Wait for the child before starting the next one.
+        waitpid(child, nullptr, 0);
+    }
+    // Return 0 indicating successful execution.
+    return 0;
+}
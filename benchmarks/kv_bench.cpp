@@ -0,0 +1,572 @@
+#include "../include/sharded_kv_store.hpp"
+#include <iostream>
+#include <fstream> // For --output
+#include <sstream> // For parsing --workloads
+#include <string>
+#include <vector>
+#include <thread> // For the client threads
+#include <atomic> // For the start flag and the insert counter
+#include <chrono> // For timing
+#include <random> // For the per-thread generators
+#include <cmath> // For std::pow
+#include <cstdlib> // For std::strtoull
+#include <cstdint> // For uint64_t
+#include <algorithm> // For std::sort, std::max
+#include <optional> // For scan bounds
+
+namespace {
+    // Zipfian skew used by YCSB.
+    constexpr double ZIPFIAN_THETA = 0.99;
+    // Longest scan (YCSB's maxscanlength); lengths are uniform in 1..MAX_SCAN_LENGTH.
+    constexpr size_t MAX_SCAN_LENGTH = 100;
+    // Characters dropped from a key to form the prefix of a prefix search (up to 100 keys share it).
+    constexpr size_t PREFIX_DROP = 2;
+
+    // How a workload picks the key of its next operation.
+    enum class Distribution {
+        // Every loaded or inserted key equally likely.
+        Uniform,
+        // A few keys get most of the traffic (theta 0.99); the popular keys are scattered over the keyspace.
+        Zipfian,
+        // Recently inserted keys are the most popular.
+        Latest
+    };
+
+    // Kinds of operations a workload issues.
+    enum class Operation {
+        // GET of a loaded key.
+        Read,
+        // SET of a loaded key.
+        Update,
+        // SET of a new key.
+        Insert,
+        // Range scan of up to MAX_SCAN_LENGTH keys from a loaded key.
+        Scan,
+        // GET then SET of the same key.
+        ReadModifyWrite,
+        // Prefix search covering up to 100 keys.
+        Prefix,
+        // GET of a key that was never inserted.
+        NegativeRead
+    };
+
+    // Number of Operation values.
+    constexpr size_t OPERATION_KINDS = 7;
+    // Names used in the report, indexed by Operation.
+    constexpr const char* OPERATION_NAMES[OPERATION_KINDS] = {"read", "update", "insert", "scan", "rmw", "prefix", "negative_read"};
+
+    // One workload: percentages of each Operation (summing to 100) and its default key distribution.
+    struct Workload {
+        // Name on the command line and in the report.
+        const char* name;
+        // Percentage of each Operation, indexed by Operation.
+        unsigned mix[OPERATION_KINDS];
+        // Distribution unless --distribution overrides it.
+        Distribution distribution;
+    };
+
+    // YCSB core workloads A-F plus the prefix and negative-lookup mixes.
+    const Workload WORKLOADS[] = {
+        // Update heavy: 50% reads, 50% updates.
+        {"A", {50, 50, 0, 0, 0, 0, 0}, Distribution::Zipfian},
+        // Read mostly: 95% reads, 5% updates.
+        {"B", {95, 5, 0, 0, 0, 0, 0}, Distribution::Zipfian},
+        // Read only.
+        {"C", {100, 0, 0, 0, 0, 0, 0}, Distribution::Zipfian},
+        // Read latest: 95% reads, 5% inserts, reads favour the newest keys.
+        {"D", {95, 0, 5, 0, 0, 0, 0}, Distribution::Latest},
+        // Short ranges: 95% scans, 5% inserts.
+        {"E", {0, 0, 5, 95, 0, 0, 0}, Distribution::Zipfian},
+        // Read-modify-write: 50% reads, 50% read-modify-writes.
+        {"F", {50, 0, 0, 0, 50, 0, 0}, Distribution::Zipfian},
+        // Prefix searches mixed into reads: 90% reads, 10% prefix searches.
+        {"prefix", {90, 0, 0, 0, 0, 10, 0}, Distribution::Zipfian},
+        // Lookups that half the time miss (served by the Bloom filter): 50% reads, 50% negative reads.
+        {"negative", {50, 0, 0, 0, 0, 0, 50}, Distribution::Zipfian}
+    };
+
+    // Command-line settings.
+    struct BenchConfig {
+        // Keys loaded before each workload.
+        size_t records = 100000;
+        // Operations per workload, split across the threads.
+        size_t operations = 200000;
+        // Client threads.
+        size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        // Key length in bytes (raised to fit "user" plus the digits of the largest key index).
+        size_t keySize = 16;
+        // Value length in bytes.
+        size_t valueSize = 100;
+        // ShardedKVStore shards (0: one per hardware thread).
+        size_t shards = 0;
+        // Seed of the per-thread generators.
+        uint64_t seed = 1;
+        // Distribution of every workload, or each workload's own.
+        std::optional<Distribution> distribution;
+        // Workloads to run, in order.
+        std::vector<const Workload*> workloads;
+        // JSON report path (empty: stdout).
+        std::string outputPath;
+    };
+
+    // Zipfian ranks in [0, items) after Gray et al., "Quickly Generating Billion-Record Synthetic Databases" (as in YCSB).
+    class ZipfianGenerator {
+    private:
+        // Number of ranks.
+        double items;
+        // 1 / (1 - theta).
+        double alpha;
+        // Sum of 1 / i^theta over all ranks.
+        double zetaN;
+        // Constant of the inverse.
+        double eta;
+        // Probability boundary of rank 1.
+        double secondBoundary;
+
+    public:
+        // Constructor: O(items) to sum zeta once.
+        explicit ZipfianGenerator(size_t count) : items(static_cast<double>(count)), alpha(1.0 / (1.0 - ZIPFIAN_THETA)), zetaN(0.0) {
+            // zeta(n, theta).
+            for (size_t i = 1; i <= count; ++i) zetaN += 1.0 / std::pow(static_cast<double>(i), ZIPFIAN_THETA);
+            // zeta(2, theta).
+            double zeta2 = 1.0 + 1.0 / std::pow(2.0, ZIPFIAN_THETA);
+            // Closed-form constant.
+            eta = (1.0 - std::pow(2.0 / items, 1.0 - ZIPFIAN_THETA)) / (1.0 - zeta2 / zetaN);
+            // Ranks 0 and 1 are handled apart.
+            secondBoundary = 1.0 + std::pow(0.5, ZIPFIAN_THETA);
+        }
+
+        // Maps a uniform draw in [0, 1) to a rank (0 the most popular).
+        size_t next(double uniform) const {
+            // Scaled draw.
+            double scaled = uniform * zetaN;
+            // Most popular.
+            if (scaled < 1.0) return 0;
+            // Second most popular.
+            if (scaled < secondBoundary) return 1;
+            // Every other rank.
+            size_t rank = static_cast<size_t>(items * std::pow(eta * uniform - eta + 1.0, alpha));
+            // Guard the top end against rounding.
+            return std::min(rank, static_cast<size_t>(items) - 1);
+        }
+    };
+
+    // Scatters zipfian ranks over the keyspace so the popular keys are not neighbours (YCSB's scrambled zipfian).
+    uint64_t scramble(uint64_t value) {
+        // splitmix64 finalizer.
+        value += 0x9e3779b97f4a7c15ULL;
+        // Mix.
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        // Mix.
+        value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+        // Done.
+        return value ^ (value >> 31);
+    }
+
+    // Formats key index as prefix followed by zero-padded digits, keySize bytes in all.
+    std::string makeKey(const char* prefix, uint64_t index, size_t keySize) {
+        // Digits of the index.
+        std::string digits = std::to_string(index);
+        // Prefix.
+        std::string key = prefix;
+        // Pad to the full length.
+        key.append(keySize - key.size() - digits.size(), '0');
+        // Then the digits.
+        key += digits;
+        // Done.
+        return key;
+    }
+
+    // Latencies of one operation kind in one workload.
+    struct LatencySummary {
+        // Operations measured.
+        size_t count = 0;
+        // Median in nanoseconds.
+        uint64_t p50 = 0;
+        // 99th percentile in nanoseconds.
+        uint64_t p99 = 0;
+        // 99.9th percentile in nanoseconds.
+        uint64_t p999 = 0;
+        // Slowest in nanoseconds.
+        uint64_t max = 0;
+    };
+
+    // Outcome of one workload.
+    struct WorkloadResult {
+        // Which workload.
+        const Workload* workload = nullptr;
+        // Distribution it ran with.
+        Distribution distribution = Distribution::Zipfian;
+        // Operations issued.
+        size_t operations = 0;
+        // Wall time of the run phase.
+        double seconds = 0.0;
+        // Per Operation, indexed by Operation.
+        LatencySummary byOperation[OPERATION_KINDS];
+        // Every operation together.
+        LatencySummary overall;
+    };
+
+    // Exact percentiles of a set of latencies (sorted in place).
+    LatencySummary summarize(std::vector<uint64_t>& latencies) {
+        // Result.
+        LatencySummary summary;
+        // Nothing measured.
+        if (latencies.empty()) return summary;
+        // Order them.
+        std::sort(latencies.begin(), latencies.end());
+        // Count.
+        summary.count = latencies.size();
+        // Nearest-rank percentile.
+        auto at = [&latencies](double fraction) {
+            // Rank ceil(fraction * n), 1-based.
+            size_t rank = static_cast<size_t>(std::ceil(fraction * static_cast<double>(latencies.size())));
+            // Its value.
+            return latencies[std::max<size_t>(rank, 1) - 1];
+        };
+        // Median.
+        summary.p50 = at(0.50);
+        // Tail.
+        summary.p99 = at(0.99);
+        // Far tail.
+        summary.p999 = at(0.999);
+        // Worst.
+        summary.max = latencies.back();
+        // Done.
+        return summary;
+    }
+
+    // Name of a distribution.
+    const char* distributionName(Distribution distribution) {
+        // One per value.
+        return distribution == Distribution::Uniform ? "uniform" : distribution == Distribution::Latest ? "latest" : "zipfian";
+    }
+
+    // Loads config.records keys into store, split across the threads.
+    void loadRecords(ShardedKVStore& store, const BenchConfig& config) {
+        // The loaders.
+        std::vector<std::thread> loaders;
+        // One per client thread.
+        for (size_t t = 0; t < config.threads; ++t) {
+            // Each takes every threads-th key.
+            loaders.emplace_back([&store, &config, t]() {
+                // Same bytes for every record.
+                std::string value(config.valueSize, 'v');
+                // Its keys.
+                for (size_t i = t; i < config.records; i += config.threads) store.set(makeKey("user", i, config.keySize), value);
+            });
+        }
+        // Wait for them.
+        for (std::thread& loader : loaders) loader.join();
+    }
+
+    // Runs one workload against a freshly loaded store and measures every operation.
+    WorkloadResult runWorkload(const Workload& workload, const BenchConfig& config, const ZipfianGenerator& zipfian) {
+        // Result.
+        WorkloadResult result;
+        // Which workload.
+        result.workload = &workload;
+        // Its distribution.
+        result.distribution = config.distribution ? *config.distribution : workload.distribution;
+        // Fresh store.
+        ShardedKVStore store(config.shards);
+        // Load it.
+        loadRecords(store, config);
+        // Next key index to insert; readers choose among the indices below it.
+        std::atomic<uint64_t> inserted{config.records};
+        // Threads waiting to start.
+        std::atomic<size_t> ready{0};
+        // Starts every thread at once.
+        std::atomic<bool> go{false};
+        // Latencies per thread and Operation.
+        std::vector<std::vector<std::vector<uint64_t>>> latencies(config.threads, std::vector<std::vector<uint64_t>>(OPERATION_KINDS));
+        // The clients.
+        std::vector<std::thread> clients;
+        // Start them.
+        for (size_t t = 0; t < config.threads; ++t) {
+            // The first threads take the remainder.
+            size_t count = config.operations / config.threads + (t < config.operations % config.threads ? 1 : 0);
+            // One client.
+            clients.emplace_back([&, t, count]() {
+                // Own generator.
+                std::mt19937_64 random(config.seed * 0x100000001b3ULL + t);
+                // Uniform draw in [0, 1).
+                auto uniform = [&random]() { return static_cast<double>(random() >> 11) * 0x1.0p-53; };
+                // Written by updates and inserts.
+                std::string value(config.valueSize, static_cast<char>('a' + t % 26));
+                // Own latency buffers.
+                std::vector<std::vector<uint64_t>>& own = latencies[t];
+                // Room for its share.
+                for (size_t op = 0; op < OPERATION_KINDS; ++op) own[op].reserve(count * workload.mix[op] / 100 + 16);
+                // Picks the index of an existing key.
+                auto chooseIndex = [&]() -> uint64_t {
+                    // Keys that exist (or are being inserted).
+                    uint64_t existing = inserted.load(std::memory_order_relaxed);
+                    // Any of them.
+                    if (result.distribution == Distribution::Uniform) return random() % existing;
+                    // Popular ranks over the loaded records, counted back from the newest key.
+                    if (result.distribution == Distribution::Latest) return existing - 1 - zipfian.next(uniform());
+                    // Popular ranks scattered over the loaded records.
+                    return scramble(zipfian.next(uniform())) % config.records;
+                };
+                // Checked in.
+                ready.fetch_add(1);
+                // Wait for the others.
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                // Its operations.
+                for (size_t i = 0; i < count; ++i) {
+                    // Pick the operation by the mix.
+                    unsigned roll = static_cast<unsigned>(random() % 100);
+                    // Walk the percentages.
+                    size_t op = 0;
+                    // Until the roll falls in one.
+                    while (roll >= workload.mix[op]) roll -= workload.mix[op++];
+                    // Key chosen before timing.
+                    std::string key = op == static_cast<size_t>(Operation::Insert)
+                        ? makeKey("user", inserted.fetch_add(1, std::memory_order_relaxed), config.keySize)
+                        : op == static_cast<size_t>(Operation::NegativeRead)
+                        ? makeKey("miss", random() % config.records, config.keySize)
+                        : makeKey("user", chooseIndex(), config.keySize);
+                    // Scan length drawn before timing.
+                    size_t scanLength = 1 + random() % MAX_SCAN_LENGTH;
+                    // Start of the operation.
+                    auto start = std::chrono::steady_clock::now();
+                    // Issue it.
+                    switch (static_cast<Operation>(op)) {
+                        // Lookups.
+                        case Operation::Read:
+                        case Operation::NegativeRead:
+                            store.get(key);
+                            break;
+                        // Writes.
+                        case Operation::Update:
+                        case Operation::Insert:
+                            store.set(key, value);
+                            break;
+                        // Ordered range from the key.
+                        case Operation::Scan:
+                            store.scanRange(key, std::nullopt, scanLength);
+                            break;
+                        // Read, then write back.
+                        case Operation::ReadModifyWrite:
+                            store.get(key);
+                            store.set(key, value);
+                            break;
+                        // Keys sharing all but the last digits.
+                        case Operation::Prefix:
+                            store.prefixSearch(key.substr(0, key.size() - PREFIX_DROP));
+                            break;
+                    }
+                    // Record it.
+                    own[op].push_back(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+                }
+            });
+        }
+        // Wait until every client is ready.
+        while (ready.load() != config.threads) std::this_thread::yield();
+        // Start of the run.
+        auto start = std::chrono::steady_clock::now();
+        // Release them.
+        go.store(true, std::memory_order_release);
+        // Wait for them.
+        for (std::thread& client : clients) client.join();
+        // Elapsed.
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // Every latency together.
+        std::vector<uint64_t> all;
+        // Merge each operation kind across the threads.
+        for (size_t op = 0; op < OPERATION_KINDS; ++op) {
+            // Merged.
+            std::vector<uint64_t> merged;
+            // Each thread's.
+            for (size_t t = 0; t < config.threads; ++t) merged.insert(merged.end(), latencies[t][op].begin(), latencies[t][op].end());
+            // Into the overall set.
+            all.insert(all.end(), merged.begin(), merged.end());
+            // Summarize.
+            result.byOperation[op] = summarize(merged);
+        }
+        // Operations issued.
+        result.operations = all.size();
+        // Summarize.
+        result.overall = summarize(all);
+        // Done.
+        return result;
+    }
+
+    // Writes one latency summary as a JSON object.
+    void writeSummary(std::ostream& out, const LatencySummary& summary) {
+        // Fields.
+        out << "{\"count\": " << summary.count << ", \"p50_ns\": " << summary.p50 << ", \"p99_ns\": " << summary.p99
+            << ", \"p999_ns\": " << summary.p999 << ", \"max_ns\": " << summary.max << "}";
+    }
+
+    // Writes the configuration and every workload's results as JSON.
+    void writeReport(std::ostream& out, const BenchConfig& config, const std::vector<WorkloadResult>& results) {
+        // Build and run settings, so two reports can be compared like for like.
+        out << "{\n  \"config\": {\"records\": " << config.records << ", \"operations\": " << config.operations
+            << ", \"threads\": " << config.threads << ", \"key_size\": " << config.keySize << ", \"value_size\": " << config.valueSize
+            << ", \"shards\": " << config.shards << ", \"seed\": " << config.seed
+            << ", \"hardware_threads\": " << std::thread::hardware_concurrency()
+#ifdef NDEBUG
+            << ", \"assertions\": false"
+#else
+            << ", \"assertions\": true"
+#endif
+            << "},\n  \"workloads\": [";
+        // Each workload.
+        for (size_t w = 0; w < results.size(); ++w) {
+            // This one.
+            const WorkloadResult& result = results[w];
+            // Header.
+            out << (w == 0 ? "\n" : ",\n") << "    {\"name\": \"" << result.workload->name << "\", \"distribution\": \""
+                << distributionName(result.distribution) << "\", \"operations\": " << result.operations
+                << ", \"seconds\": " << result.seconds << ", \"ops_per_sec\": "
+                << static_cast<uint64_t>(static_cast<double>(result.operations) / result.seconds) << ",\n      \"latency\": ";
+            // Overall.
+            writeSummary(out, result.overall);
+            // Per operation kind.
+            out << ",\n      \"by_operation\": {";
+            // Separator state.
+            bool first = true;
+            // Each kind the workload issued.
+            for (size_t op = 0; op < OPERATION_KINDS; ++op) {
+                // Not part of the mix.
+                if (result.workload->mix[op] == 0) continue;
+                // Entry.
+                out << (first ? "" : ", ") << "\"" << OPERATION_NAMES[op] << "\": ";
+                // Summary.
+                writeSummary(out, result.byOperation[op]);
+                // Next.
+                first = false;
+            }
+            // Close it.
+            out << "}}";
+        }
+        // Close the report.
+        out << "\n  ]\n}" << std::endl;
+    }
+
+    // Prints the command line and fails.
+    int usage() {
+        // Options.
+        std::cerr << "Usage: kv_bench [--workloads A,B,C,D,E,F,prefix,negative] [--distribution uniform|zipfian|latest] [--records <n>]"
+                     " [--operations <n>] [--threads <n>] [--key-size <n>] [--value-size <n>] [--shards <n>] [--seed <n>] [--output <file>]" << std::endl;
+        // Failure status.
+        return 1;
+    }
+}
+
+// Main function for the YCSB-style benchmark. Loads a ShardedKVStore with --records keys, then runs each chosen
+// workload (YCSB A-F, "prefix" and "negative", all by default) on a freshly loaded store with --threads clients and
+// writes throughput and p50/p99/p999/max latency per workload and operation kind as JSON (stdout unless --output).
+// Progress goes to stderr. Latencies are exact (every operation is recorded) and include the clock reads.
+int main(int argc, char** argv) {
+    // Settings.
+    BenchConfig config;
+    // Parse the options.
+    for (int i = 1; i < argc; ++i) {
+        // Current option.
+        std::string option = argv[i];
+        // Which workloads, comma separated.
+        if (option == "--workloads" && i + 1 < argc) {
+            // The list.
+            std::istringstream names(argv[++i]);
+            // One name.
+            std::string name;
+            // Each name.
+            while (std::getline(names, name, ',')) {
+                // Its workload.
+                const Workload* found = nullptr;
+                // Look it up.
+                for (const Workload& workload : WORKLOADS) if (name == workload.name) found = &workload;
+                // Unknown.
+                if (!found) return usage();
+                // Keep it.
+                config.workloads.push_back(found);
+            }
+        // Key distribution for every workload.
+        } else if (option == "--distribution" && i + 1 < argc) {
+            // The name.
+            std::string name = argv[++i];
+            // Map it.
+            if (name == "uniform") config.distribution = Distribution::Uniform;
+            else if (name == "zipfian") config.distribution = Distribution::Zipfian;
+            else if (name == "latest") config.distribution = Distribution::Latest;
+            else return usage();
+        // Keys loaded.
+        } else if (option == "--records" && i + 1 < argc) {
+            // Parse it.
+            config.records = std::strtoull(argv[++i], nullptr, 10);
+        // Operations per workload.
+        } else if (option == "--operations" && i + 1 < argc) {
+            // Parse it.
+            config.operations = std::strtoull(argv[++i], nullptr, 10);
+        // Client threads.
+        } else if (option == "--threads" && i + 1 < argc) {
+            // Parse it.
+            config.threads = std::strtoull(argv[++i], nullptr, 10);
+        // Key length.
+        } else if (option == "--key-size" && i + 1 < argc) {
+            // Parse it.
+            config.keySize = std::strtoull(argv[++i], nullptr, 10);
+        // Value length.
+        } else if (option == "--value-size" && i + 1 < argc) {
+            // Parse it.
+            config.valueSize = std::strtoull(argv[++i], nullptr, 10);
+        // Shards.
+        } else if (option == "--shards" && i + 1 < argc) {
+            // Parse it.
+            config.shards = std::strtoull(argv[++i], nullptr, 10);
+        // Generator seed.
+        } else if (option == "--seed" && i + 1 < argc) {
+            // Parse it.
+            config.seed = std::strtoull(argv[++i], nullptr, 10);
+        // Report file.
+        } else if (option == "--output" && i + 1 < argc) {
+            // Keep it.
+            config.outputPath = argv[++i];
+        } else {
+            // Unknown option.
+            return usage();
+        }
+    }
+    // Nothing to load or run.
+    if (config.records == 0 || config.threads == 0) return usage();
+    // Every workload by default.
+    if (config.workloads.empty()) for (const Workload& workload : WORKLOADS) config.workloads.push_back(&workload);
+    // Room for the prefix and the digits of the largest index an insert can reach.
+    config.keySize = std::max(config.keySize, 4 + std::to_string(config.records + config.operations).size());
+    // Shared by every workload (summing zeta is O(records)).
+    ZipfianGenerator zipfian(config.records);
+    // Results in order.
+    std::vector<WorkloadResult> results;
+    // Run each.
+    for (const Workload* workload : config.workloads) {
+        // Announce it.
+        std::cerr << "Workload " << workload->name << ": loading " << config.records << " records, running " << config.operations
+                  << " operations on " << config.threads << " thread(s)..." << std::flush;
+        // Run it.
+        results.push_back(runWorkload(*workload, config, zipfian));
+        // Throughput.
+        std::cerr << " " << static_cast<uint64_t>(static_cast<double>(results.back().operations) / results.back().seconds) << " ops/s" << std::endl;
+    }
+    // To stdout.
+    if (config.outputPath.empty()) {
+        // Report.
+        writeReport(std::cout, config, results);
+    } else {
+        // To the file.
+        std::ofstream file(config.outputPath);
+        // Unwritable.
+        if (!file) {
+            // Say so.
+            std::cerr << "Could not open " << config.outputPath << std::endl;
+            // Fail.
+            return 1;
+        }
+        // Report.
+        writeReport(file, config, results);
+    }
+    // Return 0 indicating successful execution.
+    return 0;
+}
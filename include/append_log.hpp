@@ -0,0 +1,235 @@
+#ifndef APPEND_LOG_HPP
+#define APPEND_LOG_HPP
+
+#include <string>
+#include <string_view>
+#include <functional> // For replay callbacks
+#include <mutex> // For the append buffer lock
+#include <condition_variable> // For group commit followers
+#include <thread> // For the background flusher
+#include <cstdint> // For sequence numbers and deadlines
+#include <cstddef> // For size_t
+#include <memory> // For the optional ring and ring writer
+#include "io_ring.hpp" // For the io_uring write paths (KV_STORE_IO_URING builds)
+
+// When the append log forces its writes to disk.
+enum class AppendFsync {
+    // Every write waits for an fdatasync covering it (concurrent writers share one; see AppendLog::sync).
+    Always,
+    // A background thread writes and fdatasyncs once a second; a crash loses at most about a second of writes.
+    EverySec,
+    // A background thread writes once a second and the OS decides when to flush.
+    No
+};
+
+// Kind of a logged write.
+enum class LogOp : uint8_t {
+    // Key set to value (clearing any deadline).
+    Set = 1,
+    // Key removed.
+    Remove = 2,
+    // Key given an absolute deadline (ms since the Unix epoch), so replay does not depend on when it runs.
+    ExpireAt = 3,
+    // Key's deadline removed.
+    Persist = 4
+};
+
+// One logged write. Views borrow the caller's bytes (or, during replay, the log's).
+struct LogRecord {
+    // What happened.
+    LogOp op = LogOp::Set;
+    // Key written.
+    std::string_view key;
+    // New value (Set only).
+    std::string_view value;
+    // Deadline (ExpireAt only).
+    uint64_t deadline = 0;
+};
+
+// Outcome of replaying a log file.
+struct LogReplayResult {
+    // Records applied.
+    size_t records = 0;
+    // Bytes of valid records (the file is truncated here when opened for appending, unless it is damaged).
+    size_t validBytes = 0;
+    // Bytes of a torn last record (a write cut short by a crash: its length runs past the end of the file, or it
+    // ends exactly there but fails its checksum), dropped on open.
+    size_t truncatedBytes = 0;
+    // Bytes from a damaged record that is followed by more data to the end of the file. Those records cannot be
+    // trusted or skipped, so none are applied, and the file must not be cut: KVStore moves it aside instead.
+    size_t damagedBytes = 0;
+};
+
+// Append log figures reported by AppendLog::stats (and KVStore::appendLogStats).
+struct AppendLogStats {
+    // Fsync policy in use.
+    AppendFsync policy = AppendFsync::EverySec;
+    // Bytes in the log, including records not yet written out.
+    size_t sizeBytes = 0;
+    // Records appended since the log was opened.
+    uint64_t appendedRecords = 0;
+    // write calls issued (each carries every record buffered since the previous one).
+    uint64_t writes = 0;
+    // fdatasync calls issued.
+    uint64_t syncs = 0;
+    // write or fdatasync calls that failed.
+    uint64_t writeErrors = 0;
+    // Completed rewrites.
+    uint64_t rewrites = 0;
+    // True while a rewrite is collecting new records.
+    bool rewriteInProgress = false;
+    // Records applied from the log when the store started.
+    size_t replayedRecords = 0;
+    // Torn bytes dropped from the end of the log when the store started.
+    size_t truncatedBytes = 0;
+    // Bytes from a damaged record on when the store started (the log was moved aside; see KVStore).
+    size_t damagedBytes = 0;
+};
+
+// Write-ahead log of store writes in a single append-only file:
+//   [uint32 payload length][uint32 checksum of payload][payload]
+// where the payload is [uint8 op][varint key length][key] followed, for Set, by [varint value length][value]
+// and, for ExpireAt, by a uint64 deadline (integers in host byte order).
+// Writers append records to an in-memory buffer and get a sequence number. Under AppendFsync::Always each writer
+// then calls sync: the first to arrive becomes the leader and issues one write + fdatasync for everything buffered,
+// while writers arriving meanwhile wait and are covered by the next leader (group commit). Under the other policies a
+// background thread writes the buffer once a second.
+// A rewrite replaces the log with a compacted one produced elsewhere (see LogFileWriter): between beginRewrite and
+// finishRewrite every appended record is also kept aside and appended to the new file before it takes over.
+// All public members are thread-safe.
+class AppendLog {
+public:
+    // Interval of the background flusher.
+    static constexpr unsigned FLUSH_INTERVAL_MS = 1000;
+
+private:
+    // Log file.
+    std::string path;
+    // Fsync policy.
+    AppendFsync policy;
+    // Descriptor the log is appended through (-1 if it could not be opened).
+    int fd;
+    // Guards every field below.
+    mutable std::mutex mutex;
+    // Signalled when a flush completes or the log is closing.
+    std::condition_variable flushed;
+    // Records appended but not yet written.
+    std::string pending;
+    // Records appended since beginRewrite (empty unless rewriting).
+    std::string rewriteBuffer;
+    // True between beginRewrite and finishRewrite / abortRewrite.
+    bool rewriting;
+    // True while a leader is writing outside the lock.
+    bool flushing;
+    // True once the destructor asked the flusher to stop.
+    bool closing;
+    // True between pauseForFork and resumeAfterFork (the flusher is stopped).
+    bool pausedForFork;
+    // Sequence number of the last record appended.
+    uint64_t appendedSequence;
+    // Sequence number of the last record written to the file.
+    uint64_t writtenSequence;
+    // Sequence number of the last record covered by an fdatasync.
+    uint64_t durableSequence;
+    // Bytes written to the file.
+    size_t fileBytes;
+    // Counters reported by stats.
+    AppendLogStats counters;
+    // Background flusher (not started under AppendFsync::Always).
+    std::thread flusher;
+#ifdef KV_STORE_IO_URING
+    // Ring the leader submits each batch's write and fdatasync through, linked, in one system call
+    // (null if the kernel refused it).
+    std::unique_ptr<IoRing> ring;
+#endif
+
+    // Writes (and, if durable, fdatasyncs) everything appended up to target, as leader or by waiting for one.
+    void flushUpTo(std::unique_lock<std::mutex>& lock, uint64_t target, bool durable);
+    // Body of the background flusher.
+    void flushLoop();
+    // Writes a batch to fileFd and, if durable, fdatasyncs it. Sets wrote; returns true if both succeeded.
+    bool writeBatch(int fileFd, const std::string& batch, bool durable, bool& wrote);
+
+public:
+    // Appends record to out in the log's framed encoding.
+    static void encode(std::string& out, const LogRecord& record);
+    // Applies every valid record of the log at path, in order, and reports where the valid prefix ends.
+    // A missing file replays nothing.
+    static LogReplayResult replay(const std::string& path, const std::function<void(const LogRecord&)>& apply);
+
+    // Constructor: opens (creating) the log at path for appending, first cutting it to validBytes (from replay)
+    // so a torn record is not followed by new ones; starts the background flusher unless the policy is Always.
+    AppendLog(const std::string& path, AppendFsync policy, size_t validBytes);
+    // Destructor: writes and fdatasyncs whatever is buffered, stops the flusher and closes the file.
+    ~AppendLog();
+    // Holds a descriptor and a thread, so it cannot be copied.
+    AppendLog(const AppendLog&) = delete;
+    // Holds a descriptor and a thread, so it cannot be copied.
+    AppendLog& operator=(const AppendLog&) = delete;
+
+    // Returns false if the file could not be opened (appends are then dropped and counted as errors).
+    bool isOpen() const;
+    // Returns the fsync policy.
+    AppendFsync fsyncPolicy() const;
+    // Buffers a record and returns its sequence number.
+    uint64_t append(const LogRecord& record);
+    // Under AppendFsync::Always, returns once every record up to sequence is on disk, sharing the write and
+    // fdatasync with concurrent callers. A no-op under the other policies.
+    void sync(uint64_t sequence);
+    // Writes (without syncing) everything buffered.
+    void flush();
+    // Returns the size of the log in bytes, including buffered records.
+    size_t sizeBytes() const;
+    // Starts keeping a copy of every record appended from now on for a rewrite. Returns false if one is running.
+    bool beginRewrite();
+    // Appends the records kept since beginRewrite to the compacted log at tempPath, syncs it, renames it over the
+    // log and continues appending there. Returns false (and keeps the current log) if any step failed.
+    bool finishRewrite(const std::string& tempPath);
+    // Stops a rewrite without replacing the log.
+    void abortRewrite();
+    // Before a fork: stops and joins the flusher, waits for a group-commit leader's write to finish, and returns
+    // holding the log's lock, so no thread is inside the log when the process is copied. Appends block until
+    // resumeAfterFork.
+    void pauseForFork();
+    // After a fork, in the parent: releases the lock and restarts the flusher. The child never calls it.
+    void resumeAfterFork();
+    // Returns the log's counters.
+    AppendLogStats stats() const;
+    // Records what replay found, for stats.
+    void setReplayResult(const LogReplayResult& result);
+};
+
+// Writes a complete log file from scratch (the compacted log of a rewrite), buffered and synced on commit.
+class LogFileWriter {
+private:
+    // Descriptor of the file (-1 if it could not be created).
+    int fd;
+    // Records not yet written.
+    std::string buffer;
+    // True once a write failed.
+    bool failed;
+#ifdef KV_STORE_IO_URING
+    // Writes the buffer from registered buffers with several writes in flight (null if the kernel refused it).
+    std::unique_ptr<RingFileWriter> ringWriter;
+#endif
+
+    // Writes the buffer out.
+    void flushBuffer();
+
+public:
+    // Constructor: creates (truncating) the file at path.
+    explicit LogFileWriter(const std::string& path);
+    // Destructor: closes the file.
+    ~LogFileWriter();
+    // Holds a descriptor, so it cannot be copied.
+    LogFileWriter(const LogFileWriter&) = delete;
+    // Holds a descriptor, so it cannot be copied.
+    LogFileWriter& operator=(const LogFileWriter&) = delete;
+
+    // Adds a record.
+    void add(const LogRecord& record);
+    // Writes everything and fsyncs the file. Returns false on any I/O error.
+    bool commit();
+};
+
+#endif // APPEND_LOG_HPP
@@ -2,30 +2,69 @@
 #define BLOOM_FILTER_HPP
 
 #include <string>
+#include <string_view> // For hashing keys without copying them
 #include <vector>
-#include <functional> // For std::function
+#include <cstdint> // For uint64_t
 
-// Implements a Bloom Filter for probabilistic checking of key existence.
+// Implements a cache-line-blocked Bloom Filter for probabilistic checking of key existence.
+// The bit array is split into 512-bit blocks aligned to 64-byte cache lines. A key's hash picks
+// one block, and all k bits of the key fall inside it, so add and possiblyContains touch a single
+// cache line. The k positions come from (enhanced) double hashing of the key's 64-bit hash, so k is
+// not limited by a fixed set of hash functions. Lookups test the key's whole 512-bit mask at once with SSE2.
 class BloomFilter {
+public:
+    // Number of bits in one block (one 64-byte cache line).
+    static constexpr size_t BLOCK_BITS = 512;
+
 private:
-    // The bit array representing the Bloom Filter.
-    std::vector<bool> bitArray;
-    // The size of the bit array.
-    size_t arraySize;
-    // The number of hash functions to use.
+    // Number of 64-bit words in one block.
+    static constexpr size_t BLOCK_WORDS = BLOCK_BITS / 64;
+
+    // One cache line of filter bits.
+    struct alignas(64) Block {
+        // The block's bits, least significant bit of words[0] first.
+        uint64_t words[BLOCK_WORDS];
+    };
+
+    // The blocks making up the bit array.
+    std::vector<Block> blocks;
+    // The number of bit positions set per key.
     size_t numHashFunctions;
-    // Vector of hash functions. Each takes a string and returns an unsigned int.
-    std::vector<std::function<unsigned int(const std::string&)>> hashFunctions;
 
+    // Returns the block responsible for a key hash.
+    size_t blockIndex(uint64_t hashCode) const;
+    // Builds the 512-bit mask of a key's k bit positions within its block.
+    void keyMask(uint64_t hashCode, uint64_t (&mask)[BLOCK_WORDS]) const;
 
 public:
-    // Constructor: initializes the Bloom Filter with a given size and number of hash functions.
+    // Constructor: initializes the Bloom Filter with at least size bits (rounded up to whole blocks)
+    // and numHashes bit positions per key.
     BloomFilter(size_t size, size_t numHashes);
 
+    // Returns a filter sized so that expectedKeys keys give a false-positive rate of about targetFpr.
+    static BloomFilter forExpectedKeys(size_t expectedKeys, double targetFpr);
+    // Returns the number of bits a blocked filter needs for expectedKeys keys at targetFpr.
+    static size_t optimalNumBits(size_t expectedKeys, double targetFpr);
+    // Returns the number of bits per key that minimizes the false-positive rate for a filter of numBits bits.
+    static size_t optimalNumHashes(size_t numBits, size_t expectedKeys);
+    // Returns the expected false-positive rate of a blocked filter of numBits bits holding numKeys keys
+    // with numHashes bits per key (accounts for the uneven load of individual blocks).
+    static double estimateFalsePositiveRate(size_t numBits, size_t numHashes, size_t numKeys);
+
     // Adds a key to the Bloom Filter.
-    void add(const std::string& key);
+    void add(std::string_view key);
+    // Adds a key given its precomputed Utils::hash64.
+    void add(uint64_t hashCode);
     // Checks if a key might exist in the set.
-    bool possiblyContains(const std::string& key) const;
+    bool possiblyContains(std::string_view key) const;
+    // Checks if a key might exist given its precomputed Utils::hash64.
+    bool possiblyContains(uint64_t hashCode) const;
+    // Starts loading the block of a key hash into cache ahead of add or possiblyContains (a hint only).
+    void prefetch(uint64_t hashCode) const;
+    // Returns the size of the bit array in bits.
+    size_t numBits() const;
+    // Returns the number of bit positions set per key.
+    size_t numHashes() const;
 };
 
-#endif // BLOOM_FILTER_HPP
\ No newline at end of file
+#endif // BLOOM_FILTER_HPP
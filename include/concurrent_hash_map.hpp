@@ -0,0 +1,115 @@
+#ifndef CONCURRENT_HASH_MAP_HPP
+#define CONCURRENT_HASH_MAP_HPP
+
+#include <string>
+#include <string_view> // For heterogeneous lookup
+#include <atomic> // For the published table and slots
+#include <mutex> // For serializing writers
+#include <cstdint> // For hashes
+#include <cstddef> // For size_t
+#include "epoch_manager.hpp"
+
+// Defines a concurrent variant of HashMap for read-mostly workloads: get and contains take no lock and store to no
+// shared cache line (only to the reader's own epoch slot), so readers on different cores never contend.
+// Each slot is an atomic pointer to an immutable heap record holding the hash, key and value. Writers (serialized by
+// a mutex readers never touch) build a new record and publish it with one atomic pointer store; a remove publishes a
+// tombstone. Growing builds a whole new table and publishes it with one pointer store. Replaced records and old
+// tables are retired to an EpochManager and freed once no reader can still see them.
+class ConcurrentHashMap {
+public:
+    // Default load factor (live + tombstone slots / capacity) that starts a rebuild.
+    static constexpr double DEFAULT_MAX_LOAD_FACTOR = 0.75;
+
+private:
+    // Assumed cache line size; the fields readers load stay apart from those writers store.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    // Smallest table.
+    static constexpr size_t MIN_CAPACITY = 16;
+
+    // One open-addressing table with linear probing. Immutable once published except for its slot contents.
+    struct Table {
+        // Number of slots minus one (capacity is a power of two).
+        size_t mask;
+        // nullptr (never used, stops probing), the tombstone marker (probing continues) or a record.
+        std::atomic<const char*>* slots;
+
+        // Constructor: capacity empty slots.
+        explicit Table(size_t capacity);
+        // Destructor: frees the slot array (not the records).
+        ~Table();
+        // Owns its slot array, so it cannot be copied.
+        Table(const Table&) = delete;
+        // Owns its slot array, so it cannot be copied.
+        Table& operator=(const Table&) = delete;
+    };
+
+    // Table readers probe, alone on its cache line so the writer's counters do not evict it from readers' caches.
+    alignas(CACHE_LINE_SIZE) std::atomic<Table*> table;
+    // Number of live entries.
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> count;
+    // Live plus tombstone slots of the current table (writers only).
+    size_t usedSlots;
+    // Slots in use that start a rebuild (writers only).
+    size_t rebuildThreshold;
+    // Load factor that starts a rebuild.
+    double maxLoadFactor;
+    // Serializes writers.
+    std::mutex writeLock;
+    // Frees replaced records and old tables once readers are done with them.
+    mutable EpochManager epochs;
+
+    // Hash function used by the overloads without a precomputed hash.
+    static uint64_t hash(std::string_view key);
+    // Allocates a record holding the hash, key and value.
+    static const char* makeRecord(std::string_view key, std::string_view value, uint64_t hashCode);
+    // Returns true if a record holds key.
+    static bool matches(const char* record, std::string_view key, uint64_t hashCode);
+    // Frees a record (an EpochManager destroy callback).
+    static void destroyRecord(void* record);
+    // Frees a table (an EpochManager destroy callback).
+    static void destroyTable(void* table);
+    // Finds the record holding key in a table under an epoch guard, or returns nullptr.
+    static const char* findRecord(const Table& current, std::string_view key, uint64_t hashCode);
+    // Copies the live records into a table sized for the current entries and publishes it (writers only).
+    void rebuild();
+
+public:
+    // Constructor: sized for capacity entries before the first rebuild.
+    explicit ConcurrentHashMap(size_t capacity = 101, double maxLoad = DEFAULT_MAX_LOAD_FACTOR);
+    // Destructor: frees every record and table (no reader or writer may be active).
+    ~ConcurrentHashMap();
+    // Readers hold pointers into it, so it cannot be copied.
+    ConcurrentHashMap(const ConcurrentHashMap&) = delete;
+    // Readers hold pointers into it, so it cannot be copied.
+    ConcurrentHashMap& operator=(const ConcurrentHashMap&) = delete;
+
+    // Inserts or updates a key-value pair. Returns true if the key was new, false if it was updated.
+    bool set(std::string_view key, std::string_view value);
+    // Same as set, with a precomputed Utils::hash64 of the key.
+    bool set(std::string_view key, std::string_view value, uint64_t hashCode);
+    // Deletes a key-value pair. Returns true if key was found and deleted, false otherwise.
+    bool remove(std::string_view key);
+    // Same as remove, with a precomputed Utils::hash64 of the key.
+    bool remove(std::string_view key, uint64_t hashCode);
+    // Copies the value of key into value (reusing its buffer) and returns true, or returns false if it is absent.
+    // Lock-free; safe alongside writers and other readers.
+    bool get(std::string_view key, std::string& value) const;
+    // Same as get, with a precomputed Utils::hash64 of the key.
+    bool get(std::string_view key, uint64_t hashCode, std::string& value) const;
+    // Checks if a key exists. Lock-free; safe alongside writers and other readers.
+    bool contains(std::string_view key) const;
+    // Same as contains, with a precomputed Utils::hash64 of the key.
+    bool contains(std::string_view key, uint64_t hashCode) const;
+    // Returns the current number of elements.
+    size_t size() const;
+    // Returns the number of slots of the current table.
+    size_t capacity() const;
+    // Frees whatever retired records and tables no reader can still see; returns how many.
+    size_t reclaim();
+    // Returns the number of retired records and tables not yet freed.
+    size_t pendingReclamation();
+    // Returns the number of retired records and tables freed so far.
+    uint64_t reclaimedCount();
+};
+
+#endif // CONCURRENT_HASH_MAP_HPP
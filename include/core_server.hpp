@@ -0,0 +1,100 @@
+#ifndef CORE_SERVER_HPP
+#define CORE_SERVER_HPP
+
+#include "kv_store.hpp"
+#include "resp_server.hpp"
+#include <vector>
+#include <memory> // For std::unique_ptr
+#include <atomic> // For the queue indices
+#include <cstdint> // For core numbers
+#include <cstddef> // For size_t
+
+// Bounded lock-free queue of message batches from one core to another: exactly one thread pushes and one pops.
+// Each side caches the other's index, so the shared cache lines are only read when the cached view runs out.
+class PeerQueue {
+public:
+    // Default batches in flight per pair of cores (a power of two).
+    static constexpr size_t DEFAULT_CAPACITY = 1024;
+
+private:
+    // Assumed cache line size; keeps the producer's and consumer's indices off each other's lines.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // Ring of batches.
+    std::vector<std::vector<CoreMessage>> slots;
+    // Capacity - 1.
+    size_t mask;
+    // Next slot to pop (written by the consumer).
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head;
+    // Consumer's last view of tail.
+    size_t cachedTail;
+    // Next slot to fill (written by the producer).
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail;
+    // Producer's last view of head.
+    size_t cachedHead;
+
+public:
+    // Constructor: room for capacity (rounded up to a power of two) batches.
+    explicit PeerQueue(size_t capacity = DEFAULT_CAPACITY);
+
+    // Producer: moves batch in and returns true, or returns false (batch untouched) if the queue is full.
+    bool push(std::vector<CoreMessage>& batch);
+    // Consumer: moves the oldest batch into batch and returns true, or returns false if the queue is empty.
+    bool pop(std::vector<CoreMessage>& batch);
+    // Consumer: returns true if nothing is queued.
+    bool empty() const;
+};
+
+// Thread-per-core, shared-nothing RESP server. Each core runs its own RespServer event loop on a pinned thread and
+// owns a private KVStore partition, so the data path takes no lock. Every core listens on the same port
+// (SO_REUSEPORT) and serves the connections the kernel hands it. A command on a key another core owns is forwarded
+// to that core over a PeerQueue and its result comes back the same way; the connection's replies stay in command
+// order. MGET, MSET, DEL and EXISTS are split by owner and their parts merged; DBSIZE, PREFIX and the persistence
+// commands go to every core (scatter-gather). Ownership uses the same high hash bits as ShardedKVStore.
+class CoreServer {
+private:
+    // Each core's partition.
+    std::vector<std::unique_ptr<KVStore>> partitions;
+    // Each core's event loop.
+    std::vector<std::unique_ptr<RespServer>> servers;
+    // queues[from * cores + to] carries batches from one core to another (null on the diagonal).
+    std::vector<std::unique_ptr<PeerQueue>> queues;
+    // Settings every core starts from.
+    ServerConfig settings;
+
+    // Pins the calling thread to the core-th CPU this process may run on.
+    void pin(size_t core) const;
+
+public:
+    // Constructor: creates cores partitions (0 means one per hardware thread), each configured with perCoreConfig.
+    // With an append log, core i logs to (and replays) appendLogPath + "." + i; its snapshots go to
+    // snapshotPath + "." + i.
+    explicit CoreServer(size_t cores = 0, const KVStoreConfig& perCoreConfig = KVStoreConfig(), const ServerConfig& config = ServerConfig());
+    // Holds sockets and threads' state, so it cannot be copied.
+    CoreServer(const CoreServer&) = delete;
+    // Holds sockets and threads' state, so it cannot be copied.
+    CoreServer& operator=(const CoreServer&) = delete;
+
+    // Binds every core to the port and listens. Returns false if any core could not.
+    bool start();
+    // Returns the port bound by start.
+    uint16_t port() const;
+    // Runs every core's loop (core 0 on the calling thread) until stop() is called.
+    void run();
+    // Asks every loop to return; safe to call from any thread or a signal handler.
+    void stop();
+    // Returns the cores' counters summed (call after run returned).
+    ServerStats stats() const;
+    // Returns the number of cores.
+    size_t coreCount() const;
+    // Returns core's partition (for loading it before run, or inspecting it after).
+    KVStore& partition(size_t core);
+    // Returns the core owning a key, given its Utils::hash64.
+    uint32_t ownerOf(uint64_t hashCode) const;
+    // Returns the queue from one core to another.
+    PeerQueue& queue(uint32_t from, uint32_t to);
+    // Returns core's event loop.
+    RespServer& server(uint32_t core);
+};
+
+#endif // CORE_SERVER_HPP
@@ -0,0 +1,83 @@
+#ifndef CUCKOO_FILTER_HPP
+#define CUCKOO_FILTER_HPP
+
+#include <string_view> // For hashing keys without copying them
+#include <vector>
+#include <cstdint> // For fixed-width fingerprints
+
+// Implements a cuckoo filter: a membership filter that, unlike a Bloom filter, supports deletion.
+// Each key is reduced to a 16-bit fingerprint stored in one of two candidate buckets of four slots
+// (partial-key cuckoo hashing: the second bucket is derived from the first and the fingerprint, so
+// entries can be relocated without the original key). A bucket is one 64-bit word, and a lookup
+// compares the fingerprint against all four slots of a bucket at once.
+// A key may only be removed if it was added, and should be added once per live copy.
+class CuckooFilter {
+public:
+    // Number of fingerprint slots per bucket.
+    static constexpr size_t SLOTS_PER_BUCKET = 4;
+    // Load factor at which a filter is considered full and should be rebuilt larger.
+    static constexpr double MAX_LOAD_FACTOR = 0.9;
+
+private:
+    // Maximum number of relocations tried before an insert gives up.
+    static constexpr size_t MAX_KICKS = 500;
+
+    // Buckets of four 16-bit fingerprints each (0 marks an empty slot).
+    std::vector<uint64_t> buckets;
+    // Number of buckets minus one (the bucket count is a power of two).
+    size_t bucketMask;
+    // Number of fingerprints stored (including the victim).
+    size_t count;
+    // Fingerprint that could not be placed after MAX_KICKS relocations (0 when none).
+    uint16_t victimFingerprint;
+    // Bucket the victim belongs to.
+    size_t victimBucket;
+    // True once an insert failed with the victim slot already taken; lookups then answer true for everything.
+    bool overflowed;
+
+    // Returns the fingerprint of a key hash (never 0).
+    static uint16_t fingerprint(uint64_t hashCode);
+    // Returns the first candidate bucket of a key hash.
+    size_t primaryBucket(uint64_t hashCode) const;
+    // Returns the other candidate bucket given one bucket and the fingerprint.
+    size_t alternateBucket(size_t bucket, uint16_t fp) const;
+    // Returns true if the bucket holds the fingerprint.
+    bool bucketContains(size_t bucket, uint16_t fp) const;
+    // Stores the fingerprint in a free slot of the bucket; returns false if the bucket is full.
+    bool bucketInsert(size_t bucket, uint16_t fp);
+    // Clears one slot of the bucket holding the fingerprint; returns false if there is none.
+    bool bucketRemove(size_t bucket, uint16_t fp);
+
+public:
+    // Constructor: sizes the filter to hold expectedKeys keys below MAX_LOAD_FACTOR.
+    explicit CuckooFilter(size_t expectedKeys);
+
+    // Adds a key. Returns false if the filter is full (it then reports every key as possibly present).
+    bool add(std::string_view key);
+    // Adds a key given its precomputed Utils::hash64.
+    bool add(uint64_t hashCode);
+    // Removes one copy of a previously added key. Returns true if a matching fingerprint was removed.
+    bool remove(std::string_view key);
+    // Removes a key given its precomputed Utils::hash64.
+    bool remove(uint64_t hashCode);
+    // Checks if a key might exist in the set.
+    bool possiblyContains(std::string_view key) const;
+    // Checks if a key might exist given its precomputed Utils::hash64.
+    bool possiblyContains(uint64_t hashCode) const;
+    // Starts loading both candidate buckets of a key hash into cache ahead of a lookup (a hint only).
+    void prefetch(uint64_t hashCode) const;
+    // Returns the number of fingerprints stored.
+    size_t size() const;
+    // Returns the number of fingerprint slots.
+    size_t capacity() const;
+    // Returns size() / capacity().
+    double loadFactor() const;
+    // Returns true once an insert has failed; the filter must be rebuilt to be useful again.
+    bool isOverflowed() const;
+    // Returns the expected false-positive rate at the current load (1.0 once overflowed).
+    double estimatedFalsePositiveRate() const;
+    // Returns the number of bytes used by the buckets.
+    size_t sizeBytes() const;
+};
+
+#endif // CUCKOO_FILTER_HPP
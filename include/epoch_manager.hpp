@@ -0,0 +1,101 @@
+#ifndef EPOCH_MANAGER_HPP
+#define EPOCH_MANAGER_HPP
+
+#include <atomic> // For the epochs
+#include <vector>
+#include <memory> // For std::unique_ptr
+#include <cstdint> // For epoch numbers
+#include <cstddef> // For size_t
+
+// Epoch-based reclamation: lets readers traverse shared structures without locks while writers unlink and retire
+// parts of them. A reader pins the current epoch for the duration of a Guard, writing only its own cache line.
+// Retired memory is freed once the global epoch moved two steps past its retirement, which can only happen after
+// every reader pinned at the time has left. Writers (retire, reclaim) must be serialized by the caller.
+class EpochManager {
+public:
+    // Threads that pin through their own slot; more concurrent threads share one conservative overflow count.
+    static constexpr size_t MAX_THREADS = 512;
+    // Default retired objects that trigger a reclamation attempt.
+    static constexpr size_t DEFAULT_RECLAIM_BATCH = 64;
+
+private:
+    // Assumed cache line size; every reader's slot gets its own line.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // One thread's pinned epoch (0 while it is not reading).
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        // Epoch pinned, or 0.
+        std::atomic<uint64_t> epoch{0};
+    };
+
+    // Memory waiting for every reader that might still see it to leave.
+    struct Retired {
+        // The object.
+        void* pointer;
+        // Frees it.
+        void (*destroy)(void*);
+        // Global epoch when it was retired.
+        uint64_t epoch;
+    };
+
+    // Global epoch (starts at 1; 0 marks an idle slot).
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> globalEpoch;
+    // Readers on threads without a slot of their own; while any is active the epoch cannot advance.
+    alignas(CACHE_LINE_SIZE) mutable std::atomic<uint64_t> overflowReaders;
+    // One slot per thread index.
+    std::unique_ptr<Slot[]> slots;
+    // Retired objects in retirement order (so in epoch order).
+    std::vector<Retired> limbo;
+    // Retired objects that trigger a reclamation attempt.
+    size_t reclaimBatch;
+    // Objects freed so far.
+    uint64_t freedCount;
+
+    // Advances the global epoch if every pinned reader has seen the current one; returns the (new) epoch.
+    uint64_t tryAdvance();
+
+public:
+    // Keeps the calling thread's reads safe from reclamation while it lives. Guards nest.
+    class Guard {
+    private:
+        // Manager pinned.
+        const EpochManager& manager;
+        // The thread's slot (nullptr for an overflow reader).
+        std::atomic<uint64_t>* slot;
+        // False for a nested guard, which leaves the pin to the outer one.
+        bool pinned;
+
+    public:
+        // Constructor: pins the current epoch.
+        explicit Guard(const EpochManager& manager);
+        // Destructor: unpins it.
+        ~Guard();
+        // Tied to its scope, so it cannot be copied.
+        Guard(const Guard&) = delete;
+        // Tied to its scope, so it cannot be copied.
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    // Constructor: reclamation is attempted every reclaimBatch retirements.
+    explicit EpochManager(size_t reclaimBatch = DEFAULT_RECLAIM_BATCH);
+    // Destructor: frees everything still retired (no reader may be active).
+    ~EpochManager();
+    // Readers hold references to it, so it cannot be copied.
+    EpochManager(const EpochManager&) = delete;
+    // Readers hold references to it, so it cannot be copied.
+    EpochManager& operator=(const EpochManager&) = delete;
+
+    // Hands an object already unlinked from the shared structure over for freeing with destroy once no reader can
+    // still hold it. Writers only.
+    void retire(void* pointer, void (*destroy)(void*));
+    // Frees every retired object no reader can still hold; returns how many. Writers only.
+    size_t reclaim();
+    // Returns the number of retired objects not yet freed. Writers only.
+    size_t pending() const;
+    // Returns the number of objects freed so far. Writers only.
+    uint64_t freed() const;
+    // Returns the global epoch.
+    uint64_t epoch() const;
+};
+
+#endif // EPOCH_MANAGER_HPP
@@ -0,0 +1,51 @@
+#ifndef FREQUENCY_SKETCH_HPP
+#define FREQUENCY_SKETCH_HPP
+
+#include <vector>
+#include <cstdint> // For uint64_t
+#include <cstddef> // For size_t
+
+// Count-min sketch of recent access frequencies, used by the W-TinyLFU cache policy to decide
+// whether a new key is worth evicting an existing one for.
+// Counters are 4 bits (saturating at 15), sixteen to a 64-bit word, in DEPTH rows; a key's
+// estimate is the minimum of its DEPTH counters, so it never undercounts (collisions only add).
+// After sampleSize increments every counter is halved, so old popularity decays and the sketch
+// tracks the recent working set rather than all-time counts.
+class FrequencySketch {
+private:
+    // Packed 4-bit counters: DEPTH rows of wordsPerRow words each.
+    std::vector<uint64_t> table;
+    // Words in one row.
+    size_t wordsPerRow;
+    // Counters per row minus one (rows hold a power of two counters).
+    size_t counterMask;
+    // Increments since the last halving.
+    size_t additions;
+    // Increments between halvings.
+    size_t sampleSize;
+
+    // Returns the counter index for a key in a row.
+    size_t counterIndex(uint64_t hashCode, size_t row) const;
+
+public:
+    // Number of counter rows (independent hash functions).
+    static constexpr size_t DEPTH = 4;
+    // Largest value a counter can hold.
+    static constexpr uint8_t MAX_COUNT = 15;
+    // Halving period as a multiple of the number of counters in a row.
+    static constexpr size_t SAMPLE_FACTOR = 10;
+
+    // Constructor: sizes the sketch for about expectedKeys distinct keys (rounded up to a power of two).
+    explicit FrequencySketch(size_t expectedKeys);
+
+    // Records one access to a key given its Utils::hash64.
+    void increment(uint64_t hashCode);
+    // Returns the estimated recent access count of a key (0..MAX_COUNT), never below the true count since the last halving.
+    uint8_t frequency(uint64_t hashCode) const;
+    // Halves every counter (done automatically every sampleSize increments).
+    void age();
+    // Returns the number of bytes used by the counters.
+    size_t sizeBytes() const;
+};
+
+#endif // FREQUENCY_SKETCH_HPP
@@ -2,43 +2,190 @@
 #define HASH_MAP_HPP
 
 #include <string>
+#include <string_view> // For heterogeneous lookup
+#include <optional> // For borrowed lookup results
 #include <vector>
-#include <list> // For chaining
-#include <utility> // For std::pair
+#include <cstdint> // For fixed-width control bytes
+#include <memory> // For std::unique_ptr
+#include <functional> // For scan callbacks
+#include "slab_arena.hpp"
 
-// Defines a simple Hash Map with string keys and string values using chaining for collision resolution.
+// Probe sequence figures reported by HashMap::probeStats.
+struct ProbeStats {
+    // Live entries examined.
+    size_t sampledEntries = 0;
+    // Mean number of groups a lookup of a sampled entry probes (1 when each sits in its home group).
+    double meanProbeLength = 0.0;
+    // Most groups a lookup of a sampled entry probes.
+    size_t maxProbeLength = 0;
+};
+
+// Defines a flat, open-addressing Hash Map with string keys and string values.
+// Each slot is a pointer to a SlabArena record holding the key and value bytes contiguously.
+// Slots are grouped 16 at a time; a separate array of 1-byte control bytes (SwissTable style)
+// holds a 7-bit fingerprint of each slot's hash, so a probe can compare a whole group with SIMD
+// before touching any key.
+// Resizing is incremental: while a resize is in progress the map keeps the old and the new table
+// and every set/get/remove migrates a bounded number of groups, so no single call pays for it all.
 class HashMap {
+public:
+    // Default load factor (live + deleted slots / capacity) that starts a grow.
+    static constexpr double DEFAULT_MAX_LOAD_FACTOR = 0.875;
+    // Default load factor (live slots / capacity) below which the table shrinks.
+    static constexpr double DEFAULT_MIN_LOAD_FACTOR = 0.1;
+
 private:
-    // Represents a key-value pair in a hash map bucket.
-    using BucketNode = std::pair<std::string, std::string>;
-    // Each bucket is a list of key-value pairs (nodes) for chaining.
-    using Bucket = std::list<BucketNode>;
-    // The hash table is a vector of buckets.
-    std::vector<Bucket> table;
-    // Current number of elements in the hash map.
-    size_t currentSize;
-    // Capacity of the hash table (number of buckets).
-    size_t tableCapacity;
-
-    // Hash function to map a key to an index in the table.
-    size_t hash(const std::string& key) const;
-    // Rehashes the table when load factor exceeds a threshold (not fully implemented here for brevity).
-    void rehash(); // Declaration for future expansion
+    // A slot points at the arena record holding its key and value (nullptr when unused).
+    using Slot = char*;
+
+    // Control byte marking a slot that has never been used (stops probing).
+    static constexpr int8_t CTRL_EMPTY = -128;
+    // Control byte marking a tombstone left behind by remove (probing continues past it).
+    static constexpr int8_t CTRL_DELETED = -2;
+    // Number of slots scanned together in one probe step (one SSE2 register of control bytes).
+    static constexpr size_t GROUP_WIDTH = 16;
+    // Number of old-table groups migrated by each operation while a resize is in progress.
+    static constexpr size_t REHASH_GROUPS_PER_STEP = 2;
+    // Random slots probed per sampled entry before falling back to the next live slot.
+    static constexpr size_t MAX_SAMPLE_PROBES = 32;
+
+    // One open-addressing table; the map holds two of these during a resize.
+    struct Table {
+        // One control byte per slot: CTRL_EMPTY, CTRL_DELETED, or the 7-bit fingerprint of a full slot.
+        std::vector<int8_t> ctrl;
+        // The slot array, parallel to ctrl.
+        std::vector<Slot> slots;
+        // Per-slot access stamps for eviction (see accessStamp), parallel to ctrl. Kept beside the slots
+        // rather than in the arena record so records stay in their size class.
+        std::vector<uint32_t> stamps;
+        // Number of slots (always a power-of-two multiple of GROUP_WIDTH, or 0 when unallocated).
+        size_t capacity = 0;
+        // Number of live entries.
+        size_t size = 0;
+        // Number of tombstones.
+        size_t deleted = 0;
+    };
+
+    // Table receiving all inserts (the new table while a resize is in progress).
+    Table active;
+    // Old table being drained into active during a resize (unallocated otherwise).
+    Table draining;
+    // Next slot of the draining table to migrate.
+    size_t migrateIndex;
+    // Number of resizes started so far.
+    uint64_t resizeEpoch;
+    // Capacity requested at construction; the table never shrinks below it.
+    size_t initialCapacity;
+    // Load factor (live + deleted) that starts a grow or tombstone purge.
+    double maxLoadFactor;
+    // Load factor (live) below which the table shrinks.
+    double minLoadFactor;
+    // Arena created by the map itself when none was supplied.
+    std::unique_ptr<SlabArena> ownedArena;
+    // Arena holding every record (either supplied by the owner or ownedArena).
+    SlabArena* arena;
+    // Sum of SlabArena::footprint over the map's live records.
+    size_t recordBytes;
+
+    // Hash function producing the full hash of a key (group index from bits 7 and up, fingerprint from the low 7).
+    uint64_t hash(std::string_view key) const;
+    // Finds the slot holding key in a table, or returns the table's capacity if it is absent.
+    size_t findSlot(const Table& table, std::string_view key, uint64_t hashCode) const;
+    // Finds the first empty or deleted slot along the probe sequence of the given hash.
+    size_t findInsertSlot(const Table& table, uint64_t hashCode) const;
+    // Places a slot known to be absent into a table, with its access stamp.
+    void insertSlot(Table& table, uint64_t hashCode, Slot slot, uint32_t stamp);
+    // Erases the slot at index from a table.
+    void eraseSlot(Table& table, size_t index);
+    // Allocates a table of the given slot count.
+    void initTable(Table& table, size_t slotCount);
+    // Starts an incremental resize into a table of newCapacity slots.
+    void startRehash(size_t newCapacity);
+    // Migrates up to maxGroups groups from the draining table into the active table.
+    void rehashStep(size_t maxGroups);
 
 public:
-    // Constructor: initializes the hash map with a given capacity.
-    explicit HashMap(size_t capacity = 101); // Default capacity, prime number
+    // Constructor: initializes the hash map with a given capacity and resize thresholds.
+    // Records are allocated from recordArena, or from an arena private to the map when it is null.
+    explicit HashMap(size_t capacity = 101, // Rounded up to a power-of-two number of groups
+                     double maxLoad = DEFAULT_MAX_LOAD_FACTOR,
+                     double minLoad = DEFAULT_MIN_LOAD_FACTOR,
+                     SlabArena* recordArena = nullptr);
+    // Destructor: returns every record to the arena.
+    ~HashMap();
+    // Slots hold raw arena pointers, so the map cannot be copied.
+    HashMap(const HashMap&) = delete;
+    // Slots hold raw arena pointers, so the map cannot be copied.
+    HashMap& operator=(const HashMap&) = delete;
 
-    // Inserts or updates a key-value pair.
-    void set(const std::string& key, const std::string& value);
+    // Inserts or updates a key-value pair. Returns true if the key was new, false if it was updated.
+    bool set(const std::string& key, const std::string& value);
+    // Inserts or updates a key-value pair whose Utils::hash64 the caller already computed.
+    bool set(std::string_view key, std::string_view value, uint64_t hashCode);
+    // Same as set, but returns the key's record (see SlabArena::key and SlabArena::value; valid until the key
+    // is next set or removed) and reports through inserted whether the key was new.
+    char* upsert(std::string_view key, std::string_view value, uint64_t hashCode, bool& inserted);
+    // Sizes an empty map for count entries up front, so bulk loading never resizes (a no-op on a non-empty map).
+    void reserve(size_t count);
+    // Inserts a key the caller knows is absent (e.g. read from a snapshot), skipping the lookup set performs.
+    // Inserting a key that is already present leaves two entries for it.
+    void insertNew(std::string_view key, std::string_view value, uint64_t hashCode);
     // Retrieves the value associated with a key. Returns empty string if not found.
     std::string get(const std::string& key);
+    // Looks up a key without copying it or its value. The view borrows the arena record and is
+    // valid until the key is next set or removed (migration moves slot pointers, not records).
+    std::optional<std::string_view> find(std::string_view key);
+    // Same as find, with a precomputed Utils::hash64 of the key.
+    std::optional<std::string_view> find(std::string_view key, uint64_t hashCode);
+    // Same as find, but returns the record holding the key and value, or nullptr if the key is absent.
+    const char* findRecord(std::string_view key, uint64_t hashCode);
+    // Starts loading the control bytes, slots and stamps that a lookup or insert of the hash probes first into cache,
+    // in both tables while a resize is in progress (a hint only; batched callers issue it for every key before probing).
+    void prefetch(uint64_t hashCode) const;
+    // Second stage of prefetch: reads the first probe group of the hash (best issued once prefetch has loaded
+    // it) and starts loading the records whose fingerprint matches, so the key comparison finds them in cache.
+    void prefetchRecords(uint64_t hashCode) const;
+    // Same as find, but never advances an in-progress resize, so concurrent const calls are safe.
+    std::optional<std::string_view> peek(std::string_view key) const;
+    // Same as peek, with a precomputed Utils::hash64 of the key.
+    std::optional<std::string_view> peek(std::string_view key, uint64_t hashCode) const;
     // Deletes a key-value pair. Returns true if key was found and deleted, false otherwise.
     bool remove(const std::string& key);
+    // Same as remove, with a precomputed Utils::hash64 of the key.
+    bool remove(std::string_view key, uint64_t hashCode);
     // Checks if a key exists in the hash map.
     bool contains(const std::string& key);
+    // Same as contains, with a precomputed Utils::hash64 of the key.
+    bool contains(std::string_view key, uint64_t hashCode);
     // Returns the current number of elements in the hash map.
     size_t size() const;
+    // Returns the access stamp of a key (0 for a new key), or nullptr if it is absent. The map only stores
+    // the stamp; its meaning (an LRU clock, an LFU counter) is up to the owner. The pointer is valid until
+    // the next set or remove on the map.
+    uint32_t* accessStamp(std::string_view key, uint64_t hashCode);
+    // Visits count live entries picked at random (from seed) with their access stamps and returns the number
+    // visited (0 when the map is empty). Entries are drawn independently, so one may be visited more than once.
+    // Used for sampled eviction.
+    size_t sample(uint64_t seed, size_t count,
+                  const std::function<void(std::string_view key, uint32_t stamp)>& visit) const;
+    // Returns the bytes held by the map: control bytes, slots and stamps of both tables, plus the arena
+    // slots of its records.
+    size_t memoryUsage() const;
+    // Returns the number of slots in the table receiving inserts.
+    size_t capacity() const;
+    // Measures probe lengths on up to maxEntries live entries of the table receiving inserts, taken at evenly
+    // spaced slots, so the cost is bounded whatever the map's size (entries still in a draining table are skipped).
+    ProbeStats probeStats(size_t maxEntries) const;
+    // Returns true while an incremental resize is migrating entries.
+    bool isRehashing() const;
+    // Returns the number of resizes started so far; scan cursors are only meaningful while it is unchanged.
+    uint64_t resizeCount() const;
+    // Visits the live entries in slots [cursor, cursor + maxSlots) of the active table and returns the
+    // cursor to resume from (capacity() once every slot was visited). Entries still waiting in a draining
+    // table are not visited, so a full pass is only complete if it ran while isRehashing() was false
+    // and resizeCount() did not change. Entries never move between slots otherwise.
+    size_t scan(size_t cursor, size_t maxSlots,
+                const std::function<void(std::string_view key, std::string_view value)>& visit) const;
 };
 
-#endif // HASH_MAP_HPP
\ No newline at end of file
+#endif // HASH_MAP_HPP
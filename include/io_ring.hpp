@@ -0,0 +1,188 @@
+#ifndef IO_RING_HPP
+#define IO_RING_HPP
+
+// The io_uring backend is compiled only with the KV_STORE_IO_URING CMake option; without it this header is empty
+// and every caller keeps its epoll / blocking-write path.
+#ifdef KV_STORE_IO_URING
+
+#include <linux/io_uring.h> // For the kernel's ring layout and opcodes
+#include <sys/uio.h> // For iovec
+#include <vector>
+#include <cstdint> // For fixed-width fields
+#include <cstddef> // For size_t
+
+// Minimal io_uring instance driven through the kernel interface directly (io_uring_setup / io_uring_enter and the
+// shared submission and completion rings), so the backend needs nothing beyond the kernel headers.
+// Not thread-safe: one thread at a time prepares, submits and reaps.
+class IoRing {
+private:
+    // Ring descriptor (-1 if setup failed).
+    int ringFd;
+    // Mapped submission ring (head, tail, mask, index array).
+    unsigned char* sqRing;
+    // Its mapped length.
+    size_t sqRingBytes;
+    // Mapped completion ring (the same mapping as sqRing when the kernel offers a single mmap).
+    unsigned char* cqRing;
+    // Its mapped length (0 when shared with sqRing).
+    size_t cqRingBytes;
+    // Mapped submission queue entries.
+    io_uring_sqe* sqes;
+    // Their mapped length.
+    size_t sqesBytes;
+    // Kernel-owned submission head.
+    unsigned* sqHead;
+    // Submission tail published to the kernel.
+    unsigned* sqTail;
+    // Submission index array.
+    unsigned* sqArray;
+    // Submission ring mask.
+    unsigned sqMask;
+    // Submission ring size.
+    unsigned sqEntries;
+    // Completion head, advanced as completions are reaped.
+    unsigned* cqHead;
+    // Kernel-owned completion tail.
+    unsigned* cqTail;
+    // Completion ring mask.
+    unsigned cqMask;
+    // Completion entries.
+    io_uring_cqe* cqes;
+    // Entries handed out by nextSqe (published by submit).
+    unsigned preparedTail;
+    // Entries already published.
+    unsigned publishedTail;
+
+public:
+    // Constructor: sets up a ring with room for entries submissions (rounded up to a power of two by the kernel).
+    explicit IoRing(unsigned entries);
+    // Destructor: unmaps the rings and closes the descriptor, cancelling whatever is still in flight.
+    ~IoRing();
+    // Holds a descriptor and mappings, so it cannot be copied.
+    IoRing(const IoRing&) = delete;
+    // Holds a descriptor and mappings, so it cannot be copied.
+    IoRing& operator=(const IoRing&) = delete;
+
+    // Returns false if the kernel refused the ring (too old, or io_uring disabled).
+    bool isOpen() const;
+    // Returns a zeroed submission entry to fill in, submitting the prepared ones first if the queue is full.
+    // Returns nullptr only if the queue stays full.
+    io_uring_sqe* nextSqe();
+    // Publishes every prepared entry and enters the kernel once, waiting for at least waitFor completions.
+    // Returns the number submitted, or -errno.
+    int submit(unsigned waitFor = 0);
+    // Returns the oldest unreaped completion, or nullptr if there is none.
+    io_uring_cqe* peekCompletion();
+    // Marks the completion returned by peekCompletion as reaped.
+    void advanceCompletion();
+    // Registers fixed buffers for IORING_OP_READ_FIXED / WRITE_FIXED (buf_index is their position).
+    bool registerBuffers(const iovec* buffers, unsigned count);
+    // Returns the ring descriptor (for io_uring_register calls).
+    int descriptor() const;
+};
+
+// Provided buffers: a group of equally sized receive buffers the kernel picks from when a receive completes
+// (IOSQE_BUFFER_SELECT), so a multishot receive needs no buffer per connection. The chosen buffer's id arrives in
+// the completion's flags; the caller reads it and hands it back with recycle, which queues a PROVIDE_BUFFERS entry
+// (submitted with the caller's next batch). Those completions carry PROVIDE_TAG and are to be skipped.
+class IoBufferRing {
+public:
+    // user_data of the ring's own PROVIDE_BUFFERS completions.
+    static constexpr uint64_t PROVIDE_TAG = 0;
+
+private:
+    // Ring the group is provided to.
+    IoRing& ring;
+    // Backing storage of every buffer.
+    std::vector<char> storage;
+    // Buffers waiting for a submission entry (only when the queue was full).
+    std::vector<uint16_t> pending;
+    // Number of buffers.
+    unsigned count;
+    // Bytes per buffer.
+    size_t bufferBytes;
+    // Buffer group id.
+    uint16_t groupId;
+    // True once the kernel accepted the buffers.
+    bool registered;
+
+public:
+    // Constructor: allocates count buffers of bufferBytes and provides them as group groupId.
+    IoBufferRing(IoRing& ring, uint16_t groupId, unsigned count, size_t bufferBytes);
+    // Destructor: frees the buffers (destroy the ring first, so no receive can still fill them).
+    ~IoBufferRing();
+    // Lent to the kernel by address, so it cannot be copied.
+    IoBufferRing(const IoBufferRing&) = delete;
+    // Lent to the kernel by address, so it cannot be copied.
+    IoBufferRing& operator=(const IoBufferRing&) = delete;
+
+    // Returns false if the kernel does not support provided buffers.
+    bool isOpen() const;
+    // Returns the group id to put in a receive's buf_group.
+    uint16_t group() const;
+    // Returns the start of buffer id.
+    const char* buffer(uint16_t id) const;
+    // Hands buffer id back to the kernel.
+    void recycle(uint16_t id);
+};
+
+// Sequential file writer that keeps up to depth writes in flight from registered (fixed) buffers, so encoding or
+// hashing the next block overlaps with writing the previous ones, and the final write and fsync share one
+// system call. Used by snapshot and log-rewrite writers.
+class RingFileWriter {
+public:
+    // Default bytes per buffer (one write each).
+    static constexpr size_t DEFAULT_SLOT_BYTES = 1 << 20;
+    // Default buffers, and so most writes in flight.
+    static constexpr unsigned DEFAULT_DEPTH = 4;
+
+private:
+    // Ring of this writer.
+    IoRing ring;
+    // File written.
+    int fd;
+    // Bytes per buffer.
+    size_t slotBytes;
+    // Backing storage of every buffer (registered with the ring).
+    std::vector<char> storage;
+    // Bytes queued in each buffer.
+    std::vector<size_t> slotLength;
+    // Buffers not in flight.
+    std::vector<unsigned> freeSlots;
+    // Buffer being filled (-1 when none).
+    int currentSlot;
+    // File offset of the next write.
+    uint64_t offset;
+    // Writes in flight.
+    unsigned inFlight;
+    // True while a queued fsync has not completed.
+    bool syncPending;
+    // True once any write failed.
+    bool failed;
+    // True once the buffers were registered.
+    bool registered;
+
+    // Queues the current buffer for writing.
+    void submitSlot();
+    // Reaps completions, waiting for at least waitFor.
+    void reap(unsigned waitFor);
+
+public:
+    // Constructor: writes fd sequentially from offset with depth buffers of slotBytes.
+    RingFileWriter(int fd, uint64_t offset, size_t slotBytes = DEFAULT_SLOT_BYTES, unsigned depth = DEFAULT_DEPTH);
+    // Holds a ring, so it cannot be copied.
+    RingFileWriter(const RingFileWriter&) = delete;
+    // Holds a ring, so it cannot be copied.
+    RingFileWriter& operator=(const RingFileWriter&) = delete;
+
+    // Returns false if the ring or its buffers could not be set up (callers then write directly).
+    bool isOpen() const;
+    // Copies data into the buffers, queueing each full one.
+    void write(const char* data, size_t size);
+    // Writes the rest, waits for every write and, if sync, fsyncs the file. Returns false on any I/O error.
+    bool finish(bool sync);
+};
+
+#endif // KV_STORE_IO_URING
+
+#endif // IO_RING_HPP
@@ -1,52 +1,567 @@
 #ifndef KV_STORE_HPP
 #define KV_STORE_HPP
 
+#include "slab_arena.hpp"
 #include "hash_map.hpp"
 #include "trie.hpp"
 #include "lru_cache.hpp"
-#include "bloom_filter.hpp"
+#include "membership_filter.hpp"
+#include "timing_wheel.hpp"
+#include "snapshot.hpp"
+#include "append_log.hpp"
+#include "metrics.hpp"
 #include <string>
+#include <string_view> // For zero-copy lookups
+#include <optional> // For borrowed lookup results
 #include <vector>
 #include <memory> // For std::unique_ptr
+#include <unordered_map> // For keys changed during a filter rebuild
+#include <unordered_set> // For deadlines that lapsed while the store was down
+#include <map> // For snapshot versions and ordered version chains
+#include <utility> // For std::pair
+#include <functional> // For a substitutable expiry clock
+#include <cstdint> // For expiry deadlines
+#include <sys/types.h> // For the background save's process id
+
+// What a KVStore does when a write would take it past its memory budget (KVStoreConfig::maxMemoryBytes).
+// Victims are chosen by sampling a few keys and evicting the best candidate among them, as Redis does,
+// so no policy keeps a global ordering of all keys.
+enum class EvictionPolicy {
+    // Reject the write; nothing is evicted.
+    NoEviction,
+    // Evict the sampled key idle for longest.
+    AllKeysLRU,
+    // Evict the sampled key with the lowest decayed access frequency.
+    AllKeysLFU,
+    // Evict a random key.
+    AllKeysRandom,
+    // Like AllKeysLRU, but only keys with an expiry are candidates.
+    VolatileLRU,
+    // Like AllKeysRandom, but only keys with an expiry are candidates.
+    VolatileRandom
+};
+
+// Construction-time tunables for KVStore.
+struct KVStoreConfig {
+    // Default capacity of the LRU cache.
+    static constexpr size_t DEFAULT_CACHE_CAPACITY = 100;
+    // Default size of the Bloom filter in bits (positional constructor).
+    static constexpr size_t DEFAULT_BLOOM_FILTER_SIZE = 1000;
+    // Default number of Bloom filter hash functions (positional constructor).
+    static constexpr size_t DEFAULT_BLOOM_FILTER_HASHES = 3;
+    // Default number of keys the Bloom filter is sized for.
+    static constexpr size_t DEFAULT_BLOOM_EXPECTED_KEYS = 10000;
+    // Default Bloom filter false-positive rate at the expected number of keys.
+    static constexpr double DEFAULT_BLOOM_TARGET_FPR = 0.01;
+    // Default multiple of the target false-positive rate at which the filter is rebuilt.
+    static constexpr double DEFAULT_FILTER_REBUILD_FACTOR = 2.0;
+    // Default number of keys sampled per eviction.
+    static constexpr size_t DEFAULT_EVICTION_SAMPLES = 5;
+    // Default number of keys multiGet / multiSet hash and prefetch before resolving any of them.
+    static constexpr size_t DEFAULT_MULTI_KEY_BATCH = 16;
+    // Default multiple of the live data size past which the append log is rewritten.
+    static constexpr double DEFAULT_APPEND_LOG_REWRITE_FACTOR = 2.0;
+    // Default size below which the append log is never rewritten.
+    static constexpr size_t DEFAULT_APPEND_LOG_REWRITE_MIN_BYTES = 64 * 1024 * 1024;
+
+    // Initial number of HashMap slots (the table grows and shrinks from here).
+    size_t hashMapCapacity = 101;
+    // Maximum number of entries in the LRU cache.
+    size_t cacheCapacity = DEFAULT_CACHE_CAPACITY;
+    // Cache replacement policy: LRU (default), or the scan-resistant W-TinyLFU or S3-FIFO.
+    CachePolicy cachePolicy = CachePolicy::LRU;
+    // Membership filter in front of the main store: Bloom (default) or the deletable cuckoo filter.
+    FilterMode filterMode = FilterMode::Bloom;
+    // Number of keys the membership filter (Bloom or cuckoo) is sized for.
+    size_t bloomExpectedKeys = DEFAULT_BLOOM_EXPECTED_KEYS;
+    // Bloom filter false-positive rate wanted once bloomExpectedKeys keys are stored.
+    double bloomTargetFpr = DEFAULT_BLOOM_TARGET_FPR;
+    // The filter is rebuilt from the main store in the background once its estimated false-positive rate
+    // exceeds this multiple of bloomTargetFpr, or a cuckoo filter fills up (0 disables rebuilds).
+    double filterRebuildFactor = DEFAULT_FILTER_REBUILD_FACTOR;
+    // Explicit Bloom filter size in bits; 0 sizes it from bloomExpectedKeys and bloomTargetFpr.
+    size_t bloomFilterSize = 0;
+    // Explicit number of Bloom filter bits per key; 0 picks the optimum for the filter size.
+    size_t bloomFilterNumHashes = 0;
+    // HashMap load factor (live + deleted slots) that starts an incremental grow.
+    double maxLoadFactor = HashMap::DEFAULT_MAX_LOAD_FACTOR;
+    // HashMap load factor (live slots) below which it incrementally shrinks.
+    double minLoadFactor = HashMap::DEFAULT_MIN_LOAD_FACTOR;
+    // Memory budget in bytes across the main store, trie, cache and filter (see KVStore::memoryUsage); 0 means unlimited.
+    size_t maxMemoryBytes = 0;
+    // What a write does once the budget is reached.
+    EvictionPolicy evictionPolicy = EvictionPolicy::NoEviction;
+    // Keys sampled per eviction; more samples approximate the exact policy more closely but cost more.
+    size_t evictionSamples = DEFAULT_EVICTION_SAMPLES;
+    // Current time in milliseconds since the Unix epoch, used for key expiry; empty uses Utils::unixMillis.
+    std::function<uint64_t()> clock;
+    // Keys multiGet / multiSet hash and prefetch ahead of resolving them; enough to cover memory latency,
+    // few enough that the prefetched lines are still cached when each lookup runs (0 is treated as 1).
+    size_t multiKeyBatch = DEFAULT_MULTI_KEY_BATCH;
+    // Append-only log every write is recorded in and replayed from when the store is constructed; empty disables it.
+    std::string appendLogPath;
+    // When the log is forced to disk.
+    AppendFsync appendFsync = AppendFsync::EverySec;
+    // Under AppendFsync::Always, writes return before their record is on disk and the caller makes them durable with
+    // KVStore::syncAppendLog, e.g. once per pipelined batch or after releasing a lock, so several writes share one fdatasync.
+    bool appendLogDeferSync = false;
+    // The log is rewritten in the background once it exceeds this multiple of the live payload bytes (0 disables it).
+    double appendLogRewriteFactor = DEFAULT_APPEND_LOG_REWRITE_FACTOR;
+    // Nor is it rewritten while smaller than this.
+    size_t appendLogRewriteMinBytes = DEFAULT_APPEND_LOG_REWRITE_MIN_BYTES;
+};
+
+// Membership filter figures reported by KVStore::filterStats.
+struct FilterStats {
+    // Structure in use.
+    FilterMode mode = FilterMode::Bloom;
+    // Bytes of filter bits or buckets.
+    size_t sizeBytes = 0;
+    // Expected false-positive rate given the keys added (and, for cuckoo, removed) since the last build.
+    double estimatedFalsePositiveRate = 0.0;
+    // Number of completed background rebuilds.
+    size_t rebuilds = 0;
+    // True while a rebuild is in progress.
+    bool rebuilding = false;
+};
+
+// Memory budget figures reported by KVStore::evictionStats.
+struct EvictionStats {
+    // Policy in use.
+    EvictionPolicy policy = EvictionPolicy::NoEviction;
+    // Current usage in bytes (KVStore::memoryUsage).
+    size_t usedBytes = 0;
+    // Configured budget (0 when unlimited).
+    size_t maxBytes = 0;
+    // Keys evicted so far.
+    size_t evictedKeys = 0;
+    // Writes rejected because nothing could be evicted.
+    size_t rejectedWrites = 0;
+};
+
+// Key expiry figures reported by KVStore::expiryStats.
+struct ExpiryStats {
+    // Keys that currently carry a deadline.
+    size_t keysWithExpiry = 0;
+    // Timers in the timing wheel (including stale ones left by EXPIRE, PERSIST or overwrites).
+    size_t pendingTimers = 0;
+    // Keys removed because their deadline passed (lazily on access or by the timing wheel).
+    size_t expiredKeys = 0;
+};
+
+// Snapshot figures reported by KVStore::snapshotStats.
+struct SnapshotStats {
+    // True while a background save (BGSAVE) is running.
+    bool backgroundSaveInProgress = false;
+    // Whether the last completed save (foreground or background) succeeded; true before the first.
+    bool lastSaveOk = true;
+    // Time of the last successful save, in ms since the Unix epoch (0 if none).
+    uint64_t lastSaveUnixMillis = 0;
+    // Keys read by the last load.
+    size_t keysLoaded = 0;
+};
+
+// Version figures reported by KVStore::versionStats.
+struct VersionStats {
+    // Snapshots currently open.
+    size_t openSnapshots = 0;
+    // Keys with overwritten states kept for a snapshot.
+    size_t versionedKeys = 0;
+    // Overwritten states kept.
+    size_t keptVersions = 0;
+    // Bytes of keys and values held by the kept states (not counted against the memory budget).
+    size_t versionBytes = 0;
+    // Overwritten states dropped once no snapshot could read them.
+    uint64_t collectedVersions = 0;
+};
+
+// A key, value and deadline as a snapshot sees them (KVSnapshot::entries).
+struct SnapshotEntry {
+    // The key.
+    std::string key;
+    // Its value.
+    std::string value;
+    // Its deadline in ms since the Unix epoch (0 if none).
+    uint64_t deadline = 0;
+};
+
+class KVStore;
+
+// Handle on a point-in-time view of a KVStore, taken with KVStore::snapshot(). Reads through it see every key as it
+// was when the snapshot was taken, however the store is written meanwhile; writes keep going and pay only for
+// copying the state they overwrite while a snapshot may still read it. Releasing the handle (or destroying it) lets
+// the store drop those copies. It must be released before its store is destroyed, and it is not thread-safe on its
+// own: reads count as const calls on the store and releasing as a write.
+class KVSnapshot {
+private:
+    friend class KVStore;
+    // Store viewed (null once released).
+    KVStore* store;
+    // Last write visible to the snapshot.
+    uint64_t snapshotVersion;
+    // Time keys' deadlines are judged against (the store's clock when it was taken).
+    uint64_t snapshotTime;
+
+    // Constructor: used by KVStore::snapshot.
+    KVSnapshot(KVStore* store, uint64_t version, uint64_t time);
+
+public:
+    // Constructor: an empty handle that views nothing.
+    KVSnapshot();
+    // Destructor: releases the snapshot.
+    ~KVSnapshot();
+    // Moves the view over, leaving other empty.
+    KVSnapshot(KVSnapshot&& other) noexcept;
+    // Releases this view and takes other's.
+    KVSnapshot& operator=(KVSnapshot&& other) noexcept;
+    // A view is released once, so handles cannot be copied.
+    KVSnapshot(const KVSnapshot&) = delete;
+    // A view is released once, so handles cannot be copied.
+    KVSnapshot& operator=(const KVSnapshot&) = delete;
+
+    // Lets the store drop the versions only this snapshot needed; the handle becomes empty.
+    void release();
+    // Returns true until the handle is released.
+    bool valid() const;
+    // Returns the store version the snapshot reads at.
+    uint64_t version() const;
+    // Returns a copy of a key's value as of the snapshot, or std::nullopt if it was absent (or expired).
+    std::optional<std::string> get(std::string_view key) const;
+    // Retrieves all keys starting with the given prefix as of the snapshot, in sorted order.
+    std::vector<std::string> prefixSearch(const std::string& prefix) const;
+    // Returns up to limit key-value pairs with keys in [start, end) as of the snapshot (no end: every key from start
+    // on), in ascending key order, or descending when reverse is set.
+    std::vector<std::pair<std::string, std::string>> scanRange(const std::string& start, const std::optional<std::string>& end,
+                                                               size_t limit, bool reverse = false) const;
+    // Returns up to limit entries (with deadlines) whose keys start with prefix, in ascending order after the key
+    // after (none: from the first). Pages resume from the last key returned, so a caller can release its lock
+    // between pages and still read one consistent view.
+    std::vector<SnapshotEntry> entries(const std::string& prefix, const std::optional<std::string>& after, size_t limit) const;
+};
 
 // High-level interface for the In-Memory Key-Value Store.
 class KVStore {
+public:
+    // Number of main store slots the background filter rebuild scans per write (and per tick by default).
+    static constexpr size_t FILTER_REBUILD_SLOTS_PER_STEP = 64;
+    // Most keys a single write evicts to get back under the memory budget.
+    static constexpr size_t MAX_EVICTIONS_PER_WRITE = 64;
+    // Most expired keys each write reclaims through the timing wheel (tick takes its own budget).
+    static constexpr size_t EXPIRED_KEYS_PER_STEP = 16;
+    // ttl() result for a key without a deadline.
+    static constexpr int64_t TTL_NO_EXPIRY = -1;
+    // ttl() result for a missing (or expired) key.
+    static constexpr int64_t TTL_MISSING = -2;
+    // Most main store entries metrics() measures probe lengths on.
+    static constexpr size_t METRICS_PROBE_SAMPLE = 1024;
+
 private:
-    // The primary key-value storage.
+    friend class KVSnapshot;
+
+    // A key's state as replaced by a write, kept while an open snapshot may still read it.
+    struct KeyVersion {
+        // Version of the write that replaced it (snapshots at earlier versions see this state).
+        uint64_t overwrittenAt;
+        // False if the key was absent.
+        bool present;
+        // Its value.
+        std::string value;
+        // Its deadline (0 if none).
+        uint64_t deadline;
+    };
+
+    // A key's replaced states, oldest first.
+    struct VersionChain {
+        // The states.
+        std::vector<KeyVersion> versions;
+        // Version of the key's latest write.
+        uint64_t lastWrite = 0;
+    };
+
+    // A key's state at some version, borrowed from the store or a version chain.
+    struct VersionedState {
+        // False if the key was absent.
+        bool present = false;
+        // Its value.
+        std::string_view value;
+        // Its deadline (0 if none).
+        uint64_t deadline = 0;
+    };
+
+    // Settings the store was built with (consulted again when the filter is rebuilt).
+    KVStoreConfig settings;
+    // Size-class slab arena packing each key and value into one record (declared first so it outlives mainStore).
+    SlabArena arena;
+    // The primary key-value storage; its slots point at records in arena.
     HashMap mainStore;
+    // Deadlines of the keys that have one (8-byte milliseconds since the Unix epoch), also in arena.
+    HashMap expires;
+    // Deadlines by time, so expired keys are reclaimed without waiting for an access.
+    TimingWheel expiryWheel;
+    // Keys removed because their deadline passed.
+    size_t expiredKeys;
     // Trie for prefix searches on keys.
     Trie keyTrie;
     // LRU Cache for frequently accessed items.
     LRUCache cache; // LRU cache for values
-    // Bloom Filter for fast "key not found" checks.
-    BloomFilter filter;
-
-    // Configuration for LRU cache capacity.
-    static const size_t DEFAULT_CACHE_CAPACITY = 100;
-    // Configuration for Bloom filter size.
-    static const size_t DEFAULT_BLOOM_FILTER_SIZE = 1000;
-    // Configuration for Bloom filter number of hash functions.
-    static const size_t DEFAULT_BLOOM_FILTER_HASHES = 3;
+    // Membership filter (Bloom or cuckoo) for fast "key not found" checks.
+    MembershipFilter filter;
+    // Replacement filter being filled from mainStore in the background (null when no rebuild is running).
+    std::unique_ptr<MembershipFilter> rebuildFilter;
+    // Next mainStore slot the rebuild scans.
+    size_t rebuildCursor;
+    // mainStore resize count when the current rebuild pass started (a resize moves slots, so the pass restarts).
+    uint64_t rebuildResizeCount;
+    // Number of keys the replacement filter is sized for.
+    size_t rebuildExpectedKeys;
+    // Keys added (true) or removed (false) since the rebuild started; the scan skips them and they are
+    // applied from here when the pass completes, so each key ends up in the new filter exactly once.
+    std::unordered_map<uint64_t, bool> rebuildTouched;
+    // Number of completed rebuilds.
+    size_t filterRebuilds;
+    // Logical clock advanced by every tracked access; LRU stamps hold its value, LFU stamps its decay period.
+    uint32_t accessClock;
+    // State of the generator behind eviction sampling and the LFU counter increments.
+    uint64_t evictionRng;
+    // Keys evicted so far.
+    size_t evictedKeys;
+    // Writes rejected because nothing could be evicted.
+    size_t rejectedWrites;
+    // Process writing a background snapshot (-1 when none is running).
+    pid_t backgroundSavePid;
+    // Last save result, time and load count.
+    SnapshotStats snapshotState;
+    // Write-ahead log (null when KVStoreConfig::appendLogPath is empty, while it is being replayed, and if a damaged log
+    // could not be moved aside and replaced).
+    std::unique_ptr<AppendLog> appendLog;
+    // Sequence number of the last record this store appended.
+    uint64_t appendLogSequence;
+    // Process writing a compacted log (-1 when no rewrite is running).
+    pid_t logRewritePid;
+    // Log size an automatic rewrite waits for after a failed one (0 normally).
+    size_t logRewriteFloor;
+    // Bytes from a damaged record found when the log was replayed (reported even if no log could be opened).
+    size_t damagedLogBytes;
+    // Version of the latest write; every set, remove, deadline change, expiry and eviction takes the next one.
+    uint64_t writeVersion;
+    // Versions of the open snapshots, with how many are open at each.
+    std::map<uint64_t, size_t> openSnapshots;
+    // Replaced states by key, in key order so snapshot scans can merge them with the Trie (empty without snapshots).
+    std::map<std::string, VersionChain, std::less<>> versionChains;
+    // Number of states in versionChains.
+    size_t keptVersions;
+    // Bytes of keys and values held by versionChains.
+    size_t versionBytes;
+    // States dropped once no snapshot could read them.
+    uint64_t collectedVersions;
+    // Per-thread latency histograms and event counters (no-ops without KV_STORE_METRICS); const lookups record too.
+    mutable StoreMetrics instrumentation;
 
+    // Starts a background rebuild sized for the current number of keys.
+    void startFilterRebuild();
+    // Restarts the current rebuild pass from the first slot.
+    void restartFilterRebuild();
+    // Advances a rebuild in progress (or starts one if the filter needs it) by up to maxSlots slots.
+    void filterMaintenanceStep(size_t maxSlots);
+    // Returns the next pseudo-random number for eviction.
+    uint64_t nextRandom();
+    // Updates a key's access stamp for the LRU or LFU policy (no-op without a budget or for other policies).
+    void recordAccess(std::string_view key, uint64_t hashCode);
+    // Evicts one key chosen by the policy from a sample; returns false if there was no candidate.
+    bool evictOne();
+    // Returns the current time in milliseconds since the Unix epoch.
+    uint64_t now() const;
+    // Returns a key's deadline, or std::nullopt if it has none.
+    std::optional<uint64_t> deadlineOf(std::string_view key, uint64_t hashCode) const;
+    // Returns true if the key has a deadline at or before now.
+    bool isExpired(std::string_view key, uint64_t hashCode, uint64_t now) const;
+    // Gives an existing key a deadline and schedules it on the timing wheel.
+    void setDeadline(std::string_view key, uint64_t hashCode, uint64_t deadline);
+    // Removes the key if its deadline passed; returns true if it did.
+    bool expireIfDue(std::string_view key, uint64_t hashCode);
+    // Same as expireIfDue, judged against currentTime instead of reading the clock.
+    bool expireIfDue(std::string_view key, uint64_t hashCode, uint64_t currentTime);
+    // Reclaims up to maxKeys keys whose timers are due.
+    void expiryStep(size_t maxKeys);
+    // Removes a key from every structure (no expiry check); returns false if it was not in the main store.
+    bool deleteKey(std::string_view key, uint64_t hashCode);
+    // Evicts keys until incomingBytes more fit the budget (or MAX_EVICTIONS_PER_WRITE keys are gone);
+    // returns false if the write must be rejected.
+    bool makeRoom(size_t incomingBytes);
+    // Writes every key live at version as of time, in key order, and the deadlines of those that have one to a
+    // snapshot file.
+    bool writeSnapshot(const std::string& path, uint64_t version, uint64_t time) const;
+    // Gives the write about to change a key its version and, if an open snapshot can still see the key's current
+    // state, copies that state into the key's version chain first.
+    void preserveVersion(std::string_view key, uint64_t hashCode);
+    // Returns a key's state at version.
+    VersionedState stateAt(std::string_view key, uint64_t hashCode, uint64_t version) const;
+    // Visits the keys in [start, end) (no end: unbounded) live at version as of time, ascending or descending, with
+    // their values and deadlines, until visit returns false.
+    void visitVersion(uint64_t version, uint64_t time, std::string_view start, std::optional<std::string_view> end, bool reverse,
+                      const std::function<bool(std::string_view key, std::string_view value, uint64_t deadline)>& visit) const;
+    // Closes a snapshot at version and drops the states no open snapshot can read any more.
+    void releaseSnapshot(uint64_t version);
+    // Collects the result of a finished background save; with wait set, blocks until it finishes.
+    void collectBackgroundSave(bool wait);
+    // Looks up a key through the filter, cache and main store (getView and multiGet wrap it). Deadlines are judged
+    // against batchTime when given (multiGet reads the clock once for all its keys), otherwise against the clock.
+    std::optional<std::string_view> lookup(std::string_view key, uint64_t hashCode, std::optional<uint64_t> batchTime);
+    // Sets a key-value pair and logs it, without waiting for the log (set and multiSet wrap it).
+    bool writeValue(std::string_view key, std::string_view value, uint64_t hashCode);
+    // Appends a record to the append log, if there is one.
+    void logWrite(const LogRecord& record);
+    // Ends a public write: makes its records durable (unless deferred) and starts a log rewrite once due.
+    void commitWrite();
+    // Collects a finished log rewrite, or starts one once the log outgrew the live data.
+    void appendLogMaintenance();
+    // Applies one record while replaying the append log. Keys whose logged deadline already passed are collected in
+    // lapsed rather than dropped, since a later record may still overwrite the key or remove the deadline.
+    void applyLogRecord(const LogRecord& record, std::unordered_set<std::string>& lapsed);
+    // Writes one Set (and, for keys with a deadline, one ExpireAt) record per key live at currentTime to a fresh log
+    // file.
+    bool writeCompactedLog(const std::string& path, uint64_t currentTime) const;
+    // Returns the file a rewrite child writes (named after this process, so the parent can name it before forking).
+    std::string logRewritePath() const;
+    // Collects the result of a finished log rewrite and switches the log over; with wait set, blocks until it finishes.
+    void collectLogRewrite(bool wait);
 
 public:
     // Constructor: initializes all underlying data structures.
     KVStore(size_t hashMapCapacity = 101,
-            size_t cacheCapacity = DEFAULT_CACHE_CAPACITY,
-            size_t bloomFilterSize = DEFAULT_BLOOM_FILTER_SIZE,
-            size_t bloomFilterNumHashes = DEFAULT_BLOOM_FILTER_HASHES);
+            size_t cacheCapacity = KVStoreConfig::DEFAULT_CACHE_CAPACITY,
+            size_t bloomFilterSize = KVStoreConfig::DEFAULT_BLOOM_FILTER_SIZE,
+            size_t bloomFilterNumHashes = KVStoreConfig::DEFAULT_BLOOM_FILTER_HASHES);
+    // Constructor: initializes all underlying data structures from a full configuration and replays the append log, if
+    // any. A torn last record is cut off; a damaged record with more after it stops the replay there, and the log is
+    // renamed to "<appendLogPath>.damaged.<ms>" and replaced by one holding what was replayed (appendLogStats reports
+    // damagedBytes; if the rename or rewrite fails, the store runs without a log).
+    explicit KVStore(const KVStoreConfig& config);
+    // Destructor: waits for a background save or log rewrite still writing, then flushes the append log.
+    ~KVStore();
 
-    // Sets (inserts or updates) a key-value pair in the store.
-    void set(const std::string& key, const std::string& value);
+    // Sets (inserts or updates) a key-value pair in the store, clearing any deadline the key had.
+    // Returns false if the write was rejected because the memory budget is reached and the eviction
+    // policy could not free room.
+    bool set(const std::string& key, const std::string& value);
+    // Same as set, with a precomputed Utils::hash64 of the key shared by every structure.
+    bool set(std::string_view key, std::string_view value, uint64_t hashCode);
+    // Same as set, and the key expires ttlMillis milliseconds from now (SET key value EX/PX).
+    bool setWithTtl(const std::string& key, const std::string& value, uint64_t ttlMillis);
+    // Gives an existing key a deadline ttlMillis from now, replacing any previous one. Returns false if the key is missing.
+    bool expire(const std::string& key, uint64_t ttlMillis);
+    // Removes a key's deadline. Returns false if the key is missing or had none.
+    bool persist(const std::string& key);
+    // Returns the milliseconds left before a key expires, TTL_NO_EXPIRY if it has no deadline, or TTL_MISSING.
+    int64_t ttl(const std::string& key);
     // Gets the value associated with a key.
     // Checks cache first, then main store. Updates LRU and access history.
     std::string get(const std::string& key);
-    // Deletes a key from the store, cache, trie, and potentially bloom filter (conceptually, BF doesn't support true delete).
+    // Looks up a key without copying it or its value; std::nullopt means the key is absent
+    // (an empty view is a present key with an empty value). The view borrows the stored value
+    // and is only valid until the next call on this store.
+    std::optional<std::string_view> getView(std::string_view key);
+    // Same as getView, with a precomputed Utils::hash64 of the key.
+    std::optional<std::string_view> getView(std::string_view key, uint64_t hashCode);
+    // Looks up several keys at once, returning one result per key in order (std::nullopt for absent keys).
+    // Keys are taken in batches of KVStoreConfig::multiKeyBatch: every key of a batch is hashed and its filter
+    // block and first table group prefetched before any is looked up, so their cache misses overlap.
+    // The views borrow stored values and stay valid until the next write to the store: every key is judged against
+    // one reading of the clock, so a key that expires is absent from every position it is asked for, and removing
+    // it cannot free a record an earlier view points at.
+    std::vector<std::optional<std::string_view>> multiGet(const std::vector<std::string>& keys);
+    // Sets several key-value pairs in order, batched and prefetched like multiGet (MSET). Returns false if
+    // the memory budget rejected any write; the other pairs are still written.
+    bool multiSet(const std::vector<std::pair<std::string, std::string>>& pairs);
+    // Looks up a key through the membership filter and main store only, without touching the cache
+    // or advancing a HashMap resize; concurrent const calls on one store are safe.
+    std::optional<std::string_view> peek(std::string_view key) const;
+    // Same as peek, with a precomputed Utils::hash64 of the key.
+    std::optional<std::string_view> peek(std::string_view key, uint64_t hashCode) const;
+    // Deletes a key from the store, cache, trie, and (in cuckoo mode) the membership filter.
     bool remove(const std::string& key);
-    // Retrieves all keys starting with the given prefix.
-    std::vector<std::string> prefixSearch(const std::string& prefix);
-    // Checks if a key might exist using the Bloom Filter.
-    bool mightContain(const std::string& key);
+    // Same as remove, with a precomputed Utils::hash64 of the key.
+    bool remove(std::string_view key, uint64_t hashCode);
+    // Retrieves all keys starting with the given prefix. Keys past their deadline are left out even
+    // before they are reclaimed (as are they from paged prefix searches and range scans).
+    std::vector<std::string> prefixSearch(const std::string& prefix) const;
+    // Returns up to limit keys starting with prefix, resuming from cursor (Trie::CURSOR_START for the
+    // first page); std::nullopt if the cursor is malformed.
+    std::optional<PrefixPage> prefixSearch(const std::string& prefix, size_t limit, const std::string& cursor) const;
+    // Opens a point-in-time view of the store (see KVSnapshot). Cheap: it records the current version, and writes
+    // only start copying overwritten states while it is open.
+    KVSnapshot snapshot();
+    // Returns a lazy iterator over the keys starting with prefix (invalidated by any write to the store).
+    // It reads the Trie directly, so it can still return a key whose deadline passed moments ago.
+    Trie::KeyIterator scanPrefix(std::string_view prefix) const;
+    // Returns up to limit key-value pairs with keys in [start, end) (no end: every key from start on),
+    // in ascending key order, or descending when reverse is set.
+    std::vector<std::pair<std::string, std::string>> scanRange(const std::string& start, const std::optional<std::string>& end,
+                                                               size_t limit, bool reverse = false) const;
+    // Checks if a key might exist using the membership filter.
+    bool mightContain(std::string_view key) const;
+    // Performs up to maxSlots slots of background work: the membership filter rebuild, reclaiming up to
+    // maxSlots expired keys, collecting a finished background save or log rewrite, and starting a log rewrite once due.
+    // Writes already do a bounded share; idle callers can drive it from here.
+    // Returns true while work remains.
+    bool tick(size_t maxSlots = FILTER_REBUILD_SLOTS_PER_STEP);
+    // Writes a point-in-time snapshot of every live key and deadline to path, replacing any previous file only once
+    // the new one is complete and synced (SAVE). Returns false on an I/O error.
+    bool save(const std::string& path);
+    // Same as save, but writes the store as view sees it, so the file reflects the moment the snapshot was taken
+    // however the store was written since (view must be a valid snapshot of this store).
+    bool save(const std::string& path, const KVSnapshot& view);
+    // Starts writing a snapshot of the store as it is now from a forked child process, which sees the parent's memory
+    // copy-on-write, and returns at once (BGSAVE). Returns false if a background save is already running or the fork
+    // failed. tick() collects the result; see snapshotStats. The child runs only the calling thread's copy, so it takes
+    // no lock (the append log is paused across the fork) and only allocates, which needs a C library whose malloc
+    // survives fork in a threaded process, as glibc's does.
+    bool backgroundSave(const std::string& path);
+    // Blocks until a running background save finishes and returns whether it succeeded (true if none was running).
+    bool waitForBackgroundSave();
+    // Loads a snapshot into an empty store: the main store is sized for every key and filled without lookups, the
+    // filter is rebuilt for the key count, keys enter the Trie in sorted order, and keys whose deadline has passed
+    // are dropped. The memory budget is not enforced while loading. With an append log, a rewrite is started so the
+    // log covers the loaded keys. Returns false, leaving the store unchanged, if the store is not empty, a snapshot is
+    // open, or the file is missing or fails validation.
+    bool load(const std::string& path);
+    // Returns whether a background save is running, the last save's result and time, and the last load's key count.
+    SnapshotStats snapshotStats() const;
+    // Starts rebuilding the append log from the store's current contents in a forked child, while writes keep going to
+    // the old log and to a buffer that is appended to the new one before it replaces the old (BGREWRITEAOF). Runs on its
+    // own once the log outgrows KVStoreConfig::appendLogRewriteFactor. Returns false without a log, if a rewrite is
+    // already running, or if the fork failed; tick() (or the next write) switches to the new log. Forks under the same
+    // constraints as backgroundSave.
+    bool rewriteAppendLog();
+    // Blocks until a running log rewrite finishes and returns whether the log was replaced (true if none was running).
+    bool waitForAppendLogRewrite();
+    // Returns the sequence number of the store's last logged write, for syncAppendLog.
+    uint64_t lastAppendLogSequence() const;
+    // Returns once every logged write up to sequence is on disk (AppendFsync::Always; otherwise a no-op). Unlike the
+    // other members it only touches the thread-safe log, so a caller serializing the store with a lock can release it
+    // first and let concurrent writers share the fdatasync.
+    void syncAppendLog(uint64_t sequence);
+    // Returns the append log's policy, size, write and sync counts, rewrites and what startup replayed.
+    AppendLogStats appendLogStats() const;
+    // Returns the membership filter's mode, size, estimated false-positive rate and rebuild count.
+    FilterStats filterStats() const;
+    // Returns the number of keys in the store (including expired keys not yet reclaimed).
+    size_t size() const;
+    // Returns the record arena's usage and fragmentation figures.
+    ArenaStats memoryStats() const;
+    // Returns the bytes counted against the memory budget: main store tables and records, trie nodes,
+    // cache entries and membership filter(s).
+    size_t memoryUsage() const;
+    // Returns the memory budget, usage and eviction counters.
+    EvictionStats evictionStats() const;
+    // Returns the number of keys with a deadline, pending timers and expired keys.
+    ExpiryStats expiryStats() const;
+    // Returns the open snapshots and the overwritten states kept for them.
+    VersionStats versionStats() const;
+    // Returns the latency histogram of each operation, the cache and filter counters (both zero and marked disabled
+    // without KV_STORE_METRICS), main store probe lengths sampled from up to METRICS_PROBE_SAMPLE entries, and the
+    // trie's node count. Safe alongside the const lookups of other threads (ShardedKVStore reads under a shared lock).
+    MetricsSnapshot metrics() const;
 };
 
 #endif // KV_STORE_HPP
\ No newline at end of file
@@ -1,44 +1,162 @@
 #ifndef LRU_CACHE_HPP
 #define LRU_CACHE_HPP
 
+#include "frequency_sketch.hpp"
 #include <string>
+#include <string_view> // For heterogeneous lookup
+#include <optional> // For borrowed lookup results
 #include <list>
+#include <deque> // For the S3-FIFO ghost queue
 #include <unordered_map> // For O(1) lookup of list iterators
+#include <unordered_set> // For S3-FIFO ghost membership
 #include <utility> // For std::pair
+#include <cstdint> // For uint64_t
 
-// Implements an LRU (Least Recently Used) Cache.
+// Replacement (and admission) policy of an LRUCache.
+enum class CachePolicy {
+    // Least recently used: every access moves the entry to the front; every new key is admitted.
+    LRU,
+    // W-TinyLFU: a small LRU window admits new keys, and a key leaving the window only displaces
+    // an entry of the main segmented LRU if a count-min sketch says it is accessed more often.
+    // One-off scans never build up frequency, so they cannot flush the hot set.
+    WTinyLFU,
+    // S3-FIFO: new keys enter a small FIFO queue and are dropped (remembered only in a ghost queue)
+    // unless hit again before they reach its end; the main FIFO gives hit entries another lap
+    // (CLOCK-style). Hits only bump a counter, so reads never relink list nodes.
+    S3FIFO
+};
+
+// Who owns the bytes of cached keys and values.
+enum class CacheStorage {
+    // The cache keeps its own copy of every key and value (one allocation per entry, if any).
+    Owned,
+    // The cache copies each key (entries are looked up by it) but only keeps a view of each value: the
+    // caller owns the value bytes and must update (put) or remove the entry before they move or are freed.
+    // KVStore uses this to index records owned by its main store, so each value is resident once.
+    Borrowed
+};
+
+// Implements an LRU (Least Recently Used) Cache, with W-TinyLFU and S3-FIFO as alternative policies.
 class LRUCache {
 private:
     // Represents a node in the doubly linked list, storing key-value.
     struct CacheNode {
-        // Key of the cached item.
-        std::string key;
-        // Value of the cached item.
-        std::string value;
+        // Key of the cached item (a view of owned).
+        std::string_view key;
+        // Value of the cached item (a view of owned, or of the caller's bytes in Borrowed mode).
+        std::string_view value;
+        // The key bytes, followed by the value bytes in Owned mode.
+        std::string owned;
+        // Utils::hash64 of the key, kept so eviction can find the map entry without rehashing.
+        uint64_t hashCode;
+        // Queue the node is on.
+        uint8_t queue;
+        // S3-FIFO: hits since the node was queued or last given another lap (saturates at S3_MAX_FREQUENCY).
+        uint8_t frequency;
+    };
+    // Node list type shared by every queue (nodes move between queues by splicing, which keeps iterators valid).
+    using NodeList = std::list<CacheNode>;
+
+    // Map key: a view of the node's key plus its precomputed hash.
+    struct HashedKey {
+        // View of the key bytes.
+        std::string_view key;
+        // Utils::hash64 of the key.
+        uint64_t hashCode;
+        // Keys are equal when their bytes are (the hash is only a shortcut).
+        bool operator==(const HashedKey& other) const { return hashCode == other.hashCode && key == other.key; }
+    };
+    // Hasher that returns the precomputed hash instead of hashing the key again.
+    struct HashedKeyHash {
+        // Reuse the stored hash.
+        size_t operator()(const HashedKey& hashedKey) const { return static_cast<size_t>(hashedKey.hashCode); }
     };
 
+    // Queue indexes. LRU keeps everything on RECENCY (most recent at front); W-TinyLFU uses WINDOW,
+    // PROBATION and PROTECTED; S3-FIFO uses SMALL and MAIN (newest at front, evicted from the back).
+    static constexpr uint8_t RECENCY = 0, WINDOW = 0, PROBATION = 1, PROTECTED = 2, SMALL = 0, MAIN = 1;
+    // Number of queues.
+    static constexpr size_t NUM_QUEUES = 3;
+    // S3-FIFO frequency counters saturate here.
+    static constexpr uint8_t S3_MAX_FREQUENCY = 3;
+
     // Maximum number of items the cache can hold.
     size_t capacity;
-    // Doubly linked list to store cache items by recency. Most recent at front.
-    std::list<CacheNode> dll;
-    // Unordered map to store key to list iterator for O(1) access to list nodes.
-    std::unordered_map<std::string, std::list<CacheNode>::iterator> map;
+    // Replacement policy.
+    CachePolicy policy;
+    // Whether entries copy or borrow their bytes.
+    CacheStorage storage;
+    // Node queues (see the queue indexes above).
+    NodeList queues[NUM_QUEUES];
+    // Unordered map from key to list iterator for O(1) access to list nodes.
+    // Keys are views of the key stored in the list node (list nodes never move), so lookups
+    // by std::string_view need no temporary string and each key is stored once. The bucket
+    // comes from the caller's precomputed hash, so the cache never hashes a key itself.
+    std::unordered_map<HashedKey, NodeList::iterator, HashedKeyHash> map;
+    // W-TinyLFU: capacity of the admission window.
+    size_t windowCapacity;
+    // W-TinyLFU: capacity of the protected segment. S3-FIFO: capacity of the small queue.
+    size_t segmentCapacity;
+    // W-TinyLFU: access frequencies used to admit keys leaving the window (empty for other policies).
+    FrequencySketch sketch;
+    // S3-FIFO: hashes of keys recently dropped from the small queue, oldest first.
+    std::deque<uint64_t> ghostQueue;
+    // S3-FIFO: the same hashes, for membership tests.
+    std::unordered_set<uint64_t> ghostSet;
+    // Sum of entryBytes over the cached entries.
+    size_t cachedBytes;
+
+    // Returns the bytes one entry costs: its list node, its map node and its owned bytes.
+    static size_t entryBytes(const CacheNode& node);
+    // Points an entry at a key and value, copying the value too in Owned mode (newEntry: the key is not copied yet).
+    void store(CacheNode& node, std::string_view key, std::string_view value, bool newEntry);
+
+    // Records a hit on an entry according to the policy.
+    void touch(NodeList::iterator node);
+    // Removes an entry from its queue and the map.
+    void erase(NodeList::iterator node);
+    // Moves an entry to the front of a queue.
+    void moveTo(NodeList::iterator node, uint8_t queue);
+    // W-TinyLFU: moves the window's oldest entry into the main segments if it beats their eviction victim.
+    void admitFromWindow();
+    // S3-FIFO: evicts one entry, from the small queue if it is over its share, otherwise from the main queue.
+    void evictS3();
+    // S3-FIFO: remembers a dropped key's hash in the ghost queue.
+    void addGhost(uint64_t hashCode);
 
 public:
-    // Constructor: initializes the LRU cache with a given capacity.
-    explicit LRUCache(size_t cap);
+    // Constructor: initializes the cache with a given capacity, replacement policy and storage mode.
+    explicit LRUCache(size_t cap, CachePolicy cachePolicy = CachePolicy::LRU, CacheStorage cacheStorage = CacheStorage::Owned);
 
     // Retrieves the value associated with a key. Updates its recency.
     std::string get(const std::string& key);
+    // Looks up a key without copying it or its value. Updates its recency.
+    // The view borrows the cached value and stays valid until the entry is updated, evicted or removed
+    // (in Borrowed mode it is the caller's own bytes).
+    std::optional<std::string_view> find(std::string_view key);
+    // Same as find, with a precomputed Utils::hash64 of the key.
+    std::optional<std::string_view> find(std::string_view key, uint64_t hashCode);
     // Inserts or updates a key-value pair. Updates its recency.
-    // If capacity is exceeded, evicts the least recently used item.
-    void put(const std::string& key, const std::string& value);
+    // If capacity is exceeded, evicts an item chosen by the policy (the least recently used one for LRU).
+    // In Borrowed mode key and value must stay valid until the key is put again or removed.
+    void put(std::string_view key, std::string_view value);
+    // Same as put, with a precomputed Utils::hash64 of the key.
+    void put(std::string_view key, std::string_view value, uint64_t hashCode);
     // Checks if a key exists in the cache.
-    bool contains(const std::string& key);
+    bool contains(std::string_view key);
+    // Same as contains, with a precomputed Utils::hash64 of the key.
+    bool contains(std::string_view key, uint64_t hashCode);
     // Removes a key from the cache.
     bool remove(const std::string& key);
+    // Same as remove, with a precomputed Utils::hash64 of the key.
+    bool remove(std::string_view key, uint64_t hashCode);
     // Returns the current size of the cache.
     size_t size() const;
+    // Returns the replacement policy.
+    CachePolicy cachePolicy() const;
+    // Returns the bytes held by the cache: its entries, the map's bucket array, the frequency sketch
+    // and the ghost queue.
+    size_t memoryUsage() const;
 };
 
-#endif // LRU_CACHE_HPP
\ No newline at end of file
+#endif // LRU_CACHE_HPP
@@ -0,0 +1,60 @@
+#ifndef MEMBERSHIP_FILTER_HPP
+#define MEMBERSHIP_FILTER_HPP
+
+#include "bloom_filter.hpp"
+#include "cuckoo_filter.hpp"
+#include <cstdint> // For uint64_t
+#include <cstddef> // For size_t
+
+// Which structure KVStore uses to answer "definitely absent" quickly.
+enum class FilterMode {
+    // Blocked Bloom filter: smallest and fastest, but deletes leave their bits set.
+    Bloom,
+    // Cuckoo filter: supports deletion, so churn does not saturate it.
+    Cuckoo
+};
+
+// Membership filter in front of KVStore's main store: either a BloomFilter or a CuckooFilter,
+// plus the bookkeeping to tell when it has drifted past its rebuild threshold.
+// A Bloom filter cannot forget deleted keys, so it counts every insert since it was built and
+// estimates its false-positive rate from that; a cuckoo filter reports its own load.
+class MembershipFilter {
+private:
+    // Structure in use.
+    FilterMode filterMode;
+    // Bloom filter (empty in cuckoo mode).
+    BloomFilter bloom;
+    // Cuckoo filter (minimal in Bloom mode).
+    CuckooFilter cuckoo;
+    // Bloom mode: keys added since the filter was built (deleted keys are never subtracted).
+    size_t insertions;
+    // Bloom mode: insert count past which the estimated false-positive rate exceeds the rebuild threshold.
+    size_t rebuildAtInsertions;
+    // False-positive rate past which the filter asks to be rebuilt (0 disables rebuilds).
+    double rebuildFpr;
+
+public:
+    // Constructor: builds a filter of the given mode for expectedKeys keys at targetFpr.
+    // In Bloom mode a non-zero bloomBits / bloomHashes overrides the derived size / bits per key.
+    MembershipFilter(FilterMode mode, size_t expectedKeys, double targetFpr, double rebuildThresholdFpr,
+                     size_t bloomBits = 0, size_t bloomHashes = 0);
+
+    // Adds a key given its Utils::hash64. Returns false if a cuckoo filter overflowed.
+    bool add(uint64_t hashCode);
+    // Removes a key given its Utils::hash64 (a no-op in Bloom mode). The key must have been added.
+    bool remove(uint64_t hashCode);
+    // Checks if a key might exist given its Utils::hash64.
+    bool possiblyContains(uint64_t hashCode) const;
+    // Starts loading the filter memory a key hash maps to into cache ahead of a lookup (a hint only).
+    void prefetch(uint64_t hashCode) const;
+    // Returns the structure in use.
+    FilterMode mode() const;
+    // Returns the expected false-positive rate given everything added (and, for cuckoo, removed) so far.
+    double estimatedFalsePositiveRate() const;
+    // Returns true once the filter has drifted past its rebuild threshold or a cuckoo filter is full.
+    bool needsRebuild() const;
+    // Returns the number of bytes used by the filter's bits or buckets.
+    size_t sizeBytes() const;
+};
+
+#endif // MEMBERSHIP_FILTER_HPP
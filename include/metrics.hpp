@@ -0,0 +1,333 @@
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <string>
+#include <vector>
+#include <atomic> // For the per-thread cells
+#include <memory> // For std::unique_ptr
+#include <chrono> // For the fallback clock
+#include <cstdint> // For counts and ticks
+#include <cstddef> // For size_t
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // For __rdtsc
+#endif
+
+// Operations KVStore times, each into a latency histogram of its own.
+enum class MetricOp : uint8_t {
+    // get, getView and peek (GET, EXISTS).
+    Get,
+    // set and setWithTtl (SET).
+    Set,
+    // remove (DEL).
+    Remove,
+    // multiGet (MGET).
+    MultiGet,
+    // multiSet (MSET).
+    MultiSet,
+    // expire, persist and ttl (EXPIRE, PERSIST, TTL).
+    Expire,
+    // Both prefixSearch overloads (PREFIX).
+    PrefixSearch,
+    // scanRange (SCANRANGE).
+    ScanRange
+};
+
+// Number of MetricOp values.
+constexpr size_t METRIC_OP_COUNT = 8;
+
+// Events KVStore counts.
+enum class MetricCounter : uint8_t {
+    // Lookups answered by the LRU cache.
+    CacheHits,
+    // Lookups that passed the filter but missed the cache.
+    CacheMisses,
+    // Lookups the membership filter ruled out.
+    FilterNegatives,
+    // Lookups the membership filter let through for a key the main store does not hold.
+    FilterFalsePositives
+};
+
+// Number of MetricCounter values.
+constexpr size_t METRIC_COUNTER_COUNT = 4;
+
+// One operation in this many on a thread is timed (counted across every store the thread uses); calls and events
+// are counted exactly.
+constexpr uint32_t METRIC_SAMPLE_PERIOD = 64;
+
+// Returns the lower-case name of an operation ("get", "set", ...).
+const char* metricOpName(MetricOp op);
+
+// Log-linear latency histogram in the HdrHistogram layout: values below SUB_BUCKETS get a bucket each, and every
+// power of two above is split into SUB_BUCKETS equal buckets, so a bucket spans at most 1/SUB_BUCKETS of its values
+// (6.25%) over a range of 1 ns to 2^MAX_EXPONENT ns (about 18 minutes) in a few KiB. Not thread-safe; StoreMetrics
+// keeps one set per thread and merges them into these.
+class LatencyHistogram {
+public:
+    // log2 of the buckets per power of two.
+    static constexpr unsigned SUB_BUCKET_BITS = 4;
+    // Buckets per power of two.
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    // Values of 2^MAX_EXPONENT and more share the last bucket.
+    static constexpr unsigned MAX_EXPONENT = 40;
+    // Number of buckets.
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Returns the bucket of a value: a leading-zero count, a shift and an add.
+    static size_t bucketOf(uint64_t value) {
+        // Small values are exact.
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        // Power of two the value falls in.
+        unsigned exponent = 63 - static_cast<unsigned>(__builtin_clzll(value));
+        // Past the range: the last bucket.
+        if (exponent >= MAX_EXPONENT) return BUCKET_COUNT - 1;
+        // Its tier, then the top SUB_BUCKET_BITS bits below the leading one.
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + static_cast<size_t>((value >> (exponent - SUB_BUCKET_BITS)) - SUB_BUCKETS);
+    }
+    // Returns the smallest value of a bucket.
+    static uint64_t bucketLow(size_t bucket);
+    // Returns the largest value of a bucket.
+    static uint64_t bucketHigh(size_t bucket);
+
+private:
+    // Values recorded per bucket.
+    std::vector<uint64_t> buckets;
+    // Values recorded.
+    uint64_t total;
+    // Largest value recorded.
+    uint64_t largest;
+
+public:
+    // Constructor: an empty histogram.
+    LatencyHistogram();
+
+    // Records count occurrences of value (in nanoseconds).
+    void record(uint64_t value, uint64_t count = 1);
+    // Adds every value recorded in other.
+    void merge(const LatencyHistogram& other);
+    // Returns the number of values recorded.
+    uint64_t count() const;
+    // Returns the value below or at which fraction (0 to 1) of the recorded values lie: the largest value of the
+    // bucket holding that rank, capped at the maximum (0 when empty).
+    uint64_t percentile(double fraction) const;
+    // Returns the largest value recorded (0 when empty).
+    uint64_t max() const;
+    // Returns the number of values recorded in a bucket.
+    uint64_t bucketCount(size_t bucket) const;
+};
+
+// What KVStore::metrics reports: latency per operation, event counters, and figures read off the structures.
+struct MetricsSnapshot {
+    // False when the library was built without KV_STORE_METRICS (the latencies and counters are then all zero).
+    bool enabled = false;
+    // Calls of each operation, indexed by MetricOp (exact).
+    std::vector<uint64_t> calls = std::vector<uint64_t>(METRIC_OP_COUNT, 0);
+    // Latency of each operation in nanoseconds, indexed by MetricOp, over the sampled calls (METRIC_SAMPLE_PERIOD).
+    std::vector<LatencyHistogram> latency = std::vector<LatencyHistogram>(METRIC_OP_COUNT);
+    // Lookups answered by the LRU cache.
+    uint64_t cacheHits = 0;
+    // Lookups that passed the filter but missed the cache.
+    uint64_t cacheMisses = 0;
+    // Lookups the membership filter ruled out.
+    uint64_t filterNegatives = 0;
+    // Lookups the filter let through for a key the main store does not hold.
+    uint64_t filterFalsePositives = 0;
+    // Main store entries the probe figures were measured on (see HashMap::probeStats).
+    size_t probeSamples = 0;
+    // Mean groups a lookup of a sampled entry probes.
+    double meanProbeLength = 0.0;
+    // Most groups a lookup of a sampled entry probes.
+    size_t maxProbeLength = 0;
+    // Trie nodes (inner nodes plus one leaf per key).
+    size_t trieNodes = 0;
+    // Keys in the store.
+    size_t keys = 0;
+
+    // Adds the figures of another store (ShardedKVStore::metrics), weighting the probe means by their samples.
+    void merge(const MetricsSnapshot& other);
+};
+
+// Formats a snapshot as INFO text: "# Section" headers followed by "field:value" lines ending in CRLF, with one
+// "latency_<op>:calls=..,sampled=..,p50_ns=..,p99_ns=..,p999_ns=..,max_ns=.." line per operation called at least
+// once (the percentiles and maximum are over the sampled calls).
+// section is "stats", "latency" or empty for both.
+std::string formatMetrics(const MetricsSnapshot& metrics, const std::string& section = std::string());
+
+#ifdef KV_STORE_METRICS
+
+// Per-store instrumentation: an exact call count per MetricOp, the MetricCounter counts, and a latency histogram per
+// MetricOp fed by one operation in METRIC_SAMPLE_PERIOD on each thread. Reading the clock twice costs more than the
+// rest of a cached GET's bookkeeping, so it is only paid on the sampled operations. Each thread keeps
+// its own block (allocated the first time it records on the store and indexed by Utils::threadIndex) whose cells
+// only that thread stores to, with plain relaxed loads and stores rather than atomic read-modify-writes, and finds it
+// through a one-entry thread-local cache; collect() sums every block with relaxed loads while threads keep recording.
+// Threads past MAX_THREADS share one overflow block, updated with atomic adds so none of their counts are lost.
+// Durations are counted in ticks of the cheapest clock available (the time-stamp counter on x86, assumed invariant;
+// steady_clock elsewhere) and converted to nanoseconds once per collect.
+class StoreMetrics {
+public:
+    // Threads with a block of their own; the rest share the overflow block.
+    static constexpr size_t MAX_THREADS = 512;
+
+private:
+    // One thread's cells (or, for the overflow block, several threads').
+    struct ThreadBlock {
+        // Histogram buckets in ticks, per MetricOp (sampled operations only).
+        std::atomic<uint64_t> buckets[METRIC_OP_COUNT][LatencyHistogram::BUCKET_COUNT];
+        // Longest sampled duration in ticks, per MetricOp.
+        std::atomic<uint64_t> largest[METRIC_OP_COUNT];
+        // Calls, per MetricOp.
+        std::atomic<uint64_t> calls[METRIC_OP_COUNT];
+        // Event counts, per MetricCounter.
+        std::atomic<uint64_t> counters[METRIC_COUNTER_COUNT];
+        // True for the overflow block, which several threads update.
+        bool shared = false;
+    };
+
+    // What a thread remembers between operations: the block it used last and its sampling countdown.
+    struct LocalCache {
+        // Id of the StoreMetrics the block belongs to (0: none yet).
+        uint64_t owner;
+        // That store's block for this thread.
+        ThreadBlock* block;
+        // Operations left before the next timed one.
+        uint32_t countdown;
+    };
+
+    // This thread's cache (plain data, so reaching it needs no initialization guard).
+    static inline thread_local LocalCache cache{};
+
+    // Identifies this instance in the caches (never reused, unlike its address).
+    uint64_t id;
+    // Block of each thread index (null until that thread records); the last is the overflow block.
+    std::unique_ptr<std::atomic<ThreadBlock*>[]> blocks;
+
+    // Adds amount to a cell of block.
+    static void bump(ThreadBlock& block, std::atomic<uint64_t>& cell, uint64_t amount) {
+        // Threads sharing the overflow block need a real add.
+        if (block.shared) cell.fetch_add(amount, std::memory_order_relaxed);
+        // Only this thread stores to it: load and store, both relaxed (no lock prefix); readers see some recent value.
+        else cell.store(cell.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+    // Returns the calling thread's block.
+    ThreadBlock& local() {
+        // Same store as this thread's last call (every call but the first, unless it alternates between stores).
+        if (cache.owner == id) return *cache.block;
+        // Look it up (allocating on the first call) and remember it.
+        return remember();
+    }
+    // Finds (or allocates) the calling thread's block and stores it in the thread's cache.
+    ThreadBlock& remember();
+    // Allocates and publishes the block of a thread index.
+    ThreadBlock& allocate(size_t index);
+    // Adds a sampled duration to block.
+    static void sample(ThreadBlock& block, MetricOp op, uint64_t elapsed);
+    // Returns the nanoseconds per tick, measured against steady_clock since the process started.
+    static double nanosPerTick();
+
+public:
+    // Constructor: no blocks yet.
+    StoreMetrics();
+    // Destructor: frees every block.
+    ~StoreMetrics();
+    // Owns its blocks, so it cannot be copied.
+    StoreMetrics(const StoreMetrics&) = delete;
+    // Owns its blocks, so it cannot be copied.
+    StoreMetrics& operator=(const StoreMetrics&) = delete;
+
+    // Returns the current time in ticks.
+    static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+        // About 20 cycles, without a system call or a serializing instruction.
+        return __rdtsc();
+#else
+        // vDSO clock read.
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+    // Returns the start time in ticks if the calling thread's next operation is one to time, otherwise 0.
+    static uint64_t sampleStart() {
+        // Not this one.
+        if (cache.countdown != 0) {
+            // One closer.
+            --cache.countdown;
+            // Untimed.
+            return 0;
+        }
+        // Time this one and skip the next METRIC_SAMPLE_PERIOD - 1.
+        cache.countdown = METRIC_SAMPLE_PERIOD - 1;
+        // Start the clock.
+        return ticks();
+    }
+    // Counts one call of op and, if start is not 0 (see sampleStart), records its duration up to now.
+    void finish(MetricOp op, uint64_t start) {
+        // This thread's cells.
+        ThreadBlock& block = local();
+        // Count the call.
+        bump(block, block.calls[static_cast<size_t>(op)], 1);
+        // A sampled one.
+        if (start != 0) sample(block, op, ticks() - start);
+    }
+    // Records one duration of elapsed ticks for op directly (counted as a call and always kept).
+    void record(MetricOp op, uint64_t elapsed) {
+        // This thread's cells.
+        ThreadBlock& block = local();
+        // Count the call.
+        bump(block, block.calls[static_cast<size_t>(op)], 1);
+        // Keep the duration.
+        sample(block, op, elapsed);
+    }
+    // Counts amount occurrences of an event.
+    void count(MetricCounter counter, uint64_t amount = 1) {
+        // This thread's cells.
+        ThreadBlock& block = local();
+        // Its counter.
+        bump(block, block.counters[static_cast<size_t>(counter)], amount);
+    }
+    // Sums every thread's calls, sampled histograms (converted to nanoseconds) and counters into snapshot and marks
+    // it enabled.
+    void collect(MetricsSnapshot& snapshot) const;
+
+    // Counts one operation from construction to destruction, timing one in METRIC_SAMPLE_PERIOD.
+    class Timer {
+    private:
+        // Where it is recorded.
+        StoreMetrics& metrics;
+        // What is timed.
+        MetricOp op;
+        // Start in ticks (0: not sampled).
+        uint64_t start;
+
+    public:
+        // Constructor: starts the clock if this operation is sampled.
+        Timer(StoreMetrics& metrics, MetricOp op) : metrics(metrics), op(op), start(sampleStart()) {}
+        // Destructor: counts the call and records a sampled duration.
+        ~Timer() { metrics.finish(op, start); }
+        // Refers to its start, so it cannot be copied.
+        Timer(const Timer&) = delete;
+        // Refers to its start, so it cannot be copied.
+        Timer& operator=(const Timer&) = delete;
+    };
+};
+
+#else
+
+// Stand-in for builds without KV_STORE_METRICS: every call compiles to nothing and collect leaves the snapshot
+// disabled.
+class StoreMetrics {
+public:
+    // Counts amount occurrences of an event (nothing to do).
+    void count(MetricCounter, uint64_t = 1) {}
+    // Leaves the snapshot's latencies and counters at zero.
+    void collect(MetricsSnapshot&) const {}
+
+    // Times nothing.
+    class Timer {
+    public:
+        // Constructor: nothing to start.
+        Timer(StoreMetrics&, MetricOp) {}
+    };
+};
+
+#endif // KV_STORE_METRICS
+
+#endif // METRICS_HPP
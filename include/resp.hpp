@@ -0,0 +1,50 @@
+#ifndef RESP_HPP
+#define RESP_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint> // For integer replies
+#include <cstddef> // For size_t
+
+// Outcome of parsing one command from the front of a read buffer.
+enum class RespParseStatus {
+    // A whole command was parsed.
+    Complete,
+    // The buffer ends mid-command; read more and parse again from the same position.
+    Incomplete,
+    // The bytes are not valid RESP; the connection cannot be resynchronized.
+    Error
+};
+
+// The Redis serialization protocol (RESP2), as spoken by redis-cli, redis-benchmark and client libraries.
+// Commands arrive either as an array of bulk strings ("*2\r\n$3\r\nGET\r\n$1\r\nk\r\n") or as an inline line
+// ("GET k\r\n"); replies are encoded by the append* functions straight into an output buffer.
+namespace Resp {
+    // Most arguments a command may have.
+    constexpr size_t MAX_ARGUMENTS = 1024 * 1024;
+    // Longest bulk string argument (as Redis' proto-max-bulk-len).
+    constexpr size_t MAX_BULK_BYTES = 512 * 1024 * 1024;
+    // Longest inline command line.
+    constexpr size_t MAX_INLINE_BYTES = 64 * 1024;
+
+    // Parses the command at the front of input. On Complete, args holds views into input (valid while input is) and
+    // consumed the command's length; on Error, error holds the reason. Parsing restarts from the front each time,
+    // so a command split across reads is parsed again once the rest arrived.
+    RespParseStatus parseCommand(std::string_view input, std::vector<std::string_view>& args, size_t& consumed, std::string& error);
+
+    // Appends a simple string reply ("+OK").
+    void appendSimpleString(std::string& out, std::string_view text);
+    // Appends an error reply ("-ERR ..."); message must include the error code.
+    void appendError(std::string& out, std::string_view message);
+    // Appends an integer reply.
+    void appendInteger(std::string& out, int64_t value);
+    // Appends a bulk string reply.
+    void appendBulkString(std::string& out, std::string_view value);
+    // Appends the null bulk reply of a missing key.
+    void appendNull(std::string& out);
+    // Appends the header of an array reply of count elements (the elements follow).
+    void appendArrayHeader(std::string& out, size_t count);
+}
+
+#endif // RESP_HPP
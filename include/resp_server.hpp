@@ -0,0 +1,359 @@
+#ifndef RESP_SERVER_HPP
+#define RESP_SERVER_HPP
+
+#include "kv_store.hpp"
+#include "resp.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque> // For replies waiting on other cores
+#include <optional>
+#include <memory> // For std::unique_ptr
+#include <unordered_map> // For connections by descriptor
+#include <atomic> // For the stop flag
+#include <cstdint> // For the port
+#include <sys/socket.h> // For msghdr
+#include <sys/uio.h> // For iovec
+#include "io_ring.hpp" // For the io_uring backend (KV_STORE_IO_URING builds)
+
+// I/O mechanism of the server's event loop.
+enum class ServerBackend {
+    // Readiness notifications from epoll, then read / sendmsg system calls per client.
+    Epoll,
+    // Completions from io_uring: multishot accept, multishot receive into provided buffers, and sendmsg requests,
+    // all submitted and reaped with one io_uring_enter per iteration. Needs a KV_STORE_IO_URING build and a
+    // kernel with provided buffers and multishot receive (6.0+); otherwise start falls back to Epoll.
+    IoUring
+};
+
+// Construction-time tunables for RespServer.
+struct ServerConfig {
+    // Default TCP port (Redis' own).
+    static constexpr uint16_t DEFAULT_PORT = 6379;
+    // Default most simultaneous clients.
+    static constexpr size_t DEFAULT_MAX_CLIENTS = 10000;
+    // Default longest wait for events before the store gets a tick, in milliseconds.
+    static constexpr int DEFAULT_TICK_INTERVAL_MS = 100;
+
+    // Address to listen on.
+    std::string bindAddress = "127.0.0.1";
+    // Port to listen on; 0 picks a free one (see RespServer::port).
+    uint16_t port = DEFAULT_PORT;
+    // Connections beyond this are accepted and closed with an error.
+    size_t maxClients = DEFAULT_MAX_CLIENTS;
+    // The store's background work (KVStore::tick) runs at least this often, even when no client is active.
+    int tickIntervalMs = DEFAULT_TICK_INTERVAL_MS;
+    // Snapshot file written by SAVE and BGSAVE.
+    std::string snapshotPath = "dump.kvs";
+    // Requested event loop backend.
+    ServerBackend backend = ServerBackend::Epoll;
+    // Bind with SO_REUSEPORT, so several servers (one per core, see CoreServer) share the port and the kernel
+    // spreads incoming connections across them.
+    bool reusePort = false;
+};
+
+// Server figures reported by RespServer::stats.
+struct ServerStats {
+    // Backend actually running (Epoll if IoUring was requested but is unavailable).
+    ServerBackend backend = ServerBackend::Epoll;
+    // Connections accepted since start.
+    uint64_t connectionsAccepted = 0;
+    // Connections currently open.
+    size_t connectedClients = 0;
+    // Commands executed.
+    uint64_t commandsProcessed = 0;
+    // Event loop iterations.
+    uint64_t loopIterations = 0;
+    // Reads (read calls, or receive completions under IoUring) that returned data.
+    uint64_t reads = 0;
+    // Gather writes issued (sendmsg, i.e. writev with MSG_NOSIGNAL): at most one per connection per iteration.
+    uint64_t writevCalls = 0;
+    // Connections closed because they sent malformed RESP.
+    uint64_t protocolErrors = 0;
+    // io_uring_enter calls (IoUring backend only): one per iteration submits every request and reaps every completion.
+    uint64_t ringSubmits = 0;
+    // Commands, or parts of multi-key commands, sent to the core owning their keys (CoreServer only).
+    uint64_t forwardedCommands = 0;
+    // Sleeping cores woken through their eventfd to take forwarded work (CoreServer only).
+    uint64_t peerWakeups = 0;
+};
+
+class CoreServer;
+
+// Work one core of a CoreServer hands another over their queue: a command on a key the target owns, or the target's
+// share of a multi-key or whole-store command. The target fills in the result and queues the message back.
+struct CoreMessage {
+    // Kind of work.
+    enum class Kind : uint8_t {
+        // A whole command, answered with its encoded reply.
+        Command,
+        // MGET of some keys.
+        MultiGet,
+        // MSET of some pairs.
+        MultiSet,
+        // DEL of some keys.
+        Delete,
+        // EXISTS of some keys.
+        Exists,
+        // DBSIZE of the target's partition.
+        Size,
+        // PREFIX over the target's partition.
+        Prefix
+    };
+
+    // Kind of work.
+    Kind kind = Kind::Command;
+    // Core that sent it; the result goes back there.
+    uint32_t origin = 0;
+    // Connection on the origin core the result is for (descriptor and number, as it may have closed since).
+    int fd = -1;
+    // Its connection number.
+    uint32_t connectionId = 0;
+    // The origin's pending reply the result fills (only dereferenced by the origin, once it found the connection open).
+    void* slot = nullptr;
+    // Arguments: the command (Command), keys (MultiGet, Delete, Exists), keys and values (MultiSet) or the prefix.
+    std::vector<std::string> args;
+    // Position of each MultiGet key in the client's command, so the values merge back in order.
+    std::vector<uint32_t> positions;
+    // Encoded reply (Command).
+    std::string reply;
+    // Values, or null for missing keys (MultiGet).
+    std::vector<std::optional<std::string>> values;
+    // Matching keys, sorted (Prefix).
+    std::vector<std::string> keys;
+    // Keys removed, keys present or partition size (Delete, Exists, Size).
+    int64_t count = 0;
+    // False if the target's memory budget rejected the write (MultiSet).
+    bool ok = true;
+};
+
+// Single-threaded TCP server speaking RESP in front of one KVStore (or one core of a CoreServer).
+// One event loop (epoll, or io_uring when built and requested) accepts connections and takes whatever each client sent.
+// Every complete command in the buffer is executed back to back (pipelining), with replies appended to the client's
+// output blocks. Once every ready client has been served, the store's append log is synced once for all of the
+// iteration's writes, and each client with output gets a single writev carrying all of its replies.
+class RespServer {
+public:
+    // Bytes requested per read call.
+    static constexpr size_t READ_CHUNK_BYTES = 64 * 1024;
+    // Replies are packed into output blocks of about this size; writev sends up to IOV_MAX of them at once.
+    static constexpr size_t OUTPUT_BLOCK_BYTES = 16 * 1024;
+    // Events taken per epoll_wait.
+    static constexpr int MAX_EVENTS = 256;
+    // Submission queue entries of the io_uring backend.
+    static constexpr unsigned RING_ENTRIES = 4096;
+    // Provided receive buffers shared by every connection of the io_uring backend (a power of two).
+    static constexpr unsigned RING_BUFFERS = 512;
+    // Bytes per provided receive buffer.
+    static constexpr size_t RING_BUFFER_BYTES = 16 * 1024;
+
+private:
+    // CoreServer wires its cores together.
+    friend class CoreServer;
+
+    // Reply of a command whose result comes from other cores (CoreServer only), or one that follows it and must
+    // wait its turn. Parts merge in here as they arrive; the reply is written once every earlier one was.
+    struct PendingReply {
+        // Kind of the forwarded work (decides how parts merge).
+        CoreMessage::Kind kind = CoreMessage::Kind::Command;
+        // Parts still to arrive; 0 once the reply is complete.
+        unsigned partsLeft = 0;
+        // Encoded reply (and replies of the local commands that followed, once complete).
+        std::string reply;
+        // MultiGet values, in key order.
+        std::vector<std::optional<std::string>> values;
+        // Prefix matches of every part.
+        std::vector<std::string> keys;
+        // Summed Delete / Exists / Size counts.
+        int64_t count = 0;
+        // False once a MultiSet part was rejected.
+        bool ok = true;
+    };
+
+    // One client.
+    struct Connection {
+        // Socket.
+        int fd = -1;
+        // Connection number, telling io_uring completions for a closed connection from its descriptor's next user.
+        uint32_t id = 0;
+        // Bytes read but not yet parsed into a command.
+        std::string input;
+        // Replies not yet written, in order.
+        std::vector<std::string> output;
+        // Bytes of output.front() already written.
+        size_t outputOffset = 0;
+        // True while EPOLLOUT is registered (the socket buffer was full).
+        bool waitingForWritable = false;
+        // True once QUIT or a protocol error asked for the connection to close after its replies.
+        bool closeAfterWrite = false;
+        // True while the connection is in the current iteration's flush list.
+        bool pendingFlush = false;
+        // Output blocks an io_uring send is reading; replies go to a later block until it completes.
+        size_t blocksInFlight = 0;
+        // True while an io_uring send is in flight.
+        bool sendInFlight = false;
+        // Gather list of the io_uring send in flight.
+        std::vector<iovec> sendVector;
+        // Message header of the io_uring send in flight.
+        msghdr sendHeader{};
+        // Replies waiting on other cores, in command order, and the local ones behind them (CoreServer only).
+        std::deque<PendingReply> waiting;
+
+        // Returns true if replies are waiting to be written.
+        bool hasOutput() const {
+            // The first block always holds unsent bytes unless everything went out.
+            return !output.empty() && output.front().size() > outputOffset;
+        }
+    };
+
+    // Store every command runs against.
+    KVStore& store;
+    // Settings.
+    ServerConfig settings;
+    // Listening socket (-1 until start).
+    int listenFd;
+    // epoll instance (-1 until start).
+    int epollFd;
+    // eventfd that wakes the loop for stop().
+    int wakeFd;
+    // Port actually bound.
+    uint16_t boundPort;
+    // Set by stop(); the loop exits at the end of the iteration.
+    std::atomic<bool> stopping;
+    // Backend chosen by start.
+    ServerBackend activeBackend;
+    // Number of the last connection accepted.
+    uint32_t lastConnectionId;
+    // Open connections by descriptor.
+    std::unordered_map<int, std::unique_ptr<Connection>> connections;
+    // Connections with replies to write at the end of this iteration.
+    std::vector<Connection*> flushList;
+    // Scratch buffer each read lands in; commands that arrive whole are parsed straight from it.
+    std::vector<char> readBuffer;
+    // Arguments of the command being executed (views into its connection's input).
+    std::vector<std::string_view> args;
+    // Counters reported by stats.
+    ServerStats counters;
+    // Gather list reused by the epoll backend's sends.
+    std::vector<iovec> gather;
+    // Group this server is one core of (null when serving alone).
+    CoreServer* group;
+    // Its index in the group.
+    uint32_t core;
+    // Set while the loop is about to wait; peers that queued work then wake it through wakeFd.
+    std::atomic<bool> sleeping;
+    // Messages for each core, pushed onto their queues after the iteration's log sync.
+    std::vector<std::vector<CoreMessage>> outbox;
+    // Per-core shares of the multi-key command being split.
+    std::vector<CoreMessage> scatter;
+    // True while an outbox waits for room in its queue.
+    bool outboxWaiting;
+#ifdef KV_STORE_IO_URING
+    // The io_uring backend's ring (null under Epoll).
+    std::unique_ptr<IoRing> ring;
+    // Receive buffers every connection's multishot receive draws from.
+    std::unique_ptr<IoBufferRing> receiveBuffers;
+    // Closed connections whose send is still in flight, kept until it completes (its buffers are being read).
+    std::unordered_map<uint32_t, std::unique_ptr<Connection>> retired;
+    // Target of the eventfd read that wakes the ring for stop().
+    uint64_t wakeValue;
+    // Interval of the ring's tick timeout.
+    __kernel_timespec tickTimeout;
+#endif
+
+    // Tracks a new connection; returns nullptr (after closing it with an error) when the server is full.
+    Connection* addConnection(int fd);
+    // Accepts every pending connection (Epoll).
+    void acceptConnections();
+    // Reads from a readable client and executes every complete command it sent; returns false if it must be closed now.
+    bool readFromClient(Connection& connection);
+    // Executes every complete command in data (bytes just received) after any partial command left from before.
+    void processInput(Connection& connection, std::string_view data);
+    // Executes one parsed command, appending its reply.
+    void execute(Connection& connection);
+    // Runs the parsed command against the store, appending its reply to out; returns true if the client asked to hang up.
+    bool runCommand(std::string& out);
+    // Returns where the next reply goes: the output block, or the last pending reply while earlier ones wait.
+    std::string& replyBuffer(Connection& connection);
+    // Returns the output block replies should be appended to.
+    std::string& outputBlock(Connection& connection);
+    // Returns the open connection on fd numbered id, or nullptr if it was closed since.
+    Connection* findConnection(int fd, uint32_t id);
+    // Sends the parsed command, or its per-core shares, to the cores owning its keys; returns false if it is local.
+    bool route(Connection& connection);
+    // Adds a pending reply expecting parts results.
+    PendingReply& awaitParts(Connection& connection, CoreMessage::Kind kind, unsigned parts);
+    // Fills in a message's routing to the pending reply.
+    void address(CoreMessage& message, Connection& connection, PendingReply& reply, CoreMessage::Kind kind);
+    // Does a message's work against the store, filling in its result.
+    void serveMessage(CoreMessage& message);
+    // Merges a part's result into its pending reply, encoding the reply once the last part arrived.
+    void mergePart(PendingReply& reply, CoreMessage& message);
+    // Moves completed pending replies, in order, to the output.
+    void releaseReplies(Connection& connection);
+    // Queues a message for target.
+    void sendToCore(uint32_t target, CoreMessage&& message);
+    // Serves requests from other cores and merges their results.
+    void drainPeers();
+    // Pushes every outbox onto its queue and wakes the targets.
+    void flushPeers();
+    // Returns the next wait's timeout, announcing the sleep to peers (0 if work is already waiting).
+    int waitTimeout();
+    // Wakes the loop if it is sleeping; returns true if it had to.
+    bool notify();
+    // Queues a connection for the end-of-iteration flush.
+    void scheduleFlush(Connection& connection);
+    // Points iovecs at the connection's unsent output blocks (at most IOV_MAX); returns the blocks covered.
+    size_t gatherOutput(Connection& connection, std::vector<iovec>& iovecs);
+    // Drops bytes of output that were written.
+    void consumeOutput(Connection& connection, size_t bytes);
+    // Writes as much of a connection's output as the socket takes with one writev; returns false if it must be closed.
+    bool flushClient(Connection& connection);
+    // Registers or clears interest in a connection becoming writable.
+    void watchWritable(Connection& connection, bool enable);
+    // Closes a connection and forgets it.
+    void closeClient(int fd);
+    // Runs the epoll event loop.
+    void runEpoll();
+#ifdef KV_STORE_IO_URING
+    // Sets up the ring and its receive buffers; returns false if the kernel lacks what the backend needs.
+    bool startRing();
+    // Runs the io_uring event loop.
+    void runRing();
+    // Queues the multishot accept.
+    void armAccept();
+    // Queues a connection's multishot receive.
+    void armReceive(Connection& connection);
+    // Queues the read of the wake-up eventfd.
+    void armWake();
+    // Queues the tick timeout.
+    void armTick();
+    // Queues one sendmsg carrying a connection's output, unless one is in flight.
+    void queueSend(Connection& connection);
+    // Handles one completion.
+    void handleCompletion(const io_uring_cqe& completion);
+#endif
+
+public:
+    // Constructor: serves store with the given settings (nothing is opened until start).
+    explicit RespServer(KVStore& store, const ServerConfig& config = ServerConfig());
+    // Destructor: closes every socket.
+    ~RespServer();
+    // Holds descriptors, so it cannot be copied.
+    RespServer(const RespServer&) = delete;
+    // Holds descriptors, so it cannot be copied.
+    RespServer& operator=(const RespServer&) = delete;
+
+    // Binds and listens. Returns false (and prints nothing) if the address cannot be used.
+    bool start();
+    // Returns the port bound by start (useful with ServerConfig::port = 0).
+    uint16_t port() const;
+    // Runs the event loop until stop() is called.
+    void run();
+    // Asks run() to return; safe to call from any thread or a signal handler.
+    void stop();
+    // Returns the server's counters (call from the loop's thread, or after run returned).
+    ServerStats stats() const;
+};
+
+#endif // RESP_SERVER_HPP
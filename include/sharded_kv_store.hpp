@@ -0,0 +1,83 @@
+#ifndef SHARDED_KV_STORE_HPP
+#define SHARDED_KV_STORE_HPP
+
+#include "kv_store.hpp"
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <memory> // For std::unique_ptr
+#include <shared_mutex> // For per-shard reader/writer locks
+
+// Thread-safe key-value store that hash-partitions keys across independent KVStore shards.
+// Each shard owns its own HashMap, Trie, LRUCache and BloomFilter behind its own reader/writer
+// lock, so single-key operations on different shards never contend.
+class ShardedKVStore {
+private:
+    // Assumed cache line size; keeps each shard's lock off its neighbours' lines.
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    // One partition of the key space.
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        // Reader/writer lock guarding the store; readers share it, writers take it exclusively.
+        mutable std::shared_mutex lock;
+        // The shard's data, on its own cache line so writers do not invalidate the lock word.
+        alignas(CACHE_LINE_SIZE) KVStore store;
+
+        // Constructor: builds the shard's store from the per-shard configuration.
+        explicit Shard(const KVStoreConfig& config) : store(config) {}
+    };
+
+    // The shards, allocated individually so each starts on a fresh cache line.
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    // Entries a consistent scan or save reads from a shard per hold of its shared lock.
+    static constexpr size_t SCAN_PAGE_SIZE = 256;
+
+    // Returns the shard responsible for a key, given its Utils::hash64.
+    Shard& shardFor(uint64_t hashCode) const;
+    // Opens a snapshot of every shard at one instant, holding every shard's lock at once just long enough.
+    std::vector<KVSnapshot> snapshotAll() const;
+    // Releases snapshots taken by snapshotAll, each under its shard's lock.
+    void releaseAll(std::vector<KVSnapshot>& snapshots) const;
+
+public:
+    // Constructor: creates numShards shards (0 means one per hardware thread), each configured with perShardConfig.
+    // With an append log, shard i logs to (and replays) appendLogPath + "." + i.
+    explicit ShardedKVStore(size_t numShards = 0, const KVStoreConfig& perShardConfig = KVStoreConfig());
+
+    // Sets (inserts or updates) a key-value pair. Takes the owning shard's lock exclusively; under AppendFsync::Always
+    // it waits for the shard's log after releasing the lock, so writers to one shard share an fdatasync.
+    // Returns false if the shard's memory budget rejected the write (budgets are per shard).
+    bool set(const std::string& key, const std::string& value);
+    // Gets a copy of the value for a key, or std::nullopt if absent. Takes the owning shard's lock shared.
+    // Readers consult the Bloom filter and main store only; the shard's cache is left to writers.
+    std::optional<std::string> get(std::string_view key) const;
+    // Deletes a key. Returns true if the key was present. Takes the owning shard's lock exclusively (logged like set).
+    bool remove(const std::string& key);
+    // Retrieves all keys starting with the given prefix from every shard, merged in sorted order.
+    std::vector<std::string> prefixSearch(const std::string& prefix) const;
+    // Returns up to limit key-value pairs with keys in [start, end) (no end: every key from start on) from every shard,
+    // merged in ascending key order. Each shard is read under its own shared lock, one shard at a time.
+    std::vector<std::pair<std::string, std::string>> scanRange(const std::string& start, const std::optional<std::string>& end,
+                                                               size_t limit) const;
+    // Returns every key-value pair whose key starts with prefix as of one instant across all shards, merged in sorted
+    // order. Each shard is read from a snapshot a page at a time under its shared lock, so writers keep going between
+    // pages and the result still never mixes states from before and after a write.
+    std::vector<std::pair<std::string, std::string>> prefixScan(const std::string& prefix) const;
+    // Writes shard i as of one instant across all shards to pathPrefix + "." + i without forking: each shard is read
+    // from a snapshot a page at a time, as prefixScan does, while writes continue. Returns false on an I/O error.
+    bool save(const std::string& pathPrefix) const;
+    // Loads shard i from pathPrefix + "." + i (see KVStore::load). Returns false if any shard failed to load.
+    bool load(const std::string& pathPrefix);
+    // Checks if a key might exist using the owning shard's Bloom Filter.
+    bool mightContain(std::string_view key) const;
+    // Returns the total number of keys across all shards.
+    size_t size() const;
+    // Returns every shard's KVStore::metrics merged (each read under its shared lock).
+    MetricsSnapshot metrics() const;
+    // Returns the number of shards.
+    size_t shardCount() const;
+};
+
+#endif // SHARDED_KV_STORE_HPP
@@ -0,0 +1,101 @@
+#ifndef SLAB_ARENA_HPP
+#define SLAB_ARENA_HPP
+
+#include <string_view>
+#include <vector>
+#include <cstddef> // For size_t
+#include <cstdint> // For fixed-width header bytes
+
+// Memory usage report for a SlabArena.
+struct ArenaStats {
+    // Number of records currently allocated.
+    size_t liveRecords = 0;
+    // Bytes actually needed by live records (length header + key + value).
+    size_t payloadBytes = 0;
+    // Bytes of slab slots handed out to live records (payload rounded up to its size class).
+    size_t slotBytes = 0;
+    // Bytes held by the arena: every slab page plus every oversized record.
+    size_t reservedBytes = 0;
+    // Bytes of records too large for any size class (included in reservedBytes).
+    size_t largeBytes = 0;
+    // Share of the reserved bytes not holding payload: 1 - payloadBytes / reservedBytes.
+    double fragmentation = 0.0;
+};
+
+// Size-class slab allocator that packs a key and its value contiguously into one record:
+//   [varint key length][varint value length][key bytes][value bytes]
+// Records are carved out of 64 KiB pages, one page list and free list per size class,
+// so small entries cost one slot instead of several separate heap allocations.
+class SlabArena {
+private:
+    // Size of each slab page.
+    static constexpr size_t PAGE_SIZE = 64 * 1024;
+    // Number of size classes.
+    static constexpr size_t NUM_CLASSES = 17;
+    // Slot size of each class; records larger than the last class get their own allocation.
+    static constexpr size_t CLASS_SIZES[NUM_CLASSES] = {
+        16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096
+    };
+
+    // Allocation state of one size class.
+    struct SizeClass {
+        // Head of the intrusive free list (the first 8 bytes of a free slot point at the next).
+        char* freeList = nullptr;
+        // Next never-used slot in the newest page.
+        char* bumpPtr = nullptr;
+        // End of the newest page.
+        char* bumpEnd = nullptr;
+        // Number of slots in use.
+        size_t usedSlots = 0;
+    };
+
+    // Per-class state.
+    SizeClass classes[NUM_CLASSES];
+    // Every slab page ever allocated (pages are recycled through free lists, not returned).
+    std::vector<char*> pages;
+    // Number of live records.
+    size_t liveRecords;
+    // Payload bytes of live records.
+    size_t payloadBytes;
+    // Bytes of live oversized records.
+    size_t largeBytes;
+
+    // Returns the size class for a record of the given size, or NUM_CLASSES if it is oversized.
+    static size_t classFor(size_t recordSize);
+    // Returns the total size (header + key + value) of an existing record.
+    static size_t recordSize(const char* record);
+    // Writes the header, key and value into a record.
+    static void writeRecord(char* record, std::string_view key, std::string_view value);
+    // Returns the size of a record holding key and value.
+    static size_t sizeFor(std::string_view key, std::string_view value);
+    // Hands out one slot of the given class.
+    char* allocateSlot(size_t classIndex);
+
+public:
+    // Constructor: creates an empty arena (pages are allocated on demand).
+    SlabArena();
+    // Destructor: releases every page and oversized record.
+    ~SlabArena();
+    // Records are referenced by raw pointers, so the arena cannot be copied.
+    SlabArena(const SlabArena&) = delete;
+    // Records are referenced by raw pointers, so the arena cannot be copied.
+    SlabArena& operator=(const SlabArena&) = delete;
+
+    // Allocates a record holding copies of key and value.
+    char* allocate(std::string_view key, std::string_view value);
+    // Replaces a record's value; rewrites in place when it still fits the slot, otherwise moves it.
+    // Returns the (possibly new) record pointer.
+    char* reassign(char* record, std::string_view value);
+    // Frees a record.
+    void deallocate(char* record);
+    // Returns a view of a record's key.
+    static std::string_view key(const char* record);
+    // Returns a view of a record's value.
+    static std::string_view value(const char* record);
+    // Returns the number of bytes reserved for a record (its slot, or its own allocation if oversized).
+    static size_t footprint(const char* record);
+    // Returns current usage and fragmentation figures.
+    ArenaStats stats() const;
+};
+
+#endif // SLAB_ARENA_HPP
@@ -0,0 +1,124 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional> // For entry callbacks
+#include <cstdint> // For fixed-width header fields
+#include <cstddef> // For size_t
+#include <memory> // For the optional ring writer
+#include "io_ring.hpp" // For the io_uring write path (KV_STORE_IO_URING builds)
+
+// Binary point-in-time snapshot of a key-value store.
+// Layout (integers little-endian, as written by the host):
+//   header:    8-byte magic "KVSNAP\0\1", uint32 format version, uint32 reserved (0)
+//   entries:   [varint key length][varint value length][key bytes][value bytes]  (the SlabArena record layout)
+//   deadlines: [varint key length][key bytes][uint64 deadline]                    (keys with an expiry)
+//   footer:    uint64 entry count, uint64 deadline count, uint64 checksum
+// The checksum covers every byte before it, hashed in CHECKSUM_BLOCK-byte blocks with Utils::hash64,
+// so it is verified at memory bandwidth before any entry is trusted.
+namespace Snapshot {
+    // Format version written and accepted.
+    constexpr uint32_t FORMAT_VERSION = 1;
+    // Bytes hashed per checksum block.
+    constexpr size_t CHECKSUM_BLOCK = 64 * 1024;
+}
+
+// Streams a snapshot to path + ".tmp.<pid>" and renames it over path on commit, so readers only ever see a
+// complete file and a foreground and a background save never share a temporary file.
+// Every entry must be added before the first deadline. I/O errors make commit fail.
+class SnapshotWriter {
+private:
+    // Final file name.
+    std::string finalPath;
+    // File being written.
+    std::string tempPath;
+    // Descriptor of the temporary file (-1 once closed or if it failed to open).
+    int fd;
+    // Pending bytes; flushed one checksum block at a time.
+    std::vector<char> buffer;
+    // Running checksum of the blocks flushed so far.
+    uint64_t checksum;
+    // Entries written.
+    uint64_t entries;
+    // Deadlines written.
+    uint64_t deadlines;
+    // True once any write failed.
+    bool failed;
+    // True once commit renamed the file into place.
+    bool committed;
+#ifdef KV_STORE_IO_URING
+    // Writes blocks from registered buffers with several in flight while the next ones are hashed
+    // (null if the kernel refused it).
+    std::unique_ptr<RingFileWriter> ringWriter;
+#endif
+
+    // Appends raw bytes, flushing each full checksum block.
+    void append(const char* data, size_t size);
+    // Appends a varint.
+    void appendVarint(uint64_t value);
+    // Appends a uint64.
+    void appendU64(uint64_t value);
+    // Hashes the buffered bytes into the checksum and writes them out.
+    void flushBlock();
+
+public:
+    // Constructor: creates the temporary file and writes the header.
+    explicit SnapshotWriter(const std::string& path);
+    // Destructor: closes the file and removes it unless it was committed.
+    ~SnapshotWriter();
+    // Holds a descriptor, so it cannot be copied.
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    // Holds a descriptor, so it cannot be copied.
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    // Adds one key-value pair.
+    void addEntry(std::string_view key, std::string_view value);
+    // Adds the expiry deadline (ms since the Unix epoch) of a key already added.
+    void addDeadline(std::string_view key, uint64_t deadline);
+    // Writes the footer, syncs the file to disk and renames it over the final path. Returns false on any I/O error.
+    bool commit();
+};
+
+// Maps a snapshot file read-only and hands out its entries as views into the mapping.
+class SnapshotReader {
+private:
+    // Mapped file (nullptr when nothing is open).
+    const char* data;
+    // Size of the mapping.
+    size_t size;
+    // End of the entries section.
+    const char* entriesEnd;
+    // Number of entries.
+    uint64_t entries;
+    // Number of deadlines.
+    uint64_t deadlines;
+
+    // Releases the mapping.
+    void close();
+
+public:
+    // Constructor: nothing open.
+    SnapshotReader();
+    // Destructor: unmaps the file.
+    ~SnapshotReader();
+    // Holds a mapping, so it cannot be copied.
+    SnapshotReader(const SnapshotReader&) = delete;
+    // Holds a mapping, so it cannot be copied.
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // Maps path and validates it: magic, version, checksum and the bounds of every record. Returns false if
+    // the file is missing, truncated or corrupt (nothing stays open then).
+    bool open(const std::string& path);
+    // Returns the number of key-value entries.
+    size_t entryCount() const;
+    // Returns the number of deadlines.
+    size_t deadlineCount() const;
+    // Visits every entry in file order. Views point into the mapping and are valid until the reader is destroyed.
+    void forEachEntry(const std::function<void(std::string_view key, std::string_view value)>& visit) const;
+    // Visits every deadline in file order (keys as in forEachEntry).
+    void forEachDeadline(const std::function<void(std::string_view key, uint64_t deadline)>& visit) const;
+};
+
+#endif // SNAPSHOT_HPP
@@ -0,0 +1,77 @@
+#ifndef TIMING_WHEEL_HPP
+#define TIMING_WHEEL_HPP
+
+#include <string>
+#include <string_view> // For scheduling without copying twice
+#include <vector>
+#include <functional> // For expiry callbacks
+#include <cstdint> // For uint64_t
+#include <cstddef> // For size_t
+
+// Hierarchical timing wheel of key deadlines, in millisecond ticks.
+// Level L has SLOTS_PER_LEVEL slots of 64^L ticks each; a timer is filed at the lowest level whose
+// slot still separates its deadline from the current tick, and moves down a level (cascades) when the
+// wheel reaches that slot, so scheduling is O(1) and each timer is touched at most LEVELS times.
+// Timers are never cancelled: the owner checks a fired key's current deadline and ignores stale timers.
+class TimingWheel {
+public:
+    // Slots per level (a power of two; each level's slot spans this many slots of the level below).
+    static constexpr size_t SLOTS_PER_LEVEL = 64;
+    // Number of levels; together they span 64^6 ms (about 2.2 years) ahead of the current tick.
+    static constexpr size_t LEVELS = 6;
+
+private:
+    // Bits of the tick consumed by one level.
+    static constexpr unsigned LEVEL_BITS = 6;
+
+    // One scheduled deadline.
+    struct Timer {
+        // Key to expire.
+        std::string key;
+        // Deadline in ticks (milliseconds since the Unix epoch).
+        uint64_t deadline;
+    };
+
+    // Timers by level and slot.
+    std::vector<Timer> slots[LEVELS][SLOTS_PER_LEVEL];
+    // Timers per level, so empty levels are skipped when time jumps ahead.
+    size_t levelCounts[LEVELS];
+    // Timers whose deadline passed, waiting to be handed out.
+    std::vector<Timer> due;
+    // Next timer of due to hand out.
+    size_t dueIndex;
+    // Timers beyond the last level's span, re-filed as the wheel turns.
+    std::vector<Timer> overflow;
+    // The tick the wheel has processed up to (deadlines at or before it are due).
+    uint64_t currentTick;
+    // Timers scheduled and not yet handed out.
+    size_t pending;
+    // Heap bytes of the pending timers' keys (keys too long for the small-string buffer).
+    size_t keyBytes;
+
+    // Files a timer at its level and slot, or in due if its deadline already passed.
+    void place(Timer&& timer);
+    // Re-files every timer of one slot (the wheel reached it).
+    void cascade(size_t level, size_t slot);
+    // Moves the wheel to tick, cascading and collecting due timers along the way.
+    void advanceTo(uint64_t tick);
+
+public:
+    // Constructor: starts the wheel at a tick (normally the current time in milliseconds).
+    explicit TimingWheel(uint64_t startTick = 0);
+
+    // Schedules key to fire at deadline (a tick at or before the current one fires on the next advance).
+    void schedule(std::string_view key, uint64_t deadline);
+    // Moves the wheel to now and hands up to maxTimers due timers to fire, oldest slot first.
+    // Timers left over stay due for the next call. Returns the number fired.
+    size_t advance(uint64_t now, size_t maxTimers,
+                   const std::function<void(const std::string& key, uint64_t deadline)>& fire);
+    // Returns the number of due timers left over by the last advance.
+    size_t dueCount() const;
+    // Returns the number of timers scheduled and not yet fired.
+    size_t size() const;
+    // Returns the bytes held by the wheel: its slot arrays and pending timers.
+    size_t memoryUsage() const;
+};
+
+#endif // TIMING_WHEEL_HPP
@@ -2,48 +2,138 @@
 #define TRIE_HPP
 
 #include <string>
+#include <string_view> // For key arguments
 #include <vector>
-#include <map> // For children nodes
-
-// Represents a node in the Trie.
-struct TrieNode {
-    // Map of characters to child TrieNode pointers.
-    std::map<char, TrieNode*> children;
-    // Flag to mark if a key ends at this node.
-    bool isEndOfKey;
-
-    // Constructor for TrieNode.
-    TrieNode() : isEndOfKey(false) {}
-    // Destructor to free children (needed for proper memory management).
-    ~TrieNode();
+#include <cstdint> // For key bytes
+#include <optional> // For resume positions and malformed cursors
+
+// Node header shared by every node of the adaptive radix tree (defined in trie.cpp).
+struct ArtNode;
+// Leaf node holding one complete key (defined in trie.cpp).
+struct ArtLeaf;
+
+// One page of a paged prefix search.
+struct PrefixPage {
+    // Keys on this page, in sorted order.
+    std::vector<std::string> keys;
+    // Token that resumes after the last key on this page, or Trie::CURSOR_START once nothing is left.
+    std::string nextCursor;
 };
 
-// Implements a Trie data structure for prefix-based key search.
+// Implements a Trie data structure for prefix-based key search, as an adaptive radix tree (ART).
+// Inner nodes adapt their fan-out to the number of children (Node4, Node16, Node48, Node256), so
+// sparse levels stay small and dense levels are a single array lookup; Node16 is searched with SSE2.
+// Runs of single-child nodes are collapsed into a compressed prefix stored in the node below
+// (path compression), and a key is stored as one leaf as soon as it is the only key below its
+// parent (lazy expansion), so most keys cost one leaf allocation rather than a node per character.
+// Keys are visited in lexicographic byte order, the same order as std::string comparison.
 class Trie {
 private:
-    // The root node of the Trie.
-    TrieNode* root;
+    // The root node of the tree (nullptr when empty).
+    ArtNode* root;
+    // Number of keys stored.
+    size_t keyCount;
+    // Bytes allocated for nodes and leaves.
+    size_t allocatedBytes;
+    // Number of inner nodes (every key also has a leaf).
+    size_t innerNodes;
+
+    // Allocates a leaf holding a copy of key.
+    ArtLeaf* makeLeaf(std::string_view key);
+    // Frees a leaf.
+    void freeLeaf(ArtLeaf* leaf);
+    // Frees an inner node (not its children).
+    void freeInner(ArtNode* node);
+    // Frees a node and everything below it.
+    void freeSubtree(ArtNode* node);
+    // Adds a child under byte to the inner node in ref, growing the node into a larger type if it is full.
+    void addChild(ArtNode*& ref, uint8_t byte, ArtNode* child);
+    // Removes the child under byte from the inner node in ref, shrinking or collapsing the node as needed.
+    void removeChild(ArtNode*& ref, uint8_t byte);
+    // Replaces a Node4 in ref that is left with a single child or only a terminal key by that child or key.
+    void collapse(ArtNode*& ref);
+    // Recursive helper for inserting a key below the node in ref, which starts at depth.
+    bool insertRecursive(ArtNode*& ref, std::string_view key, size_t depth);
+    // Recursive helper for deleting a key below the node in ref, which starts at depth.
+    bool removeRecursive(ArtNode*& ref, std::string_view key, size_t depth);
+public:
+    // Cursor that starts a paged prefix search, and that a page returns once the search is complete.
+    static constexpr const char* CURSOR_START = "0";
 
-    // Recursive helper for collecting keys with a given prefix.
-    void collectKeys(TrieNode* node, const std::string& currentPrefix, std::vector<std::string>& result) const;
-    // Recursive helper for deleting a key (and pruning nodes).
-    bool deleteKeyRecursive(TrieNode* node, const std::string& key, size_t depth);
+    // Lazy ordered iterator over the keys in a range [lowerBound, upperBound), ascending or descending.
+    // Keys are read straight from the tree's leaves, so iterating copies nothing and a page of results
+    // never materializes the rest of the range. Any insert or remove on the Trie invalidates the iterator.
+    class KeyIterator {
+    private:
+        friend class Trie;
+        // A node being visited and the next thing to visit in it.
+        struct Frame {
+            // The node.
+            const ArtNode* node;
+            // Ascending: -1 before the terminal key has been visited, then the next child byte to visit.
+            // Descending: the next child byte to visit (255 down to 0), then -1 for the terminal key.
+            int nextByte;
+        };
+        // Path from the subtree being walked down to the current node.
+        std::vector<Frame> stack;
+        // Keys sorting before this are outside the range.
+        std::string lowerBound;
+        // True to exclude lowerBound itself as well (resuming after a key).
+        bool skipLowerBound;
+        // Keys at or after this are outside the range (none: unbounded).
+        std::optional<std::string> upperBound;
+        // True to visit keys in descending order.
+        bool reverse;
+        // Key the iterator is positioned on.
+        std::string_view currentKey;
 
+        // Positions the stack on the first key not less than target below root.
+        void seekForward(const ArtNode* root, std::string_view target);
+        // Positions the stack on the last key not greater than target below root.
+        void seekReverse(const ArtNode* root, std::string_view target);
+        // Returns true if key is below the range.
+        bool belowRange(std::string_view key) const;
+        // Returns true if key is above the range.
+        bool aboveRange(std::string_view key) const;
 
-public:
-    // Constructor: initializes the Trie with a root node.
+    public:
+        // Advances to the next key. Returns false once no keys are left.
+        bool next();
+        // Returns the current key (valid until the next call to next() or until the Trie changes).
+        std::string_view key() const;
+    };
+
+    // Constructor: initializes an empty Trie.
     Trie();
     // Destructor: cleans up all nodes in the Trie.
     ~Trie();
+    // Nodes are owned through raw pointers, so the Trie cannot be copied.
+    Trie(const Trie&) = delete;
+    // Nodes are owned through raw pointers, so the Trie cannot be copied.
+    Trie& operator=(const Trie&) = delete;
 
     // Inserts a key into the Trie.
-    void insert(const std::string& key);
-    // Searches for keys in the Trie that start with the given prefix.
+    void insert(std::string_view key);
+    // Searches for keys in the Trie that start with the given prefix (returned in sorted order).
     std::vector<std::string> searchPrefix(const std::string& prefix) const;
+    // Returns an iterator over the keys that start with prefix, optionally resuming after the key startAfter.
+    KeyIterator scanPrefix(std::string_view prefix, std::optional<std::string_view> startAfter = std::nullopt) const;
+    // Returns an iterator over the keys in [start, end) (no end: every key from start on), optionally descending.
+    KeyIterator scanRange(std::string_view start, std::optional<std::string_view> end, bool reverse = false) const;
+    // Returns up to limit keys starting with prefix, resuming from cursor (CURSOR_START for the first page).
+    // The cursor encodes the last key returned, so pages stay consistent while keys are added or removed.
+    // Returns std::nullopt if cursor is malformed.
+    std::optional<PrefixPage> searchPrefix(const std::string& prefix, size_t limit, const std::string& cursor) const;
     // Deletes a key from the Trie. Returns true if key was found and deleted.
-    bool remove(const std::string& key);
+    bool remove(std::string_view key);
     // Checks if a key exists in the Trie.
-    bool contains(const std::string& key) const;
+    bool contains(std::string_view key) const;
+    // Returns the number of keys in the Trie.
+    size_t size() const;
+    // Returns the bytes allocated for nodes and leaves (excluding allocator overhead).
+    size_t memoryUsage() const;
+    // Returns the number of nodes: inner nodes plus one leaf per key.
+    size_t nodeCount() const;
 };
 
-#endif // TRIE_HPP
\ No newline at end of file
+#endif // TRIE_HPP
@@ -2,16 +2,22 @@
 #define UTILS_HPP
 
 #include <string>
-#include <vector> // For Bloom filter hash functions
+#include <string_view> // For hashing keys without copying them
+#include <cstdint> // For uint64_t
+#include <cstddef> // For size_t
 
-// Contains utility functions, like hash functions for the Bloom filter.
+// Contains utility functions, like the key hash shared by every data structure.
 namespace Utils {
-    // First hash function for Bloom Filter (example: simple variant of DJB2).
-    unsigned int hashFunction1(const std::string& key);
-    // Second hash function for Bloom Filter (example: SDBM hash).
-    unsigned int hashFunction2(const std::string& key);
-    // Third hash function for Bloom Filter (example: a different multiplicative hash).
-    unsigned int hashFunction3(const std::string& key);
+    // Fast, high-quality 64-bit hash (wyhash family). Short keys take two multiply-mixes; keys over
+    // 48 bytes are consumed 48 bytes per iteration across three independent lanes.
+    // KVStore computes it once per request and every structure derives its indices from it.
+    uint64_t hash64(std::string_view key);
+    // Returns the current wall-clock time in milliseconds since the Unix epoch (the unit of key expiry deadlines).
+    uint64_t unixMillis();
+    // Returns a small index unique among the live threads, assigned on the thread's first call. Indices of exited
+    // threads are handed out again, so they stay below the number of threads alive at once; per-thread slot arrays
+    // (EpochManager, StoreMetrics) are indexed by it.
+    size_t threadIndex();
 }
 
 #endif // UTILS_HPP
\ No newline at end of file
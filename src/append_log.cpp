@@ -0,0 +1,673 @@
+#include "../include/append_log.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <chrono> // For the flusher interval
+#include <cstring> // For std::memcpy
+#include <fcntl.h> // For open
+#include <unistd.h> // For write, fdatasync, ftruncate, close
+#include <sys/stat.h> // For fstat
+#include <cstdio> // For std::rename
+
+namespace {
+    // Bytes of the frame header: payload length and checksum.
+    constexpr size_t FRAME_HEADER_SIZE = 2 * sizeof(uint32_t);
+    // Longest LEB128 encoding of a 64-bit value.
+    constexpr size_t MAX_VARINT_BYTES = 10;
+    // Buffered bytes at which LogFileWriter writes out.
+    constexpr size_t WRITER_BUFFER_BYTES = 1 << 20;
+#ifdef KV_STORE_IO_URING
+    // Ring entries of an AppendLog: a linked write and fdatasync per batch.
+    constexpr unsigned LOG_RING_ENTRIES = 4;
+#endif
+
+    // Checksum stored in a frame: the low half of the payload's hash.
+    uint32_t frameChecksum(std::string_view payload) {
+        // Truncate the 64-bit hash.
+        return static_cast<uint32_t>(Utils::hash64(payload));
+    }
+
+    // Appends a LEB128 varint.
+    void appendVarint(std::string& out, uint64_t value) {
+        // Emit 7 bits at a time with a continuation flag.
+        while (value >= 0x80) {
+            // Low 7 bits plus continuation bit.
+            out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            // Drop the bits just written.
+            value >>= 7;
+        }
+        // Final byte without continuation bit.
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Reads a LEB128 varint that must end before end; returns nullptr if it does not.
+    const char* readVarint(const char* in, const char* end, uint64_t& value) {
+        // Accumulated value.
+        value = 0;
+        // Read at most the longest valid encoding.
+        for (size_t i = 0; i < MAX_VARINT_BYTES && in < end; ++i) {
+            // Current byte.
+            unsigned char byte = static_cast<unsigned char>(*in++);
+            // Merge its 7 payload bits.
+            value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+            // The last byte has no continuation bit.
+            if ((byte & 0x80) == 0) return in;
+        }
+        // Ran off the end or past ten bytes.
+        return nullptr;
+    }
+
+    // Reads a length-prefixed string that must end before end; returns nullptr if it does not.
+    const char* readBytes(const char* in, const char* end, std::string_view& bytes) {
+        // Length prefix.
+        uint64_t length;
+        // Decode it.
+        in = readVarint(in, end, length);
+        // The bytes must fit in what is left.
+        if (in == nullptr || length > static_cast<uint64_t>(end - in)) return nullptr;
+        // The bytes.
+        bytes = std::string_view(in, length);
+        // Position after them.
+        return in + length;
+    }
+
+    // Decodes a payload into record. Returns false if it is malformed.
+    bool decodePayload(std::string_view payload, LogRecord& record) {
+        // Cursor.
+        const char* in = payload.data();
+        // End of the payload.
+        const char* end = in + payload.size();
+        // Every payload starts with the op.
+        if (in == end) return false;
+        // Decode it.
+        record.op = static_cast<LogOp>(*in++);
+        // Then the key.
+        in = readBytes(in, end, record.key);
+        // Truncated key.
+        if (in == nullptr) return false;
+        // Op-specific tail.
+        switch (record.op) {
+            // Value follows.
+            case LogOp::Set: in = readBytes(in, end, record.value); break;
+            // Deadline follows.
+            case LogOp::ExpireAt:
+                // It must be all that is left.
+                if (static_cast<size_t>(end - in) != sizeof(uint64_t)) return false;
+                // Copy it out.
+                std::memcpy(&record.deadline, in, sizeof(uint64_t));
+                // Past it.
+                in = end;
+                // Done.
+                break;
+            // Nothing follows.
+            case LogOp::Remove: case LogOp::Persist: break;
+            // Unknown op: not a record this version wrote.
+            default: return false;
+        }
+        // The payload must be used up exactly.
+        return in == end;
+    }
+
+    // Writes all of data to fd, retrying short writes. Returns false on error.
+    bool writeAll(int fd, const char* data, size_t size) {
+        // Loop until everything is out.
+        for (size_t done = 0; done < size;) {
+            // Write what is left.
+            ssize_t written = ::write(fd, data + done, size - done);
+            // An error (or no progress) ends it.
+            if (written <= 0) return false;
+            // Advance.
+            done += static_cast<size_t>(written);
+        }
+        // All written.
+        return true;
+    }
+
+    // Fsyncs the directory holding path, so a rename into it survives a crash (best effort).
+    void syncParentDirectory(const std::string& path) {
+        // Directory holding the file.
+        std::string directory = path.find('/') == std::string::npos ? "." : path.substr(0, path.rfind('/') + 1);
+        // Open it.
+        int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        // Nothing more to do without it.
+        if (dirFd < 0) return;
+        // Sync the directory entry.
+        ::fsync(dirFd);
+        // Done with it.
+        ::close(dirFd);
+    }
+}
+
+// Appends record to out in the log's framed encoding.
+void AppendLog::encode(std::string& out, const LogRecord& record) {
+    // Frame header goes first; its fields are filled once the payload is known.
+    size_t frameStart = out.size();
+    // Reserve it.
+    out.append(FRAME_HEADER_SIZE, '\0');
+    // Op.
+    out.push_back(static_cast<char>(record.op));
+    // Key.
+    appendVarint(out, record.key.size());
+    // Key bytes.
+    out.append(record.key.data(), record.key.size());
+    // Value for Set.
+    if (record.op == LogOp::Set) {
+        // Length.
+        appendVarint(out, record.value.size());
+        // Bytes.
+        out.append(record.value.data(), record.value.size());
+    }
+    // Deadline for ExpireAt.
+    if (record.op == LogOp::ExpireAt) out.append(reinterpret_cast<const char*>(&record.deadline), sizeof(uint64_t));
+    // Payload just appended.
+    std::string_view payload(out.data() + frameStart + FRAME_HEADER_SIZE, out.size() - frameStart - FRAME_HEADER_SIZE);
+    // Length and checksum.
+    uint32_t header[2] = {static_cast<uint32_t>(payload.size()), frameChecksum(payload)};
+    // Fill the frame header.
+    std::memcpy(&out[frameStart], header, sizeof(header));
+}
+
+// Applies every valid record of the log at path, in order.
+LogReplayResult AppendLog::replay(const std::string& path, const std::function<void(const LogRecord&)>& apply) {
+    // Outcome.
+    LogReplayResult result;
+    // Open the log.
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    // A missing log replays nothing.
+    if (fd < 0) return result;
+    // Whole file.
+    std::string content;
+    // Its size.
+    struct stat info;
+    // Read it in one piece.
+    if (::fstat(fd, &info) == 0) content.resize(static_cast<size_t>(info.st_size));
+    // Bytes read so far.
+    size_t loaded = 0;
+    // Loop over short reads.
+    while (loaded < content.size()) {
+        // Read what is left.
+        ssize_t got = ::read(fd, &content[loaded], content.size() - loaded);
+        // Stop at an error or an early end.
+        if (got <= 0) break;
+        // Advance.
+        loaded += static_cast<size_t>(got);
+    }
+    // Done with the file.
+    ::close(fd);
+    // Only what was read counts.
+    content.resize(loaded);
+    // Offset of the next frame.
+    size_t offset = 0;
+    // Decoded record.
+    LogRecord record;
+    // Bytes from a record that does not check out but has data after it.
+    size_t damaged = 0;
+    // Walk the frames until one does not check out.
+    while (content.size() - offset >= FRAME_HEADER_SIZE) {
+        // Length and checksum.
+        uint32_t header[2];
+        // Copy them out.
+        std::memcpy(header, content.data() + offset, sizeof(header));
+        // A payload running past the end was torn mid-write.
+        if (header[0] > content.size() - offset - FRAME_HEADER_SIZE) break;
+        // The payload.
+        std::string_view payload(content.data() + offset + FRAME_HEADER_SIZE, header[0]);
+        // Partly written or damaged, or not a record.
+        if (frameChecksum(payload) != header[1] || !decodePayload(payload, record)) {
+            // Only the last frame can have been torn by a crash; one with more data after it was damaged in place.
+            if (offset + FRAME_HEADER_SIZE + header[0] != content.size()) damaged = content.size() - offset;
+            // Stop either way.
+            break;
+        }
+        // Apply it.
+        apply(record);
+        // Count it.
+        result.records++;
+        // Next frame.
+        offset += FRAME_HEADER_SIZE + header[0];
+    }
+    // Valid prefix.
+    result.validBytes = offset;
+    // Everything after it is a torn tail to drop, or damage to keep.
+    if (damaged != 0) result.damagedBytes = damaged; else result.truncatedBytes = content.size() - offset;
+    // Report.
+    return result;
+}
+
+// Constructor: opens the log for appending and starts the background flusher.
+AppendLog::AppendLog(const std::string& path, AppendFsync policy, size_t validBytes)
+    : path(path), policy(policy), fd(-1), rewriting(false), flushing(false), closing(false), pausedForFork(false),
+      appendedSequence(0),
+      writtenSequence(0), durableSequence(0), fileBytes(validBytes) {
+    // Open (creating) the file; O_APPEND keeps every write at the end.
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    // Cut a torn tail so new records follow the last valid one.
+    if (fd >= 0 && ::ftruncate(fd, static_cast<off_t>(validBytes)) != 0) counters.writeErrors++;
+    // Report the policy.
+    counters.policy = policy;
+#ifdef KV_STORE_IO_URING
+    // A write and an fdatasync per batch; a few spare entries.
+    ring = std::make_unique<IoRing>(LOG_RING_ENTRIES);
+    // Fall back to write + fdatasync without it.
+    if (!ring->isOpen()) ring.reset();
+#endif
+    // Always syncs in the writers; the others need the flusher.
+    if (policy != AppendFsync::Always) flusher = std::thread(&AppendLog::flushLoop, this);
+}
+
+// Destructor: writes and syncs what is buffered, stops the flusher and closes the file.
+AppendLog::~AppendLog() {
+    // Lock for the final flush.
+    {
+        // Exclusive access.
+        std::unique_lock<std::mutex> lock(mutex);
+        // Tell the flusher to stop.
+        closing = true;
+        // Everything appended goes to disk.
+        flushUpTo(lock, appendedSequence, true);
+    }
+    // Wake the flusher.
+    flushed.notify_all();
+    // Wait for it.
+    if (flusher.joinable()) flusher.join();
+    // Close the file.
+    if (fd >= 0) ::close(fd);
+}
+
+// Writes (and, if durable, fdatasyncs) everything appended up to target, as leader or by waiting for one.
+void AppendLog::flushUpTo(std::unique_lock<std::mutex>& lock, uint64_t target, bool durable) {
+    // Repeat until a flush covered target.
+    while ((durable ? durableSequence : writtenSequence) < target) {
+        // Another leader is writing; its flush (or the next one) covers us.
+        if (flushing) {
+            // Wait for it.
+            flushed.wait(lock);
+            // Check again.
+            continue;
+        }
+        // Become the leader.
+        flushing = true;
+        // Take everything buffered, including records appended by writers now waiting.
+        std::string batch;
+        // Swap it out, leaving an empty buffer for new appends.
+        batch.swap(pending);
+        // Last sequence number in the batch.
+        uint64_t batchEnd = appendedSequence;
+        // Descriptor to write to (a rewrite cannot swap it while flushing is set).
+        int fileFd = fd;
+        // Write without holding the lock, so other writers keep appending.
+        lock.unlock();
+        // Whether the batch reached the file.
+        bool wrote = false;
+        // One write for the whole batch, and one fdatasync if asked for.
+        bool synced = writeBatch(fileFd, batch, durable, wrote);
+        // Back under the lock.
+        lock.lock();
+        // Count the write.
+        if (!batch.empty()) counters.writes++;
+        // Count the sync.
+        if (durable) counters.syncs++;
+        // Count failures; the records are lost but waiters must not hang.
+        if (!synced) counters.writeErrors++;
+        // The file grew.
+        if (wrote) fileBytes += batch.size();
+        // Everything up to batchEnd is written.
+        writtenSequence = batchEnd;
+        // And durable, if synced.
+        if (durable) durableSequence = batchEnd;
+        // Step down.
+        flushing = false;
+        // Wake followers and the next leader.
+        flushed.notify_all();
+    }
+}
+
+// Writes a batch and, if durable, fdatasyncs it.
+bool AppendLog::writeBatch(int fileFd, const std::string& batch, bool durable, bool& wrote) {
+    // No file, nothing written.
+    wrote = false;
+    // The log could not be opened.
+    if (fileFd < 0) return false;
+#ifdef KV_STORE_IO_URING
+    // Submit the write and the fdatasync linked, so the leader enters the kernel once per group commit.
+    if (ring && !batch.empty()) {
+        // The write.
+        io_uring_sqe* write = ring->nextSqe();
+        // Plain write at the file position (O_APPEND puts it at the end).
+        write->opcode = IORING_OP_WRITE;
+        // File.
+        write->fd = fileFd;
+        // Source.
+        write->addr = reinterpret_cast<uint64_t>(batch.data());
+        // Length.
+        write->len = static_cast<uint32_t>(batch.size());
+        // Current position.
+        write->off = UINT64_MAX;
+        // Identify it.
+        write->user_data = 0;
+        // The fdatasync starts only once the write completed in full.
+        if (durable) {
+            // Chain it.
+            write->flags = IOSQE_IO_LINK;
+            // The sync.
+            io_uring_sqe* sync = ring->nextSqe();
+            // fsync...
+            sync->opcode = IORING_OP_FSYNC;
+            // ...of the log...
+            sync->fd = fileFd;
+            // ...data only, like fdatasync.
+            sync->fsync_flags = IORING_FSYNC_DATASYNC;
+            // Identify it.
+            sync->user_data = 1;
+        }
+        // Completions expected.
+        unsigned expected = durable ? 2 : 1;
+        // Submit both and wait for both.
+        if (ring->submit(expected) >= 0) {
+            // Write result (bytes or -errno).
+            int64_t written = -1;
+            // Sync result (0 when not asked for).
+            int32_t syncResult = 0;
+            // Reap them.
+            while (expected > 0) {
+                // Next completion.
+                io_uring_cqe* cqe = ring->peekCompletion();
+                // Not there yet: wait again.
+                if (cqe == nullptr) {
+                    // Entering the ring failed; treat the batch as failed.
+                    if (ring->submit(1) < 0) return false;
+                    // Check again.
+                    continue;
+                }
+                // Record its result.
+                if (cqe->user_data == 0) written = cqe->res; else syncResult = cqe->res;
+                // Consume it.
+                ring->advanceCompletion();
+                // One fewer.
+                expected--;
+            }
+            // A short write cancelled the linked sync: finish the rest the ordinary way.
+            if (written >= 0 && static_cast<size_t>(written) < batch.size()) {
+                // The remaining bytes.
+                wrote = writeAll(fileFd, batch.data() + written, batch.size() - static_cast<size_t>(written));
+                // And the sync.
+                return wrote && (!durable || ::fdatasync(fileFd) == 0);
+            }
+            // The whole batch landed.
+            wrote = written == static_cast<int64_t>(batch.size());
+            // And was synced if asked for.
+            return wrote && syncResult == 0;
+        }
+        // The entries may still be queued; stop using the ring rather than risk writing the batch twice.
+        ring.reset();
+    }
+#endif
+    // One write for the whole batch.
+    wrote = writeAll(fileFd, batch.data(), batch.size());
+    // And one fdatasync, if asked for.
+    return wrote && (!durable || ::fdatasync(fileFd) == 0);
+}
+
+// Body of the background flusher.
+void AppendLog::flushLoop() {
+    // Exclusive access between waits.
+    std::unique_lock<std::mutex> lock(mutex);
+    // Until the destructor stops it (or a fork pauses it).
+    while (!closing && !pausedForFork) {
+        // Sleep for an interval (or until closing or pausing).
+        flushed.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS), [this] { return closing || pausedForFork; });
+        // The destructor does the final flush; resumeAfterFork starts a new flusher.
+        if (closing || pausedForFork) break;
+        // Write what arrived, syncing under EverySec.
+        flushUpTo(lock, appendedSequence, policy == AppendFsync::EverySec);
+    }
+}
+
+// Returns false if the file could not be opened.
+bool AppendLog::isOpen() const {
+    // Set once by the constructor.
+    return fd >= 0;
+}
+
+// Returns the fsync policy.
+AppendFsync AppendLog::fsyncPolicy() const {
+    // Fixed at construction.
+    return policy;
+}
+
+// Buffers a record and returns its sequence number.
+uint64_t AppendLog::append(const LogRecord& record) {
+    // Exclusive access.
+    std::lock_guard<std::mutex> lock(mutex);
+    // Position of the record in the buffer.
+    size_t start = pending.size();
+    // Encode it.
+    encode(pending, record);
+    // A rewrite also needs it.
+    if (rewriting) rewriteBuffer.append(pending, start, std::string::npos);
+    // Count it.
+    counters.appendedRecords++;
+    // Its sequence number.
+    return ++appendedSequence;
+}
+
+// Under AppendFsync::Always, returns once every record up to sequence is on disk.
+void AppendLog::sync(uint64_t sequence) {
+    // The flusher handles the other policies.
+    if (policy != AppendFsync::Always) return;
+    // Exclusive access.
+    std::unique_lock<std::mutex> lock(mutex);
+    // Lead or follow a group commit.
+    flushUpTo(lock, sequence, true);
+}
+
+// Writes (without syncing) everything buffered.
+void AppendLog::flush() {
+    // Exclusive access.
+    std::unique_lock<std::mutex> lock(mutex);
+    // Up to the last record.
+    flushUpTo(lock, appendedSequence, false);
+}
+
+// Returns the size of the log in bytes, including buffered records.
+size_t AppendLog::sizeBytes() const {
+    // Exclusive access.
+    std::lock_guard<std::mutex> lock(mutex);
+    // Written plus buffered (a batch being written counts once it lands).
+    return fileBytes + pending.size();
+}
+
+// Starts keeping a copy of every record appended from now on for a rewrite.
+bool AppendLog::beginRewrite() {
+    // Exclusive access.
+    std::lock_guard<std::mutex> lock(mutex);
+    // One rewrite at a time.
+    if (rewriting) return false;
+    // Start collecting.
+    rewriting = true;
+    // Nothing collected yet.
+    rewriteBuffer.clear();
+    // Report it.
+    counters.rewriteInProgress = true;
+    // Started.
+    return true;
+}
+
+// Appends the kept records to the compacted log at tempPath and renames it over the log.
+bool AppendLog::finishRewrite(const std::string& tempPath) {
+    // Exclusive access.
+    std::unique_lock<std::mutex> lock(mutex);
+    // Nothing to finish.
+    if (!rewriting) return false;
+    // Wait out a leader still writing to the old file.
+    flushed.wait(lock, [this] { return !flushing; });
+    // The compacted log.
+    int newFd = ::open(tempPath.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    // Its size before the tail is added.
+    struct stat info;
+    // Append what changed since the rewrite started, make it durable and put it in place.
+    bool ok = newFd >= 0 && ::fstat(newFd, &info) == 0 && writeAll(newFd, rewriteBuffer.data(), rewriteBuffer.size()) &&
+              ::fdatasync(newFd) == 0 && std::rename(tempPath.c_str(), path.c_str()) == 0;
+    // Collection ends either way.
+    rewriting = false;
+    // Report it.
+    counters.rewriteInProgress = false;
+    // Keep the old log on failure.
+    if (!ok) {
+        // Drop the half-built file.
+        if (newFd >= 0) ::close(newFd);
+        // Remove it.
+        ::unlink(tempPath.c_str());
+        // Free the tail.
+        rewriteBuffer.clear();
+        // Count it.
+        counters.writeErrors++;
+        // The old log stays in use.
+        return false;
+    }
+    // Retire the old descriptor.
+    if (fd >= 0) ::close(fd);
+    // Continue in the new file.
+    fd = newFd;
+    // Compacted size plus the tail.
+    fileBytes = static_cast<size_t>(info.st_size) + rewriteBuffer.size();
+    // Buffered records are already in the tail, so they must not be written again.
+    pending.clear();
+    // Everything appended is in the new file.
+    writtenSequence = appendedSequence;
+    // And on disk.
+    durableSequence = appendedSequence;
+    // Free the tail.
+    rewriteBuffer.clear();
+    // Count the rewrite.
+    counters.rewrites++;
+    // Persist the rename.
+    syncParentDirectory(path);
+    // Replaced.
+    return true;
+}
+
+// Stops a rewrite without replacing the log.
+void AppendLog::abortRewrite() {
+    // Exclusive access.
+    std::lock_guard<std::mutex> lock(mutex);
+    // Stop collecting.
+    rewriting = false;
+    // Free the tail.
+    rewriteBuffer.clear();
+    // Report it.
+    counters.rewriteInProgress = false;
+}
+
+// Stops the flusher and returns holding the lock once no leader is writing.
+void AppendLog::pauseForFork() {
+    // Exclusive access.
+    std::unique_lock<std::mutex> lock(mutex);
+    // Tell the flusher to leave its loop.
+    pausedForFork = true;
+    // Let it take the lock and see the flag.
+    lock.unlock();
+    // Wake it.
+    flushed.notify_all();
+    // Wait for it (it may first finish a write it started).
+    if (flusher.joinable()) flusher.join();
+    // Back under the lock.
+    lock.lock();
+    // A group-commit leader writes outside the lock; wait for it to step down.
+    flushed.wait(lock, [this] { return !flushing; });
+    // Keep the lock held across the fork; resumeAfterFork releases it.
+    lock.release();
+}
+
+// Releases the lock taken by pauseForFork and restarts the flusher.
+void AppendLog::resumeAfterFork() {
+    // Still held from pauseForFork.
+    pausedForFork = false;
+    // Let appends in again.
+    mutex.unlock();
+    // Always syncs in the writers; the others need the flusher back.
+    if (policy != AppendFsync::Always) flusher = std::thread(&AppendLog::flushLoop, this);
+}
+
+// Returns the log's counters.
+AppendLogStats AppendLog::stats() const {
+    // Exclusive access.
+    std::lock_guard<std::mutex> lock(mutex);
+    // Copy the counters.
+    AppendLogStats result = counters;
+    // Current size.
+    result.sizeBytes = fileBytes + pending.size();
+    // Report.
+    return result;
+}
+
+// Records what replay found, for stats.
+void AppendLog::setReplayResult(const LogReplayResult& result) {
+    // Exclusive access.
+    std::lock_guard<std::mutex> lock(mutex);
+    // Records applied.
+    counters.replayedRecords = result.records;
+    // Torn bytes dropped.
+    counters.truncatedBytes = result.truncatedBytes;
+    // Damaged bytes moved aside.
+    counters.damagedBytes = result.damagedBytes;
+}
+
+// Constructor: creates (truncating) the file at path.
+LogFileWriter::LogFileWriter(const std::string& path) : fd(-1), failed(false) {
+    // Create the file.
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    // Nothing can be written without it.
+    if (fd < 0) failed = true;
+    // Room for one write.
+    buffer.reserve(WRITER_BUFFER_BYTES);
+#ifdef KV_STORE_IO_URING
+    // Keep several writes in flight while the next records are encoded.
+    if (fd >= 0) ringWriter = std::make_unique<RingFileWriter>(fd, 0);
+    // Fall back to blocking writes without it.
+    if (ringWriter && !ringWriter->isOpen()) ringWriter.reset();
+#endif
+}
+
+// Destructor: closes the file.
+LogFileWriter::~LogFileWriter() {
+    // Close the descriptor.
+    if (fd >= 0) ::close(fd);
+}
+
+// Writes the buffer out.
+void LogFileWriter::flushBuffer() {
+#ifdef KV_STORE_IO_URING
+    // Queue it behind the writes in flight.
+    if (ringWriter) {
+        // Copied into a registered buffer.
+        ringWriter->write(buffer.data(), buffer.size());
+        // Start again.
+        buffer.clear();
+        // Done.
+        return;
+    }
+#endif
+    // Write it unless an earlier write failed.
+    if (!failed && !writeAll(fd, buffer.data(), buffer.size())) failed = true;
+    // Start again.
+    buffer.clear();
+}
+
+// Adds a record.
+void LogFileWriter::add(const LogRecord& record) {
+    // Encode it.
+    AppendLog::encode(buffer, record);
+    // Write out a full buffer.
+    if (buffer.size() >= WRITER_BUFFER_BYTES) flushBuffer();
+}
+
+// Writes everything and fsyncs the file.
+bool LogFileWriter::commit() {
+    // Write the rest.
+    flushBuffer();
+#ifdef KV_STORE_IO_URING
+    // Wait for every write and fsync in one submission.
+    if (ringWriter) return ringWriter->finish(true) && !failed;
+#endif
+    // Make it durable.
+    return !failed && ::fsync(fd) == 0;
+}
@@ -1,56 +1,210 @@
 #include "../include/bloom_filter.hpp"
-#include "../include/utils.hpp" // For Utils::hashFunction1, etc.
+#include "../include/utils.hpp" // For Utils::hash64
+#include <cmath> // For std::log, std::exp, std::lgamma
+#include <algorithm> // For std::max, std::min
+#if defined(__SSE2__)
+#include <emmintrin.h> // For 128-bit mask comparisons
+#endif
 
-// Constructor: initializes the Bloom Filter with a given size and number of hash functions.
+// Out-of-line definition of the block size.
+constexpr size_t BloomFilter::BLOCK_BITS;
+
+// Constructor: initializes the Bloom Filter with at least size bits and numHashes bits per key.
 BloomFilter::BloomFilter(size_t size, size_t numHashes)
-    : arraySize(size), numHashFunctions(numHashes) {
-    // Resize the bit array to the specified size and initialize all bits to false.
-    bitArray.resize(arraySize, false);
+    : numHashFunctions(numHashes) {
+    // Round the requested size up to whole blocks (a size of 0 gives an empty filter).
+    size_t numBlocks = (size + BLOCK_BITS - 1) / BLOCK_BITS;
+    // Allocate the blocks with every bit cleared.
+    blocks.assign(numBlocks, Block{});
+}
 
-    if (numHashes >= 1) {
-        // Add first hash function.
-        hashFunctions.push_back(Utils::hashFunction1);
-    }
-    // If at least two hash functions are requested.
-    if (numHashes >= 2) {
-        // Add second hash function.
-        hashFunctions.push_back(Utils::hashFunction2);
+// Returns a filter sized so that expectedKeys keys give a false-positive rate of about targetFpr.
+BloomFilter BloomFilter::forExpectedKeys(size_t expectedKeys, double targetFpr) {
+    // Bits needed for the target rate.
+    size_t bits = optimalNumBits(expectedKeys, targetFpr);
+    // Build the filter with the matching number of bits per key.
+    return BloomFilter(bits, optimalNumHashes(bits, expectedKeys));
+}
+
+// Returns the number of bits a blocked filter needs for expectedKeys keys at targetFpr.
+size_t BloomFilter::optimalNumBits(size_t expectedKeys, double targetFpr) {
+    // An empty filter still gets one block so lookups stay valid.
+    if (expectedKeys == 0) return BLOCK_BITS;
+    // Keep the target in a range where the formulas below are meaningful.
+    targetFpr = std::min(std::max(targetFpr, 1e-9), 0.5);
+    // Natural log of 2.
+    const double ln2 = std::log(2.0);
+    // Textbook size of an unblocked filter: m = -n ln p / (ln 2)^2.
+    double bits = -static_cast<double>(expectedKeys) * std::log(targetFpr) / (ln2 * ln2);
+    // Blocking loads some blocks more than others, so grow in 5% steps until the blocked estimate meets the target.
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        // Round the candidate up to whole blocks.
+        size_t candidate = (static_cast<size_t>(std::ceil(bits)) + BLOCK_BITS - 1) / BLOCK_BITS * BLOCK_BITS;
+        // Accept the first size whose estimate is within the target.
+        if (estimateFalsePositiveRate(candidate, optimalNumHashes(candidate, expectedKeys), expectedKeys) <= targetFpr) {
+            // Return the accepted size.
+            return candidate;
+        }
+        // Try a larger filter.
+        bits *= 1.05;
     }
-    // If at least three hash functions are requested.
-    if (numHashes >= 3) {
-        // Add third hash function.
-        hashFunctions.push_back(Utils::hashFunction3);
+    // Fall back to the largest candidate tried.
+    return (static_cast<size_t>(std::ceil(bits)) + BLOCK_BITS - 1) / BLOCK_BITS * BLOCK_BITS;
+}
+
+// Returns the number of bits per key that minimizes the false-positive rate for a filter of numBits bits.
+size_t BloomFilter::optimalNumHashes(size_t numBits, size_t expectedKeys) {
+    // With no keys any k works; use one.
+    if (expectedKeys == 0) return 1;
+    // k = (m / n) ln 2, rounded, at least one.
+    double k = static_cast<double>(numBits) / static_cast<double>(expectedKeys) * std::log(2.0);
+    // Round to the nearest whole number of bits.
+    return std::max<size_t>(1, static_cast<size_t>(std::lround(k)));
+}
+
+// Returns the expected false-positive rate of a blocked filter.
+double BloomFilter::estimateFalsePositiveRate(size_t numBits, size_t numHashes, size_t numKeys) {
+    // Number of blocks in the filter.
+    size_t numBlocks = numBits / BLOCK_BITS;
+    // An empty filter rejects everything.
+    if (numBlocks == 0) return 0.0;
+    // Average number of keys per block; the actual load is Poisson distributed around it.
+    double lambda = static_cast<double>(numKeys) / static_cast<double>(numBlocks);
+    // Probability that one key leaves a given bit of its block clear.
+    double clearPerKey = std::pow(1.0 - 1.0 / static_cast<double>(BLOCK_BITS), static_cast<double>(numHashes));
+    // Sum over block loads within 12 standard deviations of the mean.
+    double spread = 12.0 * std::sqrt(lambda) + 12.0;
+    // Lowest load considered.
+    size_t lowest = static_cast<size_t>(std::max(0.0, lambda - spread));
+    // Highest load considered.
+    size_t highest = static_cast<size_t>(lambda + spread);
+    // Accumulated false-positive probability.
+    double rate = 0.0;
+    // Weight each block load by its Poisson probability.
+    for (size_t load = lowest; load <= highest; ++load) {
+        // Poisson probability of this load, computed in log space to avoid overflow.
+        double weight = lambda == 0.0 ? (load == 0 ? 1.0 : 0.0)
+            : std::exp(static_cast<double>(load) * std::log(lambda) - lambda - std::lgamma(static_cast<double>(load) + 1.0));
+        // Fraction of the block's bits set at this load.
+        double setFraction = 1.0 - std::pow(clearPerKey, static_cast<double>(load));
+        // All k probed bits must be set for a false positive.
+        rate += weight * std::pow(setFraction, static_cast<double>(numHashes));
     }
-    // Ensure numHashFunctions does not exceed available hash functions.
-    this->numHashFunctions = hashFunctions.size();
+    // Return the expected rate.
+    return rate;
 }
 
+// Returns the block responsible for a key hash.
+size_t BloomFilter::blockIndex(uint64_t hashCode) const {
+    // Remix the hash so the block choice does not reuse the bits ShardedKVStore selects shards with.
+    uint64_t mixed = hashCode * 0x9E3779B97F4A7C15ull;
+    // Map the top 32 bits onto [0, blocks) with a multiply-shift instead of a division.
+    return static_cast<size_t>(((mixed >> 32) * static_cast<uint64_t>(blocks.size())) >> 32);
+}
 
-// Adds a key to the Bloom Filter.
-void BloomFilter::add(const std::string& key) {
-    // Iterate through each hash function.
+// Builds the 512-bit mask of a key's k bit positions within its block.
+void BloomFilter::keyMask(uint64_t hashCode, uint64_t (&mask)[BLOCK_WORDS]) const {
+    // Start from an empty mask.
+    for (size_t w = 0; w < BLOCK_WORDS; ++w) mask[w] = 0;
+    // First base hash: the key hash with its halves swapped, so its top bits are not the shard-selecting ones.
+    uint64_t h1 = (hashCode << 32) | (hashCode >> 32);
+    // Second base hash: the key hash spread by an odd multiplier.
+    uint64_t h2 = hashCode * 0xC2B2AE3D27D4EB4Full;
+    // Set each of the k bits (enhanced double hashing; the top 9 bits pick the position).
     for (size_t i = 0; i < numHashFunctions; ++i) {
-        // Compute the hash value for the key using the current hash function.
-        unsigned int hashValue = hashFunctions[i](key) % arraySize;
-        // Set the bit at the computed index to true.
-        bitArray[hashValue] = true;
+        // Position of the i-th bit inside the block.
+        uint64_t bit = h1 >> 55;
+        // Set it in the mask.
+        mask[bit >> 6] |= uint64_t(1) << (bit & 63);
+        // Step to the next position.
+        h1 += h2;
+        // Grow the step each round, so a step that happens to divide the block evenly cannot repeat bits.
+        h2 += static_cast<uint64_t>(i) * 0x9E3779B97F4A7C15ull;
+    }
+}
+
+// Adds a key to the Bloom Filter.
+void BloomFilter::add(std::string_view key) {
+    // Hash the key and forward.
+    add(Utils::hash64(key));
+}
+
+// Adds a key given its precomputed hash.
+void BloomFilter::add(uint64_t hashCode) {
+    // A zero-sized filter holds nothing.
+    if (blocks.empty()) return;
+    // The key's bits within its block.
+    uint64_t mask[BLOCK_WORDS];
+    // Build them.
+    keyMask(hashCode, mask);
+    // The key's block.
+    Block& block = blocks[blockIndex(hashCode)];
+    // Set every bit of the mask in one pass over the cache line.
+    for (size_t w = 0; w < BLOCK_WORDS; ++w) {
+        // Merge one word.
+        block.words[w] |= mask[w];
     }
 }
 
 // Checks if a key might exist in the set.
-bool BloomFilter::possiblyContains(const std::string& key) const {
+bool BloomFilter::possiblyContains(std::string_view key) const {
+    // Hash the key and forward.
+    return possiblyContains(Utils::hash64(key));
+}
+
+// Checks if a key might exist given its precomputed hash.
+bool BloomFilter::possiblyContains(uint64_t hashCode) const {
     // If the bit array is empty (e.g. size 0), nothing can be contained.
-    if (arraySize == 0) return false;
-    // Iterate through each hash function.
-    for (size_t i = 0; i < numHashFunctions; ++i) {
-        // Compute the hash value for the key.
-        unsigned int hashValue = hashFunctions[i](key) % arraySize;
-        // If the bit at the computed index is false.
-        if (!bitArray[hashValue]) {
-            // The key definitely does not exist.
-            return false;
-        }
+    if (blocks.empty()) return false;
+    // The key's bits within its block.
+    alignas(16) uint64_t mask[BLOCK_WORDS];
+    // Build them.
+    keyMask(hashCode, mask);
+    // The key's block (the only cache line of the filter this lookup reads).
+    const Block& block = blocks[blockIndex(hashCode)];
+#if defined(__SSE2__)
+    // Accumulates mask bits missing from the block.
+    __m128i missing = _mm_setzero_si128();
+    // Compare the block 128 bits at a time.
+    for (size_t w = 0; w < BLOCK_WORDS; w += 2) {
+        // Two words of the block.
+        __m128i bits = _mm_load_si128(reinterpret_cast<const __m128i*>(&block.words[w]));
+        // The matching two words of the mask.
+        __m128i wanted = _mm_load_si128(reinterpret_cast<const __m128i*>(&mask[w]));
+        // Collect mask bits that are clear in the block.
+        missing = _mm_or_si128(missing, _mm_andnot_si128(bits, wanted));
+    }
+    // The key might be present only if no mask bit was missing.
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+    // Portable fallback: accumulate missing bits word by word.
+    uint64_t missing = 0;
+    // Compare each word.
+    for (size_t w = 0; w < BLOCK_WORDS; ++w) {
+        // Collect mask bits that are clear in the block.
+        missing |= mask[w] & ~block.words[w];
     }
-    // All corresponding bits are true, so the key might exist (could be a false positive).
-    return true;
-}
\ No newline at end of file
+    // The key might be present only if no mask bit was missing.
+    return missing == 0;
+#endif
+}
+
+// Starts loading the block of a key hash into cache.
+void BloomFilter::prefetch(uint64_t hashCode) const {
+    // An empty filter has nothing to load.
+    if (blocks.empty()) return;
+    // The block is one cache line; the lookup reading it follows shortly.
+    __builtin_prefetch(&blocks[blockIndex(hashCode)], 0, 3);
+}
+
+// Returns the size of the bit array in bits.
+size_t BloomFilter::numBits() const {
+    // Whole blocks only.
+    return blocks.size() * BLOCK_BITS;
+}
+
+// Returns the number of bit positions set per key.
+size_t BloomFilter::numHashes() const {
+    // As configured.
+    return numHashFunctions;
+}
@@ -0,0 +1,335 @@
+#include "../include/concurrent_hash_map.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <cstring> // For std::memcpy, std::memcmp
+
+namespace {
+    // Record header: hash (8 bytes), key length (4), value length (4); the key and value bytes follow.
+    constexpr size_t RECORD_HEADER = 16;
+    // Its address marks a removed slot (a sentinel no record can share).
+    const char tombstoneMarker = 0;
+    // Slot value of a removed entry.
+    const char* const TOMBSTONE = &tombstoneMarker;
+
+    // Reads a record's hash.
+    uint64_t recordHash(const char* record) {
+        // Unaligned-safe read.
+        uint64_t hashCode;
+        // Copy it out.
+        std::memcpy(&hashCode, record, sizeof(hashCode));
+        // Report it.
+        return hashCode;
+    }
+
+    // Reads a record's key length.
+    uint32_t recordKeyLength(const char* record) {
+        // Unaligned-safe read.
+        uint32_t length;
+        // Copy it out.
+        std::memcpy(&length, record + 8, sizeof(length));
+        // Report it.
+        return length;
+    }
+
+    // Reads a record's value length.
+    uint32_t recordValueLength(const char* record) {
+        // Unaligned-safe read.
+        uint32_t length;
+        // Copy it out.
+        std::memcpy(&length, record + 12, sizeof(length));
+        // Report it.
+        return length;
+    }
+}
+
+// Constructor: capacity empty slots.
+ConcurrentHashMap::Table::Table(size_t capacity) : mask(capacity - 1), slots(new std::atomic<const char*>[capacity]) {
+    // Every slot starts unused.
+    for (size_t i = 0; i < capacity; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+}
+
+// Destructor: frees the slot array (not the records).
+ConcurrentHashMap::Table::~Table() {
+    // Allocated by the constructor.
+    delete[] slots;
+}
+
+// Constructor: sized for capacity entries before the first rebuild.
+ConcurrentHashMap::ConcurrentHashMap(size_t capacity, double maxLoad)
+    : table(nullptr), count(0), usedSlots(0), rebuildThreshold(0), maxLoadFactor(maxLoad) {
+    // Keep the load factor sane (at least one slot must stay empty so probes end).
+    if (maxLoadFactor <= 0.0 || maxLoadFactor > 0.9) maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    // Slots for capacity entries within the load factor.
+    size_t slotCount = MIN_CAPACITY;
+    // Double until they fit.
+    while (static_cast<double>(slotCount) * maxLoadFactor < static_cast<double>(capacity)) slotCount <<= 1;
+    // The first table.
+    table.store(new Table(slotCount), std::memory_order_release);
+    // Rebuild once it is full.
+    rebuildThreshold = static_cast<size_t>(static_cast<double>(slotCount) * maxLoadFactor);
+}
+
+// Destructor: frees every record and table (no reader or writer may be active).
+ConcurrentHashMap::~ConcurrentHashMap() {
+    // The current table.
+    Table* current = table.load(std::memory_order_acquire);
+    // Free its records.
+    for (size_t i = 0; i <= current->mask; ++i) {
+        // The slot's content.
+        const char* record = current->slots[i].load(std::memory_order_relaxed);
+        // A live record.
+        if (record != nullptr && record != TOMBSTONE) destroyRecord(const_cast<char*>(record));
+    }
+    // Free the table; the EpochManager frees whatever was retired.
+    delete current;
+}
+
+// Hash function used by the overloads without a precomputed hash.
+uint64_t ConcurrentHashMap::hash(std::string_view key) {
+    // Shared with every other structure.
+    return Utils::hash64(key);
+}
+
+// Allocates a record holding the hash, key and value.
+const char* ConcurrentHashMap::makeRecord(std::string_view key, std::string_view value, uint64_t hashCode) {
+    // Header plus the bytes.
+    char* record = new char[RECORD_HEADER + key.size() + value.size()];
+    // Lengths as stored.
+    uint32_t keyLength = static_cast<uint32_t>(key.size());
+    // Lengths as stored.
+    uint32_t valueLength = static_cast<uint32_t>(value.size());
+    // Hash.
+    std::memcpy(record, &hashCode, sizeof(hashCode));
+    // Key length.
+    std::memcpy(record + 8, &keyLength, sizeof(keyLength));
+    // Value length.
+    std::memcpy(record + 12, &valueLength, sizeof(valueLength));
+    // Key bytes.
+    std::memcpy(record + RECORD_HEADER, key.data(), key.size());
+    // Value bytes.
+    std::memcpy(record + RECORD_HEADER + key.size(), value.data(), value.size());
+    // Immutable from here on.
+    return record;
+}
+
+// Returns true if a record holds key.
+bool ConcurrentHashMap::matches(const char* record, std::string_view key, uint64_t hashCode) {
+    // Compare the hash first, then the length, then the bytes.
+    return recordHash(record) == hashCode && recordKeyLength(record) == key.size()
+        && std::memcmp(record + RECORD_HEADER, key.data(), key.size()) == 0;
+}
+
+// Frees a record (an EpochManager destroy callback).
+void ConcurrentHashMap::destroyRecord(void* record) {
+    // Allocated by makeRecord.
+    delete[] static_cast<char*>(record);
+}
+
+// Frees a table (an EpochManager destroy callback).
+void ConcurrentHashMap::destroyTable(void* table) {
+    // Allocated by the constructor or rebuild.
+    delete static_cast<Table*>(table);
+}
+
+// Finds the record holding key in a table under an epoch guard, or returns nullptr.
+const char* ConcurrentHashMap::findRecord(const Table& current, std::string_view key, uint64_t hashCode) {
+    // Linear probing from the hash's home slot.
+    for (size_t index = hashCode & current.mask;; index = (index + 1) & current.mask) {
+        // Pairs with the writer's release, so the record's bytes are visible.
+        const char* record = current.slots[index].load(std::memory_order_acquire);
+        // Never used: the key is absent.
+        if (record == nullptr) return nullptr;
+        // Found it.
+        if (record != TOMBSTONE && matches(record, key, hashCode)) return record;
+    }
+}
+
+// Copies the live records into a table sized for the current entries and publishes it (writers only).
+void ConcurrentHashMap::rebuild() {
+    // The table being replaced.
+    Table* old = table.load(std::memory_order_relaxed);
+    // Live entries.
+    size_t live = count.load(std::memory_order_relaxed);
+    // Leave room to double before the next rebuild (a table full of tombstones is just purged).
+    size_t slotCount = MIN_CAPACITY;
+    // Double until the entries fill half the load factor.
+    while (static_cast<double>(slotCount) * maxLoadFactor < static_cast<double>((live + 1) * 2)) slotCount <<= 1;
+    // The new table (private until published, so plain relaxed stores suffice).
+    Table* fresh = new Table(slotCount);
+    // Move each live record pointer over (records are shared, not copied).
+    for (size_t i = 0; i <= old->mask; ++i) {
+        // The slot's content.
+        const char* record = old->slots[i].load(std::memory_order_relaxed);
+        // Unused or removed.
+        if (record == nullptr || record == TOMBSTONE) continue;
+        // First free slot along its probe sequence.
+        size_t index = recordHash(record) & fresh->mask;
+        // A fresh table has no tombstones.
+        while (fresh->slots[index].load(std::memory_order_relaxed) != nullptr) index = (index + 1) & fresh->mask;
+        // Place it.
+        fresh->slots[index].store(record, std::memory_order_relaxed);
+    }
+    // Publish it; readers already probing the old table finish there.
+    table.store(fresh, std::memory_order_release);
+    // Free the old one once they have.
+    epochs.retire(old, destroyTable);
+    // Only live entries occupy the new table.
+    usedSlots = live;
+    // Rebuild once it is full.
+    rebuildThreshold = static_cast<size_t>(static_cast<double>(slotCount) * maxLoadFactor);
+}
+
+// Inserts or updates a key-value pair.
+bool ConcurrentHashMap::set(std::string_view key, std::string_view value) {
+    // Hash once.
+    return set(key, value, hash(key));
+}
+
+// Inserts or updates a key-value pair with a precomputed hash.
+bool ConcurrentHashMap::set(std::string_view key, std::string_view value, uint64_t hashCode) {
+    // One writer at a time.
+    std::lock_guard<std::mutex> lock(writeLock);
+    // An insert may take the last free slot: rebuild first.
+    if (usedSlots + 1 > rebuildThreshold) rebuild();
+    // The table (only writers replace it, and this one holds the lock).
+    Table* current = table.load(std::memory_order_relaxed);
+    // First tombstone along the probe, reused by an insert.
+    size_t reuse = current->mask + 1;
+    // Linear probing from the hash's home slot.
+    size_t index = hashCode & current->mask;
+    // Look for the key.
+    for (;; index = (index + 1) & current->mask) {
+        // The slot's content.
+        const char* record = current->slots[index].load(std::memory_order_relaxed);
+        // Never used: the key is absent.
+        if (record == nullptr) break;
+        // Removed: remember the first one.
+        if (record == TOMBSTONE) {
+            // Only the first.
+            if (reuse > current->mask) reuse = index;
+            // Keep looking.
+            continue;
+        }
+        // Present: publish a replacement record.
+        if (matches(record, key, hashCode)) {
+            // Readers see either the old or the new record, never a mix.
+            current->slots[index].store(makeRecord(key, value, hashCode), std::memory_order_release);
+            // Free the old one once readers are done with it.
+            epochs.retire(const_cast<char*>(record), destroyRecord);
+            // Updated.
+            return false;
+        }
+    }
+    // Fill a tombstone if there was one; otherwise the empty slot that ended the probe.
+    if (reuse <= current->mask) index = reuse;
+    // A never-used slot is now in use.
+    else ++usedSlots;
+    // Publish the record.
+    current->slots[index].store(makeRecord(key, value, hashCode), std::memory_order_release);
+    // One more entry.
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    // Inserted.
+    return true;
+}
+
+// Deletes a key-value pair.
+bool ConcurrentHashMap::remove(std::string_view key) {
+    // Hash once.
+    return remove(key, hash(key));
+}
+
+// Deletes a key-value pair with a precomputed hash.
+bool ConcurrentHashMap::remove(std::string_view key, uint64_t hashCode) {
+    // One writer at a time.
+    std::lock_guard<std::mutex> lock(writeLock);
+    // The table (only writers replace it, and this one holds the lock).
+    Table* current = table.load(std::memory_order_relaxed);
+    // Linear probing from the hash's home slot.
+    for (size_t index = hashCode & current->mask;; index = (index + 1) & current->mask) {
+        // The slot's content.
+        const char* record = current->slots[index].load(std::memory_order_relaxed);
+        // Never used: the key is absent.
+        if (record == nullptr) return false;
+        // Not this one.
+        if (record == TOMBSTONE || !matches(record, key, hashCode)) continue;
+        // Probes keep going past a tombstone.
+        current->slots[index].store(TOMBSTONE, std::memory_order_release);
+        // Free the record once readers are done with it.
+        epochs.retire(const_cast<char*>(record), destroyRecord);
+        // One entry fewer.
+        count.store(count.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+        // Removed.
+        return true;
+    }
+}
+
+// Copies the value of key into value.
+bool ConcurrentHashMap::get(std::string_view key, std::string& value) const {
+    // Hash once.
+    return get(key, hash(key), value);
+}
+
+// Copies the value of key into value, with a precomputed hash.
+bool ConcurrentHashMap::get(std::string_view key, uint64_t hashCode, std::string& value) const {
+    // Keeps the table and record alive until the copy is done.
+    EpochManager::Guard guard(epochs);
+    // Pairs with the writer's release, so a rebuilt table's slots are visible.
+    const char* record = findRecord(*table.load(std::memory_order_acquire), key, hashCode);
+    // Absent.
+    if (record == nullptr) return false;
+    // Copy the value out while it is guarded.
+    value.assign(record + RECORD_HEADER + recordKeyLength(record), recordValueLength(record));
+    // Found.
+    return true;
+}
+
+// Checks if a key exists.
+bool ConcurrentHashMap::contains(std::string_view key) const {
+    // Hash once.
+    return contains(key, hash(key));
+}
+
+// Checks if a key exists, with a precomputed hash.
+bool ConcurrentHashMap::contains(std::string_view key, uint64_t hashCode) const {
+    // Keeps the table and record alive until the comparison is done.
+    EpochManager::Guard guard(epochs);
+    // Probe the published table.
+    return findRecord(*table.load(std::memory_order_acquire), key, hashCode) != nullptr;
+}
+
+// Returns the current number of elements.
+size_t ConcurrentHashMap::size() const {
+    // Exact once writers are quiet.
+    return count.load(std::memory_order_relaxed);
+}
+
+// Returns the number of slots of the current table.
+size_t ConcurrentHashMap::capacity() const {
+    // Keeps the table alive while it is read.
+    EpochManager::Guard guard(epochs);
+    // Its slot count.
+    return table.load(std::memory_order_acquire)->mask + 1;
+}
+
+// Frees whatever retired records and tables no reader can still see.
+size_t ConcurrentHashMap::reclaim() {
+    // The EpochManager belongs to the writers.
+    std::lock_guard<std::mutex> lock(writeLock);
+    // Advance and free.
+    return epochs.reclaim();
+}
+
+// Returns the number of retired records and tables not yet freed.
+size_t ConcurrentHashMap::pendingReclamation() {
+    // The EpochManager belongs to the writers.
+    std::lock_guard<std::mutex> lock(writeLock);
+    // Still in limbo.
+    return epochs.pending();
+}
+
+// Returns the number of retired records and tables freed so far.
+uint64_t ConcurrentHashMap::reclaimedCount() {
+    // The EpochManager belongs to the writers.
+    std::lock_guard<std::mutex> lock(writeLock);
+    // Freed.
+    return epochs.freed();
+}
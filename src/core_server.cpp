@@ -0,0 +1,247 @@
+#include "../include/core_server.hpp"
+#include <algorithm> // For std::max
+#include <thread> // For the per-core threads
+#include <pthread.h> // For pthread_setaffinity_np
+#include <sched.h> // For CPU sets
+
+// Constructor: room for capacity batches.
+PeerQueue::PeerQueue(size_t capacity) : mask(0), head(0), cachedTail(0), tail(0), cachedHead(0) {
+    // Round up to a power of two, so an index maps to its slot with a mask.
+    size_t size = 1;
+    // Double until it fits.
+    while (size < capacity) size <<= 1;
+    // The slots.
+    slots.resize(size);
+    // Remember the mask.
+    mask = size - 1;
+}
+
+// Producer: moves batch in, unless the queue is full.
+bool PeerQueue::push(std::vector<CoreMessage>& batch) {
+    // Only the producer writes tail.
+    size_t position = tail.load(std::memory_order_relaxed);
+    // Full as far as the cached head knows: look at the real one.
+    if (position - cachedHead == slots.size()) {
+        // Pairs with the consumer's release, so the slot it emptied is free.
+        cachedHead = head.load(std::memory_order_acquire);
+        // Really full.
+        if (position - cachedHead == slots.size()) return false;
+    }
+    // Fill the slot.
+    slots[position & mask] = std::move(batch);
+    // Publish it to the consumer.
+    tail.store(position + 1, std::memory_order_release);
+    // Queued.
+    return true;
+}
+
+// Consumer: moves the oldest batch out, unless the queue is empty.
+bool PeerQueue::pop(std::vector<CoreMessage>& batch) {
+    // Only the consumer writes head.
+    size_t position = head.load(std::memory_order_relaxed);
+    // Empty as far as the cached tail knows: look at the real one.
+    if (position == cachedTail) {
+        // Pairs with the producer's release, so the batch it published is visible.
+        cachedTail = tail.load(std::memory_order_acquire);
+        // Really empty.
+        if (position == cachedTail) return false;
+    }
+    // Take the batch.
+    batch = std::move(slots[position & mask]);
+    // Hand the slot back to the producer.
+    head.store(position + 1, std::memory_order_release);
+    // Taken.
+    return true;
+}
+
+// Consumer: returns true if nothing is queued.
+bool PeerQueue::empty() const {
+    // Fresh look at the producer's index.
+    return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+}
+
+// Constructor: creates the partitions, their event loops and the queues between them.
+CoreServer::CoreServer(size_t cores, const KVStoreConfig& perCoreConfig, const ServerConfig& config) : settings(config) {
+    // Default to one core per hardware thread.
+    if (cores == 0) {
+        // hardware_concurrency may report 0 when unknown.
+        cores = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    // Every core listens on the same port.
+    settings.reusePort = true;
+    // Each partition's configuration (only the file paths differ between cores).
+    KVStoreConfig coreConfig = perCoreConfig;
+    // The loop syncs the log once per iteration, before any reply (local or forwarded) leaves the core.
+    coreConfig.appendLogDeferSync = true;
+    // Create each core's partition.
+    for (size_t i = 0; i < cores; ++i) {
+        // Each core logs to (and replays) its own file.
+        if (!perCoreConfig.appendLogPath.empty()) coreConfig.appendLogPath = perCoreConfig.appendLogPath + "." + std::to_string(i);
+        // Its partition.
+        partitions.push_back(std::make_unique<KVStore>(coreConfig));
+    }
+    // One queue per ordered pair of distinct cores.
+    queues.resize(cores * cores);
+    // Create them.
+    for (size_t from = 0; from < cores; ++from) {
+        // Every other core.
+        for (size_t to = 0; to < cores; ++to) if (from != to) queues[from * cores + to] = std::make_unique<PeerQueue>();
+    }
+}
+
+// Binds every core to the port and listens.
+bool CoreServer::start() {
+    // Settings of each core's loop.
+    ServerConfig coreSettings = settings;
+    // Create and start each loop.
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        // Each core saves its own partition.
+        coreSettings.snapshotPath = settings.snapshotPath + "." + std::to_string(i);
+        // Its loop.
+        servers.push_back(std::make_unique<RespServer>(*partitions[i], coreSettings));
+        // Join the group.
+        servers[i]->group = this;
+        // As core i.
+        servers[i]->core = static_cast<uint32_t>(i);
+        // One outbox per core.
+        servers[i]->outbox.resize(partitions.size());
+        // Listen.
+        if (!servers[i]->start()) return false;
+        // The others join the port the first one bound (it may have been picked by the kernel).
+        coreSettings.port = servers[0]->port();
+    }
+    // Listening everywhere.
+    return true;
+}
+
+// Returns the port bound by start.
+uint16_t CoreServer::port() const {
+    // Every core shares it.
+    return servers.empty() ? 0 : servers[0]->port();
+}
+
+// Pins the calling thread to the core-th CPU this process may run on.
+void CoreServer::pin(size_t core) const {
+    // CPUs this process may use.
+    cpu_set_t allowed;
+    // Look them up.
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) return;
+    // Number of them.
+    int count = CPU_COUNT(&allowed);
+    // Nothing to choose from.
+    if (count == 0) return;
+    // Position of the CPU among the allowed ones (more cores than CPUs share them round robin).
+    int wanted = static_cast<int>(core % static_cast<size_t>(count));
+    // Find it.
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        // Not allowed.
+        if (!CPU_ISSET(cpu, &allowed)) continue;
+        // Not this one yet.
+        if (wanted-- != 0) continue;
+        // Just this CPU.
+        cpu_set_t only;
+        // Clear it.
+        CPU_ZERO(&only);
+        // Add it.
+        CPU_SET(cpu, &only);
+        // Pin the thread (best effort: an unpinned core still works, it just may migrate).
+        pthread_setaffinity_np(pthread_self(), sizeof(only), &only);
+        // Done.
+        return;
+    }
+}
+
+// Runs every core's loop until stop() is called.
+void CoreServer::run() {
+    // The other cores' threads.
+    std::vector<std::thread> threads;
+    // One per core after the first.
+    for (size_t i = 1; i < servers.size(); ++i) {
+        // Pinned, then serving.
+        threads.emplace_back([this, i]() {
+            // Stay on one CPU, so the partition stays in its caches.
+            pin(i);
+            // Serve.
+            servers[i]->run();
+        });
+    }
+    // Core 0 runs on the calling thread.
+    pin(0);
+    // Serve.
+    servers[0]->run();
+    // Wait for the others.
+    for (std::thread& thread : threads) thread.join();
+}
+
+// Asks every loop to return.
+void CoreServer::stop() {
+    // Each sets a flag and writes its eventfd, both async-signal-safe.
+    for (const std::unique_ptr<RespServer>& server : servers) server->stop();
+}
+
+// Returns the cores' counters summed.
+ServerStats CoreServer::stats() const {
+    // Sum.
+    ServerStats total;
+    // Add each core.
+    for (const std::unique_ptr<RespServer>& server : servers) {
+        // Its counters.
+        ServerStats core = server->stats();
+        // Every core runs the same backend.
+        total.backend = core.backend;
+        // Connections.
+        total.connectionsAccepted += core.connectionsAccepted;
+        // Open connections.
+        total.connectedClients += core.connectedClients;
+        // Commands from clients.
+        total.commandsProcessed += core.commandsProcessed;
+        // Iterations.
+        total.loopIterations += core.loopIterations;
+        // Reads.
+        total.reads += core.reads;
+        // Gather writes.
+        total.writevCalls += core.writevCalls;
+        // Protocol errors.
+        total.protocolErrors += core.protocolErrors;
+        // io_uring_enter calls.
+        total.ringSubmits += core.ringSubmits;
+        // Forwarded work.
+        total.forwardedCommands += core.forwardedCommands;
+        // Wake-ups.
+        total.peerWakeups += core.peerWakeups;
+    }
+    // Report.
+    return total;
+}
+
+// Returns the number of cores.
+size_t CoreServer::coreCount() const {
+    // One partition each.
+    return partitions.size();
+}
+
+// Returns core's partition.
+KVStore& CoreServer::partition(size_t core) {
+    // Created by the constructor.
+    return *partitions[core];
+}
+
+// Returns the core owning a key.
+uint32_t CoreServer::ownerOf(uint64_t hashCode) const {
+    // Use the high bits: the partition's HashMap indexes with the low ones, so the choices stay independent.
+    uint64_t high = hashCode >> 32;
+    // Map the 32 high bits onto [0, cores) with a multiply instead of a modulo.
+    return static_cast<uint32_t>((high * partitions.size()) >> 32);
+}
+
+// Returns the queue from one core to another.
+PeerQueue& CoreServer::queue(uint32_t from, uint32_t to) {
+    // Row-major by sender.
+    return *queues[static_cast<size_t>(from) * partitions.size() + to];
+}
+
+// Returns core's event loop.
+RespServer& CoreServer::server(uint32_t core) {
+    // Created by start.
+    return *servers[core];
+}
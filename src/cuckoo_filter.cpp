@@ -0,0 +1,277 @@
+#include "../include/cuckoo_filter.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <cmath> // For std::pow, std::ceil
+
+namespace {
+    // A 1 in the lowest bit of each 16-bit lane.
+    constexpr uint64_t LANE_ONES = 0x0001000100010001ull;
+    // The highest bit of each 16-bit lane.
+    constexpr uint64_t LANE_HIGHS = 0x8000800080008000ull;
+
+    // Returns the 16-bit lane of a bucket word.
+    inline uint16_t lane(uint64_t bucket, size_t slot) {
+        // Shift the lane down and truncate.
+        return static_cast<uint16_t>(bucket >> (slot * 16));
+    }
+}
+
+// Out-of-line definitions of the class constants.
+constexpr size_t CuckooFilter::SLOTS_PER_BUCKET;
+constexpr double CuckooFilter::MAX_LOAD_FACTOR;
+constexpr size_t CuckooFilter::MAX_KICKS;
+
+// Constructor: sizes the filter to hold expectedKeys keys below MAX_LOAD_FACTOR.
+CuckooFilter::CuckooFilter(size_t expectedKeys)
+    : count(0), victimFingerprint(0), victimBucket(0), overflowed(false) {
+    // Buckets needed to stay under the maximum load.
+    size_t needed = static_cast<size_t>(std::ceil(static_cast<double>(expectedKeys) / (SLOTS_PER_BUCKET * MAX_LOAD_FACTOR)));
+    // Round up to a power of two so bucket indexes can use a mask.
+    size_t numBuckets = 1;
+    // Double until large enough.
+    while (numBuckets < needed) numBuckets *= 2;
+    // Allocate empty buckets.
+    buckets.assign(numBuckets, 0);
+    // Mask for bucket indexes.
+    bucketMask = numBuckets - 1;
+}
+
+// Returns the fingerprint of a key hash (never 0).
+uint16_t CuckooFilter::fingerprint(uint64_t hashCode) {
+    // Bits 16..31: independent of the bucket bits and of the bits ShardedKVStore selects shards with.
+    uint16_t fp = static_cast<uint16_t>(hashCode >> 16);
+    // 0 marks an empty slot, so remap it.
+    return fp == 0 ? 1 : fp;
+}
+
+// Returns the first candidate bucket of a key hash.
+size_t CuckooFilter::primaryBucket(uint64_t hashCode) const {
+    // Remix the hash so the bucket does not reuse the fingerprint bits.
+    uint64_t mixed = hashCode * 0x9E3779B97F4A7C15ull;
+    // Take the bucket from the top half.
+    return static_cast<size_t>(mixed >> 32) & bucketMask;
+}
+
+// Returns the other candidate bucket given one bucket and the fingerprint.
+size_t CuckooFilter::alternateBucket(size_t bucket, uint16_t fp) const {
+    // XOR with a hash of the fingerprint is its own inverse, so either bucket leads to the other.
+    return (bucket ^ (static_cast<size_t>(fp) * 0x5BD1E995u)) & bucketMask;
+}
+
+// Returns true if the bucket holds the fingerprint.
+bool CuckooFilter::bucketContains(size_t bucket, uint16_t fp) const {
+    // Lanes equal to the fingerprint become zero.
+    uint64_t diff = buckets[bucket] ^ (LANE_ONES * fp);
+    // Test all four lanes for zero at once (SWAR: a borrow reaches the high bit only out of a zero lane).
+    return ((diff - LANE_ONES) & ~diff & LANE_HIGHS) != 0;
+}
+
+// Stores the fingerprint in a free slot of the bucket.
+bool CuckooFilter::bucketInsert(size_t bucket, uint16_t fp) {
+    // Look for an empty lane.
+    for (size_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot) {
+        // Empty lanes hold 0.
+        if (lane(buckets[bucket], slot) == 0) {
+            // Write the fingerprint into the lane.
+            buckets[bucket] |= static_cast<uint64_t>(fp) << (slot * 16);
+            // Stored.
+            return true;
+        }
+    }
+    // The bucket is full.
+    return false;
+}
+
+// Clears one slot of the bucket holding the fingerprint.
+bool CuckooFilter::bucketRemove(size_t bucket, uint16_t fp) {
+    // Look for a matching lane.
+    for (size_t slot = 0; slot < SLOTS_PER_BUCKET; ++slot) {
+        // Compare the lane.
+        if (lane(buckets[bucket], slot) == fp) {
+            // Clear the lane.
+            buckets[bucket] &= ~(static_cast<uint64_t>(0xFFFF) << (slot * 16));
+            // Removed.
+            return true;
+        }
+    }
+    // No such fingerprint in the bucket.
+    return false;
+}
+
+// Adds a key.
+bool CuckooFilter::add(std::string_view key) {
+    // Hash the key and forward.
+    return add(Utils::hash64(key));
+}
+
+// Adds a key given its precomputed hash.
+bool CuckooFilter::add(uint64_t hashCode) {
+    // The key's fingerprint.
+    uint16_t fp = fingerprint(hashCode);
+    // Its first candidate bucket.
+    size_t bucket = primaryBucket(hashCode);
+    // Try the first bucket, then the second.
+    if (bucketInsert(bucket, fp) || bucketInsert(alternateBucket(bucket, fp), fp)) {
+        // Stored directly.
+        count++;
+        // Done.
+        return true;
+    }
+    // With the victim slot taken there is nowhere left to put a displaced fingerprint.
+    if (victimFingerprint != 0) {
+        // The key is lost, so from now on every lookup must answer true.
+        overflowed = true;
+        // Report the failure.
+        return false;
+    }
+    // Cheap per-insert pseudo-random state for choosing which slot to evict.
+    uint64_t state = hashCode | 1;
+    // Relocate fingerprints until one lands in a bucket with room.
+    for (size_t kick = 0; kick < MAX_KICKS; ++kick) {
+        // Advance the xorshift state.
+        state ^= state << 13;
+        // Mix right.
+        state ^= state >> 7;
+        // Mix left.
+        state ^= state << 17;
+        // Slot to evict.
+        size_t slot = static_cast<size_t>(state % SLOTS_PER_BUCKET);
+        // The fingerprint being evicted.
+        uint16_t evicted = lane(buckets[bucket], slot);
+        // Put ours in its place.
+        buckets[bucket] = (buckets[bucket] & ~(static_cast<uint64_t>(0xFFFF) << (slot * 16)))
+                        | (static_cast<uint64_t>(fp) << (slot * 16));
+        // Continue with the evicted fingerprint.
+        fp = evicted;
+        // Its other candidate bucket.
+        bucket = alternateBucket(bucket, fp);
+        // Stop if it fits there.
+        if (bucketInsert(bucket, fp)) {
+            // Stored after relocations.
+            count++;
+            // Done.
+            return true;
+        }
+    }
+    // Park the homeless fingerprint in the victim slot so no key is lost.
+    victimFingerprint = fp;
+    // Remember one of its buckets.
+    victimBucket = bucket;
+    // Counted like any other entry.
+    count++;
+    // The filter is now effectively full, but still exact about membership.
+    return true;
+}
+
+// Removes one copy of a previously added key.
+bool CuckooFilter::remove(std::string_view key) {
+    // Hash the key and forward.
+    return remove(Utils::hash64(key));
+}
+
+// Removes a key given its precomputed hash.
+bool CuckooFilter::remove(uint64_t hashCode) {
+    // The key's fingerprint.
+    uint16_t fp = fingerprint(hashCode);
+    // Its first candidate bucket.
+    size_t bucket = primaryBucket(hashCode);
+    // Its second candidate bucket.
+    size_t other = alternateBucket(bucket, fp);
+    // The victim may be the entry being removed.
+    bool removed = victimFingerprint == fp && (victimBucket == bucket || victimBucket == other);
+    // Clear the victim if so.
+    if (removed) {
+        // The victim slot is free again.
+        victimFingerprint = 0;
+    } else {
+        // Otherwise clear a matching slot in either bucket.
+        removed = bucketRemove(bucket, fp) || bucketRemove(other, fp);
+    }
+    // Nothing matched.
+    if (!removed) return false;
+    // One fewer entry.
+    count--;
+    // A freed slot may give the victim a home.
+    if (victimFingerprint != 0) {
+        // The victim's two buckets.
+        size_t victimOther = alternateBucket(victimBucket, victimFingerprint);
+        // Try to place it.
+        if (bucketInsert(victimBucket, victimFingerprint) || bucketInsert(victimOther, victimFingerprint)) {
+            // The victim slot is free again.
+            victimFingerprint = 0;
+        }
+    }
+    // Removed.
+    return true;
+}
+
+// Checks if a key might exist in the set.
+bool CuckooFilter::possiblyContains(std::string_view key) const {
+    // Hash the key and forward.
+    return possiblyContains(Utils::hash64(key));
+}
+
+// Checks if a key might exist given its precomputed hash.
+bool CuckooFilter::possiblyContains(uint64_t hashCode) const {
+    // A lost key could be any key.
+    if (overflowed) return true;
+    // The key's fingerprint.
+    uint16_t fp = fingerprint(hashCode);
+    // Its first candidate bucket.
+    size_t bucket = primaryBucket(hashCode);
+    // Its second candidate bucket.
+    size_t other = alternateBucket(bucket, fp);
+    // The victim counts as stored.
+    if (victimFingerprint == fp && (victimBucket == bucket || victimBucket == other)) return true;
+    // Check both buckets.
+    return bucketContains(bucket, fp) || bucketContains(other, fp);
+}
+
+// Starts loading both candidate buckets of a key hash into cache.
+void CuckooFilter::prefetch(uint64_t hashCode) const {
+    // Its first candidate bucket.
+    size_t bucket = primaryBucket(hashCode);
+    // Each bucket is one word, so two hints cover the lookup.
+    __builtin_prefetch(&buckets[bucket], 0, 3);
+    // Its second candidate bucket.
+    __builtin_prefetch(&buckets[alternateBucket(bucket, fingerprint(hashCode))], 0, 3);
+}
+
+// Returns the number of fingerprints stored.
+size_t CuckooFilter::size() const {
+    // Maintained by add and remove.
+    return count;
+}
+
+// Returns the number of fingerprint slots.
+size_t CuckooFilter::capacity() const {
+    // Four slots per bucket.
+    return buckets.size() * SLOTS_PER_BUCKET;
+}
+
+// Returns size() / capacity().
+double CuckooFilter::loadFactor() const {
+    // Share of occupied slots.
+    return static_cast<double>(count) / static_cast<double>(capacity());
+}
+
+// Returns true once an insert has failed.
+bool CuckooFilter::isOverflowed() const {
+    // Set by add.
+    return overflowed;
+}
+
+// Returns the expected false-positive rate at the current load.
+double CuckooFilter::estimatedFalsePositiveRate() const {
+    // A lost key makes every lookup positive.
+    if (overflowed) return 1.0;
+    // A lookup compares against the occupied slots of two buckets; each matches with probability 1 / 65535.
+    double comparisons = 2.0 * SLOTS_PER_BUCKET * loadFactor();
+    // Chance that at least one comparison matches.
+    return 1.0 - std::pow(1.0 - 1.0 / 65535.0, comparisons);
+}
+
+// Returns the number of bytes used by the buckets.
+size_t CuckooFilter::sizeBytes() const {
+    // One 64-bit word per bucket.
+    return buckets.size() * sizeof(uint64_t);
+}
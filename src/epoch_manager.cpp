@@ -0,0 +1,122 @@
+#include "../include/epoch_manager.hpp"
+#include "../include/utils.hpp" // For Utils::threadIndex
+
+// Constructor: pins the current epoch.
+EpochManager::Guard::Guard(const EpochManager& manager) : manager(manager), slot(nullptr), pinned(true) {
+    // This thread's index.
+    size_t index = Utils::threadIndex();
+    // Too many threads for a slot of its own: count it as an overflow reader, which holds the epoch still.
+    if (index >= MAX_THREADS) {
+        // Seen by tryAdvance before it looks at anything else, so the reads below are covered.
+        manager.overflowReaders.fetch_add(1, std::memory_order_seq_cst);
+        // Pinned.
+        return;
+    }
+    // Its slot.
+    slot = &manager.slots[index].epoch;
+    // Already pinned by an outer guard on this thread.
+    if (slot->load(std::memory_order_relaxed) != 0) {
+        // The outer guard unpins.
+        pinned = false;
+        // Covered.
+        return;
+    }
+    // Announce the epoch this thread reads in.
+    slot->store(manager.globalEpoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // Order the announcement before every read of the shared structure (pairs with the fence in tryAdvance).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+// Destructor: unpins it.
+EpochManager::Guard::~Guard() {
+    // A nested guard leaves the pin to the outer one.
+    if (!pinned) return;
+    // An overflow reader.
+    if (slot == nullptr) {
+        // Its reads are done before the count drops.
+        manager.overflowReaders.fetch_sub(1, std::memory_order_release);
+        // Unpinned.
+        return;
+    }
+    // Its reads are done before the slot is cleared.
+    slot->store(0, std::memory_order_release);
+}
+
+// Constructor: reclamation is attempted every reclaimBatch retirements.
+EpochManager::EpochManager(size_t reclaimBatch)
+    : globalEpoch(1), overflowReaders(0), slots(new Slot[MAX_THREADS]), reclaimBatch(reclaimBatch == 0 ? 1 : reclaimBatch), freedCount(0) {
+}
+
+// Destructor: frees everything still retired (no reader may be active).
+EpochManager::~EpochManager() {
+    // Free each.
+    for (const Retired& retired : limbo) retired.destroy(retired.pointer);
+}
+
+// Advances the global epoch if every pinned reader has seen the current one; returns the (new) epoch.
+uint64_t EpochManager::tryAdvance() {
+    // Order the unlinking stores before the look at the readers (pairs with the fence in Guard).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Current epoch (only writers change it).
+    uint64_t current = globalEpoch.load(std::memory_order_relaxed);
+    // An overflow reader may be in any epoch.
+    if (overflowReaders.load(std::memory_order_acquire) != 0) return current;
+    // Check each slot.
+    for (size_t i = 0; i < MAX_THREADS; ++i) {
+        // Its epoch.
+        uint64_t pinnedEpoch = slots[i].epoch.load(std::memory_order_acquire);
+        // A reader still in an older epoch.
+        if (pinnedEpoch != 0 && pinnedEpoch != current) return current;
+    }
+    // Everyone reading has seen the current epoch.
+    globalEpoch.store(current + 1, std::memory_order_seq_cst);
+    // Report the new one.
+    return current + 1;
+}
+
+// Hands an object over for freeing once no reader can still hold it.
+void EpochManager::retire(void* pointer, void (*destroy)(void*)) {
+    // Tagged with the epoch it was unlinked in.
+    limbo.push_back(Retired{pointer, destroy, globalEpoch.load(std::memory_order_relaxed)});
+    // Batch the scans of the reader slots.
+    if (limbo.size() % reclaimBatch == 0) reclaim();
+}
+
+// Frees every retired object no reader can still hold; returns how many.
+size_t EpochManager::reclaim() {
+    // Nothing waiting.
+    if (limbo.empty()) return 0;
+    // Move the epoch on if the readers allow it.
+    uint64_t current = tryAdvance();
+    // Retired objects form a prefix ordered by epoch; readers pinned in epoch e may hold objects retired in e - 1,
+    // but nothing retired two epochs before the current one.
+    size_t count = 0;
+    // Find where the safe prefix ends.
+    while (count < limbo.size() && limbo[count].epoch + 2 <= current) ++count;
+    // Free it.
+    for (size_t i = 0; i < count; ++i) limbo[i].destroy(limbo[i].pointer);
+    // Drop it.
+    limbo.erase(limbo.begin(), limbo.begin() + static_cast<std::ptrdiff_t>(count));
+    // Count it.
+    freedCount += count;
+    // Report it.
+    return count;
+}
+
+// Returns the number of retired objects not yet freed.
+size_t EpochManager::pending() const {
+    // Still in limbo.
+    return limbo.size();
+}
+
+// Returns the number of objects freed so far.
+uint64_t EpochManager::freed() const {
+    // Counted by reclaim.
+    return freedCount;
+}
+
+// Returns the global epoch.
+uint64_t EpochManager::epoch() const {
+    // Current value.
+    return globalEpoch.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,84 @@
+#include "../include/frequency_sketch.hpp"
+
+namespace {
+    // Odd multipliers giving each row an independent index from the one key hash.
+    constexpr uint64_t ROW_SEEDS[FrequencySketch::DEPTH] = {
+        0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL
+    };
+    // Counters packed into one 64-bit word.
+    constexpr size_t COUNTERS_PER_WORD = 16;
+    // Every nibble's low three bits, used to halve all sixteen counters of a word at once.
+    constexpr uint64_t HALVE_MASK = 0x7777777777777777ULL;
+}
+
+// Constructor: sizes the sketch for about expectedKeys distinct keys.
+FrequencySketch::FrequencySketch(size_t expectedKeys) : additions(0) {
+    // At least one word of counters per row.
+    size_t counters = COUNTERS_PER_WORD;
+    // One counter per expected key, rounded up to a power of two for mask indexing.
+    while (counters < expectedKeys) counters <<= 1;
+    // Index mask within a row.
+    counterMask = counters - 1;
+    // Words per row.
+    wordsPerRow = counters / COUNTERS_PER_WORD;
+    // All rows, zeroed.
+    table.assign(wordsPerRow * DEPTH, 0);
+    // Halve after this many increments.
+    sampleSize = counters * SAMPLE_FACTOR;
+}
+
+// Returns the counter index for a key in a row.
+size_t FrequencySketch::counterIndex(uint64_t hashCode, size_t row) const {
+    // Remix with the row's seed and take the high bits (the best mixed ones).
+    return static_cast<size_t>((hashCode * ROW_SEEDS[row]) >> 32) & counterMask;
+}
+
+// Records one access to a key.
+void FrequencySketch::increment(uint64_t hashCode) {
+    // Bump the key's counter in every row.
+    for (size_t row = 0; row < DEPTH; ++row) {
+        // Counter position.
+        size_t index = counterIndex(hashCode, row);
+        // Word holding it.
+        uint64_t& word = table[row * wordsPerRow + index / COUNTERS_PER_WORD];
+        // Bit offset of the counter in the word.
+        unsigned shift = static_cast<unsigned>(index % COUNTERS_PER_WORD) * 4;
+        // Saturate rather than wrap.
+        if (((word >> shift) & 0xF) < MAX_COUNT) word += uint64_t{1} << shift;
+    }
+    // Age the sketch once enough accesses have been seen.
+    if (++additions >= sampleSize) age();
+}
+
+// Returns the estimated recent access count of a key.
+uint8_t FrequencySketch::frequency(uint64_t hashCode) const {
+    // Minimum over the rows.
+    uint8_t estimate = MAX_COUNT;
+    // Read the key's counter in every row.
+    for (size_t row = 0; row < DEPTH; ++row) {
+        // Counter position.
+        size_t index = counterIndex(hashCode, row);
+        // Word holding it.
+        uint64_t word = table[row * wordsPerRow + index / COUNTERS_PER_WORD];
+        // Counter value.
+        uint8_t count = static_cast<uint8_t>((word >> (index % COUNTERS_PER_WORD * 4)) & 0xF);
+        // Keep the smallest.
+        if (count < estimate) estimate = count;
+    }
+    // Return the estimate.
+    return estimate;
+}
+
+// Halves every counter.
+void FrequencySketch::age() {
+    // Shift each word right by one and drop the bit that crossed into the next nibble.
+    for (uint64_t& word : table) word = (word >> 1) & HALVE_MASK;
+    // The halved counts stand for half as many increments.
+    additions /= 2;
+}
+
+// Returns the number of bytes used by the counters.
+size_t FrequencySketch::sizeBytes() const {
+    // One uint64_t per word.
+    return table.size() * sizeof(uint64_t);
+}
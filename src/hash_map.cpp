@@ -1,103 +1,674 @@
 #include "../include/hash_map.hpp"
-#include <stdexcept> 
-// Constructor: initializes the hash map with a given capacity.
-HashMap::HashMap(size_t capacity) : currentSize(0), tableCapacity(capacity) {
-    // Resize the table to the specified capacity.
-    table.resize(tableCapacity);
+#include "../include/utils.hpp" // For Utils::hash64
+#include <algorithm> // For std::max
+#if defined(__SSE2__)
+#include <emmintrin.h> // For 16-wide control byte comparisons
+#endif
+
+namespace {
+    // Returns a bitmask with bit i set when control byte i of the group equals b.
+    inline uint32_t matchByte(const int8_t* group, int8_t b) {
+#if defined(__SSE2__)
+        // Load all 16 control bytes of the group into one register.
+        __m128i ctrlBytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+        // Compare every byte against the broadcast needle and collect the sign bits.
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(b), ctrlBytes)));
+#else
+        // Portable fallback: test the bytes one by one.
+        uint32_t mask = 0;
+        // Iterate through each control byte of the group.
+        for (int i = 0; i < 16; ++i) {
+            // Set bit i if the byte matches.
+            if (group[i] == b) mask |= (1u << i);
+        }
+        // Return the collected mask.
+        return mask;
+#endif
+    }
+
+    // Returns a bitmask with bit i set when slot i of the group is empty or deleted (high bit set).
+    inline uint32_t matchEmptyOrDeleted(const int8_t* group) {
+#if defined(__SSE2__)
+        // Empty and deleted are the only negative control bytes, so the sign bits are the answer.
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(group))));
+#else
+        // Portable fallback: test the sign of each byte.
+        uint32_t mask = 0;
+        // Iterate through each control byte of the group.
+        for (int i = 0; i < 16; ++i) {
+            // Set bit i if the byte is negative.
+            if (group[i] < 0) mask |= (1u << i);
+        }
+        // Return the collected mask.
+        return mask;
+#endif
+    }
+
+    // Returns the index of the lowest set bit of a non-zero mask.
+    inline size_t lowestBit(uint32_t mask) {
+        // Count trailing zeros.
+        return static_cast<size_t>(__builtin_ctz(mask));
+    }
+
+    // Fingerprint stored in the control byte: the low 7 bits of the hash.
+    inline int8_t fingerprint(uint64_t hashCode) {
+        // Always non-negative, so it never collides with the empty/deleted markers.
+        return static_cast<int8_t>(hashCode & 0x7F);
+    }
 }
 
-// Hash function to map a key to an index in the table.
-size_t HashMap::hash(const std::string& key) const {
-    // Initialize hash value.
-    size_t hashCode = 0;
-    // Iterate through each character of the key.
-    for (char c : key) {
-        // A simple hash function: sum of char values multiplied by a prime.
-        hashCode = (hashCode * 31 + c) % tableCapacity;
+// Constructor: initializes the hash map with a given capacity and resize thresholds.
+HashMap::HashMap(size_t capacity, double maxLoad, double minLoad, SlabArena* recordArena)
+    : migrateIndex(0), resizeEpoch(0), initialCapacity(GROUP_WIDTH), maxLoadFactor(maxLoad), minLoadFactor(minLoad),
+      arena(recordArena), recordBytes(0) {
+    // Without a shared arena, the map allocates its records from its own.
+    if (arena == nullptr) {
+        // Create the private arena.
+        ownedArena = std::make_unique<SlabArena>();
+        // Use it for every record.
+        arena = ownedArena.get();
     }
-    // Return the computed hash code modulo table capacity.
-    return hashCode;
+    // Grow the slot count in whole groups until the requested capacity fits.
+    while (initialCapacity < capacity) {
+        // Keep the number of groups a power of two so probing can use a mask.
+        initialCapacity *= 2;
+    }
+    // Keep at least one group in sixteen free so probes always terminate, and never start below 1/4.
+    if (maxLoadFactor > 0.9375) maxLoadFactor = 0.9375;
+    // A very low maximum would just waste memory.
+    if (maxLoadFactor < 0.25) maxLoadFactor = 0.25;
+    // The shrink threshold must sit well below half the grow threshold, or a shrink would immediately regrow.
+    if (minLoadFactor > maxLoadFactor / 4) minLoadFactor = maxLoadFactor / 4;
+    // Negative thresholds mean "never shrink".
+    if (minLoadFactor < 0) minLoadFactor = 0;
+    // Allocate the first table.
+    initTable(active, initialCapacity);
 }
 
-// Inserts or updates a key-value pair.
-void HashMap::set(const std::string& key, const std::string& value) {
-    // Get the hash index for the key.
-    size_t index = hash(key);
-    // Iterate through the bucket (chain) at the computed index.
-    for (auto& node : table[index]) {
-        // If key is found, update its value.
-        if (node.first == key) {
-            // Update the value of the existing key.
-            node.second = value;
-            // Return after updating.
-            return;
+// Destructor: returns every record to the arena.
+HashMap::~HashMap() {
+    // Both tables may hold records during a resize.
+    for (Table* table : {&active, &draining}) {
+        // Visit every slot.
+        for (size_t i = 0; i < table->capacity; ++i) {
+            // Free the record of every full slot.
+            if (table->ctrl[i] >= 0) arena->deallocate(table->slots[i]);
+        }
+    }
+}
+
+// Hash function producing the full hash of a key.
+uint64_t HashMap::hash(std::string_view key) const {
+    // The same 64-bit hash KVStore computes once per request and passes in.
+    return Utils::hash64(key);
+}
+
+// Allocates a table of the given slot count.
+void HashMap::initTable(Table& table, size_t slotCount) {
+    // All control bytes start out empty.
+    table.ctrl.assign(slotCount, CTRL_EMPTY);
+    // Every slot starts without a record.
+    table.slots.assign(slotCount, nullptr);
+    // And without an access stamp.
+    table.stamps.assign(slotCount, 0);
+    // Record the capacity.
+    table.capacity = slotCount;
+    // A fresh table holds nothing.
+    table.size = 0;
+    // And has no tombstones.
+    table.deleted = 0;
+}
+
+// Finds the slot holding key in a table, or returns the table's capacity if it is absent.
+size_t HashMap::findSlot(const Table& table, std::string_view key, uint64_t hashCode) const {
+    // An unallocated table holds nothing.
+    if (table.capacity == 0) return 0;
+    // Fingerprint to compare against the control bytes.
+    int8_t h2 = fingerprint(hashCode);
+    // Mask for wrapping group indices.
+    size_t groupMask = table.capacity / GROUP_WIDTH - 1;
+    // Starting group comes from the high bits of the hash.
+    size_t group = (hashCode >> 7) & groupMask;
+    // Triangular probing over groups visits every group exactly once.
+    for (size_t step = 1; step <= groupMask + 1; ++step) {
+        // Pointer to the control bytes of this group.
+        const int8_t* groupCtrl = table.ctrl.data() + group * GROUP_WIDTH;
+        // Check every slot whose fingerprint matches.
+        for (uint32_t mask = matchByte(groupCtrl, h2); mask != 0; mask &= mask - 1) {
+            // Slot index of the candidate.
+            size_t index = group * GROUP_WIDTH + lowestBit(mask);
+            // Compare the full key only on a fingerprint hit.
+            if (SlabArena::key(table.slots[index]) == key) {
+                // Key found.
+                return index;
+            }
+        }
+        // An empty slot in this group means the key was never pushed further along.
+        if (matchByte(groupCtrl, CTRL_EMPTY) != 0) {
+            // Key not present.
+            return table.capacity;
+        }
+        // Move to the next group in the probe sequence.
+        group = (group + step) & groupMask;
+    }
+    // Every group was full and none held the key.
+    return table.capacity;
+}
+
+// Finds the first empty or deleted slot along the probe sequence of the given hash.
+size_t HashMap::findInsertSlot(const Table& table, uint64_t hashCode) const {
+    // Mask for wrapping group indices.
+    size_t groupMask = table.capacity / GROUP_WIDTH - 1;
+    // Starting group comes from the high bits of the hash.
+    size_t group = (hashCode >> 7) & groupMask;
+    // Triangular probing over groups, identical to findSlot.
+    for (size_t step = 1; step <= groupMask + 1; ++step) {
+        // Free (empty or deleted) slots in this group.
+        uint32_t mask = matchEmptyOrDeleted(table.ctrl.data() + group * GROUP_WIDTH);
+        // If any slot is free, use the first one.
+        if (mask != 0) {
+            // Return the slot index.
+            return group * GROUP_WIDTH + lowestBit(mask);
         }
+        // Move to the next group in the probe sequence.
+        group = (group + step) & groupMask;
     }
-    // If key is not found, add a new key-value pair to the bucket.
-    table[index].emplace_back(key, value);
-    // Increment the current size of the hash map.
-    currentSize++;
+    // Unreachable while the load factor keeps free slots around.
+    return table.capacity;
+}
+
+// Places a slot known to be absent into a table, with its access stamp.
+void HashMap::insertSlot(Table& table, uint64_t hashCode, Slot slot, uint32_t stamp) {
+    // Find a free slot along the probe sequence.
+    size_t index = findInsertSlot(table, hashCode);
+    // Reusing a tombstone reduces the tombstone count.
+    if (table.ctrl[index] == CTRL_DELETED) {
+        // One fewer tombstone.
+        table.deleted--;
+    }
+    // Publish the fingerprint for this slot.
+    table.ctrl[index] = fingerprint(hashCode);
+    // Point the slot at the record.
+    table.slots[index] = slot;
+    // Carry the stamp over.
+    table.stamps[index] = stamp;
+    // One more live entry.
+    table.size++;
+}
+
+// Erases the slot at index from a table.
+void HashMap::eraseSlot(Table& table, size_t index) {
+    // Start of the group containing the slot.
+    const int8_t* groupCtrl = table.ctrl.data() + (index / GROUP_WIDTH) * GROUP_WIDTH;
+    // If the group already has an empty slot, every probe stops here anyway, so no tombstone is needed.
+    if (matchByte(groupCtrl, CTRL_EMPTY) != 0) {
+        // Mark the slot as never used.
+        table.ctrl[index] = CTRL_EMPTY;
+    } else {
+        // Leave a tombstone so probes for keys displaced past this group keep going.
+        table.ctrl[index] = CTRL_DELETED;
+        // Track the tombstone for the load factor.
+        table.deleted++;
+    }
+    // Stop accounting for the record.
+    recordBytes -= SlabArena::footprint(table.slots[index]);
+    // Return the record to the arena.
+    arena->deallocate(table.slots[index]);
+    // Clear the slot.
+    table.slots[index] = nullptr;
+    // One fewer live entry.
+    table.size--;
+}
+
+// Inserts or updates a key-value pair.
+bool HashMap::set(const std::string& key, const std::string& value) {
+    // Hash the key and forward.
+    return set(key, value, hash(key));
+}
+
+// Inserts or updates a key-value pair whose hash the caller already computed.
+bool HashMap::set(std::string_view key, std::string_view value, uint64_t hashCode) {
+    // Whether the key is new.
+    bool inserted;
+    // Write it and drop the record pointer.
+    upsert(key, value, hashCode, inserted);
+    // Report whether the key is new.
+    return inserted;
+}
+
+// Inserts or updates a key-value pair and returns its record.
+char* HashMap::upsert(std::string_view key, std::string_view value, uint64_t hashCode, bool& inserted) {
+    // Assume an update until the key turns out to be new.
+    inserted = false;
+    // Pay a bounded share of any resize in progress.
+    rehashStep(REHASH_GROUPS_PER_STEP);
+    // Look for an existing slot in the active table first.
+    size_t index = findSlot(active, key, hashCode);
+    // If key is found, update its value.
+    if (index != active.capacity) {
+        // Stop accounting for the old record.
+        recordBytes -= SlabArena::footprint(active.slots[index]);
+        // Update the value of the existing key (in place when it still fits its slab slot).
+        active.slots[index] = arena->reassign(active.slots[index], value);
+        // Account for the (possibly moved) record.
+        recordBytes += SlabArena::footprint(active.slots[index]);
+        // Return the updated record; the key was already present.
+        return active.slots[index];
+    }
+    // The record to insert into the active table.
+    Slot slot;
+    // Access stamp the entry keeps (a new key starts at 0).
+    uint32_t stamp = 0;
+    // Keys not yet migrated still live in the draining table.
+    index = findSlot(draining, key, hashCode);
+    // If the key is waiting to be migrated, move it over now with its new value.
+    if (isRehashing() && index != draining.capacity) {
+        // Stop accounting for the old record.
+        recordBytes -= SlabArena::footprint(draining.slots[index]);
+        // Take the old record and give it the new value.
+        slot = arena->reassign(draining.slots[index], value);
+        // Keep its stamp.
+        stamp = draining.stamps[index];
+        // Detach it from the old table without freeing it.
+        draining.slots[index] = nullptr;
+        // Leave a tombstone behind (the old table is going away anyway).
+        draining.ctrl[index] = CTRL_DELETED;
+        // One fewer entry left to migrate.
+        draining.size--;
+    } else {
+        // Brand new key and value in one record.
+        slot = arena->allocate(key, value);
+        // Remember that the key is new.
+        inserted = true;
+    }
+    // Account for the record.
+    recordBytes += SlabArena::footprint(slot);
+    // Start a resize if live + deleted slots would exceed the maximum load factor.
+    if (static_cast<double>(active.size + active.deleted + 1) > maxLoadFactor * active.capacity) {
+        // A resize that has fallen behind must finish before the next one can start.
+        rehashStep(draining.capacity / GROUP_WIDTH);
+        // Double the table if live entries fill more than half the usable slots; otherwise just drop tombstones.
+        bool grow = static_cast<double>(active.size + 1) > maxLoadFactor * active.capacity / 2;
+        // Begin migrating into the new table.
+        startRehash(grow ? active.capacity * 2 : active.capacity);
+    }
+    // Insert the entry into the table receiving inserts.
+    insertSlot(active, hashCode, slot, stamp);
+    // Return the record.
+    return slot;
+}
+
+// Sizes an empty map for count entries up front.
+void HashMap::reserve(size_t count) {
+    // Only an empty, settled map is resized this way.
+    if (active.size != 0 || isRehashing()) return;
+    // Start from the current table.
+    size_t slotCount = active.capacity;
+    // Double until count entries stay below the grow threshold.
+    while (static_cast<double>(count) >= maxLoadFactor * slotCount) slotCount *= 2;
+    // Reallocate if it has to grow (the old table is empty, apart from tombstones).
+    if (slotCount != active.capacity || active.deleted != 0) initTable(active, slotCount);
+}
+
+// Inserts a key the caller knows is absent.
+void HashMap::insertNew(std::string_view key, std::string_view value, uint64_t hashCode) {
+    // Past the grow threshold or mid-resize: take the regular path.
+    if (isRehashing() || static_cast<double>(active.size + active.deleted + 1) > maxLoadFactor * active.capacity) {
+        // set handles the resize.
+        set(key, value, hashCode);
+        // Done.
+        return;
+    }
+    // The key and value in one record.
+    Slot slot = arena->allocate(key, value);
+    // Account for it.
+    recordBytes += SlabArena::footprint(slot);
+    // Straight into a free slot, with a fresh stamp.
+    insertSlot(active, hashCode, slot, 0);
 }
 
 // Retrieves the value associated with a key. Returns empty string if not found.
 std::string HashMap::get(const std::string& key) {
-    // Get the hash index for the key.
-    size_t index = hash(key);
-    // Iterate through the bucket at the computed index.
-    for (const auto& node : table[index]) {
-        // If key is found, return its value.
-        if (node.first == key) {
-            // Return the value associated with the key.
-            return node.second;
+    // Borrow the value, then copy it out for the caller.
+    std::optional<std::string_view> value = find(key);
+    // Return an empty string if the key is not found.
+    return value ? std::string(*value) : std::string();
+}
+
+// Looks up a key without copying it or its value.
+std::optional<std::string_view> HashMap::find(std::string_view key) {
+    // Hash the key and forward.
+    return find(key, hash(key));
+}
+
+// Looks up a key whose hash the caller already computed.
+std::optional<std::string_view> HashMap::find(std::string_view key, uint64_t hashCode) {
+    // Pay a bounded share of any resize in progress.
+    rehashStep(REHASH_GROUPS_PER_STEP);
+    // The lookup itself does not modify the map.
+    return peek(key, hashCode);
+}
+
+// Looks up the record holding a key, or returns nullptr if it is absent.
+const char* HashMap::findRecord(std::string_view key, uint64_t hashCode) {
+    // Pay a bounded share of any resize in progress.
+    rehashStep(REHASH_GROUPS_PER_STEP);
+    // Look in the active table first.
+    size_t index = findSlot(active, key, hashCode);
+    // Found there.
+    if (index != active.capacity) return active.slots[index];
+    // Fall back to the draining table for keys not yet migrated.
+    index = findSlot(draining, key, hashCode);
+    // Found there.
+    if (isRehashing() && index != draining.capacity) return draining.slots[index];
+    // Key not found.
+    return nullptr;
+}
+
+// Starts loading the first probe group of a hash in both tables.
+void HashMap::prefetch(uint64_t hashCode) const {
+    // Both tables; the draining one is only allocated during a resize.
+    const Table* tables[] = {&active, &draining};
+    // Hint each allocated table.
+    for (const Table* table : tables) {
+        // An unallocated table is never probed.
+        if (table->capacity == 0) continue;
+        // First group of the probe sequence, as findSlot picks it.
+        size_t group = (hashCode >> 7) & (table->capacity / GROUP_WIDTH - 1);
+        // Its 16 control bytes (one cache line at most).
+        __builtin_prefetch(table->ctrl.data() + group * GROUP_WIDTH, 0, 3);
+        // The matching slot pointers span two cache lines.
+        __builtin_prefetch(table->slots.data() + group * GROUP_WIDTH, 0, 3);
+        // Second half of them.
+        __builtin_prefetch(table->slots.data() + group * GROUP_WIDTH + GROUP_WIDTH / 2, 0, 3);
+        // Their access stamps, which inserts and eviction tracking write.
+        __builtin_prefetch(table->stamps.data() + group * GROUP_WIDTH, 1, 3);
+    }
+}
+
+// Starts loading the records in the first probe group of a hash whose fingerprint matches.
+void HashMap::prefetchRecords(uint64_t hashCode) const {
+    // Fingerprint to compare against the control bytes.
+    int8_t h2 = fingerprint(hashCode);
+    // Both tables; the draining one is only allocated during a resize.
+    const Table* tables[] = {&active, &draining};
+    // Hint each allocated table.
+    for (const Table* table : tables) {
+        // An unallocated table is never probed.
+        if (table->capacity == 0) continue;
+        // First group of the probe sequence, as findSlot picks it.
+        size_t group = (hashCode >> 7) & (table->capacity / GROUP_WIDTH - 1);
+        // Every fingerprint match (usually just the key itself, if present).
+        for (uint32_t mask = matchByte(table->ctrl.data() + group * GROUP_WIDTH, h2); mask != 0; mask &= mask - 1) {
+            // Start loading the candidate's record, whose key findSlot compares.
+            __builtin_prefetch(table->slots[group * GROUP_WIDTH + lowestBit(mask)], 0, 3);
         }
     }
-    // Return an empty string if the key is not found.
-    return ""; // Or throw an exception, e.g., std::out_of_range("Key not found")
+}
+
+// Same as find, but never advances an in-progress resize.
+std::optional<std::string_view> HashMap::peek(std::string_view key) const {
+    // Hash the key and forward.
+    return peek(key, hash(key));
+}
+
+// Same as find with a precomputed hash, but never advances an in-progress resize.
+std::optional<std::string_view> HashMap::peek(std::string_view key, uint64_t hashCode) const {
+    // Look in the active table first.
+    size_t index = findSlot(active, key, hashCode);
+    // If key is found, borrow its value.
+    if (index != active.capacity) {
+        // View of the stored value.
+        return SlabArena::value(active.slots[index]);
+    }
+    // Fall back to the draining table for keys not yet migrated.
+    index = findSlot(draining, key, hashCode);
+    // If key is found there, borrow its value.
+    if (isRehashing() && index != draining.capacity) {
+        // View of the stored value.
+        return SlabArena::value(draining.slots[index]);
+    }
+    // Key not found.
+    return std::nullopt;
 }
 
 // Deletes a key-value pair. Returns true if key was found and deleted, false otherwise.
 bool HashMap::remove(const std::string& key) {
-    // Get the hash index for the key.
-    size_t index = hash(key);
-    // Get a reference to the bucket.
-    auto& bucket = table[index];
-    // Iterate through the bucket.
-    for (auto it = bucket.begin(); it != bucket.end(); ++it) {
-        // If the key is found.
-        if (it->first == key) {
-            // Erase the key-value pair from the list (bucket).
-            bucket.erase(it);
-            // Decrement the current size of the hash map.
-            currentSize--;
-            // Return true indicating successful removal.
-            return true;
+    // Hash the key and forward.
+    return remove(key, hash(key));
+}
+
+// Deletes a key whose hash the caller already computed.
+bool HashMap::remove(std::string_view key, uint64_t hashCode) {
+    // Pay a bounded share of any resize in progress.
+    rehashStep(REHASH_GROUPS_PER_STEP);
+    // Look in the active table first.
+    size_t index = findSlot(active, key, hashCode);
+    // If key is found, erase it.
+    if (index != active.capacity) {
+        // Erase from the active table.
+        eraseSlot(active, index);
+    } else {
+        // Look in the draining table for keys not yet migrated.
+        index = findSlot(draining, key, hashCode);
+        // Return false if the key was not found in either table.
+        if (!isRehashing() || index == draining.capacity) {
+            // Nothing to remove.
+            return false;
         }
+        // Erase from the draining table.
+        eraseSlot(draining, index);
     }
-    // Return false if the key was not found.
-    return false;
+    // Shrink once the table is mostly empty, but never below the constructor capacity.
+    if (!isRehashing() && active.capacity > initialCapacity &&
+        static_cast<double>(active.size) < minLoadFactor * active.capacity) {
+        // Begin migrating into a table half the size.
+        startRehash(active.capacity / 2);
+    }
+    // Return true indicating successful removal.
+    return true;
 }
 
 // Checks if a key exists in the hash map.
 bool HashMap::contains(const std::string& key) {
-    // Get the hash index for the key.
-    size_t index = hash(key);
-    // Iterate through the bucket at the computed index.
-    for (const auto& node : table[index]) {
-        // If key is found, return true.
-        if (node.first == key) {
-            // Key exists in the hash map.
-            return true;
-        }
-    }
-    // Key does not exist in the hash map.
-    return false;
+    // Hash the key and forward.
+    return contains(key, hash(key));
+}
+
+// Checks if a key whose hash the caller already computed exists in the hash map.
+bool HashMap::contains(std::string_view key, uint64_t hashCode) {
+    // Pay a bounded share of any resize in progress.
+    rehashStep(REHASH_GROUPS_PER_STEP);
+    // Key exists if it is in the active table.
+    if (findSlot(active, key, hashCode) != active.capacity) return true;
+    // Otherwise it may still be waiting in the draining table.
+    return isRehashing() && findSlot(draining, key, hashCode) != draining.capacity;
 }
 
 // Returns the current number of elements in the hash map.
 size_t HashMap::size() const {
-    // Return the number of key-value pairs stored.
-    return currentSize;
+    // Entries are split across both tables during a resize.
+    return active.size + draining.size;
+}
+
+// Returns the access stamp of a key, or nullptr if it is absent.
+uint32_t* HashMap::accessStamp(std::string_view key, uint64_t hashCode) {
+    // Look in the active table first.
+    size_t index = findSlot(active, key, hashCode);
+    // Found there.
+    if (index != active.capacity) return &active.stamps[index];
+    // Keys not yet migrated still live in the draining table.
+    index = findSlot(draining, key, hashCode);
+    // Found there (the stamp moves with the slot when it migrates).
+    if (isRehashing() && index != draining.capacity) return &draining.stamps[index];
+    // Key not found.
+    return nullptr;
+}
+
+// Visits count live entries with their access stamps, each found from its own random slots.
+size_t HashMap::sample(uint64_t seed, size_t count,
+                       const std::function<void(std::string_view, uint32_t)>& visit) const {
+    // Entries visited so far.
+    size_t visited = 0;
+    // Live entries across both tables.
+    size_t live = size();
+    // Nothing to sample.
+    if (live == 0) return 0;
+    // Next random number (splitmix64 over the seed).
+    auto nextRandom = [&seed]() {
+        // Advance the state.
+        uint64_t z = seed += 0x9E3779B97F4A7C15ULL;
+        // Mix.
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        // Mix again.
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        // Final fold.
+        return z ^ (z >> 31);
+    };
+    // One independent pick per sample.
+    for (size_t n = 0; n < count; ++n) {
+        // Pick a table in proportion to its live entries (the draining one only during a resize).
+        const Table& table = nextRandom() % live < active.size ? active : draining;
+        // Slot index mask (capacities are powers of two).
+        size_t mask = table.capacity - 1;
+        // Probe random slots until one is live, so every entry is equally likely (walking forward from a
+        // random slot would favour entries after long empty runs).
+        size_t index = static_cast<size_t>(nextRandom()) & mask;
+        // Bounded number of retries for very sparse tables.
+        for (size_t probe = 1; probe < MAX_SAMPLE_PROBES && table.ctrl[index] < 0; ++probe) {
+            // Another random slot.
+            index = static_cast<size_t>(nextRandom()) & mask;
+        }
+        // Still nothing: walk forward to the next live slot (the table holds at least one).
+        while (table.ctrl[index] < 0) index = (index + 1) & mask;
+        // Hand the key and stamp to the caller.
+        visit(SlabArena::key(table.slots[index]), table.stamps[index]);
+        // One more.
+        visited++;
+    }
+    // Return the number visited.
+    return visited;
+}
+
+// Returns the bytes held by the map.
+size_t HashMap::memoryUsage() const {
+    // Bytes per slot: control byte, record pointer and stamp.
+    constexpr size_t SLOT_BYTES = sizeof(int8_t) + sizeof(Slot) + sizeof(uint32_t);
+    // Both tables' arrays plus the records.
+    return (active.capacity + draining.capacity) * SLOT_BYTES + recordBytes;
+}
+
+// Returns the number of slots in the table receiving inserts.
+size_t HashMap::capacity() const {
+    // Return the slot count of the active table.
+    return active.capacity;
+}
+
+// Measures probe lengths on up to maxEntries live entries taken at evenly spaced slots.
+ProbeStats HashMap::probeStats(size_t maxEntries) const {
+    // Result.
+    ProbeStats stats;
+    // Nothing to measure.
+    if (active.size == 0 || maxEntries == 0) return stats;
+    // Mask for wrapping group indices.
+    size_t groupMask = active.capacity / GROUP_WIDTH - 1;
+    // Slots between two looks (about maxEntries looks over the table).
+    size_t stride = std::max<size_t>(1, active.capacity / maxEntries);
+    // Sum of the probe lengths.
+    size_t totalLength = 0;
+    // Look at every stride-th slot.
+    for (size_t index = 0; index < active.capacity && stats.sampledEntries < maxEntries; index += stride) {
+        // Empty and deleted slots hold nothing.
+        if (active.ctrl[index] < 0) continue;
+        // Group the entry sits in.
+        size_t target = index / GROUP_WIDTH;
+        // Home group of its hash.
+        size_t group = (hash(SlabArena::key(active.slots[index])) >> 7) & groupMask;
+        // Groups probed before reaching it.
+        size_t length = 1;
+        // Follow the triangular sequence findSlot walks.
+        for (size_t step = 1; group != target && step <= groupMask; ++step, ++length) group = (group + step) & groupMask;
+        // Count it.
+        totalLength += length;
+        // Longest so far.
+        stats.maxProbeLength = std::max(stats.maxProbeLength, length);
+        // One more entry.
+        stats.sampledEntries++;
+    }
+    // Average.
+    if (stats.sampledEntries != 0) stats.meanProbeLength = static_cast<double>(totalLength) / static_cast<double>(stats.sampledEntries);
+    // Report.
+    return stats;
 }
 
-// Rehashes the table when load factor exceeds a threshold (stub).
-void HashMap::rehash() {}
\ No newline at end of file
+// Returns true while an incremental resize is migrating entries.
+bool HashMap::isRehashing() const {
+    // The draining table is only allocated during a resize.
+    return draining.capacity != 0;
+}
+
+// Returns the number of resizes started so far.
+uint64_t HashMap::resizeCount() const {
+    // Bumped by startRehash.
+    return resizeEpoch;
+}
+
+// Visits the live entries in slots [cursor, cursor + maxSlots) of the active table.
+size_t HashMap::scan(size_t cursor, size_t maxSlots,
+                     const std::function<void(std::string_view, std::string_view)>& visit) const {
+    // Slot index where this call stops.
+    size_t end = cursor + maxSlots;
+    // Do not run past the end of the table.
+    if (end > active.capacity) end = active.capacity;
+    // Visit every full slot in the range.
+    for (; cursor < end; ++cursor) {
+        // Skip empty and deleted slots.
+        if (active.ctrl[cursor] < 0) continue;
+        // Hand the key and value to the caller.
+        visit(SlabArena::key(active.slots[cursor]), SlabArena::value(active.slots[cursor]));
+    }
+    // Resume point for the next call (capacity() once the table is exhausted).
+    return cursor;
+}
+
+// Starts an incremental resize into a table of newCapacity slots.
+void HashMap::startRehash(size_t newCapacity) {
+    // The current table becomes the one being drained.
+    draining = std::move(active);
+    // Allocate the new table.
+    initTable(active, newCapacity);
+    // Migration starts at the first slot.
+    migrateIndex = 0;
+    // Slot positions handed out by scan are no longer valid.
+    resizeEpoch++;
+}
+
+// Migrates up to maxGroups groups from the draining table into the active table.
+void HashMap::rehashStep(size_t maxGroups) {
+    // Nothing to do unless a resize is in progress.
+    if (!isRehashing()) return;
+    // Slot index where this step stops.
+    size_t end = migrateIndex + maxGroups * GROUP_WIDTH;
+    // Do not run past the end of the old table.
+    if (end > draining.capacity) end = draining.capacity;
+    // Move every live slot in the range.
+    for (; migrateIndex < end; ++migrateIndex) {
+        // Skip empty and deleted slots.
+        if (draining.ctrl[migrateIndex] < 0) continue;
+        // Recompute the hash of the key for its new position.
+        uint64_t hashCode = hash(SlabArena::key(draining.slots[migrateIndex]));
+        // Move the record pointer; the record itself stays put (the key is known to be absent from the new table).
+        insertSlot(active, hashCode, draining.slots[migrateIndex], draining.stamps[migrateIndex]);
+        // Detach it from the old table.
+        draining.slots[migrateIndex] = nullptr;
+        // Leave a tombstone so lookups for keys displaced past this group still reach them.
+        draining.ctrl[migrateIndex] = CTRL_DELETED;
+        // One fewer entry left to migrate.
+        draining.size--;
+    }
+    // Once the whole old table is drained, release it.
+    if (migrateIndex == draining.capacity) {
+        // Free the old arrays.
+        draining = Table();
+    }
+}
@@ -0,0 +1,456 @@
+#include "../include/io_ring.hpp"
+
+#ifdef KV_STORE_IO_URING
+
+#include <algorithm> // For std::min
+#include <cerrno> // For errno
+#include <cstring> // For std::memset, std::memcpy
+#include <sys/mman.h> // For the ring mappings
+#include <sys/syscall.h> // For the io_uring system call numbers
+#include <unistd.h> // For syscall, close
+
+namespace {
+    // Completion ring size relative to the submission ring (multishot requests post many completions per entry).
+    constexpr unsigned COMPLETIONS_PER_ENTRY = 4;
+
+    // Reads a value the kernel writes, ordered before the reads that depend on it.
+    unsigned loadAcquire(const unsigned* value) {
+        // Pairs with the kernel's release store.
+        return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+    }
+
+    // Publishes a value the kernel reads, ordered after the writes it covers.
+    void storeRelease(unsigned* value, unsigned update) {
+        // Pairs with the kernel's acquire load.
+        __atomic_store_n(value, update, __ATOMIC_RELEASE);
+    }
+}
+
+// Constructor: sets up a ring with room for entries submissions.
+IoRing::IoRing(unsigned entries)
+    : ringFd(-1), sqRing(nullptr), sqRingBytes(0), cqRing(nullptr), cqRingBytes(0), sqes(nullptr), sqesBytes(0),
+      sqHead(nullptr), sqTail(nullptr), sqArray(nullptr), sqMask(0), sqEntries(0), cqHead(nullptr), cqTail(nullptr),
+      cqMask(0), cqes(nullptr), preparedTail(0), publishedTail(0) {
+    // Requested sizes; the kernel fills in the ring offsets.
+    io_uring_params params{};
+    // A larger completion ring, so bursts of multishot completions do not overflow.
+    params.flags = IORING_SETUP_CQSIZE;
+    // Its size.
+    params.cq_entries = entries * COMPLETIONS_PER_ENTRY;
+    // Create the ring.
+    int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    // io_uring unavailable: the caller falls back.
+    if (fd < 0) return;
+    // Submission ring length.
+    sqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    // Completion ring length.
+    size_t completionBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    // One mapping holds both rings on kernels that offer it (5.4+).
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    // It must cover the larger one.
+    if (single) sqRingBytes = std::max(sqRingBytes, completionBytes);
+    // Map the submission ring.
+    void* sq = ::mmap(nullptr, sqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    // Mapping failed.
+    if (sq == MAP_FAILED) {
+        // Give up.
+        ::close(fd);
+        // Not open.
+        return;
+    }
+    // Keep it.
+    sqRing = static_cast<unsigned char*>(sq);
+    // Map the completion ring separately on older kernels.
+    if (single) {
+        // Shared.
+        cqRing = sqRing;
+    } else {
+        // Its own mapping.
+        void* cq = ::mmap(nullptr, completionBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        // Mapping failed.
+        if (cq == MAP_FAILED) {
+            // Undo the first one.
+            ::munmap(sqRing, sqRingBytes);
+            // Nothing mapped.
+            sqRing = nullptr;
+            // Give up.
+            ::close(fd);
+            // Not open.
+            return;
+        }
+        // Keep it.
+        cqRing = static_cast<unsigned char*>(cq);
+        // Its length.
+        cqRingBytes = completionBytes;
+    }
+    // Submission queue entries.
+    sqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+    // Map them.
+    void* entriesMap = ::mmap(nullptr, sqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    // Mapping failed.
+    if (entriesMap == MAP_FAILED) {
+        // Undo the ring mappings.
+        if (cqRingBytes != 0) ::munmap(cqRing, cqRingBytes);
+        // And the first one.
+        ::munmap(sqRing, sqRingBytes);
+        // Nothing mapped.
+        sqRing = cqRing = nullptr;
+        // Give up.
+        ::close(fd);
+        // Not open.
+        return;
+    }
+    // Keep it.
+    sqes = static_cast<io_uring_sqe*>(entriesMap);
+    // Submission ring fields.
+    sqHead = reinterpret_cast<unsigned*>(sqRing + params.sq_off.head);
+    // Tail.
+    sqTail = reinterpret_cast<unsigned*>(sqRing + params.sq_off.tail);
+    // Index array.
+    sqArray = reinterpret_cast<unsigned*>(sqRing + params.sq_off.array);
+    // Mask.
+    sqMask = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_mask);
+    // Size.
+    sqEntries = *reinterpret_cast<unsigned*>(sqRing + params.sq_off.ring_entries);
+    // Completion ring fields.
+    cqHead = reinterpret_cast<unsigned*>(cqRing + params.cq_off.head);
+    // Tail.
+    cqTail = reinterpret_cast<unsigned*>(cqRing + params.cq_off.tail);
+    // Mask.
+    cqMask = *reinterpret_cast<unsigned*>(cqRing + params.cq_off.ring_mask);
+    // Entries.
+    cqes = reinterpret_cast<io_uring_cqe*>(cqRing + params.cq_off.cqes);
+    // Start where the kernel is.
+    preparedTail = publishedTail = *sqTail;
+    // Ready.
+    ringFd = fd;
+}
+
+// Destructor: unmaps the rings and closes the descriptor.
+IoRing::~IoRing() {
+    // Nothing was set up.
+    if (ringFd < 0) return;
+    // Entries.
+    ::munmap(sqes, sqesBytes);
+    // Completion ring, when mapped on its own.
+    if (cqRingBytes != 0) ::munmap(cqRing, cqRingBytes);
+    // Submission ring.
+    ::munmap(sqRing, sqRingBytes);
+    // Closing the ring cancels anything still in flight.
+    ::close(ringFd);
+}
+
+// Returns false if the kernel refused the ring.
+bool IoRing::isOpen() const {
+    // Set once by the constructor.
+    return ringFd >= 0;
+}
+
+// Returns a zeroed submission entry to fill in.
+io_uring_sqe* IoRing::nextSqe() {
+    // Queue full: hand the prepared entries to the kernel first.
+    if (preparedTail - loadAcquire(sqHead) >= sqEntries) submit(0);
+    // Still full (the kernel has not consumed them).
+    if (preparedTail - loadAcquire(sqHead) >= sqEntries) return nullptr;
+    // Next entry.
+    io_uring_sqe* sqe = &sqes[preparedTail & sqMask];
+    // Entries are reused, so clear every field.
+    std::memset(sqe, 0, sizeof(*sqe));
+    // Hand it out.
+    preparedTail++;
+    // To be filled in.
+    return sqe;
+}
+
+// Publishes every prepared entry and enters the kernel once.
+int IoRing::submit(unsigned waitFor) {
+    // Entries to publish.
+    unsigned count = preparedTail - publishedTail;
+    // Point the index array at them (entry i sits in slot i).
+    for (unsigned i = publishedTail; i != preparedTail; ++i) sqArray[i & sqMask] = i & sqMask;
+    // Make them visible to the kernel.
+    storeRelease(sqTail, preparedTail);
+    // Published.
+    publishedTail = preparedTail;
+    // Nothing to submit or wait for.
+    if (count == 0 && waitFor == 0) return 0;
+    // Submit and wait in one call, retrying if a signal interrupted the wait.
+    while (true) {
+        // Enter the kernel.
+        int result = static_cast<int>(::syscall(__NR_io_uring_enter, ringFd, count, waitFor, waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+        // Submitted (and waited).
+        if (result >= 0) return result;
+        // Interrupted: the entries were consumed or will be on the retry.
+        if (errno == EINTR) {
+            // The kernel already took them.
+            count = 0;
+            // Wait again.
+            continue;
+        }
+        // Report the error.
+        return -errno;
+    }
+}
+
+// Returns the oldest unreaped completion.
+io_uring_cqe* IoRing::peekCompletion() {
+    // Our head.
+    unsigned head = *cqHead;
+    // Nothing new.
+    if (head == loadAcquire(cqTail)) return nullptr;
+    // The completion.
+    return &cqes[head & cqMask];
+}
+
+// Marks the completion returned by peekCompletion as reaped.
+void IoRing::advanceCompletion() {
+    // Give the slot back to the kernel.
+    storeRelease(cqHead, *cqHead + 1);
+}
+
+// Registers fixed buffers.
+bool IoRing::registerBuffers(const iovec* buffers, unsigned count) {
+    // One registration call.
+    return ::syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_BUFFERS, buffers, count) == 0;
+}
+
+// Returns the ring descriptor.
+int IoRing::descriptor() const {
+    // Set by the constructor.
+    return ringFd;
+}
+
+// Constructor: allocates the receive buffers and provides them to the kernel.
+IoBufferRing::IoBufferRing(IoRing& ring, uint16_t groupId, unsigned count, size_t bufferBytes)
+    : ring(ring), storage(count * bufferBytes), count(count), bufferBytes(bufferBytes), groupId(groupId), registered(false) {
+    // Entry providing every buffer at once.
+    io_uring_sqe* sqe = ring.nextSqe();
+    // A fresh ring always has room; a refused ring has none.
+    if (sqe == nullptr) return;
+    // Provide buffers...
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    // ...this many...
+    sqe->fd = static_cast<int32_t>(count);
+    // ...laid out back to back from here...
+    sqe->addr = reinterpret_cast<uint64_t>(storage.data());
+    // ...each this long...
+    sqe->len = static_cast<uint32_t>(bufferBytes);
+    // ...numbered from 0...
+    sqe->off = 0;
+    // ...in this group.
+    sqe->buf_group = groupId;
+    // Marks the completion as the ring's own.
+    sqe->user_data = PROVIDE_TAG;
+    // Submit it and wait for the answer (kernel 5.7+).
+    if (ring.submit(1) < 0) return;
+    // Its completion (the only one on a fresh ring).
+    io_uring_cqe* completion = ring.peekCompletion();
+    // Accepted.
+    registered = completion != nullptr && completion->res >= 0;
+    // Reaped.
+    if (completion != nullptr) ring.advanceCompletion();
+}
+
+// Destructor: the buffers die with the ring, which is closed after this.
+IoBufferRing::~IoBufferRing() = default;
+
+// Returns false if the kernel does not support provided buffers.
+bool IoBufferRing::isOpen() const {
+    // Set by the constructor.
+    return registered;
+}
+
+// Returns the group id.
+uint16_t IoBufferRing::group() const {
+    // Fixed at construction.
+    return groupId;
+}
+
+// Returns the start of buffer id.
+const char* IoBufferRing::buffer(uint16_t id) const {
+    // Buffers are laid out back to back.
+    return storage.data() + static_cast<size_t>(id) * bufferBytes;
+}
+
+// Hands buffer id back to the kernel.
+void IoBufferRing::recycle(uint16_t id) {
+    // Queue it behind any the full submission queue held back.
+    pending.push_back(id);
+    // Provide each of them again.
+    while (!pending.empty()) {
+        // Entry for the oldest.
+        io_uring_sqe* sqe = ring.nextSqe();
+        // Still full: retried on the next recycle.
+        if (sqe == nullptr) return;
+        // Buffer to provide.
+        uint16_t next = pending.back();
+        // Taken.
+        pending.pop_back();
+        // Provide buffers...
+        sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+        // ...just this one...
+        sqe->fd = 1;
+        // ...at its address...
+        sqe->addr = reinterpret_cast<uint64_t>(storage.data() + static_cast<size_t>(next) * bufferBytes);
+        // ...of its size...
+        sqe->len = static_cast<uint32_t>(bufferBytes);
+        // ...under its id...
+        sqe->off = next;
+        // ...in this group.
+        sqe->buf_group = groupId;
+        // Marks the completion as the ring's own.
+        sqe->user_data = PROVIDE_TAG;
+    }
+}
+
+// Constructor: writes fd sequentially from offset.
+RingFileWriter::RingFileWriter(int fd, uint64_t offset, size_t slotBytes, unsigned depth)
+    : ring(depth + 1), fd(fd), slotBytes(slotBytes), storage(slotBytes * depth), slotLength(depth, 0), currentSlot(-1),
+      offset(offset), inFlight(0), syncPending(false), failed(false), registered(false) {
+    // No ring, no writer.
+    if (!ring.isOpen()) return;
+    // One fixed buffer per slot.
+    std::vector<iovec> slots(depth);
+    // Point at each.
+    for (unsigned i = 0; i < depth; ++i) slots[i] = iovec{storage.data() + i * slotBytes, slotBytes};
+    // Register them, so writes skip pinning the pages each time.
+    registered = ring.registerBuffers(slots.data(), depth);
+    // Every slot is free.
+    for (unsigned i = depth; i > 0; --i) freeSlots.push_back(i - 1);
+}
+
+// Returns false if the ring or its buffers could not be set up.
+bool RingFileWriter::isOpen() const {
+    // Both are needed.
+    return ring.isOpen() && registered;
+}
+
+// Queues the current buffer for writing.
+void RingFileWriter::submitSlot() {
+    // Nothing to write.
+    if (currentSlot < 0) return;
+    // Buffer being written.
+    unsigned slot = static_cast<unsigned>(currentSlot);
+    // No longer being filled.
+    currentSlot = -1;
+    // Empty buffers go straight back.
+    if (slotLength[slot] == 0) {
+        // Free it.
+        freeSlots.push_back(slot);
+        // Done.
+        return;
+    }
+    // Entry for the write (the ring has a spare entry per buffer, so one is always free).
+    io_uring_sqe* sqe = ring.nextSqe();
+    // Write from the registered buffer.
+    sqe->opcode = IORING_OP_WRITE_FIXED;
+    // File.
+    sqe->fd = fd;
+    // Source.
+    sqe->addr = reinterpret_cast<uint64_t>(storage.data() + slot * slotBytes);
+    // Length.
+    sqe->len = static_cast<uint32_t>(slotLength[slot]);
+    // Position in the file.
+    sqe->off = offset;
+    // Registered buffer index.
+    sqe->buf_index = static_cast<uint16_t>(slot);
+    // Identify it on completion.
+    sqe->user_data = slot;
+    // The next write follows it.
+    offset += slotLength[slot];
+    // Count it.
+    inFlight++;
+    // Start it without waiting.
+    if (ring.submit(0) < 0) failed = true;
+}
+
+// Reaps completions, waiting for at least waitFor.
+void RingFileWriter::reap(unsigned waitFor) {
+    // Wait if asked to.
+    if (waitFor > 0 && ring.submit(waitFor) < 0) failed = true;
+    // Take every completion.
+    while (io_uring_cqe* cqe = ring.peekCompletion()) {
+        // Buffer it wrote from (fsyncs carry UINT64_MAX).
+        uint64_t slot = cqe->user_data;
+        // A write.
+        if (slot < slotLength.size()) {
+            // A short or failed write loses data.
+            if (cqe->res != static_cast<int32_t>(slotLength[slot])) failed = true;
+            // The buffer is free again.
+            slotLength[slot] = 0;
+            // Reuse it.
+            freeSlots.push_back(static_cast<unsigned>(slot));
+            // One fewer in flight.
+            inFlight--;
+        } else {
+            // The fsync finished (or failed).
+            if (cqe->res < 0) failed = true;
+            // No longer pending.
+            syncPending = false;
+        }
+        // Consume it.
+        ring.advanceCompletion();
+    }
+}
+
+// Copies data into the buffers, queueing each full one.
+void RingFileWriter::write(const char* data, size_t size) {
+    // Until everything is buffered.
+    while (size > 0) {
+        // Need a buffer to fill.
+        if (currentSlot < 0) {
+            // Wait for a write to finish if every buffer is in flight.
+            while (freeSlots.empty()) reap(1);
+            // Take one.
+            currentSlot = static_cast<int>(freeSlots.back());
+            // In use.
+            freeSlots.pop_back();
+        }
+        // Buffer being filled.
+        unsigned slot = static_cast<unsigned>(currentSlot);
+        // Bytes that fit.
+        size_t chunk = std::min(size, slotBytes - slotLength[slot]);
+        // Copy them.
+        std::memcpy(storage.data() + slot * slotBytes + slotLength[slot], data, chunk);
+        // Account for them.
+        slotLength[slot] += chunk;
+        // Past them.
+        data += chunk;
+        // Fewer left.
+        size -= chunk;
+        // A full buffer goes out.
+        if (slotLength[slot] == slotBytes) submitSlot();
+    }
+}
+
+// Writes the rest, waits for every write and optionally fsyncs.
+bool RingFileWriter::finish(bool sync) {
+    // Queue the partial buffer.
+    submitSlot();
+    // Queue the fsync behind every write in the same submission.
+    if (sync) {
+        // Entry for it.
+        io_uring_sqe* sqe = ring.nextSqe();
+        // Flush the file.
+        sqe->opcode = IORING_OP_FSYNC;
+        // File.
+        sqe->fd = fd;
+        // Start only after every earlier entry completed.
+        sqe->flags = IOSQE_IO_DRAIN;
+        // Not a buffer.
+        sqe->user_data = UINT64_MAX;
+        // Waited for below.
+        syncPending = true;
+    }
+    // Wait for everything, submitting the fsync with the wait.
+    while (inFlight > 0 || syncPending) {
+        // Nothing can complete if entering the ring fails.
+        if (ring.submit(1) < 0) return false;
+        // Take what completed.
+        reap(0);
+    }
+    // Success if nothing failed.
+    return !failed;
+}
+
+#endif // KV_STORE_IO_URING
@@ -1,91 +1,1797 @@
 #include "../include/kv_store.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <algorithm> // For std::max, std::min
+#include <cstring> // For std::memcpy of deadlines
+#include <unistd.h> // For fork, _exit
+#include <sys/wait.h> // For waitpid
+#include <sys/stat.h> // For the size of a rewritten log
+#include <cstdio> // For std::rename
+
+namespace {
+    // Returns the smallest key after every key starting with prefix, or std::nullopt if there is none (an empty
+    // prefix, or one of only 0xFF bytes), so a prefix is the range [prefix, prefixEnd(prefix)).
+    std::optional<std::string> prefixEnd(std::string_view prefix) {
+        // Start from the prefix.
+        std::string end(prefix);
+        // Drop trailing 0xFF bytes, which cannot be incremented.
+        while (!end.empty()) {
+            // Last byte, unsigned as keys are ordered.
+            unsigned char last = static_cast<unsigned char>(end.back());
+            // Increment it: every key with the prefix sorts before the result.
+            if (last != 0xFF) {
+                // Next byte value.
+                end.back() = static_cast<char>(last + 1);
+                // Done.
+                return end;
+            }
+            // Carry into the byte before.
+            end.pop_back();
+        }
+        // Unbounded.
+        return std::nullopt;
+    }
+
+    // Builds a configuration from the positional constructor arguments.
+    KVStoreConfig makeConfig(size_t hashMapCapacity, size_t cacheCapacity,
+                             size_t bloomFilterSize, size_t bloomFilterNumHashes) {
+        // Start from the defaults.
+        KVStoreConfig config;
+        // Copy each positional argument.
+        config.hashMapCapacity = hashMapCapacity;
+        // Cache capacity.
+        config.cacheCapacity = cacheCapacity;
+        // Bloom filter size.
+        config.bloomFilterSize = bloomFilterSize;
+        // Bloom filter hash count.
+        config.bloomFilterNumHashes = bloomFilterNumHashes;
+        // Return the filled configuration.
+        return config;
+    }
+
+    // Returns the false-positive rate past which a configuration's filter is rebuilt (0 when disabled).
+    double rebuildThreshold(const KVStoreConfig& config) {
+        // A multiple of the target rate.
+        return config.filterRebuildFactor * config.bloomTargetFpr;
+    }
+
+    // LFU: starting counter of a new key, so it is not the first victim before it had a chance to be read.
+    constexpr uint32_t LFU_INIT_VALUE = 5;
+    // LFU: the counter grows logarithmically; larger factors need more accesses per step.
+    constexpr uint32_t LFU_LOG_FACTOR = 10;
+    // LFU: the counter loses one per 2^LFU_DECAY_SHIFT ticks of the access clock it goes unread.
+    constexpr unsigned LFU_DECAY_SHIFT = 16;
+    // LFU: largest counter value (the low byte of the stamp).
+    constexpr uint32_t LFU_MAX_COUNTER = 255;
+
+    // LFU stamp layout: decay period (access clock >> LFU_DECAY_SHIFT) in the high 24 bits, counter in the low 8.
+    uint32_t lfuStamp(uint32_t clock, uint32_t counter) {
+        // Pack both fields.
+        return ((clock >> LFU_DECAY_SHIFT) << 8) | counter;
+    }
+
+    // Returns an LFU stamp's counter after decaying it for the periods elapsed since it was written.
+    uint32_t lfuDecayedCounter(uint32_t stamp, uint32_t clock) {
+        // Periods since the last access, modulo the 24-bit field.
+        uint32_t elapsed = ((clock >> LFU_DECAY_SHIFT) - (stamp >> 8)) & 0xFFFFFF;
+        // Stored counter.
+        uint32_t counter = stamp & 0xFF;
+        // Lose one per period, down to zero.
+        return counter > elapsed ? counter - elapsed : 0;
+    }
+
+    // Snapshot entries hashed and prefetched ahead of the one being inserted while loading.
+    constexpr size_t LOAD_PREFETCH_DISTANCE = 16;
+
+    // A snapshot entry waiting for its prefetched lines.
+    struct PendingEntry {
+        // Key (a view into the mapped snapshot).
+        std::string_view key;
+        // Value (likewise).
+        std::string_view value;
+        // Its hash.
+        uint64_t hashCode;
+    };
+
+    // Returns true for the policies that track an access stamp per key.
+    bool tracksAccess(EvictionPolicy policy) {
+        // Random and noeviction never look at stamps.
+        return policy == EvictionPolicy::AllKeysLRU || policy == EvictionPolicy::AllKeysLFU ||
+               policy == EvictionPolicy::VolatileLRU;
+    }
+}
 
 // Constructor: initializes all underlying data structures.
 KVStore::KVStore(size_t hashMapCapacity,
                  size_t cacheCapacity,
                  size_t bloomFilterSize,
                  size_t bloomFilterNumHashes)
-    // Initialize mainStore with provided or default capacity.
-    : mainStore(hashMapCapacity),
+    // Delegate to the configuration constructor.
+    : KVStore(makeConfig(hashMapCapacity, cacheCapacity, bloomFilterSize, bloomFilterNumHashes)) {
+}
+
+// Constructor: initializes all underlying data structures from a full configuration.
+KVStore::KVStore(const KVStoreConfig& config)
+    // Keep the settings for later filter rebuilds.
+    : settings(config),
+      // Initialize the record arena (empty until the first set).
+      arena(),
+      // Initialize mainStore with the configured capacity and resize thresholds, backed by the store's arena.
+      mainStore(config.hashMapCapacity, config.maxLoadFactor, config.minLoadFactor, &arena),
+      // Deadlines share the arena; most stores have few, so start small.
+      expires(16, config.maxLoadFactor, config.minLoadFactor, &arena),
+      // The wheel starts at the current time.
+      expiryWheel(config.clock ? config.clock() : Utils::unixMillis()),
+      // Nothing expired yet.
+      expiredKeys(0),
       // Initialize keyTrie (default constructor).
       keyTrie(), // Default constructor is fine
-      // Initialize cache with provided or default capacity.
-      cache(cacheCapacity),
-      // Initialize filter with provided or default size and number of hashes.
-      filter(bloomFilterSize, bloomFilterNumHashes) {
-    // Constructor body can be empty if all initialization is done in the member initializer list.
+      // Initialize cache with the configured capacity.
+      cache(config.cacheCapacity, config.cachePolicy, CacheStorage::Borrowed),
+      // Initialize the filter from the configured mode and size, or from the expected key count and target rate.
+      filter(config.filterMode, config.bloomExpectedKeys, config.bloomTargetFpr, rebuildThreshold(config),
+             config.bloomFilterSize, config.bloomFilterNumHashes),
+      // No rebuild running.
+      rebuildCursor(0), rebuildResizeCount(0), rebuildExpectedKeys(0), filterRebuilds(0),
+      // Eviction state starts clean.
+      accessClock(0), evictionRng(0x9E3779B97F4A7C15ULL), evictedKeys(0), rejectedWrites(0),
+      // No background save running.
+      backgroundSavePid(-1),
+      // No log records or rewrite yet.
+      appendLogSequence(0), logRewritePid(-1), logRewriteFloor(0), damagedLogBytes(0),
+      // No writes or snapshots yet.
+      writeVersion(0), keptVersions(0), versionBytes(0), collectedVersions(0) {
+    // Without an append log the store starts empty.
+    if (config.appendLogPath.empty()) return;
+    // The memory budget is not enforced while replaying (as while loading a snapshot).
+    settings.maxMemoryBytes = 0;
+    // Keys whose deadline passed while the store was down, unless a later record cancels it.
+    std::unordered_set<std::string> lapsed;
+    // Rebuild the contents; appendLog is still null, so nothing replayed is logged again.
+    LogReplayResult replayed = AppendLog::replay(config.appendLogPath, [&](const LogRecord& record) { applyLogRecord(record, lapsed); });
+    // Drop the keys that expired.
+    for (const std::string& key : lapsed) {
+        // Remove it everywhere.
+        deleteKey(key, Utils::hash64(key));
+        // Count it.
+        expiredKeys++;
+    }
+    // Restore the budget.
+    settings.maxMemoryBytes = config.maxMemoryBytes;
+    // A damaged record with more after it: cutting the file there would destroy every later record, so the file is
+    // moved aside untouched and a new log is written from what was replayed. If either step fails the store runs
+    // without a log rather than risk the damaged one.
+    if (replayed.damagedBytes != 0) {
+        // Remember it for appendLogStats, whatever happens next.
+        damagedLogBytes = replayed.damagedBytes;
+        // Next to the log, named by the time it was set aside.
+        std::string asidePath = config.appendLogPath + ".damaged." + std::to_string(Utils::unixMillis());
+        // Keep every byte of it.
+        if (std::rename(config.appendLogPath.c_str(), asidePath.c_str()) != 0) return;
+        // The replayed state as a fresh log.
+        if (!writeCompactedLog(config.appendLogPath, now())) return;
+        // Its size.
+        struct stat info;
+        // New records follow it.
+        if (::stat(config.appendLogPath.c_str(), &info) != 0) return;
+        // The whole new file is valid.
+        replayed.validBytes = static_cast<size_t>(info.st_size);
+    }
+    // New records follow the last valid one.
+    appendLog = std::make_unique<AppendLog>(config.appendLogPath, config.appendFsync, replayed.validBytes);
+    // Keep the replay figures for stats.
+    appendLog->setReplayResult(replayed);
+}
+
+// Destructor: waits for a background save or log rewrite still writing, then flushes the append log.
+KVStore::~KVStore() {
+    // Let the child finish its file rather than leave it behind.
+    collectBackgroundSave(true);
+    // Likewise a log rewrite, which then takes over as the log.
+    collectLogRewrite(true);
+    // appendLog's destructor writes and syncs whatever is still buffered.
+}
+
+// Starts a background rebuild sized for the current number of keys.
+void KVStore::startFilterRebuild() {
+    // Leave room to grow: twice the live keys, and never less than configured.
+    rebuildExpectedKeys = std::max(settings.bloomExpectedKeys, 2 * mainStore.size());
+    // Begin the first pass.
+    restartFilterRebuild();
+}
+
+// Restarts the current rebuild pass from the first slot.
+void KVStore::restartFilterRebuild() {
+    // A fresh, empty replacement filter (rebuilds always size from the key count and target rate).
+    rebuildFilter = std::make_unique<MembershipFilter>(settings.filterMode, rebuildExpectedKeys,
+                                                       settings.bloomTargetFpr, rebuildThreshold(settings));
+    // Scan from the first slot.
+    rebuildCursor = 0;
+    // Slot positions are valid until the next mainStore resize.
+    rebuildResizeCount = mainStore.resizeCount();
+    // Changes before this point are covered by the scan.
+    rebuildTouched.clear();
+}
+
+// Advances a rebuild in progress (or starts one if the filter needs it) by up to maxSlots slots.
+void KVStore::filterMaintenanceStep(size_t maxSlots) {
+    // Nothing to do unless a rebuild is running or due.
+    if (!rebuildFilter) {
+        // Keep using the current filter while it is within its threshold.
+        if (!filter.needsRebuild()) return;
+        // Otherwise start replacing it.
+        startFilterRebuild();
+    }
+    // A resize moves entries between slots, so the scan can only run between resizes.
+    if (mainStore.isRehashing()) return;
+    // A resize since this pass started invalidated its cursor.
+    if (mainStore.resizeCount() != rebuildResizeCount) {
+        // Start the pass over against the new layout.
+        restartFilterRebuild();
+    }
+    // Set when the replacement filter itself fills up.
+    bool overflowed = false;
+    // Copy the next slots' keys into the replacement filter.
+    rebuildCursor = mainStore.scan(rebuildCursor, maxSlots, [&](std::string_view key, std::string_view) {
+        // Hash of the key.
+        uint64_t hashCode = Utils::hash64(key);
+        // Keys changed during the rebuild are applied when the pass completes.
+        if (rebuildTouched.count(hashCode) != 0) return;
+        // Add the key.
+        if (!rebuildFilter->add(hashCode)) overflowed = true;
+    });
+    // The pass is done once every slot was scanned.
+    if (!overflowed && rebuildCursor == mainStore.capacity()) {
+        // Apply the keys changed during the pass.
+        for (const auto& change : rebuildTouched) {
+            // Keys that ended up present go in; removed ones stay out.
+            if (change.second && !rebuildFilter->add(change.first)) overflowed = true;
+        }
+    }
+    // An undersized replacement is retried at twice the size.
+    if (overflowed) {
+        // Double the target.
+        rebuildExpectedKeys *= 2;
+        // Start a new pass.
+        restartFilterRebuild();
+        // Continue on the next step.
+        return;
+    }
+    // Not done yet.
+    if (rebuildCursor != mainStore.capacity()) return;
+    // Swap the replacement in.
+    filter = std::move(*rebuildFilter);
+    // The rebuild is over.
+    rebuildFilter.reset();
+    // Release the change log.
+    rebuildTouched.clear();
+    // Count it.
+    filterRebuilds++;
+}
+
+// Returns the next pseudo-random number for eviction.
+uint64_t KVStore::nextRandom() {
+    // splitmix64: advance the state by the golden-ratio increment.
+    uint64_t z = (evictionRng += 0x9E3779B97F4A7C15ULL);
+    // Mix.
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    // Mix again.
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    // Final fold.
+    return z ^ (z >> 31);
+}
+
+// Updates a key's access stamp for the LRU or LFU policy.
+void KVStore::recordAccess(std::string_view key, uint64_t hashCode) {
+    // Stamps only matter when something may be evicted by age or frequency.
+    if (settings.maxMemoryBytes == 0 || !tracksAccess(settings.evictionPolicy)) return;
+    // The key's stamp in the main store.
+    uint32_t* stamp = mainStore.accessStamp(key, hashCode);
+    // Absent keys (a false positive path) have none.
+    if (stamp == nullptr) return;
+    // Every tracked access ticks the clock.
+    accessClock++;
+    // LRU: remember when the key was last accessed.
+    if (settings.evictionPolicy != EvictionPolicy::AllKeysLFU) {
+        // Current clock.
+        *stamp = accessClock;
+        // Done.
+        return;
+    }
+    // LFU: a new key (stamp 0) starts at the initial counter; its first write is not yet a repeat access.
+    if (*stamp == 0) {
+        // Initial counter in the current period.
+        *stamp = lfuStamp(accessClock, LFU_INIT_VALUE);
+        // Done.
+        return;
+    }
+    // Counter after decay for the periods the key went unaccessed.
+    uint32_t counter = lfuDecayedCounter(*stamp, accessClock);
+    // Logarithmic increment: the higher the counter, the less likely it grows.
+    if (counter < LFU_MAX_COUNTER) {
+        // Probability 1 / ((counter - init) * factor + 1).
+        uint64_t base = counter > LFU_INIT_VALUE ? counter - LFU_INIT_VALUE : 0;
+        // Draw against it.
+        if (nextRandom() % (base * LFU_LOG_FACTOR + 1) == 0) counter++;
+    }
+    // Store the counter with the current decay period.
+    *stamp = lfuStamp(accessClock, counter);
+}
+
+// Evicts one key chosen by the policy from a sample.
+bool KVStore::evictOne() {
+    // Policy in use.
+    EvictionPolicy policy = settings.evictionPolicy;
+    // Nothing may be evicted.
+    if (policy == EvictionPolicy::NoEviction) return false;
+    // Volatile policies only consider keys with a deadline.
+    bool volatileOnly = policy == EvictionPolicy::VolatileLRU || policy == EvictionPolicy::VolatileRandom;
+    // Best candidate so far.
+    std::string victim;
+    // Its score (higher is a better victim).
+    uint64_t bestScore = 0;
+    // Whether any candidate was seen.
+    bool found = false;
+    // Random keys only need a random starting slot; the others compare a few samples.
+    bool random = policy == EvictionPolicy::AllKeysRandom || policy == EvictionPolicy::VolatileRandom;
+    // Samples per victim.
+    size_t samples = random ? 1 : std::max<size_t>(1, settings.evictionSamples);
+    // Scores one sampled key.
+    auto consider = [&](std::string_view key, uint32_t stamp) {
+        // LRU: idle time on the access clock (unsigned difference survives wrap-around).
+        uint64_t score = policy == EvictionPolicy::AllKeysLRU || policy == EvictionPolicy::VolatileLRU ? accessClock - stamp
+                       // LFU: the lower the decayed counter, the better the victim.
+                       : policy == EvictionPolicy::AllKeysLFU ? LFU_MAX_COUNTER - lfuDecayedCounter(stamp, accessClock)
+                       // Random: the only sample.
+                       : 0;
+        // Keep the first candidate and any better one.
+        if (!found || score > bestScore) {
+            // Copy the key out (the view does not survive the removal below).
+            victim.assign(key);
+            // Its score.
+            bestScore = score;
+            // At least one candidate.
+            found = true;
+        }
+    };
+    // Volatile policies sample the deadline table, then read each key's access stamp from the main store.
+    if (volatileOnly) {
+        // Sample keys with a deadline.
+        expires.sample(nextRandom(), samples, [&](std::string_view key, uint32_t) {
+            // Its access stamp.
+            uint32_t* stamp = mainStore.accessStamp(key, Utils::hash64(key));
+            // Score it (every key with a deadline is in the main store).
+            if (stamp != nullptr) consider(key, *stamp);
+        });
+    } else {
+        // Sample any key.
+        mainStore.sample(nextRandom(), samples, consider);
+    }
+    // No candidate (an empty store, or no key with a deadline).
+    if (!found) return false;
+    // Drop it from every structure.
+    deleteKey(victim, Utils::hash64(victim));
+    // Log it, so a replay under a different budget does not bring it back.
+    logWrite(LogRecord{LogOp::Remove, victim, {}, 0});
+    // Count it.
+    evictedKeys++;
+    // One key evicted.
+    return true;
+}
+
+// Evicts keys until incomingBytes more fit the budget.
+bool KVStore::makeRoom(size_t incomingBytes) {
+    // Keys evicted by this write.
+    size_t evicted = 0;
+    // Evict while over budget, up to the per-write cap.
+    while (memoryUsage() + incomingBytes > settings.maxMemoryBytes && evicted < MAX_EVICTIONS_PER_WRITE) {
+        // Stop when the policy has no candidate left.
+        if (!evictOne()) break;
+        // One more.
+        evicted++;
+    }
+    // The write fits.
+    if (memoryUsage() + incomingBytes <= settings.maxMemoryBytes) return true;
+    // Over budget but making progress: let it through and let the next writes continue evicting.
+    return evicted > 0;
 }
 
 // Sets (inserts or updates) a key-value pair in the store.
-void KVStore::set(const std::string& key, const std::string& value) {
-    // Set the key-value pair in the main hash map.
-    mainStore.set(key, value);
+bool KVStore::set(const std::string& key, const std::string& value) {
+    // Hash the key once for every structure.
+    return set(key, value, Utils::hash64(key));
+}
+
+// Sets a key-value pair whose hash the caller already computed.
+bool KVStore::set(std::string_view key, std::string_view value, uint64_t hashCode) {
+    // Timed until it is durable.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Set);
+    // Write and log it.
+    bool written = writeValue(key, value, hashCode);
+    // Make it (and any eviction it caused) durable.
+    commitWrite();
+    // Report whether it went through.
+    return written;
+}
+
+// Sets a key-value pair and logs it, without waiting for the log.
+bool KVStore::writeValue(std::string_view key, std::string_view value, uint64_t hashCode) {
+    // Enforce the memory budget before writing (the payload is a lower bound on what the write adds).
+    if (settings.maxMemoryBytes != 0 && !makeRoom(key.size() + value.size())) {
+        // Count the rejection.
+        rejectedWrites++;
+        // Nothing was written.
+        return false;
+    }
+    // Keep the state it replaces for any snapshot that can still see it.
+    preserveVersion(key, hashCode);
+    // Whether the key is new.
+    bool inserted;
+    // Set the key-value pair in the main hash map; its record is the only copy of the value.
+    const char* record = mainStore.upsert(key, value, hashCode, inserted);
+    // Record the write in the append log.
+    logWrite(LogRecord{LogOp::Set, key, value, 0});
     // Insert the key into the Trie for prefix searching.
     keyTrie.insert(key); // Assuming Trie's insert handles duplicates gracefully or is idempotent.
-    // Add/update the key-value pair in the LRU cache.
-    cache.put(key, value);
-    // Add the key to the Bloom Filter.
-    filter.add(key);
+    // Index the record in the cache (it views the record's value, which may have moved, so refresh it on every write).
+    cache.put(key, SlabArena::value(record), hashCode);
+    // New keys enter the filter once (an update is already in it, and a cuckoo filter must not hold duplicates).
+    if (inserted) {
+        // Add the key to the membership filter.
+        filter.add(hashCode);
+        // A rebuild in progress applies the key when its pass completes.
+        if (rebuildFilter) rebuildTouched[hashCode] = true;
+    }
+    // A plain write clears any deadline (its timer goes stale and is ignored when it fires).
+    if (expires.size() != 0) expires.remove(key, hashCode);
+    // A write counts as an access.
+    recordAccess(key, hashCode);
+    // Pay a bounded share of any filter rebuild.
+    filterMaintenanceStep(FILTER_REBUILD_SLOTS_PER_STEP);
+    // Reclaim a few keys whose deadline passed.
+    expiryStep(EXPIRED_KEYS_PER_STEP);
+    // The write went through.
+    return true;
+}
+
+// Sets a key-value pair that expires ttlMillis milliseconds from now.
+bool KVStore::setWithTtl(const std::string& key, const std::string& value, uint64_t ttlMillis) {
+    // Timed as a set.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Set);
+    // Hash the key once for every structure.
+    uint64_t hashCode = Utils::hash64(key);
+    // Write it (this clears any older deadline).
+    bool written = writeValue(key, value, hashCode);
+    // Give it its deadline.
+    if (written) {
+        // Absolute, so a replay does not restart the countdown.
+        uint64_t deadline = now() + ttlMillis;
+        // Deadline table and timing wheel.
+        setDeadline(key, hashCode, deadline);
+        // Log it after the value; both share the next sync.
+        logWrite(LogRecord{LogOp::ExpireAt, key, {}, deadline});
+    }
+    // Make the records durable.
+    commitWrite();
+    // Report whether it went through.
+    return written;
+}
+
+// Gives an existing key a deadline ttlMillis from now.
+bool KVStore::expire(const std::string& key, uint64_t ttlMillis) {
+    // Timed with the other deadline commands.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Expire);
+    // Hash the key once for every structure.
+    uint64_t hashCode = Utils::hash64(key);
+    // An already expired key is gone.
+    if (expireIfDue(key, hashCode)) return false;
+    // Only existing keys get a deadline.
+    if (!mainStore.contains(key, hashCode)) return false;
+    // Absolute deadline.
+    uint64_t deadline = now() + ttlMillis;
+    // Replace the deadline.
+    setDeadline(key, hashCode, deadline);
+    // Log it.
+    logWrite(LogRecord{LogOp::ExpireAt, key, {}, deadline});
+    // Make it durable.
+    commitWrite();
+    // Done.
+    return true;
+}
+
+// Removes a key's deadline.
+bool KVStore::persist(const std::string& key) {
+    // Timed with the other deadline commands.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Expire);
+    // Hash the key once for every structure.
+    uint64_t hashCode = Utils::hash64(key);
+    // An already expired key is gone.
+    if (expireIfDue(key, hashCode)) return false;
+    // Nothing to drop.
+    if (!deadlineOf(key, hashCode)) return false;
+    // Keep the state it replaces for any snapshot that can still see it.
+    preserveVersion(key, hashCode);
+    // Drop the deadline; its timer goes stale.
+    expires.remove(key, hashCode);
+    // Log it.
+    logWrite(LogRecord{LogOp::Persist, key, {}, 0});
+    // Make it durable.
+    commitWrite();
+    // Done.
+    return true;
+}
+
+// Returns the milliseconds left before a key expires.
+int64_t KVStore::ttl(const std::string& key) {
+    // Timed with the other deadline commands.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Expire);
+    // Hash the key once for every structure.
+    uint64_t hashCode = Utils::hash64(key);
+    // Read once: the expiry check and the time left must agree, or a deadline passing in between would wrap.
+    uint64_t currentTime = now();
+    // An already expired key is gone.
+    if (expireIfDue(key, hashCode, currentTime)) return TTL_MISSING;
+    // Missing key.
+    if (!mainStore.contains(key, hashCode)) return TTL_MISSING;
+    // Its deadline, if any.
+    std::optional<uint64_t> deadline = deadlineOf(key, hashCode);
+    // Time left (expireIfDue guarantees it is after currentTime).
+    return deadline ? static_cast<int64_t>(*deadline - currentTime) : TTL_NO_EXPIRY;
+}
+
+// Returns the current time in milliseconds since the Unix epoch.
+uint64_t KVStore::now() const {
+    // The configured clock, or the system clock.
+    return settings.clock ? settings.clock() : Utils::unixMillis();
+}
+
+// Returns a key's deadline, or std::nullopt if it has none.
+std::optional<uint64_t> KVStore::deadlineOf(std::string_view key, uint64_t hashCode) const {
+    // No key has a deadline: skip the probe.
+    if (expires.size() == 0) return std::nullopt;
+    // The stored deadline bytes.
+    std::optional<std::string_view> stored = expires.peek(key, hashCode);
+    // No deadline.
+    if (!stored) return std::nullopt;
+    // Decode the 8 bytes.
+    uint64_t deadline;
+    // Copy them out (the record is not aligned).
+    std::memcpy(&deadline, stored->data(), sizeof(deadline));
+    // Return it.
+    return deadline;
+}
+
+// Returns true if the key has a deadline at or before now.
+bool KVStore::isExpired(std::string_view key, uint64_t hashCode, uint64_t currentTime) const {
+    // Its deadline, if any.
+    std::optional<uint64_t> deadline = deadlineOf(key, hashCode);
+    // Expired once the deadline is reached.
+    return deadline && *deadline <= currentTime;
+}
+
+// Gives an existing key a deadline and schedules it on the timing wheel.
+void KVStore::setDeadline(std::string_view key, uint64_t hashCode, uint64_t deadline) {
+    // Keep the state it replaces for any snapshot that can still see it.
+    preserveVersion(key, hashCode);
+    // Encode the deadline as 8 bytes.
+    char bytes[sizeof(deadline)];
+    // Copy it in.
+    std::memcpy(bytes, &deadline, sizeof(deadline));
+    // Store it (replacing any previous one, whose timer goes stale).
+    expires.set(key, std::string_view(bytes, sizeof(bytes)), hashCode);
+    // Schedule its reclamation.
+    expiryWheel.schedule(key, deadline);
+}
+
+// Removes the key if its deadline passed.
+bool KVStore::expireIfDue(std::string_view key, uint64_t hashCode) {
+    // Judged against the clock now.
+    return expireIfDue(key, hashCode, now());
+}
+
+// Removes the key if its deadline is at or before currentTime.
+bool KVStore::expireIfDue(std::string_view key, uint64_t hashCode, uint64_t currentTime) {
+    // Not expired (or no deadline at all).
+    if (!isExpired(key, hashCode, currentTime)) return false;
+    // Remove it everywhere.
+    deleteKey(key, hashCode);
+    // Count it.
+    expiredKeys++;
+    // It is gone.
+    return true;
+}
+
+// Reclaims up to maxKeys keys whose timers are due.
+void KVStore::expiryStep(size_t maxKeys) {
+    // Nothing scheduled.
+    if (expiryWheel.size() == 0) return;
+    // Current time, read once for the whole step.
+    uint64_t currentTime = now();
+    // Fire due timers.
+    expiryWheel.advance(currentTime, maxKeys, [&](const std::string& key, uint64_t deadline) {
+        // Hash of the key.
+        uint64_t hashCode = Utils::hash64(key);
+        // The key's current deadline.
+        std::optional<uint64_t> current = deadlineOf(key, hashCode);
+        // A stale timer (the key was rewritten, re-expired, persisted or deleted since): ignore it.
+        if (!current || *current != deadline || deadline > currentTime) return;
+        // Remove it everywhere.
+        deleteKey(key, hashCode);
+        // Count it.
+        expiredKeys++;
+    });
 }
 
 // Gets the value associated with a key.
 std::string KVStore::get(const std::string& key) {
+    // Borrow the value, then copy it out once for the caller.
+    std::optional<std::string_view> value = getView(key);
+    // Missing keys keep the historical empty-string result.
+    return value ? std::string(*value) : std::string();
+}
+
+// Looks up a key without copying it or its value.
+std::optional<std::string_view> KVStore::getView(std::string_view key) {
+    // Hash the key once for every structure.
+    return getView(key, Utils::hash64(key));
+}
+
+// Looks up a key whose hash the caller already computed.
+std::optional<std::string_view> KVStore::getView(std::string_view key, uint64_t hashCode) {
+    // Timed.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Get);
+    // Look it up against the clock.
+    return lookup(key, hashCode, std::nullopt);
+}
+
+// Looks up a key through the filter, cache and main store.
+std::optional<std::string_view> KVStore::lookup(std::string_view key, uint64_t hashCode, std::optional<uint64_t> batchTime) {
     // First, check the Bloom Filter to quickly rule out non-existent keys.
-    if (!filter.possiblyContains(key)) {
+    if (!filter.possiblyContains(hashCode)) {
+        // Count it.
+        instrumentation.count(MetricCounter::FilterNegatives);
         // If Bloom Filter says key is not present, it's definitively not.
-        return ""; // Key definitely not found
+        return std::nullopt;
     }
+    // A key past its deadline is removed on access.
+    if (expires.size() != 0 && expireIfDue(key, hashCode, batchTime ? *batchTime : now())) return std::nullopt;
 
-    // Try to get the value from the LRU cache.
-    std::string cachedValue = cache.get(key);
-    // If the value was found in the cache.
-    if (!cachedValue.empty() || cache.contains(key)) { // `contains` check for empty string values
-        // Return the cached value. LRU `get` already updated its recency.
+    // Try the LRU cache; a hit already updated its recency.
+    std::optional<std::string_view> cachedValue = cache.find(key, hashCode);
+    // If the value was found in the cache (an empty value is still a hit).
+    if (cachedValue) {
+        // Count it.
+        instrumentation.count(MetricCounter::CacheHits);
+        // Track the access for eviction (this does not move mainStore slots or touch the cache).
+        recordAccess(key, hashCode);
+        // Return the borrowed cached value.
         return cachedValue;
     }
 
-    // If not in cache, get from the main store.
-    std::string storeValue = mainStore.get(key);
-    // If the value was found in the main store.
-    if (!storeValue.empty() || mainStore.contains(key)) { // `contains` check for empty string values
-        // Put the retrieved value into the cache for future accesses.
-        cache.put(key, storeValue);
-        // Return the value from the store.
-        return storeValue;
+    // Count the miss.
+    instrumentation.count(MetricCounter::CacheMisses);
+    // If not in cache, look in the main store.
+    const char* record = mainStore.findRecord(key, hashCode);
+    // The Bloom filter gave a false positive.
+    if (record == nullptr) {
+        // Count it.
+        instrumentation.count(MetricCounter::FilterFalsePositives);
+        // Absent.
+        return std::nullopt;
+    }
+    // Index the record in the cache for future accesses (no copy; this does not move mainStore slots).
+    cache.put(key, SlabArena::value(record), hashCode);
+    // Track the access for eviction.
+    recordAccess(key, hashCode);
+    // Return the borrowed value.
+    return SlabArena::value(record);
+}
+
+// Looks up several keys at once, overlapping their cache misses.
+std::vector<std::optional<std::string_view>> KVStore::multiGet(const std::vector<std::string>& keys) {
+    // Timed as a whole.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::MultiGet);
+    // One result per key.
+    std::vector<std::optional<std::string_view>> results;
+    // Room for all of them.
+    results.reserve(keys.size());
+    // Keys hashed and prefetched ahead of their lookups.
+    size_t batch = std::max<size_t>(settings.multiKeyBatch, 1);
+    // Hashes of the current batch.
+    std::vector<uint64_t> hashes(std::min(batch, keys.size()));
+    // One time for every key (a key repeated in keys must not expire between its lookups and free a returned view).
+    std::optional<uint64_t> batchTime;
+    // Only read when some key has a deadline (nothing here adds one).
+    if (expires.size() != 0) batchTime = now();
+    // Walk the keys a batch at a time.
+    for (size_t begin = 0; begin < keys.size(); begin += batch) {
+        // Keys in this batch.
+        size_t count = std::min(batch, keys.size() - begin);
+        // Hash every key first, so the prefetches below go out back to back.
+        for (size_t i = 0; i < count; ++i) hashes[i] = Utils::hash64(keys[begin + i]);
+        // Start loading the filter block and first table group of each key; none of these loads waits on another.
+        for (size_t i = 0; i < count; ++i) {
+            // The block the filter check reads.
+            filter.prefetch(hashes[i]);
+            // The control bytes and slots the main store probes.
+            mainStore.prefetch(hashes[i]);
+        }
+        // With the groups arriving, start loading the records they point at.
+        for (size_t i = 0; i < count; ++i) mainStore.prefetchRecords(hashes[i]);
+        // Resolve the lookups; by now most of their lines are in cache.
+        for (size_t i = 0; i < count; ++i) results.push_back(lookup(keys[begin + i], hashes[i], batchTime));
+    }
+    // Return the results in key order.
+    return results;
+}
+
+// Sets several key-value pairs, overlapping their cache misses.
+bool KVStore::multiSet(const std::vector<std::pair<std::string, std::string>>& pairs) {
+    // Timed as a whole.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::MultiSet);
+    // Whether every write went through.
+    bool allWritten = true;
+    // Pairs hashed and prefetched ahead of their writes.
+    size_t batch = std::max<size_t>(settings.multiKeyBatch, 1);
+    // Hashes of the current batch.
+    std::vector<uint64_t> hashes(std::min(batch, pairs.size()));
+    // Walk the pairs a batch at a time.
+    for (size_t begin = 0; begin < pairs.size(); begin += batch) {
+        // Pairs in this batch.
+        size_t count = std::min(batch, pairs.size() - begin);
+        // Hash every key first.
+        for (size_t i = 0; i < count; ++i) hashes[i] = Utils::hash64(pairs[begin + i].first);
+        // Start loading what each write touches first: the filter block it sets and the table group it probes.
+        for (size_t i = 0; i < count; ++i) {
+            // The block (or buckets) a new key is added to.
+            filter.prefetch(hashes[i]);
+            // The control bytes and slots the upsert probes.
+            mainStore.prefetch(hashes[i]);
+        }
+        // Apply the writes in order (a later pair for the same key wins, as with separate SETs).
+        for (size_t i = 0; i < count; ++i) {
+            // Note a rejection but keep going.
+            if (!writeValue(pairs[begin + i].first, pairs[begin + i].second, hashes[i])) allWritten = false;
+        }
     }
-    // Key not found in main store either (Bloom filter might have given a false positive).
-    return "";
+    // One sync covers every pair.
+    commitWrite();
+    // Report whether anything was rejected.
+    return allWritten;
+}
+
+// Looks up a key through the Bloom filter and main store only.
+std::optional<std::string_view> KVStore::peek(std::string_view key) const {
+    // Hash the key once for both structures.
+    return peek(key, Utils::hash64(key));
+}
+
+// Looks up a key whose hash the caller already computed through the Bloom filter and main store only.
+std::optional<std::string_view> KVStore::peek(std::string_view key, uint64_t hashCode) const {
+    // Timed as a get.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Get);
+    // Rule out non-existent keys with the Bloom Filter first.
+    if (!filter.possiblyContains(hashCode)) {
+        // Count it.
+        instrumentation.count(MetricCounter::FilterNegatives);
+        // Definitely absent.
+        return std::nullopt;
+    }
+    // A key past its deadline reads as absent (it is reclaimed by the next write or tick).
+    if (isExpired(key, hashCode, expires.size() != 0 ? now() : 0)) return std::nullopt;
+    // Read the main store without migrating any slots.
+    std::optional<std::string_view> value = mainStore.peek(key, hashCode);
+    // The filter gave a false positive.
+    if (!value) instrumentation.count(MetricCounter::FilterFalsePositives);
+    // Return the borrowed value.
+    return value;
 }
 
 // Deletes a key from the store, cache, trie.
 bool KVStore::remove(const std::string& key) {
+    // Hash the key once for every structure.
+    return remove(key, Utils::hash64(key));
+}
+
+// Deletes a key whose hash the caller already computed.
+bool KVStore::remove(std::string_view key, uint64_t hashCode) {
+    // Timed until it is durable.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::Remove);
     // Check Bloom Filter first.
-    if (!filter.possiblyContains(key)) {
+    if (!filter.possiblyContains(hashCode)) {
         // Key definitely not present.
         return false;
     }
+    // A key past its deadline is already gone (it is reclaimed here, but not reported as deleted).
+    if (expires.size() != 0 && expireIfDue(key, hashCode)) return false;
+    // Remove it everywhere.
+    if (!deleteKey(key, hashCode)) return false;
+    // Log it (expired keys are not: replaying their deadline removes them again).
+    logWrite(LogRecord{LogOp::Remove, key, {}, 0});
+    // Make it durable.
+    commitWrite();
+    // Deleted.
+    return true;
+}
 
+// Removes a key from every structure.
+bool KVStore::deleteKey(std::string_view key, uint64_t hashCode) {
+    // An open snapshot may still need the state it removes (an absent key has nothing to keep).
+    if (!openSnapshots.empty() && mainStore.peek(key, hashCode)) preserveVersion(key, hashCode);
     // Attempt to remove from the main store.
-    bool removedFromStore = mainStore.remove(key);
+    bool removedFromStore = mainStore.remove(key, hashCode);
     // If key was successfully removed from the main store.
     if (removedFromStore) {
         // Remove the key from the Trie.
         keyTrie.remove(key);
         // Remove the key from the LRU cache.
-        cache.remove(key);
+        cache.remove(key, hashCode);
+        // Remove the key from the membership filter (cuckoo mode only; Bloom bits stay until a rebuild).
+        filter.remove(hashCode);
+        // A rebuild in progress must leave the key out.
+        if (rebuildFilter) rebuildTouched[hashCode] = false;
+        // Drop its deadline, if any (its timer goes stale).
+        if (expires.size() != 0) expires.remove(key, hashCode);
+        // Pay a bounded share of any filter rebuild.
+        filterMaintenanceStep(FILTER_REBUILD_SLOTS_PER_STEP);
     }
     // Return the status of removal from the main store.
     return removedFromStore;
 }
 
 // Retrieves all keys starting with the given prefix.
-std::vector<std::string> KVStore::prefixSearch(const std::string& prefix) {
+std::vector<std::string> KVStore::prefixSearch(const std::string& prefix) const {
+    // Timed.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::PrefixSearch);
     // Perform prefix search using the Trie.
-    return keyTrie.searchPrefix(prefix);
+    std::vector<std::string> keys = keyTrie.searchPrefix(prefix);
+    // Without deadlines every indexed key is live.
+    if (expires.size() == 0) return keys;
+    // Current time, read once.
+    uint64_t currentTime = now();
+    // Drop keys past their deadline that are not reclaimed yet.
+    keys.erase(std::remove_if(keys.begin(), keys.end(), [&](const std::string& key) {
+        // Expired keys go.
+        return isExpired(key, Utils::hash64(key), currentTime);
+    }), keys.end());
+    // Return the live keys.
+    return keys;
+}
+
+// Returns up to limit keys starting with prefix, resuming from cursor.
+std::optional<PrefixPage> KVStore::prefixSearch(const std::string& prefix, size_t limit, const std::string& cursor) const {
+    // Timed.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::PrefixSearch);
+    // Page through the Trie.
+    std::optional<PrefixPage> page = keyTrie.searchPrefix(prefix, limit, cursor);
+    // Without deadlines (or on a bad cursor) the page stands as is.
+    if (!page || expires.size() == 0) return page;
+    // Current time, read once.
+    uint64_t currentTime = now();
+    // Drop expired keys; the cursor still resumes after the last key scanned, so a page may come back short.
+    page->keys.erase(std::remove_if(page->keys.begin(), page->keys.end(), [&](const std::string& key) {
+        // Expired keys go.
+        return isExpired(key, Utils::hash64(key), currentTime);
+    }), page->keys.end());
+    // Return the page.
+    return page;
+}
+
+// Returns a lazy iterator over the keys starting with prefix.
+Trie::KeyIterator KVStore::scanPrefix(std::string_view prefix) const {
+    // Iterate the Trie directly.
+    return keyTrie.scanPrefix(prefix);
+}
+
+// Returns up to limit key-value pairs with keys in [start, end).
+std::vector<std::pair<std::string, std::string>> KVStore::scanRange(const std::string& start, const std::optional<std::string>& end,
+                                                                    size_t limit, bool reverse) const {
+    // Timed.
+    StoreMetrics::Timer timer(instrumentation, MetricOp::ScanRange);
+    // Pairs found.
+    std::vector<std::pair<std::string, std::string>> result;
+    // Walk the ordered key index over the range.
+    Trie::KeyIterator it = keyTrie.scanRange(start, end ? std::optional<std::string_view>(*end) : std::nullopt, reverse);
+    // Current time, read once (only needed when some key has a deadline).
+    uint64_t currentTime = expires.size() != 0 ? now() : 0;
+    // Collect until the limit or the end of the range.
+    while (result.size() < limit && it.next()) {
+        // Hash of the key.
+        uint64_t hashCode = Utils::hash64(it.key());
+        // Skip keys past their deadline that are not reclaimed yet.
+        if (isExpired(it.key(), hashCode, currentTime)) continue;
+        // Every indexed key is in the main store; read its value without touching the cache.
+        std::optional<std::string_view> value = mainStore.peek(it.key(), hashCode);
+        // Append the pair.
+        if (value) result.emplace_back(std::string(it.key()), std::string(*value));
+    }
+    // Return the pairs.
+    return result;
+}
+
+// Checks if a key might exist using the membership filter.
+bool KVStore::mightContain(std::string_view key) const {
+    // Query the filter.
+    return filter.possiblyContains(Utils::hash64(key));
+}
+
+// Performs up to maxSlots slots of background work.
+bool KVStore::tick(size_t maxSlots) {
+    // Advance (or start) the filter rebuild.
+    filterMaintenanceStep(maxSlots);
+    // Reclaim expired keys.
+    expiryStep(maxSlots);
+    // Pick up a finished background save.
+    collectBackgroundSave(false);
+    // Pick up a finished log rewrite, or start one once due.
+    appendLogMaintenance();
+    // Report whether a rebuild is still running or expired keys are still waiting.
+    return rebuildFilter != nullptr || expiryWheel.dueCount() != 0;
 }
 
-// Checks if a key might exist using the Bloom Filter.
-bool KVStore::mightContain(const std::string& key) {
-    // Query the Bloom Filter.
-    return filter.possiblyContains(key);
-}
\ No newline at end of file
+// Writes every key live at a version and its deadline to a snapshot file.
+bool KVStore::writeSnapshot(const std::string& path, uint64_t version, uint64_t time) const {
+    // Streams the file and renames it into place on commit.
+    SnapshotWriter writer(path);
+    // Deadlines go after every entry.
+    std::vector<std::pair<std::string, uint64_t>> deadlines;
+    // Walk the keys in sorted order, so a load inserts them into the Trie along neighbouring paths; keys whose
+    // deadline passed are left out.
+    visitVersion(version, time, "", std::nullopt, false, [&](std::string_view key, std::string_view value, uint64_t deadline) {
+        // Write the pair.
+        writer.addEntry(key, value);
+        // Remember the deadline.
+        if (deadline != 0) deadlines.emplace_back(std::string(key), deadline);
+        // Keep going.
+        return true;
+    });
+    // Then every deadline.
+    for (const std::pair<std::string, uint64_t>& deadline : deadlines) writer.addDeadline(deadline.first, deadline.second);
+    // Footer, sync and rename.
+    return writer.commit();
+}
+
+// Writes a snapshot to path in the foreground.
+bool KVStore::save(const std::string& path) {
+    // Write the store as it is now.
+    bool ok = writeSnapshot(path, writeVersion, now());
+    // Record the result.
+    snapshotState.lastSaveOk = ok;
+    // And the time of a successful save.
+    if (ok) snapshotState.lastSaveUnixMillis = Utils::unixMillis();
+    // Report it.
+    return ok;
+}
+
+// Writes the store as a snapshot sees it to a file.
+bool KVStore::save(const std::string& path, const KVSnapshot& view) {
+    // Only a live view of this store.
+    if (view.store != this) return false;
+    // Write the versions it sees.
+    bool ok = writeSnapshot(path, view.snapshotVersion, view.snapshotTime);
+    // Record the result.
+    snapshotState.lastSaveOk = ok;
+    // And the time of a successful save.
+    if (ok) snapshotState.lastSaveUnixMillis = Utils::unixMillis();
+    // Report it.
+    return ok;
+}
+
+// Starts writing a snapshot from a forked child.
+bool KVStore::backgroundSave(const std::string& path) {
+    // Pick up a save that already finished.
+    collectBackgroundSave(false);
+    // One at a time.
+    if (backgroundSavePid > 0) return false;
+    // Version and time the child writes, read here: the clock may be a std::function the child should not run.
+    uint64_t saveVersion = writeVersion;
+    // Read once, before the fork.
+    uint64_t saveTime = now();
+    // Only this thread survives in the child. Any lock another thread holds at the fork (the append log's, a peer
+    // core's in thread-per-core mode) stays held there forever, so the child takes none: it reads this store's
+    // memory, which this thread owns, writes a file it creates itself and leaves with _exit. It does allocate, which
+    // relies on the C library keeping malloc usable in a forked child (glibc holds every arena lock across fork).
+    // The log's own threads are parked first so none is mid-write when the process is copied.
+    if (appendLog) appendLog->pauseForFork();
+    // The child gets a copy-on-write view of the store as of this instant.
+    pid_t pid = ::fork();
+    // Child: write the file and leave without running the parent's destructors (or touching the paused log).
+    if (pid == 0) ::_exit(writeSnapshot(path, saveVersion, saveTime) ? 0 : 1);
+    // Parent: let the log run again.
+    if (appendLog) appendLog->resumeAfterFork();
+    // Could not fork.
+    if (pid < 0) {
+        // Count it as a failed save.
+        snapshotState.lastSaveOk = false;
+        // Nothing started.
+        return false;
+    }
+    // Parent: remember the child.
+    backgroundSavePid = pid;
+    // Running.
+    snapshotState.backgroundSaveInProgress = true;
+    // Started.
+    return true;
+}
+
+// Collects the result of a finished background save.
+void KVStore::collectBackgroundSave(bool wait) {
+    // None running.
+    if (backgroundSavePid <= 0) return;
+    // Exit status of the child.
+    int status = 0;
+    // Check on it (or wait for it).
+    pid_t done = ::waitpid(backgroundSavePid, &status, wait ? 0 : WNOHANG);
+    // Still writing.
+    if (done == 0) return;
+    // The child exits 0 once its file is in place.
+    snapshotState.lastSaveOk = done == backgroundSavePid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    // And the time of a successful save.
+    if (snapshotState.lastSaveOk) snapshotState.lastSaveUnixMillis = Utils::unixMillis();
+    // No longer running.
+    snapshotState.backgroundSaveInProgress = false;
+    // Forget the child.
+    backgroundSavePid = -1;
+}
+
+// Blocks until a running background save finishes.
+bool KVStore::waitForBackgroundSave() {
+    // Nothing running: report the last result.
+    if (backgroundSavePid <= 0) return snapshotState.lastSaveOk;
+    // Wait for the child.
+    collectBackgroundSave(true);
+    // Its result.
+    return snapshotState.lastSaveOk;
+}
+
+// Loads a snapshot into an empty store.
+bool KVStore::load(const std::string& path) {
+    // Only an empty store is filled from a snapshot (and its inserts are not versioned, so none may be open).
+    if (mainStore.size() != 0 || !openSnapshots.empty()) return false;
+    // Map and validate the file before touching anything.
+    SnapshotReader reader;
+    // Missing or corrupt.
+    if (!reader.open(path)) return false;
+    // Number of keys.
+    size_t count = reader.entryCount();
+    // Size the table once, so loading never resizes.
+    mainStore.reserve(count);
+    // The configured filter, or one sized for the snapshot if that holds more keys (as a rebuild would size it).
+    bool fitsConfigured = count <= settings.bloomExpectedKeys;
+    // Start from an empty filter of that size.
+    filter = MembershipFilter(settings.filterMode, std::max(settings.bloomExpectedKeys, count), settings.bloomTargetFpr,
+                              rebuildThreshold(settings), fitsConfigured ? settings.bloomFilterSize : 0,
+                              fitsConfigured ? settings.bloomFilterNumHashes : 0);
+    // A rebuild of the old filter is moot.
+    rebuildFilter.reset();
+    // Along with its pending changes.
+    rebuildTouched.clear();
+    // Deadlines at or before now are dropped.
+    uint64_t currentTime = now();
+    // Entries whose table group and filter block are being prefetched, in a ring.
+    PendingEntry pending[LOAD_PREFETCH_DISTANCE];
+    // Entries read so far.
+    size_t read = 0;
+    // Inserts one entry into every structure.
+    auto insert = [&](const PendingEntry& entry) {
+        // No lookup: snapshot keys are unique.
+        mainStore.insertNew(entry.key, entry.value, entry.hashCode);
+        // Keys arrive sorted, so consecutive inserts share their path.
+        keyTrie.insert(entry.key);
+        // Filter bits.
+        filter.add(entry.hashCode);
+    };
+    // Fill every structure straight from the mapping, inserting each entry LOAD_PREFETCH_DISTANCE entries after
+    // its prefetch, so the random table and filter accesses of consecutive entries overlap.
+    reader.forEachEntry([&](std::string_view key, std::string_view value) {
+        // Hash once for every structure.
+        uint64_t hashCode = Utils::hash64(key);
+        // The table group and stamps it will be written to.
+        mainStore.prefetch(hashCode);
+        // The filter block it will set.
+        filter.prefetch(hashCode);
+        // Ring position; the entry there was prefetched LOAD_PREFETCH_DISTANCE entries ago.
+        PendingEntry& slot = pending[read % LOAD_PREFETCH_DISTANCE];
+        // Insert it before reusing its position.
+        if (read >= LOAD_PREFETCH_DISTANCE) insert(slot);
+        // Queue this one.
+        slot = PendingEntry{key, value, hashCode};
+        // Count it.
+        read++;
+    });
+    // Insert the entries still queued, oldest first.
+    for (size_t i = read > LOAD_PREFETCH_DISTANCE ? read - LOAD_PREFETCH_DISTANCE : 0; i < read; ++i) {
+        // Next in order.
+        insert(pending[i % LOAD_PREFETCH_DISTANCE]);
+    }
+    // Then the deadlines of the keys that have one.
+    reader.forEachDeadline([&](std::string_view key, uint64_t deadline) {
+        // Hash once.
+        uint64_t hashCode = Utils::hash64(key);
+        // Still live: track its deadline.
+        if (deadline > currentTime) {
+            // Deadline table and timing wheel.
+            setDeadline(key, hashCode, deadline);
+        } else {
+            // Expired while the store was down.
+            deleteKey(key, hashCode);
+            // Count it.
+            expiredKeys++;
+        }
+    });
+    // Record the count.
+    snapshotState.keysLoaded = count;
+    // The loaded keys bypassed the log; a rewrite records them.
+    if (appendLog) rewriteAppendLog();
+    // Loaded.
+    return true;
+}
+
+// Returns the background save state and the last save and load figures.
+SnapshotStats KVStore::snapshotStats() const {
+    // Maintained by save, backgroundSave, tick and load.
+    return snapshotState;
+}
+
+// Appends a record to the append log, if there is one.
+void KVStore::logWrite(const LogRecord& record) {
+    // No log (or still replaying it).
+    if (!appendLog) return;
+    // Buffer it and remember its position for the sync.
+    appendLogSequence = appendLog->append(record);
+}
+
+// Ends a public write: makes its records durable and starts a log rewrite once due.
+void KVStore::commitWrite() {
+    // Nothing logged.
+    if (!appendLog) return;
+    // Wait for the group commit covering this write, unless the caller does it later.
+    if (!settings.appendLogDeferSync) appendLog->sync(appendLogSequence);
+    // Keep the log's size in check.
+    appendLogMaintenance();
+}
+
+// Collects a finished log rewrite, or starts one once the log outgrew the live data.
+void KVStore::appendLogMaintenance() {
+    // No log.
+    if (!appendLog) return;
+    // A rewrite is running: switch over once its child finished.
+    if (logRewritePid > 0) {
+        // Non-blocking check.
+        collectLogRewrite(false);
+        // One at a time.
+        return;
+    }
+    // Automatic rewrites are off.
+    if (settings.appendLogRewriteFactor <= 0) return;
+    // Current log size.
+    size_t logBytes = appendLog->sizeBytes();
+    // Small logs, and logs that have not grown since a failed rewrite, are left alone.
+    if (logBytes < std::max(settings.appendLogRewriteMinBytes, logRewriteFloor)) return;
+    // Compact once the log holds this many times the live payload.
+    if (static_cast<double>(logBytes) > settings.appendLogRewriteFactor * static_cast<double>(arena.stats().payloadBytes)) {
+        // Start it in the background.
+        rewriteAppendLog();
+    }
+}
+
+// Applies one record while replaying the append log.
+void KVStore::applyLogRecord(const LogRecord& record, std::unordered_set<std::string>& lapsed) {
+    // Hash once for every structure.
+    uint64_t hashCode = Utils::hash64(record.key);
+    // Any later record about a key supersedes a lapsed deadline (an ExpireAt below may add it back).
+    if (!lapsed.empty()) lapsed.erase(std::string(record.key));
+    // Redo the write.
+    switch (record.op) {
+        // Insert or overwrite, clearing any deadline.
+        case LogOp::Set: writeValue(record.key, record.value, hashCode); break;
+        // Delete (the key may already be gone if it expired meanwhile).
+        case LogOp::Remove: deleteKey(record.key, hashCode); break;
+        // Deadline of a key that exists.
+        case LogOp::ExpireAt:
+            // Skip keys that are gone.
+            if (!mainStore.contains(record.key, hashCode)) break;
+            // Still live: track it.
+            if (record.deadline > now()) {
+                // Deadline table and timing wheel.
+                setDeadline(record.key, hashCode, record.deadline);
+            } else {
+                // Expired while the store was down; dropped after the replay unless a later record cancels it.
+                lapsed.insert(std::string(record.key));
+                // Any earlier, later deadline no longer applies.
+                if (expires.size() != 0) expires.remove(record.key, hashCode);
+            }
+            // Done.
+            break;
+        // Drop a deadline.
+        case LogOp::Persist: if (expires.size() != 0) expires.remove(record.key, hashCode); break;
+    }
+}
+
+// Writes one Set (and ExpireAt) record per live key to a fresh log file.
+bool KVStore::writeCompactedLog(const std::string& path, uint64_t currentTime) const {
+    // Buffered writer for the new file.
+    LogFileWriter writer(path);
+    // Every key, through the Trie (which, unlike a table scan, also covers a resize in progress).
+    for (Trie::KeyIterator it = keyTrie.scanPrefix(""); it.next();) {
+        // Current key.
+        std::string_view key = it.key();
+        // Its hash.
+        uint64_t hashCode = Utils::hash64(key);
+        // Its deadline, if any.
+        std::optional<uint64_t> deadline = deadlineOf(key, hashCode);
+        // Expired keys are not written.
+        if (deadline && *deadline <= currentTime) continue;
+        // Its value.
+        std::optional<std::string_view> value = mainStore.peek(key, hashCode);
+        // Every Trie key is in the main store.
+        if (!value) continue;
+        // The value.
+        writer.add(LogRecord{LogOp::Set, key, *value, 0});
+        // Its deadline.
+        if (deadline) writer.add(LogRecord{LogOp::ExpireAt, key, {}, *deadline});
+    }
+    // Write the rest and sync.
+    return writer.commit();
+}
+
+// Returns the file a rewrite child writes.
+std::string KVStore::logRewritePath() const {
+    // Next to the log, so the rename stays within one file system (one rewrite per log at a time).
+    return settings.appendLogPath + ".rewrite." + std::to_string(::getpid());
+}
+
+// Starts rebuilding the append log from a forked child.
+bool KVStore::rewriteAppendLog() {
+    // Pick up a rewrite that already finished.
+    collectLogRewrite(false);
+    // No log, or one rewrite at a time; from here on every record is also kept for the new log.
+    if (!appendLog || logRewritePid > 0 || !appendLog->beginRewrite()) return false;
+    // File the child writes, named before the fork so the child builds no strings of its own.
+    std::string tempPath = logRewritePath();
+    // Time expired keys are judged against, read here for the same reason backgroundSave reads saveTime.
+    uint64_t rewriteTime = now();
+    // As with backgroundSave, the child must not take a lock another thread may have held at the fork: the log's
+    // flusher and any group-commit leader are parked (and the log locked) across it, and the child only reads this
+    // store's memory and writes its own file, relying on glibc to keep malloc usable in the child.
+    appendLog->pauseForFork();
+    // The child gets a copy-on-write view of the store as of this instant, which covers every record appended so far.
+    pid_t pid = ::fork();
+    // Child: write the compacted log and leave without running the parent's destructors (or touching the log).
+    if (pid == 0) ::_exit(writeCompactedLog(tempPath, rewriteTime) ? 0 : 1);
+    // Parent: let the log run again.
+    appendLog->resumeAfterFork();
+    // Could not fork.
+    if (pid < 0) {
+        // Stop keeping records.
+        appendLog->abortRewrite();
+        // Nothing started.
+        return false;
+    }
+    // Parent: remember the child.
+    logRewritePid = pid;
+    // Started.
+    return true;
+}
+
+// Collects the result of a finished log rewrite and switches the log over.
+void KVStore::collectLogRewrite(bool wait) {
+    // None running.
+    if (logRewritePid <= 0) return;
+    // Exit status of the child.
+    int status = 0;
+    // Check on it (or wait for it).
+    pid_t done = ::waitpid(logRewritePid, &status, wait ? 0 : WNOHANG);
+    // Still writing.
+    if (done == 0) return;
+    // File the child wrote.
+    std::string tempPath = logRewritePath();
+    // Forget the child.
+    logRewritePid = -1;
+    // Append what was written meanwhile and rename the new log into place.
+    if (done > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0 && appendLog->finishRewrite(tempPath)) {
+        // Automatic rewrites go back to the normal threshold.
+        logRewriteFloor = 0;
+        // Switched over.
+        return;
+    }
+    // Keep the old log.
+    appendLog->abortRewrite();
+    // Drop whatever the child left.
+    ::unlink(tempPath.c_str());
+    // Do not retry on every write: wait for the log to double first.
+    logRewriteFloor = 2 * appendLog->sizeBytes();
+}
+
+// Blocks until a running log rewrite finishes.
+bool KVStore::waitForAppendLogRewrite() {
+    // Nothing running.
+    if (logRewritePid <= 0) return true;
+    // Rewrites completed so far.
+    uint64_t before = appendLog->stats().rewrites;
+    // Wait for the child and switch over.
+    collectLogRewrite(true);
+    // Whether the log was replaced.
+    return appendLog->stats().rewrites > before;
+}
+
+// Returns the sequence number of the store's last logged write.
+uint64_t KVStore::lastAppendLogSequence() const {
+    // Updated by every logged write.
+    return appendLogSequence;
+}
+
+// Returns once every logged write up to sequence is on disk.
+void KVStore::syncAppendLog(uint64_t sequence) {
+    // The log is thread-safe; nothing else is touched.
+    if (appendLog) appendLog->sync(sequence);
+}
+
+// Returns the append log's figures.
+AppendLogStats KVStore::appendLogStats() const {
+    // The log's figures (empty without a log).
+    AppendLogStats stats = appendLog ? appendLog->stats() : AppendLogStats();
+    // Damage found on replay, also when it left the store without a log.
+    stats.damagedBytes = damagedLogBytes;
+    // Report.
+    return stats;
+}
+
+// Returns the membership filter's figures.
+FilterStats KVStore::filterStats() const {
+    // Report being filled.
+    FilterStats stats;
+    // Structure in use.
+    stats.mode = filter.mode();
+    // Its size.
+    stats.sizeBytes = filter.sizeBytes();
+    // Its estimated false-positive rate.
+    stats.estimatedFalsePositiveRate = filter.estimatedFalsePositiveRate();
+    // Completed rebuilds.
+    stats.rebuilds = filterRebuilds;
+    // Whether one is running.
+    stats.rebuilding = rebuildFilter != nullptr;
+    // Return the report.
+    return stats;
+}
+
+// Returns the number of keys in the store.
+size_t KVStore::size() const {
+    // The main store holds exactly one entry per key.
+    return mainStore.size();
+}
+
+// Returns the record arena's usage and fragmentation figures.
+ArenaStats KVStore::memoryStats() const {
+    // The arena tracks its own accounting.
+    return arena.stats();
+}
+
+// Returns the bytes counted against the memory budget.
+size_t KVStore::memoryUsage() const {
+    // Main store tables and records, trie nodes and cache entries.
+    size_t total = mainStore.memoryUsage() + keyTrie.memoryUsage() + cache.memoryUsage() + filter.sizeBytes();
+    // Deadlines and their timers.
+    total += expires.memoryUsage() + expiryWheel.memoryUsage();
+    // A replacement filter being built counts too.
+    if (rebuildFilter) total += rebuildFilter->sizeBytes();
+    // Return the total.
+    return total;
+}
+
+// Returns the memory budget, usage and eviction counters.
+EvictionStats KVStore::evictionStats() const {
+    // Report being filled.
+    EvictionStats stats;
+    // Policy in use.
+    stats.policy = settings.evictionPolicy;
+    // Current usage.
+    stats.usedBytes = memoryUsage();
+    // Budget.
+    stats.maxBytes = settings.maxMemoryBytes;
+    // Evictions.
+    stats.evictedKeys = evictedKeys;
+    // Rejections.
+    stats.rejectedWrites = rejectedWrites;
+    // Return the report.
+    return stats;
+}
+
+// Returns the number of keys with a deadline, pending timers and expired keys.
+ExpiryStats KVStore::expiryStats() const {
+    // Report being filled.
+    ExpiryStats stats;
+    // Keys with a deadline.
+    stats.keysWithExpiry = expires.size();
+    // Timers on the wheel.
+    stats.pendingTimers = expiryWheel.size();
+    // Keys expired so far.
+    stats.expiredKeys = expiredKeys;
+    // Return the report.
+    return stats;
+}
+
+// Opens a point-in-time view of the store.
+KVSnapshot KVStore::snapshot() {
+    // Writes from here on get later versions, so they stay invisible to it.
+    ++openSnapshots[writeVersion];
+    // Deadlines are judged against the time it was taken.
+    return KVSnapshot(this, writeVersion, now());
+}
+
+// Versions a write and keeps the state it replaces while a snapshot can still see it.
+void KVStore::preserveVersion(std::string_view key, uint64_t hashCode) {
+    // The write's version.
+    uint64_t version = ++writeVersion;
+    // No snapshot: nothing to keep.
+    if (openSnapshots.empty()) return;
+    // Newest open snapshot; every other one is older.
+    uint64_t newest = openSnapshots.rbegin()->first;
+    // The key's chain, if an earlier write kept a state.
+    auto chain = versionChains.find(key);
+    // The current state was written after every open snapshot, so none can see it.
+    if (chain != versionChains.end() && chain->second.lastWrite > newest) {
+        // Just move the mark.
+        chain->second.lastWrite = version;
+        // Nothing to keep.
+        return;
+    }
+    // The state being replaced (no kept state is newer than the current one, so this reads the store).
+    VersionedState current = stateAt(key, hashCode, writeVersion);
+    // Start a chain for the key.
+    if (chain == versionChains.end()) {
+        // Keyed by a copy of the key.
+        chain = versionChains.emplace(std::string(key), VersionChain()).first;
+        // Count the key.
+        versionBytes += key.size();
+    }
+    // Keep it, copied before the write changes the store.
+    chain->second.versions.push_back(KeyVersion{version, current.present, std::string(current.value), current.deadline});
+    // Mark the write.
+    chain->second.lastWrite = version;
+    // Count the state.
+    ++keptVersions;
+    // And its bytes.
+    versionBytes += current.value.size();
+}
+
+// Returns a key's state at a version.
+KVStore::VersionedState KVStore::stateAt(std::string_view key, uint64_t hashCode, uint64_t version) const {
+    // Report being filled.
+    VersionedState state;
+    // Kept states, if the key was written while a snapshot was open.
+    if (!versionChains.empty()) {
+        // The key's chain.
+        auto chain = versionChains.find(key);
+        // The first state replaced after version is the one version saw.
+        if (chain != versionChains.end()) {
+            // Oldest first.
+            for (const KeyVersion& kept : chain->second.versions) {
+                // Replaced later than version.
+                if (kept.overwrittenAt > version) {
+                    // Presence.
+                    state.present = kept.present;
+                    // Value.
+                    state.value = kept.value;
+                    // Deadline.
+                    state.deadline = kept.deadline;
+                    // Found.
+                    return state;
+                }
+            }
+        }
+    }
+    // Not replaced since: the store holds it.
+    std::optional<std::string_view> value = mainStore.peek(key, hashCode);
+    // Absent.
+    if (!value) return state;
+    // Present.
+    state.present = true;
+    // Value.
+    state.value = *value;
+    // Deadline, if any.
+    state.deadline = deadlineOf(key, hashCode).value_or(0);
+    // Report it.
+    return state;
+}
+
+// Visits the keys in a range live at a version.
+void KVStore::visitVersion(uint64_t version, uint64_t time, std::string_view start, std::optional<std::string_view> end, bool reverse,
+                           const std::function<bool(std::string_view key, std::string_view value, uint64_t deadline)>& visit) const {
+    // Keys in the store now.
+    Trie::KeyIterator it = keyTrie.scanRange(start, end, reverse);
+    // Whether it is positioned on a key.
+    bool haveTrie = it.next();
+    // Kept chains in the range: the first one.
+    auto low = versionChains.lower_bound(start);
+    // And the one past the last.
+    auto high = end ? versionChains.lower_bound(*end) : versionChains.end();
+    // Whether any is left to visit.
+    bool haveChain = low != high;
+    // Next chain in visiting order.
+    auto chain = reverse && haveChain ? std::prev(high) : low;
+    // Merge the two ordered streams: a key deleted since the snapshot only has a chain, one created since only a
+    // Trie entry (and its chain says it was absent), and one updated since has both.
+    while (haveTrie || haveChain) {
+        // Whether the next key comes from the Trie, the chains, or both.
+        bool fromTrie = haveTrie;
+        // Likewise.
+        bool fromChain = haveChain;
+        // Both have one: take the one first in visiting order.
+        if (haveTrie && haveChain) {
+            // Their order.
+            int order = it.key().compare(chain->first);
+            // Flipped for a descending walk.
+            if (reverse) order = -order;
+            // Trie first (or the same key).
+            fromTrie = order <= 0;
+            // Chain first (or the same key).
+            fromChain = order >= 0;
+        }
+        // The key.
+        std::string_view key = fromTrie ? it.key() : std::string_view(chain->first);
+        // Its state at the version.
+        VersionedState state = stateAt(key, Utils::hash64(key), version);
+        // Live keys go to the visitor, which may end the walk.
+        if (state.present && (state.deadline == 0 || state.deadline > time) && !visit(key, state.value, state.deadline)) return;
+        // Step past it in the Trie.
+        if (fromTrie) haveTrie = it.next();
+        // And in the chains.
+        if (fromChain) {
+            // Descending: step back unless this was the first one.
+            if (reverse) {
+                // Done with the chains.
+                if (chain == low) haveChain = false;
+                // Previous one.
+                else --chain;
+            } else {
+                // Next one.
+                ++chain;
+                // Done at the end of the range.
+                haveChain = chain != high;
+            }
+        }
+    }
+}
+
+// Closes a snapshot and drops the states no open snapshot can read.
+void KVStore::releaseSnapshot(uint64_t version) {
+    // Its entry.
+    auto open = openSnapshots.find(version);
+    // Not open (already released).
+    if (open == openSnapshots.end()) return;
+    // Others may share the version.
+    if (--open->second == 0) openSnapshots.erase(open);
+    // The last one: drop every kept state.
+    if (openSnapshots.empty()) {
+        // Count them.
+        collectedVersions += keptVersions;
+        // Drop them.
+        versionChains.clear();
+        // None left.
+        keptVersions = 0;
+        // Nor bytes.
+        versionBytes = 0;
+        // Done.
+        return;
+    }
+    // Otherwise check each chain.
+    for (auto chain = versionChains.begin(); chain != versionChains.end();) {
+        // Its states, oldest first.
+        std::vector<KeyVersion>& versions = chain->second.versions;
+        // States kept so far (compacted to the front).
+        size_t kept = 0;
+        // A state is seen by the snapshots from the previous state's replacement up to its own.
+        uint64_t from = 0;
+        // Check each.
+        for (size_t i = 0; i < versions.size(); ++i) {
+            // Oldest open snapshot not before the interval.
+            auto reader = openSnapshots.lower_bound(from);
+            // Seen by one inside the interval.
+            bool needed = reader != openSnapshots.end() && reader->first < versions[i].overwrittenAt;
+            // Next interval starts here.
+            from = versions[i].overwrittenAt;
+            // Keep it.
+            if (needed) {
+                // Compact.
+                if (kept != i) versions[kept] = std::move(versions[i]);
+                // Count it.
+                ++kept;
+                // Next.
+                continue;
+            }
+            // Its bytes go.
+            versionBytes -= versions[i].value.size();
+            // One state fewer.
+            --keptVersions;
+            // Count it.
+            ++collectedVersions;
+        }
+        // Drop the tail.
+        versions.erase(versions.begin() + static_cast<std::ptrdiff_t>(kept), versions.end());
+        // Still needed.
+        if (kept != 0) {
+            // Next chain.
+            ++chain;
+            // Keep it.
+            continue;
+        }
+        // Its key goes.
+        versionBytes -= chain->first.size();
+        // Drop the chain (a later write starts a new one if a snapshot can see the key).
+        chain = versionChains.erase(chain);
+    }
+}
+
+// Returns the open snapshots and the states kept for them.
+VersionStats KVStore::versionStats() const {
+    // Report being filled.
+    VersionStats stats;
+    // Count the snapshots.
+    for (const std::pair<const uint64_t, size_t>& open : openSnapshots) stats.openSnapshots += open.second;
+    // Keys with kept states.
+    stats.versionedKeys = versionChains.size();
+    // Kept states.
+    stats.keptVersions = keptVersions;
+    // Their bytes.
+    stats.versionBytes = versionBytes;
+    // Dropped so far.
+    stats.collectedVersions = collectedVersions;
+    // Return the report.
+    return stats;
+}
+
+// Returns latencies, counters and structure figures.
+MetricsSnapshot KVStore::metrics() const {
+    // Report being filled.
+    MetricsSnapshot snapshot;
+    // Latencies and counters of every thread (left disabled without KV_STORE_METRICS).
+    instrumentation.collect(snapshot);
+    // Probe lengths, from a bounded sample.
+    ProbeStats probes = mainStore.probeStats(METRICS_PROBE_SAMPLE);
+    // Entries measured.
+    snapshot.probeSamples = probes.sampledEntries;
+    // Mean.
+    snapshot.meanProbeLength = probes.meanProbeLength;
+    // Longest.
+    snapshot.maxProbeLength = probes.maxProbeLength;
+    // Trie size.
+    snapshot.trieNodes = keyTrie.nodeCount();
+    // Keys.
+    snapshot.keys = mainStore.size();
+    // Return the report.
+    return snapshot;
+}
+
+// Constructor: used by KVStore::snapshot.
+KVSnapshot::KVSnapshot(KVStore* store, uint64_t version, uint64_t time) : store(store), snapshotVersion(version), snapshotTime(time) {
+}
+
+// Constructor: an empty handle.
+KVSnapshot::KVSnapshot() : store(nullptr), snapshotVersion(0), snapshotTime(0) {
+}
+
+// Destructor: releases the snapshot.
+KVSnapshot::~KVSnapshot() {
+    // Let the store drop what only this view needed.
+    release();
+}
+
+// Moves the view over.
+KVSnapshot::KVSnapshot(KVSnapshot&& other) noexcept
+    : store(other.store), snapshotVersion(other.snapshotVersion), snapshotTime(other.snapshotTime) {
+    // The other handle no longer holds it.
+    other.store = nullptr;
+}
+
+// Releases this view and takes other's.
+KVSnapshot& KVSnapshot::operator=(KVSnapshot&& other) noexcept {
+    // Moving onto itself changes nothing.
+    if (this == &other) return *this;
+    // Let go of the current view.
+    release();
+    // Take the other.
+    store = other.store;
+    // Its version.
+    snapshotVersion = other.snapshotVersion;
+    // Its time.
+    snapshotTime = other.snapshotTime;
+    // The other handle no longer holds it.
+    other.store = nullptr;
+    // Chain.
+    return *this;
+}
+
+// Lets the store drop the versions only this snapshot needed.
+void KVSnapshot::release() {
+    // Already released.
+    if (store == nullptr) return;
+    // Close it.
+    store->releaseSnapshot(snapshotVersion);
+    // Empty now.
+    store = nullptr;
+}
+
+// Returns true until the handle is released.
+bool KVSnapshot::valid() const {
+    // Emptied by release.
+    return store != nullptr;
+}
+
+// Returns the store version the snapshot reads at.
+uint64_t KVSnapshot::version() const {
+    // Taken at creation.
+    return snapshotVersion;
+}
+
+// Returns a copy of a key's value as of the snapshot.
+std::optional<std::string> KVSnapshot::get(std::string_view key) const {
+    // Released.
+    if (store == nullptr) return std::nullopt;
+    // Its state then.
+    KVStore::VersionedState state = store->stateAt(key, Utils::hash64(key), snapshotVersion);
+    // Absent, or expired as of the snapshot.
+    if (!state.present || (state.deadline != 0 && state.deadline <= snapshotTime)) return std::nullopt;
+    // Copy it out.
+    return std::string(state.value);
+}
+
+// Retrieves all keys starting with the given prefix as of the snapshot.
+std::vector<std::string> KVSnapshot::prefixSearch(const std::string& prefix) const {
+    // Keys found.
+    std::vector<std::string> keys;
+    // Released.
+    if (store == nullptr) return keys;
+    // End of the prefix's range.
+    std::optional<std::string> end = prefixEnd(prefix);
+    // Walk it.
+    store->visitVersion(snapshotVersion, snapshotTime, prefix, end ? std::optional<std::string_view>(*end) : std::nullopt, false,
+                        [&keys](std::string_view key, std::string_view, uint64_t) {
+        // Collect it.
+        keys.emplace_back(key);
+        // Keep going.
+        return true;
+    });
+    // Return the keys.
+    return keys;
+}
+
+// Returns up to limit key-value pairs with keys in [start, end) as of the snapshot.
+std::vector<std::pair<std::string, std::string>> KVSnapshot::scanRange(const std::string& start, const std::optional<std::string>& end,
+                                                                       size_t limit, bool reverse) const {
+    // Pairs found.
+    std::vector<std::pair<std::string, std::string>> result;
+    // Released, or nothing wanted.
+    if (store == nullptr || limit == 0) return result;
+    // Walk the range.
+    store->visitVersion(snapshotVersion, snapshotTime, start, end ? std::optional<std::string_view>(*end) : std::nullopt, reverse,
+                        [&result, limit](std::string_view key, std::string_view value, uint64_t) {
+        // Append the pair.
+        result.emplace_back(std::string(key), std::string(value));
+        // Until the limit.
+        return result.size() < limit;
+    });
+    // Return the pairs.
+    return result;
+}
+
+// Returns a page of entries with keys starting with prefix, after a key.
+std::vector<SnapshotEntry> KVSnapshot::entries(const std::string& prefix, const std::optional<std::string>& after, size_t limit) const {
+    // Entries found.
+    std::vector<SnapshotEntry> result;
+    // Released, or nothing wanted.
+    if (store == nullptr || limit == 0) return result;
+    // First key past after (a key followed by a zero byte is the next one in order), but not before the prefix.
+    std::string start = after && *after >= prefix ? *after + std::string(1, '\0') : prefix;
+    // End of the prefix's range.
+    std::optional<std::string> end = prefixEnd(prefix);
+    // Walk it.
+    store->visitVersion(snapshotVersion, snapshotTime, start, end ? std::optional<std::string_view>(*end) : std::nullopt, false,
+                        [&result, limit](std::string_view key, std::string_view value, uint64_t deadline) {
+        // Append the entry.
+        result.push_back(SnapshotEntry{std::string(key), std::string(value), deadline});
+        // Until the limit.
+        return result.size() < limit;
+    });
+    // Return the page.
+    return result;
+}
@@ -1,87 +1,380 @@
 #include "../include/lru_cache.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <algorithm> // For std::max
 
-// Constructor: initializes the LRU cache with a given capacity.
-LRUCache::LRUCache(size_t cap) : capacity(cap) {
-    // Ensure capacity is at least 1 if a cache is being made.
-    if (capacity == 0) {
-    
+namespace {
+    // W-TinyLFU: share of the capacity given to the admission window, in percent.
+    constexpr size_t WINDOW_PERCENT = 1;
+    // W-TinyLFU: share of the main segments given to the protected segment, in percent.
+    constexpr size_t PROTECTED_PERCENT = 80;
+    // S3-FIFO: share of the capacity given to the small queue, in percent.
+    constexpr size_t SMALL_PERCENT = 10;
+
+    // Returns the first segment size for a policy.
+    size_t windowSize(size_t capacity, CachePolicy policy) {
+        // Only W-TinyLFU has a window; it always holds at least one entry.
+        return policy == CachePolicy::WTinyLFU ? std::max<size_t>(1, capacity * WINDOW_PERCENT / 100) : 0;
+    }
+
+    // Returns the second segment size for a policy.
+    size_t segmentSize(size_t capacity, CachePolicy policy) {
+        // W-TinyLFU: protected share of what the window leaves.
+        if (policy == CachePolicy::WTinyLFU) return (capacity - windowSize(capacity, policy)) * PROTECTED_PERCENT / 100;
+        // S3-FIFO: the small queue, at least one entry.
+        if (policy == CachePolicy::S3FIFO) return std::max<size_t>(1, capacity * SMALL_PERCENT / 100);
+        // LRU has a single queue.
+        return 0;
+    }
+
+    // Returns the heap bytes a string owns (none while it fits the small-string buffer inside the object).
+    size_t heapBytes(const std::string& text) {
+        // Start of the object itself.
+        const char* object = reinterpret_cast<const char*>(&text);
+        // Characters stored inline need no allocation.
+        if (text.data() >= object && text.data() < object + sizeof(std::string)) return 0;
+        // Capacity plus the terminator.
+        return text.capacity() + 1;
     }
 }
 
+// Constructor: initializes the cache with a given capacity, replacement policy and storage mode.
+LRUCache::LRUCache(size_t cap, CachePolicy cachePolicy, CacheStorage cacheStorage)
+    : capacity(cap),
+      policy(cachePolicy),
+      storage(cacheStorage),
+      windowCapacity(windowSize(cap, cachePolicy)),
+      segmentCapacity(segmentSize(cap, cachePolicy)),
+      // Only W-TinyLFU counts accesses; the others keep a minimal sketch.
+      sketch(cachePolicy == CachePolicy::WTinyLFU ? cap : 0),
+      cachedBytes(0) {}
+
+// Returns the bytes one entry costs.
+size_t LRUCache::entryBytes(const CacheNode& node) {
+    // List node: the entry plus its two links.
+    size_t listNode = sizeof(CacheNode) + 2 * sizeof(void*);
+    // Map node: the key view and iterator plus the next link and cached hash.
+    size_t mapNode = sizeof(HashedKey) + sizeof(NodeList::iterator) + sizeof(void*) + sizeof(size_t);
+    // Both nodes and the owned copy (none in Borrowed mode).
+    return listNode + mapNode + heapBytes(node.owned);
+}
+
+// Points an entry at a key and value, copying the value too in Owned mode.
+void LRUCache::store(CacheNode& node, std::string_view key, std::string_view value, bool newEntry) {
+    // Borrowed: keep a view of the caller's value.
+    if (storage == CacheStorage::Borrowed) {
+        // The key is copied once, when the entry is created, so lookups never read the caller's bytes.
+        if (newEntry) {
+            // Copy it.
+            node.owned.assign(key);
+            // View the copy.
+            node.key = node.owned;
+        }
+        // The value.
+        node.value = value;
+        // Done.
+        return;
+    }
+    // Owned: build the copy aside, since key or value may be views of the current copy.
+    std::string copy;
+    // Room for both.
+    copy.reserve(key.size() + value.size());
+    // Key bytes first.
+    copy.append(key);
+    // Then the value bytes.
+    copy.append(value);
+    // Replace the old copy.
+    node.owned = std::move(copy);
+    // View of the key part.
+    node.key = std::string_view(node.owned.data(), key.size());
+    // View of the value part.
+    node.value = std::string_view(node.owned.data() + key.size(), value.size());
+}
+
 // Returns value if key exists, empty string otherwise.
 std::string LRUCache::get(const std::string& key) {
+    // Borrow the value, then copy it out for the caller.
+    std::optional<std::string_view> value = find(key);
+    // Return empty string indicating key not found.
+    return value ? std::string(*value) : std::string();
+}
+
+// Looks up a key without copying it or its value. Updates its recency.
+std::optional<std::string_view> LRUCache::find(std::string_view key) {
+    // Hash the key and forward.
+    return find(key, Utils::hash64(key));
+}
+
+// Looks up a key whose hash the caller already computed. Updates its recency.
+std::optional<std::string_view> LRUCache::find(std::string_view key, uint64_t hashCode) {
     // If capacity is 0, cache is disabled.
-    if (capacity == 0) return "";
+    if (capacity == 0) return std::nullopt;
 
     // Attempt to find the key in the map.
-    auto it = map.find(key);
+    auto it = map.find(HashedKey{key, hashCode});
     // If key is not found in the map.
     if (it == map.end()) {
-        // Return empty string indicating key not found.
-        return "";
+        // W-TinyLFU counts misses too, so a key's popularity builds up before it is admitted.
+        if (policy == CachePolicy::WTinyLFU) sketch.increment(hashCode);
+        // Key not cached.
+        return std::nullopt;
     }
 
-    // Key found. Move the accessed item to the front of the list (most recently used).
-    dll.splice(dll.begin(), dll, it->second);
-    // Return the value of the cached item.
-    return it->second->value;
+    // Key found. Record the hit.
+    touch(it->second);
+    // Borrow the value of the cached item.
+    return std::string_view(it->second->value);
 }
 
 // Inserts or updates a key-value pair. Updates its recency.
-void LRUCache::put(const std::string& key, const std::string& value) {
+void LRUCache::put(std::string_view key, std::string_view value) {
+    // Hash the key and forward.
+    put(key, value, Utils::hash64(key));
+}
+
+// Inserts or updates a key-value pair whose hash the caller already computed.
+void LRUCache::put(std::string_view key, std::string_view value, uint64_t hashCode) {
     // If capacity is 0, cache is disabled, do nothing.
     if (capacity == 0) return;
 
     // Attempt to find the key in the map.
-    auto it = map.find(key);
+    auto it = map.find(HashedKey{key, hashCode});
     // If key is already in the cache.
     if (it != map.end()) {
-        // Update the value of the existing item.
-        it->second->value = value;
-        // Move the accessed item to the front of the list (most recently used).
-        dll.splice(dll.begin(), dll, it->second);
-    // If key is not in the cache (new item).
+        // The entry.
+        NodeList::iterator node = it->second;
+        // Stop accounting for the old value.
+        cachedBytes -= entryBytes(*node);
+        // Update the value of the existing item (the key bytes may move too).
+        store(*node, key, value, false);
+        // Account for the new one.
+        cachedBytes += entryBytes(*node);
+        // The map entry must view the key bytes the node now holds.
+        if (it->first.key.data() != node->key.data()) {
+            // Take the map node out without freeing it.
+            auto handle = map.extract(it);
+            // Re-point its key.
+            handle.key().key = node->key;
+            // Put it back.
+            map.insert(std::move(handle));
+        }
+        // Record the access.
+        touch(node);
+        // Done.
+        return;
+    }
+    // Queue the new item joins.
+    uint8_t queue = RECENCY;
+    // Make room and pick the queue according to the policy.
+    switch (policy) {
+        // LRU: evict the least recently used item (the one at the back of the list) if the cache is full.
+        case CachePolicy::LRU:
+            // Evict while full.
+            if (size() >= capacity) erase(std::prev(queues[RECENCY].end()));
+            break;
+        // W-TinyLFU: count the access; every new key starts in the window, which is trimmed below.
+        case CachePolicy::WTinyLFU:
+            // Count it.
+            sketch.increment(hashCode);
+            // Join the window.
+            queue = WINDOW;
+            break;
+        // S3-FIFO: evict while full; keys seen recently (in the ghost queue) go straight to the main queue.
+        case CachePolicy::S3FIFO:
+            // Evict while full.
+            while (size() >= capacity) evictS3();
+            // Ghost hit: the key was dropped from the small queue too early.
+            if (ghostSet.count(hashCode)) queue = MAIN;
+            else queue = SMALL;
+            break;
+    }
+    // Add the new item to the front of its queue.
+    queues[queue].push_front({std::string_view(), std::string_view(), std::string(), hashCode, queue, 0});
+    // Give it its key and value.
+    store(queues[queue].front(), key, value, true);
+    // Index the new item by a view of the key it now owns.
+    map.emplace(HashedKey{queues[queue].front().key, hashCode}, queues[queue].begin());
+    // Account for it.
+    cachedBytes += entryBytes(queues[queue].front());
+    // W-TinyLFU: the window's oldest entry now competes for a place in the main segments.
+    if (policy == CachePolicy::WTinyLFU && queues[WINDOW].size() > windowCapacity) admitFromWindow();
+}
+
+// Records a hit on an entry according to the policy.
+void LRUCache::touch(NodeList::iterator node) {
+    // Dispatch on the policy.
+    switch (policy) {
+        // LRU: move the accessed item to the front of the list (most recently used).
+        case CachePolicy::LRU:
+            // Relink it.
+            moveTo(node, RECENCY);
+            break;
+        // W-TinyLFU: count the access and move the entry up its segments.
+        case CachePolicy::WTinyLFU:
+            // Count it.
+            sketch.increment(node->hashCode);
+            // Window and protected entries move to the front of their own segment.
+            if (node->queue != PROBATION) {
+                // Relink it.
+                moveTo(node, node->queue);
+                // Done.
+                break;
+            }
+            // A probation entry hit again is promoted.
+            moveTo(node, PROTECTED);
+            // An overfull protected segment demotes its oldest entry back to probation.
+            if (queues[PROTECTED].size() > segmentCapacity) moveTo(std::prev(queues[PROTECTED].end()), PROBATION);
+            break;
+        // S3-FIFO: only count the hit; the queues are reordered lazily at eviction time.
+        case CachePolicy::S3FIFO:
+            // Saturating counter.
+            if (node->frequency < S3_MAX_FREQUENCY) node->frequency++;
+            break;
+    }
+}
+
+// Removes an entry from its queue and the map.
+void LRUCache::erase(NodeList::iterator node) {
+    // Stop accounting for it.
+    cachedBytes -= entryBytes(*node);
+    // Remove the map entry while its key is still alive.
+    map.erase(HashedKey{node->key, node->hashCode});
+    // Remove the node from its queue.
+    queues[node->queue].erase(node);
+}
+
+// Moves an entry to the front of a queue.
+void LRUCache::moveTo(NodeList::iterator node, uint8_t queue) {
+    // Relink the node (no allocation; the map's iterator stays valid).
+    queues[queue].splice(queues[queue].begin(), queues[node->queue], node);
+    // Record its new queue.
+    node->queue = queue;
+}
+
+// W-TinyLFU: moves the window's oldest entry into the main segments if it beats their eviction victim.
+void LRUCache::admitFromWindow() {
+    // The entry leaving the window.
+    NodeList::iterator candidate = std::prev(queues[WINDOW].end());
+    // Room in the main segments: admit it unconditionally.
+    if (queues[PROBATION].size() + queues[PROTECTED].size() < capacity - windowCapacity) {
+        // New main entries start on probation.
+        moveTo(candidate, PROBATION);
+        // Done.
+        return;
+    }
+    // The main segments' eviction victim: the oldest probation entry, or the oldest protected one.
+    uint8_t victimQueue = queues[PROBATION].empty() ? PROTECTED : PROBATION;
+    // No main segments at all (tiny cache): the candidate is simply evicted.
+    if (queues[victimQueue].empty()) {
+        // Drop it.
+        erase(candidate);
+        // Done.
+        return;
+    }
+    // The victim.
+    NodeList::iterator victim = std::prev(queues[victimQueue].end());
+    // Keep whichever is accessed more often; ties keep the incumbent, which is what makes scans harmless.
+    if (sketch.frequency(candidate->hashCode) > sketch.frequency(victim->hashCode)) {
+        // Evict the victim.
+        erase(victim);
+        // Admit the candidate on probation.
+        moveTo(candidate, PROBATION);
     } else {
-        // If the cache is full.
-        if (dll.size() >= capacity) {
-            // Evict the least recently used item (the one at the back of the list).
-            // Get the key of the LRU item.
-            std::string lruKey = dll.back().key;
-            // Remove the LRU item from the map.
-            map.erase(lruKey);
-            // Remove the LRU item from the list.
-            dll.pop_back();
+        // Reject the candidate.
+        erase(candidate);
+    }
+}
+
+// S3-FIFO: evicts one entry.
+void LRUCache::evictS3() {
+    // Evict from the small queue while it holds more than its share (or the main queue is empty).
+    if (queues[SMALL].size() >= segmentCapacity || queues[MAIN].empty()) {
+        // Walk the small queue from its oldest entry.
+        while (!queues[SMALL].empty()) {
+            // Oldest small entry.
+            NodeList::iterator oldest = std::prev(queues[SMALL].end());
+            // Hit more than once while in the small queue: it earned a place in the main queue.
+            if (oldest->frequency > 1) {
+                // Restart its count there.
+                oldest->frequency = 0;
+                // Move it (the total size is unchanged, so keep looking for a victim).
+                moveTo(oldest, MAIN);
+                // Next.
+                continue;
+            }
+            // Otherwise it is a one-hit wonder: remember it as a ghost and drop it.
+            addGhost(oldest->hashCode);
+            // Drop it.
+            erase(oldest);
+            // One entry evicted.
+            return;
+        }
+    }
+    // Main queue: CLOCK-style, entries hit since their last lap go round again with one hit spent.
+    while (!queues[MAIN].empty()) {
+        // Oldest main entry.
+        NodeList::iterator oldest = std::prev(queues[MAIN].end());
+        // Not hit since its last lap: evict it.
+        if (oldest->frequency == 0) {
+            // Drop it.
+            erase(oldest);
+            // One entry evicted.
+            return;
         }
-        // Add the new item to the front of the list.
-        dll.push_front({key, value});
-        // Store the iterator to the new item in the map.
-        map[key] = dll.begin();
+        // Spend one hit.
+        oldest->frequency--;
+        // Give it another lap.
+        moveTo(oldest, MAIN);
+    }
+}
+
+// S3-FIFO: remembers a dropped key's hash in the ghost queue.
+void LRUCache::addGhost(uint64_t hashCode) {
+    // Already remembered.
+    if (!ghostSet.insert(hashCode).second) return;
+    // Queue it.
+    ghostQueue.push_back(hashCode);
+    // The ghost queue remembers as many keys as the main queue holds.
+    if (ghostQueue.size() > capacity - segmentCapacity) {
+        // Forget the oldest ghost.
+        ghostSet.erase(ghostQueue.front());
+        // Drop it from the queue.
+        ghostQueue.pop_front();
     }
 }
 
 // Checks if a key exists in the cache.
-bool LRUCache::contains(const std::string& key) {
+bool LRUCache::contains(std::string_view key) {
+    // Hash the key and forward.
+    return contains(key, Utils::hash64(key));
+}
+
+// Checks if a key whose hash the caller already computed exists in the cache.
+bool LRUCache::contains(std::string_view key, uint64_t hashCode) {
     // If capacity is 0, cache is disabled.
     if (capacity == 0) return false;
     // Return true if key is found in the map, false otherwise.
-    return map.count(key) > 0;
+    return map.count(HashedKey{key, hashCode}) > 0;
 }
 
 // Removes a key from the cache.
 bool LRUCache::remove(const std::string& key) {
+    // Hash the key and forward.
+    return remove(key, Utils::hash64(key));
+}
+
+// Removes a key whose hash the caller already computed.
+bool LRUCache::remove(std::string_view key, uint64_t hashCode) {
     // If capacity is 0, cache is disabled.
     if (capacity == 0) return false;
     // Attempt to find the key in the map.
-    auto it = map.find(key);
+    auto it = map.find(HashedKey{key, hashCode});
     // If key is not found in the map.
     if (it == map.end()) {
         // Key not present, nothing to remove.
         return false;
     }
-    // Erase the item from the list using the stored iterator.
-    dll.erase(it->second);
-    // Erase the key from the map.
-    map.erase(it);
+    // Erase the entry from the map and its queue.
+    erase(it->second);
     // Return true indicating successful removal.
     return true;
 }
@@ -89,6 +382,26 @@ bool LRUCache::remove(const std::string& key) {
 
 // Returns the current size of the cache.
 size_t LRUCache::size() const {
-    // Return the number of items currently in the doubly linked list.
-    return dll.size();
-}
\ No newline at end of file
+    // Return the number of items currently in all queues.
+    return map.size();
+}
+
+// Returns the replacement policy.
+CachePolicy LRUCache::cachePolicy() const {
+    // As constructed.
+    return policy;
+}
+
+// Returns the bytes held by the cache.
+size_t LRUCache::memoryUsage() const {
+    // Entries.
+    size_t total = cachedBytes;
+    // The map's bucket array.
+    total += map.bucket_count() * sizeof(void*);
+    // The frequency sketch.
+    total += sketch.sizeBytes();
+    // Ghost hashes: one in the queue and one node in the set (hash, next link, bucket share).
+    total += ghostQueue.size() * sizeof(uint64_t) + ghostSet.size() * (sizeof(uint64_t) + 2 * sizeof(void*));
+    // Return the total.
+    return total;
+}
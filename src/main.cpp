@@ -3,6 +3,14 @@
 #include <string>
 #include <vector>
 #include <sstream> // For parsing input line
+#include <cstdlib> // For std::strtoull
+#include <cstdint> // For SIZE_MAX
+#include <algorithm> // For std::remove
+
+// Snapshot file written by SAVE / BGSAVE and loaded on startup (in the working directory).
+constexpr const char* SNAPSHOT_PATH = "dump.kvs";
+// Append-only log used with --appendonly (in the working directory).
+constexpr const char* APPEND_LOG_PATH = "appendonly.aof";
 
 // Helper function to split a string by a delimiter.
 std::vector<std::string> splitString(const std::string& s, char delimiter) {
@@ -21,17 +29,38 @@ std::vector<std::string> splitString(const std::string& s, char delimiter) {
     return tokens;
 }
 
-// Main function for the CLI interface.
-int main() {
-    // Create an instance of the Key-Value Store.
-    KVStore store;
+// Main function for the CLI interface. Usage: kv_store_cli [--appendonly [always|everysec|no]]
+int main(int argc, char** argv) {
+    // Store settings.
+    KVStoreConfig config;
+    // Log every write when asked to.
+    if (argc > 1 && std::string(argv[1]) == "--appendonly") {
+        // Log file.
+        config.appendLogPath = APPEND_LOG_PATH;
+        // Fsync policy (everysec by default).
+        std::string policy = argc > 2 ? argv[2] : "everysec";
+        // Map it.
+        config.appendFsync = policy == "always" ? AppendFsync::Always : policy == "no" ? AppendFsync::No : AppendFsync::EverySec;
+    }
+    // Create an instance of the Key-Value Store (replaying the log, if enabled).
+    KVStore store(config);
     // String to hold user input.
     std::string line;
 
     // Print welcome message for the REPL.
     std::cout << "Custom In-Memory Key-Value Store CLI" << std::endl;
+    // The log is more recent than any snapshot, so it alone is the source of truth when enabled.
+    if (!config.appendLogPath.empty()) {
+        // Report what came back.
+        std::cout << "Replayed " << store.appendLogStats().replayedRecords << " records from " << APPEND_LOG_PATH << " ("
+                  << store.size() << " keys)." << std::endl;
+    // Restore the last snapshot, if there is one.
+    } else if (store.load(SNAPSHOT_PATH)) {
+        // Report what came back.
+        std::cout << "Loaded " << store.size() << " keys from " << SNAPSHOT_PATH << "." << std::endl;
+    }
     // Print usage instructions.
-    std::cout << "Commands: SET <key> <value>, GET <key>, DEL <key>, PREFIX <prefix>, BLOOM <key>, EXIT" << std::endl;
+    std::cout << "Commands: SET <key> <value> [EX <seconds>|PX <ms>], GET <key>, MSET <key> <value> [<key> <value> ...], MGET <key> [<key> ...], EXPIRE <key> <seconds>, TTL <key>, PERSIST <key>, DEL <key>, PREFIX <prefix> [LIMIT <n> [CURSOR <c>]], SCANRANGE <start> <end|+> [REV] [LIMIT <n>], BLOOM <key>, INFO [stats|latency], SAVE, BGSAVE, BGREWRITEAOF, EXIT" << std::endl;
 
     // REPL (Read-Eval-Print Loop).
     while (true) {
@@ -43,6 +72,8 @@ int main() {
             break;
         }
 
+        // Give background work (filter rebuild, reclaiming expired keys) a slice between commands.
+        store.tick();
         // Split the input line into command and arguments.
         std::vector<std::string> args = splitString(line, ' ');
         // If no arguments entered, continue to next iteration.
@@ -56,22 +87,83 @@ int main() {
 
         // Process SET command.
         if (command == "SET" && args.size() == 3) {
-            // Set key-value pair in the store.
-            store.set(args[1], args[2]);
-            // Print confirmation message.
-            std::cout << "OK" << std::endl;
+            // Set key-value pair in the store; a full store under its memory budget rejects it.
+            if (store.set(args[1], args[2])) {
+                // Print confirmation message.
+                std::cout << "OK" << std::endl;
+            } else {
+                // Report the rejection.
+                std::cout << "ERR: OOM, command not allowed when used memory > maxmemory" << std::endl;
+            }
+        // Process SET with a time to live: SET <key> <value> EX <seconds> | PX <milliseconds>.
+        } else if (command == "SET" && args.size() == 5 && (args[3] == "EX" || args[3] == "PX")) {
+            // Time to live as given.
+            uint64_t amount = std::strtoull(args[4].c_str(), nullptr, 10);
+            // Reject a zero or malformed time.
+            if (amount == 0) {
+                // Print error message.
+                std::cout << "ERR: invalid expire time in 'SET' command" << std::endl;
+            // Seconds or milliseconds.
+            } else if (store.setWithTtl(args[1], args[2], args[3] == "EX" ? amount * 1000 : amount)) {
+                // Print confirmation message.
+                std::cout << "OK" << std::endl;
+            } else {
+                // Report the rejection.
+                std::cout << "ERR: OOM, command not allowed when used memory > maxmemory" << std::endl;
+            }
+        // Process EXPIRE command.
+        } else if (command == "EXPIRE" && args.size() == 3) {
+            // Time to live in seconds.
+            uint64_t seconds = std::strtoull(args[2].c_str(), nullptr, 10);
+            // 1 if the key exists and now has a deadline, 0 otherwise.
+            std::cout << "(integer) " << (store.expire(args[1], seconds * 1000) ? 1 : 0) << std::endl;
+        // Process TTL command.
+        } else if (command == "TTL" && args.size() == 2) {
+            // Milliseconds left, or a negative status.
+            int64_t millis = store.ttl(args[1]);
+            // Seconds left, rounded to the nearest (negative statuses pass through unchanged).
+            std::cout << "(integer) " << (millis < 0 ? millis : (millis + 500) / 1000) << std::endl;
+        // Process PERSIST command.
+        } else if (command == "PERSIST" && args.size() == 2) {
+            // 1 if a deadline was removed, 0 otherwise.
+            std::cout << "(integer) " << (store.persist(args[1]) ? 1 : 0) << std::endl;
         // Process GET command.
         } else if (command == "GET" && args.size() == 2) {
-            // Get value for the key from the store.
-            std::string value = store.get(args[1]);
-            // If value is not empty (key found).
-            if (!value.empty() || store.mightContain(args[1])) { // Check mightContain for keys that map to empty strings
+            // Borrow the value for the key from the store.
+            std::optional<std::string_view> value = store.getView(args[1]);
+            // If the key was found (possibly with an empty value).
+            if (value) {
                 // Print the retrieved value.
-                std::cout << "\"" << value << "\"" << std::endl;
+                std::cout << "\"" << *value << "\"" << std::endl;
             } else {
                 // Print message if key not found.
                 std::cout << "(nil)" << std::endl; // Or (key not found)
             }
+        // Process MSET command: MSET <key> <value> [<key> <value> ...].
+        } else if (command == "MSET" && args.size() >= 3 && args.size() % 2 == 1) {
+            // Pairs in command order.
+            std::vector<std::pair<std::string, std::string>> pairs;
+            // Collect each key and its value.
+            for (size_t i = 1; i < args.size(); i += 2) pairs.emplace_back(args[i], args[i + 1]);
+            // Write them as one batch; a full store under its memory budget may reject some.
+            if (store.multiSet(pairs)) {
+                // Print confirmation message.
+                std::cout << "OK" << std::endl;
+            } else {
+                // Report the rejection.
+                std::cout << "ERR: OOM, command not allowed when used memory > maxmemory" << std::endl;
+            }
+        // Process MGET command: MGET <key> [<key> ...].
+        } else if (command == "MGET" && args.size() >= 2) {
+            // The requested keys.
+            std::vector<std::string> keys(args.begin() + 1, args.end());
+            // Look them all up as one batch.
+            std::vector<std::optional<std::string_view>> values = store.multiGet(keys);
+            // Print one numbered line per key, in request order.
+            for (size_t i = 0; i < values.size(); ++i) {
+                // The value, or (nil) for a missing key.
+                std::cout << i + 1 << ") " << (values[i] ? "\"" + std::string(*values[i]) + "\"" : std::string("(nil)")) << std::endl;
+            }
         // Process DEL command.
         } else if (command == "DEL" && args.size() == 2) {
             // Remove key from the store.
@@ -82,20 +174,90 @@ int main() {
                 // Print message if key was not found to delete.
                 std::cout << "OK (key not found)" << std::endl;
             }
-        // Process PREFIX command.
+        // Process PREFIX command (streamed, so large matches are never held in memory at once).
         } else if (command == "PREFIX" && args.size() == 2) {
-            // Search for keys with the given prefix.
-            std::vector<std::string> keys = store.prefixSearch(args[1]);
-            // If keys are found.
-            if (!keys.empty()) {
-                // Iterate through found keys.
-                for (size_t i = 0; i < keys.size(); ++i) {
+            // Walk the matching keys lazily.
+            Trie::KeyIterator it = store.scanPrefix(args[1]);
+            // Number of keys printed.
+            size_t count = 0;
+            // Print each key as it is reached.
+            while (it.next()) {
+                // Skip keys past their deadline that are not reclaimed yet.
+                if (!store.peek(it.key())) continue;
+                // Print each key.
+                std::cout << ++count << ") " << it.key() << std::endl;
+            }
+            // If no keys matched.
+            if (count == 0) {
+                // Print message if no keys match the prefix.
+                std::cout << "(no keys found with this prefix)" << std::endl;
+            }
+        // Process paged PREFIX command: PREFIX <prefix> LIMIT <n> [CURSOR <c>].
+        } else if (command == "PREFIX" && (args.size() == 4 || args.size() == 6) && args[2] == "LIMIT" &&
+                   (args.size() == 4 || args[4] == "CURSOR")) {
+            // Page size (must be a positive number).
+            size_t limit = std::strtoull(args[3].c_str(), nullptr, 10);
+            // Resume token from the previous page, or the start.
+            std::string cursor = args.size() == 6 ? args[5] : Trie::CURSOR_START;
+            // Fetch the page.
+            std::optional<PrefixPage> page = limit > 0 ? store.prefixSearch(args[1], limit, cursor) : std::nullopt;
+            // Reject a bad limit or cursor.
+            if (!page) {
+                // Print error message.
+                std::cout << "ERR: LIMIT must be a positive number and CURSOR a token returned by PREFIX" << std::endl;
+            } else {
+                // Print the keys on the page.
+                for (size_t i = 0; i < page->keys.size(); ++i) {
                     // Print each key.
-                    std::cout << (i + 1) << ") " << keys[i] << std::endl;
+                    std::cout << (i + 1) << ") " << page->keys[i] << std::endl;
+                }
+                // Print the token for the next page ("0" when done).
+                std::cout << "cursor: " << page->nextCursor << std::endl;
+            }
+        // Process SCANRANGE command: SCANRANGE <start> <end|+> [REV] [LIMIT <n>], keys in [start, end).
+        } else if (command == "SCANRANGE" && args.size() >= 3 && args.size() <= 6) {
+            // Descending order requested.
+            bool reverse = false;
+            // Maximum number of pairs (unlimited by default).
+            size_t limit = SIZE_MAX;
+            // True while the options parse.
+            bool valid = true;
+            // Parse the options after the bounds.
+            for (size_t i = 3; i < args.size() && valid; ++i) {
+                // Reverse order.
+                if (args[i] == "REV") {
+                    // Set the flag.
+                    reverse = true;
+                // Limit followed by a positive number.
+                } else if (args[i] == "LIMIT" && i + 1 < args.size()) {
+                    // Parse the number.
+                    limit = std::strtoull(args[++i].c_str(), nullptr, 10);
+                    // Zero (or not a number) is rejected.
+                    valid = limit > 0;
+                } else {
+                    // Unknown option.
+                    valid = false;
                 }
+            }
+            // Reject malformed options.
+            if (!valid) {
+                // Print error message.
+                std::cout << "ERR: usage SCANRANGE <start> <end|+> [REV] [LIMIT <n>]" << std::endl;
             } else {
-                // Print message if no keys match the prefix.
-                std::cout << "(no keys found with this prefix)" << std::endl;
+                // "+" leaves the range open at the top.
+                std::optional<std::string> end = args[2] == "+" ? std::nullopt : std::optional<std::string>(args[2]);
+                // Fetch the pairs.
+                std::vector<std::pair<std::string, std::string>> pairs = store.scanRange(args[1], end, limit, reverse);
+                // Print each pair.
+                for (size_t i = 0; i < pairs.size(); ++i) {
+                    // Key and value.
+                    std::cout << (i + 1) << ") " << pairs[i].first << " = \"" << pairs[i].second << "\"" << std::endl;
+                }
+                // If nothing was in range.
+                if (pairs.empty()) {
+                    // Print message.
+                    std::cout << "(no keys in range)" << std::endl;
+                }
             }
         // Process BLOOM command (check Bloom Filter).
         } else if (command == "BLOOM" && args.size() == 2) {
@@ -107,6 +269,44 @@ int main() {
                 // Print message if key is definitely not present.
                 std::cout << "Key \"" << args[1] << "\" is DEFINITELY NOT present." << std::endl;
             }
+        // Process SAVE command (blocks until the snapshot is on disk).
+        } else if (command == "SAVE" && args.size() == 1) {
+            // Write the snapshot.
+            if (store.save(SNAPSHOT_PATH)) {
+                // Print confirmation message.
+                std::cout << "OK" << std::endl;
+            } else {
+                // Report the failure.
+                std::cout << "ERR: could not write " << SNAPSHOT_PATH << std::endl;
+            }
+        // Process BGSAVE command (a child process writes the snapshot while commands keep running).
+        } else if (command == "BGSAVE" && args.size() == 1) {
+            // Start the background save.
+            if (store.backgroundSave(SNAPSHOT_PATH)) {
+                // Print confirmation message.
+                std::cout << "Background saving started" << std::endl;
+            } else {
+                // One is running already, or the fork failed.
+                std::cout << "ERR: Background save already in progress or could not be started" << std::endl;
+            }
+        // Process BGREWRITEAOF command.
+        } else if (command == "BGREWRITEAOF" && args.size() == 1) {
+            // Compact the log from a forked child.
+            if (store.rewriteAppendLog()) {
+                // Print confirmation message.
+                std::cout << "Background append only file rewriting started" << std::endl;
+            } else {
+                // No log, one is running already, or the fork failed.
+                std::cout << "ERR: Append only file disabled, rewrite already in progress or could not be started" << std::endl;
+            }
+        // Process INFO / STATS command (latency per operation, cache and filter counters, structure figures).
+        } else if ((command == "INFO" || command == "STATS") && args.size() <= 2) {
+            // The report (its lines end in CRLF for RESP clients).
+            std::string report = formatMetrics(store.metrics(), args.size() == 2 ? args[1] : std::string());
+            // Drop the carriage returns.
+            report.erase(std::remove(report.begin(), report.end(), '\r'), report.end());
+            // Print it.
+            std::cout << report;
         // Process EXIT command.
         } else if (command == "EXIT") {
             // Print goodbye message and break loop.
@@ -116,7 +316,7 @@ int main() {
         // Handle unknown commands.
         } else {
             // Print error message for invalid command.
-            std::cout << "ERR: Unknown command or incorrect arguments. Available: SET, GET, DEL, PREFIX, BLOOM, EXIT" << std::endl;
+            std::cout << "ERR: Unknown command or incorrect arguments. Available: SET, GET, MSET, MGET, DEL, EXPIRE, TTL, PERSIST, PREFIX, SCANRANGE, BLOOM, INFO, SAVE, BGSAVE, BGREWRITEAOF, EXIT" << std::endl;
         }
     }
     // Return 0 indicating successful execution.
@@ -0,0 +1,114 @@
+#include "../include/membership_filter.hpp"
+#include <limits> // For std::numeric_limits
+
+namespace {
+    // Builds the Bloom filter for a mode (an empty one when the cuckoo filter is in use).
+    BloomFilter makeBloom(FilterMode mode, size_t expectedKeys, double targetFpr, size_t bloomBits, size_t bloomHashes) {
+        // Cuckoo mode keeps no Bloom bits.
+        if (mode != FilterMode::Bloom) return BloomFilter(0, 1);
+        // Size from the expected key count and target rate unless an explicit size was given.
+        size_t bits = bloomBits != 0 ? bloomBits : BloomFilter::optimalNumBits(expectedKeys, targetFpr);
+        // Use the explicit bits per key, or the optimum for that size.
+        size_t hashes = bloomHashes != 0 ? bloomHashes : BloomFilter::optimalNumHashes(bits, expectedKeys);
+        // Build the filter.
+        return BloomFilter(bits, hashes);
+    }
+}
+
+// Constructor: builds a filter of the given mode for expectedKeys keys at targetFpr.
+MembershipFilter::MembershipFilter(FilterMode mode, size_t expectedKeys, double targetFpr, double rebuildThresholdFpr,
+                                   size_t bloomBits, size_t bloomHashes)
+    : filterMode(mode),
+      bloom(makeBloom(mode, expectedKeys, targetFpr, bloomBits, bloomHashes)),
+      // Cuckoo mode sizes its buckets for the expected keys; Bloom mode keeps a single empty bucket.
+      cuckoo(mode == FilterMode::Cuckoo ? expectedKeys : 0),
+      insertions(0),
+      rebuildAtInsertions(std::numeric_limits<size_t>::max()),
+      rebuildFpr(rebuildThresholdFpr) {
+    // Only Bloom mode needs the insert limit, and only when rebuilds are enabled.
+    if (filterMode != FilterMode::Bloom || rebuildFpr <= 0.0 || bloom.numBits() == 0) return;
+    // Binary search the largest insert count whose estimated rate stays within the threshold
+    // (the estimate is costly, so it is evaluated here once rather than on every insert).
+    size_t low = 0;
+    // No filter stays useful past one key per bit.
+    size_t high = bloom.numBits();
+    // Narrow [low, high] down to the limit.
+    while (low < high) {
+        // Midpoint, rounded up so the loop always makes progress.
+        size_t mid = low + (high - low + 1) / 2;
+        // Keep the midpoint if its estimate is still acceptable.
+        if (BloomFilter::estimateFalsePositiveRate(bloom.numBits(), bloom.numHashes(), mid) <= rebuildFpr) {
+            // The limit is at least mid.
+            low = mid;
+        } else {
+            // The limit is below mid.
+            high = mid - 1;
+        }
+    }
+    // Rebuild once inserts go past the limit.
+    rebuildAtInsertions = low;
+}
+
+// Adds a key given its hash.
+bool MembershipFilter::add(uint64_t hashCode) {
+    // Cuckoo mode reports overflow.
+    if (filterMode == FilterMode::Cuckoo) return cuckoo.add(hashCode);
+    // Set the key's bits.
+    bloom.add(hashCode);
+    // Count the insert toward saturation.
+    insertions++;
+    // Bloom filters never reject an insert.
+    return true;
+}
+
+// Removes a key given its hash.
+bool MembershipFilter::remove(uint64_t hashCode) {
+    // Only the cuckoo filter can forget a key; a Bloom filter's bits stay set until it is rebuilt.
+    return filterMode == FilterMode::Cuckoo && cuckoo.remove(hashCode);
+}
+
+// Checks if a key might exist given its hash.
+bool MembershipFilter::possiblyContains(uint64_t hashCode) const {
+    // Ask whichever structure is in use.
+    return filterMode == FilterMode::Cuckoo ? cuckoo.possiblyContains(hashCode) : bloom.possiblyContains(hashCode);
+}
+
+// Starts loading the filter memory a key hash maps to.
+void MembershipFilter::prefetch(uint64_t hashCode) const {
+    // Hint whichever structure is in use.
+    if (filterMode == FilterMode::Cuckoo) cuckoo.prefetch(hashCode); else bloom.prefetch(hashCode);
+}
+
+// Returns the structure in use.
+FilterMode MembershipFilter::mode() const {
+    // As constructed.
+    return filterMode;
+}
+
+// Returns the expected false-positive rate.
+double MembershipFilter::estimatedFalsePositiveRate() const {
+    // The cuckoo filter tracks its own load.
+    if (filterMode == FilterMode::Cuckoo) return cuckoo.estimatedFalsePositiveRate();
+    // A Bloom filter is as full as every insert since it was built made it.
+    return BloomFilter::estimateFalsePositiveRate(bloom.numBits(), bloom.numHashes(), insertions);
+}
+
+// Returns true once the filter has drifted past its rebuild threshold.
+bool MembershipFilter::needsRebuild() const {
+    // Rebuilds are disabled.
+    if (rebuildFpr <= 0.0) return false;
+    // Cuckoo: full, overflowed, or too many fingerprints for the threshold.
+    if (filterMode == FilterMode::Cuckoo) {
+        // Any of the three saturation signals.
+        return cuckoo.isOverflowed() || cuckoo.loadFactor() > CuckooFilter::MAX_LOAD_FACTOR ||
+               cuckoo.estimatedFalsePositiveRate() > rebuildFpr;
+    }
+    // Bloom: past the precomputed insert limit.
+    return insertions > rebuildAtInsertions;
+}
+
+// Returns the number of bytes used by the filter's bits or buckets.
+size_t MembershipFilter::sizeBytes() const {
+    // Only the structure in use counts.
+    return filterMode == FilterMode::Cuckoo ? cuckoo.sizeBytes() : bloom.numBits() / 8;
+}
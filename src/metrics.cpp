@@ -0,0 +1,343 @@
+#include "../include/metrics.hpp"
+#include "../include/utils.hpp" // For Utils::threadIndex
+#include <algorithm> // For std::min, std::max
+#include <cmath> // For std::ceil
+#include <sstream> // For formatting
+#include <thread> // For std::this_thread::yield
+
+namespace {
+    // Operation names, indexed by MetricOp.
+    constexpr const char* OP_NAMES[METRIC_OP_COUNT] = {"get", "set", "remove", "multiget", "multiset", "expire", "prefix", "scanrange"};
+
+#ifdef KV_STORE_METRICS
+    // Shortest stretch nanosPerTick measures over.
+    constexpr std::chrono::milliseconds MIN_CALIBRATION_TIME{10};
+
+    // A tick count and steady_clock reading taken together.
+    struct ClockOrigin {
+        // Ticks.
+        uint64_t ticks;
+        // Time.
+        std::chrono::steady_clock::time_point time;
+    };
+
+    // Taken while the library is loaded, so by the first collect the stretch to measure over is usually long enough.
+    const ClockOrigin PROCESS_ORIGIN{StoreMetrics::ticks(), std::chrono::steady_clock::now()};
+
+    // Id of the next StoreMetrics (0 is left for "no store" in the thread caches).
+    std::atomic<uint64_t> NEXT_ID{1};
+#endif
+}
+
+// Returns the lower-case name of an operation.
+const char* metricOpName(MetricOp op) {
+    // Table lookup.
+    return OP_NAMES[static_cast<size_t>(op)];
+}
+
+// Returns the smallest value of a bucket.
+uint64_t LatencyHistogram::bucketLow(size_t bucket) {
+    // Small values are exact.
+    if (bucket < SUB_BUCKETS) return bucket;
+    // Tier (1 for the values 16..31) and position in it.
+    size_t tier = bucket / SUB_BUCKETS;
+    // Leading SUB_BUCKET_BITS + 1 bits, shifted into place.
+    return static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << (tier - 1);
+}
+
+// Returns the largest value of a bucket.
+uint64_t LatencyHistogram::bucketHigh(size_t bucket) {
+    // Small values are exact.
+    if (bucket < SUB_BUCKETS) return bucket;
+    // The last bucket holds everything beyond the range.
+    if (bucket == BUCKET_COUNT - 1) return UINT64_MAX;
+    // One below the next bucket's start (buckets of a tier are 2^(tier - 1) wide).
+    return bucketLow(bucket) + (uint64_t(1) << (bucket / SUB_BUCKETS - 1)) - 1;
+}
+
+// Constructor: an empty histogram.
+LatencyHistogram::LatencyHistogram() : buckets(BUCKET_COUNT, 0), total(0), largest(0) {}
+
+// Records count occurrences of value.
+void LatencyHistogram::record(uint64_t value, uint64_t count) {
+    // Nothing to add.
+    if (count == 0) return;
+    // Its bucket.
+    buckets[bucketOf(value)] += count;
+    // Count them.
+    total += count;
+    // Track the maximum.
+    largest = std::max(largest, value);
+}
+
+// Adds every value recorded in other.
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    // Bucket by bucket.
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) buckets[i] += other.buckets[i];
+    // Totals.
+    total += other.total;
+    // Maximum.
+    largest = std::max(largest, other.largest);
+}
+
+// Returns the number of values recorded.
+uint64_t LatencyHistogram::count() const {
+    // Maintained by record and merge.
+    return total;
+}
+
+// Returns the value below or at which fraction of the recorded values lie.
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    // Nothing recorded.
+    if (total == 0) return 0;
+    // Nearest rank, 1-based.
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total))));
+    // Values seen so far.
+    uint64_t seen = 0;
+    // Walk up the buckets.
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        // Add this bucket.
+        seen += buckets[i];
+        // The rank falls in it.
+        if (seen >= rank) return std::min(bucketHigh(i), largest);
+    }
+    // Only reached for fraction > 1.
+    return largest;
+}
+
+// Returns the largest value recorded.
+uint64_t LatencyHistogram::max() const {
+    // Maintained by record and merge.
+    return largest;
+}
+
+// Returns the number of values recorded in a bucket.
+uint64_t LatencyHistogram::bucketCount(size_t bucket) const {
+    // Stored directly.
+    return buckets[bucket];
+}
+
+// Adds the figures of another store.
+void MetricsSnapshot::merge(const MetricsSnapshot& other) {
+    // Enabled or not is a build setting, the same for both.
+    enabled = enabled || other.enabled;
+    // Calls.
+    for (size_t i = 0; i < METRIC_OP_COUNT; ++i) calls[i] += other.calls[i];
+    // Latencies.
+    for (size_t i = 0; i < METRIC_OP_COUNT; ++i) latency[i].merge(other.latency[i]);
+    // Counters.
+    cacheHits += other.cacheHits;
+    // Counters.
+    cacheMisses += other.cacheMisses;
+    // Counters.
+    filterNegatives += other.filterNegatives;
+    // Counters.
+    filterFalsePositives += other.filterFalsePositives;
+    // Weighted mean of the probe lengths.
+    size_t samples = probeSamples + other.probeSamples;
+    // Combine them (an empty side contributes nothing).
+    if (samples != 0) meanProbeLength = (meanProbeLength * static_cast<double>(probeSamples) + other.meanProbeLength * static_cast<double>(other.probeSamples)) / static_cast<double>(samples);
+    // Samples.
+    probeSamples = samples;
+    // Longest.
+    maxProbeLength = std::max(maxProbeLength, other.maxProbeLength);
+    // Nodes.
+    trieNodes += other.trieNodes;
+    // Keys.
+    keys += other.keys;
+}
+
+// Formats a snapshot as INFO text.
+std::string formatMetrics(const MetricsSnapshot& metrics, const std::string& section) {
+    // The text.
+    std::ostringstream out;
+    // Counters and structure figures.
+    if (section.empty() || section == "stats") {
+        // Header.
+        out << "# Stats\r\n";
+        // Whether latencies and counters are collected.
+        out << "metrics_enabled:" << (metrics.enabled ? 1 : 0) << "\r\n";
+        // Keys.
+        out << "keys:" << metrics.keys << "\r\n";
+        // Cache.
+        out << "cache_hits:" << metrics.cacheHits << "\r\n";
+        // Cache.
+        out << "cache_misses:" << metrics.cacheMisses << "\r\n";
+        // Filter.
+        out << "filter_negatives:" << metrics.filterNegatives << "\r\n";
+        // Filter.
+        out << "filter_false_positives:" << metrics.filterFalsePositives << "\r\n";
+        // Main store probes.
+        out << "hash_probe_samples:" << metrics.probeSamples << "\r\n";
+        // Main store probes.
+        out << "hash_probe_mean:" << metrics.meanProbeLength << "\r\n";
+        // Main store probes.
+        out << "hash_probe_max:" << metrics.maxProbeLength << "\r\n";
+        // Trie.
+        out << "trie_nodes:" << metrics.trieNodes << "\r\n";
+    }
+    // Latency per operation.
+    if (section.empty() || section == "latency") {
+        // Blank line between sections.
+        if (section.empty()) out << "\r\n";
+        // Header.
+        out << "# Latency\r\n";
+        // Each operation called at least once.
+        for (size_t i = 0; i < METRIC_OP_COUNT; ++i) {
+            // Its histogram.
+            const LatencyHistogram& histogram = metrics.latency[i];
+            // Never called.
+            if (metrics.calls[i] == 0) continue;
+            // One line.
+            out << "latency_" << OP_NAMES[i] << ":calls=" << metrics.calls[i] << ",sampled=" << histogram.count() << ",p50_ns=" << histogram.percentile(0.50)
+                << ",p99_ns=" << histogram.percentile(0.99) << ",p999_ns=" << histogram.percentile(0.999)
+                << ",max_ns=" << histogram.max() << "\r\n";
+        }
+    }
+    // Return the text.
+    return out.str();
+}
+
+#ifdef KV_STORE_METRICS
+
+// Constructor: no blocks yet.
+StoreMetrics::StoreMetrics() : id(NEXT_ID.fetch_add(1, std::memory_order_relaxed)), blocks(new std::atomic<ThreadBlock*>[MAX_THREADS]) {
+    // Every thread starts without one.
+    for (size_t i = 0; i < MAX_THREADS; ++i) blocks[i].store(nullptr, std::memory_order_relaxed);
+}
+
+// Destructor: frees every block.
+StoreMetrics::~StoreMetrics() {
+    // Each allocated one.
+    for (size_t i = 0; i < MAX_THREADS; ++i) delete blocks[i].load(std::memory_order_relaxed);
+}
+
+// Finds (or allocates) the calling thread's block and caches it.
+StoreMetrics::ThreadBlock& StoreMetrics::remember() {
+    // Its index (threads past the table share the last, overflow block).
+    size_t index = std::min(Utils::threadIndex(), MAX_THREADS - 1);
+    // Its block.
+    ThreadBlock* block = blocks[index].load(std::memory_order_acquire);
+    // First call from this index.
+    if (block == nullptr) block = &allocate(index);
+    // Remember the store.
+    cache.owner = id;
+    // And its block.
+    cache.block = block;
+    // Hand it back.
+    return *block;
+}
+
+// Allocates and publishes the block of a thread index.
+StoreMetrics::ThreadBlock& StoreMetrics::allocate(size_t index) {
+    // Value-initialized, so every cell starts at zero.
+    ThreadBlock* block = new ThreadBlock();
+    // The overflow block is updated by several threads.
+    block->shared = index == MAX_THREADS - 1;
+    // Expected: still none.
+    ThreadBlock* expected = nullptr;
+    // Publish it, unless an overflow thread sharing the index got there first.
+    if (!blocks[index].compare_exchange_strong(expected, block, std::memory_order_acq_rel)) {
+        // Use theirs.
+        delete block;
+        // Theirs.
+        return *expected;
+    }
+    // Ours.
+    return *block;
+}
+
+// Adds a sampled duration to block.
+void StoreMetrics::sample(ThreadBlock& block, MetricOp op, uint64_t elapsed) {
+    // Its bucket.
+    bump(block, block.buckets[static_cast<size_t>(op)][LatencyHistogram::bucketOf(elapsed)], 1);
+    // Its longest.
+    std::atomic<uint64_t>& largest = block.largest[static_cast<size_t>(op)];
+    // Longest so far.
+    uint64_t current = largest.load(std::memory_order_relaxed);
+    // Raise it (retrying only if another thread sharing the block raised it meanwhile).
+    while (elapsed > current && !largest.compare_exchange_weak(current, elapsed, std::memory_order_relaxed)) {}
+}
+
+// Returns the nanoseconds per tick.
+double StoreMetrics::nanosPerTick() {
+#if defined(__x86_64__) || defined(__i386__)
+    // Wait out the first moments of the process, so clock read jitter stays negligible against the stretch.
+    while (std::chrono::steady_clock::now() - PROCESS_ORIGIN.time < MIN_CALIBRATION_TIME) std::this_thread::yield();
+    // Both clocks now.
+    uint64_t nowTicks = ticks();
+    // Both clocks now.
+    auto nowTime = std::chrono::steady_clock::now();
+    // Nanoseconds elapsed.
+    double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(nowTime - PROCESS_ORIGIN.time).count());
+    // Ratio of the two.
+    return nanos / static_cast<double>(nowTicks - PROCESS_ORIGIN.ticks);
+#else
+    // Ticks are nanoseconds.
+    return 1.0;
+#endif
+}
+
+// Sums every thread's histograms and counters into snapshot.
+void StoreMetrics::collect(MetricsSnapshot& snapshot) const {
+    // Collected.
+    snapshot.enabled = true;
+    // Tick length.
+    double scale = nanosPerTick();
+    // Counters summed over the threads.
+    uint64_t counters[METRIC_COUNTER_COUNT] = {};
+    // Each thread's block.
+    for (size_t t = 0; t < MAX_THREADS; ++t) {
+        // Its block.
+        const ThreadBlock* block = blocks[t].load(std::memory_order_acquire);
+        // That thread never recorded.
+        if (block == nullptr) continue;
+        // Its counters.
+        for (size_t c = 0; c < METRIC_COUNTER_COUNT; ++c) counters[c] += block->counters[c].load(std::memory_order_relaxed);
+        // Its calls.
+        for (size_t op = 0; op < METRIC_OP_COUNT; ++op) snapshot.calls[op] += block->calls[op].load(std::memory_order_relaxed);
+        // Its histograms.
+        for (size_t op = 0; op < METRIC_OP_COUNT; ++op) {
+            // Longest in nanoseconds.
+            uint64_t largest = static_cast<uint64_t>(static_cast<double>(block->largest[op].load(std::memory_order_relaxed)) * scale);
+            // Highest non-empty bucket, which holds the longest.
+            size_t top = LatencyHistogram::BUCKET_COUNT;
+            // Find it from the end.
+            while (top != 0 && block->buckets[op][top - 1].load(std::memory_order_relaxed) == 0) --top;
+            // Nothing recorded for this operation.
+            if (top == 0) continue;
+            // Index of it.
+            --top;
+            // Each bucket up to it.
+            for (size_t b = 0; b <= top; ++b) {
+                // Durations in it.
+                uint64_t count = block->buckets[op][b].load(std::memory_order_relaxed);
+                // Empty.
+                if (count == 0) continue;
+                // Its start in ticks.
+                uint64_t low = LatencyHistogram::bucketLow(b);
+                // Its middle in ticks (the last bucket's upper end is open, so take its start).
+                uint64_t middle = b == LatencyHistogram::BUCKET_COUNT - 1 ? low : low + (LatencyHistogram::bucketHigh(b) - low) / 2;
+                // The longest is one of the top bucket's durations: record it exactly.
+                if (b == top) {
+                    // Exact.
+                    snapshot.latency[op].record(largest);
+                    // The rest.
+                    --count;
+                }
+                // Re-bucketed in nanoseconds, never above the longest.
+                snapshot.latency[op].record(std::min(static_cast<uint64_t>(static_cast<double>(middle) * scale), largest), count);
+            }
+        }
+    }
+    // Hand over the counters.
+    snapshot.cacheHits += counters[static_cast<size_t>(MetricCounter::CacheHits)];
+    // Hand over the counters.
+    snapshot.cacheMisses += counters[static_cast<size_t>(MetricCounter::CacheMisses)];
+    // Hand over the counters.
+    snapshot.filterNegatives += counters[static_cast<size_t>(MetricCounter::FilterNegatives)];
+    // Hand over the counters.
+    snapshot.filterFalsePositives += counters[static_cast<size_t>(MetricCounter::FilterFalsePositives)];
+}
+
+#endif // KV_STORE_METRICS
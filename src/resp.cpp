@@ -0,0 +1,207 @@
+#include "../include/resp.hpp"
+#include <charconv> // For std::to_chars
+
+namespace {
+    // Parses the decimal integer of a "*<n>\r\n" or "$<n>\r\n" header starting at pos (after the type byte).
+    // Returns Incomplete until the line ends, Error if it is not a number, and sets pos past the line on success.
+    RespParseStatus parseLength(std::string_view input, size_t& pos, int64_t& value) {
+        // End of the header line.
+        size_t lineEnd = input.find("\r\n", pos);
+        // The line has not fully arrived (a sane header is short, so a long one is garbage).
+        if (lineEnd == std::string_view::npos) return input.size() - pos > 32 ? RespParseStatus::Error : RespParseStatus::Incomplete;
+        // Negative lengths (null arrays or bulks) are not valid in a command, and 18 digits cover every limit.
+        if (lineEnd == pos || lineEnd - pos > 18) return RespParseStatus::Error;
+        // Accumulated value.
+        value = 0;
+        // Decimal digits only.
+        for (size_t i = pos; i < lineEnd; ++i) {
+            // Anything else is malformed.
+            if (input[i] < '0' || input[i] > '9') return RespParseStatus::Error;
+            // Shift in the digit.
+            value = value * 10 + (input[i] - '0');
+        }
+        // Past the line.
+        pos = lineEnd + 2;
+        // Parsed.
+        return RespParseStatus::Complete;
+    }
+
+    // Parses an inline command: one line of space-separated words.
+    RespParseStatus parseInline(std::string_view input, std::vector<std::string_view>& args, size_t& consumed, std::string& error) {
+        // End of the line (clients may send a bare "\n").
+        size_t lineEnd = input.find('\n');
+        // Not complete yet.
+        if (lineEnd == std::string_view::npos) {
+            // Refuse to buffer an endless line.
+            if (input.size() > Resp::MAX_INLINE_BYTES) {
+                // Report it.
+                error = "Protocol error: too big inline request";
+                // Give up on the connection.
+                return RespParseStatus::Error;
+            }
+            // Wait for the rest.
+            return RespParseStatus::Incomplete;
+        }
+        // The line without its terminator.
+        std::string_view line = input.substr(0, lineEnd);
+        // Drop a trailing carriage return.
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        // Split on runs of spaces.
+        for (size_t pos = 0; pos < line.size();) {
+            // Skip spaces.
+            if (line[pos] == ' ') {
+                // Next byte.
+                pos++;
+                // Continue.
+                continue;
+            }
+            // End of the word.
+            size_t end = line.find(' ', pos);
+            // The last word runs to the end of the line.
+            if (end == std::string_view::npos) end = line.size();
+            // Keep it.
+            args.push_back(line.substr(pos, end - pos));
+            // Past it.
+            pos = end;
+        }
+        // The line is used up (an empty line yields no arguments and is skipped by the caller).
+        consumed = lineEnd + 1;
+        // Parsed.
+        return RespParseStatus::Complete;
+    }
+
+    // Appends a decimal integer.
+    void appendDecimal(std::string& out, int64_t value) {
+        // Room for any 64-bit value.
+        char digits[24];
+        // Format without locale or allocation.
+        char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+        // Copy it.
+        out.append(digits, static_cast<size_t>(end - digits));
+    }
+}
+
+// Parses the command at the front of input.
+RespParseStatus Resp::parseCommand(std::string_view input, std::vector<std::string_view>& args, size_t& consumed, std::string& error) {
+    // Start with no arguments.
+    args.clear();
+    // Nothing buffered.
+    if (input.empty()) return RespParseStatus::Incomplete;
+    // Anything but an array is an inline command.
+    if (input[0] != '*') return parseInline(input, args, consumed, error);
+    // Position after the type byte.
+    size_t pos = 1;
+    // Number of elements.
+    int64_t count;
+    // Read the array header.
+    RespParseStatus status = parseLength(input, pos, count);
+    // Not there yet, or malformed.
+    if (status != RespParseStatus::Complete || count > static_cast<int64_t>(MAX_ARGUMENTS)) {
+        // Name the problem.
+        if (status != RespParseStatus::Incomplete) error = "Protocol error: invalid multibulk length";
+        // Report it.
+        return status == RespParseStatus::Incomplete ? status : RespParseStatus::Error;
+    }
+    // Each element is a bulk string.
+    for (int64_t i = 0; i < count; ++i) {
+        // Wait for its header.
+        if (pos == input.size()) return RespParseStatus::Incomplete;
+        // Commands are arrays of bulk strings only.
+        if (input[pos] != '$') {
+            // Name the problem.
+            error = "Protocol error: expected '$', got '" + std::string(1, input[pos]) + "'";
+            // Give up on the connection.
+            return RespParseStatus::Error;
+        }
+        // Past the type byte.
+        pos++;
+        // Length of the string.
+        int64_t length;
+        // Read its header.
+        status = parseLength(input, pos, length);
+        // Not there yet, or malformed.
+        if (status != RespParseStatus::Complete || length > static_cast<int64_t>(MAX_BULK_BYTES)) {
+            // Name the problem.
+            if (status != RespParseStatus::Incomplete) error = "Protocol error: invalid bulk length";
+            // Report it.
+            return status == RespParseStatus::Incomplete ? status : RespParseStatus::Error;
+        }
+        // The bytes and their terminator must have arrived.
+        if (input.size() - pos < static_cast<size_t>(length) + 2) return RespParseStatus::Incomplete;
+        // The terminator must be there.
+        if (input[pos + length] != '\r' || input[pos + length + 1] != '\n') {
+            // Name the problem.
+            error = "Protocol error: bulk string not terminated";
+            // Give up on the connection.
+            return RespParseStatus::Error;
+        }
+        // The argument.
+        args.push_back(input.substr(pos, static_cast<size_t>(length)));
+        // Past it and its terminator.
+        pos += static_cast<size_t>(length) + 2;
+    }
+    // The whole command.
+    consumed = pos;
+    // Parsed.
+    return RespParseStatus::Complete;
+}
+
+// Appends a simple string reply.
+void Resp::appendSimpleString(std::string& out, std::string_view text) {
+    // Type byte.
+    out.push_back('+');
+    // Text.
+    out.append(text);
+    // Terminator.
+    out.append("\r\n");
+}
+
+// Appends an error reply.
+void Resp::appendError(std::string& out, std::string_view message) {
+    // Type byte.
+    out.push_back('-');
+    // Message.
+    out.append(message);
+    // Terminator.
+    out.append("\r\n");
+}
+
+// Appends an integer reply.
+void Resp::appendInteger(std::string& out, int64_t value) {
+    // Type byte.
+    out.push_back(':');
+    // Digits.
+    appendDecimal(out, value);
+    // Terminator.
+    out.append("\r\n");
+}
+
+// Appends a bulk string reply.
+void Resp::appendBulkString(std::string& out, std::string_view value) {
+    // Type byte.
+    out.push_back('$');
+    // Length.
+    appendDecimal(out, static_cast<int64_t>(value.size()));
+    // Header terminator.
+    out.append("\r\n");
+    // Bytes.
+    out.append(value);
+    // Terminator.
+    out.append("\r\n");
+}
+
+// Appends the null bulk reply.
+void Resp::appendNull(std::string& out) {
+    // RESP2 null bulk string.
+    out.append("$-1\r\n");
+}
+
+// Appends the header of an array reply.
+void Resp::appendArrayHeader(std::string& out, size_t count) {
+    // Type byte.
+    out.push_back('*');
+    // Element count.
+    appendDecimal(out, static_cast<int64_t>(count));
+    // Terminator.
+    out.append("\r\n");
+}
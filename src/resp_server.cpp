@@ -0,0 +1,1410 @@
+#include "../include/resp_server.hpp"
+#include "../include/core_server.hpp" // For forwarding between cores
+#include "../include/utils.hpp" // For Utils::hash64
+#include <algorithm> // For std::min, std::find, std::sort
+#include <cctype> // For std::toupper
+#include <cerrno> // For errno
+#include <charconv> // For std::from_chars
+#include <iterator> // For std::make_move_iterator
+#include <climits> // For IOV_MAX
+#include <fcntl.h> // For O_* flags
+#include <unistd.h> // For read, write, close
+#include <sys/epoll.h> // For the event loop
+#include <sys/eventfd.h> // For waking the loop
+#include <sys/socket.h> // For sockets
+#include <sys/uio.h> // For iovec
+#include <netinet/in.h> // For sockaddr_in
+#include <netinet/tcp.h> // For TCP_NODELAY
+#include <arpa/inet.h> // For inet_pton
+
+namespace {
+    // Parses a whole decimal integer argument.
+    bool parseInteger(std::string_view text, int64_t& value) {
+        // Convert without locale or allocation.
+        std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+        // Every byte must be part of the number.
+        return result.ec == std::errc() && result.ptr == text.data() + text.size();
+    }
+
+    // Returns true if text equals word, ignoring ASCII case (word is upper case).
+    bool equalsIgnoreCase(std::string_view text, std::string_view word) {
+        // Lengths must match.
+        if (text.size() != word.size()) return false;
+        // Compare byte by byte.
+        for (size_t i = 0; i < text.size(); ++i) {
+            // Fold the client's byte to upper case.
+            if (std::toupper(static_cast<unsigned char>(text[i])) != word[i]) return false;
+        }
+        // Equal.
+        return true;
+    }
+
+    // Reply of a write rejected by the memory budget.
+    constexpr std::string_view OOM_ERROR = "OOM command not allowed when used memory > 'maxmemory'.";
+
+#ifdef KV_STORE_IO_URING
+    // Kind of an io_uring request, kept in the low byte of its user_data.
+    enum class RingOp : uint8_t { Accept = 1, Receive, Send, Wake, Tick };
+
+    // Packs a request's kind, descriptor (24 bits) and connection number (32 bits) into its user_data.
+    uint64_t ringTag(RingOp op, int fd, uint32_t id) {
+        // id | fd | op.
+        return static_cast<uint64_t>(id) << 32 | (static_cast<uint64_t>(static_cast<uint32_t>(fd)) & 0xFFFFFF) << 8 | static_cast<uint8_t>(op);
+    }
+#endif
+}
+
+// Constructor: serves store with the given settings.
+RespServer::RespServer(KVStore& store, const ServerConfig& config)
+    : store(store), settings(config), listenFd(-1), epollFd(-1), wakeFd(-1), boundPort(0), stopping(false),
+      activeBackend(ServerBackend::Epoll), lastConnectionId(0), readBuffer(READ_CHUNK_BYTES), group(nullptr), core(0), sleeping(false),
+      outboxWaiting(false) {
+}
+
+// Destructor: closes every socket.
+RespServer::~RespServer() {
+#ifdef KV_STORE_IO_URING
+    // Closing the ring cancels what is in flight before the receive buffers and connections are freed.
+    ring.reset();
+    // Nothing can fill them now.
+    receiveBuffers.reset();
+#endif
+    // Every client.
+    for (std::pair<const int, std::unique_ptr<Connection>>& entry : connections) ::close(entry.first);
+    // The listening socket.
+    if (listenFd >= 0) ::close(listenFd);
+    // The wake-up descriptor.
+    if (wakeFd >= 0) ::close(wakeFd);
+    // The epoll instance.
+    if (epollFd >= 0) ::close(epollFd);
+}
+
+// Binds and listens.
+bool RespServer::start() {
+    // Non-blocking TCP socket.
+    listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    // No socket.
+    if (listenFd < 0) return false;
+    // Allow a restart while old connections linger in TIME_WAIT.
+    int enable = 1;
+    // Set it.
+    ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    // Share the port with the other cores' sockets; the kernel balances connections across them.
+    if (settings.reusePort && ::setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) != 0) return false;
+    // Address to bind.
+    sockaddr_in address{};
+    // IPv4.
+    address.sin_family = AF_INET;
+    // Port in network order.
+    address.sin_port = htons(settings.port);
+    // Parse the address; bind and listen.
+    if (::inet_pton(AF_INET, settings.bindAddress.c_str(), &address.sin_addr) != 1 ||
+        ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd, SOMAXCONN) != 0) return false;
+    // Port actually bound (differs from the setting when it was 0).
+    socklen_t length = sizeof(address);
+    // Look it up.
+    if (::getsockname(listenFd, reinterpret_cast<sockaddr*>(&address), &length) != 0) return false;
+    // Remember it.
+    boundPort = ntohs(address.sin_port);
+    // Wake-up channel for stop().
+    wakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    // Needed by both backends.
+    if (wakeFd < 0) return false;
+#ifdef KV_STORE_IO_URING
+    // The io_uring backend, when asked for and supported.
+    if (settings.backend == ServerBackend::IoUring && startRing()) {
+        // Use it.
+        activeBackend = ServerBackend::IoUring;
+        // Listening.
+        return true;
+    }
+#endif
+    // Event loop.
+    epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+    // Needed.
+    if (epollFd < 0) return false;
+    // Watch for new connections and wake-ups.
+    for (int fd : {listenFd, wakeFd}) {
+        // Readable means a connection or a stop request is waiting.
+        epoll_event event{};
+        // Level-triggered reads.
+        event.events = EPOLLIN;
+        // Identify it by descriptor.
+        event.data.fd = fd;
+        // Register it.
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) return false;
+    }
+    // Listening.
+    return true;
+}
+
+// Returns the port bound by start.
+uint16_t RespServer::port() const {
+    // Set by start.
+    return boundPort;
+}
+
+// Tracks a new connection.
+RespServer::Connection* RespServer::addConnection(int fd) {
+    // Over the limit: tell the client why and hang up.
+    if (connections.size() >= settings.maxClients) {
+        // Best effort; the socket is fresh, so the short reply fits.
+        static constexpr std::string_view refusal = "-ERR max number of clients reached\r\n";
+        // Send it.
+        ssize_t ignored = ::send(fd, refusal.data(), refusal.size(), MSG_NOSIGNAL);
+        // Nothing to do if it failed.
+        (void)ignored;
+        // Hang up.
+        ::close(fd);
+        // Not tracked.
+        return nullptr;
+    }
+    // Replies go out as soon as they are written, not after Nagle's delay.
+    int enable = 1;
+    // Set it.
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    // Its state.
+    std::unique_ptr<Connection> connection = std::make_unique<Connection>();
+    // Socket.
+    connection->fd = fd;
+    // Number it.
+    connection->id = ++lastConnectionId;
+    // Keep a pointer for the caller.
+    Connection* added = connection.get();
+    // Track it.
+    connections[fd] = std::move(connection);
+    // Count it.
+    counters.connectionsAccepted++;
+    // Hand it back.
+    return added;
+}
+
+// Accepts every pending connection.
+void RespServer::acceptConnections() {
+    // Drain the accept queue.
+    while (true) {
+        // Next client, already non-blocking.
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        // Queue empty (or a transient error): wait for the next event.
+        if (fd < 0) return;
+        // Track it (or turn it away).
+        if (addConnection(fd) == nullptr) continue;
+        // Watch it for requests.
+        epoll_event event{};
+        // Level-triggered, so a client left with unread data is served again next iteration.
+        event.events = EPOLLIN;
+        // Identify it by descriptor.
+        event.data.fd = fd;
+        // Register it; a connection that cannot be watched cannot be served.
+        if (::epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) closeClient(fd);
+    }
+}
+
+// Reads from a readable client and executes every complete command it sent.
+bool RespServer::readFromClient(Connection& connection) {
+    // One read per readiness, so one busy client cannot starve the others.
+    ssize_t received = ::read(connection.fd, readBuffer.data(), readBuffer.size());
+    // The client hung up.
+    if (received == 0) return false;
+    // Spurious wake-up or interrupted read: try again next iteration; anything else is fatal.
+    if (received < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    // Count it.
+    counters.reads++;
+    // Execute what arrived.
+    processInput(connection, std::string_view(readBuffer.data(), static_cast<size_t>(received)));
+    // Keep serving it.
+    return true;
+}
+
+// Executes every complete command in data after any partial command left from before.
+void RespServer::processInput(Connection& connection, std::string_view data) {
+    // A partial command is waiting for these bytes.
+    if (!connection.input.empty()) {
+        // Join them.
+        connection.input.append(data);
+        // Parse the joined bytes.
+        data = connection.input;
+    }
+    // Bytes parsed so far.
+    size_t offset = 0;
+    // Reason for a protocol error.
+    std::string error;
+    // Execute every complete command back to back (a pipeline), stopping after QUIT.
+    while (!connection.closeAfterWrite) {
+        // Length of the next command.
+        size_t consumed = 0;
+        // Parse it.
+        RespParseStatus status = Resp::parseCommand(data.substr(offset), args, consumed, error);
+        // The rest has not arrived.
+        if (status == RespParseStatus::Incomplete) break;
+        // Malformed: the stream cannot be resynchronized.
+        if (status == RespParseStatus::Error) {
+            // Tell the client why.
+            Resp::appendError(replyBuffer(connection), "ERR " + error);
+            // Then hang up.
+            connection.closeAfterWrite = true;
+            // Count it.
+            counters.protocolErrors++;
+            // Discard the rest.
+            offset = data.size();
+            // Done.
+            break;
+        }
+        // Past it.
+        offset += consumed;
+        // Empty inline lines are ignored.
+        if (!args.empty()) execute(connection);
+    }
+    // Keep only the unparsed tail (a command still arriving); data may point into the caller's receive buffer.
+    if (connection.input.empty()) connection.input.assign(data.substr(offset)); else connection.input.erase(0, offset);
+    // Replies go out at the end of the iteration.
+    if (connection.hasOutput()) scheduleFlush(connection);
+}
+
+// Executes one parsed command, appending its reply.
+void RespServer::execute(Connection& connection) {
+    // Count it.
+    counters.commandsProcessed++;
+    // Keys owned by other cores: the reply arrives later.
+    if (group != nullptr && route(connection)) return;
+    // Run it here; hang up after its reply if it was QUIT.
+    if (runCommand(replyBuffer(connection))) connection.closeAfterWrite = true;
+}
+
+// Runs the parsed command against the store, appending its reply to out.
+bool RespServer::runCommand(std::string& out) {
+    // Number of arguments, including the command name.
+    size_t argc = args.size();
+    // Command name as sent.
+    std::string_view name = args[0];
+    // Replies to a command called with the wrong number of arguments.
+    auto wrongArity = [&]() {
+        // Redis' wording, with the name in lower case.
+        std::string lower(name);
+        // Fold it.
+        for (char& c : lower) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        // Reply.
+        Resp::appendError(out, "ERR wrong number of arguments for '" + lower + "' command");
+        // The connection stays open.
+        return false;
+    };
+    // Replies with an error.
+    auto error = [&](const std::string& message) {
+        // Reply.
+        Resp::appendError(out, message);
+        // The connection stays open.
+        return false;
+    };
+    // Dispatch on the name, most frequent first.
+    if (equalsIgnoreCase(name, "GET")) {
+        // GET key.
+        if (argc != 2) return wrongArity();
+        // Borrow the value; it is copied into the reply before the next store call.
+        std::optional<std::string_view> value = store.getView(args[1]);
+        // Reply with it, or null.
+        if (value) Resp::appendBulkString(out, *value); else Resp::appendNull(out);
+    } else if (equalsIgnoreCase(name, "SET")) {
+        // SET key value [EX seconds|PX milliseconds].
+        if (argc < 3) return wrongArity();
+        // Plain SET.
+        if (argc == 3) {
+            // Write it.
+            if (store.set(args[1], args[2], Utils::hash64(args[1]))) Resp::appendSimpleString(out, "OK"); else Resp::appendError(out, OOM_ERROR);
+            // Done.
+            return false;
+        }
+        // Expiry amount.
+        int64_t amount = 0;
+        // Only one EX or PX option is supported.
+        bool seconds = equalsIgnoreCase(args[3], "EX");
+        // Anything else is a syntax error.
+        if (argc != 5 || (!seconds && !equalsIgnoreCase(args[3], "PX"))) return error("ERR syntax error");
+        // The amount must be a positive integer.
+        if (!parseInteger(args[4], amount) || amount <= 0) return error("ERR invalid expire time in 'set' command");
+        // Write it with its deadline.
+        bool written = store.setWithTtl(std::string(args[1]), std::string(args[2]), static_cast<uint64_t>(amount) * (seconds ? 1000 : 1));
+        // Reply.
+        if (written) Resp::appendSimpleString(out, "OK"); else Resp::appendError(out, OOM_ERROR);
+    } else if (equalsIgnoreCase(name, "DEL")) {
+        // DEL key [key ...].
+        if (argc < 2) return wrongArity();
+        // Keys removed.
+        int64_t removed = 0;
+        // Remove each.
+        for (size_t i = 1; i < argc; ++i) removed += store.remove(args[i], Utils::hash64(args[i])) ? 1 : 0;
+        // Reply with the count.
+        Resp::appendInteger(out, removed);
+    } else if (equalsIgnoreCase(name, "MGET")) {
+        // MGET key [key ...].
+        if (argc < 2) return wrongArity();
+        // Keys, owned for the batched lookup.
+        std::vector<std::string> keys(args.begin() + 1, args.end());
+        // Look them up together.
+        std::vector<std::optional<std::string_view>> values = store.multiGet(keys);
+        // One element per key.
+        Resp::appendArrayHeader(out, values.size());
+        // Each value, or null.
+        for (const std::optional<std::string_view>& value : values) {
+            // Copy it in.
+            if (value) Resp::appendBulkString(out, *value); else Resp::appendNull(out);
+        }
+    } else if (equalsIgnoreCase(name, "MSET")) {
+        // MSET key value [key value ...].
+        if (argc < 3 || argc % 2 == 0) return wrongArity();
+        // Pairs, owned for the batched write.
+        std::vector<std::pair<std::string, std::string>> pairs;
+        // One per key.
+        pairs.reserve(argc / 2);
+        // Collect them.
+        for (size_t i = 1; i + 1 < argc; i += 2) pairs.emplace_back(args[i], args[i + 1]);
+        // Write them together.
+        if (store.multiSet(pairs)) Resp::appendSimpleString(out, "OK"); else Resp::appendError(out, OOM_ERROR);
+    } else if (equalsIgnoreCase(name, "EXISTS")) {
+        // EXISTS key [key ...].
+        if (argc < 2) return wrongArity();
+        // Keys present.
+        int64_t present = 0;
+        // Check each (an expired key is reclaimed and not counted).
+        for (size_t i = 1; i < argc; ++i) present += store.getView(args[i]) ? 1 : 0;
+        // Reply with the count.
+        Resp::appendInteger(out, present);
+    } else if (equalsIgnoreCase(name, "PREFIX")) {
+        // PREFIX prefix.
+        if (argc != 2) return wrongArity();
+        // Every key starting with it, sorted.
+        std::vector<std::string> keys = store.prefixSearch(std::string(args[1]));
+        // One element per key.
+        Resp::appendArrayHeader(out, keys.size());
+        // Each key.
+        for (const std::string& key : keys) Resp::appendBulkString(out, key);
+    } else if (equalsIgnoreCase(name, "EXPIRE") || equalsIgnoreCase(name, "PEXPIRE")) {
+        // EXPIRE key seconds / PEXPIRE key milliseconds.
+        if (argc != 3) return wrongArity();
+        // Amount.
+        int64_t amount = 0;
+        // A non-negative integer.
+        if (!parseInteger(args[2], amount) || amount < 0) return error("ERR value is not an integer or out of range");
+        // Seconds or milliseconds.
+        uint64_t millis = static_cast<uint64_t>(amount) * (equalsIgnoreCase(name, "EXPIRE") ? 1000 : 1);
+        // 1 if the key exists.
+        Resp::appendInteger(out, store.expire(std::string(args[1]), millis) ? 1 : 0);
+    } else if (equalsIgnoreCase(name, "TTL") || equalsIgnoreCase(name, "PTTL")) {
+        // TTL key / PTTL key.
+        if (argc != 2) return wrongArity();
+        // Milliseconds left, or a negative status.
+        int64_t left = store.ttl(std::string(args[1]));
+        // TTL rounds to seconds; statuses pass through.
+        Resp::appendInteger(out, left >= 0 && equalsIgnoreCase(name, "TTL") ? (left + 500) / 1000 : left);
+    } else if (equalsIgnoreCase(name, "PERSIST")) {
+        // PERSIST key.
+        if (argc != 2) return wrongArity();
+        // 1 if a deadline was removed.
+        Resp::appendInteger(out, store.persist(std::string(args[1])) ? 1 : 0);
+    } else if (equalsIgnoreCase(name, "PING")) {
+        // PING [message].
+        if (argc > 2) return wrongArity();
+        // Echo the message, or PONG.
+        if (argc == 2) Resp::appendBulkString(out, args[1]); else Resp::appendSimpleString(out, "PONG");
+    } else if (equalsIgnoreCase(name, "ECHO")) {
+        // ECHO message.
+        if (argc != 2) return wrongArity();
+        // Send it back.
+        Resp::appendBulkString(out, args[1]);
+    } else if (equalsIgnoreCase(name, "DBSIZE")) {
+        // Number of keys.
+        Resp::appendInteger(out, static_cast<int64_t>(store.size()));
+    } else if (equalsIgnoreCase(name, "INFO") || equalsIgnoreCase(name, "STATS")) {
+        // INFO [stats|latency] (STATS is the same command).
+        if (argc > 2) return wrongArity();
+        // Section asked for, folded to lower case ("all" and "everything" mean every section).
+        std::string section(argc == 2 ? args[1] : std::string_view());
+        // Fold it.
+        for (char& c : section) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        // Every section.
+        if (section == "all" || section == "everything" || section == "default") section.clear();
+        // In thread-per-core mode this is the serving core's partition.
+        Resp::appendBulkString(out, section.empty() || section == "stats" || section == "latency" ? formatMetrics(store.metrics(), section) : std::string());
+    } else if (equalsIgnoreCase(name, "SAVE")) {
+        // Foreground snapshot.
+        if (store.save(settings.snapshotPath)) Resp::appendSimpleString(out, "OK"); else Resp::appendError(out, "ERR could not write the snapshot");
+    } else if (equalsIgnoreCase(name, "BGSAVE")) {
+        // Background snapshot.
+        if (store.backgroundSave(settings.snapshotPath)) Resp::appendSimpleString(out, "Background saving started");
+        // One is running, or the fork failed.
+        else Resp::appendError(out, "ERR Background save already in progress or could not be started");
+    } else if (equalsIgnoreCase(name, "BGREWRITEAOF")) {
+        // Background log rewrite.
+        if (store.rewriteAppendLog()) Resp::appendSimpleString(out, "Background append only file rewriting started");
+        // No log, one is running, or the fork failed.
+        else Resp::appendError(out, "ERR Append only file disabled, rewrite already in progress or could not be started");
+    } else if (equalsIgnoreCase(name, "SELECT")) {
+        // Only database 0 exists.
+        if (argc != 2) return wrongArity();
+        // Accept it and refuse the others.
+        if (args[1] == "0") Resp::appendSimpleString(out, "OK"); else Resp::appendError(out, "ERR DB index is out of range");
+    } else if (equalsIgnoreCase(name, "COMMAND") || equalsIgnoreCase(name, "CONFIG")) {
+        // Introspection that redis-cli and redis-benchmark send on connect: nothing to report.
+        Resp::appendArrayHeader(out, 0);
+    } else if (equalsIgnoreCase(name, "QUIT")) {
+        // Acknowledge.
+        Resp::appendSimpleString(out, "OK");
+        // Hang up once the replies are out.
+        return true;
+    } else {
+        // Redis' wording.
+        Resp::appendError(out, "ERR unknown command '" + std::string(name) + "'");
+    }
+    // The connection stays open.
+    return false;
+}
+
+// Returns where the next reply goes.
+std::string& RespServer::replyBuffer(Connection& connection) {
+    // Nothing is waiting on other cores: straight to the output.
+    if (connection.waiting.empty()) return outputBlock(connection);
+    // Behind a reply still waiting: queue up after it.
+    if (connection.waiting.back().partsLeft != 0) connection.waiting.emplace_back();
+    // The last pending reply is complete and collects the replies after it.
+    return connection.waiting.back().reply;
+}
+
+// Returns the output block replies should be appended to.
+std::string& RespServer::outputBlock(Connection& connection) {
+    // Start a new block when there is none, the last one is full, or a send in flight is reading it.
+    if (connection.output.size() <= connection.blocksInFlight || connection.output.back().size() >= OUTPUT_BLOCK_BYTES) {
+        // Fresh block.
+        connection.output.emplace_back();
+        // Room for a block of small replies without regrowing.
+        connection.output.back().reserve(OUTPUT_BLOCK_BYTES);
+    }
+    // The last block.
+    return connection.output.back();
+}
+
+// Queues a connection for the end-of-iteration flush.
+void RespServer::scheduleFlush(Connection& connection) {
+    // Already queued.
+    if (connection.pendingFlush) return;
+    // Mark it.
+    connection.pendingFlush = true;
+    // Queue it.
+    flushList.push_back(&connection);
+}
+
+// Points iovecs at the connection's unsent output blocks.
+size_t RespServer::gatherOutput(Connection& connection, std::vector<iovec>& iovecs) {
+    // Blocks to send, capped at what one gather write accepts.
+    size_t count = std::min<size_t>(connection.output.size(), IOV_MAX);
+    // One entry per block.
+    iovecs.resize(count);
+    // Point at each block (the first one past what was already sent).
+    for (size_t i = 0; i < count; ++i) {
+        // Block start.
+        iovecs[i].iov_base = connection.output[i].data() + (i == 0 ? connection.outputOffset : 0);
+        // Its unsent length.
+        iovecs[i].iov_len = connection.output[i].size() - (i == 0 ? connection.outputOffset : 0);
+    }
+    // Blocks covered.
+    return count;
+}
+
+// Drops bytes of output that were written.
+void RespServer::consumeOutput(Connection& connection, size_t bytes) {
+    // Whole blocks first.
+    size_t done = 0;
+    // Walk the blocks the write covered.
+    while (done < connection.output.size() && bytes >= connection.output[done].size() - connection.outputOffset) {
+        // Bytes of this block that were unsent.
+        bytes -= connection.output[done].size() - connection.outputOffset;
+        // Whole block gone.
+        connection.outputOffset = 0;
+        // Next block.
+        done++;
+    }
+    // Keep the first sent block's capacity for the next replies when everything went out.
+    if (done == connection.output.size() && done != 0) {
+        // Reuse the first block.
+        connection.output.front().clear();
+        // Drop the rest.
+        connection.output.resize(1);
+    } else {
+        // Drop the sent blocks.
+        connection.output.erase(connection.output.begin(), connection.output.begin() + static_cast<std::ptrdiff_t>(done));
+        // Part of the next block went out.
+        connection.outputOffset += bytes;
+    }
+}
+
+// Writes as much of a connection's output as the socket takes with one gather write.
+bool RespServer::flushClient(Connection& connection) {
+    // Point at the unsent blocks.
+    size_t count = gatherOutput(connection, gather);
+    // The gather write, as sendmsg so a client that hung up reports EPIPE instead of raising SIGPIPE.
+    msghdr message{};
+    // The blocks.
+    message.msg_iov = gather.data();
+    // How many.
+    message.msg_iovlen = count;
+    // One system call for every reply of the iteration.
+    ssize_t written = count == 0 ? 0 : ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+    // Count it.
+    if (count != 0) counters.writevCalls++;
+    // Socket buffer full: wait until it drains; any other error ends the connection.
+    if (written < 0) {
+        // Not fatal.
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) return false;
+        // Nothing went out.
+        written = 0;
+    }
+    // Drop what was sent.
+    consumeOutput(connection, static_cast<size_t>(written));
+    // Whether replies are still waiting.
+    bool pending = connection.hasOutput();
+    // Wake up when the socket drains (or stop watching once it did).
+    watchWritable(connection, pending);
+    // Hang up after QUIT or a protocol error once its replies (including those waiting on other cores) are out.
+    return pending || !connection.waiting.empty() || !connection.closeAfterWrite;
+}
+
+// Registers or clears interest in a connection becoming writable.
+void RespServer::watchWritable(Connection& connection, bool enable) {
+    // Already in that state.
+    if (connection.waitingForWritable == enable) return;
+    // New interest set.
+    epoll_event event{};
+    // Always readable; writable only while output is stuck.
+    event.events = enable ? static_cast<uint32_t>(EPOLLIN | EPOLLOUT) : static_cast<uint32_t>(EPOLLIN);
+    // Identify it by descriptor.
+    event.data.fd = connection.fd;
+    // Update it.
+    ::epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+    // Remember it.
+    connection.waitingForWritable = enable;
+}
+
+// Returns the open connection on fd numbered id.
+RespServer::Connection* RespServer::findConnection(int fd, uint32_t id) {
+    // Connection now using the descriptor.
+    std::unordered_map<int, std::unique_ptr<Connection>>::iterator it = connections.find(fd);
+    // The descriptor was closed (and possibly reused by a newer connection).
+    if (it == connections.end() || it->second->id != id) return nullptr;
+    // Still the same connection.
+    return it->second.get();
+}
+
+// Closes a connection and forgets it.
+void RespServer::closeClient(int fd) {
+    // Its state.
+    std::unordered_map<int, std::unique_ptr<Connection>>::iterator it = connections.find(fd);
+    // Unknown descriptor.
+    if (it == connections.end()) return;
+    // It must not be flushed after it is gone.
+    if (it->second->pendingFlush) flushList.erase(std::find(flushList.begin(), flushList.end(), it->second.get()));
+#ifdef KV_STORE_IO_URING
+    // Under io_uring the pending receive holds the socket open; shutting it down ends the receive.
+    if (ring) ::shutdown(fd, SHUT_RDWR);
+    // A send in flight is still reading the output blocks: keep them until it completes.
+    if (it->second->sendInFlight) retired[it->second->id] = std::move(it->second);
+#endif
+    // Closing also removes it from the epoll set.
+    ::close(fd);
+    // Forget it.
+    connections.erase(it);
+}
+
+// Runs the event loop until stop() is called.
+void RespServer::run() {
+#ifdef KV_STORE_IO_URING
+    // Completion-based loop.
+    if (activeBackend == ServerBackend::IoUring) return runRing();
+#endif
+    // Readiness-based loop.
+    runEpoll();
+}
+
+// Runs the epoll event loop.
+void RespServer::runEpoll() {
+    // Events of one wait.
+    epoll_event events[MAX_EVENTS];
+    // Connections flushed in an iteration.
+    std::vector<Connection*> flushing;
+    // Until stop().
+    while (!stopping.load(std::memory_order_relaxed)) {
+        // Wait for activity, or for the tick interval (not at all if other cores left work).
+        int ready = ::epoll_wait(epollFd, events, MAX_EVENTS, waitTimeout());
+        // Awake: peers need not write the eventfd until the next wait.
+        sleeping.store(false, std::memory_order_relaxed);
+        // Count it.
+        counters.loopIterations++;
+        // Serve every ready descriptor.
+        for (int i = 0; i < ready; ++i) {
+            // Descriptor.
+            int fd = events[i].data.fd;
+            // New connections.
+            if (fd == listenFd) {
+                // Accept them all.
+                acceptConnections();
+                // Next event.
+                continue;
+            }
+            // stop() was called.
+            if (fd == wakeFd) {
+                // Counter value.
+                uint64_t value;
+                // Reset it.
+                ssize_t ignored = ::read(wakeFd, &value, sizeof(value));
+                // The loop condition sees the flag.
+                (void)ignored;
+                // Next event.
+                continue;
+            }
+            // The client.
+            std::unordered_map<int, std::unique_ptr<Connection>>::iterator it = connections.find(fd);
+            // Closed earlier in this iteration.
+            if (it == connections.end()) continue;
+            // Its state.
+            Connection& connection = *it->second;
+            // The socket drained: send the rest with this iteration's writes.
+            if (events[i].events & EPOLLOUT) scheduleFlush(connection);
+            // Requests (or a hang-up, which reads as end of stream).
+            if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !readFromClient(connection)) closeClient(fd);
+        }
+        // Work other cores forwarded, and the results of what this core forwarded.
+        if (group != nullptr) drainPeers();
+        // Every write of the iteration becomes durable with one log sync, before any of them is acknowledged.
+        store.syncAppendLog(store.lastAppendLogSequence());
+        // Results and requests for other cores (after the sync, so a forwarded write is durable once answered).
+        if (group != nullptr) flushPeers();
+        // Take this iteration's list (closeClient edits flushList).
+        flushing.swap(flushList);
+        // One gather write per connection.
+        for (Connection* connection : flushing) {
+            // No longer queued.
+            connection->pendingFlush = false;
+            // Send its replies; close it on error or once it asked to be closed.
+            if (!flushClient(*connection)) closeClient(connection->fd);
+        }
+        // Ready for the next iteration.
+        flushing.clear();
+        // Background work: filter rebuild, expiry, finished saves and log rewrites.
+        store.tick();
+    }
+}
+
+#ifdef KV_STORE_IO_URING
+// Sets up the ring and its receive buffers.
+bool RespServer::startRing() {
+    // The ring.
+    ring = std::make_unique<IoRing>(RING_ENTRIES);
+    // Receive buffers shared by every connection (registered once, picked by the kernel per receive).
+    if (ring->isOpen()) receiveBuffers = std::make_unique<IoBufferRing>(*ring, 0, RING_BUFFERS, RING_BUFFER_BYTES);
+    // Both are needed.
+    if (!receiveBuffers || !receiveBuffers->isOpen()) {
+        // Drop the ring first (the buffers were lent to it).
+        ring.reset();
+        // Then the buffers.
+        receiveBuffers.reset();
+        // Fall back to epoll.
+        return false;
+    }
+    // Seconds of the tick timeout.
+    tickTimeout.tv_sec = settings.tickIntervalMs / 1000;
+    // And nanoseconds.
+    tickTimeout.tv_nsec = static_cast<long long>(settings.tickIntervalMs % 1000) * 1000000;
+    // Ready.
+    return true;
+}
+
+// Queues the multishot accept.
+void RespServer::armAccept() {
+    // Entry for it.
+    io_uring_sqe* sqe = ring->nextSqe();
+    // Queue full; retried when the next accept completion arrives.
+    if (sqe == nullptr) return;
+    // Accept...
+    sqe->opcode = IORING_OP_ACCEPT;
+    // ...on the listening socket...
+    sqe->fd = listenFd;
+    // ...with close-on-exec descriptors...
+    sqe->accept_flags = SOCK_CLOEXEC;
+    // ...one completion per connection until cancelled.
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    // Identify it.
+    sqe->user_data = ringTag(RingOp::Accept, listenFd, 0);
+}
+
+// Queues a connection's multishot receive.
+void RespServer::armReceive(Connection& connection) {
+    // Entry for it.
+    io_uring_sqe* sqe = ring->nextSqe();
+    // Queue full: the connection cannot be served.
+    if (sqe == nullptr) return closeClient(connection.fd);
+    // Receive...
+    sqe->opcode = IORING_OP_RECV;
+    // ...from the client...
+    sqe->fd = connection.fd;
+    // ...into whichever provided buffer is free...
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    // ...of the shared group...
+    sqe->buf_group = receiveBuffers->group();
+    // ...with one completion per arrival until the socket closes.
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    // Identify it.
+    sqe->user_data = ringTag(RingOp::Receive, connection.fd, connection.id);
+}
+
+// Queues the read of the wake-up eventfd.
+void RespServer::armWake() {
+    // Entry for it.
+    io_uring_sqe* sqe = ring->nextSqe();
+    // Queue full; stop() also sets the flag the loop checks every tick.
+    if (sqe == nullptr) return;
+    // Read...
+    sqe->opcode = IORING_OP_READ;
+    // ...the eventfd...
+    sqe->fd = wakeFd;
+    // ...counter.
+    sqe->addr = reinterpret_cast<uint64_t>(&wakeValue);
+    // Eight bytes.
+    sqe->len = sizeof(wakeValue);
+    // Identify it.
+    sqe->user_data = ringTag(RingOp::Wake, wakeFd, 0);
+}
+
+// Queues the tick timeout.
+void RespServer::armTick() {
+    // Entry for it.
+    io_uring_sqe* sqe = ring->nextSqe();
+    // Queue full; retried on the next completion of any kind.
+    if (sqe == nullptr) return;
+    // Timeout...
+    sqe->opcode = IORING_OP_TIMEOUT;
+    // ...of the tick interval...
+    sqe->addr = reinterpret_cast<uint64_t>(&tickTimeout);
+    // ...one timespec...
+    sqe->len = 1;
+    // ...that fires on time, not after a number of completions.
+    sqe->off = 0;
+    // Identify it.
+    sqe->user_data = ringTag(RingOp::Tick, -1, 0);
+}
+
+// Queues one sendmsg carrying a connection's output.
+void RespServer::queueSend(Connection& connection) {
+    // The send in flight requeues the connection when it completes.
+    if (connection.sendInFlight) return;
+    // Nothing to send: hang up if it asked to be closed.
+    if (!connection.hasOutput()) {
+        // After QUIT or a protocol error, once no reply waits on another core.
+        if (connection.closeAfterWrite && connection.waiting.empty()) closeClient(connection.fd);
+        // Done.
+        return;
+    }
+    // Entry for it.
+    io_uring_sqe* sqe = ring->nextSqe();
+    // Queue full: try again next iteration.
+    if (sqe == nullptr) return scheduleFlush(connection);
+    // Point at the unsent blocks; they stay untouched until the send completes.
+    connection.blocksInFlight = gatherOutput(connection, connection.sendVector);
+    // Message header.
+    connection.sendHeader = msghdr{};
+    // The blocks.
+    connection.sendHeader.msg_iov = connection.sendVector.data();
+    // How many.
+    connection.sendHeader.msg_iovlen = connection.sendVector.size();
+    // Gather send...
+    sqe->opcode = IORING_OP_SENDMSG;
+    // ...to the client...
+    sqe->fd = connection.fd;
+    // ...of the header...
+    sqe->addr = reinterpret_cast<uint64_t>(&connection.sendHeader);
+    // ...without SIGPIPE if it hung up.
+    sqe->msg_flags = MSG_NOSIGNAL;
+    // Identify it.
+    sqe->user_data = ringTag(RingOp::Send, connection.fd, connection.id);
+    // In flight.
+    connection.sendInFlight = true;
+    // Count it.
+    counters.writevCalls++;
+}
+
+// Handles one completion.
+void RespServer::handleCompletion(const io_uring_cqe& completion) {
+    // A receive buffer handed back; nothing to do.
+    if (completion.user_data == IoBufferRing::PROVIDE_TAG) return;
+    // Request kind.
+    RingOp op = static_cast<RingOp>(completion.user_data & 0xFF);
+    // Descriptor it was issued on.
+    int fd = static_cast<int>(completion.user_data >> 8 & 0xFFFFFF);
+    // Connection number it was issued for.
+    uint32_t id = static_cast<uint32_t>(completion.user_data >> 32);
+    // A multishot request stays armed while this is set.
+    bool more = (completion.flags & IORING_CQE_F_MORE) != 0;
+    // Dispatch on the kind.
+    switch (op) {
+    case RingOp::Accept:
+        // A new client: track it and start receiving.
+        if (completion.res >= 0) {
+            // Track it (or turn it away).
+            Connection* connection = addConnection(completion.res);
+            // Start receiving.
+            if (connection != nullptr) armReceive(*connection);
+        }
+        // The multishot accept ended (error or overflow): re-arm it.
+        if (!more) armAccept();
+        // Done.
+        return;
+    case RingOp::Wake:
+        // stop() set the flag (the loop ends after this iteration) or another core queued work: keep listening.
+        armWake();
+        // Done.
+        return;
+    case RingOp::Tick:
+        // Bound the next wait too.
+        armTick();
+        // Done.
+        return;
+    case RingOp::Receive: {
+        // Connection it was for (nullptr if closed since).
+        Connection* connection = findConnection(fd, id);
+        // Buffer the kernel filled, if any.
+        bool hasBuffer = (completion.flags & IORING_CQE_F_BUFFER) != 0;
+        // Its id.
+        uint16_t buffer = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+        // Requests arrived.
+        if (connection != nullptr && completion.res > 0 && hasBuffer) {
+            // Count it.
+            counters.reads++;
+            // Execute them straight from the buffer (a partial command is copied out).
+            processInput(*connection, std::string_view(receiveBuffers->buffer(buffer), static_cast<size_t>(completion.res)));
+        }
+        // The buffer is free again.
+        if (hasBuffer) receiveBuffers->recycle(buffer);
+        // Closed since.
+        if (connection == nullptr) return;
+        // The client hung up, or the socket failed (running out of buffers only pauses the receive).
+        if (completion.res == 0 || (completion.res < 0 && completion.res != -ENOBUFS)) return closeClient(fd);
+        // The multishot receive ended: re-arm it.
+        if (!more) armReceive(*connection);
+        // Done.
+        return;
+    }
+    case RingOp::Send: {
+        // Connection it was for (nullptr if closed since).
+        Connection* connection = findConnection(fd, id);
+        // Closed while sending: its blocks can be freed now.
+        if (connection == nullptr) {
+            // Free them.
+            retired.erase(id);
+            // Done.
+            return;
+        }
+        // No longer in flight.
+        connection->sendInFlight = false;
+        // Every block may be written again.
+        connection->blocksInFlight = 0;
+        // The client is gone.
+        if (completion.res < 0) return closeClient(fd);
+        // Drop what was sent.
+        consumeOutput(*connection, static_cast<size_t>(completion.res));
+        // The rest (or replies added meanwhile) goes out at the end of the iteration; closing waits for it.
+        if (connection->hasOutput() || connection->closeAfterWrite) scheduleFlush(*connection);
+        // Done.
+        return;
+    }
+    }
+}
+
+// Runs the io_uring event loop.
+void RespServer::runRing() {
+    // Connections sent to in an iteration.
+    std::vector<Connection*> sending;
+    // Requests that stay armed across iterations.
+    armAccept();
+    // Wake-up for stop().
+    armWake();
+    // Upper bound on each wait.
+    armTick();
+    // Until stop().
+    while (!stopping.load(std::memory_order_relaxed)) {
+        // Submit every request queued in the last iteration and wait for at least one completion, in one call
+        // (without waiting if other cores left work).
+        int submitted = ring->submit(waitTimeout() == 0 ? 0 : 1);
+        // Awake: peers need not write the eventfd until the next wait.
+        sleeping.store(false, std::memory_order_relaxed);
+        // Count it.
+        counters.ringSubmits++;
+        // Count the iteration.
+        counters.loopIterations++;
+        // The ring itself failed.
+        if (submitted < 0 && submitted != -EINTR && submitted != -EBUSY) break;
+        // Handle every completion that arrived.
+        while (io_uring_cqe* cqe = ring->peekCompletion()) {
+            // Copy it, so the slot can be handed back before the handler queues new requests.
+            io_uring_cqe completion = *cqe;
+            // Hand the slot back.
+            ring->advanceCompletion();
+            // Handle it.
+            handleCompletion(completion);
+        }
+        // Work other cores forwarded, and the results of what this core forwarded.
+        if (group != nullptr) drainPeers();
+        // Every write of the iteration becomes durable with one log sync, before any of them is acknowledged.
+        store.syncAppendLog(store.lastAppendLogSequence());
+        // Results and requests for other cores (after the sync, so a forwarded write is durable once answered).
+        if (group != nullptr) flushPeers();
+        // Take this iteration's list (closeClient edits flushList).
+        sending.swap(flushList);
+        // One gather send per connection, submitted with the next wait.
+        for (Connection* connection : sending) {
+            // No longer queued.
+            connection->pendingFlush = false;
+            // Queue its replies.
+            queueSend(*connection);
+        }
+        // Ready for the next iteration.
+        sending.clear();
+        // Background work: filter rebuild, expiry, finished saves and log rewrites.
+        store.tick();
+    }
+}
+#endif
+
+// Sends the parsed command, or its per-core shares, to the cores owning its keys.
+bool RespServer::route(Connection& connection) {
+    // Number of arguments, including the command name.
+    size_t argc = args.size();
+    // Command name as sent.
+    std::string_view name = args[0];
+    // Cores in the group.
+    uint32_t cores = static_cast<uint32_t>(group->coreCount());
+    // A single core owns every key.
+    if (cores == 1) return false;
+    // Commands on one key run on the key's owner.
+    if (argc >= 2 && (equalsIgnoreCase(name, "GET") || equalsIgnoreCase(name, "SET") || equalsIgnoreCase(name, "EXPIRE") ||
+                      equalsIgnoreCase(name, "PEXPIRE") || equalsIgnoreCase(name, "TTL") || equalsIgnoreCase(name, "PTTL") ||
+                      equalsIgnoreCase(name, "PERSIST"))) {
+        // Owner of the key.
+        uint32_t owner = group->ownerOf(Utils::hash64(args[1]));
+        // Ours: run it here.
+        if (owner == core) return false;
+        // The whole command, answered by the owner.
+        CoreMessage message;
+        // Answered into a pending reply.
+        address(message, connection, awaitParts(connection, CoreMessage::Kind::Command, 1), CoreMessage::Kind::Command);
+        // Its arguments.
+        message.args.assign(args.begin(), args.end());
+        // Send it.
+        sendToCore(owner, std::move(message));
+        // Forwarded.
+        return true;
+    }
+    // Multi-key commands split by owner.
+    bool multiGet = equalsIgnoreCase(name, "MGET");
+    // MSET pairs.
+    bool multiSet = equalsIgnoreCase(name, "MSET");
+    // DEL keys.
+    bool remove = equalsIgnoreCase(name, "DEL");
+    // EXISTS keys.
+    bool exists = equalsIgnoreCase(name, "EXISTS");
+    // A well-formed one (malformed ones get their error here).
+    if (((multiGet || remove || exists) && argc >= 2) || (multiSet && argc >= 3 && argc % 2 == 1)) {
+        // Its kind.
+        CoreMessage::Kind kind = multiGet ? CoreMessage::Kind::MultiGet : multiSet ? CoreMessage::Kind::MultiSet
+                               : remove ? CoreMessage::Kind::Delete : CoreMessage::Kind::Exists;
+        // Arguments per key.
+        size_t stride = multiSet ? 2 : 1;
+        // One empty share per core.
+        scatter.assign(cores, CoreMessage());
+        // Cores with a share.
+        unsigned parts = 0;
+        // Give each key to its owner.
+        for (size_t i = 1; i + stride <= argc; i += stride) {
+            // Owner's share.
+            CoreMessage& share = scatter[group->ownerOf(Utils::hash64(args[i]))];
+            // First key for it.
+            if (share.args.empty()) parts++;
+            // The key.
+            share.args.emplace_back(args[i]);
+            // Its value.
+            if (multiSet) share.args.emplace_back(args[i + 1]);
+            // Where its value goes in the reply.
+            if (multiGet) share.positions.push_back(static_cast<uint32_t>(i - 1));
+        }
+        // Every key is ours: run it here.
+        if (parts == 1 && !scatter[core].args.empty()) return false;
+        // Reply the shares merge into.
+        PendingReply& reply = awaitParts(connection, kind, parts);
+        // One value per key.
+        if (multiGet) reply.values.resize(argc - 1);
+        // Send the other cores' shares.
+        for (uint32_t target = 0; target < cores; ++target) {
+            // No keys there, or ours (done last).
+            if (scatter[target].args.empty() || target == core) continue;
+            // Answered into the pending reply.
+            address(scatter[target], connection, reply, kind);
+            // Send it.
+            sendToCore(target, std::move(scatter[target]));
+        }
+        // Our own share, if any, right away.
+        if (!scatter[core].args.empty()) {
+            // Answered into the pending reply.
+            address(scatter[core], connection, reply, kind);
+            // Do it.
+            serveMessage(scatter[core]);
+            // Merge it (other shares are still out, so the reply stays pending).
+            mergePart(reply, scatter[core]);
+        }
+        // Forwarded.
+        return true;
+    }
+    // Whole-store commands: every core answers for its partition.
+    bool size = equalsIgnoreCase(name, "DBSIZE");
+    // PREFIX prefix.
+    bool prefix = argc == 2 && equalsIgnoreCase(name, "PREFIX");
+    // Each core saves (or rewrites the log of) its own partition.
+    bool persist = equalsIgnoreCase(name, "SAVE") || equalsIgnoreCase(name, "BGSAVE") || equalsIgnoreCase(name, "BGREWRITEAOF");
+    // Anything else runs here.
+    if (!size && !prefix && !persist) return false;
+    // Its kind.
+    CoreMessage::Kind kind = size ? CoreMessage::Kind::Size : prefix ? CoreMessage::Kind::Prefix : CoreMessage::Kind::Command;
+    // Reply every core's part merges into.
+    PendingReply& reply = awaitParts(connection, kind, cores);
+    // Every core's part, ours last (serving a Command part reuses args).
+    for (uint32_t i = 1; i <= cores; ++i) {
+        // Cores after ours first, wrapping around to ours.
+        uint32_t target = (core + i) % cores;
+        // Its part.
+        CoreMessage message;
+        // Answered into the pending reply.
+        address(message, connection, reply, kind);
+        // The prefix.
+        if (prefix) message.args.emplace_back(args[1]);
+        // The whole command.
+        if (persist) message.args.assign(args.begin(), args.end());
+        // Send the others.
+        if (target != core) {
+            // Send it.
+            sendToCore(target, std::move(message));
+            // Next core.
+            continue;
+        }
+        // Do ours.
+        serveMessage(message);
+        // Merge it (the others are still out, so the reply stays pending).
+        mergePart(reply, message);
+    }
+    // Forwarded.
+    return true;
+}
+
+// Adds a pending reply expecting parts results.
+RespServer::PendingReply& RespServer::awaitParts(Connection& connection, CoreMessage::Kind kind, unsigned parts) {
+    // After every reply before it.
+    connection.waiting.emplace_back();
+    // The new reply.
+    PendingReply& reply = connection.waiting.back();
+    // How parts merge.
+    reply.kind = kind;
+    // Parts to wait for.
+    reply.partsLeft = parts;
+    // Hand it back (its address stays valid while it waits; the deque only grows at the back and pops at the front).
+    return reply;
+}
+
+// Fills in a message's routing to the pending reply.
+void RespServer::address(CoreMessage& message, Connection& connection, PendingReply& reply, CoreMessage::Kind kind) {
+    // Work.
+    message.kind = kind;
+    // Back to this core...
+    message.origin = core;
+    // ...for this connection...
+    message.fd = connection.fd;
+    // ...if it is still the same one...
+    message.connectionId = connection.id;
+    // ...into this reply.
+    message.slot = &reply;
+}
+
+// Does a message's work against the store.
+void RespServer::serveMessage(CoreMessage& message) {
+    // Dispatch on the kind.
+    switch (message.kind) {
+    case CoreMessage::Kind::Command:
+        // Parse-free: point the arguments at the message's copies.
+        args.assign(message.args.begin(), message.args.end());
+        // Run it; its reply travels back.
+        runCommand(message.reply);
+        // Done.
+        break;
+    case CoreMessage::Kind::MultiGet: {
+        // Batched lookup (values borrowed until the next store call).
+        std::vector<std::optional<std::string_view>> found = store.multiGet(message.args);
+        // One per key.
+        message.values.reserve(found.size());
+        // Copy each out; they cross to another core.
+        for (const std::optional<std::string_view>& value : found) {
+            // Owned copy, or null.
+            if (value) message.values.emplace_back(std::string(*value)); else message.values.emplace_back(std::nullopt);
+        }
+        // Done.
+        break;
+    }
+    case CoreMessage::Kind::MultiSet: {
+        // Pairs for the batched write.
+        std::vector<std::pair<std::string, std::string>> pairs;
+        // One per key.
+        pairs.reserve(message.args.size() / 2);
+        // Collect them.
+        for (size_t i = 0; i + 1 < message.args.size(); i += 2) pairs.emplace_back(std::move(message.args[i]), std::move(message.args[i + 1]));
+        // Write them together.
+        message.ok = store.multiSet(pairs);
+        // Done.
+        break;
+    }
+    case CoreMessage::Kind::Delete:
+        // Remove each key.
+        for (const std::string& key : message.args) message.count += store.remove(key, Utils::hash64(key)) ? 1 : 0;
+        // Done.
+        break;
+    case CoreMessage::Kind::Exists:
+        // Check each key (an expired key is reclaimed and not counted).
+        for (const std::string& key : message.args) message.count += store.getView(key) ? 1 : 0;
+        // Done.
+        break;
+    case CoreMessage::Kind::Size:
+        // Keys in this partition.
+        message.count = static_cast<int64_t>(store.size());
+        // Done.
+        break;
+    case CoreMessage::Kind::Prefix:
+        // Matches in this partition, sorted.
+        message.keys = store.prefixSearch(message.args[0]);
+        // Done.
+        break;
+    }
+    // The arguments need not travel back.
+    message.args.clear();
+}
+
+// Merges a part's result into its pending reply.
+void RespServer::mergePart(PendingReply& reply, CoreMessage& message) {
+    // Dispatch on the kind.
+    switch (reply.kind) {
+    case CoreMessage::Kind::Command:
+        // The first reply, unless a later part failed (one core's error stands for the command).
+        if (reply.reply.empty() || (!message.reply.empty() && message.reply[0] == '-' && reply.reply[0] != '-')) reply.reply = std::move(message.reply);
+        // Done.
+        break;
+    case CoreMessage::Kind::MultiGet:
+        // Put each value where its key was.
+        for (size_t i = 0; i < message.positions.size(); ++i) reply.values[message.positions[i]] = std::move(message.values[i]);
+        // Done.
+        break;
+    case CoreMessage::Kind::MultiSet:
+        // Every part must have been written.
+        reply.ok = reply.ok && message.ok;
+        // Done.
+        break;
+    case CoreMessage::Kind::Delete:
+    case CoreMessage::Kind::Exists:
+    case CoreMessage::Kind::Size:
+        // Sum the counts.
+        reply.count += message.count;
+        // Done.
+        break;
+    case CoreMessage::Kind::Prefix:
+        // Collect the matches.
+        reply.keys.insert(reply.keys.end(), std::make_move_iterator(message.keys.begin()), std::make_move_iterator(message.keys.end()));
+        // Done.
+        break;
+    }
+    // More parts to come.
+    if (--reply.partsLeft != 0) return;
+    // Last part: encode the reply.
+    switch (reply.kind) {
+    case CoreMessage::Kind::Command:
+        // Already encoded.
+        break;
+    case CoreMessage::Kind::MultiGet:
+        // One element per key.
+        Resp::appendArrayHeader(reply.reply, reply.values.size());
+        // Each value, or null.
+        for (const std::optional<std::string>& value : reply.values) {
+            // Copy it in.
+            if (value) Resp::appendBulkString(reply.reply, *value); else Resp::appendNull(reply.reply);
+        }
+        // Done.
+        break;
+    case CoreMessage::Kind::MultiSet:
+        // OK, or rejected by a partition's memory budget.
+        if (reply.ok) Resp::appendSimpleString(reply.reply, "OK"); else Resp::appendError(reply.reply, OOM_ERROR);
+        // Done.
+        break;
+    case CoreMessage::Kind::Delete:
+    case CoreMessage::Kind::Exists:
+    case CoreMessage::Kind::Size:
+        // The total.
+        Resp::appendInteger(reply.reply, reply.count);
+        // Done.
+        break;
+    case CoreMessage::Kind::Prefix:
+        // Each partition's matches were sorted; the union is sorted once.
+        std::sort(reply.keys.begin(), reply.keys.end());
+        // One element per key.
+        Resp::appendArrayHeader(reply.reply, reply.keys.size());
+        // Each key.
+        for (const std::string& key : reply.keys) Resp::appendBulkString(reply.reply, key);
+        // Done.
+        break;
+    }
+    // Free what was merged.
+    reply.values.clear();
+    // Including the matches.
+    reply.keys.clear();
+}
+
+// Moves completed pending replies, in order, to the output.
+void RespServer::releaseReplies(Connection& connection) {
+    // True once a reply moved.
+    bool released = false;
+    // Every complete reply at the front (a reply still waiting holds back the ones after it).
+    while (!connection.waiting.empty() && connection.waiting.front().partsLeft == 0) {
+        // Append it.
+        outputBlock(connection).append(connection.waiting.front().reply);
+        // Gone.
+        connection.waiting.pop_front();
+        // Something to send.
+        released = true;
+    }
+    // Sent at the end of the iteration.
+    if (released) scheduleFlush(connection);
+}
+
+// Queues a message for target.
+void RespServer::sendToCore(uint32_t target, CoreMessage&& message) {
+    // Work this core's clients asked for (the rest are results going back).
+    if (message.origin == core) counters.forwardedCommands++;
+    // Pushed after the iteration's log sync.
+    outbox[target].push_back(std::move(message));
+}
+
+// Serves requests from other cores and merges their results.
+void RespServer::drainPeers() {
+    // One batch at a time.
+    std::vector<CoreMessage> inbox;
+    // From every other core.
+    for (uint32_t from = 0; from < group->coreCount(); ++from) {
+        // Not from ourselves.
+        if (from == core) continue;
+        // Its queue to us.
+        PeerQueue& queue = group->queue(from, core);
+        // Every batch it sent.
+        while (queue.pop(inbox)) {
+            // Each message.
+            for (CoreMessage& message : inbox) {
+                // Work for a key this core owns: do it and send the result back.
+                if (message.origin != core) {
+                    // Do it.
+                    serveMessage(message);
+                    // Back to its origin.
+                    sendToCore(message.origin, std::move(message));
+                    // Next.
+                    continue;
+                }
+                // A result: the connection may have closed since.
+                Connection* connection = findConnection(message.fd, message.connectionId);
+                // Nobody to answer.
+                if (connection == nullptr) continue;
+                // Merge it.
+                mergePart(*static_cast<PendingReply*>(message.slot), message);
+                // Send whatever it completed.
+                releaseReplies(*connection);
+            }
+            // Ready for the next batch.
+            inbox.clear();
+        }
+    }
+}
+
+// Pushes every outbox onto its queue and wakes the targets.
+void RespServer::flushPeers() {
+    // Set again if a queue is full.
+    outboxWaiting = false;
+    // Every other core.
+    for (uint32_t target = 0; target < outbox.size(); ++target) {
+        // Nothing for it.
+        if (outbox[target].empty()) continue;
+        // Queue full: keep the messages (order is kept) and retry next iteration.
+        if (!group->queue(core, target).push(outbox[target])) {
+            // Do not sleep on it.
+            outboxWaiting = true;
+            // Next core.
+            continue;
+        }
+        // Moved out; start afresh.
+        outbox[target].clear();
+        // Wake it if it is waiting.
+        if (group->server(target).notify()) counters.peerWakeups++;
+    }
+}
+
+// Returns the next wait's timeout, announcing the sleep to peers.
+int RespServer::waitTimeout() {
+    // Serving alone: only clients and ticks wake the loop.
+    if (group == nullptr) return settings.tickIntervalMs;
+    // Peers that push from now on write the eventfd.
+    sleeping.store(true, std::memory_order_relaxed);
+    // Order the flag before the queue checks (pairs with the fence in notify).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // An outbox still waits for room.
+    bool ready = outboxWaiting;
+    // Or a peer pushed before the flag was up.
+    for (uint32_t from = 0; from < group->coreCount() && !ready; ++from) ready = from != core && !group->queue(from, core).empty();
+    // Nothing to do: sleep until a client, a peer or the tick.
+    if (!ready) return settings.tickIntervalMs;
+    // Not sleeping after all.
+    sleeping.store(false, std::memory_order_relaxed);
+    // Poll.
+    return 0;
+}
+
+// Wakes the loop if it is sleeping.
+bool RespServer::notify() {
+    // Order the caller's push before reading the flag (pairs with the fence in waitTimeout).
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Awake, or another peer already woke it.
+    if (!sleeping.load(std::memory_order_relaxed) || !sleeping.exchange(false)) return false;
+    // Bump the eventfd.
+    uint64_t one = 1;
+    // Wake it.
+    ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+    // The loop wakes either way.
+    (void)ignored;
+    // Had to.
+    return true;
+}
+
+// Asks run() to return.
+void RespServer::stop() {
+    // Seen at the end of the current iteration.
+    stopping.store(true, std::memory_order_relaxed);
+    // Wake a loop sleeping in epoll_wait (write is async-signal-safe).
+    uint64_t one = 1;
+    // Bump the counter.
+    ssize_t ignored = ::write(wakeFd, &one, sizeof(one));
+    // Nothing to do if the loop is already awake.
+    (void)ignored;
+}
+
+// Returns the server's counters.
+ServerStats RespServer::stats() const {
+    // Copy the counters.
+    ServerStats result = counters;
+    // Backend in use.
+    result.backend = activeBackend;
+    // Open connections.
+    result.connectedClients = connections.size();
+    // Report.
+    return result;
+}
@@ -0,0 +1,163 @@
+#include "../include/kv_store.hpp"
+#include "../include/resp_server.hpp"
+#include "../include/core_server.hpp"
+#include <iostream>
+#include <string>
+#include <csignal> // For SIGINT, SIGTERM
+#include <cstdlib> // For std::strtoul
+
+// Append-only log used with --appendonly (in the working directory).
+constexpr const char* APPEND_LOG_PATH = "appendonly.aof";
+
+// Server stopped by SIGINT / SIGTERM.
+RespServer* activeServer = nullptr;
+// Thread-per-core server stopped by SIGINT / SIGTERM.
+CoreServer* activeCores = nullptr;
+
+// Signal handler: asks the event loop(s) to return.
+void handleShutdownSignal(int) {
+    // stop() only sets a flag and writes to an eventfd, both async-signal-safe.
+    if (activeServer) activeServer->stop();
+    // Every core's loop likewise.
+    if (activeCores) activeCores->stop();
+}
+
+// Prints the command line and fails.
+int usage() {
+    // Options.
+    std::cerr << "Usage: kv_store_server [--port <n>] [--bind <address>] [--appendonly [always|everysec|no]] [--io-uring] [--cores <n>]" << std::endl;
+    // Failure status.
+    return 1;
+}
+
+// Runs a thread-per-core server until stopped; each core restores its own partition.
+int runCores(size_t cores, const KVStoreConfig& storeConfig, const ServerConfig& serverConfig) {
+    // Partitions (replaying their logs, if enabled) and their loops.
+    CoreServer server(cores, storeConfig, serverConfig);
+    // Restore each core's last snapshot when there is no log.
+    for (size_t i = 0; i < server.coreCount() && storeConfig.appendLogPath.empty(); ++i) {
+        // Missing files are skipped.
+        server.partition(i).load(serverConfig.snapshotPath + "." + std::to_string(i));
+    }
+    // Keys restored.
+    size_t keys = 0;
+    // Sum the partitions.
+    for (size_t i = 0; i < server.coreCount(); ++i) keys += server.partition(i).size();
+    // Report what came back.
+    if (keys != 0) std::cout << "Restored " << keys << " keys across " << server.coreCount() << " partitions." << std::endl;
+    // Bind and listen on every core.
+    if (!server.start()) {
+        // Nothing to serve on.
+        std::cerr << "Could not listen on " << serverConfig.bindAddress << ":" << serverConfig.port << std::endl;
+        // Fail.
+        return 1;
+    }
+    // Stop cleanly on Ctrl+C or kill.
+    activeCores = &server;
+    // Interrupt.
+    std::signal(SIGINT, handleShutdownSignal);
+    // Termination.
+    std::signal(SIGTERM, handleShutdownSignal);
+    // Announce it.
+    std::cout << "Ready to accept connections on " << serverConfig.bindAddress << ":" << server.port() << " ("
+              << server.coreCount() << " cores)" << std::endl;
+    // Serve until stopped.
+    server.run();
+    // No more signals for it.
+    activeCores = nullptr;
+    // Report the session.
+    ServerStats stats = server.stats();
+    // Figures.
+    std::cout << "Shutting down after " << stats.commandsProcessed << " commands from " << stats.connectionsAccepted
+              << " connections (" << stats.forwardedCommands << " forwarded between cores)." << std::endl;
+    // Success.
+    return 0;
+}
+
+// Main function for the network server.
+int main(int argc, char** argv) {
+    // Store settings.
+    KVStoreConfig storeConfig;
+    // Server settings.
+    ServerConfig serverConfig;
+    // Event loops (1: a single RespServer; more, or 0 for one per hardware thread: a thread-per-core CoreServer).
+    size_t cores = 1;
+    // Parse the options.
+    for (int i = 1; i < argc; ++i) {
+        // Current option.
+        std::string option = argv[i];
+        // Port to listen on.
+        if (option == "--port" && i + 1 < argc) {
+            // Parse it.
+            serverConfig.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        // Address to listen on.
+        } else if (option == "--bind" && i + 1 < argc) {
+            // Keep it.
+            serverConfig.bindAddress = argv[++i];
+        // Log every write.
+        } else if (option == "--appendonly") {
+            // Log file.
+            storeConfig.appendLogPath = APPEND_LOG_PATH;
+            // Fsync policy (everysec by default).
+            std::string policy = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : "everysec";
+            // Map it.
+            storeConfig.appendFsync = policy == "always" ? AppendFsync::Always : policy == "no" ? AppendFsync::No : AppendFsync::EverySec;
+            // The event loop syncs once per iteration, before any reply is sent, instead of once per write.
+            storeConfig.appendLogDeferSync = true;
+        // One event loop and partition per core.
+        } else if (option == "--cores" && i + 1 < argc) {
+            // Parse it.
+            cores = static_cast<size_t>(std::strtoul(argv[++i], nullptr, 10));
+        // Completion-based event loop (falls back to epoll where unavailable).
+        } else if (option == "--io-uring") {
+            // Ask for it.
+            serverConfig.backend = ServerBackend::IoUring;
+        } else {
+            // Unknown option.
+            return usage();
+        }
+    }
+    // Thread-per-core mode.
+    if (cores != 1) return runCores(cores, storeConfig, serverConfig);
+    // Create the store (replaying the log, if enabled).
+    KVStore store(storeConfig);
+    // The log is more recent than any snapshot, so it alone is the source of truth when enabled.
+    if (!storeConfig.appendLogPath.empty()) {
+        // Report what came back.
+        std::cout << "Replayed " << store.appendLogStats().replayedRecords << " records from " << APPEND_LOG_PATH << " ("
+                  << store.size() << " keys)." << std::endl;
+    // Restore the last snapshot, if there is one.
+    } else if (store.load(serverConfig.snapshotPath)) {
+        // Report what came back.
+        std::cout << "Loaded " << store.size() << " keys from " << serverConfig.snapshotPath << "." << std::endl;
+    }
+    // The server.
+    RespServer server(store, serverConfig);
+    // Bind and listen.
+    if (!server.start()) {
+        // Nothing to serve on.
+        std::cerr << "Could not listen on " << serverConfig.bindAddress << ":" << serverConfig.port << std::endl;
+        // Fail.
+        return 1;
+    }
+    // Stop cleanly on Ctrl+C or kill.
+    activeServer = &server;
+    // Interrupt.
+    std::signal(SIGINT, handleShutdownSignal);
+    // Termination.
+    std::signal(SIGTERM, handleShutdownSignal);
+    // Announce it.
+    std::cout << "Ready to accept connections on " << serverConfig.bindAddress << ":" << server.port() << " ("
+              << (server.stats().backend == ServerBackend::IoUring ? "io_uring" : "epoll") << ")" << std::endl;
+    // Serve until stopped.
+    server.run();
+    // No more signals for it.
+    activeServer = nullptr;
+    // Report the session.
+    ServerStats stats = server.stats();
+    // Figures.
+    std::cout << "Shutting down after " << stats.commandsProcessed << " commands from " << stats.connectionsAccepted
+              << " connections (" << stats.writevCalls << " gather writes)." << std::endl;
+    // Success.
+    return 0;
+}
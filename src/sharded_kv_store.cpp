@@ -0,0 +1,348 @@
+#include "../include/sharded_kv_store.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <algorithm> // For std::merge
+#include <iterator> // For std::back_inserter
+#include <mutex> // For std::unique_lock
+#include <thread> // For std::thread::hardware_concurrency
+
+// Constructor: creates the shards.
+ShardedKVStore::ShardedKVStore(size_t numShards, const KVStoreConfig& perShardConfig) {
+    // Default to one shard per hardware thread.
+    if (numShards == 0) {
+        // hardware_concurrency may report 0 when unknown.
+        numShards = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+    // Reserve the shard table.
+    shards.reserve(numShards);
+    // Each shard's configuration (only the append log differs between shards).
+    KVStoreConfig shardConfig = perShardConfig;
+    // Writers sync the log after releasing the shard lock, so concurrent writers share an fdatasync.
+    shardConfig.appendLogDeferSync = true;
+    // Create each shard with its own independent data structures.
+    for (size_t i = 0; i < numShards; ++i) {
+        // Each shard logs to (and replays) its own file.
+        if (!perShardConfig.appendLogPath.empty()) shardConfig.appendLogPath = perShardConfig.appendLogPath + "." + std::to_string(i);
+        // Aligned allocation keeps every shard on its own cache lines.
+        shards.push_back(std::make_unique<Shard>(shardConfig));
+    }
+}
+
+// Returns the shard responsible for a key.
+ShardedKVStore::Shard& ShardedKVStore::shardFor(uint64_t hashCode) const {
+    // Use the high bits: the shard's HashMap indexes with the low ones, so the choices stay independent.
+    uint64_t high = hashCode >> 32;
+    // Map the 32 high bits onto [0, shards) with a multiply instead of a modulo.
+    return *shards[static_cast<size_t>((high * shards.size()) >> 32)];
+}
+
+// Sets (inserts or updates) a key-value pair.
+bool ShardedKVStore::set(const std::string& key, const std::string& value) {
+    // Hash the key once; the shard choice and every structure inside the shard reuse it.
+    uint64_t hashCode = Utils::hash64(key);
+    // Find the owning shard.
+    Shard& shard = shardFor(hashCode);
+    // Whether the write went through.
+    bool written;
+    // Position of its log record.
+    uint64_t sequence;
+    // Writers take the shard exclusively.
+    {
+        // Held for the write only.
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        // Apply the write (the shard's own memory budget may reject it).
+        written = shard.store.set(key, value, hashCode);
+        // Its record.
+        sequence = shard.store.lastAppendLogSequence();
+    }
+    // Wait for the log outside the lock, alongside the shard's other writers.
+    shard.store.syncAppendLog(sequence);
+    // Report whether it went through.
+    return written;
+}
+
+// Gets a copy of the value for a key.
+std::optional<std::string> ShardedKVStore::get(std::string_view key) const {
+    // Hash the key once; the shard choice and every structure inside the shard reuse it.
+    uint64_t hashCode = Utils::hash64(key);
+    // Find the owning shard.
+    Shard& shard = shardFor(hashCode);
+    // Readers share the shard.
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    // Read without mutating the shard (no cache splice, no resize step).
+    std::optional<std::string_view> value = shard.store.peek(key, hashCode);
+    // Copy the value out before the lock is released.
+    return value ? std::optional<std::string>(std::string(*value)) : std::nullopt;
+}
+
+// Deletes a key.
+bool ShardedKVStore::remove(const std::string& key) {
+    // Hash the key once; the shard choice and every structure inside the shard reuse it.
+    uint64_t hashCode = Utils::hash64(key);
+    // Find the owning shard.
+    Shard& shard = shardFor(hashCode);
+    // Whether the key was present.
+    bool removed;
+    // Position of its log record.
+    uint64_t sequence;
+    // Writers take the shard exclusively.
+    {
+        // Held for the delete only.
+        std::unique_lock<std::shared_mutex> guard(shard.lock);
+        // Apply the delete.
+        removed = shard.store.remove(key, hashCode);
+        // Its record.
+        sequence = shard.store.lastAppendLogSequence();
+    }
+    // Wait for the log outside the lock, alongside the shard's other writers.
+    shard.store.syncAppendLog(sequence);
+    // Report whether it was present.
+    return removed;
+}
+
+// Retrieves all keys starting with the given prefix from every shard, merged in sorted order.
+std::vector<std::string> ShardedKVStore::prefixSearch(const std::string& prefix) const {
+    // Merged result so far.
+    std::vector<std::string> result;
+    // Fan out to every shard.
+    for (const auto& shard : shards) {
+        // Keys from this shard (already sorted, since the Trie walks children in order).
+        std::vector<std::string> shardKeys;
+        // Scope the shared lock to the trie walk.
+        {
+            // Readers share the shard.
+            std::shared_lock<std::shared_mutex> guard(shard->lock);
+            // Collect this shard's matches.
+            shardKeys = shard->store.prefixSearch(prefix);
+        }
+        // Merge buffer.
+        std::vector<std::string> merged;
+        // Room for both inputs.
+        merged.reserve(result.size() + shardKeys.size());
+        // Merge the two sorted runs, moving strings instead of copying them.
+        std::merge(std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()),
+                   std::make_move_iterator(shardKeys.begin()), std::make_move_iterator(shardKeys.end()),
+                   std::back_inserter(merged));
+        // Keep the merged run.
+        result.swap(merged);
+    }
+    // Return the merged keys.
+    return result;
+}
+
+// Returns up to limit key-value pairs with keys in [start, end) from every shard, merged in ascending key order.
+std::vector<std::pair<std::string, std::string>> ShardedKVStore::scanRange(const std::string& start, const std::optional<std::string>& end,
+                                                                           size_t limit) const {
+    // Merged result so far.
+    std::vector<std::pair<std::string, std::string>> result;
+    // Fan out to every shard.
+    for (const auto& shard : shards) {
+        // This shard's first limit pairs (no more can make the merged first limit).
+        std::vector<std::pair<std::string, std::string>> shardPairs;
+        // Scope the shared lock to the scan.
+        {
+            // Readers share the shard.
+            std::shared_lock<std::shared_mutex> guard(shard->lock);
+            // Walk its ordered index.
+            shardPairs = shard->store.scanRange(start, end, limit);
+        }
+        // Merge buffer.
+        std::vector<std::pair<std::string, std::string>> merged;
+        // Room for both inputs.
+        merged.reserve(result.size() + shardPairs.size());
+        // Merge the two sorted runs by key (keys are unique across shards).
+        std::merge(std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()),
+                   std::make_move_iterator(shardPairs.begin()), std::make_move_iterator(shardPairs.end()),
+                   std::back_inserter(merged));
+        // Keep only the first limit.
+        if (merged.size() > limit) merged.resize(limit);
+        // Keep the merged run.
+        result.swap(merged);
+    }
+    // Return the pairs.
+    return result;
+}
+
+// Opens a snapshot of every shard at one instant.
+std::vector<KVSnapshot> ShardedKVStore::snapshotAll() const {
+    // Every shard's lock, taken in shard order.
+    std::vector<std::unique_lock<std::shared_mutex>> guards;
+    // Room for them.
+    guards.reserve(shards.size());
+    // Hold them all, so no write lands between two shards' snapshots.
+    for (const auto& shard : shards) guards.emplace_back(shard->lock);
+    // One snapshot per shard.
+    std::vector<KVSnapshot> snapshots;
+    // Room for them.
+    snapshots.reserve(shards.size());
+    // Open each (only records a version).
+    for (const auto& shard : shards) snapshots.push_back(shard->store.snapshot());
+    // The locks drop here.
+    return snapshots;
+}
+
+// Releases snapshots taken by snapshotAll.
+void ShardedKVStore::releaseAll(std::vector<KVSnapshot>& snapshots) const {
+    // Each releases into its own shard.
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        // Releasing may drop kept versions, which is a write.
+        std::unique_lock<std::shared_mutex> guard(shards[i]->lock);
+        // Release it.
+        snapshots[i].release();
+    }
+}
+
+// Returns every key-value pair whose key starts with prefix as of one instant.
+std::vector<std::pair<std::string, std::string>> ShardedKVStore::prefixScan(const std::string& prefix) const {
+    // The instant.
+    std::vector<KVSnapshot> snapshots = snapshotAll();
+    // Merged result so far.
+    std::vector<std::pair<std::string, std::string>> result;
+    // Read each shard.
+    for (size_t i = 0; i < shards.size(); ++i) {
+        // This shard's pairs, in key order.
+        std::vector<std::pair<std::string, std::string>> shardPairs;
+        // Last key read, where the next page resumes.
+        std::optional<std::string> after;
+        // A page at a time.
+        while (true) {
+            // This page.
+            std::vector<SnapshotEntry> page;
+            // Scope the shared lock to one page.
+            {
+                // Readers share the shard.
+                std::shared_lock<std::shared_mutex> guard(shards[i]->lock);
+                // Read it from the snapshot.
+                page = snapshots[i].entries(prefix, after, SCAN_PAGE_SIZE);
+            }
+            // Keep its pairs.
+            for (SnapshotEntry& entry : page) shardPairs.emplace_back(std::move(entry.key), std::move(entry.value));
+            // A short page is the last.
+            if (page.size() < SCAN_PAGE_SIZE) break;
+            // Resume after its last key.
+            after = shardPairs.back().first;
+        }
+        // Merge buffer.
+        std::vector<std::pair<std::string, std::string>> merged;
+        // Room for both inputs.
+        merged.reserve(result.size() + shardPairs.size());
+        // Merge the two sorted runs by key (keys are unique across shards).
+        std::merge(std::make_move_iterator(result.begin()), std::make_move_iterator(result.end()),
+                   std::make_move_iterator(shardPairs.begin()), std::make_move_iterator(shardPairs.end()),
+                   std::back_inserter(merged));
+        // Keep the merged run.
+        result.swap(merged);
+    }
+    // Let the shards drop the versions kept for the scan.
+    releaseAll(snapshots);
+    // Return the pairs.
+    return result;
+}
+
+// Writes every shard as of one instant to its own snapshot file.
+bool ShardedKVStore::save(const std::string& pathPrefix) const {
+    // The instant.
+    std::vector<KVSnapshot> snapshots = snapshotAll();
+    // Whether every file was written.
+    bool ok = true;
+    // Write each shard.
+    for (size_t i = 0; i < shards.size(); ++i) {
+        // Streams the file and renames it into place on commit.
+        SnapshotWriter writer(pathPrefix + "." + std::to_string(i));
+        // Deadlines go after every entry.
+        std::vector<std::pair<std::string, uint64_t>> deadlines;
+        // Last key written, where the next page resumes.
+        std::optional<std::string> after;
+        // A page at a time.
+        while (true) {
+            // This page.
+            std::vector<SnapshotEntry> page;
+            // Scope the shared lock to one page.
+            {
+                // Readers share the shard.
+                std::shared_lock<std::shared_mutex> guard(shards[i]->lock);
+                // Read it from the snapshot.
+                page = snapshots[i].entries("", after, SCAN_PAGE_SIZE);
+            }
+            // Write it outside the lock.
+            for (const SnapshotEntry& entry : page) {
+                // The pair.
+                writer.addEntry(entry.key, entry.value);
+                // Remember the deadline.
+                if (entry.deadline != 0) deadlines.emplace_back(entry.key, entry.deadline);
+            }
+            // A short page is the last.
+            if (page.size() < SCAN_PAGE_SIZE) break;
+            // Resume after its last key.
+            after = page.back().key;
+        }
+        // Then every deadline.
+        for (const std::pair<std::string, uint64_t>& deadline : deadlines) writer.addDeadline(deadline.first, deadline.second);
+        // Footer, sync and rename.
+        if (!writer.commit()) ok = false;
+    }
+    // Let the shards drop the versions kept for the save.
+    releaseAll(snapshots);
+    // Report it.
+    return ok;
+}
+
+// Loads every shard from its own snapshot file.
+bool ShardedKVStore::load(const std::string& pathPrefix) {
+    // Whether every shard loaded.
+    bool ok = true;
+    // Load each.
+    for (size_t i = 0; i < shards.size(); ++i) {
+        // Loading writes the shard.
+        std::unique_lock<std::shared_mutex> guard(shards[i]->lock);
+        // Its file.
+        if (!shards[i]->store.load(pathPrefix + "." + std::to_string(i))) ok = false;
+    }
+    // Report it.
+    return ok;
+}
+
+// Checks if a key might exist using the owning shard's Bloom Filter.
+bool ShardedKVStore::mightContain(std::string_view key) const {
+    // Find the owning shard.
+    Shard& shard = shardFor(Utils::hash64(key));
+    // Readers share the shard.
+    std::shared_lock<std::shared_mutex> guard(shard.lock);
+    // Query the shard's filter.
+    return shard.store.mightContain(key);
+}
+
+// Returns the total number of keys across all shards.
+size_t ShardedKVStore::size() const {
+    // Running total.
+    size_t total = 0;
+    // Sum every shard's count.
+    for (const auto& shard : shards) {
+        // Readers share the shard.
+        std::shared_lock<std::shared_mutex> guard(shard->lock);
+        // Add this shard's keys.
+        total += shard->store.size();
+    }
+    // Return the total.
+    return total;
+}
+
+// Returns every shard's metrics merged.
+MetricsSnapshot ShardedKVStore::metrics() const {
+    // Running total.
+    MetricsSnapshot total;
+    // Merge every shard's figures.
+    for (const auto& shard : shards) {
+        // Readers share the shard (the probe sample and node count read its structures).
+        std::shared_lock<std::shared_mutex> guard(shard->lock);
+        // Add this shard's.
+        total.merge(shard->store.metrics());
+    }
+    // Return the total.
+    return total;
+}
+
+// Returns the number of shards.
+size_t ShardedKVStore::shardCount() const {
+    // One entry per shard.
+    return shards.size();
+}
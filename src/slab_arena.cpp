@@ -0,0 +1,291 @@
+#include "../include/slab_arena.hpp"
+#include <cstring> // For std::memcpy
+
+namespace {
+    // Returns the number of bytes a LEB128 varint needs for value.
+    inline size_t varintSize(size_t value) {
+        // At least one byte.
+        size_t bytes = 1;
+        // One more byte per additional 7 bits.
+        while (value >= 0x80) {
+            // Drop 7 bits.
+            value >>= 7;
+            // Count the byte.
+            bytes++;
+        }
+        // Return the byte count.
+        return bytes;
+    }
+
+    // Writes value as a LEB128 varint and returns the position after it.
+    inline char* writeVarint(char* out, size_t value) {
+        // Emit 7 bits at a time with a continuation flag.
+        while (value >= 0x80) {
+            // Low 7 bits plus continuation bit.
+            *out++ = static_cast<char>((value & 0x7F) | 0x80);
+            // Drop the bits just written.
+            value >>= 7;
+        }
+        // Final byte without continuation bit.
+        *out++ = static_cast<char>(value);
+        // Return the position after the varint.
+        return out;
+    }
+
+    // Reads a LEB128 varint and returns the position after it.
+    inline const char* readVarint(const char* in, size_t& value) {
+        // Accumulated value.
+        value = 0;
+        // Bit position of the next group.
+        unsigned shift = 0;
+        // Read groups until one lacks the continuation bit.
+        while (true) {
+            // Current byte.
+            unsigned char byte = static_cast<unsigned char>(*in++);
+            // Merge its 7 payload bits.
+            value |= static_cast<size_t>(byte & 0x7F) << shift;
+            // Stop at the last byte.
+            if ((byte & 0x80) == 0) break;
+            // Next group.
+            shift += 7;
+        }
+        // Return the position after the varint.
+        return in;
+    }
+}
+
+// Out-of-line definition of the size class table.
+constexpr size_t SlabArena::CLASS_SIZES[SlabArena::NUM_CLASSES];
+
+// Constructor: creates an empty arena.
+SlabArena::SlabArena() : liveRecords(0), payloadBytes(0), largeBytes(0) {}
+
+// Destructor: releases every page. Oversized records must already have been deallocated by their owner.
+SlabArena::~SlabArena() {
+    // Free each slab page.
+    for (char* page : pages) {
+        // Pages were allocated as char arrays.
+        delete[] page;
+    }
+}
+
+// Returns the size class for a record of the given size.
+size_t SlabArena::classFor(size_t recordSize) {
+    // Linear scan of a short, cache-resident table.
+    for (size_t i = 0; i < NUM_CLASSES; ++i) {
+        // First class large enough wins.
+        if (recordSize <= CLASS_SIZES[i]) return i;
+    }
+    // Oversized record.
+    return NUM_CLASSES;
+}
+
+// Returns the size of a record holding key and value.
+size_t SlabArena::sizeFor(std::string_view key, std::string_view value) {
+    // Two varint lengths plus the bytes themselves.
+    return varintSize(key.size()) + varintSize(value.size()) + key.size() + value.size();
+}
+
+// Returns the total size (header + key + value) of an existing record.
+size_t SlabArena::recordSize(const char* record) {
+    // Key length.
+    size_t keyLength;
+    // Value length.
+    size_t valueLength;
+    // Decode both lengths.
+    const char* data = readVarint(readVarint(record, keyLength), valueLength);
+    // Header bytes plus payload.
+    return static_cast<size_t>(data - record) + keyLength + valueLength;
+}
+
+// Writes the header, key and value into a record.
+void SlabArena::writeRecord(char* record, std::string_view key, std::string_view value) {
+    // Key length, then value length.
+    char* out = writeVarint(writeVarint(record, key.size()), value.size());
+    // Key bytes (a rewrite in place keeps the key where it already is).
+    if (out != key.data()) std::memcpy(out, key.data(), key.size());
+    // Value bytes follow the key (memmove: the new value may alias the old one).
+    std::memmove(out + key.size(), value.data(), value.size());
+}
+
+// Hands out one slot of the given class.
+char* SlabArena::allocateSlot(size_t classIndex) {
+    // State of the class.
+    SizeClass& sizeClass = classes[classIndex];
+    // Count the slot.
+    sizeClass.usedSlots++;
+    // Reuse a freed slot first.
+    if (sizeClass.freeList != nullptr) {
+        // Pop the head of the free list.
+        char* slot = sizeClass.freeList;
+        // The next pointer is stored in the slot itself.
+        std::memcpy(&sizeClass.freeList, slot, sizeof(char*));
+        // Return the recycled slot.
+        return slot;
+    }
+    // Slot size of this class.
+    size_t slotSize = CLASS_SIZES[classIndex];
+    // Start a new page when the current one is exhausted.
+    if (sizeClass.bumpPtr == nullptr || sizeClass.bumpPtr + slotSize > sizeClass.bumpEnd) {
+        // Allocate the page.
+        char* page = new char[PAGE_SIZE];
+        // Remember it for the destructor and the stats.
+        pages.push_back(page);
+        // Carve from the start.
+        sizeClass.bumpPtr = page;
+        // Up to the end of the page.
+        sizeClass.bumpEnd = page + PAGE_SIZE;
+    }
+    // Take the next slot.
+    char* slot = sizeClass.bumpPtr;
+    // Advance the bump pointer.
+    sizeClass.bumpPtr += slotSize;
+    // Return the fresh slot.
+    return slot;
+}
+
+// Allocates a record holding copies of key and value.
+char* SlabArena::allocate(std::string_view key, std::string_view value) {
+    // Bytes needed.
+    size_t size = sizeFor(key, value);
+    // Pick the size class.
+    size_t classIndex = classFor(size);
+    // The record's storage.
+    char* record;
+    // Small and medium records come from a slab.
+    if (classIndex < NUM_CLASSES) {
+        // Take a slot.
+        record = allocateSlot(classIndex);
+    } else {
+        // Oversized records get their own allocation.
+        record = new char[size];
+        // Track them separately.
+        largeBytes += size;
+    }
+    // Fill in the header and bytes.
+    writeRecord(record, key, value);
+    // One more live record.
+    liveRecords++;
+    // Account for its payload.
+    payloadBytes += size;
+    // Return the record.
+    return record;
+}
+
+// Replaces a record's value.
+char* SlabArena::reassign(char* record, std::string_view value) {
+    // Current size, for the accounting.
+    size_t oldSize = recordSize(record);
+    // Current key.
+    std::string_view oldKey = key(record);
+    // Size with the new value.
+    size_t newSize = sizeFor(oldKey, value);
+    // Current class.
+    size_t oldClass = classFor(oldSize);
+    // A slab record that stays in the same size class (and whose key does not shift) is rewritten in place;
+    // the class is derived from the size on free, so it must not change.
+    if (oldClass < NUM_CLASSES && classFor(newSize) == oldClass &&
+        varintSize(value.size()) == varintSize(this->value(record).size())) {
+        // Key stays put; only the value length and bytes change.
+        writeRecord(record, oldKey, value);
+        // Update the payload accounting.
+        payloadBytes = payloadBytes - oldSize + newSize;
+        // Same record.
+        return record;
+    }
+    // Otherwise allocate a new record with the same key.
+    char* moved = allocate(oldKey, value);
+    // And release the old one.
+    deallocate(record);
+    // Return the new record.
+    return moved;
+}
+
+// Frees a record.
+void SlabArena::deallocate(char* record) {
+    // Size of the record.
+    size_t size = recordSize(record);
+    // Its class.
+    size_t classIndex = classFor(size);
+    // One fewer live record.
+    liveRecords--;
+    // Release its payload from the accounting.
+    payloadBytes -= size;
+    // Oversized records are freed directly.
+    if (classIndex == NUM_CLASSES) {
+        // Release the tracking.
+        largeBytes -= size;
+        // Free the allocation.
+        delete[] record;
+        // Done.
+        return;
+    }
+    // State of the class.
+    SizeClass& sizeClass = classes[classIndex];
+    // Link the slot in front of the free list.
+    std::memcpy(record, &sizeClass.freeList, sizeof(char*));
+    // The slot becomes the new head.
+    sizeClass.freeList = record;
+    // Count the slot as free.
+    sizeClass.usedSlots--;
+}
+
+// Returns a view of a record's key.
+std::string_view SlabArena::key(const char* record) {
+    // Key length.
+    size_t keyLength;
+    // Value length (needed to skip the header).
+    size_t valueLength;
+    // Decode the header.
+    const char* data = readVarint(readVarint(record, keyLength), valueLength);
+    // The key starts right after the header.
+    return std::string_view(data, keyLength);
+}
+
+// Returns a view of a record's value.
+std::string_view SlabArena::value(const char* record) {
+    // Key length.
+    size_t keyLength;
+    // Value length.
+    size_t valueLength;
+    // Decode the header.
+    const char* data = readVarint(readVarint(record, keyLength), valueLength);
+    // The value follows the key.
+    return std::string_view(data + keyLength, valueLength);
+}
+
+// Returns the number of bytes reserved for a record.
+size_t SlabArena::footprint(const char* record) {
+    // Size of the record.
+    size_t size = recordSize(record);
+    // Its class.
+    size_t classIndex = classFor(size);
+    // Slot size, or the exact size of an oversized allocation.
+    return classIndex < NUM_CLASSES ? CLASS_SIZES[classIndex] : size;
+}
+
+// Returns current usage and fragmentation figures.
+ArenaStats SlabArena::stats() const {
+    // Report being filled.
+    ArenaStats result;
+    // Live record count.
+    result.liveRecords = liveRecords;
+    // Payload bytes.
+    result.payloadBytes = payloadBytes;
+    // Oversized bytes.
+    result.largeBytes = largeBytes;
+    // Slot bytes in use, summed per class.
+    for (size_t i = 0; i < NUM_CLASSES; ++i) {
+        // Slots in use times the class slot size.
+        result.slotBytes += classes[i].usedSlots * CLASS_SIZES[i];
+    }
+    // Oversized records occupy exactly their own size.
+    result.slotBytes += largeBytes;
+    // Every page plus every oversized record.
+    result.reservedBytes = pages.size() * PAGE_SIZE + largeBytes;
+    // Share of reserved bytes not holding payload.
+    result.fragmentation = result.reservedBytes == 0 ? 0.0
+        : 1.0 - static_cast<double>(payloadBytes) / static_cast<double>(result.reservedBytes);
+    // Return the report.
+    return result;
+}
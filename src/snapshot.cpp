@@ -0,0 +1,421 @@
+#include "../include/snapshot.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <algorithm> // For std::min
+#include <cstring> // For std::memcpy, std::memcmp
+#include <fcntl.h> // For open
+#include <unistd.h> // For write, fsync, close, unlink
+#include <sys/mman.h> // For mmap
+#include <sys/stat.h> // For fstat
+#include <cstdio> // For std::rename
+
+namespace {
+    // File signature.
+    constexpr char MAGIC[8] = {'K', 'V', 'S', 'N', 'A', 'P', '\0', '\1'};
+    // Header bytes: magic, version, reserved.
+    constexpr size_t HEADER_SIZE = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+    // Footer bytes: entry count, deadline count, checksum.
+    constexpr size_t FOOTER_SIZE = 3 * sizeof(uint64_t);
+    // Longest LEB128 encoding of a 64-bit value.
+    constexpr size_t MAX_VARINT_BYTES = 10;
+
+    // Folds one block's hash into the running checksum (order-sensitive).
+    uint64_t foldChecksum(uint64_t checksum, std::string_view block) {
+        // Add, then multiply by an odd constant so swapped blocks change the result.
+        return (checksum + Utils::hash64(block)) * 0x9E3779B97F4A7C15ULL;
+    }
+
+    // Reads a LEB128 varint that must end before end; returns nullptr if it does not.
+    const char* readVarint(const char* in, const char* end, uint64_t& value) {
+        // Accumulated value.
+        value = 0;
+        // Read at most the longest valid encoding.
+        for (size_t i = 0; i < MAX_VARINT_BYTES && in < end; ++i) {
+            // Current byte.
+            unsigned char byte = static_cast<unsigned char>(*in++);
+            // Merge its 7 payload bits.
+            value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+            // The last byte has no continuation bit.
+            if ((byte & 0x80) == 0) return in;
+        }
+        // Ran off the end or past ten bytes.
+        return nullptr;
+    }
+
+    // Reads a uint64 stored in host byte order.
+    uint64_t readU64(const char* in) {
+        // Unaligned-safe copy.
+        uint64_t value;
+        // Copy the bytes.
+        std::memcpy(&value, in, sizeof(value));
+        // Return it.
+        return value;
+    }
+
+    // Parses one entry at in (not past end): sets key and value and returns the position after it, or nullptr.
+    const char* parseEntry(const char* in, const char* end, std::string_view& key, std::string_view& value) {
+        // Key length.
+        uint64_t keyLength;
+        // Value length.
+        uint64_t valueLength;
+        // Decode the key length.
+        in = readVarint(in, end, keyLength);
+        // Decode the value length.
+        if (in != nullptr) in = readVarint(in, end, valueLength);
+        // Both lengths must fit in what is left.
+        if (in == nullptr || keyLength > static_cast<uint64_t>(end - in) ||
+            valueLength > static_cast<uint64_t>(end - in) - keyLength) return nullptr;
+        // The key.
+        key = std::string_view(in, keyLength);
+        // The value right after it.
+        value = std::string_view(in + keyLength, valueLength);
+        // Position after the entry.
+        return in + keyLength + valueLength;
+    }
+
+    // Parses one deadline at in (not past end): sets key and deadline and returns the position after it, or nullptr.
+    const char* parseDeadline(const char* in, const char* end, std::string_view& key, uint64_t& deadline) {
+        // Key length.
+        uint64_t keyLength;
+        // Decode it.
+        in = readVarint(in, end, keyLength);
+        // The key and the 8-byte deadline must fit in what is left.
+        if (in == nullptr || static_cast<uint64_t>(end - in) < sizeof(uint64_t) ||
+            keyLength > static_cast<uint64_t>(end - in) - sizeof(uint64_t)) return nullptr;
+        // The key.
+        key = std::string_view(in, keyLength);
+        // The deadline right after it.
+        deadline = readU64(in + keyLength);
+        // Position after the deadline.
+        return in + keyLength + sizeof(uint64_t);
+    }
+}
+
+// Constructor: creates the temporary file and writes the header.
+SnapshotWriter::SnapshotWriter(const std::string& path)
+    : finalPath(path), tempPath(path + ".tmp." + std::to_string(::getpid())), fd(-1), checksum(0), entries(0), deadlines(0),
+      failed(false), committed(false) {
+    // Create (or truncate) the temporary file.
+    fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    // Nothing can be written without it.
+    if (fd < 0) failed = true;
+#ifdef KV_STORE_IO_URING
+    // Keep several writes in flight while the next blocks are encoded and hashed.
+    if (fd >= 0) ringWriter = std::make_unique<RingFileWriter>(fd, 0);
+    // Fall back to blocking writes without it.
+    if (ringWriter && !ringWriter->isOpen()) ringWriter.reset();
+#endif
+    // One checksum block of buffer.
+    buffer.reserve(Snapshot::CHECKSUM_BLOCK);
+    // Signature.
+    append(MAGIC, sizeof(MAGIC));
+    // Version, then the reserved word.
+    uint32_t header[2] = {Snapshot::FORMAT_VERSION, 0};
+    // Write both.
+    append(reinterpret_cast<const char*>(header), sizeof(header));
+}
+
+// Destructor: closes the file and removes it unless it was committed.
+SnapshotWriter::~SnapshotWriter() {
+    // Close the descriptor if commit did not.
+    if (fd >= 0) ::close(fd);
+    // Drop a partial file.
+    if (!committed) ::unlink(tempPath.c_str());
+}
+
+// Hashes the buffered bytes into the checksum and writes them out.
+void SnapshotWriter::flushBlock() {
+    // Hash exactly the bytes written, so the reader can recompute it block by block.
+    checksum = foldChecksum(checksum, std::string_view(buffer.data(), buffer.size()));
+#ifdef KV_STORE_IO_URING
+    // Queue them behind the writes in flight.
+    if (ringWriter) {
+        // Copied into a registered buffer.
+        ringWriter->write(buffer.data(), buffer.size());
+        // Start the next block.
+        buffer.clear();
+        // Done.
+        return;
+    }
+#endif
+    // Write them, retrying short writes.
+    for (size_t done = 0; !failed && done < buffer.size();) {
+        // Write what is left.
+        ssize_t written = ::write(fd, buffer.data() + done, buffer.size() - done);
+        // An error ends the snapshot.
+        if (written <= 0) failed = true; else done += static_cast<size_t>(written);
+    }
+    // Start the next block.
+    buffer.clear();
+}
+
+// Appends raw bytes, flushing each full checksum block.
+void SnapshotWriter::append(const char* data, size_t size) {
+    // Copy in as many pieces as block boundaries require.
+    while (size != 0) {
+        // Room left in this block.
+        size_t piece = std::min(size, Snapshot::CHECKSUM_BLOCK - buffer.size());
+        // Copy the piece.
+        buffer.insert(buffer.end(), data, data + piece);
+        // Move past it.
+        data += piece;
+        // Fewer bytes left.
+        size -= piece;
+        // A full block is hashed and written.
+        if (buffer.size() == Snapshot::CHECKSUM_BLOCK) flushBlock();
+    }
+}
+
+// Appends a varint.
+void SnapshotWriter::appendVarint(uint64_t value) {
+    // Encoded bytes.
+    char bytes[MAX_VARINT_BYTES];
+    // Bytes used.
+    size_t length = 0;
+    // Emit 7 bits at a time with a continuation flag.
+    while (value >= 0x80) {
+        // Low 7 bits plus continuation bit.
+        bytes[length++] = static_cast<char>((value & 0x7F) | 0x80);
+        // Drop the bits just written.
+        value >>= 7;
+    }
+    // Final byte without continuation bit.
+    bytes[length++] = static_cast<char>(value);
+    // Write them.
+    append(bytes, length);
+}
+
+// Appends a uint64 in host byte order.
+void SnapshotWriter::appendU64(uint64_t value) {
+    // Raw bytes.
+    append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Adds one key-value pair.
+void SnapshotWriter::addEntry(std::string_view key, std::string_view value) {
+    // Key length, value length, key, value: the arena record layout.
+    appendVarint(key.size());
+    // Value length.
+    appendVarint(value.size());
+    // Key bytes.
+    append(key.data(), key.size());
+    // Value bytes.
+    append(value.data(), value.size());
+    // Count it.
+    entries++;
+}
+
+// Adds the expiry deadline of a key already added.
+void SnapshotWriter::addDeadline(std::string_view key, uint64_t deadline) {
+    // Key length, key, deadline.
+    appendVarint(key.size());
+    // Key bytes.
+    append(key.data(), key.size());
+    // Deadline.
+    appendU64(deadline);
+    // Count it.
+    deadlines++;
+}
+
+// Writes the footer, syncs the file and renames it over the final path.
+bool SnapshotWriter::commit() {
+    // Counts are covered by the checksum.
+    appendU64(entries);
+    // Deadline count.
+    appendU64(deadlines);
+    // Hash and write the last, partial block.
+    flushBlock();
+    // The checksum itself goes out unhashed.
+    buffer.assign(reinterpret_cast<const char*>(&checksum), reinterpret_cast<const char*>(&checksum) + sizeof(checksum));
+    // Write it (this folds it into the running value, which is no longer needed).
+    flushBlock();
+#ifdef KV_STORE_IO_URING
+    // Wait for every write and fsync in one submission.
+    if (ringWriter && !ringWriter->finish(true)) failed = true;
+    // The ring already synced.
+    bool synced = ringWriter != nullptr;
+#else
+    // Synced below.
+    bool synced = false;
+#endif
+    // Make the data durable before it becomes visible under the final name.
+    if (!failed && !synced && ::fsync(fd) != 0) failed = true;
+    // Close the file.
+    if (::close(fd) != 0) failed = true;
+    // Closed either way.
+    fd = -1;
+    // Replace the previous snapshot atomically.
+    if (failed || std::rename(tempPath.c_str(), finalPath.c_str()) != 0) return false;
+    // The file is in place.
+    committed = true;
+    // Directory holding the snapshot.
+    std::string directory = finalPath.find('/') == std::string::npos ? "." : finalPath.substr(0, finalPath.rfind('/') + 1);
+    // Persist the rename itself.
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    // Best effort: the snapshot is complete either way.
+    if (dirFd >= 0) {
+        // Sync the directory entry.
+        ::fsync(dirFd);
+        // Done with it.
+        ::close(dirFd);
+    }
+    // Written and in place.
+    return true;
+}
+
+// Constructor: nothing open.
+SnapshotReader::SnapshotReader() : data(nullptr), size(0), entriesEnd(nullptr), entries(0), deadlines(0) {}
+
+// Destructor: unmaps the file.
+SnapshotReader::~SnapshotReader() {
+    // Release the mapping.
+    close();
+}
+
+// Releases the mapping.
+void SnapshotReader::close() {
+    // Unmap if mapped.
+    if (data != nullptr) ::munmap(const_cast<char*>(data), size);
+    // Nothing open.
+    data = nullptr;
+    // Forget the size.
+    size = 0;
+}
+
+// Maps path and validates it.
+bool SnapshotReader::open(const std::string& path) {
+    // Drop anything open before.
+    close();
+    // Open the file.
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    // Missing or unreadable.
+    if (fd < 0) return false;
+    // File size.
+    struct stat info;
+    // Too short to hold a header and footer, or not a regular file.
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || static_cast<size_t>(info.st_size) < HEADER_SIZE + FOOTER_SIZE) {
+        // Give the descriptor back.
+        ::close(fd);
+        // Not a snapshot.
+        return false;
+    }
+    // Map it.
+    void* mapped = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file alive.
+    ::close(fd);
+    // Mapping failed.
+    if (mapped == MAP_FAILED) return false;
+    // Keep it.
+    data = static_cast<const char*>(mapped);
+    // Its size.
+    size = static_cast<size_t>(info.st_size);
+    // The whole file is read front to back.
+    ::madvise(mapped, size, MADV_SEQUENTIAL);
+    // Signature and version.
+    uint32_t version;
+    // Copy the version out.
+    std::memcpy(&version, data + sizeof(MAGIC), sizeof(version));
+    // Reject other files and other versions.
+    if (std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || version != Snapshot::FORMAT_VERSION) {
+        // Nothing stays open.
+        close();
+        // Not ours.
+        return false;
+    }
+    // Bytes covered by the checksum.
+    size_t covered = size - sizeof(uint64_t);
+    // Recompute it block by block.
+    uint64_t checksum = 0;
+    // Hash every block, the last one possibly partial.
+    for (size_t offset = 0; offset < covered; offset += Snapshot::CHECKSUM_BLOCK) {
+        // Fold this block in.
+        checksum = foldChecksum(checksum, std::string_view(data + offset, std::min(Snapshot::CHECKSUM_BLOCK, covered - offset)));
+    }
+    // Footer fields.
+    const char* footer = data + size - FOOTER_SIZE;
+    // Counts.
+    entries = readU64(footer);
+    // Deadlines.
+    deadlines = readU64(footer + sizeof(uint64_t));
+    // Torn or corrupted file.
+    if (checksum != readU64(footer + 2 * sizeof(uint64_t))) {
+        // Nothing stays open.
+        close();
+        // Reject it.
+        return false;
+    }
+    // Walk every record once, so forEach can trust the lengths.
+    const char* in = data + HEADER_SIZE;
+    // Key and value of the current record.
+    std::string_view key;
+    // Value.
+    std::string_view value;
+    // Every entry must lie before the footer.
+    for (uint64_t i = 0; in != nullptr && i < entries; ++i) in = parseEntry(in, footer, key, value);
+    // Entries end here.
+    entriesEnd = in;
+    // Deadline of the current record.
+    uint64_t deadline;
+    // Every deadline must too.
+    for (uint64_t i = 0; in != nullptr && i < deadlines; ++i) in = parseDeadline(in, footer, key, deadline);
+    // The records must fill exactly the space up to the footer.
+    if (in != footer) {
+        // Nothing stays open.
+        close();
+        // Malformed.
+        return false;
+    }
+    // Ready to read.
+    return true;
+}
+
+// Returns the number of key-value entries.
+size_t SnapshotReader::entryCount() const {
+    // From the footer.
+    return data != nullptr ? static_cast<size_t>(entries) : 0;
+}
+
+// Returns the number of deadlines.
+size_t SnapshotReader::deadlineCount() const {
+    // From the footer.
+    return data != nullptr ? static_cast<size_t>(deadlines) : 0;
+}
+
+// Visits every entry in file order.
+void SnapshotReader::forEachEntry(const std::function<void(std::string_view key, std::string_view value)>& visit) const {
+    // Nothing open.
+    if (data == nullptr) return;
+    // First record.
+    const char* in = data + HEADER_SIZE;
+    // Current key.
+    std::string_view key;
+    // Current value.
+    std::string_view value;
+    // Entries (validated by open).
+    while (in != entriesEnd) {
+        // Decode one.
+        in = parseEntry(in, entriesEnd, key, value);
+        // Hand it out.
+        visit(key, value);
+    }
+}
+
+// Visits every deadline in file order.
+void SnapshotReader::forEachDeadline(const std::function<void(std::string_view key, uint64_t deadline)>& visit) const {
+    // Nothing open.
+    if (data == nullptr) return;
+    // End of the records.
+    const char* footer = data + size - FOOTER_SIZE;
+    // First deadline, right after the entries.
+    const char* in = entriesEnd;
+    // Current key.
+    std::string_view key;
+    // Current deadline.
+    uint64_t deadline;
+    // Deadlines (validated by open).
+    while (in != footer) {
+        // Decode one.
+        in = parseDeadline(in, footer, key, deadline);
+        // Hand it out.
+        visit(key, deadline);
+    }
+}
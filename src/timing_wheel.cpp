@@ -0,0 +1,175 @@
+#include "../include/timing_wheel.hpp"
+#include <utility> // For std::move
+
+namespace {
+    // Keys up to this length live inside the std::string object (libstdc++ small-string buffer).
+    constexpr size_t INLINE_KEY_LENGTH = 15;
+
+    // Returns the heap bytes a timer key of this length needs.
+    size_t keyHeapBytes(size_t length) {
+        // Short keys need none; longer ones their characters plus the terminator.
+        return length > INLINE_KEY_LENGTH ? length + 1 : 0;
+    }
+}
+
+// Constructor: starts the wheel at a tick.
+TimingWheel::TimingWheel(uint64_t startTick)
+    : levelCounts(), dueIndex(0), currentTick(startTick), pending(0), keyBytes(0) {}
+
+// Files a timer at its level and slot, or in due if its deadline already passed.
+void TimingWheel::place(Timer&& timer) {
+    // Already due.
+    if (timer.deadline <= currentTick) {
+        // Hand it out on the next advance.
+        due.push_back(std::move(timer));
+        // Done.
+        return;
+    }
+    // Find the lowest level whose higher digits agree with the current tick.
+    for (size_t level = 0; level < LEVELS; ++level) {
+        // Bits above this level's digit.
+        unsigned shift = LEVEL_BITS * static_cast<unsigned>(level + 1);
+        // Deadline and current tick differ above this level: try the next one up.
+        if ((timer.deadline >> shift) != (currentTick >> shift)) continue;
+        // This level's digit of the deadline picks the slot.
+        size_t slot = (timer.deadline >> (LEVEL_BITS * level)) & (SLOTS_PER_LEVEL - 1);
+        // File it.
+        slots[level][slot].push_back(std::move(timer));
+        // Count it.
+        levelCounts[level]++;
+        // Done.
+        return;
+    }
+    // Further out than the wheel spans.
+    overflow.push_back(std::move(timer));
+}
+
+// Re-files every timer of one slot.
+void TimingWheel::cascade(size_t level, size_t slot) {
+    // Take the slot's timers.
+    std::vector<Timer> timers = std::move(slots[level][slot]);
+    // Leave the slot empty.
+    slots[level][slot].clear();
+    // They leave this level.
+    levelCounts[level] -= timers.size();
+    // Each lands at a lower level, or in due.
+    for (Timer& timer : timers) place(std::move(timer));
+}
+
+// Moves the wheel to tick, cascading and collecting due timers along the way.
+void TimingWheel::advanceTo(uint64_t tick) {
+    // Step through the boundaries that matter until the target.
+    while (currentTick < tick) {
+        // Lowest level holding timers.
+        size_t lowest = 0;
+        // Skip empty levels.
+        while (lowest < LEVELS && levelCounts[lowest] == 0) lowest++;
+        // Nothing scheduled anywhere: jump straight there.
+        if (lowest == LEVELS && overflow.empty()) {
+            // Nothing can fire on the way.
+            currentTick = tick;
+            // Done.
+            return;
+        }
+        // Width of one slot of that level (the top level's span for overflow timers).
+        unsigned shift = LEVEL_BITS * static_cast<unsigned>(lowest);
+        // Next tick where a slot of that level starts; lower levels are empty, so nothing fires before it.
+        uint64_t next = ((currentTick >> shift) + 1) << shift;
+        // The target comes first: stop there.
+        if (next > tick) {
+            // Slots at or above the lowest level stay valid, since no boundary of theirs was crossed.
+            currentTick = tick;
+            // Done.
+            return;
+        }
+        // Move to the boundary.
+        currentTick = next;
+        // Overflow timers come back into range at the top level's boundaries.
+        if ((currentTick & ((uint64_t{1} << (LEVEL_BITS * LEVELS)) - 1)) == 0 && !overflow.empty()) {
+            // Take them all.
+            std::vector<Timer> timers = std::move(overflow);
+            // Leave the list empty.
+            overflow.clear();
+            // Re-file each.
+            for (Timer& timer : timers) place(std::move(timer));
+        }
+        // Cascade every level whose slot starts here, highest first, so timers fall through in one pass.
+        for (size_t level = LEVELS - 1; level >= 1; --level) {
+            // Bits below this level's digit.
+            unsigned levelShift = LEVEL_BITS * static_cast<unsigned>(level);
+            // Not at a slot boundary of this level.
+            if ((currentTick & ((uint64_t{1} << levelShift) - 1)) != 0) continue;
+            // Re-file the slot the wheel just reached.
+            if (levelCounts[level] != 0) cascade(level, (currentTick >> levelShift) & (SLOTS_PER_LEVEL - 1));
+        }
+        // Level 0's slot for this tick holds exactly the timers due now.
+        std::vector<Timer>& slot = slots[0][currentTick & (SLOTS_PER_LEVEL - 1)];
+        // Nothing due this tick.
+        if (slot.empty()) continue;
+        // They leave level 0.
+        levelCounts[0] -= slot.size();
+        // Move them to due.
+        for (Timer& timer : slot) due.push_back(std::move(timer));
+        // Leave the slot empty.
+        slot.clear();
+    }
+}
+
+// Schedules key to fire at deadline.
+void TimingWheel::schedule(std::string_view key, uint64_t deadline) {
+    // One more pending timer.
+    pending++;
+    // Account for its key.
+    keyBytes += keyHeapBytes(key.size());
+    // File it.
+    place(Timer{std::string(key), deadline});
+}
+
+// Moves the wheel to now and hands up to maxTimers due timers to fire.
+size_t TimingWheel::advance(uint64_t now, size_t maxTimers,
+                            const std::function<void(const std::string&, uint64_t)>& fire) {
+    // Collect everything due by now.
+    advanceTo(now);
+    // Timers fired by this call.
+    size_t fired = 0;
+    // Hand out due timers up to the budget.
+    while (fired < maxTimers && dueIndex < due.size()) {
+        // Take the timer out first, so fire may schedule (and grow due) safely.
+        Timer timer = std::move(due[dueIndex++]);
+        // It is no longer pending.
+        pending--;
+        // Stop accounting for its key.
+        keyBytes -= keyHeapBytes(timer.key.size());
+        // Fire it.
+        fire(timer.key, timer.deadline);
+        // Count it.
+        fired++;
+    }
+    // Reset the list once drained.
+    if (dueIndex == due.size()) {
+        // Drop the fired timers.
+        due.clear();
+        // Start over.
+        dueIndex = 0;
+    }
+    // Return the number fired.
+    return fired;
+}
+
+// Returns the number of due timers left over by the last advance.
+size_t TimingWheel::dueCount() const {
+    // Not yet handed out.
+    return due.size() - dueIndex;
+}
+
+// Returns the number of timers scheduled and not yet fired.
+size_t TimingWheel::size() const {
+    // Maintained by schedule and advance.
+    return pending;
+}
+
+// Returns the bytes held by the wheel.
+size_t TimingWheel::memoryUsage() const {
+    // Slot vectors, the pending timers themselves and their keys' heap buffers.
+    return sizeof(slots) + pending * sizeof(Timer) + keyBytes;
+}
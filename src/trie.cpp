@@ -1,154 +1,1449 @@
 #include "../include/trie.hpp"
+#include <algorithm> // For std::min
+#include <cstring> // For std::memcpy, std::memmove, std::memcmp
+#include <new> // For placement new
+#if defined(__SSE2__)
+#include <emmintrin.h> // For 16-wide key byte comparisons in Node16
+#endif
 
-// Destructor for TrieNode to free children.
-TrieNode::~TrieNode() {
-    // Iterate through all children in the map.
-    for (auto& pair : children) {
-        // Delete the child TrieNode.
-        delete pair.second;
+// Node types of the adaptive radix tree.
+enum ArtNodeType : uint8_t {
+    // A complete key.
+    ART_LEAF,
+    // Up to 4 children, keys kept sorted.
+    ART_NODE4,
+    // Up to 16 children, keys kept sorted and searched with SSE2.
+    ART_NODE16,
+    // Up to 48 children behind a 256-entry byte index.
+    ART_NODE48,
+    // One child slot per byte value.
+    ART_NODE256
+};
+
+// Header shared by every node.
+struct ArtNode {
+    // One of ArtNodeType.
+    uint8_t type;
+};
+
+// A complete key; its bytes are allocated directly after the struct.
+struct ArtLeaf : ArtNode {
+    // Length of the key.
+    uint32_t length;
+};
+
+// Number of compressed prefix bytes stored inline in an inner node; longer prefixes are
+// checked against a leaf below the node when an exact comparison is needed.
+static constexpr size_t MAX_PREFIX_LENGTH = 10;
+
+// Fields shared by every inner node.
+struct ArtInner : ArtNode {
+    // Number of children.
+    uint16_t numChildren;
+    // Length of the compressed path above this node's children.
+    uint32_t prefixLength;
+    // The first MAX_PREFIX_LENGTH bytes of the compressed path.
+    uint8_t prefix[MAX_PREFIX_LENGTH];
+    // Key that ends exactly at this node (one that is a prefix of the keys below), or nullptr.
+    ArtLeaf* terminal;
+};
+
+// Inner node with up to 4 children.
+struct ArtNode4 : ArtInner {
+    // Sorted child key bytes.
+    uint8_t keys[4];
+    // Children, parallel to keys.
+    ArtNode* children[4];
+};
+
+// Inner node with up to 16 children.
+struct ArtNode16 : ArtInner {
+    // Sorted child key bytes (one SSE2 register).
+    uint8_t keys[16];
+    // Children, parallel to keys.
+    ArtNode* children[16];
+};
+
+// Inner node with up to 48 children.
+struct ArtNode48 : ArtInner {
+    // For each byte value, 1 + the index of its child, or 0 when absent.
+    uint8_t childIndex[256];
+    // Children in arbitrary order.
+    ArtNode* children[48];
+};
+
+// Inner node with one slot per byte value.
+struct ArtNode256 : ArtInner {
+    // Child for each byte value, or nullptr.
+    ArtNode* children[256];
+};
+
+namespace {
+    // Returns the bytes of a leaf's key.
+    inline const char* leafData(const ArtLeaf* leaf) {
+        // The key is stored right after the struct.
+        return reinterpret_cast<const char*>(leaf + 1);
+    }
+
+    // Returns a leaf's key.
+    inline std::string_view leafKey(const ArtLeaf* leaf) {
+        // View over the trailing bytes.
+        return std::string_view(leafData(leaf), leaf->length);
+    }
+
+    // Returns the byte of key at position i.
+    inline uint8_t keyByte(std::string_view key, size_t i) {
+        // Compare bytes unsigned so the order matches std::string.
+        return static_cast<uint8_t>(key[i]);
+    }
+
+    // Returns any leaf below node (the smallest); used to recover compressed prefix bytes not stored inline.
+    const ArtLeaf* minimumLeaf(const ArtNode* node) {
+        // Descend until a leaf is reached.
+        while (node->type != ART_LEAF) {
+            // Inner node fields.
+            const ArtInner* inner = static_cast<const ArtInner*>(node);
+            // A key ending here is the smallest below the node.
+            if (inner->terminal) return inner->terminal;
+            // Otherwise follow the smallest child.
+            switch (node->type) {
+                // Sorted keys: the first child.
+                case ART_NODE4: node = static_cast<const ArtNode4*>(node)->children[0]; break;
+                // Sorted keys: the first child.
+                case ART_NODE16: node = static_cast<const ArtNode16*>(node)->children[0]; break;
+                // Scan the byte index for the first present child.
+                case ART_NODE48: {
+                    // Node fields.
+                    const ArtNode48* n48 = static_cast<const ArtNode48*>(node);
+                    // First used byte.
+                    size_t b = 0;
+                    // Skip absent bytes.
+                    while (n48->childIndex[b] == 0) ++b;
+                    // Follow it.
+                    node = n48->children[n48->childIndex[b] - 1];
+                    break;
+                }
+                // Scan the slots for the first present child.
+                default: {
+                    // Node fields.
+                    const ArtNode256* n256 = static_cast<const ArtNode256*>(node);
+                    // First used byte.
+                    size_t b = 0;
+                    // Skip absent bytes.
+                    while (n256->children[b] == nullptr) ++b;
+                    // Follow it.
+                    node = n256->children[b];
+                    break;
+                }
+            }
+        }
+        // The leaf reached.
+        return static_cast<const ArtLeaf*>(node);
+    }
+
+    // Returns the full compressed prefix of an inner node whose prefix starts at depth.
+    inline const uint8_t* fullPrefix(const ArtInner* inner, size_t depth) {
+        // Short prefixes are stored inline.
+        if (inner->prefixLength <= MAX_PREFIX_LENGTH) return inner->prefix;
+        // Longer ones are read from any key below the node (they all share it).
+        return reinterpret_cast<const uint8_t*>(leafData(minimumLeaf(inner))) + depth;
+    }
+
+    // Returns how many bytes of an inner node's prefix match key from depth on (exact comparison).
+    size_t prefixMismatch(const ArtInner* inner, std::string_view key, size_t depth) {
+        // Compare no further than the prefix or the key.
+        size_t limit = inner->prefixLength;
+        // Bytes of key left.
+        if (key.size() - depth < limit) limit = key.size() - depth;
+        // The prefix bytes.
+        const uint8_t* bytes = fullPrefix(inner, depth);
+        // Compare byte by byte.
+        for (size_t i = 0; i < limit; ++i) {
+            // Stop at the first difference.
+            if (bytes[i] != keyByte(key, depth + i)) return i;
+        }
+        // Everything compared matched.
+        return limit;
+    }
+
+    // Returns true if the inline part of an inner node's prefix matches key from depth on
+    // (optimistic check: bytes beyond MAX_PREFIX_LENGTH are verified against the leaf at the end).
+    bool prefixMatchesOptimistic(const ArtInner* inner, std::string_view key, size_t depth) {
+        // The key must be long enough to hold the whole prefix.
+        if (key.size() - depth < inner->prefixLength) return false;
+        // Inline bytes to compare.
+        size_t stored = inner->prefixLength < MAX_PREFIX_LENGTH ? inner->prefixLength : MAX_PREFIX_LENGTH;
+        // Compare them.
+        return std::memcmp(inner->prefix, key.data() + depth, stored) == 0;
     }
-    // Clear the children map.
-    children.clear();
-}
 
+    // Returns the slot holding the child for byte, or nullptr if there is none.
+    ArtNode** findChild(ArtNode* node, uint8_t byte) {
+        // Dispatch on the node type.
+        switch (node->type) {
+            // Linear search of at most four keys.
+            case ART_NODE4: {
+                // Node fields.
+                ArtNode4* n4 = static_cast<ArtNode4*>(node);
+                // Check each key.
+                for (size_t i = 0; i < n4->numChildren; ++i) {
+                    // Return the matching slot.
+                    if (n4->keys[i] == byte) return &n4->children[i];
+                }
+                // Not found.
+                return nullptr;
+            }
+            // Compare all sixteen keys at once.
+            case ART_NODE16: {
+                // Node fields.
+                ArtNode16* n16 = static_cast<ArtNode16*>(node);
+#if defined(__SSE2__)
+                // One bit per key equal to byte.
+                int matches = _mm_movemask_epi8(_mm_cmpeq_epi8(
+                    _mm_set1_epi8(static_cast<char>(byte)),
+                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys))));
+                // Ignore unused key slots.
+                matches &= (1 << n16->numChildren) - 1;
+                // Return the matching slot.
+                return matches ? &n16->children[__builtin_ctz(matches)] : nullptr;
+#else
+                // Portable fallback: check each key.
+                for (size_t i = 0; i < n16->numChildren; ++i) {
+                    // Return the matching slot.
+                    if (n16->keys[i] == byte) return &n16->children[i];
+                }
+                // Not found.
+                return nullptr;
+#endif
+            }
+            // One indirection through the byte index.
+            case ART_NODE48: {
+                // Node fields.
+                ArtNode48* n48 = static_cast<ArtNode48*>(node);
+                // Index of the child, plus one.
+                uint8_t index = n48->childIndex[byte];
+                // Return its slot.
+                return index ? &n48->children[index - 1] : nullptr;
+            }
+            // Direct slot.
+            default: {
+                // Node fields.
+                ArtNode256* n256 = static_cast<ArtNode256*>(node);
+                // Return the slot if it is used.
+                return n256->children[byte] ? &n256->children[byte] : nullptr;
+            }
+        }
+    }
+
+    // Returns the smallest child whose byte is at least from (storing that byte), or nullptr.
+    const ArtNode* childAtOrAfter(const ArtNode* node, int from, uint8_t& byte) {
+        // Dispatch on the node type.
+        switch (node->type) {
+            // Keys are sorted: the first one not below from.
+            case ART_NODE4: {
+                // Node fields.
+                const ArtNode4* n4 = static_cast<const ArtNode4*>(node);
+                // Scan the keys.
+                for (size_t i = 0; i < n4->numChildren; ++i) {
+                    // Skip smaller keys.
+                    if (n4->keys[i] < from) continue;
+                    // Report the byte.
+                    byte = n4->keys[i];
+                    // Return the child.
+                    return n4->children[i];
+                }
+                // None left.
+                return nullptr;
+            }
+            // Keys are sorted: the first one not below from.
+            case ART_NODE16: {
+                // Node fields.
+                const ArtNode16* n16 = static_cast<const ArtNode16*>(node);
+                // Scan the keys.
+                for (size_t i = 0; i < n16->numChildren; ++i) {
+                    // Skip smaller keys.
+                    if (n16->keys[i] < from) continue;
+                    // Report the byte.
+                    byte = n16->keys[i];
+                    // Return the child.
+                    return n16->children[i];
+                }
+                // None left.
+                return nullptr;
+            }
+            // Scan the byte index from from.
+            case ART_NODE48: {
+                // Node fields.
+                const ArtNode48* n48 = static_cast<const ArtNode48*>(node);
+                // Each remaining byte value.
+                for (int b = from; b < 256; ++b) {
+                    // Skip absent bytes.
+                    if (n48->childIndex[b] == 0) continue;
+                    // Report the byte.
+                    byte = static_cast<uint8_t>(b);
+                    // Return the child.
+                    return n48->children[n48->childIndex[b] - 1];
+                }
+                // None left.
+                return nullptr;
+            }
+            // Scan the slots from from.
+            default: {
+                // Node fields.
+                const ArtNode256* n256 = static_cast<const ArtNode256*>(node);
+                // Each remaining byte value.
+                for (int b = from; b < 256; ++b) {
+                    // Skip absent bytes.
+                    if (n256->children[b] == nullptr) continue;
+                    // Report the byte.
+                    byte = static_cast<uint8_t>(b);
+                    // Return the child.
+                    return n256->children[b];
+                }
+                // None left.
+                return nullptr;
+            }
+        }
+    }
+
+    // Returns the largest child whose byte is at most from (storing that byte), or nullptr.
+    const ArtNode* childAtOrBefore(const ArtNode* node, int from, uint8_t& byte) {
+        // Dispatch on the node type.
+        switch (node->type) {
+            // Keys are sorted: the last one not above from.
+            case ART_NODE4: {
+                // Node fields.
+                const ArtNode4* n4 = static_cast<const ArtNode4*>(node);
+                // Scan the keys from the end.
+                for (size_t i = n4->numChildren; i-- > 0;) {
+                    // Skip larger keys.
+                    if (n4->keys[i] > from) continue;
+                    // Report the byte.
+                    byte = n4->keys[i];
+                    // Return the child.
+                    return n4->children[i];
+                }
+                // None left.
+                return nullptr;
+            }
+            // Keys are sorted: the last one not above from.
+            case ART_NODE16: {
+                // Node fields.
+                const ArtNode16* n16 = static_cast<const ArtNode16*>(node);
+                // Scan the keys from the end.
+                for (size_t i = n16->numChildren; i-- > 0;) {
+                    // Skip larger keys.
+                    if (n16->keys[i] > from) continue;
+                    // Report the byte.
+                    byte = n16->keys[i];
+                    // Return the child.
+                    return n16->children[i];
+                }
+                // None left.
+                return nullptr;
+            }
+            // Scan the byte index down from from.
+            case ART_NODE48: {
+                // Node fields.
+                const ArtNode48* n48 = static_cast<const ArtNode48*>(node);
+                // Each remaining byte value.
+                for (int b = from; b >= 0; --b) {
+                    // Skip absent bytes.
+                    if (n48->childIndex[b] == 0) continue;
+                    // Report the byte.
+                    byte = static_cast<uint8_t>(b);
+                    // Return the child.
+                    return n48->children[n48->childIndex[b] - 1];
+                }
+                // None left.
+                return nullptr;
+            }
+            // Scan the slots down from from.
+            default: {
+                // Node fields.
+                const ArtNode256* n256 = static_cast<const ArtNode256*>(node);
+                // Each remaining byte value.
+                for (int b = from; b >= 0; --b) {
+                    // Skip absent bytes.
+                    if (n256->children[b] == nullptr) continue;
+                    // Report the byte.
+                    byte = static_cast<uint8_t>(b);
+                    // Return the child.
+                    return n256->children[b];
+                }
+                // None left.
+                return nullptr;
+            }
+        }
+    }
 
-// Constructor: initializes the Trie with a root node.
-Trie::Trie() {
-    // Create a new TrieNode for the root.
-    root = new TrieNode();
+    // Returns the smallest string greater than every string starting with prefix, or std::nullopt if
+    // there is none (an empty prefix or one made only of 0xFF bytes).
+    std::optional<std::string> prefixSuccessor(std::string_view prefix) {
+        // Work on a copy.
+        std::string successor(prefix);
+        // Drop trailing 0xFF bytes, which cannot be incremented.
+        while (!successor.empty() && static_cast<uint8_t>(successor.back()) == 0xFF) successor.pop_back();
+        // Nothing left to increment.
+        if (successor.empty()) return std::nullopt;
+        // Increment the last byte.
+        successor.back() = static_cast<char>(static_cast<uint8_t>(successor.back()) + 1);
+        // Return the bound.
+        return successor;
+    }
+
+    // Encodes a resume key as an opaque cursor (lowercase hex, so any key bytes survive a text protocol).
+    std::string encodeCursor(std::string_view key) {
+        // Hex digits.
+        static const char digits[] = "0123456789abcdef";
+        // Two digits per byte.
+        std::string cursor;
+        // Reserve them.
+        cursor.reserve(key.size() * 2);
+        // Encode each byte.
+        for (char c : key) {
+            // High nibble.
+            cursor.push_back(digits[static_cast<uint8_t>(c) >> 4]);
+            // Low nibble.
+            cursor.push_back(digits[static_cast<uint8_t>(c) & 0xF]);
+        }
+        // Return the cursor.
+        return cursor;
+    }
+
+    // Returns the value of a hex digit, or -1 if c is not one.
+    int hexValue(char c) {
+        // Decimal digits.
+        if (c >= '0' && c <= '9') return c - '0';
+        // Lowercase letters.
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        // Anything else.
+        return -1;
+    }
+
+    // Decodes a cursor back into its resume key, or std::nullopt if it is malformed.
+    std::optional<std::string> decodeCursor(const std::string& cursor) {
+        // Every byte takes two digits.
+        if (cursor.size() % 2 != 0) return std::nullopt;
+        // Decoded key.
+        std::string key;
+        // Reserve it.
+        key.reserve(cursor.size() / 2);
+        // Decode each pair.
+        for (size_t i = 0; i < cursor.size(); i += 2) {
+            // High nibble.
+            int high = hexValue(cursor[i]);
+            // Low nibble.
+            int low = hexValue(cursor[i + 1]);
+            // Reject non-hex input.
+            if (high < 0 || low < 0) return std::nullopt;
+            // Append the byte.
+            key.push_back(static_cast<char>(high << 4 | low));
+        }
+        // Return the key.
+        return key;
+    }
+
+    // Copies the fields shared by every inner node.
+    void copyHeader(ArtInner* to, const ArtInner* from) {
+        // Child count.
+        to->numChildren = from->numChildren;
+        // Compressed path length.
+        to->prefixLength = from->prefixLength;
+        // Inline prefix bytes.
+        std::memcpy(to->prefix, from->prefix, MAX_PREFIX_LENGTH);
+        // Key ending at the node.
+        to->terminal = from->terminal;
+    }
+
+    // Returns the allocation size of a node.
+    size_t nodeBytes(const ArtNode* node) {
+        // Dispatch on the node type.
+        switch (node->type) {
+            // Struct plus key bytes.
+            case ART_LEAF: return sizeof(ArtLeaf) + static_cast<const ArtLeaf*>(node)->length;
+            // Fixed sizes for inner nodes.
+            case ART_NODE4: return sizeof(ArtNode4);
+            // Fixed size.
+            case ART_NODE16: return sizeof(ArtNode16);
+            // Fixed size.
+            case ART_NODE48: return sizeof(ArtNode48);
+            // Fixed size.
+            default: return sizeof(ArtNode256);
+        }
+    }
+
+    // Allocates a zeroed inner node of the given type.
+    template <typename NodeType>
+    NodeType* newInner(uint8_t type) {
+        // Value-initialize so every count, key and child starts at zero.
+        NodeType* node = new NodeType();
+        // Tag its type.
+        node->type = type;
+        // Return the node.
+        return node;
+    }
 }
 
-// Destructor: cleans up all nodes in the Trie by deleting the root.
+// Constructor: initializes an empty Trie.
+Trie::Trie() : root(nullptr), keyCount(0), allocatedBytes(0), innerNodes(0) {}
+
+// Destructor: cleans up all nodes in the Trie.
 Trie::~Trie() {
-    // Delete the root node, which recursively deletes all children.
-    delete root;
+    // Free the whole tree.
+    freeSubtree(root);
+}
+
+// Allocates a leaf holding a copy of key.
+ArtLeaf* Trie::makeLeaf(std::string_view key) {
+    // Struct plus key bytes in one allocation.
+    size_t bytes = sizeof(ArtLeaf) + key.size();
+    // Construct the header in raw storage.
+    ArtLeaf* leaf = new (::operator new(bytes)) ArtLeaf();
+    // Tag its type.
+    leaf->type = ART_LEAF;
+    // Record the key length.
+    leaf->length = static_cast<uint32_t>(key.size());
+    // Copy the key bytes after the header.
+    std::memcpy(leaf + 1, key.data(), key.size());
+    // Account for the allocation.
+    allocatedBytes += bytes;
+    // Return the leaf.
+    return leaf;
+}
+
+// Frees a leaf.
+void Trie::freeLeaf(ArtLeaf* leaf) {
+    // Release the accounting.
+    allocatedBytes -= nodeBytes(leaf);
+    // Release the raw storage.
+    ::operator delete(leaf);
+}
+
+// Frees an inner node (not its children).
+void Trie::freeInner(ArtNode* node) {
+    // Release the accounting.
+    allocatedBytes -= nodeBytes(node);
+    // One node fewer.
+    innerNodes--;
+    // Delete through the concrete type.
+    switch (node->type) {
+        // Node4.
+        case ART_NODE4: delete static_cast<ArtNode4*>(node); break;
+        // Node16.
+        case ART_NODE16: delete static_cast<ArtNode16*>(node); break;
+        // Node48.
+        case ART_NODE48: delete static_cast<ArtNode48*>(node); break;
+        // Node256.
+        default: delete static_cast<ArtNode256*>(node); break;
+    }
+}
+
+// Frees a node and everything below it.
+void Trie::freeSubtree(ArtNode* node) {
+    // Nothing to free.
+    if (node == nullptr) return;
+    // Leaves have no children.
+    if (node->type == ART_LEAF) {
+        // Free the leaf.
+        freeLeaf(static_cast<ArtLeaf*>(node));
+        // Done.
+        return;
+    }
+    // Inner node fields.
+    ArtInner* inner = static_cast<ArtInner*>(node);
+    // Free the key ending here.
+    if (inner->terminal) freeLeaf(inner->terminal);
+    // Free the children.
+    switch (node->type) {
+        // Used slots are packed at the front.
+        case ART_NODE4: for (size_t i = 0; i < inner->numChildren; ++i) freeSubtree(static_cast<ArtNode4*>(node)->children[i]); break;
+        // Used slots are packed at the front.
+        case ART_NODE16: for (size_t i = 0; i < inner->numChildren; ++i) freeSubtree(static_cast<ArtNode16*>(node)->children[i]); break;
+        // Unused slots are null.
+        case ART_NODE48: for (ArtNode* child : static_cast<ArtNode48*>(node)->children) freeSubtree(child); break;
+        // Unused slots are null.
+        default: for (ArtNode* child : static_cast<ArtNode256*>(node)->children) freeSubtree(child); break;
+    }
+    // Free the node itself.
+    freeInner(node);
+}
+
+// Adds a child under byte to the inner node in ref, growing the node if it is full.
+void Trie::addChild(ArtNode*& ref, uint8_t byte, ArtNode* child) {
+    // Dispatch on the node type.
+    switch (ref->type) {
+        // Sorted insert, or grow into a Node16.
+        case ART_NODE4: {
+            // Node fields.
+            ArtNode4* n4 = static_cast<ArtNode4*>(ref);
+            // Room left.
+            if (n4->numChildren < 4) {
+                // Position keeping keys sorted.
+                size_t pos = 0;
+                // Skip smaller keys.
+                while (pos < n4->numChildren && n4->keys[pos] < byte) ++pos;
+                // Shift larger keys right.
+                std::memmove(n4->keys + pos + 1, n4->keys + pos, n4->numChildren - pos);
+                // Shift their children too.
+                std::memmove(n4->children + pos + 1, n4->children + pos, (n4->numChildren - pos) * sizeof(ArtNode*));
+                // Place the new key.
+                n4->keys[pos] = byte;
+                // Place the new child.
+                n4->children[pos] = child;
+                // Count it.
+                n4->numChildren++;
+                // Done.
+                return;
+            }
+            // Full: copy into a Node16.
+            ArtNode16* n16 = newInner<ArtNode16>(ART_NODE16);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode16);
+            // Count it.
+            innerNodes++;
+            // Shared fields.
+            copyHeader(n16, n4);
+            // Keys (already sorted).
+            std::memcpy(n16->keys, n4->keys, 4);
+            // Children.
+            std::memcpy(n16->children, n4->children, 4 * sizeof(ArtNode*));
+            // Drop the old node.
+            freeInner(n4);
+            // Link the new one.
+            ref = n16;
+            // Insert into the larger node.
+            addChild(ref, byte, child);
+            // Done.
+            return;
+        }
+        // Sorted insert, or grow into a Node48.
+        case ART_NODE16: {
+            // Node fields.
+            ArtNode16* n16 = static_cast<ArtNode16*>(ref);
+            // Room left.
+            if (n16->numChildren < 16) {
+                // Position keeping keys sorted.
+                size_t pos = 0;
+#if defined(__SSE2__)
+                // Flip the sign bits so the signed byte compare orders bytes as unsigned.
+                __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+                // One bit per key greater than byte.
+                int greater = _mm_movemask_epi8(_mm_cmplt_epi8(
+                    _mm_xor_si128(_mm_set1_epi8(static_cast<char>(byte)), flip),
+                    _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(n16->keys)), flip)));
+                // Ignore unused key slots.
+                greater &= (1 << n16->numChildren) - 1;
+                // The first greater key is the insert position.
+                pos = greater ? static_cast<size_t>(__builtin_ctz(greater)) : n16->numChildren;
+#else
+                // Skip smaller keys.
+                while (pos < n16->numChildren && n16->keys[pos] < byte) ++pos;
+#endif
+                // Shift larger keys right.
+                std::memmove(n16->keys + pos + 1, n16->keys + pos, n16->numChildren - pos);
+                // Shift their children too.
+                std::memmove(n16->children + pos + 1, n16->children + pos, (n16->numChildren - pos) * sizeof(ArtNode*));
+                // Place the new key.
+                n16->keys[pos] = byte;
+                // Place the new child.
+                n16->children[pos] = child;
+                // Count it.
+                n16->numChildren++;
+                // Done.
+                return;
+            }
+            // Full: copy into a Node48.
+            ArtNode48* n48 = newInner<ArtNode48>(ART_NODE48);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode48);
+            // Count it.
+            innerNodes++;
+            // Shared fields.
+            copyHeader(n48, n16);
+            // Move each child and index it by its key byte.
+            for (size_t i = 0; i < 16; ++i) {
+                // Child slot i.
+                n48->children[i] = n16->children[i];
+                // Byte index entry (index + 1).
+                n48->childIndex[n16->keys[i]] = static_cast<uint8_t>(i + 1);
+            }
+            // Drop the old node.
+            freeInner(n16);
+            // Link the new one.
+            ref = n48;
+            // Insert into the larger node.
+            addChild(ref, byte, child);
+            // Done.
+            return;
+        }
+        // Use a free slot, or grow into a Node256.
+        case ART_NODE48: {
+            // Node fields.
+            ArtNode48* n48 = static_cast<ArtNode48*>(ref);
+            // Room left.
+            if (n48->numChildren < 48) {
+                // First free slot.
+                size_t slot = 0;
+                // Skip used slots.
+                while (n48->children[slot] != nullptr) ++slot;
+                // Place the child.
+                n48->children[slot] = child;
+                // Index it by its byte.
+                n48->childIndex[byte] = static_cast<uint8_t>(slot + 1);
+                // Count it.
+                n48->numChildren++;
+                // Done.
+                return;
+            }
+            // Full: copy into a Node256.
+            ArtNode256* n256 = newInner<ArtNode256>(ART_NODE256);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode256);
+            // Count it.
+            innerNodes++;
+            // Shared fields.
+            copyHeader(n256, n48);
+            // Move each indexed child to its byte's slot.
+            for (size_t b = 0; b < 256; ++b) {
+                // Copy present children.
+                if (n48->childIndex[b]) n256->children[b] = n48->children[n48->childIndex[b] - 1];
+            }
+            // Drop the old node.
+            freeInner(n48);
+            // Link the new one.
+            ref = n256;
+            // Insert into the larger node.
+            addChild(ref, byte, child);
+            // Done.
+            return;
+        }
+        // Direct slot.
+        default: {
+            // Node fields.
+            ArtNode256* n256 = static_cast<ArtNode256*>(ref);
+            // Place the child.
+            n256->children[byte] = child;
+            // Count it.
+            n256->numChildren++;
+            // Done.
+            return;
+        }
+    }
+}
+
+// Removes the child under byte from the inner node in ref, shrinking or collapsing the node as needed.
+void Trie::removeChild(ArtNode*& ref, uint8_t byte) {
+    // Dispatch on the node type.
+    switch (ref->type) {
+        // Remove from the sorted arrays, then collapse if only one path is left.
+        case ART_NODE4: {
+            // Node fields.
+            ArtNode4* n4 = static_cast<ArtNode4*>(ref);
+            // Position of the key.
+            size_t pos = 0;
+            // Find it.
+            while (n4->keys[pos] != byte) ++pos;
+            // Shift larger keys left.
+            std::memmove(n4->keys + pos, n4->keys + pos + 1, n4->numChildren - pos - 1);
+            // Shift their children too.
+            std::memmove(n4->children + pos, n4->children + pos + 1, (n4->numChildren - pos - 1) * sizeof(ArtNode*));
+            // One fewer child.
+            n4->numChildren--;
+            // Replace the node if it no longer branches.
+            collapse(ref);
+            // Done.
+            return;
+        }
+        // Remove from the sorted arrays, then shrink to a Node4.
+        case ART_NODE16: {
+            // Node fields.
+            ArtNode16* n16 = static_cast<ArtNode16*>(ref);
+            // Slot of the key.
+            size_t pos = static_cast<size_t>(findChild(n16, byte) - n16->children);
+            // Shift larger keys left.
+            std::memmove(n16->keys + pos, n16->keys + pos + 1, n16->numChildren - pos - 1);
+            // Shift their children too.
+            std::memmove(n16->children + pos, n16->children + pos + 1, (n16->numChildren - pos - 1) * sizeof(ArtNode*));
+            // One fewer child.
+            n16->numChildren--;
+            // Keep the node while it is more than a Node4 could hold comfortably.
+            if (n16->numChildren > 3) return;
+            // Copy into a Node4.
+            ArtNode4* n4 = newInner<ArtNode4>(ART_NODE4);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode4);
+            // Count it.
+            innerNodes++;
+            // Shared fields.
+            copyHeader(n4, n16);
+            // Keys.
+            std::memcpy(n4->keys, n16->keys, n16->numChildren);
+            // Children.
+            std::memcpy(n4->children, n16->children, n16->numChildren * sizeof(ArtNode*));
+            // Drop the old node.
+            freeInner(n16);
+            // Link the new one.
+            ref = n4;
+            // Done.
+            return;
+        }
+        // Clear the slot, then shrink to a Node16.
+        case ART_NODE48: {
+            // Node fields.
+            ArtNode48* n48 = static_cast<ArtNode48*>(ref);
+            // Clear the child slot.
+            n48->children[n48->childIndex[byte] - 1] = nullptr;
+            // Clear the index entry.
+            n48->childIndex[byte] = 0;
+            // One fewer child.
+            n48->numChildren--;
+            // Keep the node while it is well above Node16 size.
+            if (n48->numChildren > 12) return;
+            // Copy into a Node16.
+            ArtNode16* n16 = newInner<ArtNode16>(ART_NODE16);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode16);
+            // Count it.
+            innerNodes++;
+            // Shared fields.
+            copyHeader(n16, n48);
+            // Next free position in the sorted arrays.
+            size_t pos = 0;
+            // Walk the bytes in order so the keys come out sorted.
+            for (size_t b = 0; b < 256; ++b) {
+                // Skip absent bytes.
+                if (n48->childIndex[b] == 0) continue;
+                // Key byte.
+                n16->keys[pos] = static_cast<uint8_t>(b);
+                // Its child.
+                n16->children[pos] = n48->children[n48->childIndex[b] - 1];
+                // Next position.
+                pos++;
+            }
+            // Drop the old node.
+            freeInner(n48);
+            // Link the new one.
+            ref = n16;
+            // Done.
+            return;
+        }
+        // Clear the slot, then shrink to a Node48.
+        default: {
+            // Node fields.
+            ArtNode256* n256 = static_cast<ArtNode256*>(ref);
+            // Clear the child slot.
+            n256->children[byte] = nullptr;
+            // One fewer child.
+            n256->numChildren--;
+            // Keep the node while it is well above Node48 size.
+            if (n256->numChildren > 37) return;
+            // Copy into a Node48.
+            ArtNode48* n48 = newInner<ArtNode48>(ART_NODE48);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode48);
+            // Count it.
+            innerNodes++;
+            // Shared fields.
+            copyHeader(n48, n256);
+            // Next free child slot.
+            size_t pos = 0;
+            // Move each present child.
+            for (size_t b = 0; b < 256; ++b) {
+                // Skip absent bytes.
+                if (n256->children[b] == nullptr) continue;
+                // Child slot.
+                n48->children[pos] = n256->children[b];
+                // Byte index entry (index + 1).
+                n48->childIndex[b] = static_cast<uint8_t>(pos + 1);
+                // Next slot.
+                pos++;
+            }
+            // Drop the old node.
+            freeInner(n256);
+            // Link the new one.
+            ref = n48;
+            // Done.
+            return;
+        }
+    }
+}
+
+// Replaces a Node4 in ref that no longer branches by its only child or key.
+void Trie::collapse(ArtNode*& ref) {
+    // Only Node4 can get this small.
+    if (ref->type != ART_NODE4) return;
+    // Node fields.
+    ArtNode4* n4 = static_cast<ArtNode4*>(ref);
+    // No children left: the node is just its terminal key (or nothing).
+    if (n4->numChildren == 0) {
+        // The key ending here, if any, takes the node's place (a leaf holds its whole key).
+        ArtNode* replacement = n4->terminal;
+        // Free the node.
+        freeInner(n4);
+        // Link the replacement.
+        ref = replacement;
+        // Done.
+        return;
+    }
+    // Still a branch point: two children, or a child plus a key ending here.
+    if (n4->numChildren > 1 || n4->terminal) return;
+    // The only child.
+    ArtNode* child = n4->children[0];
+    // An inner child absorbs this node's prefix and the edge byte into its own prefix.
+    if (child->type != ART_LEAF) {
+        // Child fields.
+        ArtInner* inner = static_cast<ArtInner*>(child);
+        // Inline bytes of the merged prefix.
+        uint8_t merged[MAX_PREFIX_LENGTH];
+        // Bytes collected so far.
+        size_t length = 0;
+        // This node's inline prefix bytes first.
+        size_t own = n4->prefixLength < MAX_PREFIX_LENGTH ? n4->prefixLength : MAX_PREFIX_LENGTH;
+        // Copy them.
+        std::memcpy(merged, n4->prefix, own);
+        // Count them.
+        length = own;
+        // Then the edge byte, if there is room.
+        if (length < MAX_PREFIX_LENGTH) merged[length++] = n4->keys[0];
+        // Then the child's inline bytes, as many as fit.
+        size_t childStored = inner->prefixLength < MAX_PREFIX_LENGTH ? inner->prefixLength : MAX_PREFIX_LENGTH;
+        // Copy what fits.
+        for (size_t i = 0; i < childStored && length < MAX_PREFIX_LENGTH; ++i) merged[length++] = inner->prefix[i];
+        // Install the merged prefix.
+        std::memcpy(inner->prefix, merged, length);
+        // The child's path now covers this node's prefix and the edge byte.
+        inner->prefixLength += n4->prefixLength + 1;
+    }
+    // Free the node.
+    freeInner(n4);
+    // Link the child in its place (a leaf already holds its whole key).
+    ref = child;
 }
 
 // Inserts a key into the Trie.
-void Trie::insert(const std::string& key) {
-    // Start traversal from the root node.
-    TrieNode* current = root;
-    // Iterate through each character of the key.
-    for (char ch : key) {
-        // If the character is not a child of the current node.
-        if (current->children.find(ch) == current->children.end()) {
-            // Create a new TrieNode for this character.
-            current->children[ch] = new TrieNode();
+void Trie::insert(std::string_view key) {
+    // Count keys that were not already present.
+    if (insertRecursive(root, key, 0)) keyCount++;
+}
+
+// Recursive helper for inserting a key below the node in ref, which starts at depth.
+bool Trie::insertRecursive(ArtNode*& ref, std::string_view key, size_t depth) {
+    // Empty slot: the key becomes a leaf here (lazy expansion).
+    if (ref == nullptr) {
+        // Store the key.
+        ref = makeLeaf(key);
+        // Inserted.
+        return true;
+    }
+    // A leaf: either the key itself, or a key to split from.
+    if (ref->type == ART_LEAF) {
+        // The existing leaf.
+        ArtLeaf* existing = static_cast<ArtLeaf*>(ref);
+        // Its key.
+        std::string_view existingKey = leafKey(existing);
+        // Already present.
+        if (existingKey == key) return false;
+        // Length of the shared part from depth on.
+        size_t common = 0;
+        // Shorter of the two remaining lengths.
+        size_t limit = std::min(existingKey.size(), key.size()) - depth;
+        // Count equal bytes.
+        while (common < limit && existingKey[depth + common] == key[depth + common]) ++common;
+        // New branch point holding the shared part as its compressed prefix.
+        ArtNode4* node = newInner<ArtNode4>(ART_NODE4);
+        // Account for it.
+        allocatedBytes += sizeof(ArtNode4);
+        // Count it.
+        innerNodes++;
+        // Full length of the shared part.
+        node->prefixLength = static_cast<uint32_t>(common);
+        // Its first bytes inline.
+        std::memcpy(node->prefix, key.data() + depth, std::min(common, MAX_PREFIX_LENGTH));
+        // Depth of the branch.
+        size_t branch = depth + common;
+        // Link the node.
+        ref = node;
+        // The existing key either ends at the branch or continues under its next byte.
+        if (existingKey.size() == branch) node->terminal = existing;
+        else addChild(ref, keyByte(existingKey, branch), existing);
+        // Same for the new key.
+        if (key.size() == branch) static_cast<ArtInner*>(ref)->terminal = makeLeaf(key);
+        else addChild(ref, keyByte(key, branch), makeLeaf(key));
+        // Inserted.
+        return true;
+    }
+    // Inner node fields.
+    ArtInner* inner = static_cast<ArtInner*>(ref);
+    // Check the compressed path first.
+    if (inner->prefixLength != 0) {
+        // Matching bytes of the path.
+        size_t match = prefixMismatch(inner, key, depth);
+        // The key leaves the path part way: split the path.
+        if (match < inner->prefixLength) {
+            // Every byte of the path (inline or from a leaf below).
+            const uint8_t* path = fullPrefix(inner, depth);
+            // New branch point holding the matching part.
+            ArtNode4* node = newInner<ArtNode4>(ART_NODE4);
+            // Account for it.
+            allocatedBytes += sizeof(ArtNode4);
+            // Count it.
+            innerNodes++;
+            // Matching length.
+            node->prefixLength = static_cast<uint32_t>(match);
+            // Its first bytes inline.
+            std::memcpy(node->prefix, path, std::min(match, MAX_PREFIX_LENGTH));
+            // The byte where the old path continues.
+            uint8_t edge = path[match];
+            // The old node keeps the rest of the path after the edge byte.
+            uint32_t rest = inner->prefixLength - static_cast<uint32_t>(match) - 1;
+            // Move its inline bytes forward (the source may be the node's own array).
+            std::memmove(inner->prefix, path + match + 1, std::min<size_t>(rest, MAX_PREFIX_LENGTH));
+            // Shorten it.
+            inner->prefixLength = rest;
+            // Link the branch point.
+            ref = node;
+            // The old node hangs off the edge byte.
+            addChild(ref, edge, inner);
+            // The new key ends at the branch or continues under its next byte.
+            if (key.size() == depth + match) static_cast<ArtInner*>(ref)->terminal = makeLeaf(key);
+            else addChild(ref, keyByte(key, depth + match), makeLeaf(key));
+            // Inserted.
+            return true;
         }
-        // Move to the child node corresponding to the character.
-        current = current->children[ch];
+        // Skip past the path.
+        depth += inner->prefixLength;
     }
-    // Mark the last node as the end of the inserted key.
-    current->isEndOfKey = true;
+    // The key ends at this node.
+    if (depth == key.size()) {
+        // Already present.
+        if (inner->terminal) return false;
+        // Store it as the node's terminal key.
+        inner->terminal = makeLeaf(key);
+        // Inserted.
+        return true;
+    }
+    // Child for the next byte.
+    ArtNode** child = findChild(ref, keyByte(key, depth));
+    // Descend if there is one.
+    if (child) return insertRecursive(*child, key, depth + 1);
+    // Otherwise the key becomes a new leaf child.
+    addChild(ref, keyByte(key, depth), makeLeaf(key));
+    // Inserted.
+    return true;
 }
 
 // Searches for keys in the Trie that start with the given prefix.
 std::vector<std::string> Trie::searchPrefix(const std::string& prefix) const {
     // Vector to store the keys found with the given prefix.
     std::vector<std::string> result;
-    // Start traversal from the root node.
-    TrieNode* current = root;
-    // Traverse the Trie according to the characters in the prefix.
-    for (char ch : prefix) {
-        // If the character is not a child of the current node.
-        if (current->children.find(ch) == current->children.end()) {
-            // Prefix does not exist, return empty result.
-            return result;
-        }
-        // Move to the child node.
-        current = current->children[ch];
-    }
-    // Prefix found, collect all keys starting from this node.
-    collectKeys(current, prefix, result);
+    // Walk the matching keys in order.
+    KeyIterator it = scanPrefix(prefix);
+    // Copy each one out.
+    while (it.next()) result.emplace_back(it.key());
     // Return the vector of keys.
     return result;
 }
 
-// Recursive helper for collecting keys with a given prefix.
-void Trie::collectKeys(TrieNode* node, const std::string& currentPrefix, std::vector<std::string>& result) const {
-    // If the current node marks the end of a key.
-    if (node->isEndOfKey) {
-        // Add the current prefix (which is a complete key) to the result.
-        result.push_back(currentPrefix);
-    }
-    // Iterate through all children of the current node.
-    for (auto const& [keyChar, childNode] : node->children) {
-        // Recursively call collectKeys for each child, appending the character to the prefix.
-        collectKeys(childNode, currentPrefix + keyChar, result);
+// Returns an iterator over the keys that start with prefix, optionally resuming after the key startAfter.
+Trie::KeyIterator Trie::scanPrefix(std::string_view prefix, std::optional<std::string_view> startAfter) const {
+    // Every key with the prefix lies in [prefix, successor of prefix).
+    std::optional<std::string> end = prefixSuccessor(prefix);
+    // Walk that range.
+    KeyIterator it = scanRange(prefix, end ? std::optional<std::string_view>(*end) : std::nullopt);
+    // Resume after startAfter unless that is before the prefix's first key.
+    if (startAfter && *startAfter >= prefix) {
+        // Restart from the resume key.
+        it.stack.clear();
+        // It is the new lower bound.
+        it.lowerBound = std::string(*startAfter);
+        // Excluding the key itself.
+        it.skipLowerBound = true;
+        // Position the stack there.
+        if (root) it.seekForward(root, it.lowerBound);
     }
+    // Return the iterator.
+    return it;
 }
 
-// Checks if a key exists in the Trie.
-bool Trie::contains(const std::string& key) const {
-    // Start traversal from the root node.
-    TrieNode* current = root;
-    // Iterate through each character of the key.
-    for (char ch : key) {
-        // If the character is not a child of the current node.
-        if (current->children.find(ch) == current->children.end()) {
-            // Key does not exist.
-            return false;
-        }
-        // Move to the child node.
-        current = current->children[ch];
-    }
-    // Return true if the traversal reached the end and it's marked as a key.
-    return current != nullptr && current->isEndOfKey;
+// Returns an iterator over the keys in [start, end), optionally descending.
+Trie::KeyIterator Trie::scanRange(std::string_view start, std::optional<std::string_view> end, bool reverse) const {
+    // The iterator.
+    KeyIterator it;
+    // Inclusive lower bound.
+    it.lowerBound = std::string(start);
+    // Nothing to resume after.
+    it.skipLowerBound = false;
+    // Exclusive upper bound, if any.
+    if (end) it.upperBound = std::string(*end);
+    // Direction.
+    it.reverse = reverse;
+    // An empty tree has nothing to visit.
+    if (root == nullptr) return it;
+    // Ascending: start at the lower bound.
+    if (!reverse) it.seekForward(root, it.lowerBound);
+    // Descending: start at the upper bound.
+    else if (it.upperBound) it.seekReverse(root, *it.upperBound);
+    // Descending without an upper bound: start at the largest key.
+    else it.stack.push_back({root, 255});
+    // Return the iterator.
+    return it;
 }
 
+// Returns up to limit keys starting with prefix, resuming from cursor.
+std::optional<PrefixPage> Trie::searchPrefix(const std::string& prefix, size_t limit, const std::string& cursor) const {
+    // Key to resume after (none on the first page).
+    std::optional<std::string> startAfter;
+    // Decode the cursor unless it starts the search.
+    if (cursor != CURSOR_START) {
+        // The last key of the previous page.
+        startAfter = decodeCursor(cursor);
+        // Reject cursors this Trie did not produce.
+        if (!startAfter) return std::nullopt;
+    }
+    // The page to fill.
+    PrefixPage page;
+    // An empty page leaves the position unchanged.
+    if (limit == 0) {
+        // Resume where the caller is.
+        page.nextCursor = cursor;
+        // Return the empty page.
+        return page;
+    }
+    // Walk the matching keys from the resume point.
+    KeyIterator it = scanPrefix(prefix, startAfter ? std::optional<std::string_view>(*startAfter) : std::nullopt);
+    // Copy keys until the page is full.
+    while (page.keys.size() < limit && it.next()) page.keys.emplace_back(it.key());
+    // A full page resumes after its last key if at least one more key follows.
+    page.nextCursor = page.keys.size() == limit && it.next() ? encodeCursor(page.keys.back()) : CURSOR_START;
+    // Return the page.
+    return page;
+}
 
-// Recursive helper for deleting a key (and pruning nodes).
-bool Trie::deleteKeyRecursive(TrieNode* node, const std::string& key, size_t depth) {
-    // If current node is null, key part not found.
-    if (!node) {
-        // Path for key does not exist.
-        return false;
+// Positions the stack on the first key not less than target below root.
+void Trie::KeyIterator::seekForward(const ArtNode* root, std::string_view target) {
+    // Node being descended into.
+    const ArtNode* node = root;
+    // Bytes of target matched so far.
+    size_t depth = 0;
+    // Follow target down the tree.
+    while (node != nullptr) {
+        // A leaf is compared by next() against the bounds.
+        if (node->type == ART_LEAF) {
+            // Visit it.
+            stack.push_back({node, -1});
+            // Done.
+            return;
+        }
+        // Inner node fields.
+        const ArtInner* inner = static_cast<const ArtInner*>(node);
+        // Every byte of the compressed path.
+        const uint8_t* path = fullPrefix(inner, depth);
+        // Bytes of target left.
+        size_t remaining = target.size() - depth;
+        // Path bytes that can be compared with target.
+        size_t limit = std::min<size_t>(inner->prefixLength, remaining);
+        // Compare the path with target.
+        for (size_t i = 0; i < limit; ++i) {
+            // Byte of target.
+            uint8_t wanted = keyByte(target, depth + i);
+            // Equal bytes continue the comparison.
+            if (path[i] == wanted) continue;
+            // A larger path byte puts every key below after target: visit the whole node.
+            if (path[i] > wanted) stack.push_back({node, -1});
+            // A smaller one puts every key below before target: skip the node.
+            return;
+        }
+        // Target ends within the path: every key below is at least target.
+        if (remaining <= inner->prefixLength) {
+            // Visit the whole node.
+            stack.push_back({node, -1});
+            // Done.
+            return;
+        }
+        // Skip past the path.
+        depth += inner->prefixLength;
+        // Next byte of target.
+        uint8_t byte = keyByte(target, depth);
+        // The terminal key is shorter than target (so smaller); after the child for byte, continue with larger bytes.
+        stack.push_back({node, byte + 1});
+        // Child on target's path.
+        ArtNode** child = findChild(const_cast<ArtNode*>(node), byte);
+        // No child: the larger bytes are all that is left.
+        if (child == nullptr) return;
+        // Descend.
+        node = *child;
+        // One more byte consumed.
+        depth++;
     }
+}
 
-    // If we are at the end of the key.
-    if (depth == key.length()) {
-        // If this node is marked as end of key.
-        if (node->isEndOfKey) {
-            // Unmark it as end of key.
-            node->isEndOfKey = false;
-            // Return true if this node has no children (can be deleted).
-            return node->children.empty();
+// Positions the stack on the last key not greater than target below root.
+void Trie::KeyIterator::seekReverse(const ArtNode* root, std::string_view target) {
+    // Node being descended into.
+    const ArtNode* node = root;
+    // Bytes of target matched so far.
+    size_t depth = 0;
+    // Follow target down the tree.
+    while (node != nullptr) {
+        // A leaf is compared by next() against the bounds.
+        if (node->type == ART_LEAF) {
+            // Visit it.
+            stack.push_back({node, -1});
+            // Done.
+            return;
         }
-        // Key not found as a complete word here.
-        return false;
+        // Inner node fields.
+        const ArtInner* inner = static_cast<const ArtInner*>(node);
+        // Every byte of the compressed path.
+        const uint8_t* path = fullPrefix(inner, depth);
+        // Bytes of target left.
+        size_t remaining = target.size() - depth;
+        // Path bytes that can be compared with target.
+        size_t limit = std::min<size_t>(inner->prefixLength, remaining);
+        // Compare the path with target.
+        for (size_t i = 0; i < limit; ++i) {
+            // Byte of target.
+            uint8_t wanted = keyByte(target, depth + i);
+            // Equal bytes continue the comparison.
+            if (path[i] == wanted) continue;
+            // A smaller path byte puts every key below before target: visit the whole node.
+            if (path[i] < wanted) stack.push_back({node, 255});
+            // A larger one puts every key below after target: skip the node.
+            return;
+        }
+        // Target ends inside the path: every key below extends past target (so is larger).
+        if (remaining < inner->prefixLength) return;
+        // Target ends right after the path: only the terminal key (equal to target) is not larger.
+        if (remaining == inner->prefixLength) {
+            // Visit just the terminal key.
+            stack.push_back({node, -1});
+            // Done.
+            return;
+        }
+        // Skip past the path.
+        depth += inner->prefixLength;
+        // Next byte of target.
+        uint8_t byte = keyByte(target, depth);
+        // After the child for byte, continue with smaller bytes and then the terminal key.
+        stack.push_back({node, byte - 1});
+        // Child on target's path.
+        ArtNode** child = findChild(const_cast<ArtNode*>(node), byte);
+        // No child: the smaller bytes are all that is left.
+        if (child == nullptr) return;
+        // Descend.
+        node = *child;
+        // One more byte consumed.
+        depth++;
     }
+}
+
+// Returns true if key is below the range.
+bool Trie::KeyIterator::belowRange(std::string_view key) const {
+    // Before the lower bound, or equal to it when resuming after it.
+    return key < lowerBound || (skipLowerBound && key == lowerBound);
+}
+
+// Returns true if key is above the range.
+bool Trie::KeyIterator::aboveRange(std::string_view key) const {
+    // At or after the exclusive upper bound.
+    return upperBound && key >= *upperBound;
+}
 
-    // Get the character for the current depth.
-    char ch = key[depth];
-    // If the character is not a child of the current node.
-    if (node->children.find(ch) == node->children.end()) {
-        // Key path does not exist further.
-        return false;
+// Advances to the next key.
+bool Trie::KeyIterator::next() {
+    // Walk until a key in range is found or the tree is exhausted.
+    while (!stack.empty()) {
+        // Node on top of the stack.
+        Frame& frame = stack.back();
+        // Key reached in this step.
+        std::string_view key;
+        // A leaf is visited once.
+        if (frame.node->type == ART_LEAF) {
+            // Its key.
+            key = leafKey(static_cast<const ArtLeaf*>(frame.node));
+            // Done with it.
+            stack.pop_back();
+        } else if (!reverse && frame.nextByte < 0) {
+            // Ascending: children follow the terminal key.
+            frame.nextByte = 0;
+            // Inner node fields.
+            const ArtInner* inner = static_cast<const ArtInner*>(frame.node);
+            // Nothing ends here: go on to the children.
+            if (inner->terminal == nullptr) continue;
+            // The key ending here sorts before every key below.
+            key = leafKey(inner->terminal);
+        } else if (reverse && frame.nextByte < 0) {
+            // Descending: the terminal key comes after every child.
+            const ArtLeaf* terminal = static_cast<const ArtInner*>(frame.node)->terminal;
+            // Done with the node.
+            stack.pop_back();
+            // Nothing ends here: return to the parent.
+            if (terminal == nullptr) continue;
+            // The key ending here sorts before every key below.
+            key = leafKey(terminal);
+        } else {
+            // Byte of the next child.
+            uint8_t byte = 0;
+            // Next child in the walk's direction.
+            const ArtNode* child = nullptr;
+            // Ascending: the smallest child at or after nextByte.
+            if (!reverse && frame.nextByte <= 255) child = childAtOrAfter(frame.node, frame.nextByte, byte);
+            // Descending: the largest child at or before nextByte.
+            if (reverse) child = childAtOrBefore(frame.node, frame.nextByte, byte);
+            // No children left.
+            if (child == nullptr) {
+                // Ascending: done with the node; descending: the terminal key is next.
+                if (!reverse) stack.pop_back();
+                else frame.nextByte = -1;
+                // Continue.
+                continue;
+            }
+            // Resume past this child later.
+            frame.nextByte = reverse ? byte - 1 : byte + 1;
+            // Visit the child next, from its first key in the walk's direction.
+            stack.push_back({child, reverse ? 255 : -1});
+            // Continue with it.
+            continue;
+        }
+        // Keys are visited in order, so a key past the far end of the range ends the scan.
+        if (reverse ? belowRange(key) : aboveRange(key)) {
+            // Release the stack.
+            stack.clear();
+            // No more keys.
+            return false;
+        }
+        // Skip keys before the near end (only reached on the path the seek followed).
+        if (reverse ? aboveRange(key) : belowRange(key)) continue;
+        // Position on the key.
+        currentKey = key;
+        // A key was found.
+        return true;
     }
+    // The tree is exhausted.
+    return false;
+}
 
-    // Recursively call delete for the child corresponding to char ch.
-    bool shouldDeleteChild = deleteKeyRecursive(node->children[ch], key, depth + 1);
+// Returns the current key.
+std::string_view Trie::KeyIterator::key() const {
+    // Points into the leaf.
+    return currentKey;
+}
 
-    // If the child node should be deleted (it became empty and was part of the key).
-    if (shouldDeleteChild) {
-        // Delete the child node from memory.
-        delete node->children[ch];
-        // Remove the child from the current node's children map.
-        node->children.erase(ch);
-        // Return true if current node can also be deleted (no other children and not end of another key).
-        return !node->isEndOfKey && node->children.empty();
+// Checks if a key exists in the Trie.
+bool Trie::contains(std::string_view key) const {
+    // Start traversal from the root node.
+    const ArtNode* node = root;
+    // Bytes of the key consumed so far.
+    size_t depth = 0;
+    // Descend until a leaf or a dead end.
+    while (node != nullptr) {
+        // A leaf holds the full key: compare it (this also verifies any skipped path bytes).
+        if (node->type == ART_LEAF) return leafKey(static_cast<const ArtLeaf*>(node)) == key;
+        // Inner node fields.
+        const ArtInner* inner = static_cast<const ArtInner*>(node);
+        // Check the inline part of the compressed path.
+        if (!prefixMatchesOptimistic(inner, key, depth)) return false;
+        // Skip past the path.
+        depth += inner->prefixLength;
+        // The key ends here: it is present only as this node's terminal key.
+        if (depth == key.size()) return inner->terminal != nullptr && leafKey(inner->terminal) == key;
+        // Child for the next byte.
+        ArtNode** child = findChild(const_cast<ArtNode*>(node), keyByte(key, depth));
+        // Key does not exist.
+        if (child == nullptr) return false;
+        // Descend.
+        node = *child;
+        // One more byte consumed.
+        depth++;
     }
-    // Child should not be deleted, so this node should also not be deleted.
+    // Reached an empty slot.
     return false;
 }
 
+// Recursive helper for deleting a key below the node in ref, which starts at depth.
+bool Trie::removeRecursive(ArtNode*& ref, std::string_view key, size_t depth) {
+    // Nothing here.
+    if (ref == nullptr) return false;
+    // A leaf is removed if it holds the key.
+    if (ref->type == ART_LEAF) {
+        // Compare the full key.
+        if (leafKey(static_cast<ArtLeaf*>(ref)) != key) return false;
+        // Free it.
+        freeLeaf(static_cast<ArtLeaf*>(ref));
+        // Empty the slot (only the root is ever a bare leaf slot; children are removed by their parent).
+        ref = nullptr;
+        // Removed.
+        return true;
+    }
+    // Inner node fields.
+    ArtInner* inner = static_cast<ArtInner*>(ref);
+    // The key must follow the whole compressed path.
+    if (prefixMismatch(inner, key, depth) != inner->prefixLength) return false;
+    // Skip past the path.
+    depth += inner->prefixLength;
+    // The key ends at this node.
+    if (depth == key.size()) {
+        // It must be the terminal key.
+        if (inner->terminal == nullptr || leafKey(inner->terminal) != key) return false;
+        // Free it.
+        freeLeaf(inner->terminal);
+        // Clear the slot.
+        inner->terminal = nullptr;
+        // A Node4 may no longer branch.
+        collapse(ref);
+        // Removed.
+        return true;
+    }
+    // The next byte.
+    uint8_t byte = keyByte(key, depth);
+    // Child for it.
+    ArtNode** child = findChild(ref, byte);
+    // Key path does not exist further.
+    if (child == nullptr) return false;
+    // A leaf child is unlinked here so the node can shrink.
+    if ((*child)->type == ART_LEAF) {
+        // Compare the full key.
+        if (leafKey(static_cast<ArtLeaf*>(*child)) != key) return false;
+        // Free the leaf.
+        freeLeaf(static_cast<ArtLeaf*>(*child));
+        // Remove its slot (shrinking or collapsing this node).
+        removeChild(ref, byte);
+        // Removed.
+        return true;
+    }
+    // Recurse into an inner child (which collapses itself if needed).
+    if (!removeRecursive(*child, key, depth + 1)) return false;
+    // Unlink the child if it collapsed to nothing.
+    if (*child == nullptr) removeChild(ref, byte);
+    // Removed.
+    return true;
+}
+
 // Deletes a key from the Trie. Returns true if key was found and deleted.
-bool Trie::remove(const std::string& key) {
-    // If the key is empty, nothing to remove.
-    if (key.empty()) return false;
-    // Start recursive deletion from the root.
-    if (!contains(key)) return false;
-    // Call the recursive helper starting from root at depth 0.
-    deleteKeyRecursive(root, key, 0);
-    // Return true, assuming if contains was true, it's processed.
-    return true; 
\ No newline at end of file
+bool Trie::remove(std::string_view key) {
+    // Remove it, counting success (the empty key is a bare-leaf root or the root's terminal slot).
+    if (!removeRecursive(root, key, 0)) return false;
+    // One fewer key.
+    keyCount--;
+    // Removed.
+    return true;
+}
+
+// Returns the number of keys in the Trie.
+size_t Trie::size() const {
+    // Maintained by insert and remove.
+    return keyCount;
+}
+
+// Returns the bytes allocated for nodes and leaves.
+size_t Trie::memoryUsage() const {
+    // Maintained by every allocation and free.
+    return allocatedBytes;
+}
+
+// Returns the number of nodes: inner nodes plus one leaf per key.
+size_t Trie::nodeCount() const {
+    // Every key is exactly one leaf.
+    return innerNodes + keyCount;
+}
@@ -1,46 +1,209 @@
 #include "../include/utils.hpp"
+#include <cstring> // For std::memcpy
+#include <chrono> // For the wall clock
+#include <mutex> // For the thread index allocator
+#include <vector> // For the free thread indices
 
-// Contains utility functions, like hash functions for the Bloom filter.
+// Contains utility functions, like the key hash shared by every data structure.
 namespace Utils {
 
-    // First hash function for Bloom Filter (example: simple variant of DJB2).
-    unsigned int hashFunction1(const std::string& key) {
-        // Initialize hash value.
-        unsigned int hash = 5381;
-        // Iterate through each character of the key.
-        for (char c : key) {
-            // Update hash: hash * 33 + c.
-            hash = ((hash << 5) + hash) + c; // hash * 33 + c
+    namespace {
+        // Hands out small per-thread indices, reusing those of exited threads so they stay below the live thread count.
+        class ThreadIndex {
+        private:
+            // Guards the allocator (taken only when a thread asks for its index first and when it exits).
+            static std::mutex& allocatorLock() {
+                // Constructed on first use.
+                static std::mutex lock;
+                // Share it.
+                return lock;
+            }
+            // Indices of exited threads.
+            static std::vector<size_t>& freeIndices() {
+                // Constructed on first use.
+                static std::vector<size_t> indices;
+                // Share them.
+                return indices;
+            }
+            // Next index never handed out.
+            static size_t& nextIndex() {
+                // Starts at 0.
+                static size_t next = 0;
+                // Share it.
+                return next;
+            }
+
+        public:
+            // This thread's index.
+            size_t value;
+
+            // Constructor: takes a free index.
+            ThreadIndex() {
+                // Serialize with other threads starting or exiting.
+                std::lock_guard<std::mutex> lock(allocatorLock());
+                // Reuse an exited thread's index.
+                if (!freeIndices().empty()) {
+                    // The most recent one.
+                    value = freeIndices().back();
+                    // Taken.
+                    freeIndices().pop_back();
+                } else {
+                    // A new one.
+                    value = nextIndex()++;
+                }
+            }
+
+            // Destructor: hands the index back (the thread is done with every slot it indexed).
+            ~ThreadIndex() {
+                // Serialize with other threads starting or exiting.
+                std::lock_guard<std::mutex> lock(allocatorLock());
+                // Free for the next thread.
+                freeIndices().push_back(value);
+            }
+        };
+
+        // Default wyhash secret (odd constants with balanced bits).
+        const uint64_t SECRET[4] = {
+            0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull, 0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull
+        };
+
+        // 64x64 -> 128-bit multiply; returns the low half in a and the high half in b.
+        inline void multiply128(uint64_t& a, uint64_t& b) {
+            // Full-width product.
+            __uint128_t product = static_cast<__uint128_t>(a) * b;
+            // Low 64 bits.
+            a = static_cast<uint64_t>(product);
+            // High 64 bits.
+            b = static_cast<uint64_t>(product >> 64);
+        }
+
+        // Multiplies and folds the two halves together.
+        inline uint64_t mix(uint64_t a, uint64_t b) {
+            // Wide multiply.
+            multiply128(a, b);
+            // Fold.
+            return a ^ b;
         }
-        // Return the computed hash.
-        return hash;
-    }
 
-    // Second hash function for Bloom Filter (example: SDBM hash).
-    unsigned int hashFunction2(const std::string& key) {
-        // Initialize hash value.
-        unsigned int hash = 0;
-        // Iterate through each character of the key.
-        for (char c : key) {
-            // Update hash: c + (hash << 6) + (hash << 16) - hash.
-            hash = c + (hash << 6) + (hash << 16) - hash;
+        // Reads 8 little-endian bytes.
+        inline uint64_t read8(const unsigned char* p) {
+            // Unaligned-safe load.
+            uint64_t value;
+            // Copy the bytes.
+            std::memcpy(&value, p, 8);
+            // Return the word.
+            return value;
+        }
+
+        // Reads 4 little-endian bytes.
+        inline uint64_t read4(const unsigned char* p) {
+            // Unaligned-safe load.
+            uint32_t value;
+            // Copy the bytes.
+            std::memcpy(&value, p, 4);
+            // Return the word widened.
+            return value;
+        }
+
+        // Reads 1 to 3 bytes into one word.
+        inline uint64_t read3(const unsigned char* p, size_t k) {
+            // First, middle and last byte cover every length from 1 to 3.
+            return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[k >> 1]) << 8) | p[k - 1];
         }
-        // Return the computed hash.
-        return hash;
     }
-    
-    // Third hash function for Bloom Filter (example: a different multiplicative hash).
-    unsigned int hashFunction3(const std::string& key) {
-        // Initialize hash value.
-        unsigned int hash = 0;
-        // A prime number for multiplication.
-        unsigned int prime = 31;
-        // Iterate through each character of the key.
-        for (char c : key) {
-            // Update hash: (hash * prime) + c.
-            hash = (hash * prime) + c;
+
+    // Fast, high-quality 64-bit hash (wyhash family).
+    uint64_t hash64(std::string_view key) {
+        // Byte pointer to the key.
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(key.data());
+        // Key length.
+        size_t len = key.size();
+        // Seed the state from the secret.
+        uint64_t seed = mix(SECRET[0], SECRET[1]);
+        // The two words fed to the final mix.
+        uint64_t a;
+        // Second word.
+        uint64_t b;
+        // Short keys: read overlapping words covering the whole key without a loop.
+        if (len <= 16) {
+            // 4..16 bytes: four overlapping 4-byte reads.
+            if (len >= 4) {
+                // First and middle words.
+                a = (read4(p) << 32) | read4(p + ((len >> 3) << 2));
+                // Last and mirrored-middle words.
+                b = (read4(p + len - 4) << 32) | read4(p + len - 4 - ((len >> 3) << 2));
+            // 1..3 bytes.
+            } else if (len > 0) {
+                // Pack the bytes.
+                a = read3(p, len);
+                // Nothing else.
+                b = 0;
+            // Empty key.
+            } else {
+                // Both words zero.
+                a = b = 0;
+            }
+        } else {
+            // Bytes left to consume.
+            size_t i = len;
+            // Long keys: three independent lanes of 16 bytes each per iteration.
+            if (i > 48) {
+                // Second lane state.
+                uint64_t lane1 = seed;
+                // Third lane state.
+                uint64_t lane2 = seed;
+                // Consume 48 bytes per iteration.
+                do {
+                    // Lane 0.
+                    seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                    // Lane 1.
+                    lane1 = mix(read8(p + 16) ^ SECRET[2], read8(p + 24) ^ lane1);
+                    // Lane 2.
+                    lane2 = mix(read8(p + 32) ^ SECRET[3], read8(p + 40) ^ lane2);
+                    // Advance.
+                    p += 48;
+                    // Count the bytes.
+                    i -= 48;
+                } while (i > 48);
+                // Merge the lanes.
+                seed ^= lane1 ^ lane2;
+            }
+            // Remaining whole 16-byte blocks.
+            while (i > 16) {
+                // Mix one block.
+                seed = mix(read8(p) ^ SECRET[1], read8(p + 8) ^ seed);
+                // Count the bytes.
+                i -= 16;
+                // Advance.
+                p += 16;
+            }
+            // Last 16 bytes (overlapping the previous block when needed).
+            a = read8(p + i - 16);
+            // Second half.
+            b = read8(p + i - 8);
         }
-        // Return the computed hash.
-        return hash;
+        // Combine with the secret and seed.
+        a ^= SECRET[1];
+        // Fold in the running state.
+        b ^= seed;
+        // Wide multiply.
+        multiply128(a, b);
+        // Final avalanche including the length.
+        return mix(a ^ SECRET[0] ^ len, b ^ SECRET[1]);
+    }
+
+    // Returns the current wall-clock time in milliseconds since the Unix epoch.
+    uint64_t unixMillis() {
+        // System clock, so deadlines keep their meaning across restarts.
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    // Returns a small index unique among the live threads, assigned on the thread's first call.
+    size_t threadIndex() {
+        // One per thread.
+        thread_local ThreadIndex index;
+        // Report it.
+        return index.value;
     }
-}
\ No newline at end of file
+}
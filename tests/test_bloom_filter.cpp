@@ -1,4 +1,6 @@
 #include "../include/bloom_filter.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <string>
 #include <iostream>
 #include <cassert>
 
@@ -36,6 +38,81 @@ int main() {
     bool datePossiblyExists = filter.possiblyContains("date");
     // Print info about "date" check.
     std::cout << "Info: 'date' possiblyContains result: " << (datePossiblyExists ? "true (potential false positive)" : "false (definitely not present)") << std::endl;
+    // Test 5: The precomputed-hash overloads agree with the key overloads.
+    BloomFilter hashedFilter(1000, 4);
+    // Add keys by precomputed hash.
+    for (int i = 0; i < 50; ++i) {
+        // Add key i through its hash.
+        hashedFilter.add(Utils::hash64("hashed_" + std::to_string(i)));
+    }
+    // Every key must be reported by both lookup overloads.
+    for (int i = 0; i < 50; ++i) {
+        // Key i.
+        std::string key = "hashed_" + std::to_string(i);
+        // Assert that the key overload sees it.
+        assert(hashedFilter.possiblyContains(key));
+        // Assert that the hash overload sees it.
+        assert(hashedFilter.possiblyContains(Utils::hash64(key)));
+    }
+    // Assert that the hash is deterministic.
+    assert(Utils::hash64("hashed_0") == Utils::hash64(std::string("hashed_0")));
+    // Print pass message for test 5.
+    std::cout << "Test 5 (precomputed-hash overloads) PASSED." << std::endl;
+
+    // Test 6: A filter sized for n keys at a target rate achieves about that rate.
+    const double targetRates[] = {0.05, 0.01, 0.001};
+    // Number of keys inserted.
+    const size_t numKeys = 100000;
+    // Number of absent keys probed.
+    const size_t numProbes = 200000;
+    // Measure each target.
+    for (double target : targetRates) {
+        // Size the filter from the expected key count and target rate.
+        BloomFilter sized = BloomFilter::forExpectedKeys(numKeys, target);
+        // Insert the keys.
+        for (size_t i = 0; i < numKeys; ++i) {
+            // Add key i.
+            sized.add("member_" + std::to_string(i));
+        }
+        // Assert that there are no false negatives.
+        for (size_t i = 0; i < numKeys; ++i) {
+            // Key i must be reported.
+            assert(sized.possiblyContains("member_" + std::to_string(i)));
+        }
+        // Count false positives among keys never added.
+        size_t falsePositives = 0;
+        // Probe the absent keys.
+        for (size_t i = 0; i < numProbes; ++i) {
+            // Count a positive answer.
+            if (sized.possiblyContains("absent_" + std::to_string(i))) falsePositives++;
+        }
+        // Achieved false-positive rate.
+        double measured = static_cast<double>(falsePositives) / static_cast<double>(numProbes);
+        // Print the measurement.
+        std::cout << "Info: target FPR " << target << " -> measured " << measured << " (" << sized.numBits() / 8
+                  << " bytes, k=" << sized.numHashes() << ", estimate "
+                  << BloomFilter::estimateFalsePositiveRate(sized.numBits(), sized.numHashes(), numKeys) << ")" << std::endl;
+        // Assert that the achieved rate is within 1.5x of the target (sampling noise included).
+        assert(measured <= target * 1.5);
+    }
+    // Print pass message for test 6.
+    std::cout << "Test 6 (sized from expected keys and target FPR) PASSED." << std::endl;
+
+    // Test 7: k is not limited to a fixed set of hash functions, and sizes round up to whole cache-line blocks.
+    BloomFilter manyHashes(1000, 12);
+    // Assert that the size was rounded up to two 512-bit blocks.
+    assert(manyHashes.numBits() == 2 * BloomFilter::BLOCK_BITS);
+    // Assert that all twelve bits per key are kept.
+    assert(manyHashes.numHashes() == 12);
+    // Add a key.
+    manyHashes.add("twelve");
+    // Assert that it is found.
+    assert(manyHashes.possiblyContains("twelve"));
+    // Assert that an empty filter rejects everything.
+    assert(!BloomFilter(0, 3).possiblyContains("anything"));
+    // Print pass message for test 7.
+    std::cout << "Test 7 (unlimited k, block rounding) PASSED." << std::endl;
+
     // Print completion message for BloomFilter tests.
     std::cout << "BloomFilter Tests completed (interpret results considering probabilistic nature)." << std::endl;
     // Return 0 indicating successful execution.
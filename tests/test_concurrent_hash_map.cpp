@@ -0,0 +1,215 @@
+#include "../include/concurrent_hash_map.hpp"
+#include "../include/epoch_manager.hpp"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory> // For std::make_unique
+
+namespace {
+    // Objects freed by countingDestroy.
+    std::atomic<size_t> destroyedObjects{0};
+
+    // EpochManager destroy callback that frees an int and counts it.
+    void countingDestroy(void* pointer) {
+        // Allocated by the test.
+        delete static_cast<int*>(pointer);
+        // Count it.
+        destroyedObjects.fetch_add(1);
+    }
+}
+
+// Main function for testing ConcurrentHashMap and EpochManager.
+int main() {
+    // Print start message for ConcurrentHashMap tests.
+    std::cout << "Running ConcurrentHashMap Tests..." << std::endl;
+
+    // Test 1: Single-threaded set/get/update/remove, through several rebuilds.
+    ConcurrentHashMap map(16);
+    // Capacity before growing.
+    size_t initialCapacity = map.capacity();
+    // Insert enough keys to rebuild several times.
+    for (int i = 0; i < 5000; ++i) {
+        // New keys report an insert.
+        assert(map.set("key" + std::to_string(i), "value" + std::to_string(i)) == true);
+    }
+    // Assert that every key was stored.
+    assert(map.size() == 5000);
+    // Assert that the table grew.
+    assert(map.capacity() > initialCapacity);
+    // Reused buffer for reads.
+    std::string value;
+    // Assert that every key reads back.
+    for (int i = 0; i < 5000; ++i) {
+        // Present.
+        assert(map.get("key" + std::to_string(i), value) && value == "value" + std::to_string(i));
+    }
+    // Assert that an update reports it and replaces the value.
+    assert(map.set("key42", "updated") == false && map.get("key42", value) && value == "updated");
+    // Assert that the size did not change.
+    assert(map.size() == 5000);
+    // Assert that removing works and reports presence.
+    assert(map.remove("key42") == true && !map.contains("key42") && !map.get("key42", value));
+    // Assert that removing again reports absence.
+    assert(map.remove("key42") == false);
+    // Assert that the key can come back (into its tombstone).
+    assert(map.set("key42", "back") == true && map.get("key42", value) && value == "back");
+    // Remove every other key.
+    for (int i = 0; i < 5000; i += 2) map.remove("key" + std::to_string(i));
+    // Assert that the right half is left.
+    assert(map.size() == 2500 && !map.contains("key0") && map.contains("key1"));
+    // Churn through tombstones: inserting and removing new keys must purge them rather than fill the table.
+    for (int i = 0; i < 20000; ++i) {
+        // Insert.
+        map.set("churn" + std::to_string(i), "x");
+        // And remove.
+        map.remove("churn" + std::to_string(i));
+    }
+    // Assert that the survivors are intact.
+    assert(map.size() == 2500 && map.get("key4999", value) && value == "value4999");
+    // Assert that empty keys and values work.
+    assert(map.set("", "") == true && map.get("", value) && value.empty());
+    // Print pass message for test 1.
+    std::cout << "Test 1 (set/get/update/remove with rebuilds) PASSED." << std::endl;
+
+    // Test 2: Retired memory is freed only after every reader pinned before it left.
+    {
+        // Attempt reclamation on every retirement.
+        EpochManager epochs(1);
+        // Pin an epoch on this thread.
+        auto guard = std::make_unique<EpochManager::Guard>(epochs);
+        // Nested guards are free and leave the pin alone.
+        { EpochManager::Guard nested(epochs); }
+        // Retire a few objects while pinned.
+        for (int i = 0; i < 10; ++i) epochs.retire(new int(i), countingDestroy);
+        // Reclaim repeatedly: the pinned reader may still hold them.
+        for (int i = 0; i < 10; ++i) epochs.reclaim();
+        // Assert that nothing was freed.
+        assert(destroyedObjects.load() == 0 && epochs.pending() == 10);
+        // Leave.
+        guard.reset();
+        // Two epochs later they are safe.
+        for (int i = 0; i < 3; ++i) epochs.reclaim();
+        // Assert that all of them were freed.
+        assert(destroyedObjects.load() == 10 && epochs.pending() == 0 && epochs.freed() == 10);
+        // A reader on another thread holds the epoch just the same.
+        std::atomic<int> phase{0};
+        // The reader.
+        std::thread reader([&epochs, &phase]() {
+            // Pin.
+            EpochManager::Guard pinned(epochs);
+            // Tell the writer.
+            phase.store(1);
+            // Hold it until told to leave.
+            while (phase.load() != 2) std::this_thread::yield();
+        });
+        // Wait for the pin.
+        while (phase.load() != 1) std::this_thread::yield();
+        // Retire one.
+        epochs.retire(new int(0), countingDestroy);
+        // Try hard.
+        for (int i = 0; i < 10; ++i) epochs.reclaim();
+        // Assert that it survived.
+        assert(destroyedObjects.load() == 10);
+        // Let the reader go.
+        phase.store(2);
+        // Wait for it.
+        reader.join();
+        // Now it can go.
+        for (int i = 0; i < 3; ++i) epochs.reclaim();
+        // Assert that it was freed.
+        assert(destroyedObjects.load() == 11);
+        // Whatever is still retired is freed with the manager.
+        epochs.retire(new int(0), countingDestroy);
+    }
+    // Assert that the destructor freed the last one.
+    assert(destroyedObjects.load() == 12);
+    // Print pass message for test 2.
+    std::cout << "Test 2 (epoch reclamation) PASSED." << std::endl;
+
+    // Test 3: Lock-free readers alongside a writer always see a consistent value.
+    ConcurrentHashMap stressMap;
+    // Keys the writer cycles through.
+    const int numKeys = 1000;
+    // Start every key at version 0.
+    for (int i = 0; i < numKeys; ++i) stressMap.set("key" + std::to_string(i), "key" + std::to_string(i) + ":0");
+    // Tells the readers to stop.
+    std::atomic<bool> done{false};
+    // Reads that found a torn or foreign value.
+    std::atomic<size_t> badReads{0};
+    // Reads that found the key.
+    std::atomic<size_t> hits{0};
+    // Reader threads.
+    std::vector<std::thread> readers;
+    // Four readers.
+    for (int r = 0; r < 4; ++r) {
+        // Each reads keys in its own order.
+        readers.emplace_back([&stressMap, &done, &badReads, &hits, r, numKeys]() {
+            // Reused buffer.
+            std::string read;
+            // Local counts.
+            size_t bad = 0, found = 0;
+            // Until the writer finishes.
+            for (size_t i = static_cast<size_t>(r); !done.load(std::memory_order_relaxed); i += 7) {
+                // The key.
+                std::string key = "key" + std::to_string(i % numKeys);
+                // Absent while the writer has it removed.
+                if (!stressMap.get(key, read)) continue;
+                // Count it.
+                ++found;
+                // The value always names its own key.
+                if (read.compare(0, key.size() + 1, key + ":") != 0) ++bad;
+            }
+            // Publish.
+            badReads.fetch_add(bad);
+            // Publish.
+            hits.fetch_add(found);
+        });
+    }
+    // The writer: updates, removes and re-inserts, and grows the map with new keys (forcing rebuilds).
+    for (int round = 1; round <= 20; ++round) {
+        // Each key.
+        for (int i = 0; i < numKeys; ++i) {
+            // The key.
+            std::string key = "key" + std::to_string(i);
+            // A new version.
+            stressMap.set(key, key + ":" + std::to_string(round));
+            // Every tenth key is removed and comes back.
+            if (i % 10 == round % 10) {
+                // Gone.
+                stressMap.remove(key);
+                // Back.
+                stressMap.set(key, key + ":" + std::to_string(round));
+            }
+        }
+        // Grow the table.
+        for (int i = 0; i < 500; ++i) stressMap.set("grow" + std::to_string(round) + ":" + std::to_string(i), "grow" + std::to_string(round) + ":" + std::to_string(i) + ":v");
+    }
+    // Stop the readers.
+    done.store(true);
+    // Wait for them.
+    for (std::thread& reader : readers) reader.join();
+    // Assert that no reader saw a torn or mismatched value.
+    assert(badReads.load() == 0);
+    // Assert that the contents are what the writer left.
+    assert(stressMap.size() == static_cast<size_t>(numKeys + 20 * 500));
+    // Final read of a key.
+    std::string last;
+    // Assert that it holds the final version.
+    assert(stressMap.get("key7", last) && last == "key7:20");
+    // With no readers left, everything retired can be freed.
+    for (int i = 0; i < 3; ++i) stressMap.reclaim();
+    // Assert that nothing is left in limbo.
+    assert(stressMap.pendingReclamation() == 0);
+    // Print reclamation statistics.
+    std::cout << "Info: " << hits.load() << " reads hit, " << stressMap.reclaimedCount() << " records and tables reclaimed." << std::endl;
+    // Print pass message for test 3.
+    std::cout << "Test 3 (readers alongside a writer) PASSED." << std::endl;
+
+    // Print final success message.
+    std::cout << "All ConcurrentHashMap Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
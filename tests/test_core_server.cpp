@@ -0,0 +1,365 @@
+#include "../include/core_server.hpp"
+#include "../include/resp.hpp"
+#include "../include/utils.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <thread> // For the producer and the cores
+#include <algorithm> // For std::min
+#include <cstdio> // For std::remove
+#include <unistd.h> // For read, write, close
+#include <sys/socket.h> // For client sockets
+#include <netinet/in.h> // For sockaddr_in
+#include <arpa/inet.h> // For inet_pton
+
+namespace {
+    // Cores of the live tests (more than this machine may have; they then share CPUs).
+    constexpr size_t CORES = 4;
+
+    // Opens a blocking client connection to the server on localhost.
+    int connectTo(uint16_t port) {
+        // TCP socket.
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        // Assert that it was created.
+        assert(fd >= 0);
+        // Server address.
+        sockaddr_in address{};
+        // IPv4.
+        address.sin_family = AF_INET;
+        // Port in network order.
+        address.sin_port = htons(port);
+        // Loopback.
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        // Connect.
+        int connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        // Assert that it worked.
+        assert(connected == 0);
+        // Never block a failing test forever.
+        timeval timeout{5, 0};
+        // Apply it to reads.
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        // Hand it back.
+        return fd;
+    }
+
+    // Sends all of data.
+    void sendAll(int fd, const std::string& data) {
+        // Bytes sent so far.
+        size_t sent = 0;
+        // Until everything went out.
+        while (sent < data.size()) {
+            // Send the rest.
+            ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+            // Assert that the socket is healthy.
+            assert(n > 0);
+            // Past it.
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // Reads exactly length bytes (fewer only if the server hangs up).
+    std::string readExactly(int fd, size_t length) {
+        // Bytes received.
+        std::string data;
+        // Read chunk.
+        char buffer[16384];
+        // Until the expected reply arrived.
+        while (data.size() < length) {
+            // Read what is there.
+            ssize_t n = ::read(fd, buffer, std::min(sizeof(buffer), length - data.size()));
+            // Hung up (or timed out).
+            if (n <= 0) break;
+            // Keep it.
+            data.append(buffer, static_cast<size_t>(n));
+        }
+        // Hand it back.
+        return data;
+    }
+
+    // Sends request and returns the reply, which must be as long as expected.
+    std::string roundTrip(int fd, const std::string& request, const std::string& expected) {
+        // Send it.
+        sendAll(fd, request);
+        // Read the reply.
+        return readExactly(fd, expected.size());
+    }
+
+    // Encodes a command as a RESP array of bulk strings.
+    std::string command(const std::vector<std::string>& words) {
+        // Encoded bytes.
+        std::string out;
+        // Array header.
+        Resp::appendArrayHeader(out, words.size());
+        // Each word as a bulk string.
+        for (const std::string& word : words) Resp::appendBulkString(out, word);
+        // Hand it back.
+        return out;
+    }
+
+    // A batch of one message carrying number.
+    std::vector<CoreMessage> batchOf(int64_t number) {
+        // The batch.
+        std::vector<CoreMessage> batch(1);
+        // Tag it.
+        batch[0].count = number;
+        // Hand it back.
+        return batch;
+    }
+
+    // Runs Tests 3-5 against a live group of CORES cores using backend (label names it in the output).
+    void testLiveCores(ServerBackend backend, const std::string& label) {
+        // Settings every core starts from.
+        ServerConfig config;
+        // Any free port.
+        config.port = 0;
+        // Requested backend.
+        config.backend = backend;
+        // Short ticks keep shutdown quick.
+        config.tickIntervalMs = 10;
+        // Snapshots of this run (one file per core).
+        config.snapshotPath = "/tmp/kv_core_server_test_" + std::to_string(::getpid()) + ".kvs";
+        // The group.
+        CoreServer server(CORES, KVStoreConfig(), config);
+        // Assert that every core listens.
+        assert(server.start());
+        // Assert that a port was picked.
+        assert(server.port() != 0);
+        // Serve in the background (each core on its own thread).
+        std::thread loop([&server]() { server.run(); });
+
+        // Test 3: Commands on keys owned by other cores, and multi-key commands spanning them, answer as on one core.
+        {
+            // One client (served by whichever core accepted it).
+            int fd = connectTo(server.port());
+            // Pairs spread over every core.
+            std::vector<std::string> pairs = {"MSET"};
+            // Twenty keys.
+            for (int i = 0; i < 20; ++i) {
+                // The key.
+                pairs.push_back("user:" + std::to_string(i));
+                // Its value.
+                pairs.push_back("v" + std::to_string(i));
+            }
+            // Write them in one command.
+            assert(roundTrip(fd, command(pairs), "+OK\r\n") == "+OK\r\n");
+            // Read them back in a different order, with a missing key in the middle.
+            std::vector<std::string> keys = {"MGET", "user:19", "user:3", "missing", "user:0", "user:11"};
+            // Values in the order asked.
+            std::string expected = "*5\r\n$3\r\nv19\r\n$2\r\nv3\r\n$-1\r\n$2\r\nv0\r\n$3\r\nv11\r\n";
+            // Assert the merged reply.
+            assert(roundTrip(fd, command(keys), expected) == expected);
+            // Each request and its exact reply.
+            std::vector<std::pair<std::string, std::string>> exchanges = {
+                {command({"GET", "user:7"}), "$2\r\nv7\r\n"},
+                {command({"SET", "session", "x", "EX", "100"}), "+OK\r\n"},
+                {command({"TTL", "session"}), ":100\r\n"},
+                {command({"PERSIST", "session"}), ":1\r\n"},
+                {command({"EXISTS", "user:1", "user:2", "missing", "session"}), ":3\r\n"},
+                {command({"DBSIZE"}), ":21\r\n"},
+                {command({"PREFIX", "user:1"}), "*11\r\n$6\r\nuser:1\r\n$7\r\nuser:10\r\n$7\r\nuser:11\r\n$7\r\nuser:12\r\n$7\r\nuser:13\r\n"
+                                                "$7\r\nuser:14\r\n$7\r\nuser:15\r\n$7\r\nuser:16\r\n$7\r\nuser:17\r\n$7\r\nuser:18\r\n$7\r\nuser:19\r\n"},
+                {command({"DEL", "user:0", "user:1", "user:2", "missing"}), ":3\r\n"},
+                {command({"DBSIZE"}), ":18\r\n"},
+                {command({"SAVE"}), "+OK\r\n"},
+                {command({"GET"}), "-ERR wrong number of arguments for 'get' command\r\n"},
+                {command({"MSET", "a"}), "-ERR wrong number of arguments for 'mset' command\r\n"},
+                {command({"PING"}), "+PONG\r\n"},
+            };
+            // Run them one at a time.
+            for (const std::pair<std::string, std::string>& exchange : exchanges) {
+                // Assert the reply.
+                assert(roundTrip(fd, exchange.first, exchange.second) == exchange.second);
+            }
+            // Every core wrote its own snapshot.
+            for (size_t i = 0; i < CORES; ++i) {
+                // Its file.
+                std::string path = config.snapshotPath + "." + std::to_string(i);
+                // Assert that it exists, then clean up.
+                assert(std::remove(path.c_str()) == 0);
+            }
+            // Done with it.
+            ::close(fd);
+            // Print success message for Test 3.
+            std::cout << "Test 3 (Forwarded and scatter-gather commands) PASSED [" << label << "]." << std::endl;
+        }
+
+        // Test 4: Pipelines mixing local and forwarded commands are answered in order on every connection.
+        {
+            // Several clients, so the kernel spreads them over the cores.
+            std::vector<int> clients;
+            // Open them.
+            for (int c = 0; c < 8; ++c) clients.push_back(connectTo(server.port()));
+            // Each client's pipeline and its replies.
+            std::vector<std::string> requests(clients.size());
+            // Replies.
+            std::vector<std::string> expected(clients.size());
+            // Build them.
+            for (size_t c = 0; c < clients.size(); ++c) {
+                // 300 writes, reads and multi-key reads.
+                for (int i = 0; i < 100; ++i) {
+                    // Key of this client.
+                    std::string key = "pipe:" + std::to_string(c) + ":" + std::to_string(i);
+                    // Write it.
+                    requests[c] += command({"SET", key, "value" + std::to_string(i)});
+                    // Its reply.
+                    expected[c] += "+OK\r\n";
+                    // Read it back.
+                    requests[c] += command({"GET", key});
+                    // Its reply.
+                    Resp::appendBulkString(expected[c], "value" + std::to_string(i));
+                    // Local-only commands queue behind forwarded ones.
+                    requests[c] += command({"ECHO", std::to_string(i)});
+                    // Its reply.
+                    Resp::appendBulkString(expected[c], std::to_string(i));
+                }
+                // Hang up after the rest: the replies still come first.
+                requests[c] += command({"GET", "pipe:" + std::to_string(c) + ":7"}) + command({"QUIT"});
+                // Their replies.
+                expected[c] += "$6\r\nvalue7\r\n+OK\r\n";
+            }
+            // Send every pipeline before reading any reply.
+            for (size_t c = 0; c < clients.size(); ++c) sendAll(clients[c], requests[c]);
+            // Assert each client's replies, in order.
+            for (size_t c = 0; c < clients.size(); ++c) {
+                // Assert the bytes.
+                assert(readExactly(clients[c], expected[c].size()) == expected[c]);
+                // Then the server hung up.
+                char byte;
+                // Assert the end of stream.
+                assert(::read(clients[c], &byte, 1) == 0);
+                // Done with it.
+                ::close(clients[c]);
+            }
+            // Print success message for Test 4.
+            std::cout << "Test 4 (Ordered replies across cores) PASSED [" << label << "]." << std::endl;
+        }
+
+        // Stop every core.
+        server.stop();
+        // Wait for them.
+        loop.join();
+
+        // Test 5: Each partition holds exactly the keys its core owns, and requests were forwarded rather than shared.
+        {
+            // Keys across the partitions.
+            size_t total = 0;
+            // Check each core.
+            for (size_t i = 0; i < CORES; ++i) {
+                // Its keys.
+                std::vector<std::string> keys = server.partition(i).prefixSearch("");
+                // Assert that each belongs to it.
+                for (const std::string& key : keys) assert(server.ownerOf(Utils::hash64(key)) == i);
+                // Count them.
+                total += keys.size();
+            }
+            // Assert that nothing was lost or duplicated: 18 from Test 3, 800 from Test 4.
+            assert(total == 818);
+            // The cores' counters.
+            ServerStats stats = server.stats();
+            // Print the figures.
+            std::cout << "Info [" << label << "]: " << stats.commandsProcessed << " commands, " << stats.forwardedCommands
+                      << " forwarded to other cores, " << stats.peerWakeups << " peer wake-ups." << std::endl;
+            // Assert that every connection was seen.
+            assert(stats.connectionsAccepted == 9);
+            // Assert that most keyed commands were owned elsewhere.
+            assert(stats.forwardedCommands > stats.commandsProcessed / 4);
+            // Print success message for Test 5.
+            std::cout << "Test 5 (Shared-nothing partitions) PASSED [" << label << "]." << std::endl;
+        }
+    }
+}
+
+// Main function for testing the thread-per-core server.
+int main() {
+    // Print start message for CoreServer tests.
+    std::cout << "Running CoreServer Tests..." << std::endl;
+
+    // Test 1: PeerQueue is a bounded FIFO, and stays one across a producer and a consumer thread.
+    {
+        // Room for four batches.
+        PeerQueue queue(4);
+        // Batch being moved.
+        std::vector<CoreMessage> batch;
+        // Assert that it starts empty.
+        assert(queue.empty() && !queue.pop(batch));
+        // Fill it.
+        for (int64_t i = 0; i < 4; ++i) {
+            // Next batch.
+            batch = batchOf(i);
+            // Assert that it fits.
+            assert(queue.push(batch));
+        }
+        // One too many.
+        batch = batchOf(4);
+        // Assert that it is refused and left with the caller.
+        assert(!queue.push(batch) && batch.size() == 1);
+        // Drain it.
+        for (int64_t i = 0; i < 4; ++i) {
+            // Assert the order.
+            assert(queue.pop(batch) && batch.size() == 1 && batch[0].count == i);
+        }
+        // Assert that it is empty again.
+        assert(queue.empty());
+        // Batches crossing threads.
+        constexpr int64_t CROSSING = 100000;
+        // A small queue, so the producer often finds it full.
+        PeerQueue shared(16);
+        // Producer.
+        std::thread producer([&shared]() {
+            // Push every batch in order.
+            for (int64_t i = 0; i < CROSSING; ++i) {
+                // Next batch.
+                std::vector<CoreMessage> next = batchOf(i);
+                // Retry while the queue is full.
+                while (!shared.push(next)) std::this_thread::yield();
+            }
+        });
+        // Next number expected.
+        int64_t expected = 0;
+        // Consume every batch.
+        while (expected < CROSSING) {
+            // Wait for the next one.
+            if (!shared.pop(batch)) {
+                // Let the producer run.
+                std::this_thread::yield();
+                // Retry.
+                continue;
+            }
+            // Assert the order.
+            assert(batch.size() == 1 && batch[0].count == expected);
+            // Next.
+            expected++;
+        }
+        // Wait for the producer.
+        producer.join();
+        // Print success message for Test 1.
+        std::cout << "Test 1 (PeerQueue ordering) PASSED." << std::endl;
+    }
+
+    // Test 2: Keys spread evenly over the cores.
+    {
+        // A group that is never started.
+        CoreServer group(CORES);
+        // Assert the core count.
+        assert(group.coreCount() == CORES);
+        // Keys per core.
+        std::vector<size_t> owned(CORES, 0);
+        // Place 10000 keys.
+        for (int i = 0; i < 10000; ++i) owned[group.ownerOf(Utils::hash64("key:" + std::to_string(i)))]++;
+        // Assert that each core owns close to a quarter.
+        for (size_t count : owned) assert(count > 2000 && count < 3000);
+        // Print success message for Test 2.
+        std::cout << "Test 2 (Key ownership) PASSED." << std::endl;
+    }
+
+    // Tests 3-5 against the epoll backend.
+    testLiveCores(ServerBackend::Epoll, "epoll");
+    // And again through io_uring (which falls back to epoll unless built with KV_STORE_IO_URING).
+    testLiveCores(ServerBackend::IoUring, "io_uring");
+
+    // Print completion message for all CoreServer tests.
+    std::cout << "All CoreServer tests completed." << std::endl;
+    // Return 0 to indicate success.
+    return 0;
+}
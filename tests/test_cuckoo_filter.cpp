@@ -0,0 +1,112 @@
+#include "../include/cuckoo_filter.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
+#include <iostream>
+#include <cassert>
+#include <string>
+
+// Main function for testing CuckooFilter.
+int main() {
+    // Print start message for CuckooFilter tests.
+    std::cout << "Running CuckooFilter Tests..." << std::endl;
+
+    // Test 1: Add, check and remove a key.
+    CuckooFilter filter(100);
+    // Add "apple".
+    assert(filter.add("apple"));
+    // Assert that "apple" might be contained.
+    assert(filter.possiblyContains("apple"));
+    // Assert that one fingerprint is stored.
+    assert(filter.size() == 1);
+    // Remove "apple".
+    assert(filter.remove("apple"));
+    // Assert that it is gone (no other fingerprints remain to collide with).
+    assert(!filter.possiblyContains("apple"));
+    // Assert that the filter is empty again.
+    assert(filter.size() == 0);
+    // Assert that removing it again reports nothing removed.
+    assert(!filter.remove("apple"));
+    // Print pass message for test 1.
+    std::cout << "Test 1 (add/possiblyContains/remove basic) PASSED." << std::endl;
+
+    // Test 2: No false negatives when filled to the load limit, and removed keys disappear.
+    const size_t numKeys = 50000;
+    // Filter sized for the keys.
+    CuckooFilter full(numKeys);
+    // Insert every key.
+    for (size_t i = 0; i < numKeys; ++i) {
+        // Assert that each insert succeeds.
+        assert(full.add(Utils::hash64("key_" + std::to_string(i))));
+    }
+    // Assert that the load stays within the configured limit.
+    assert(full.loadFactor() <= CuckooFilter::MAX_LOAD_FACTOR);
+    // Assert that every key is reported.
+    for (size_t i = 0; i < numKeys; ++i) {
+        // Key i must be present.
+        assert(full.possiblyContains(Utils::hash64("key_" + std::to_string(i))));
+    }
+    // Remove the even keys.
+    for (size_t i = 0; i < numKeys; i += 2) {
+        // Assert that each removal finds its fingerprint.
+        assert(full.remove(Utils::hash64("key_" + std::to_string(i))));
+    }
+    // Assert that the odd keys are still reported.
+    for (size_t i = 1; i < numKeys; i += 2) {
+        // Key i must be present.
+        assert(full.possiblyContains(Utils::hash64("key_" + std::to_string(i))));
+    }
+    // Count removed keys that are still reported (false positives).
+    size_t stale = 0;
+    // Probe the removed keys.
+    for (size_t i = 0; i < numKeys; i += 2) {
+        // Count a positive answer.
+        if (full.possiblyContains(Utils::hash64("key_" + std::to_string(i)))) stale++;
+    }
+    // Print the observed rate.
+    std::cout << "Info: removed keys still reported: " << stale << " of " << numKeys / 2
+              << " (estimated FPR " << full.estimatedFalsePositiveRate() << ")" << std::endl;
+    // Assert that deletion really frees the keys (16-bit fingerprints give well under 1%).
+    assert(stale < numKeys / 2 / 100);
+    // Print pass message for test 2.
+    std::cout << "Test 2 (no false negatives, deletion) PASSED." << std::endl;
+
+    // Test 3: Churn does not saturate the filter.
+    CuckooFilter churn(1000);
+    // Create and delete many more keys than the filter is sized for.
+    for (size_t i = 0; i < 100000; ++i) {
+        // Hash of key i.
+        uint64_t hashCode = Utils::hash64("session_" + std::to_string(i));
+        // Add it.
+        assert(churn.add(hashCode));
+        // Keep at most 500 live keys by deleting the key added 500 steps ago.
+        if (i >= 500) assert(churn.remove(Utils::hash64("session_" + std::to_string(i - 500))));
+    }
+    // Assert that exactly the live keys remain.
+    assert(churn.size() == 500);
+    // Assert that the filter never overflowed.
+    assert(!churn.isOverflowed());
+    // Print pass message for test 3.
+    std::cout << "Test 3 (churn) PASSED." << std::endl;
+
+    // Test 4: An overfilled filter overflows safely: it keeps answering true rather than losing keys.
+    CuckooFilter tiny(8);
+    // Number of keys accepted before the first failure.
+    size_t accepted = 0;
+    // Insert until an add fails.
+    while (tiny.add(Utils::hash64("overflow_" + std::to_string(accepted)))) accepted++;
+    // Assert that the filter reports the overflow.
+    assert(tiny.isOverflowed());
+    // Assert that every accepted key is still reported.
+    for (size_t i = 0; i < accepted; ++i) {
+        // Key i must be present.
+        assert(tiny.possiblyContains(Utils::hash64("overflow_" + std::to_string(i))));
+    }
+    // Assert that the estimate signals that the filter is useless until rebuilt.
+    assert(tiny.estimatedFalsePositiveRate() == 1.0);
+    // Print pass message for test 4.
+    std::cout << "Test 4 (overflow) PASSED." << std::endl;
+
+    // Print completion message for CuckooFilter tests.
+    std::cout << "All CuckooFilter Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -1,6 +1,10 @@
 #include "../include/hash_map.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
 #include <iostream>
 #include <cassert> // For basic assertions
+#include <string>
+#include <unordered_map> // Reference implementation for differential testing
+#include <random>
 
 // Main function for testing HashMap.
 int main() {
@@ -76,6 +80,256 @@ int main() {
     // Print pass message for test 8.
     std::cout << "Test 8 (contains) PASSED." << std::endl;
 
+    // Test 9: Growth past the initial capacity keeps every key reachable.
+    HashMap growMap(5);
+    // Insert far more keys than the initial single group can hold.
+    for (int i = 0; i < 1000; ++i) {
+        // Insert key_i -> value_i.
+        growMap.set("key_" + std::to_string(i), "value_" + std::to_string(i));
+    }
+    // Assert that all keys were counted.
+    assert(growMap.size() == 1000);
+    // Assert that the table grew to keep the load factor under 7/8.
+    assert(growMap.capacity() * 7 >= 1000 * 8);
+    // Assert that every key is still found with the right value.
+    for (int i = 0; i < 1000; ++i) {
+        // Check each value.
+        assert(growMap.get("key_" + std::to_string(i)) == "value_" + std::to_string(i));
+    }
+    // Print pass message for test 9.
+    std::cout << "Test 9 (growth) PASSED." << std::endl;
+
+    // Test 10: Tombstones are reused and purged under insert/remove churn without growing the table.
+    HashMap churnMap(64);
+    // Remember the starting capacity.
+    size_t churnCapacity = churnMap.capacity();
+    // Repeatedly insert and remove a rolling window of keys.
+    for (int i = 0; i < 10000; ++i) {
+        // Insert a new key.
+        churnMap.set("session_" + std::to_string(i), "x");
+        // Remove the key inserted 20 iterations ago.
+        if (i >= 20) {
+            // The older key must still be present to be removed.
+            assert(churnMap.remove("session_" + std::to_string(i - 20)) == true);
+        }
+    }
+    // Assert that exactly the last 20 keys remain.
+    assert(churnMap.size() == 20);
+    // Assert that churn alone did not grow the table.
+    assert(churnMap.capacity() == churnCapacity);
+    // Assert that a removed key stays removed.
+    assert(churnMap.contains("session_0") == false);
+    // Assert that a live key is still found.
+    assert(churnMap.contains("session_9999") == true);
+    // Print pass message for test 10.
+    std::cout << "Test 10 (tombstone churn) PASSED." << std::endl;
+
+    // Test 11: Differential test against std::unordered_map over random operations.
+    HashMap diffMap(5);
+    // Reference map holding the expected contents.
+    std::unordered_map<std::string, std::string> reference;
+    // Deterministic random generator.
+    std::mt19937 rng(12345);
+    // Run a mix of set, remove, get and contains over a small key space to force collisions.
+    for (int i = 0; i < 50000; ++i) {
+        // Pick a key from a space of 2000 keys.
+        std::string key = "k" + std::to_string(rng() % 2000);
+        // Pick an operation.
+        unsigned op = rng() % 4;
+        // Set operation (values include the empty string).
+        if (op == 0) {
+            // Value derived from the iteration.
+            std::string value = (i % 7 == 0) ? "" : "v" + std::to_string(i);
+            // Apply to both maps.
+            diffMap.set(key, value);
+            // Mirror in the reference.
+            reference[key] = value;
+        // Remove operation.
+        } else if (op == 1) {
+            // Both maps must agree on whether the key was removed.
+            assert(diffMap.remove(key) == (reference.erase(key) == 1));
+        // Get operation.
+        } else if (op == 2) {
+            // Expected value (empty when missing).
+            auto it = reference.find(key);
+            // Compare against the reference.
+            assert(diffMap.get(key) == (it == reference.end() ? "" : it->second));
+        // Contains operation.
+        } else {
+            // Both maps must agree on membership.
+            assert(diffMap.contains(key) == (reference.count(key) == 1));
+        }
+        // Sizes must always agree.
+        assert(diffMap.size() == reference.size());
+    }
+    // Print pass message for test 11.
+    std::cout << "Test 11 (differential vs std::unordered_map) PASSED." << std::endl;
+
+    // Test 12: Growth is incremental; both tables stay readable until migration finishes.
+    HashMap incMap(1024);
+    // Remember the starting capacity.
+    size_t startCapacity = incMap.capacity();
+    // Fill up to the grow threshold without triggering a resize.
+    int inserted = 0;
+    // Insert until a resize starts.
+    while (!incMap.isRehashing()) {
+        // Insert the next key.
+        incMap.set("inc_" + std::to_string(inserted), std::to_string(inserted));
+        // Count it.
+        inserted++;
+    }
+    // Assert that the resize doubled the table receiving inserts.
+    assert(incMap.capacity() == startCapacity * 2);
+    // Count operations needed to finish migrating; each one moves a bounded slice.
+    int stepsWhileRehashing = 0;
+    // Keep reading keys (every one must be visible in either table) until migration completes.
+    while (incMap.isRehashing()) {
+        // Read a key that may not have been migrated yet.
+        assert(incMap.get("inc_" + std::to_string(stepsWhileRehashing % inserted)) ==
+               std::to_string(stepsWhileRehashing % inserted));
+        // Count the step.
+        stepsWhileRehashing++;
+    }
+    // Assert that the migration was spread across many calls rather than done in one.
+    assert(stepsWhileRehashing > 1);
+    // Assert that nothing was lost.
+    assert(incMap.size() == static_cast<size_t>(inserted));
+    // Assert that every key is still present.
+    for (int i = 0; i < inserted; ++i) {
+        // Check membership.
+        assert(incMap.contains("inc_" + std::to_string(i)));
+    }
+    // Print pass message for test 12.
+    std::cout << "Test 12 (incremental rehash) PASSED." << std::endl;
+
+    // Test 13: Removing most keys shrinks the table back toward its starting capacity.
+    HashMap shrinkMap(16, 0.875, 0.2);
+    // Grow well past the initial capacity.
+    for (int i = 0; i < 4000; ++i) {
+        // Insert key i.
+        shrinkMap.set("s" + std::to_string(i), "v");
+    }
+    // Remember the grown capacity.
+    size_t grownCapacity = shrinkMap.capacity();
+    // Remove all but a handful of keys.
+    for (int i = 10; i < 4000; ++i) {
+        // Remove key i.
+        assert(shrinkMap.remove("s" + std::to_string(i)) == true);
+    }
+    // Drive any in-progress migration to completion with reads.
+    while (shrinkMap.isRehashing()) {
+        // Each read pays for one migration step.
+        shrinkMap.contains("s0");
+    }
+    // Assert that the table shrank.
+    assert(shrinkMap.capacity() < grownCapacity);
+    // Assert that the survivors are intact.
+    for (int i = 0; i < 10; ++i) {
+        // Check membership.
+        assert(shrinkMap.get("s" + std::to_string(i)) == "v");
+    }
+    // Print pass message for test 13.
+    std::cout << "Test 13 (shrink) PASSED." << std::endl;
+
+    // Test 14: Borrowed lookup by string_view distinguishes a missing key from an empty value.
+    HashMap viewMap(16);
+    // Store an empty value.
+    viewMap.set("empty", "");
+    // Store a regular value.
+    viewMap.set("full", "value");
+    // Look up from a plain character buffer without building a std::string.
+    const char keyBuffer[] = "full";
+    // Borrow the value.
+    std::optional<std::string_view> fullValue = viewMap.find(keyBuffer);
+    // Assert that the value is present and correct.
+    assert(fullValue.has_value() && *fullValue == "value");
+    // Assert that the empty value is present.
+    assert(viewMap.find("empty").has_value() && viewMap.find("empty")->empty());
+    // Assert that a missing key reports no value at all.
+    assert(!viewMap.find("missing").has_value());
+    // Print pass message for test 14.
+    std::cout << "Test 14 (find by string_view) PASSED." << std::endl;
+
+    // Test 15: set reports new keys, and scan visits every entry exactly once between resizes.
+    HashMap scanMap(4096);
+    // Assert that a new key is reported as inserted.
+    assert(scanMap.set("first", "1") == true);
+    // Assert that an update is not.
+    assert(scanMap.set("first", "2") == false);
+    // Fill the map without triggering a resize.
+    for (int i = 0; i < 1000; ++i) {
+        // Insert key i.
+        scanMap.set("scan_" + std::to_string(i), std::to_string(i));
+    }
+    // Assert that no resize is running, so slot positions are stable.
+    assert(!scanMap.isRehashing());
+    // Resize count before the scan.
+    uint64_t resizesBefore = scanMap.resizeCount();
+    // Keys seen by the scan, with their values.
+    std::unordered_map<std::string, std::string> scanned;
+    // Scan in small batches.
+    size_t cursor = 0;
+    // Continue until the whole table was visited.
+    while (cursor < scanMap.capacity()) {
+        // Visit the next 37 slots.
+        cursor = scanMap.scan(cursor, 37, [&](std::string_view key, std::string_view value) {
+            // Assert that no key is visited twice.
+            assert(scanned.emplace(std::string(key), std::string(value)).second);
+        });
+    }
+    // Assert that every entry was visited.
+    assert(scanned.size() == scanMap.size());
+    // Assert that values came along with their keys.
+    assert(scanned["scan_7"] == "7" && scanned["first"] == "2");
+    // Assert that scanning did not resize anything.
+    assert(scanMap.resizeCount() == resizesBefore);
+    // Print pass message for test 15.
+    std::cout << "Test 15 (set result, scan) PASSED." << std::endl;
+
+    // Test 16: Access stamps follow their keys through updates and resizes; sampling and memory accounting.
+    HashMap stampMap(16);
+    // Table bytes of the empty map.
+    size_t emptyBytes = stampMap.memoryUsage();
+    // A new key starts with stamp 0.
+    stampMap.set("stamped", "v");
+    // Assert the initial stamp.
+    assert(stampMap.accessStamp("stamped", Utils::hash64("stamped")) && *stampMap.accessStamp("stamped", Utils::hash64("stamped")) == 0);
+    // Write a stamp.
+    *stampMap.accessStamp("stamped", Utils::hash64("stamped")) = 42;
+    // Grow through several resizes.
+    for (int i = 0; i < 1000; ++i) stampMap.set("grow_" + std::to_string(i), std::to_string(i));
+    // Update the stamped key with a longer value.
+    stampMap.set("stamped", std::string(100, 'x'));
+    // Assert that the stamp survived the resizes and the update.
+    assert(*stampMap.accessStamp("stamped", Utils::hash64("stamped")) == 42);
+    // Assert that absent keys have no stamp.
+    assert(stampMap.accessStamp("absent", Utils::hash64("absent")) == nullptr);
+    // Sample a handful of entries.
+    std::unordered_map<std::string, uint32_t> sampled;
+    // Visit a hundred.
+    size_t sampledCount = stampMap.sample(12345, 100, [&](std::string_view key, uint32_t stamp) {
+        // Assert that each sampled key is live.
+        assert(stampMap.peek(key));
+        // Remember it with its stamp.
+        sampled[std::string(key)] = stamp;
+    });
+    // Assert the count, and that independent probes spread over many keys.
+    assert(sampledCount == 100 && sampled.size() > 50);
+    // Assert that the map accounts for at least its payload.
+    assert(stampMap.memoryUsage() > emptyBytes + 1000 * 8);
+    // Remove every key.
+    for (int i = 0; i < 1000; ++i) stampMap.remove("grow_" + std::to_string(i));
+    // And the stamped one.
+    stampMap.remove("stamped");
+    // Finish any shrink in progress.
+    while (stampMap.isRehashing()) stampMap.contains("absent");
+    // Assert that the record bytes went back to zero (only table arrays remain).
+    assert(stampMap.memoryUsage() == stampMap.capacity() * (1 + sizeof(char*) + sizeof(uint32_t)));
+    // Assert that sampling an empty map visits nothing.
+    assert(stampMap.sample(7, 5, [](std::string_view, uint32_t) { assert(false); }) == 0);
+    // Print pass message for test 16.
+    std::cout << "Test 16 (access stamps, sampling, memory usage) PASSED." << std::endl;
+
 
     // Print completion message for HashMap tests.
     std::cout << "All HashMap Tests PASSED." << std::endl;
@@ -1,8 +1,10 @@
 #include "../include/kv_store.hpp"
+#include "../include/utils.hpp" // For Utils::hash64
 #include <iostream>
 #include <cassert>
 #include <vector>
-#include <algorithm> // For std::sort
+#include <algorithm> // For std::sort, std::find
+#include <cstdio> // For std::remove
 
 // Main function for testing KVStore.
 int main() {
@@ -68,6 +70,604 @@ int main() {
     // Print pass message for test 6.
     std::cout << "Test 6 (bloom for deleted key) PASSED (behavior is informational)." << std::endl;
 
+    // Test 7: Configuration constructor with custom load-factor thresholds.
+    KVStoreConfig config;
+    // Start small so the table must grow.
+    config.hashMapCapacity = 16;
+    // Grow earlier than the default.
+    config.maxLoadFactor = 0.5;
+    // Large enough Bloom filter for the keys below.
+    config.bloomFilterSize = 100000;
+    // Create the store from the configuration.
+    KVStore configuredStore(config);
+    // Insert enough keys to force several incremental resizes.
+    for (int i = 0; i < 5000; ++i) {
+        // Insert key i.
+        configuredStore.set("cfg_" + std::to_string(i), std::to_string(i));
+    }
+    // Assert that every key is retrievable after the resizes.
+    for (int i = 0; i < 5000; ++i) {
+        // Check the value.
+        assert(configuredStore.get("cfg_" + std::to_string(i)) == std::to_string(i));
+    }
+    // Print pass message for test 7.
+    std::cout << "Test 7 (config constructor with load factors) PASSED." << std::endl;
+
+    // Test 8: getView distinguishes a key holding an empty value from a missing key.
+    store.set("blank", "");
+    // Assert that the key is found with an empty value.
+    assert(store.getView("blank").has_value() && store.getView("blank")->empty());
+    // Assert that a missing key reports no value.
+    assert(!store.getView("never_set").has_value());
+    // Assert that a regular value is borrowed correctly.
+    assert(*store.getView("fruit3") == "cherry");
+    // Print pass message for test 8.
+    std::cout << "Test 8 (getView) PASSED." << std::endl;
+
+    // Test 9: Precomputed-hash overloads interoperate with the plain ones.
+    uint64_t hashedKeyHash = Utils::hash64("hashed_key");
+    // Set through the hashed overload.
+    store.set("hashed_key", "hashed_value", hashedKeyHash);
+    // Assert that the plain lookup finds it.
+    assert(store.get("hashed_key") == "hashed_value");
+    // Assert that the hashed lookups find it.
+    assert(*store.getView("hashed_key", hashedKeyHash) == "hashed_value");
+    // Assert that the read-only hashed lookup finds it.
+    assert(*store.peek("hashed_key", hashedKeyHash) == "hashed_value");
+    // Remove through the hashed overload.
+    assert(store.remove("hashed_key", hashedKeyHash));
+    // Assert that it is gone for the plain API too.
+    assert(!store.getView("hashed_key").has_value());
+    // Print pass message for test 9.
+    std::cout << "Test 9 (precomputed-hash overloads) PASSED." << std::endl;
+
+    // Test 10: In cuckoo mode, deleted keys leave the filter, so churn keeps the "definitely absent" path.
+    KVStoreConfig cuckooConfig;
+    // Deletable filter.
+    cuckooConfig.filterMode = FilterMode::Cuckoo;
+    // Sized for far fewer keys than will pass through the store.
+    cuckooConfig.bloomExpectedKeys = 2000;
+    // Create the store.
+    KVStore cuckooStore(cuckooConfig);
+    // Create and delete session keys, keeping 1000 live.
+    for (int i = 0; i < 50000; ++i) {
+        // Create session i.
+        cuckooStore.set("session_" + std::to_string(i), "data");
+        // Delete the session created 1000 steps ago.
+        if (i >= 1000) assert(cuckooStore.remove("session_" + std::to_string(i - 1000)));
+    }
+    // Assert that every live session is still found.
+    for (int i = 49000; i < 50000; ++i) {
+        // Session i must be present.
+        assert(cuckooStore.get("session_" + std::to_string(i)) == "data");
+    }
+    // Count deleted sessions the filter still lets through.
+    int cuckooPassed = 0;
+    // Probe the deleted sessions.
+    for (int i = 0; i < 49000; ++i) {
+        // Count a positive answer.
+        if (cuckooStore.mightContain("session_" + std::to_string(i))) cuckooPassed++;
+    }
+    // Print the observed rate.
+    std::cout << "Info: cuckoo mode, deleted keys passing the filter: " << cuckooPassed << " of 49000" << std::endl;
+    // Assert that the filter still rejects almost all of them.
+    assert(cuckooPassed < 490);
+    // Assert that the filter reports its mode.
+    assert(cuckooStore.filterStats().mode == FilterMode::Cuckoo);
+    // Print pass message for test 10.
+    std::cout << "Test 10 (cuckoo filter mode under churn) PASSED." << std::endl;
+
+    // Test 11: A saturated Bloom filter is rebuilt from the main store in the background.
+    KVStoreConfig bloomConfig;
+    // Sized for a small working set.
+    bloomConfig.bloomExpectedKeys = 1000;
+    // Create the store.
+    KVStore bloomStore(bloomConfig);
+    // Create and delete session keys, keeping 500 live; every insert sets bits that deletes cannot clear.
+    for (int i = 0; i < 20000; ++i) {
+        // Create session i.
+        bloomStore.set("session_" + std::to_string(i), "data");
+        // Delete the session created 500 steps ago.
+        if (i >= 500) assert(bloomStore.remove("session_" + std::to_string(i - 500)));
+        // Assert that the newest live sessions are never lost, even while a rebuild is in progress.
+        if (i % 97 == 0) {
+            // Check the last few sessions.
+            for (int j = std::max(0, i - 20); j <= i; ++j) {
+                // Session j must pass the filter.
+                assert(bloomStore.mightContain("session_" + std::to_string(j)));
+            }
+        }
+    }
+    // Let any rebuild in progress finish.
+    while (bloomStore.tick()) {}
+    // Assert that rebuilds happened.
+    assert(bloomStore.filterStats().rebuilds > 0);
+    // Assert that every live session is still found.
+    for (int i = 19500; i < 20000; ++i) {
+        // Session i must be present.
+        assert(bloomStore.get("session_" + std::to_string(i)) == "data");
+    }
+    // Count deleted sessions the filter still lets through.
+    int bloomPassed = 0;
+    // Probe the deleted sessions.
+    for (int i = 0; i < 19500; ++i) {
+        // Count a positive answer.
+        if (bloomStore.mightContain("session_" + std::to_string(i))) bloomPassed++;
+    }
+    // Print the observed rate.
+    std::cout << "Info: Bloom mode after " << bloomStore.filterStats().rebuilds << " rebuilds, deleted keys passing the filter: "
+              << bloomPassed << " of 19500 (estimated FPR " << bloomStore.filterStats().estimatedFalsePositiveRate << ")" << std::endl;
+    // Assert that the rebuilt filter stays within the rebuild threshold (2x the 1% target, plus sampling slack).
+    assert(bloomPassed < 19500 * 3 / 100);
+    // Print pass message for test 11.
+    std::cout << "Test 11 (background Bloom rebuild under churn) PASSED." << std::endl;
+
+    // Test 12: Paged prefix search through the store.
+    KVStore pagedStore;
+    // Ten keys under one prefix and one outside it.
+    for (int i = 0; i < 10; ++i) pagedStore.set("page:" + std::to_string(i), "v");
+    // Outside the prefix.
+    pagedStore.set("pagf", "v");
+    // First page of four.
+    std::optional<PrefixPage> firstPage = pagedStore.prefixSearch("page:", 4, Trie::CURSOR_START);
+    // Assert that it holds the first four keys and a resume token.
+    assert(firstPage && firstPage->keys.size() == 4 && firstPage->keys[0] == "page:0" && firstPage->nextCursor != Trie::CURSOR_START);
+    // Resume with a larger page that reaches the end.
+    std::optional<PrefixPage> lastPage = pagedStore.prefixSearch("page:", 100, firstPage->nextCursor);
+    // Assert that it holds the remaining six keys and ends the scan.
+    assert(lastPage && lastPage->keys.size() == 6 && lastPage->keys[0] == "page:4" && lastPage->nextCursor == Trie::CURSOR_START);
+    // Walk the same prefix lazily.
+    Trie::KeyIterator storeIt = pagedStore.scanPrefix("page:");
+    // Keys visited.
+    size_t storeVisited = 0;
+    // Count them.
+    while (storeIt.next()) storeVisited++;
+    // Assert the count.
+    assert(storeVisited == 10);
+    // Print pass message for test 12.
+    std::cout << "Test 12 (paged prefix search) PASSED." << std::endl;
+
+    // Test 13: Range scans return keys with their values.
+    KVStore rangeStore;
+    // Orders on three days.
+    rangeStore.set("order:2026-10-01:a", "1");
+    // Second day.
+    rangeStore.set("order:2026-10-02:a", "2");
+    // Third day (outside the range).
+    rangeStore.set("order:2026-10-03:a", "3");
+    // Scan the first two days.
+    std::vector<std::pair<std::string, std::string>> pairs = rangeStore.scanRange("order:2026-10-01", std::string("order:2026-10-03"), 10);
+    // Assert that both pairs came back with their values.
+    assert(pairs.size() == 2 && pairs[0].first == "order:2026-10-01:a" && pairs[0].second == "1" && pairs[1].second == "2");
+    // Scan everything descending with a limit of one.
+    pairs = rangeStore.scanRange("", std::nullopt, 1, true);
+    // Assert that the largest key came back.
+    assert(pairs.size() == 1 && pairs[0].first == "order:2026-10-03:a" && pairs[0].second == "3");
+    // Print pass message for test 13.
+    std::cout << "Test 13 (range scan with values) PASSED." << std::endl;
+
+    // Test 14: A memory budget is enforced by sampled eviction, or by rejecting writes under noeviction.
+    KVStoreConfig budgetConfig;
+    // A budget of 256 KiB.
+    budgetConfig.maxMemoryBytes = 256 * 1024;
+    // Evict by recency.
+    budgetConfig.evictionPolicy = EvictionPolicy::AllKeysLRU;
+    // Build the store.
+    KVStore lruStore(budgetConfig);
+    // A 100-byte value.
+    std::string payload(100, 'p');
+    // Hot keys written first.
+    for (int i = 0; i < 50; ++i) assert(lruStore.set("hot:" + std::to_string(i), payload));
+    // Write far more than the budget holds, reading the hot keys along the way.
+    for (int i = 0; i < 20000; ++i) {
+        // Every write is accepted (something can always be evicted).
+        assert(lruStore.set("cold:" + std::to_string(i), payload));
+        // Keep the hot keys recently used.
+        lruStore.get("hot:" + std::to_string(i % 50));
+    }
+    // Figures after the burst.
+    EvictionStats lruStats = lruStore.evictionStats();
+    // Assert that keys were evicted and usage stayed near the budget.
+    assert(lruStats.evictedKeys > 0 && lruStats.usedBytes <= budgetConfig.maxMemoryBytes + 1024 && lruStats.rejectedWrites == 0);
+    // Assert that the trie and store agree after the evictions.
+    assert(lruStore.prefixSearch("").size() == lruStore.size());
+    // Count surviving hot keys.
+    int hotSurvivors = 0;
+    // Check each.
+    for (int i = 0; i < 50; ++i) hotSurvivors += lruStore.peek("hot:" + std::to_string(i)).has_value();
+    // Fraction of cold keys still present.
+    double coldFraction = static_cast<double>(lruStore.size() - hotSurvivors) / 20000;
+    // Assert that recently read keys survive far better than the cold ones.
+    assert(hotSurvivors >= 40 && coldFraction < 0.5);
+    // Informational output.
+    std::cout << "Info: allkeys-lru kept " << lruStore.size() << " keys in " << lruStats.usedBytes << " bytes, "
+              << hotSurvivors << "/50 hot keys, " << lruStats.evictedKeys << " evictions." << std::endl;
+    // Evict by frequency instead.
+    budgetConfig.evictionPolicy = EvictionPolicy::AllKeysLFU;
+    // Build the store.
+    KVStore lfuStore(budgetConfig);
+    // Frequent keys, each read many times up front.
+    for (int i = 0; i < 50; ++i) {
+        // Write it.
+        lfuStore.set("freq:" + std::to_string(i), payload);
+        // Read it repeatedly.
+        for (int j = 0; j < 30; ++j) lfuStore.get("freq:" + std::to_string(i));
+    }
+    // A burst of keys written once and never read.
+    for (int i = 0; i < 20000; ++i) assert(lfuStore.set("once:" + std::to_string(i), payload));
+    // Count surviving frequent keys.
+    int frequentSurvivors = 0;
+    // Check each.
+    for (int i = 0; i < 50; ++i) frequentSurvivors += lfuStore.peek("freq:" + std::to_string(i)).has_value();
+    // Assert that frequently read keys outlived the one-off writes even though they were not read since.
+    assert(frequentSurvivors >= 40 && lfuStore.evictionStats().usedBytes <= budgetConfig.maxMemoryBytes + 1024);
+    // Informational output.
+    std::cout << "Info: allkeys-lfu kept " << frequentSurvivors << "/50 frequent keys." << std::endl;
+    // Random eviction keeps usage bounded too.
+    budgetConfig.evictionPolicy = EvictionPolicy::AllKeysRandom;
+    // Build the store.
+    KVStore randomStore(budgetConfig);
+    // Write past the budget.
+    for (int i = 0; i < 20000; ++i) assert(randomStore.set("r:" + std::to_string(i), payload));
+    // Assert the bound.
+    assert(randomStore.evictionStats().usedBytes <= budgetConfig.maxMemoryBytes + 1024);
+    // Reject writes instead.
+    budgetConfig.evictionPolicy = EvictionPolicy::NoEviction;
+    // Build the store.
+    KVStore fullStore(budgetConfig);
+    // Writes accepted before the budget is reached.
+    int accepted = 0;
+    // Write until the first rejection.
+    while (fullStore.set("n:" + std::to_string(accepted), payload)) accepted++;
+    // Assert that some writes went through and nothing was evicted.
+    assert(accepted > 0 && fullStore.size() == static_cast<size_t>(accepted) && fullStore.evictionStats().evictedKeys == 0);
+    // Assert that the rejection was counted and the rejected key is absent.
+    assert(fullStore.evictionStats().rejectedWrites == 1 && !fullStore.peek("n:" + std::to_string(accepted)));
+    // Freeing room lets writes through again.
+    for (int i = 0; i < 100; ++i) fullStore.remove("n:" + std::to_string(i));
+    // Assert that a write is accepted now.
+    assert(fullStore.set("after-delete", payload));
+    // Volatile policies have no candidates without expiries, so they reject like noeviction.
+    budgetConfig.evictionPolicy = EvictionPolicy::VolatileLRU;
+    // Build the store.
+    KVStore volatileStore(budgetConfig);
+    // Fill it.
+    int volatileAccepted = 0;
+    // Write until the first rejection.
+    while (volatileStore.set("v:" + std::to_string(volatileAccepted), payload)) volatileAccepted++;
+    // Assert that it stopped at the budget without evicting.
+    assert(volatileAccepted > 0 && volatileStore.evictionStats().evictedKeys == 0);
+    // Print pass message for test 14.
+    std::cout << "Test 14 (memory budget and eviction policies) PASSED." << std::endl;
+
+    // Test 15: Keys with a time to live expire lazily on access and actively through the timing wheel.
+    uint64_t fakeNow = 1000000;
+    // Configuration with a manual clock.
+    KVStoreConfig ttlConfig;
+    // Read the test's clock.
+    ttlConfig.clock = [&fakeNow]() { return fakeNow; };
+    // Build the store.
+    KVStore ttlStore(ttlConfig);
+    // A session that lives for 10 seconds.
+    assert(ttlStore.setWithTtl("session:1", "alice", 10000));
+    // A key without a deadline.
+    ttlStore.set("session:permanent", "root");
+    // Assert the remaining time and the no-deadline status.
+    assert(ttlStore.ttl("session:1") == 10000 && ttlStore.ttl("session:permanent") == KVStore::TTL_NO_EXPIRY);
+    // Assert the missing-key status.
+    assert(ttlStore.ttl("session:none") == KVStore::TTL_MISSING && !ttlStore.expire("session:none", 1000));
+    // Half-way through.
+    fakeNow += 5000;
+    // Assert that it is still readable with half its time left.
+    assert(ttlStore.get("session:1") == "alice" && ttlStore.ttl("session:1") == 5000);
+    // Past its deadline.
+    fakeNow += 5000;
+    // Assert that peek, the prefix search and the range scan hide it before it is reclaimed.
+    assert(!ttlStore.peek("session:1") && ttlStore.prefixSearch("session:").size() == 1 &&
+           ttlStore.scanRange("session:", std::nullopt, 10).size() == 1);
+    // Assert that an access removes it (lazy expiry) and that it is gone from the Trie too.
+    assert(!ttlStore.getView("session:1") && ttlStore.size() == 1 && ttlStore.scanPrefix("session:1").next() == false);
+    // Assert that it was counted once.
+    assert(ttlStore.expiryStats().expiredKeys == 1);
+    // A deadline passing while TTL runs: every clock read after the first is 2 ms later.
+    {
+        // Clock reads so far.
+        uint64_t clockReads = 0;
+        // Reads after which the clock jumps (set below, once the key is written).
+        uint64_t jumpAfter = UINT64_MAX;
+        // Configuration with the jumping clock.
+        KVStoreConfig jumpConfig;
+        // 1000, then 1002 once armed.
+        jumpConfig.clock = [&clockReads, &jumpAfter]() { return ++clockReads > jumpAfter ? uint64_t(1002) : uint64_t(1000); };
+        // Build the store.
+        KVStore jumpStore(jumpConfig);
+        // Due at 1001.
+        assert(jumpStore.setWithTtl("brief", "x", 1));
+        // TTL's first read is the last one before the jump.
+        jumpAfter = clockReads + 1;
+        // Assert that it reports the 1 ms left at that read, not a wrapped TTL_NO_EXPIRY.
+        assert(jumpStore.ttl("brief") == 1);
+    }
+    // EXPIRE, then PERSIST, then overwriting a key all cancel deadlines.
+    ttlStore.set("keep:1", "a");
+    // Give it a deadline.
+    assert(ttlStore.expire("keep:1", 1000));
+    // Remove the deadline again.
+    assert(ttlStore.persist("keep:1") && !ttlStore.persist("keep:1"));
+    // A key whose deadline is cleared by a plain SET.
+    assert(ttlStore.setWithTtl("keep:2", "b", 1000));
+    // Overwrite it.
+    ttlStore.set("keep:2", "c");
+    // A key whose deadline is moved later.
+    assert(ttlStore.setWithTtl("keep:3", "d", 1000));
+    // Push it out.
+    assert(ttlStore.expire("keep:3", 60000));
+    // Well past the original deadlines.
+    fakeNow += 2000;
+    // Let the wheel fire its (now stale) timers.
+    while (ttlStore.tick()) {}
+    // Assert that all three survived.
+    assert(ttlStore.peek("keep:1") && ttlStore.peek("keep:2") && ttlStore.peek("keep:3"));
+    // Assert their deadlines.
+    assert(ttlStore.ttl("keep:1") == KVStore::TTL_NO_EXPIRY && ttlStore.ttl("keep:2") == KVStore::TTL_NO_EXPIRY && ttlStore.ttl("keep:3") == 58000);
+    // Active expiry: many keys with short deadlines are reclaimed without ever being read.
+    for (int i = 0; i < 1000; ++i) assert(ttlStore.setWithTtl("tmp:" + std::to_string(i), "x", 100 + i));
+    // Assert that they all carry a deadline.
+    assert(ttlStore.expiryStats().keysWithExpiry >= 1000);
+    // Past every deadline.
+    fakeNow += 5000;
+    // Writes reclaim a bounded number each.
+    ttlStore.set("writer", "w");
+    // Assert that one write reclaimed at most its share.
+    assert(ttlStore.expiryStats().expiredKeys - 1 <= KVStore::EXPIRED_KEYS_PER_STEP);
+    // Idle ticks reclaim the rest in slices.
+    while (ttlStore.tick(64)) {}
+    // Assert that they are all gone from the store and the Trie.
+    assert(ttlStore.size() == 5 && ttlStore.prefixSearch("tmp:").empty() && !ttlStore.scanPrefix("tmp:").next());
+    // Assert the counters.
+    assert(ttlStore.expiryStats().expiredKeys == 1001 && ttlStore.expiryStats().keysWithExpiry == 1);
+    // Volatile eviction now has candidates: only keys with a deadline are evicted.
+    KVStoreConfig volatileConfig;
+    // Small budget.
+    volatileConfig.maxMemoryBytes = 128 * 1024;
+    // Evict keys with a deadline, least recently used first.
+    volatileConfig.evictionPolicy = EvictionPolicy::VolatileLRU;
+    // Same manual clock.
+    volatileConfig.clock = ttlConfig.clock;
+    // Build the store.
+    KVStore volatileTtlStore(volatileConfig);
+    // Permanent keys first.
+    for (int i = 0; i < 100; ++i) assert(volatileTtlStore.set("perm:" + std::to_string(i), std::string(100, 'p')));
+    // Then many keys with a long deadline.
+    for (int i = 0; i < 5000; ++i) assert(volatileTtlStore.setWithTtl("vol:" + std::to_string(i), std::string(100, 'v'), 3600000));
+    // Assert that evictions happened and spared every permanent key.
+    assert(volatileTtlStore.evictionStats().evictedKeys > 0 && volatileTtlStore.prefixSearch("perm:").size() == 100);
+    // Print pass message for test 15.
+    std::cout << "Test 15 (key expiry) PASSED." << std::endl;
+
+    // Test 16: Each value is resident once: the cache indexes main store records instead of copying them.
+    KVStoreConfig onceConfig;
+    // A cache large enough for every key.
+    onceConfig.cacheCapacity = 1000;
+    // Build the store.
+    KVStore onceStore(onceConfig);
+    // Value size.
+    const size_t valueSize = 1000;
+    // Bytes of keys and values written.
+    size_t payloadBytes = 0;
+    // A thousand 1 KB values.
+    for (int i = 0; i < 1000; ++i) {
+        // Key.
+        std::string key = "doc:" + std::to_string(i);
+        // Write it (this also caches it).
+        onceStore.set(key, std::string(valueSize, static_cast<char>('a' + i % 26)));
+        // Count it.
+        payloadBytes += key.size() + valueSize;
+    }
+    // Read every key twice, so the second read is a cache hit.
+    for (int round = 0; round < 2; ++round) {
+        // Every key.
+        for (int i = 0; i < 1000; ++i) assert(onceStore.getView("doc:" + std::to_string(i)));
+    }
+    // Assert that a cache hit returns the main store's own bytes.
+    assert(onceStore.getView("doc:5")->data() == onceStore.peek("doc:5")->data());
+    // Assert that an update is visible through the cache (the record may have moved).
+    onceStore.set("doc:5", std::string(4000, 'z'));
+    // Read it back.
+    assert(onceStore.getView("doc:5")->size() == 4000 && onceStore.getView("doc:5")->data() == onceStore.peek("doc:5")->data());
+    // Shrink it back.
+    onceStore.set("doc:5", std::string(valueSize, 'f'));
+    // Whole-store footprint.
+    size_t onceBytes = onceStore.memoryUsage();
+    // What a cache copying the same entries would have added on top.
+    LRUCache copyingCache(1000);
+    // Copy every entry in.
+    for (int i = 0; i < 1000; ++i) copyingCache.put("doc:" + std::to_string(i), *onceStore.peek("doc:" + std::to_string(i)));
+    // Assert that values are not stored twice: the store holds less than 1.5x the payload, where a copying cache alone adds 1x.
+    assert(onceBytes < payloadBytes * 3 / 2 && copyingCache.memoryUsage() > payloadBytes);
+    // Informational output.
+    std::cout << "Info: " << payloadBytes << " payload bytes held in " << onceBytes << " bytes; a copying cache would add "
+              << copyingCache.memoryUsage() << " bytes." << std::endl;
+    // Print pass message for test 16.
+    std::cout << "Test 16 (values resident once) PASSED." << std::endl;
+
+    // Test 17: multiGet / multiSet agree with key-at-a-time calls across batch boundaries and filter modes.
+    for (FilterMode mode : {FilterMode::Bloom, FilterMode::Cuckoo}) {
+        // An odd batch size, so batches end mid-request.
+        KVStoreConfig batchConfig;
+        // Seven keys per batch.
+        batchConfig.multiKeyBatch = 7;
+        // Filter under test.
+        batchConfig.filterMode = mode;
+        // Fake clock for the expiry case.
+        uint64_t batchClock = 1000;
+        // Read through the variable.
+        batchConfig.clock = [&batchClock]() { return batchClock; };
+        // Build the store.
+        KVStore batchStore(batchConfig);
+        // A hundred pairs, with the last write to "m:3" winning.
+        std::vector<std::pair<std::string, std::string>> pairs;
+        // Fill them.
+        for (int i = 0; i < 100; ++i) pairs.emplace_back("m:" + std::to_string(i), "v" + std::to_string(i));
+        // Overwrite one key later in the same request.
+        pairs.emplace_back("m:3", "last");
+        // Assert that every write went through.
+        assert(batchStore.multiSet(pairs) && batchStore.size() == 100);
+        // One key with a deadline that passes before the read.
+        batchStore.setWithTtl("m:50", "gone", 10);
+        // Move past it.
+        batchClock += 20;
+        // Present, missing, expired and repeated keys mixed together.
+        std::vector<std::string> keys;
+        // Every stored key, then as many missing ones.
+        for (int i = 0; i < 200; ++i) keys.push_back("m:" + std::to_string(i));
+        // A repeat.
+        keys.push_back("m:7");
+        // Look them all up at once.
+        std::vector<std::optional<std::string_view>> values = batchStore.multiGet(keys);
+        // Assert one result per key.
+        assert(values.size() == keys.size());
+        // Compare with single-key lookups.
+        for (size_t i = 0; i < keys.size(); ++i) {
+            // What a single read sees.
+            std::optional<std::string_view> single = batchStore.peek(keys[i]);
+            // Assert that both agree on presence and content.
+            assert(values[i].has_value() == single.has_value() && (!single || *values[i] == *single));
+        }
+        // Assert the specific cases: the later write won, the expired key and missing keys read as absent.
+        assert(*values[3] == "last" && !values[50] && !values[150] && *values[200] == "v7");
+        // Assert that an empty request is fine.
+        assert(batchStore.multiGet({}).empty() && batchStore.multiSet({}));
+    }
+    // A budget too small for a big batch: multiSet reports the rejection and keeps what fit.
+    KVStoreConfig tightConfig;
+    // Tiny budget without eviction.
+    tightConfig.maxMemoryBytes = 64 * 1024;
+    // Build the store.
+    KVStore tightStore(tightConfig);
+    // Many 1 KB values.
+    std::vector<std::pair<std::string, std::string>> bigPairs;
+    // Far more than fit.
+    for (int i = 0; i < 500; ++i) bigPairs.emplace_back("big:" + std::to_string(i), std::string(1000, 'b'));
+    // Assert that the batch was partly rejected but the first pairs were stored.
+    assert(!tightStore.multiSet(bigPairs) && tightStore.size() > 0 && tightStore.size() < 500 && tightStore.peek("big:0"));
+    // A deadline that passes in the middle of a request: every read of the clock after the first is past it.
+    KVStoreConfig raceConfig;
+    // Clock reads so far.
+    uint64_t clockReads = 0;
+    // Reads after which the clock jumps (set below, once the key is written).
+    uint64_t jumpAfter = UINT64_MAX;
+    // Fake clock that jumps 10 seconds ahead after jumpAfter reads.
+    raceConfig.clock = [&clockReads, &jumpAfter]() { return ++clockReads > jumpAfter ? uint64_t(11000) : uint64_t(1000); };
+    // Build the store.
+    KVStore raceStore(raceConfig);
+    // Due at 1100.
+    assert(raceStore.setWithTtl("race", "value", 100));
+    // The next read is the request's; any read after it is past the deadline.
+    jumpAfter = clockReads + 1;
+    // The same key twice (MGET race race).
+    std::vector<std::optional<std::string_view>> raced = raceStore.multiGet({"race", "race"});
+    // Assert that both copies were judged at the same instant and still point at the live record.
+    assert(raced.size() == 2 && raced[0] && raced[1] && *raced[0] == "value" && *raced[1] == "value");
+    // Assert that the next access sees the deadline passed.
+    assert(!raceStore.getView("race") && raceStore.size() == 0);
+    // Print pass message for test 17.
+    std::cout << "Test 17 (batched MGET/MSET) PASSED." << std::endl;
+
+    // Test 18: Snapshots read one point in time while writes continue, and kept versions are collected on release.
+    {
+        // Manual clock for deadlines.
+        uint64_t snapNow = 1000000;
+        // Configuration reading it.
+        KVStoreConfig snapConfig;
+        // Read the test's clock.
+        snapConfig.clock = [&snapNow]() { return snapNow; };
+        // Build the store.
+        KVStore snapStore(snapConfig);
+        // Keys under one prefix.
+        for (int i = 0; i < 10; ++i) snapStore.set("user:" + std::to_string(i), "v" + std::to_string(i));
+        // A key with a deadline.
+        snapStore.setWithTtl("user:ttl", "short", 500);
+        // Without a snapshot, writes keep nothing.
+        snapStore.set("user:0", "v0");
+        // Assert that no versions are kept.
+        assert(snapStore.versionStats().keptVersions == 0);
+        // Take a snapshot.
+        KVSnapshot first = snapStore.snapshot();
+        // Overwrite, delete, create and change deadlines after it.
+        snapStore.set("user:1", "changed");
+        // Overwrite again (only the state the snapshot saw is kept).
+        snapStore.set("user:1", "changed again");
+        // Delete.
+        snapStore.remove("user:2");
+        // Create.
+        snapStore.set("user:new", "fresh");
+        // Give a key a deadline.
+        snapStore.expire("user:3", 10);
+        // Drop the other's deadline.
+        snapStore.persist("user:ttl");
+        // Assert that the snapshot still sees the old values.
+        assert(first.get("user:1") == std::string("v1") && first.get("user:2") == std::string("v2") && !first.get("user:new"));
+        // Assert that the store sees the new ones.
+        assert(snapStore.get("user:1") == "changed again" && !snapStore.peek("user:2") && snapStore.get("user:new") == "fresh");
+        // Assert that one state is kept per key written (user:1 once, not twice).
+        assert(snapStore.versionStats().versionedKeys == 5 && snapStore.versionStats().keptVersions == 5);
+        // Let the deadlines pass: user:3 now expires and is reclaimed, user:ttl would have.
+        snapNow += 1000;
+        // Reclaim user:3.
+        snapStore.tick();
+        // Assert that the snapshot judges deadlines as of when it was taken.
+        assert(first.get("user:3") == std::string("v3") && first.get("user:ttl") == std::string("short"));
+        // Assert that the store sees user:3 gone and user:ttl kept.
+        assert(!snapStore.peek("user:3") && snapStore.peek("user:ttl"));
+        // Assert that the snapshot's prefix search is its own point in time, in order.
+        std::vector<std::string> expectedKeys = {"user:0", "user:1", "user:2", "user:3", "user:4", "user:5", "user:6", "user:7", "user:8", "user:9", "user:ttl"};
+        // Compare.
+        assert(first.prefixSearch("user:") == expectedKeys);
+        // The live view has user:new and lacks user:2 and user:3.
+        std::vector<std::string> liveKeys = snapStore.prefixSearch("user:");
+        // Assert it.
+        assert(liveKeys.size() == 10 && std::find(liveKeys.begin(), liveKeys.end(), "user:new") != liveKeys.end());
+        // Assert that a reverse range scan of the snapshot merges deleted keys in too.
+        std::vector<std::pair<std::string, std::string>> range = first.scanRange("user:1", std::string("user:4"), 10, true);
+        // user:3, user:2, user:1 with their old values.
+        assert(range.size() == 3 && range[0].first == "user:3" && range[1] == std::make_pair(std::string("user:2"), std::string("v2"))
+               && range[2].second == "v1");
+        // Assert that entries page through the snapshot with deadlines.
+        std::vector<SnapshotEntry> page = first.entries("user:", std::string("user:8"), 5);
+        // user:9, user:ttl.
+        assert(page.size() == 2 && page[0].key == "user:9" && page[1].key == "user:ttl" && page[1].deadline == 1000500);
+        // A second, later snapshot sees the current state.
+        KVSnapshot second = snapStore.snapshot();
+        // More writes.
+        snapStore.set("user:1", "third");
+        // Assert that each snapshot sees its own version.
+        assert(first.get("user:1") == std::string("v1") && second.get("user:1") == std::string("changed again"));
+        // A snapshot written to a file restores its point in time.
+        std::string snapPath = "test_kv_store_mvcc.kvs";
+        // Save the first snapshot's view.
+        assert(snapStore.save(snapPath, first));
+        // Release the first: only the states the second needs remain.
+        first.release();
+        // Assert that the older states went.
+        assert(snapStore.versionStats().openSnapshots == 1 && snapStore.versionStats().keptVersions == 1 && second.get("user:1") == std::string("changed again"));
+        // Releasing the last snapshot drops everything.
+        second.release();
+        // Assert that nothing is kept.
+        assert(snapStore.versionStats().keptVersions == 0 && snapStore.versionStats().versionBytes == 0 && snapStore.versionStats().collectedVersions == 6);
+        // Load the file while the clock is back at the snapshot's time.
+        snapNow -= 1000;
+        // Fresh store on the same clock.
+        KVStore restored(snapConfig);
+        // Assert that it holds the snapshot's state.
+        assert(restored.load(snapPath) && restored.size() == 11 && restored.get("user:1") == "v1" && restored.get("user:2") == "v2"
+               && !restored.peek("user:new") && restored.ttl("user:ttl") == 500);
+        // Clean up.
+        std::remove(snapPath.c_str());
+    }
+    // Print pass message for test 18.
+    std::cout << "Test 18 (MVCC snapshots) PASSED." << std::endl;
+
 
     // Print completion message for KVStore tests.
     std::cout << "All KVStore Tests PASSED (some behaviors are probabilistic/informational)." << std::endl;
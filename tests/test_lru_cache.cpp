@@ -87,6 +87,164 @@ int main() {
     // Print pass message for test 8.
     std::cout << "Test 8 (remove key) PASSED." << std::endl;
 
+    // Test 9: Borrowed lookup by string_view updates recency and distinguishes empty values.
+    LRUCache viewCache(2);
+    // Cache an empty value.
+    viewCache.put("empty", "");
+    // Cache a regular value.
+    viewCache.put("full", "value");
+    // Assert that the empty value is a hit; this also makes "empty" most recently used.
+    assert(viewCache.find("empty").has_value() && viewCache.find("empty")->empty());
+    // Insert a third key, which must evict "full" (least recently used).
+    viewCache.put("third", "3");
+    // Assert that "full" was evicted.
+    assert(!viewCache.find("full").has_value());
+    // Assert that "third" is borrowed correctly.
+    assert(*viewCache.find("third") == "3");
+    // Print pass message for test 9.
+    std::cout << "Test 9 (find by string_view) PASSED." << std::endl;
+
+    // Test 10: Every policy keeps the basic cache contract.
+    for (CachePolicy policy : {CachePolicy::LRU, CachePolicy::WTinyLFU, CachePolicy::S3FIFO}) {
+        // Cache under test.
+        LRUCache policyCache(100, policy);
+        // Assert that the policy is reported.
+        assert(policyCache.cachePolicy() == policy);
+        // Insert many more keys than fit.
+        for (int i = 0; i < 1000; ++i) {
+            // Insert key i.
+            policyCache.put("key" + std::to_string(i), "value" + std::to_string(i));
+            // Assert that the capacity is never exceeded.
+            assert(policyCache.size() <= 100);
+        }
+        // Insert a key, then read it back through every lookup.
+        policyCache.put("fresh", "1");
+        // Assert that a key just inserted into a cache with room for it is found (window/small queue).
+        assert(policyCache.find("fresh").has_value() && *policyCache.find("fresh") == "1");
+        // Update it.
+        policyCache.put("fresh", "2");
+        // Assert that the update is visible.
+        assert(policyCache.get("fresh") == "2");
+        // Assert that removal works.
+        assert(policyCache.remove("fresh") && !policyCache.contains("fresh"));
+        // Assert that every key the cache reports maps to its own value.
+        for (int i = 0; i < 1000; ++i) {
+            // Look key i up.
+            std::optional<std::string_view> value = policyCache.find("key" + std::to_string(i));
+            // Hits must be correct.
+            assert(!value || *value == "value" + std::to_string(i));
+        }
+    }
+    // Print pass message for test 10.
+    std::cout << "Test 10 (policy basics) PASSED." << std::endl;
+
+    // Test 11: A one-off scan flushes the hot set from LRU but not from W-TinyLFU or S3-FIFO.
+    for (CachePolicy policy : {CachePolicy::LRU, CachePolicy::WTinyLFU, CachePolicy::S3FIFO}) {
+        // Cache under test.
+        LRUCache scanCache(1000, policy);
+        // Warm a hot set of 500 keys, read many times.
+        for (int round = 0; round < 10; ++round) {
+            // Read each hot key, inserting it on a miss.
+            for (int i = 0; i < 500; ++i) {
+                // Hot key i.
+                std::string key = "hot" + std::to_string(i);
+                // Insert on a miss.
+                if (!scanCache.find(key)) scanCache.put(key, "v");
+            }
+        }
+        // Sweep 20000 keys once each, as a batch job would.
+        for (int i = 0; i < 20000; ++i) {
+            // Scan key i.
+            std::string key = "scan" + std::to_string(i);
+            // Insert on a miss.
+            if (!scanCache.find(key)) scanCache.put(key, "v");
+        }
+        // Count hot keys that survived.
+        int survivors = 0;
+        // Check each hot key.
+        for (int i = 0; i < 500; ++i) survivors += scanCache.contains("hot" + std::to_string(i));
+        // Print the survival count.
+        std::cout << "Info: hot keys surviving a scan: " << survivors << " of 500" << std::endl;
+        // Assert that LRU lost them and the scan-resistant policies kept nearly all of them.
+        if (policy == CachePolicy::LRU) assert(survivors == 0);
+        else assert(survivors >= 450);
+    }
+    // Print pass message for test 11.
+    std::cout << "Test 11 (scan resistance) PASSED." << std::endl;
+
+    // Test 12: The frequency sketch never undercounts and decays with age.
+    FrequencySketch sketch(1000);
+    // Access key 1 five times and key 2 once.
+    for (int i = 0; i < 5; ++i) sketch.increment(1);
+    // One access to key 2.
+    sketch.increment(2);
+    // Assert that the estimates are at least the true counts.
+    assert(sketch.frequency(1) >= 5 && sketch.frequency(2) >= 1);
+    // Assert that counters saturate instead of wrapping.
+    for (int i = 0; i < 100; ++i) sketch.increment(3);
+    // Saturated.
+    assert(sketch.frequency(3) == FrequencySketch::MAX_COUNT);
+    // Halve everything.
+    sketch.age();
+    // Assert that the counts halved.
+    assert(sketch.frequency(3) == FrequencySketch::MAX_COUNT / 2 && sketch.frequency(1) >= 2);
+    // Print pass message for test 12.
+    std::cout << "Test 12 (frequency sketch) PASSED." << std::endl;
+
+    // Test 13: Memory accounting follows inserts, evictions and removals.
+    LRUCache sizedCache(4);
+    // Usage of the empty cache.
+    size_t emptyUsage = sizedCache.memoryUsage();
+    // A key with a value too large for the small-string buffer.
+    sizedCache.put("big", std::string(1000, 'b'));
+    // Usage with it cached.
+    size_t bigUsage = sizedCache.memoryUsage();
+    // Assert that the value's bytes are counted.
+    assert(bigUsage >= emptyUsage + 1000);
+    // Remove it.
+    sizedCache.remove("big");
+    // Assert that its bytes are released.
+    assert(sizedCache.memoryUsage() + 1000 <= bigUsage);
+    // Fill past capacity with large values.
+    for (int i = 0; i < 10; ++i) sizedCache.put("k" + std::to_string(i), std::string(1000, 'v'));
+    // Assert that exactly the four cached entries are counted (plus bounded per-entry and bucket overhead).
+    assert(sizedCache.memoryUsage() >= emptyUsage + 4 * 1000 && sizedCache.memoryUsage() < emptyUsage + 5 * 1000);
+    // Print pass message for test 13.
+    std::cout << "Test 13 (memory usage) PASSED." << std::endl;
+
+    // Test 14: Borrowed mode keeps views of the caller's values instead of copies.
+    LRUCache borrowedCache(100, CachePolicy::LRU, CacheStorage::Borrowed);
+    // Same contents in a copying cache, for comparison.
+    LRUCache ownedCache(100);
+    // Values owned by the caller.
+    std::vector<std::string> values;
+    // A hundred 1 KB values.
+    for (int i = 0; i < 100; ++i) values.push_back(std::string(1000, static_cast<char>('a' + i % 26)));
+    // Cache them in both.
+    for (int i = 0; i < 100; ++i) {
+        // Borrowed: only a view is kept.
+        borrowedCache.put("key" + std::to_string(i), values[i]);
+        // Owned: copied.
+        ownedCache.put("key" + std::to_string(i), values[i]);
+    }
+    // Assert that the borrowed lookup returns the caller's own bytes.
+    assert(borrowedCache.find("key7")->data() == values[7].data());
+    // Assert that the owned lookup returns a copy.
+    assert(ownedCache.find("key7")->data() != values[7].data() && *ownedCache.find("key7") == values[7]);
+    // Assert that the borrowed cache does not pay for the values.
+    assert(borrowedCache.memoryUsage() + 100 * 1000 <= ownedCache.memoryUsage());
+    // Re-point an entry at new bytes.
+    std::string replacement = "replacement";
+    // Update it.
+    borrowedCache.put("key7", replacement);
+    // Assert that the view follows.
+    assert(borrowedCache.find("key7")->data() == replacement.data() && borrowedCache.size() == 100);
+    // Informational output.
+    std::cout << "Info: 100 x 1 KB values, borrowed cache " << borrowedCache.memoryUsage() << " bytes, owned cache "
+              << ownedCache.memoryUsage() << " bytes." << std::endl;
+    // Print pass message for test 14.
+    std::cout << "Test 14 (borrowed values) PASSED." << std::endl;
+
     // Print completion message for LRUCache tests.
     std::cout << "All LRUCache Tests PASSED." << std::endl;
     // Return 0 indicating successful execution.
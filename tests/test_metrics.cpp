@@ -0,0 +1,262 @@
+#include "../include/metrics.hpp"
+#include "../include/kv_store.hpp"
+#include "../include/sharded_kv_store.hpp"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic> // For the crowd's progress
+#include <random> // For the recorded values
+#include <algorithm> // For std::sort
+
+// Main function for testing LatencyHistogram, StoreMetrics and KVStore::metrics.
+int main() {
+    // Print start message for metrics tests.
+    std::cout << "Running Metrics Tests..." << std::endl;
+
+    // Test 1: Bucket boundaries tile the range and percentiles stay within a bucket's width.
+    for (size_t bucket = 0; bucket + 1 < LatencyHistogram::BUCKET_COUNT; ++bucket) {
+        // Both ends map back to the bucket.
+        assert(LatencyHistogram::bucketOf(LatencyHistogram::bucketLow(bucket)) == bucket);
+        // Both ends map back to the bucket.
+        assert(LatencyHistogram::bucketOf(LatencyHistogram::bucketHigh(bucket)) == bucket);
+        // The next bucket starts right after it.
+        assert(LatencyHistogram::bucketLow(bucket + 1) == LatencyHistogram::bucketHigh(bucket) + 1);
+    }
+    // Values past the range share the last bucket.
+    assert(LatencyHistogram::bucketOf(UINT64_MAX) == LatencyHistogram::BUCKET_COUNT - 1);
+    // Recorded values.
+    LatencyHistogram histogram;
+    // The same values, for exact percentiles.
+    std::vector<uint64_t> values;
+    // Fixed seed.
+    std::mt19937_64 random(7);
+    // Log-uniform values from 1 ns to about 1 ms.
+    for (int i = 0; i < 100000; ++i) {
+        // Spread over 20 powers of two.
+        uint64_t value = (random() % 1024 + 1) << (random() % 10);
+        // Record it.
+        histogram.record(value);
+        // Keep it.
+        values.push_back(value);
+    }
+    // Exact order.
+    std::sort(values.begin(), values.end());
+    // Assert that the count and maximum are exact.
+    assert(histogram.count() == values.size() && histogram.max() == values.back());
+    // Each percentile.
+    for (double fraction : {0.5, 0.9, 0.99, 0.999}) {
+        // Exact value.
+        uint64_t exact = values[static_cast<size_t>(fraction * static_cast<double>(values.size())) - 1];
+        // Reported value (the top of the bucket holding it).
+        uint64_t reported = histogram.percentile(fraction);
+        // Assert that it is no lower and at most one bucket width (1/16) higher.
+        assert(reported >= exact && reported <= exact + exact / LatencyHistogram::SUB_BUCKETS + 1);
+    }
+    // Second histogram to merge.
+    LatencyHistogram other;
+    // Three slow values.
+    other.record(5000000, 3);
+    // Merge.
+    histogram.merge(other);
+    // Assert that the totals and maximum moved.
+    assert(histogram.count() == values.size() + 3 && histogram.max() == 5000000 && histogram.percentile(1.0) == 5000000);
+    // Assert that an empty histogram reports zeros.
+    assert(LatencyHistogram().percentile(0.99) == 0 && LatencyHistogram().max() == 0);
+    // Print pass message for test 1.
+    std::cout << "Test 1 (log-linear buckets and percentiles) PASSED." << std::endl;
+
+#ifdef KV_STORE_METRICS
+    // Test 2: Per-thread blocks add up to what every thread recorded, and timing is sampled.
+    {
+        // The instrumentation under test.
+        StoreMetrics metrics;
+        // Threads.
+        std::vector<std::thread> threads;
+        // Four of them, recording and counting concurrently.
+        for (int t = 0; t < 4; ++t) {
+            // Each records its own mix.
+            threads.emplace_back([&metrics, t]() {
+                // Many operations.
+                for (int i = 0; i < 10000; ++i) {
+                    // A timed get.
+                    { StoreMetrics::Timer timer(metrics, MetricOp::Get); }
+                    // A set of known length in ticks.
+                    metrics.record(MetricOp::Set, static_cast<uint64_t>(100 + t));
+                    // A hit.
+                    metrics.count(MetricCounter::CacheHits);
+                }
+                // A batch of misses at once.
+                metrics.count(MetricCounter::CacheMisses, 5);
+            });
+        }
+        // Collect while they run (must not disturb them).
+        MetricsSnapshot during;
+        // Collect.
+        metrics.collect(during);
+        // Wait for them.
+        for (std::thread& thread : threads) thread.join();
+        // Collect the final figures.
+        MetricsSnapshot snapshot;
+        // Collect.
+        metrics.collect(snapshot);
+        // Assert that everything was counted.
+        assert(snapshot.enabled && snapshot.cacheHits == 40000 && snapshot.cacheMisses == 20);
+        // Assert that every call was counted.
+        assert(snapshot.calls[static_cast<size_t>(MetricOp::Get)] == 40000 && snapshot.calls[static_cast<size_t>(MetricOp::Set)] == 40000);
+        // Assert that one timed get in METRIC_SAMPLE_PERIOD was kept, starting with each thread's first.
+        assert(snapshot.latency[static_cast<size_t>(MetricOp::Get)].count() == 4 * ((10000 + METRIC_SAMPLE_PERIOD - 1) / METRIC_SAMPLE_PERIOD));
+        // Assert that every directly recorded duration was kept.
+        assert(snapshot.latency[static_cast<size_t>(MetricOp::Set)].count() == 40000);
+        // Assert that nothing else was.
+        assert(snapshot.calls[static_cast<size_t>(MetricOp::Remove)] == 0 && snapshot.latency[static_cast<size_t>(MetricOp::Remove)].count() == 0);
+        // Assert that a mid-run collect saw no more than the end.
+        assert(during.cacheHits <= snapshot.cacheHits);
+        // More threads alive at once than there are blocks: the rest share the overflow block and lose nothing.
+        StoreMetrics crowded;
+        // Threads that have counted.
+        std::atomic<size_t> counted{0};
+        // The crowd.
+        std::vector<std::thread> crowd;
+        // Past the table.
+        const size_t crowdSize = StoreMetrics::MAX_THREADS + 16;
+        // Start them.
+        for (size_t t = 0; t < crowdSize; ++t) {
+            // Each counts once, then stays alive (keeping its thread index) until every thread has counted.
+            crowd.emplace_back([&crowded, &counted, crowdSize]() {
+                // One event.
+                crowded.count(MetricCounter::CacheMisses);
+                // One timed call.
+                crowded.record(MetricOp::Get, 10);
+                // Done.
+                counted.fetch_add(1);
+                // Wait for the rest.
+                while (counted.load() < crowdSize) std::this_thread::yield();
+            });
+        }
+        // Wait for them.
+        for (std::thread& thread : crowd) thread.join();
+        // Their figures.
+        MetricsSnapshot crowdSnapshot;
+        // Collect.
+        crowded.collect(crowdSnapshot);
+        // Assert that every thread's count arrived.
+        assert(crowdSnapshot.cacheMisses == crowdSize && crowdSnapshot.calls[static_cast<size_t>(MetricOp::Get)] == crowdSize);
+        // Assert that every duration arrived.
+        assert(crowdSnapshot.latency[static_cast<size_t>(MetricOp::Get)].count() == crowdSize);
+    }
+    // Print pass message for test 2.
+    std::cout << "Test 2 (per-thread recording) PASSED." << std::endl;
+#else
+    // Print skip message for test 2.
+    std::cout << "Test 2 (per-thread recording) SKIPPED (built without KV_STORE_METRICS)." << std::endl;
+#endif
+
+    // Test 3: KVStore counts cache hits and misses and filter negatives and false positives, and reports its structures.
+    {
+        // Small cache, and a one-block filter that says "maybe" to most keys once full.
+        KVStoreConfig config;
+        // Room for a few keys.
+        config.cacheCapacity = 4;
+        // Tiny filter.
+        config.bloomFilterSize = 64;
+        // Left saturated (no rebuild).
+        config.filterRebuildFactor = 0;
+        // The store.
+        KVStore store(config);
+        // Keys.
+        for (int i = 0; i < 1000; ++i) store.set("user:" + std::to_string(i), "value" + std::to_string(i));
+        // Cold reads (the last writes are cached, the early ones are not).
+        for (int i = 0; i < 100; ++i) store.getView("user:" + std::to_string(i));
+        // The same key again (a hit now).
+        for (int i = 0; i < 10; ++i) store.getView("user:0");
+        // Absent keys: ruled out by the filter, or let through and missed.
+        for (int i = 0; i < 1000; ++i) store.getView("absent:" + std::to_string(i));
+        // A few more operations of other kinds.
+        store.remove("user:999");
+        // Prefix search.
+        store.prefixSearch("user:1");
+        // Range scan.
+        store.scanRange("user:1", std::nullopt, 10);
+        // Batched lookups.
+        store.multiGet({"user:1", "user:2", "nope"});
+        // The report.
+        MetricsSnapshot metrics = store.metrics();
+        // Assert that the structure figures are there whatever the build.
+        assert(metrics.keys == 999 && metrics.trieNodes >= metrics.keys && metrics.probeSamples > 0 && metrics.meanProbeLength >= 1.0);
+        // Assert that the counters add up when collected.
+        if (metrics.enabled) {
+            // Every present-key lookup is a hit or a miss (113 through getView and multiGet).
+            assert(metrics.cacheHits + metrics.cacheMisses >= 112);
+            // The repeated key hit after its first read (the 4-entry cache had evicted it).
+            assert(metrics.cacheHits >= 9);
+            // Every absent lookup was ruled out or a false positive (remove does not count).
+            assert(metrics.filterNegatives + metrics.filterFalsePositives == 1001);
+            // The saturated filter let some through.
+            assert(metrics.filterFalsePositives > 0);
+            // getView calls: 100 + 10 + 1000.
+            assert(metrics.calls[static_cast<size_t>(MetricOp::Get)] == 1110);
+            // One of each.
+            assert(metrics.calls[static_cast<size_t>(MetricOp::MultiGet)] == 1 && metrics.calls[static_cast<size_t>(MetricOp::Remove)] == 1);
+            // Sets.
+            assert(metrics.calls[static_cast<size_t>(MetricOp::Set)] == 1000);
+            // Timed: one in METRIC_SAMPLE_PERIOD of the 1110 consecutive gets.
+            uint64_t sampled = metrics.latency[static_cast<size_t>(MetricOp::Get)].count();
+            // 17 or 18, depending on where the countdown stood.
+            assert(sampled >= 1110 / METRIC_SAMPLE_PERIOD && sampled <= 1110 / METRIC_SAMPLE_PERIOD + 1);
+            // Percentiles are ordered.
+            const LatencyHistogram& gets = metrics.latency[static_cast<size_t>(MetricOp::Get)];
+            // p50 <= p99 <= p999 <= max.
+            assert(gets.percentile(0.5) <= gets.percentile(0.99) && gets.percentile(0.99) <= gets.percentile(0.999) && gets.percentile(0.999) <= gets.max());
+        }
+        // The INFO text.
+        std::string info = formatMetrics(metrics);
+        // Assert that both sections are there.
+        assert(info.find("# Stats\r\n") != std::string::npos && info.find("# Latency\r\n") != std::string::npos);
+        // Assert that the structure lines are there.
+        assert(info.find("keys:999\r\n") != std::string::npos && info.find("trie_nodes:") != std::string::npos);
+        // Assert that latency lines appear only when collected.
+        assert((info.find("latency_get:calls=1110,sampled=") != std::string::npos) == metrics.enabled);
+        // Assert that a section can be asked for alone.
+        assert(formatMetrics(metrics, "latency").find("# Stats") == std::string::npos);
+        // Print the report's counters.
+        std::cout << "Info: " << metrics.cacheHits << " cache hits, " << metrics.cacheMisses << " misses, " << metrics.filterNegatives
+                  << " filter negatives, " << metrics.filterFalsePositives << " false positives, mean probe " << metrics.meanProbeLength << "." << std::endl;
+    }
+    // Print pass message for test 3.
+    std::cout << "Test 3 (KVStore counters and INFO text) PASSED." << std::endl;
+
+    // Test 4: ShardedKVStore merges every shard's figures, with readers on several threads.
+    {
+        // Four shards.
+        ShardedKVStore store(4);
+        // Keys spread over them.
+        for (int i = 0; i < 400; ++i) store.set("key" + std::to_string(i), "v");
+        // Readers.
+        std::vector<std::thread> readers;
+        // Four of them.
+        for (int t = 0; t < 4; ++t) {
+            // Each reads every key.
+            readers.emplace_back([&store]() {
+                // Every key (through peek under the shard's shared lock).
+                for (int i = 0; i < 400; ++i) store.get("key" + std::to_string(i));
+            });
+        }
+        // Wait for them.
+        for (std::thread& reader : readers) reader.join();
+        // Merged report.
+        MetricsSnapshot metrics = store.metrics();
+        // Assert that the structures of every shard were summed (entries still migrating in a resize are not sampled).
+        assert(metrics.keys == 400 && metrics.trieNodes >= 400 && metrics.probeSamples > 0 && metrics.probeSamples <= 400);
+        // Assert that every thread's reads were counted.
+        if (metrics.enabled) assert(metrics.calls[static_cast<size_t>(MetricOp::Get)] == 1600);
+    }
+    // Print pass message for test 4.
+    std::cout << "Test 4 (sharded merge) PASSED." << std::endl;
+
+    // Print final success message.
+    std::cout << "All Metrics Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,423 @@
+#include "../include/resp.hpp"
+#include "../include/resp_server.hpp"
+#include "../include/kv_store.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <thread> // For the server's event loop
+#include <chrono> // For pacing split sends
+#include <algorithm> // For std::min
+#include <cstdio> // For std::remove
+#include <unistd.h> // For read, write, close
+#include <sys/socket.h> // For client sockets
+#include <netinet/in.h> // For sockaddr_in
+#include <arpa/inet.h> // For inet_pton
+
+namespace {
+    // Opens a blocking client connection to the server on localhost.
+    int connectTo(uint16_t port) {
+        // TCP socket.
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        // Assert that it was created.
+        assert(fd >= 0);
+        // Server address.
+        sockaddr_in address{};
+        // IPv4.
+        address.sin_family = AF_INET;
+        // Port in network order.
+        address.sin_port = htons(port);
+        // Loopback.
+        ::inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+        // Connect.
+        int connected = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        // Assert that it worked.
+        assert(connected == 0);
+        // Never block a failing test forever.
+        timeval timeout{5, 0};
+        // Apply it to reads.
+        ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        // Hand it back.
+        return fd;
+    }
+
+    // Sends all of data.
+    void sendAll(int fd, const std::string& data) {
+        // Bytes sent so far.
+        size_t sent = 0;
+        // Until everything went out.
+        while (sent < data.size()) {
+            // Send the rest.
+            ssize_t n = ::write(fd, data.data() + sent, data.size() - sent);
+            // Assert that the socket is healthy.
+            assert(n > 0);
+            // Past it.
+            sent += static_cast<size_t>(n);
+        }
+    }
+
+    // Reads exactly length bytes (fewer only if the server hangs up).
+    std::string readExactly(int fd, size_t length) {
+        // Bytes received.
+        std::string data;
+        // Read chunk.
+        char buffer[16384];
+        // Until the expected reply arrived.
+        while (data.size() < length) {
+            // Read what is there.
+            ssize_t n = ::read(fd, buffer, std::min(sizeof(buffer), length - data.size()));
+            // Hung up (or timed out).
+            if (n <= 0) break;
+            // Keep it.
+            data.append(buffer, static_cast<size_t>(n));
+        }
+        // Hand it back.
+        return data;
+    }
+
+    // Sends request and returns the reply, which must be as long as expected.
+    std::string roundTrip(int fd, const std::string& request, const std::string& expected) {
+        // Send it.
+        sendAll(fd, request);
+        // Read the reply.
+        return readExactly(fd, expected.size());
+    }
+
+    // Encodes a command as a RESP array of bulk strings.
+    std::string command(const std::vector<std::string>& words) {
+        // Encoded bytes.
+        std::string out;
+        // Array header.
+        Resp::appendArrayHeader(out, words.size());
+        // Each word as a bulk string.
+        for (const std::string& word : words) Resp::appendBulkString(out, word);
+        // Hand it back.
+        return out;
+    }
+
+    // Parses the single command in input, asserting the status.
+    std::vector<std::string> parseOne(const std::string& input, RespParseStatus expected, size_t* consumed = nullptr) {
+        // Views into input.
+        std::vector<std::string_view> args;
+        // Length of the command.
+        size_t used = 0;
+        // Reason for an error.
+        std::string error;
+        // Parse it.
+        RespParseStatus status = Resp::parseCommand(input, args, used, error);
+        // Assert the outcome.
+        assert(status == expected);
+        // An error always names its reason.
+        assert(status != RespParseStatus::Error || !error.empty());
+        // Report the length.
+        if (consumed != nullptr) *consumed = used;
+        // Owned copies.
+        return std::vector<std::string>(args.begin(), args.end());
+    }
+
+    // Runs Tests 3-7 against a live server using backend (label names it in the output).
+    void testLiveServer(ServerBackend backend, const std::string& label) {
+        // The store and the server, on a free port with its loop on another thread.
+        KVStore store;
+        // Settings.
+        ServerConfig config;
+        // Any free port.
+        config.port = 0;
+        // Requested backend.
+        config.backend = backend;
+        // Short ticks keep shutdown quick.
+        config.tickIntervalMs = 10;
+        // Snapshots of this run.
+        config.snapshotPath = "/tmp/kv_resp_server_test_" + std::to_string(::getpid()) + ".kvs";
+        // The server.
+        RespServer server(store, config);
+        // Assert that it listens.
+        assert(server.start());
+        // Assert that a port was picked.
+        assert(server.port() != 0);
+        // Serve in the background.
+        std::thread loop([&server]() { server.run(); });
+
+        // Test 3: Commands behave like their Redis counterparts.
+        {
+            // One client.
+            int fd = connectTo(server.port());
+            // Each request and its exact reply.
+            std::vector<std::pair<std::string, std::string>> exchanges = {
+                {command({"PING"}), "+PONG\r\n"},
+                {command({"SET", "name", "kv"}), "+OK\r\n"},
+                {command({"get", "name"}), "$2\r\nkv\r\n"},
+                {command({"GET", "missing"}), "$-1\r\n"},
+                {command({"MSET", "a", "1", "b", "2"}), "+OK\r\n"},
+                {command({"MGET", "a", "missing", "b"}), "*3\r\n$1\r\n1\r\n$-1\r\n$1\r\n2\r\n"},
+                {command({"EXISTS", "a", "b", "missing"}), ":2\r\n"},
+                {command({"DEL", "a", "missing"}), ":1\r\n"},
+                {command({"SET", "session", "x", "EX", "100"}), "+OK\r\n"},
+                {command({"TTL", "session"}), ":100\r\n"},
+                {command({"PERSIST", "session"}), ":1\r\n"},
+                {command({"TTL", "session"}), ":-1\r\n"},
+                {command({"TTL", "missing"}), ":-2\r\n"},
+                {command({"EXPIRE", "missing", "5"}), ":0\r\n"},
+                {command({"DBSIZE"}), ":3\r\n"},
+                {command({"PREFIX", "s"}), "*1\r\n$7\r\nsession\r\n"},
+                {command({"PREFIX", "zz"}), "*0\r\n"},
+                {command({"ECHO", "hi"}), "$2\r\nhi\r\n"},
+                {"PING\r\n", "+PONG\r\n"},
+                {command({"SAVE"}), "+OK\r\n"},
+                {command({"GET"}), "-ERR wrong number of arguments for 'get' command\r\n"},
+                {command({"SET", "k", "v", "EX", "-1"}), "-ERR invalid expire time in 'set' command\r\n"},
+                {command({"SET", "k", "v", "NX", "1"}), "-ERR syntax error\r\n"},
+                {command({"FLY"}), "-ERR unknown command 'FLY'\r\n"},
+            };
+            // Run them one at a time.
+            for (const std::pair<std::string, std::string>& exchange : exchanges) {
+                // Assert the reply.
+                assert(roundTrip(fd, exchange.first, exchange.second) == exchange.second);
+            }
+            // INFO answers with a bulk string whose length depends on the build.
+            sendAll(fd, command({"INFO", "stats"}));
+            // Its header, a byte at a time up to the CRLF.
+            std::string header;
+            // Until the header is complete.
+            while (header.size() < 2 || header.compare(header.size() - 2, 2, "\r\n") != 0) header += readExactly(fd, 1);
+            // Assert that it is a bulk string.
+            assert(header[0] == '$');
+            // Its body and the closing CRLF.
+            std::string info = readExactly(fd, std::stoul(header.substr(1)) + 2);
+            // Assert that the section asked for is there and the other is not.
+            assert(info.find("# Stats\r\n") == 0 && info.find("keys:3\r\n") != std::string::npos && info.find("# Latency") == std::string::npos);
+            // Assert that a bad arity is an error.
+            assert(roundTrip(fd, command({"STATS", "a", "b"}), "-ERR wrong number of arguments for 'stats' command\r\n")
+                   == "-ERR wrong number of arguments for 'stats' command\r\n");
+            // Done with it.
+            ::close(fd);
+            // Print success message for Test 3.
+            std::cout << "Test 3 (Commands and error replies) PASSED [" << label << "]." << std::endl;
+        }
+
+        // Test 4: A pipeline sent at once is answered in order, and a command split across reads waits for its rest.
+        {
+            // One client.
+            int fd = connectTo(server.port());
+            // 1000 writes and reads in one send.
+            std::string request;
+            // Their replies.
+            std::string expected;
+            // Build them.
+            for (int i = 0; i < 500; ++i) {
+                // Write a key.
+                request += command({"SET", "pipe" + std::to_string(i), "value" + std::to_string(i)});
+                // Its reply.
+                expected += "+OK\r\n";
+                // Read it back.
+                request += command({"GET", "pipe" + std::to_string(i)});
+                // Its reply.
+                Resp::appendBulkString(expected, "value" + std::to_string(i));
+            }
+            // Assert every reply, in order.
+            assert(roundTrip(fd, request, expected) == expected);
+            // A command dribbled out a few bytes at a time.
+            std::string split = command({"SET", "slow", std::string(1000, 's')}) + command({"GET", "slow"});
+            // Its replies.
+            std::string splitExpected = "+OK\r\n";
+            // The value.
+            Resp::appendBulkString(splitExpected, std::string(1000, 's'));
+            // Send it in pieces.
+            for (size_t offset = 0; offset < split.size(); offset += 97) {
+                // Next piece.
+                sendAll(fd, split.substr(offset, 97));
+                // Let the server read it on its own.
+                if (offset % 970 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+            // Assert the replies.
+            assert(readExactly(fd, splitExpected.size()) == splitExpected);
+            // Done with it.
+            ::close(fd);
+            // Print success message for Test 4.
+            std::cout << "Test 4 (Pipelining and split commands) PASSED [" << label << "]." << std::endl;
+        }
+
+        // Test 5: Replies larger than the socket buffer drain over several iterations while other clients are served.
+        {
+            // A client that reads slowly.
+            int slow = connectTo(server.port());
+            // A client that reads promptly.
+            int fast = connectTo(server.port());
+            // A 1 MiB value.
+            std::string big(1024 * 1024, 'b');
+            // Store it.
+            assert(roundTrip(fast, command({"SET", "big", big}), "+OK\r\n") == "+OK\r\n");
+            // Ask for it 16 times in one pipeline (16 MiB of replies).
+            std::string request;
+            // Their replies.
+            std::string expected;
+            // Build them.
+            for (int i = 0; i < 16; ++i) {
+                // Read it.
+                request += command({"GET", "big"});
+                // Its reply.
+                Resp::appendBulkString(expected, big);
+            }
+            // Send the pipeline without reading.
+            sendAll(slow, request);
+            // Let the server fill the socket buffer.
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            // The other client is not stuck behind it.
+            assert(roundTrip(fast, command({"PING"}), "+PONG\r\n") == "+PONG\r\n");
+            // Assert that the slow client gets every byte in order.
+            assert(readExactly(slow, expected.size()) == expected);
+            // Done with them.
+            ::close(slow);
+            // Done with it.
+            ::close(fast);
+            // Print success message for Test 5.
+            std::cout << "Test 5 (Large replies and fairness) PASSED [" << label << "]." << std::endl;
+        }
+
+        // Test 6: QUIT and protocol errors close the connection after their replies.
+        {
+            // One client.
+            int fd = connectTo(server.port());
+            // Commands after QUIT in the same pipeline are not executed.
+            std::string reply = roundTrip(fd, command({"QUIT"}) + command({"SET", "after", "quit"}), "+OK\r\n");
+            // Assert the acknowledgement.
+            assert(reply == "+OK\r\n");
+            // Assert that the server hung up.
+            assert(readExactly(fd, 1).empty());
+            // Done with it.
+            ::close(fd);
+            // Another client sends garbage.
+            fd = connectTo(server.port());
+            // Not a bulk string.
+            sendAll(fd, "*1\r\n:1\r\n");
+            // The error reply, then end of stream.
+            std::string error = readExactly(fd, 1024);
+            // Assert the reply.
+            assert(error.rfind("-ERR Protocol error: expected '$'", 0) == 0);
+            // Done with it.
+            ::close(fd);
+            // Assert that the command after QUIT did not run.
+            fd = connectTo(server.port());
+            // Look it up.
+            assert(roundTrip(fd, command({"EXISTS", "after"}), ":0\r\n") == ":0\r\n");
+            // Done with it.
+            ::close(fd);
+            // Print success message for Test 6.
+            std::cout << "Test 6 (QUIT and protocol errors) PASSED [" << label << "]." << std::endl;
+        }
+
+        // Stop the loop.
+        server.stop();
+        // Wait for it.
+        loop.join();
+        // Remove the snapshot written by SAVE.
+        std::remove(config.snapshotPath.c_str());
+
+        // Test 7: Replies are coalesced: far fewer writev calls than commands.
+        {
+            // The session's counters.
+            ServerStats stats = server.stats();
+            // Print the figures.
+            std::cout << "Info [" << label << "]: " << stats.commandsProcessed << " commands from " << stats.connectionsAccepted << " connections in "
+                      << stats.reads << " reads and " << stats.writevCalls << " writev calls (" << stats.loopIterations
+                      << " loop iterations)." << std::endl;
+            // Assert that every connection was seen.
+            assert(stats.connectionsAccepted == 7);
+            // Assert that the pipeline of 1000 commands shared writes.
+            assert(stats.writevCalls < stats.commandsProcessed / 2);
+            // Assert that the garbage was counted.
+            assert(stats.protocolErrors == 1);
+    #ifndef KV_STORE_IO_URING
+            // Without the io_uring build every request falls back to epoll.
+            assert(stats.backend == ServerBackend::Epoll);
+    #else
+            // io_uring_enter calls, when the kernel allowed the ring.
+            if (stats.backend == ServerBackend::IoUring) std::cout << "Info [" << label << "]: " << stats.ringSubmits << " io_uring_enter calls." << std::endl;
+    #endif
+            // Print success message for Test 7.
+            std::cout << "Test 7 (Coalesced writes) PASSED [" << label << "]." << std::endl;
+        }
+    }
+}
+
+// Main function for testing the RESP protocol and server.
+int main() {
+    // Print start message for RESP server tests.
+    std::cout << "Running RespServer Tests..." << std::endl;
+
+    // Test 1: The parser handles arrays, inline commands, binary arguments and commands split at any byte.
+    {
+        // A binary-safe command.
+        std::string encoded = command({"SET", std::string("k\r\n\0y", 5), ""});
+        // Length of the command.
+        size_t consumed = 0;
+        // Parse it whole.
+        std::vector<std::string> args = parseOne(encoded, RespParseStatus::Complete, &consumed);
+        // Assert the arguments, including the embedded CRLF and NUL and the empty value.
+        assert(args.size() == 3 && args[0] == "SET" && args[1] == std::string("k\r\n\0y", 5) && args[2].empty());
+        // Assert that all of it was used.
+        assert(consumed == encoded.size());
+        // Every proper prefix is incomplete.
+        for (size_t i = 0; i < encoded.size(); ++i) parseOne(encoded.substr(0, i), RespParseStatus::Incomplete);
+        // Inline commands split on runs of spaces, with or without a carriage return.
+        args = parseOne("GET   key\r\n", RespParseStatus::Complete, &consumed);
+        // Assert the words.
+        assert(args.size() == 2 && args[0] == "GET" && args[1] == "key" && consumed == 11);
+        // A bare newline terminator.
+        args = parseOne("PING\n", RespParseStatus::Complete, &consumed);
+        // Assert the word.
+        assert(args.size() == 1 && args[0] == "PING" && consumed == 5);
+        // Two pipelined commands parse one at a time.
+        std::string pipeline = command({"GET", "a"}) + command({"GET", "b"});
+        // First one.
+        args = parseOne(pipeline, RespParseStatus::Complete, &consumed);
+        // Assert that only it was used.
+        assert(args[1] == "a" && consumed == pipeline.size() / 2);
+        // Second one.
+        args = parseOne(pipeline.substr(consumed), RespParseStatus::Complete);
+        // Assert it.
+        assert(args[1] == "b");
+        // Malformed input is rejected.
+        parseOne("*1\r\n:5\r\n", RespParseStatus::Error);
+        // A length that is not a number.
+        parseOne("*x\r\n", RespParseStatus::Error);
+        // A bulk string without its terminator.
+        parseOne("*1\r\n$3\r\nabcde\r\n", RespParseStatus::Error);
+        // A header that never ends.
+        parseOne("*" + std::string(64, '1'), RespParseStatus::Error);
+        // Print success message for Test 1.
+        std::cout << "Test 1 (Incremental RESP parsing) PASSED." << std::endl;
+    }
+
+    // Test 2: Replies encode as RESP2.
+    {
+        // Encoded replies.
+        std::string out;
+        // One of each.
+        Resp::appendSimpleString(out, "OK");
+        // Error.
+        Resp::appendError(out, "ERR bad");
+        // Negative integer.
+        Resp::appendInteger(out, -2);
+        // Bulk string.
+        Resp::appendBulkString(out, "hello");
+        // Null.
+        Resp::appendNull(out);
+        // Empty array.
+        Resp::appendArrayHeader(out, 0);
+        // Assert the bytes.
+        assert(out == "+OK\r\n-ERR bad\r\n:-2\r\n$5\r\nhello\r\n$-1\r\n*0\r\n");
+        // Print success message for Test 2.
+        std::cout << "Test 2 (Reply encoding) PASSED." << std::endl;
+    }
+
+    // Tests 3-7 against the epoll backend.
+    testLiveServer(ServerBackend::Epoll, "epoll");
+    // And again through io_uring (which falls back to epoll unless built with KV_STORE_IO_URING).
+    testLiveServer(ServerBackend::IoUring, "io_uring");
+
+    // Print completion message for all RESP server tests.
+    std::cout << "All RespServer tests completed." << std::endl;
+    // Return 0 to indicate success.
+    return 0;
+}
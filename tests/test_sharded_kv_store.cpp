@@ -0,0 +1,254 @@
+#include "../include/sharded_kv_store.hpp"
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm> // For std::is_sorted
+#include <cstdio> // For std::remove
+
+// Main function for testing ShardedKVStore.
+int main() {
+    // Print start message for ShardedKVStore tests.
+    std::cout << "Running ShardedKVStore Tests..." << std::endl;
+
+    // Per-shard configuration with a Bloom filter large enough for the stress test.
+    KVStoreConfig config;
+    // Size each shard's filter for its share of the keys.
+    config.bloomFilterSize = 200000;
+
+    // Test 1: Single-threaded set/get/remove across shards.
+    ShardedKVStore store(8, config);
+    // Assert that the requested shard count was created.
+    assert(store.shardCount() == 8);
+    // Insert a handful of keys.
+    for (int i = 0; i < 100; ++i) {
+        // Insert key i.
+        store.set("key" + std::to_string(i), "value" + std::to_string(i));
+    }
+    // Assert that all keys were stored.
+    assert(store.size() == 100);
+    // Assert that a key reads back.
+    assert(store.get("key42").value() == "value42");
+    // Assert that removing works and reports presence.
+    assert(store.remove("key42") == true);
+    // Assert that the removed key is gone.
+    assert(!store.get("key42").has_value());
+    // Assert that removing again reports absence.
+    assert(store.remove("key42") == false);
+    // Print pass message for test 1.
+    std::cout << "Test 1 (set/get/remove) PASSED." << std::endl;
+
+    // Test 2: Prefix search fans out to all shards and merges results in sorted order.
+    std::vector<std::string> prefixResults = store.prefixSearch("key1");
+    // key1, key10..key19 = 11 keys.
+    assert(prefixResults.size() == 11);
+    // Assert that the merged output is sorted.
+    assert(std::is_sorted(prefixResults.begin(), prefixResults.end()));
+    // Assert that the first match is "key1".
+    assert(prefixResults.front() == "key1");
+    // Assert that a range scan merges the shards in key order and stops at the limit.
+    std::vector<std::pair<std::string, std::string>> rangePairs = store.scanRange("key2", std::string("key3"), 5);
+    // key2, key20, key21, key22, key23.
+    assert(rangePairs.size() == 5 && rangePairs.front().first == "key2" && rangePairs.back().first == "key23" && rangePairs[1].second == "value20");
+    // Print pass message for test 2.
+    std::cout << "Test 2 (prefix fan-out and merge) PASSED." << std::endl;
+
+    // Test 3: Concurrent writers and readers.
+    ShardedKVStore stressStore(16, config);
+    // Number of writer threads.
+    const int numWriters = 4;
+    // Number of reader threads.
+    const int numReaders = 4;
+    // Keys written per writer.
+    const int keysPerWriter = 2000;
+    // Set by readers that observe an impossible value.
+    std::atomic<bool> readerSawCorruption(false);
+    // Set when the writers are done.
+    std::atomic<bool> writersDone(false);
+    // Thread handles.
+    std::vector<std::thread> threads;
+    // Start the writers; each owns a disjoint key range and also churns a shared key.
+    for (int w = 0; w < numWriters; ++w) {
+        // Writer w.
+        threads.emplace_back([&, w]() {
+            // Write this writer's keys.
+            for (int i = 0; i < keysPerWriter; ++i) {
+                // Key unique to this writer.
+                std::string key = "w" + std::to_string(w) + ":" + std::to_string(i);
+                // Value derived from the key.
+                stressStore.set(key, "v" + key);
+                // Every writer also overwrites and deletes the same hot key.
+                if (i % 10 == 0) {
+                    // Overwrite the shared key.
+                    stressStore.set("hot", "writer" + std::to_string(w));
+                } else if (i % 10 == 5) {
+                    // Delete the shared key.
+                    stressStore.remove("hot");
+                }
+            }
+        });
+    }
+    // Start the readers.
+    for (int r = 0; r < numReaders; ++r) {
+        // Reader r.
+        threads.emplace_back([&, r]() {
+            // Read until the writers finish.
+            for (int i = 0; !writersDone.load(); ++i) {
+                // Pick a key that may or may not have been written yet.
+                std::string key = "w" + std::to_string((i + r) % numWriters) + ":" + std::to_string(i % keysPerWriter);
+                // Read it.
+                std::optional<std::string> value = stressStore.get(key);
+                // A present value must be the one its writer stored.
+                if (value && *value != "v" + key) readerSawCorruption = true;
+                // Read the contended key as well.
+                std::optional<std::string> hot = stressStore.get("hot");
+                // It is either absent or one of the writers' values.
+                if (hot && hot->compare(0, 6, "writer") != 0) readerSawCorruption = true;
+            }
+        });
+    }
+    // Wait for the writers.
+    for (int w = 0; w < numWriters; ++w) {
+        // Join writer w.
+        threads[w].join();
+    }
+    // Let the readers stop.
+    writersDone = true;
+    // Wait for the readers.
+    for (int r = 0; r < numReaders; ++r) {
+        // Join reader r.
+        threads[numWriters + r].join();
+    }
+    // Assert that readers never saw a torn or foreign value.
+    assert(!readerSawCorruption);
+    // Assert that every writer key is present with its value.
+    for (int w = 0; w < numWriters; ++w) {
+        // Check each key of writer w.
+        for (int i = 0; i < keysPerWriter; ++i) {
+            // Key written by writer w.
+            std::string key = "w" + std::to_string(w) + ":" + std::to_string(i);
+            // Assert that the value survived.
+            assert(stressStore.get(key).value() == "v" + key);
+        }
+    }
+    // Assert the total key count (the hot key may or may not be present).
+    assert(stressStore.size() == numWriters * keysPerWriter || stressStore.size() == numWriters * keysPerWriter + 1);
+    // Print pass message for test 3.
+    std::cout << "Test 3 (concurrent stress) PASSED." << std::endl;
+
+    // Test 4: Throughput of a 90% GET / 10% SET mix by thread count (informational).
+    ShardedKVStore benchStore(64, config);
+    // Preload keys.
+    for (int i = 0; i < 20000; ++i) {
+        // Insert key i.
+        benchStore.set("bench" + std::to_string(i), "payload");
+    }
+    // Largest thread count to try.
+    unsigned maxThreads = std::max(2u, std::thread::hardware_concurrency());
+    // Operations per thread.
+    const int opsPerThread = 100000;
+    // Double the thread count each round.
+    for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2) {
+        // Thread handles.
+        std::vector<std::thread> workers;
+        // Start time.
+        auto start = std::chrono::steady_clock::now();
+        // Launch the workers.
+        for (unsigned t = 0; t < numThreads; ++t) {
+            // Worker t.
+            workers.emplace_back([&, t]() {
+                // Run the mix.
+                for (int i = 0; i < opsPerThread; ++i) {
+                    // Key spread across all shards.
+                    std::string key = "bench" + std::to_string((i * 7919 + t * 104729) % 20000);
+                    // One write in ten.
+                    if (i % 10 == 0) {
+                        // Write.
+                        benchStore.set(key, "payload");
+                    } else {
+                        // Read.
+                        benchStore.get(key);
+                    }
+                }
+            });
+        }
+        // Wait for the workers.
+        for (auto& worker : workers) {
+            // Join the worker.
+            worker.join();
+        }
+        // Elapsed seconds.
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        // Print the throughput for this thread count.
+        std::cout << "Info: " << numThreads << " thread(s): "
+                  << static_cast<long long>(numThreads * opsPerThread / seconds) << " ops/sec" << std::endl;
+    }
+    // Print pass message for test 4.
+    std::cout << "Test 4 (throughput) PASSED (numbers are informational)." << std::endl;
+
+    // Test 5: prefixScan and save read one instant across shards while a writer keeps going.
+    ShardedKVStore scanStore(8, config);
+    // Keys the writer advances in order, spread over the shards.
+    const int chainLength = 16;
+    // Start every key at round 0.
+    for (int i = 0; i < chainLength; ++i) scanStore.set("chain:" + std::to_string(100 + i), "0");
+    // Filler so each scan reads several pages per shard.
+    for (int i = 0; i < 5000; ++i) scanStore.set("chain:1:filler" + std::to_string(i), "x");
+    // Tells the writer to stop.
+    std::atomic<bool> stopWriter{false};
+    // Rounds completed.
+    std::atomic<int> writerRounds{0};
+    // The writer: round n sets chain:100, chain:101, ... to n in that order.
+    std::thread chainWriter([&]() {
+        // Until told to stop.
+        for (int round = 1; !stopWriter.load(); ++round) {
+            // Each key in order.
+            for (int i = 0; i < chainLength; ++i) scanStore.set("chain:" + std::to_string(100 + i), std::to_string(round));
+            // Publish progress.
+            writerRounds.store(round);
+        }
+    });
+    // Scans while it writes.
+    for (int scan = 0; scan < 20; ++scan) {
+        // One instant.
+        std::vector<std::pair<std::string, std::string>> pairs = scanStore.prefixScan("chain:1");
+        // Rounds seen for chain:100.. in key order (they sort before the filler).
+        std::vector<int> rounds;
+        // Collect them.
+        for (const auto& pair : pairs) if (pair.first.size() == 9) rounds.push_back(std::stoi(pair.second));
+        // Assert that every chain key was seen, in order.
+        assert(rounds.size() == static_cast<size_t>(chainLength) && std::is_sorted(pairs.begin(), pairs.end()));
+        // Assert that the instant fell between two writes: earlier keys are at most one round ahead of later ones.
+        for (int i = 1; i < chainLength; ++i) assert(rounds[i] <= rounds[i - 1] && rounds[0] - rounds[i] <= 1);
+    }
+    // Save one instant while the writer keeps going.
+    assert(scanStore.save("test_sharded_mvcc.kvs"));
+    // Stop the writer.
+    stopWriter.store(true);
+    // Wait for it.
+    chainWriter.join();
+    // Load the files into a fresh store with the same shard count.
+    ShardedKVStore restoredStore(8, config);
+    // Assert that every shard loaded.
+    assert(restoredStore.load("test_sharded_mvcc.kvs"));
+    // The saved chain.
+    std::vector<std::pair<std::string, std::string>> saved = restoredStore.prefixScan("chain:1");
+    // Assert that it holds every key.
+    assert(saved.size() == static_cast<size_t>(chainLength) + 5000 && restoredStore.size() == static_cast<size_t>(chainLength) + 5000);
+    // Assert that the saved instant is consistent too.
+    for (int i = 1; i < chainLength; ++i) assert(std::stoi(saved[i].second) <= std::stoi(saved[i - 1].second) && std::stoi(saved[0].second) - std::stoi(saved[i].second) <= 1);
+    // Clean up.
+    for (size_t i = 0; i < 8; ++i) std::remove(("test_sharded_mvcc.kvs." + std::to_string(i)).c_str());
+    // Print writer progress.
+    std::cout << "Info: writer completed " << writerRounds.load() << " rounds during the scans." << std::endl;
+    // Print pass message for test 5.
+    std::cout << "Test 5 (consistent scans and save) PASSED." << std::endl;
+
+    // Print completion message for ShardedKVStore tests.
+    std::cout << "All ShardedKVStore Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -0,0 +1,114 @@
+#include "../include/slab_arena.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+
+// Main function for testing SlabArena.
+int main() {
+    // Print start message for SlabArena tests.
+    std::cout << "Running SlabArena Tests..." << std::endl;
+
+    // Create an arena.
+    SlabArena arena;
+
+    // Test 1: Allocate a record and read back its key and value.
+    char* record = arena.allocate("user:1", "alice");
+    // Assert that the key is stored.
+    assert(SlabArena::key(record) == "user:1");
+    // Assert that the value is stored.
+    assert(SlabArena::value(record) == "alice");
+    // Assert that a short record uses the smallest slot: 2 header bytes + 6 + 5 = 13 <= 16.
+    assert(SlabArena::footprint(record) == 16);
+    // Print pass message for test 1.
+    std::cout << "Test 1 (allocate/read) PASSED." << std::endl;
+
+    // Test 2: Reassigning a value that still fits its size class rewrites in place.
+    char* sameRecord = arena.reassign(record, "bob");
+    // Assert that the record did not move.
+    assert(sameRecord == record);
+    // Assert that the new value is visible.
+    assert(SlabArena::value(sameRecord) == "bob");
+    // Assert that the key is unchanged.
+    assert(SlabArena::key(sameRecord) == "user:1");
+    // Print pass message for test 2.
+    std::cout << "Test 2 (reassign in place) PASSED." << std::endl;
+
+    // Test 3: Reassigning a larger value moves the record to a bigger class.
+    char* grown = arena.reassign(sameRecord, std::string(100, 'x'));
+    // Assert that the record moved.
+    assert(grown != sameRecord);
+    // Assert that the value is intact.
+    assert(SlabArena::value(grown) == std::string(100, 'x'));
+    // Assert that the key travelled with it.
+    assert(SlabArena::key(grown) == "user:1");
+    // Assert that only one record is live.
+    assert(arena.stats().liveRecords == 1);
+    // Print pass message for test 3.
+    std::cout << "Test 3 (reassign and move) PASSED." << std::endl;
+
+    // Test 4: Freed slots are reused by the next allocation of the same class.
+    char* first = arena.allocate("a", "1");
+    // Free it.
+    arena.deallocate(first);
+    // Allocate another record of the same class.
+    char* second = arena.allocate("b", "2");
+    // Assert that the freed slot was recycled.
+    assert(second == first);
+    // Print pass message for test 4.
+    std::cout << "Test 4 (slot reuse) PASSED." << std::endl;
+
+    // Test 5: Oversized records and long lengths (multi-byte varint headers).
+    std::string bigValue(100000, 'z');
+    // Allocate outside the slab classes.
+    char* big = arena.allocate("big", bigValue);
+    // Assert that the value is intact.
+    assert(SlabArena::value(big) == bigValue);
+    // Assert that the oversized bytes are tracked.
+    assert(arena.stats().largeBytes >= bigValue.size());
+    // Free it.
+    arena.deallocate(big);
+    // Assert that the tracking is released.
+    assert(arena.stats().largeBytes == 0);
+    // Print pass message for test 5.
+    std::cout << "Test 5 (oversized records) PASSED." << std::endl;
+
+    // Test 6: Stats stay consistent across many allocations and frees.
+    SlabArena statsArena;
+    // Records allocated below.
+    std::vector<char*> records;
+    // Allocate records of varying sizes.
+    for (int i = 0; i < 10000; ++i) {
+        // Value length cycles through several classes.
+        records.push_back(statsArena.allocate("key" + std::to_string(i), std::string(i % 200, 'v')));
+    }
+    // Free every other record.
+    for (size_t i = 0; i < records.size(); i += 2) {
+        // Free record i.
+        statsArena.deallocate(records[i]);
+    }
+    // Snapshot the figures.
+    ArenaStats stats = statsArena.stats();
+    // Assert that half the records are live.
+    assert(stats.liveRecords == 5000);
+    // Assert the ordering payload <= slots <= reserved.
+    assert(stats.payloadBytes <= stats.slotBytes && stats.slotBytes <= stats.reservedBytes);
+    // Assert that fragmentation is a proper fraction.
+    assert(stats.fragmentation > 0.0 && stats.fragmentation < 1.0);
+    // Print fragmentation for information.
+    std::cout << "Info: fragmentation after freeing half: " << stats.fragmentation << std::endl;
+    // Free the rest so the arena ends empty.
+    for (size_t i = 1; i < records.size(); i += 2) {
+        // Free record i.
+        statsArena.deallocate(records[i]);
+    }
+    // Assert that nothing is live.
+    assert(statsArena.stats().liveRecords == 0 && statsArena.stats().payloadBytes == 0);
+    // Print pass message for test 6.
+    std::cout << "Test 6 (stats) PASSED." << std::endl;
+
+    // Print completion message for SlabArena tests.
+    std::cout << "All SlabArena Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
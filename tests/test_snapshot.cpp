@@ -0,0 +1,180 @@
+#include "../include/snapshot.hpp"
+#include "../include/kv_store.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <fstream> // For damaging snapshot files
+#include <cstdio> // For std::remove
+#include <unistd.h> // For getpid
+
+// Main function for testing snapshots.
+int main() {
+    // Print start message for snapshot tests.
+    std::cout << "Running Snapshot Tests..." << std::endl;
+    // Scratch file for this run.
+    const std::string path = "/tmp/kv_snapshot_test_" + std::to_string(::getpid()) + ".kvs";
+
+    // Test 1: Entries and deadlines written by SnapshotWriter come back unchanged, including block-spanning values.
+    {
+        // Writer for the file.
+        SnapshotWriter writer(path);
+        // Ordinary pair.
+        writer.addEntry("alpha", "one");
+        // Empty value.
+        writer.addEntry("empty", "");
+        // Binary bytes.
+        writer.addEntry(std::string("bin\0ary", 7), std::string("\xff\x00\x80", 3));
+        // A value larger than several checksum blocks.
+        writer.addEntry("large", std::string(3 * Snapshot::CHECKSUM_BLOCK + 17, 'L'));
+        // A deadline for one of them.
+        writer.addDeadline("alpha", 123456789);
+        // Assert that it was written.
+        assert(writer.commit());
+    }
+    // Reader for the file.
+    SnapshotReader reader;
+    // Assert that it validates.
+    assert(reader.open(path) && reader.entryCount() == 4 && reader.deadlineCount() == 1);
+    // Pairs read back.
+    std::vector<std::pair<std::string, std::string>> entries;
+    // Deadlines read back.
+    std::vector<std::pair<std::string, uint64_t>> deadlines;
+    // Read everything.
+    reader.forEachEntry([&](std::string_view key, std::string_view value) { entries.emplace_back(key, value); });
+    // Then the deadlines.
+    reader.forEachDeadline([&](std::string_view key, uint64_t deadline) { deadlines.emplace_back(key, deadline); });
+    // Assert the entries in file order.
+    assert(entries.size() == 4 && entries[0] == std::make_pair(std::string("alpha"), std::string("one")));
+    // Empty value and binary bytes.
+    assert(entries[1].second.empty() && entries[2].first == std::string("bin\0ary", 7) && entries[2].second == std::string("\xff\x00\x80", 3));
+    // The large value.
+    assert(entries[3].second == std::string(3 * Snapshot::CHECKSUM_BLOCK + 17, 'L'));
+    // Assert the deadline.
+    assert(deadlines.size() == 1 && deadlines[0].first == "alpha" && deadlines[0].second == 123456789);
+    // Print pass message for test 1.
+    std::cout << "Test 1 (round trip) PASSED." << std::endl;
+
+    // Test 2: Damaged, truncated, foreign and missing files are rejected.
+    {
+        // Read the good file.
+        std::ifstream in(path, std::ios::binary);
+        // Its bytes.
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        // Writes a variant of the file and returns whether a reader accepts it.
+        auto accepts = [&](const std::string& content) {
+            // Overwrite the file.
+            std::ofstream(path, std::ios::binary | std::ios::trunc) << content;
+            // Try to open it.
+            SnapshotReader damaged;
+            // Report the result.
+            return damaged.open(path);
+        };
+        // Assert that the unchanged bytes still pass.
+        assert(accepts(bytes));
+        // One flipped bit in the middle of the large value.
+        std::string flipped = bytes;
+        // Flip it.
+        flipped[bytes.size() / 2] ^= 0x01;
+        // Assert that the checksum catches it.
+        assert(!accepts(flipped));
+        // Assert that a torn write is caught.
+        assert(!accepts(bytes.substr(0, bytes.size() - 100)));
+        // Assert that a foreign file is rejected.
+        assert(!accepts("not a snapshot file at all, but long enough to hold a header and a footer"));
+        // Restore the good file.
+        assert(accepts(bytes));
+    }
+    // Assert that a missing file is rejected.
+    assert(!SnapshotReader().open(path + ".missing"));
+    // Print pass message for test 2.
+    std::cout << "Test 2 (corruption detection) PASSED." << std::endl;
+
+    // Test 3: An abandoned write leaves the previous snapshot in place.
+    {
+        // Start another snapshot of the same path but never commit it.
+        SnapshotWriter abandoned(path);
+        // Some data.
+        abandoned.addEntry("partial", "write");
+    }
+    // Assert that the old file is intact and no temporary file is left behind.
+    assert(SnapshotReader().open(path) && !std::ifstream(path + ".tmp." + std::to_string(::getpid())).good());
+    // Print pass message for test 3.
+    std::cout << "Test 3 (atomic replacement) PASSED." << std::endl;
+
+    // Test 4: KVStore save and load restore keys, values, prefix index and live deadlines.
+    uint64_t clock = 1000000;
+    // Configuration with a fake clock.
+    KVStoreConfig config;
+    // Read through the variable.
+    config.clock = [&clock]() { return clock; };
+    // Source store.
+    KVStore source(config);
+    // Ten thousand keys.
+    for (int i = 0; i < 10000; ++i) source.set("key:" + std::to_string(i), "value-" + std::to_string(i));
+    // One with a long deadline.
+    source.expire("key:1", 60000);
+    // One expiring soon.
+    source.expire("key:2", 100);
+    // One already expired but not yet reclaimed.
+    source.expire("key:3", 1);
+    // Move past key:3's deadline.
+    clock += 10;
+    // Assert that the save went through.
+    assert(source.save(path) && source.snapshotStats().lastSaveOk);
+    // Move past key:2's deadline before restarting.
+    clock += 200;
+    // Fresh store.
+    KVStore restored(config);
+    // Assert that it loads.
+    assert(restored.load(path));
+    // Assert that key:3 was never saved and key:2 was dropped as expired.
+    assert(restored.size() == 9998 && !restored.getView("key:2") && !restored.getView("key:3"));
+    // Assert that every other value is back.
+    for (int i = 0; i < 10000; ++i) {
+        // Skip the two expired keys.
+        if (i == 2 || i == 3) continue;
+        // Compare the value.
+        assert(restored.get("key:" + std::to_string(i)) == "value-" + std::to_string(i));
+    }
+    // Assert that the remaining deadline carried over.
+    assert(restored.ttl("key:1") == 60000 - 210 && restored.ttl("key:4") == KVStore::TTL_NO_EXPIRY);
+    // Assert that the prefix index was rebuilt.
+    assert(restored.prefixSearch("key:999").size() == 11 && restored.mightContain("key:9999"));
+    // Assert that a non-empty store refuses to load.
+    assert(!restored.load(path));
+    // Assert that the restored store keeps working.
+    assert(restored.set("key:new", "x") && restored.get("key:new") == "x" && restored.size() == 9999);
+    // Informational output.
+    std::cout << "Info: " << restored.snapshotStats().keysLoaded << " keys loaded, " << restored.size() << " live." << std::endl;
+    // Print pass message for test 4.
+    std::cout << "Test 4 (KVStore save and load) PASSED." << std::endl;
+
+    // Test 5: A background save captures the store as of the fork, while the parent keeps writing.
+    KVStore live;
+    // Initial contents.
+    for (int i = 0; i < 1000; ++i) live.set("bg:" + std::to_string(i), "before");
+    // Assert that it started.
+    assert(live.backgroundSave(path) && live.snapshotStats().backgroundSaveInProgress);
+    // A second request is refused while the first runs; if the first already finished, it saves the same state.
+    if (live.backgroundSave(path)) assert(live.waitForBackgroundSave());
+    // Change the parent after the fork.
+    for (int i = 0; i < 1000; ++i) live.set("bg:" + std::to_string(i), "after");
+    // Another key the snapshot must not see.
+    live.set("bg:extra", "after");
+    // Assert that the child succeeded.
+    assert(live.waitForBackgroundSave() && !live.snapshotStats().backgroundSaveInProgress);
+    // Load what it wrote.
+    KVStore pointInTime;
+    // Assert the state at the fork.
+    assert(pointInTime.load(path) && pointInTime.size() == 1000 && pointInTime.get("bg:500") == "before" && !pointInTime.getView("bg:extra"));
+    // Print pass message for test 5.
+    std::cout << "Test 5 (background save) PASSED." << std::endl;
+
+    // Remove the scratch file.
+    std::remove(path.c_str());
+    // Print completion message for snapshot tests.
+    std::cout << "All Snapshot Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
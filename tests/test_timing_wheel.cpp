@@ -0,0 +1,131 @@
+#include "../include/timing_wheel.hpp"
+#include <iostream>
+#include <cassert>
+#include <string>
+#include <vector>
+#include <map> // Reference schedule for the randomized test
+#include <random>
+#include <cstdint> // For SIZE_MAX
+
+// Main function for testing TimingWheel.
+int main() {
+    // Print start message for TimingWheel tests.
+    std::cout << "Running TimingWheel Tests..." << std::endl;
+
+    // Test 1: Timers fire once their deadline is reached, not before.
+    TimingWheel wheel(1000);
+    // Keys fired so far.
+    std::vector<std::string> fired;
+    // Collects fired keys.
+    auto collect = [&](const std::string& key, uint64_t) { fired.push_back(key); };
+    // Three deadlines at different levels.
+    wheel.schedule("soon", 1010);
+    // One level up.
+    wheel.schedule("later", 1500);
+    // Two levels up.
+    wheel.schedule("much-later", 1000 + 10 * 4096);
+    // Assert that all three are pending.
+    assert(wheel.size() == 3);
+    // Move to just before the first deadline.
+    assert(wheel.advance(1009, 100, collect) == 0);
+    // Move onto it.
+    assert(wheel.advance(1010, 100, collect) == 1 && fired.back() == "soon");
+    // Move past the second.
+    assert(wheel.advance(1600, 100, collect) == 1 && fired.back() == "later");
+    // Assert that the third has not fired one tick early.
+    assert(wheel.advance(1000 + 10 * 4096 - 1, 100, collect) == 0);
+    // Reach it.
+    assert(wheel.advance(1000 + 10 * 4096, 100, collect) == 1 && fired.back() == "much-later");
+    // Assert that nothing is left.
+    assert(wheel.size() == 0);
+    // Print pass message for test 1.
+    std::cout << "Test 1 (deadlines across levels) PASSED." << std::endl;
+
+    // Test 2: Past deadlines fire on the next advance, and each advance fires at most its budget.
+    TimingWheel batchWheel(0);
+    // A hundred timers due at tick 50.
+    for (int i = 0; i < 100; ++i) batchWheel.schedule("k" + std::to_string(i), 50);
+    // One already in the past.
+    batchWheel.schedule("past", 0);
+    // Fire at most 30.
+    size_t firstBatch = batchWheel.advance(60, 30, [](const std::string&, uint64_t) {});
+    // Assert the budget held and the rest stayed due.
+    assert(firstBatch == 30 && batchWheel.dueCount() == 71 && batchWheel.size() == 71);
+    // Drain the rest in slices.
+    while (batchWheel.dueCount() != 0) batchWheel.advance(60, 30, [](const std::string&, uint64_t) {});
+    // Assert that everything fired exactly once.
+    assert(batchWheel.size() == 0);
+    // Print pass message for test 2.
+    std::cout << "Test 2 (bounded slices) PASSED." << std::endl;
+
+    // Test 3: A deadline beyond the wheel's span waits in overflow and still fires on time.
+    TimingWheel farWheel(0);
+    // Span of all levels.
+    uint64_t span = uint64_t{1} << (6 * TimingWheel::LEVELS);
+    // Past the span.
+    farWheel.schedule("far", span + 123);
+    // Assert that it does not fire early.
+    assert(farWheel.advance(span + 122, 10, [](const std::string&, uint64_t) {}) == 0);
+    // Deadline reported to the callback.
+    uint64_t reported = 0;
+    // Reach it.
+    assert(farWheel.advance(span + 123, 10, [&](const std::string&, uint64_t deadline) { reported = deadline; }) == 1);
+    // Assert the deadline came along.
+    assert(reported == span + 123);
+    // Print pass message for test 3.
+    std::cout << "Test 3 (overflow beyond the span) PASSED." << std::endl;
+
+    // Test 4: Randomized schedule against a reference: every timer fires exactly when due.
+    std::mt19937_64 rng(11);
+    // Wheel under test.
+    TimingWheel randomWheel(5000);
+    // Reference: deadline -> keys.
+    std::multimap<uint64_t, std::string> reference;
+    // Current time.
+    uint64_t clock = 5000;
+    // Mixed operations.
+    for (int op = 0; op < 20000; ++op) {
+        // Mostly schedule, at spreads from 1 ms to several hours ahead.
+        if (rng() % 3 != 0) {
+            // Distance ahead, on a log scale.
+            uint64_t ahead = rng() % (uint64_t{1} << (rng() % 25));
+            // Key name.
+            std::string key = "t" + std::to_string(op);
+            // Schedule it.
+            randomWheel.schedule(key, clock + ahead);
+            // Record it.
+            reference.emplace(clock + ahead, key);
+        } else {
+            // Move time forward by a random step (sometimes large).
+            clock += rng() % (uint64_t{1} << (rng() % 22));
+            // Fire everything due.
+            randomWheel.advance(clock, SIZE_MAX, [&](const std::string& key, uint64_t deadline) {
+                // Assert that it was due and had not fired early.
+                assert(deadline <= clock);
+                // Find it in the reference.
+                auto range = reference.equal_range(deadline);
+                // Locate the key.
+                auto it = range.first;
+                // Walk the equal deadlines.
+                while (it != range.second && it->second != key) ++it;
+                // Assert that it was scheduled with this deadline.
+                assert(it != range.second);
+                // Fired once.
+                reference.erase(it);
+            });
+            // Assert that nothing due was left behind.
+            assert(reference.empty() || reference.begin()->first > clock);
+        }
+    }
+    // Assert that the pending counts agree.
+    assert(randomWheel.size() == reference.size());
+    // Informational output.
+    std::cout << "Info: " << reference.size() << " timers still pending, wheel memory " << randomWheel.memoryUsage() << " bytes." << std::endl;
+    // Print pass message for test 4.
+    std::cout << "Test 4 (randomized against a reference) PASSED." << std::endl;
+
+    // Print completion message for TimingWheel tests.
+    std::cout << "All TimingWheel Tests PASSED." << std::endl;
+    // Return 0 indicating successful execution.
+    return 0;
+}
@@ -3,6 +3,8 @@
 #include <cassert>
 #include <vector>
 #include <algorithm> // For std::sort
+#include <set> // Reference model for the randomized test
+#include <random> // For std::mt19937
 
 // Main function for testing Trie.
 int main() {
@@ -38,8 +40,8 @@ int main() {
     std::vector<std::string> prefixResults = trie.searchPrefix("app");
     // Sort results for consistent comparison.
     std::sort(prefixResults.begin(), prefixResults.end());
-    // Assert that 3 keys match the prefix "app".
-    assert(prefixResults.size() == 3);
+    // Assert that 2 keys match the prefix "app" ("apricot" only shares "ap").
+    assert(prefixResults.size() == 2);
     // Assert that the first result is "apple".
     assert(prefixResults[0] == "apple");
     // Assert that the second result is "application".
@@ -115,6 +117,277 @@ int main() {
     // Print pass message for test 6.
     std::cout << "Test 6 (remove prefix key) PASSED." << std::endl;
 
+    // Test 7: Node growth and shrinking through every node size keeps keys sorted and reachable.
+    Trie fanOut;
+    // Insert one key per byte value under a shared prefix, so one node grows 4 -> 16 -> 48 -> 256.
+    for (int b = 0; b < 256; ++b) {
+        // Key "k" + byte b + "x".
+        fanOut.insert(std::string("k") + static_cast<char>(b) + "x");
+        // Every key inserted so far must be present.
+        assert(fanOut.contains(std::string("k") + static_cast<char>(b) + "x"));
+    }
+    // Assert that all keys are counted.
+    assert(fanOut.size() == 256);
+    // Results of a prefix search covering every key.
+    std::vector<std::string> fanOutKeys = fanOut.searchPrefix("k");
+    // Assert that all keys are found.
+    assert(fanOutKeys.size() == 256);
+    // Assert that they come back in byte order (0x00 first, 0xFF last).
+    assert(std::is_sorted(fanOutKeys.begin(), fanOutKeys.end()));
+    // Remove them again, shrinking the node 256 -> 48 -> 16 -> 4 and collapsing it.
+    for (int b = 0; b < 256; ++b) {
+        // Assert that each removal succeeds.
+        assert(fanOut.remove(std::string("k") + static_cast<char>(b) + "x"));
+        // Assert that the next key is still reachable after the shrink.
+        if (b < 255) assert(fanOut.contains(std::string("k") + static_cast<char>(b + 1) + "x"));
+    }
+    // Assert that the tree is empty.
+    assert(fanOut.size() == 0);
+    // Assert that every node was freed.
+    assert(fanOut.memoryUsage() == 0);
+    // Print pass message for test 7.
+    std::cout << "Test 7 (node growth/shrink) PASSED." << std::endl;
+
+    // Test 8: Long shared prefixes (beyond the inline prefix bytes) split and merge correctly.
+    Trie longPrefix;
+    // A 40-byte shared path.
+    std::string base(40, 'p');
+    // Insert keys that diverge at the end, in the middle and at the start of the path.
+    longPrefix.insert(base + "a");
+    // Diverges after the whole path.
+    longPrefix.insert(base + "b");
+    // Diverges in the middle of the compressed path.
+    longPrefix.insert(base.substr(0, 25) + "q");
+    // Is a prefix of the other keys.
+    longPrefix.insert(base.substr(0, 25));
+    // Assert that all are present.
+    assert(longPrefix.contains(base + "a") && longPrefix.contains(base + "b"));
+    // Assert that the mid-path keys are present.
+    assert(longPrefix.contains(base.substr(0, 25) + "q") && longPrefix.contains(base.substr(0, 25)));
+    // Assert that a key differing only past the inline bytes is absent.
+    assert(!longPrefix.contains(base.substr(0, 30) + "x" + base.substr(31) + "a"));
+    // Assert that a prefix ending inside the compressed path finds the keys below it.
+    assert(longPrefix.searchPrefix(base.substr(0, 33)).size() == 2);
+    // Assert that a prefix diverging inside the compressed path finds nothing.
+    assert(longPrefix.searchPrefix(base.substr(0, 30) + "z").empty());
+    // Remove the mid-path keys so the path nodes merge back together.
+    assert(longPrefix.remove(base.substr(0, 25)) && longPrefix.remove(base.substr(0, 25) + "q"));
+    // Assert that the long keys are still reachable through the merged path.
+    assert(longPrefix.contains(base + "a") && longPrefix.contains(base + "b"));
+    // Assert that the merged path still rejects a key differing past the inline bytes.
+    assert(!longPrefix.contains(base.substr(0, 30) + "x" + base.substr(31) + "a"));
+    // Print pass message for test 8.
+    std::cout << "Test 8 (long compressed prefixes) PASSED." << std::endl;
+
+    // Test 9: Randomized operations match a std::set, including binary bytes and prefix-related keys.
+    Trie randomTrie;
+    // Reference model.
+    std::set<std::string> model;
+    // Fixed seed for reproducibility.
+    std::mt19937 rng(42);
+    // Small alphabet (with 0x00 and 0xFF) so keys share prefixes and branch often.
+    const char alphabet[] = {'a', 'b', 'c', '\0', static_cast<char>(0xFF)};
+    // Run many operations.
+    for (size_t op = 0; op < 20000; ++op) {
+        // Random key of length 1..12.
+        std::string key(1 + rng() % 12, 'a');
+        // Fill it from the alphabet.
+        for (char& c : key) c = alphabet[rng() % sizeof(alphabet)];
+        // Insert two thirds of the time, remove otherwise.
+        if (rng() % 3 != 0) {
+            // Insert into both.
+            randomTrie.insert(key);
+            // Mirror it.
+            model.insert(key);
+        } else {
+            // Assert that removal reports the same result as the model.
+            assert(randomTrie.remove(key) == (model.erase(key) == 1));
+        }
+        // Assert that the sizes agree.
+        assert(randomTrie.size() == model.size());
+        // Assert that membership agrees for the key.
+        assert(randomTrie.contains(key) == (model.count(key) == 1));
+        // Periodically compare a prefix search.
+        if (op % 100 == 0) {
+            // Prefix of the key.
+            std::string prefix = key.substr(0, 1 + rng() % key.size());
+            // Expected keys from the model.
+            std::vector<std::string> expected;
+            // Walk the model from the prefix.
+            for (auto it = model.lower_bound(prefix); it != model.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) expected.push_back(*it);
+            // Assert that the Trie returns the same keys in the same order.
+            assert(randomTrie.searchPrefix(prefix) == expected);
+            // A random resume key.
+            std::string resume = key.substr(0, rng() % (key.size() + 1)) + alphabet[rng() % sizeof(alphabet)];
+            // Keys the model has after the resume key, within the prefix.
+            std::vector<std::string> expectedAfter;
+            // Walk the model from the later of the prefix start and the resume key.
+            for (auto it = resume >= prefix ? model.upper_bound(resume) : model.lower_bound(prefix);
+                 it != model.end() && it->compare(0, prefix.size(), prefix) == 0; ++it) expectedAfter.push_back(*it);
+            // Keys the iterator returns when resuming after that key.
+            std::vector<std::string> actualAfter;
+            // Resume the scan.
+            Trie::KeyIterator resumed = randomTrie.scanPrefix(prefix, std::string_view(resume));
+            // Collect its keys.
+            while (resumed.next()) actualAfter.emplace_back(resumed.key());
+            // Assert that they match.
+            assert(actualAfter == expectedAfter);
+            // A random range [low, high) in both directions.
+            std::string low = key.substr(0, rng() % (key.size() + 1));
+            // Upper bound built like the resume key.
+            std::string high = resume;
+            // Keys the model has in the range, ascending.
+            std::vector<std::string> expectedRange;
+            // Walk the model from low up to high.
+            for (auto it = model.lower_bound(low); it != model.end() && *it < high; ++it) expectedRange.push_back(*it);
+            // Keys the ascending iterator returns.
+            std::vector<std::string> forwardRange;
+            // Scan up.
+            Trie::KeyIterator up = randomTrie.scanRange(low, std::string_view(high));
+            // Collect its keys.
+            while (up.next()) forwardRange.emplace_back(up.key());
+            // Assert that they match.
+            assert(forwardRange == expectedRange);
+            // Keys the descending iterator returns.
+            std::vector<std::string> reverseRange;
+            // Scan down.
+            Trie::KeyIterator down = randomTrie.scanRange(low, std::string_view(high), true);
+            // Collect its keys.
+            while (down.next()) reverseRange.emplace_back(down.key());
+            // Assert that they are the same keys in the opposite order.
+            assert(std::equal(reverseRange.begin(), reverseRange.end(), expectedRange.rbegin(), expectedRange.rend()));
+        }
+    }
+    // Assert that every model key is present.
+    for (const std::string& key : model) assert(randomTrie.contains(key));
+    // Print pass message for test 9.
+    std::cout << "Test 9 (randomized vs std::set) PASSED." << std::endl;
+
+    // Test 10: Lazy prefix iteration and cursor paging.
+    Trie pagedTrie;
+    // 250 keys under "user:" plus neighbours before and after the prefix range.
+    for (size_t i = 0; i < 250; ++i) pagedTrie.insert("user:" + std::to_string(1000 + i));
+    // Sorts before "user:".
+    pagedTrie.insert("user");
+    // Sorts after every "user:" key.
+    pagedTrie.insert("user;");
+    // Walk the matches lazily.
+    Trie::KeyIterator it = pagedTrie.scanPrefix("user:");
+    // Keys visited.
+    size_t visited = 0;
+    // Previous key, to check the order.
+    std::string previous;
+    // Visit each key.
+    while (it.next()) {
+        // Assert that keys arrive in increasing order.
+        assert(visited == 0 || previous < it.key());
+        // Remember the key.
+        previous = std::string(it.key());
+        // Count it.
+        visited++;
+    }
+    // Assert that exactly the prefixed keys were visited.
+    assert(visited == 250);
+    // Page through the same keys 64 at a time.
+    std::string cursor = Trie::CURSOR_START;
+    // Keys collected from all pages.
+    std::vector<std::string> paged;
+    // Pages fetched.
+    size_t pages = 0;
+    // Fetch until the cursor comes back to the start.
+    do {
+        // Fetch one page.
+        std::optional<PrefixPage> page = pagedTrie.searchPrefix("user:", 64, cursor);
+        // Assert that the cursor was accepted.
+        assert(page.has_value());
+        // Assert that no page exceeds the limit.
+        assert(page->keys.size() <= 64);
+        // Collect the keys.
+        paged.insert(paged.end(), page->keys.begin(), page->keys.end());
+        // Continue from the returned cursor.
+        cursor = page->nextCursor;
+        // Count the page.
+        pages++;
+        // Remove a key on a later page and add one between pages: paging stays consistent.
+        if (pages == 1) {
+            // Remove a key not yet returned.
+            pagedTrie.remove("user:1200");
+            // Add a key after the cursor.
+            pagedTrie.insert("user:1200a");
+        }
+    } while (cursor != Trie::CURSOR_START);
+    // Assert that four pages covered 250 keys.
+    assert(pages == 4 && paged.size() == 250);
+    // Assert that the removed key was skipped and the new one returned.
+    assert(std::find(paged.begin(), paged.end(), "user:1200") == paged.end());
+    // The key added between pages.
+    assert(std::find(paged.begin(), paged.end(), "user:1200a") != paged.end());
+    // Assert that the pages joined up in order without duplicates.
+    assert(std::is_sorted(paged.begin(), paged.end()) && std::adjacent_find(paged.begin(), paged.end()) == paged.end());
+    // Assert that a malformed cursor is rejected.
+    assert(!pagedTrie.searchPrefix("user:", 10, "xyz").has_value());
+    // Assert that a page that exactly exhausts the matches ends the scan.
+    assert(pagedTrie.searchPrefix("user;", 1, Trie::CURSOR_START)->nextCursor == Trie::CURSOR_START);
+    // Print pass message for test 10.
+    std::cout << "Test 10 (prefix iterator and cursor paging) PASSED." << std::endl;
+
+    // Test 11: Range scans in both directions, including open ranges.
+    Trie rangeTrie;
+    // Orders over ten days, five per day.
+    for (int day = 1; day <= 10; ++day) {
+        // Five orders per day.
+        for (int n = 0; n < 5; ++n) rangeTrie.insert("order:2026-10-" + std::string(day < 10 ? "0" : "") + std::to_string(day) + ":" + std::to_string(n));
+    }
+    // A key that equals the upper bound exactly (excluded).
+    rangeTrie.insert("order:2026-10-08");
+    // Keys in [2026-10-01, 2026-10-08).
+    std::vector<std::string> week;
+    // Scan the week.
+    Trie::KeyIterator weekIt = rangeTrie.scanRange("order:2026-10-01", std::string_view("order:2026-10-08"));
+    // Collect it.
+    while (weekIt.next()) week.emplace_back(weekIt.key());
+    // Assert that seven days of five orders were found, in order.
+    assert(week.size() == 35 && week.front() == "order:2026-10-01:0" && week.back() == "order:2026-10-07:4");
+    // The same range descending.
+    Trie::KeyIterator weekDown = rangeTrie.scanRange("order:2026-10-01", std::string_view("order:2026-10-08"), true);
+    // Assert that the first key descending is the last ascending.
+    assert(weekDown.next() && weekDown.key() == "order:2026-10-07:4");
+    // Open-ended descending scan from the top.
+    Trie::KeyIterator top = rangeTrie.scanRange("order:2026-10-10", std::nullopt, true);
+    // Keys visited.
+    size_t topCount = 0;
+    // Count them.
+    while (top.next()) topCount++;
+    // Assert that only the last day was visited.
+    assert(topCount == 5);
+    // Assert that an empty range yields nothing.
+    assert(!rangeTrie.scanRange("order:2026-10-05", std::string_view("order:2026-10-05")).next());
+    // Print pass message for test 11.
+    std::cout << "Test 11 (range scans) PASSED." << std::endl;
+
+    // Test 12: The empty key can be removed like any other, alone or next to other keys.
+    Trie emptyTrie;
+    // Alone: the root is a bare leaf.
+    emptyTrie.insert("");
+    // Assert that it is there.
+    assert(emptyTrie.contains("") && emptyTrie.size() == 1);
+    // Assert that removing it empties the Trie.
+    assert(emptyTrie.remove("") && !emptyTrie.contains("") && emptyTrie.size() == 0 && emptyTrie.searchPrefix("").empty());
+    // Assert that a second removal finds nothing.
+    assert(!emptyTrie.remove(""));
+    // Next to other keys: it sits in the root's terminal slot.
+    for (const char* key : {"", "a", "ab", "b"}) emptyTrie.insert(key);
+    // Assert that it is listed first.
+    assert(emptyTrie.searchPrefix("").size() == 4 && emptyTrie.searchPrefix("")[0].empty());
+    // Assert that removing it leaves the others.
+    assert(emptyTrie.remove("") && !emptyTrie.contains("") && emptyTrie.size() == 3);
+    // Assert that it is no longer listed.
+    assert(emptyTrie.searchPrefix("") == std::vector<std::string>({"a", "ab", "b"}));
+    // Assert that the others are still removable.
+    assert(emptyTrie.remove("a") && emptyTrie.remove("ab") && emptyTrie.remove("b") && emptyTrie.size() == 0);
+    // Print pass message for test 12.
+    std::cout << "Test 12 (empty key) PASSED." << std::endl;
+
     // Print completion message for Trie tests.
     std::cout << "All Trie Tests PASSED." << std::endl;
     // Return 0 indicating successful execution.